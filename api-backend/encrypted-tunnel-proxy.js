@@ -11,6 +11,12 @@ import WebSocket from 'ws';
 import express from 'express';
 import { createProxyMiddleware } from 'http-proxy-middleware';
 import crypto from 'crypto';
+import {
+  BINARY_FRAMES_CAPABILITY,
+  LZ4_COMPRESSION_CAPABILITY,
+  DIRECTION_CLOUD_TO_DESKTOP,
+  TunnelFrameSession,
+} from './tunnel-frame.js';
 
 class EncryptedTunnelProxy {
   constructor(options = {}) {
@@ -27,6 +33,8 @@ class EncryptedTunnelProxy {
     this.sessionKey = null;
     this.sessionId = null;
     this.devicePublicKey = null;
+    // Binary frame session, when the desktop supports binary frames
+    this.frameSession = null;
     
     // HTTP proxy server
     this.app = express();
@@ -124,8 +132,12 @@ class EncryptedTunnelProxy {
         resolve();
       });
       
-      this.ws.on('message', (data) => {
-        this.handleMessage(data);
+      this.ws.on('message', (data, isBinary) => {
+        if (isBinary) {
+          this.handleFrame(data);
+        } else {
+          this.handleMessage(data);
+        }
       });
       
       this.ws.on('error', (error) => {
@@ -158,6 +170,7 @@ class EncryptedTunnelProxy {
       id: this.generateId(),
       publicKey: keyPair.publicKey.toString('base64'),
       userId: this.userId,
+      capabilities: [BINARY_FRAMES_CAPABILITY, LZ4_COMPRESSION_CAPABILITY],
       timestamp: new Date().toISOString()
     };
     
@@ -217,6 +230,12 @@ class EncryptedTunnelProxy {
       
       this.sessionId = message.sessionId;
       this.devicePublicKey = message.publicKey;
+      const capabilities = message.capabilities || [];
+      this.frameSession = capabilities.includes(BINARY_FRAMES_CAPABILITY)
+        ? new TunnelFrameSession(this.sessionKey, this.sessionId, DIRECTION_CLOUD_TO_DESKTOP, {
+          compress: capabilities.includes(LZ4_COMPRESSION_CAPABILITY),
+        })
+        : null;
       
       console.log('🔐 [TunnelProxy] Encrypted session established:', this.sessionId);
     } catch (error) {
@@ -235,23 +254,52 @@ class EncryptedTunnelProxy {
       
       // Decrypt message
       const decryptedData = this.decryptData(encryptedMessage.encryptedData);
-      const message = JSON.parse(decryptedData);
-      
-      switch (message.type) {
-        case 'httpResponse':
-          this.handleHttpResponse(message);
-          break;
-        case 'pong':
-          console.log('🔐 [TunnelProxy] Pong received');
-          break;
-        default:
-          console.log('🔐 [TunnelProxy] Unknown encrypted message:', message.type);
-      }
+      this.handleTunnelMessage(JSON.parse(decryptedData));
     } catch (error) {
       console.error('🔐 [TunnelProxy] Error handling encrypted message:', error);
     }
   }
   
+  /**
+   * Handle binary tunnel frames; bodies arrive as Buffers
+   */
+  handleFrame(frame) {
+    try {
+      if (!this.frameSession) {
+        throw new Error('No binary frame session available');
+      }
+      
+      this.handleTunnelMessage(this.frameSession.open(frame));
+    } catch (error) {
+      console.error('🔐 [TunnelProxy] Error handling tunnel frame:', error);
+    }
+  }
+  
+  /**
+   * Dispatch a decrypted tunnel message
+   */
+  handleTunnelMessage(message) {
+    switch (message.type) {
+      case 'httpResponse':
+        this.handleHttpResponse(message);
+        break;
+      case 'httpResponseStart':
+        this.handleHttpResponseStart(message);
+        break;
+      case 'httpResponseChunk':
+        this.handleHttpResponseChunk(message);
+        break;
+      case 'httpResponseEnd':
+        this.handleHttpResponseEnd(message);
+        break;
+      case 'pong':
+        console.log('🔐 [TunnelProxy] Pong received');
+        break;
+      default:
+        console.log('🔐 [TunnelProxy] Unknown encrypted message:', message.type);
+    }
+  }
+  
   /**
    * Handle HTTP response from desktop
    */
@@ -276,6 +324,99 @@ class EncryptedTunnelProxy {
     }
   }
   
+  /**
+   * Handle the start of a streamed response: status and headers only
+   */
+  handleHttpResponseStart(response) {
+    const pendingRequest = this.pendingRequests.get(response.correlationId);
+    if (!pendingRequest) {
+      console.warn('🔐 [TunnelProxy] No pending request for correlation ID:', response.correlationId);
+      return;
+    }
+
+    const { res } = pendingRequest;
+    pendingRequest.streaming = true;
+    pendingRequest.unacknowledged = 0;
+
+    // The body is re-framed here, so the desktop's framing headers don't apply
+    Object.entries(response.headers || {}).forEach(([key, value]) => {
+      const name = key.toLowerCase();
+      if (name !== 'content-length' && name !== 'transfer-encoding' && name !== 'connection') {
+        res.setHeader(key, value);
+      }
+    });
+    res.status(response.statusCode);
+    res.flushHeaders();
+  }
+
+  /**
+   * Forward one body chunk of a streamed response
+   *
+   * Each chunk is acknowledged once it has been handed to the socket, which
+   * returns send credit to the desktop; a slow client therefore stalls the
+   * desktop's read from Ollama instead of piling up frames in memory.
+   */
+  handleHttpResponseChunk(chunk) {
+    const pendingRequest = this.pendingRequests.get(chunk.correlationId);
+    if (!pendingRequest || !pendingRequest.streaming) {
+      // The client went away; keep the desktop draining so it can finish
+      this.sendChunkAck(chunk.correlationId, 1);
+      return;
+    }
+
+    pendingRequest.res.write(chunk.body, () => {
+      pendingRequest.unacknowledged++;
+      if (pendingRequest.ackScheduled) {
+        return;
+      }
+      // Acknowledge writes that complete together in one frame
+      pendingRequest.ackScheduled = true;
+      setImmediate(() => {
+        pendingRequest.ackScheduled = false;
+        const frames = pendingRequest.unacknowledged;
+        pendingRequest.unacknowledged = 0;
+        if (frames > 0) {
+          this.sendChunkAck(chunk.correlationId, frames);
+        }
+      });
+    });
+  }
+
+  /**
+   * Return send credit for a streamed response to the desktop
+   */
+  sendChunkAck(correlationId, frames) {
+    this.sendEncryptedMessage({
+      type: 'httpResponseAck',
+      id: this.generateId(),
+      correlationId,
+      frames,
+    }).catch((error) => {
+      console.error('🔐 [TunnelProxy] Failed to acknowledge chunk:', error);
+    });
+  }
+
+  /**
+   * Finish a streamed response
+   */
+  handleHttpResponseEnd(end) {
+    const pendingRequest = this.pendingRequests.get(end.correlationId);
+    if (!pendingRequest) {
+      return;
+    }
+
+    const { res } = pendingRequest;
+    if (end.error && !pendingRequest.streaming) {
+      res.status(502).json({ error: 'Local request failed', details: end.error });
+    } else {
+      if (end.error) {
+        console.error('🔐 [TunnelProxy] Streamed response failed:', end.error);
+      }
+      res.end();
+    }
+    this.pendingRequests.delete(end.correlationId);
+  }
+  
   /**
    * Proxy HTTP request through encrypted tunnel
    */
@@ -288,6 +429,7 @@ class EncryptedTunnelProxy {
     
     // Store pending request
     this.pendingRequests.set(requestId, { req, res });
+    res.on('close', () => this.pendingRequests.delete(requestId));
     
     // Create HTTP request message
     const httpRequest = {
@@ -304,9 +446,11 @@ class EncryptedTunnelProxy {
     // Send encrypted request
     await this.sendEncryptedMessage(httpRequest);
     
-    // Set timeout for request
+    // Set timeout for request; a streamed response that has started may
+    // legitimately run for longer
     setTimeout(() => {
-      if (this.pendingRequests.has(requestId)) {
+      const pendingRequest = this.pendingRequests.get(requestId);
+      if (pendingRequest && !pendingRequest.streaming) {
         this.pendingRequests.delete(requestId);
         if (!res.headersSent) {
           res.status(504).json({ error: 'Tunnel request timeout' });
@@ -323,6 +467,14 @@ class EncryptedTunnelProxy {
       throw new Error('No session key available');
     }
     
+    if (this.frameSession) {
+      if (!this.ws || this.ws.readyState !== WebSocket.OPEN) {
+        throw new Error('WebSocket not connected');
+      }
+      this.ws.send(this.frameSession.seal(message), { binary: true });
+      return;
+    }
+    
     const messageJson = JSON.stringify(message);
     const encryptedData = this.encryptData(messageJson);
     
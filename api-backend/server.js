@@ -312,7 +312,13 @@ encryptedTunnelWss.on('connection', (ws, req) => {
   });
 
   // Handle messages from encrypted tunnel
-  ws.on('message', (data) => {
+  ws.on('message', (data, isBinary) => {
+    // Binary messages are sealed tunnel frames; relay them untouched
+    if (isBinary) {
+      handleEncryptedFrame(connectionId, data);
+      return;
+    }
+
     try {
       const message = JSON.parse(data);
       handleEncryptedTunnelMessage(connectionId, message);
@@ -451,6 +457,7 @@ function handleKeyExchange(connectionId, message) {
         id: uuidv4(),
         sessionId,
         publicKey: message.publicKey, // Container's public key to desktop
+        capabilities: message.capabilities || [],
         timestamp: new Date().toISOString()
       };
 
@@ -465,6 +472,7 @@ function handleKeyExchange(connectionId, message) {
         id: uuidv4(),
         sessionId,
         publicKey: desktopConnection.publicKey || '', // Desktop's public key to container
+        capabilities: desktopConnection.capabilities || [],
         timestamp: new Date().toISOString()
       };
 
@@ -476,25 +484,27 @@ function handleKeyExchange(connectionId, message) {
     }
   }
 
-  // Store public key for this connection
+  // Store public key and advertised protocol features for this connection
   connection.publicKey = message.publicKey;
+  connection.capabilities = Array.isArray(message.capabilities) ? message.capabilities : [];
 }
 
-// Handle encrypted data relay
-function handleEncryptedData(connectionId, message) {
+// Find the other party in a connection's encrypted tunnel session
+function findSessionPeer(connectionId) {
   const connection = encryptedTunnelConnections.get(connectionId);
   if (!connection || !connection.sessionId) {
     logger.warn(`🔐 [EncryptedTunnel] Encrypted data from connection without session: ${connectionId}`);
-    return;
+    return null;
   }
 
   const session = encryptedTunnelSessions.get(connection.sessionId);
   if (!session) {
     logger.warn(`🔐 [EncryptedTunnel] Encrypted data for unknown session: ${connection.sessionId}`);
-    return;
+    return null;
   }
 
   // Update session activity
+  connection.lastActivity = new Date();
   session.lastActivity = new Date();
 
   // Determine target connection (relay to the other party in the session)
@@ -505,24 +515,44 @@ function handleEncryptedData(connectionId, message) {
     targetConnectionId = session.desktopConnectionId;
   } else {
     logger.warn(`🔐 [EncryptedTunnel] Connection ${connectionId} not part of session ${session.sessionId}`);
-    return;
+    return null;
   }
 
   const targetConnection = encryptedTunnelConnections.get(targetConnectionId);
   if (!targetConnection || targetConnection.ws.readyState !== WebSocket.OPEN) {
     logger.warn(`🔐 [EncryptedTunnel] Target connection ${targetConnectionId} not available for relay`);
-    return;
+    return null;
   }
 
+  return targetConnection;
+}
+
+// Handle encrypted data relay
+function handleEncryptedData(connectionId, message) {
+  const targetConnection = findSessionPeer(connectionId);
+  if (!targetConnection) return;
+
   // Relay encrypted message (server cannot decrypt)
   try {
     targetConnection.ws.send(JSON.stringify(message));
-    logger.debug(`🔐 [EncryptedTunnel] Relayed encrypted data from ${connectionId} to ${targetConnectionId}`);
+    logger.debug(`🔐 [EncryptedTunnel] Relayed encrypted data from ${connectionId} to ${targetConnection.connectionId}`);
   } catch (error) {
     logger.error(`🔐 [EncryptedTunnel] Failed to relay encrypted data:`, error);
   }
 }
 
+// Relay a binary tunnel frame (see tunnel-frame.js) without parsing it
+function handleEncryptedFrame(connectionId, frame) {
+  const targetConnection = findSessionPeer(connectionId);
+  if (!targetConnection) return;
+
+  try {
+    targetConnection.ws.send(frame, { binary: true });
+  } catch (error) {
+    logger.error(`🔐 [EncryptedTunnel] Failed to relay encrypted frame:`, error);
+  }
+}
+
 // Clean up pending requests for a disconnected bridge
 function cleanupPendingRequestsForBridge(bridgeId) {
   const requestsToCleanup = [];
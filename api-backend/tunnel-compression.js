@@ -0,0 +1,192 @@
+/**
+ * Payload compression for encrypted tunnel frames ("lz4-dict-v1")
+ *
+ * Mirrors native/tunnel_compression.h in the desktop app. A compressed
+ * payload is a u32 little-endian uncompressed size followed by one LZ4 block
+ * whose matches may reach back into DICTIONARY, as if it preceded the data.
+ * Frames are compressed one at a time, so the dictionary is what lets a
+ * single short NDJSON line shrink.
+ */
+
+// Shared with the desktop; changing a byte of it changes the wire format.
+export const DICTIONARY = Buffer.from(
+  '{"status":"pulling manifest"}{"status":"verifying sha256 digest"}{' +
+  '"status":"writing manifest"}{"status":"success"}{"status":"downloa' +
+  'ding","digest":"sha256:","total":,"completed":}{"version":"0.5.7"}' +
+  '{"models":[{"name":"","model":"","expires_at":"","size_vram":{"emb' +
+  'eddings":[[0.0,-0.0,{"model":"","messages":[{"role":"system","cont' +
+  'ent":""},{"role":"user","content":""}],"stream":true,"options":{"t' +
+  'emperature":,"num_ctx":}}{"models":[{"name":"","model":"","modifie' +
+  'd_at":"","size":,"digest":"sha256:","details":{"parent_model":"","' +
+  'format":"gguf","family":"llama","families":["llama"],"parameter_si' +
+  'ze":"8.0B","quantization_level":"Q4_K_M"}}]}"response":"","context' +
+  '":["done":true,"done_reason":"stop","total_duration":,"load_durati' +
+  'on":,"prompt_eval_count":,"prompt_eval_duration":,"eval_count":,"e' +
+  'val_duration":}content-type: application/json; charset=utf-8 appli' +
+  'cation/x-ndjson content-length: {"model":"llama3.2:latest","create' +
+  'd_at":"2025-01-01T00:00:00.000000000Z","message":{"role":"assistan' +
+  't","content":""},"done":false}',
+  'latin1',
+);
+
+// Payloads below this are sent as they are.
+export const MIN_COMPRESS_SIZE = 96;
+// Largest uncompressed size accepted from a peer.
+export const MAX_DECOMPRESSED_SIZE = 16 * 1024 * 1024;
+
+const HASH_BITS = 12;
+const MIN_MATCH = 4;
+const MAX_OFFSET = 65535;
+// LZ4 block rules: the last five bytes are always literals, and the last
+// match starts at least twelve bytes before the end.
+const LAST_LITERALS = 5;
+const MATCH_START_MARGIN = 12;
+
+function hash(window, position) {
+  return Math.imul(window.readUInt32LE(position), 2654435761) >>> (32 - HASH_BITS);
+}
+
+/**
+ * Compress a payload, or return null if it is too small or would shrink by
+ * less than an eighth (send it raw then)
+ */
+export function compressPayload(payload) {
+  const size = payload.length;
+  if (size < MIN_COMPRESS_SIZE || size > MAX_DECOMPRESSED_SIZE) {
+    return null;
+  }
+  const start = DICTIONARY.length;
+  const end = start + size;
+  const window = Buffer.concat([DICTIONARY, payload]);
+  const table = new Int32Array(1 << HASH_BITS).fill(-1);
+  for (let i = 0; i + MIN_MATCH <= start; i++) {
+    table[hash(window, i)] = i;
+  }
+
+  const limit = size - Math.floor(size / 8);
+  const out = Buffer.allocUnsafe(limit + 16);
+  out.writeUInt32LE(size, 0);
+  let length = 4;
+  const putLength = (value) => {
+    for (; value >= 255; value -= 255) {
+      out[length++] = 255;
+    }
+    out[length++] = value;
+  };
+  // Appends literals window[anchor..position) and, unless matchLength is 0,
+  // a match offset back. False once the output outgrows the limit.
+  const putSequence = (anchor, position, offset, matchLength) => {
+    const literals = position - anchor;
+    const matchCode = matchLength === 0 ? 0 : matchLength - MIN_MATCH;
+    // Worst case for this sequence, checked before writing anything.
+    if (length + 1 + literals + literals / 255 + 3 + matchCode / 255 + 1 > out.length) {
+      return false;
+    }
+    out[length++] = (Math.min(literals, 15) << 4) | Math.min(matchCode, 15);
+    if (literals >= 15) putLength(literals - 15);
+    window.copy(out, length, anchor, position);
+    length += literals;
+    if (matchLength === 0) return true;
+    out.writeUInt16LE(offset, length);
+    length += 2;
+    if (matchCode >= 15) putLength(matchCode - 15);
+    return length <= limit;
+  };
+
+  const matchStartLimit = end - MATCH_START_MARGIN;
+  const matchEndLimit = end - LAST_LITERALS;
+  let anchor = start;
+  let position = start;
+  while (position < matchStartLimit) {
+    const slot = hash(window, position);
+    let reference = table[slot];
+    table[slot] = position;
+    if (reference < 0 || position - reference > MAX_OFFSET ||
+        window.readUInt32LE(reference) !== window.readUInt32LE(position)) {
+      position += 1 + ((position - anchor) >> 6);
+      continue;
+    }
+    let matchLength = MIN_MATCH;
+    while (position + matchLength < matchEndLimit &&
+           window[reference + matchLength] === window[position + matchLength]) {
+      matchLength++;
+    }
+    while (position > anchor && reference > 0 &&
+           window[position - 1] === window[reference - 1]) {
+      position--;
+      reference--;
+      matchLength++;
+    }
+    if (!putSequence(anchor, position, position - reference, matchLength)) {
+      return null;
+    }
+    position += matchLength;
+    anchor = position;
+  }
+  if (!putSequence(anchor, end, 0, 0) || length > limit) {
+    return null;
+  }
+  return out.subarray(0, length);
+}
+
+/**
+ * Decompress a payload produced by compressPayload (or the desktop); throws
+ * if it is malformed
+ */
+export function decompressPayload(payload) {
+  const fail = () => {
+    throw new Error('Malformed compressed tunnel payload');
+  };
+  if (payload.length < 4) fail();
+  const size = payload.readUInt32LE(0);
+  if (size > MAX_DECOMPRESSED_SIZE) fail();
+
+  const start = DICTIONARY.length;
+  const end = start + size;
+  const window = Buffer.allocUnsafe(end);
+  DICTIONARY.copy(window, 0);
+  let input = 4;
+  let position = start;
+  const readLength = (base) => {
+    let value = base;
+    let byte;
+    do {
+      if (input === payload.length) fail();
+      byte = payload[input++];
+      value += byte;
+    } while (byte === 255 && value <= MAX_DECOMPRESSED_SIZE);
+    if (value > MAX_DECOMPRESSED_SIZE) fail();
+    return value;
+  };
+
+  for (;;) {
+    if (input === payload.length) fail();
+    const token = payload[input++];
+    let literals = token >> 4;
+    if (literals === 15) literals = readLength(literals);
+    if (literals > payload.length - input || literals > end - position) fail();
+    payload.copy(window, position, input, input + literals);
+    input += literals;
+    position += literals;
+    if (input === payload.length) break;
+
+    if (payload.length - input < 2) fail();
+    const offset = payload.readUInt16LE(input);
+    input += 2;
+    let matchLength = token & 15;
+    if (matchLength === 15) matchLength = readLength(matchLength);
+    matchLength += MIN_MATCH;
+    if (offset === 0 || offset > position || matchLength > end - position) fail();
+    if (offset >= matchLength) {
+      window.copy(window, position, position - offset, position - offset + matchLength);
+      position += matchLength;
+    } else {
+      // Overlapping copy: the match repeats the bytes it is producing.
+      for (let from = position - offset; matchLength > 0; matchLength--) {
+        window[position++] = window[from++];
+      }
+    }
+  }
+  if (position !== end) fail();
+  return window.subarray(start);
+}
@@ -0,0 +1,374 @@
+/**
+ * Binary frame codec for the encrypted tunnel
+ *
+ * Mirrors native/tunnel_frame.h in the desktop app. Each frame travels as one
+ * binary WebSocket message; the header is authenticated as AAD and message
+ * bodies are carried as raw bytes instead of base64 inside JSON.
+ *
+ *   0   u8   version (1)
+ *   1   u8   message type (see MESSAGE_TYPES)
+ *   2   u8   flags (FLAG_COMPRESSED), other bits 0
+ *   3   u8   session id length n
+ *   4   u32  ciphertext length, including the 16-byte tag
+ *   8   u64  sender's monotonic clock in microseconds
+ *   16  u32  direction (see DIRECTION_*)
+ *   20  u64  per-direction sequence number
+ *   28  n    session id
+ *   28+n     ChaCha20-Poly1305 ciphertext, tag
+ *
+ * Bytes 16..27 double as the nonce. All integers are little-endian.
+ */
+
+import crypto from 'crypto';
+
+import { compressPayload, decompressPayload } from './tunnel-compression.js';
+
+export const FRAME_VERSION = 1;
+export const BINARY_FRAMES_CAPABILITY = 'binary-frames-v1';
+// Payloads may be compressed (see tunnel-compression.js). Each side
+// compresses what it sends only if the other advertised this.
+export const LZ4_COMPRESSION_CAPABILITY = 'lz4-dict-v1';
+
+export const DIRECTION_DESKTOP_TO_CLOUD = 0;
+export const DIRECTION_CLOUD_TO_DESKTOP = 1;
+// Streamed response bodies, sealed by the desktop's HTTP worker thread with
+// their own sequence numbers.
+export const DIRECTION_DESKTOP_TO_CLOUD_STREAM = 2;
+const DIRECTION_COUNT = 3;
+
+// TunnelMessageType index + 1 on the Dart side.
+export const MESSAGE_TYPES = {
+  httpRequest: 1,
+  httpResponse: 2,
+  error: 5,
+  ping: 6,
+  pong: 7,
+  // Streamed responses: start (status, headers), body chunks, end, and the
+  // acknowledgement that returns send credit to the desktop.
+  httpResponseStart: 8,
+  httpResponseChunk: 9,
+  httpResponseEnd: 10,
+  httpResponseAck: 11,
+};
+
+const FIXED_HEADER_SIZE = 28;
+const TAG_SIZE = 16;
+const FLAG_COMPRESSED = 1 << 0;
+
+const TYPE_NAMES = Object.fromEntries(
+  Object.entries(MESSAGE_TYPES).map(([name, code]) => [code, name]),
+);
+
+function fromDesktop(direction) {
+  return direction !== DIRECTION_CLOUD_TO_DESKTOP;
+}
+
+/**
+ * Seals and opens frames for one tunnel session
+ *
+ * Compressed frames are always accepted; with { compress: true } the frames
+ * sealed are compressed too when that pays off.
+ */
+export class TunnelFrameSession {
+  constructor(key, sessionId, outgoingDirection, { compress = false } = {}) {
+    this.key = key;
+    this.compress = compress;
+    this.sessionId = Buffer.from(sessionId || '', 'utf8');
+    this.outgoingDirection = outgoingDirection;
+    this.nextSequence = 0n;
+    // Lowest sequence number still acceptable from each direction
+    this.nextReceivedSequence = new Array(DIRECTION_COUNT).fill(0n);
+  }
+
+  /**
+   * Build a frame for a message object ({ type, id, ... })
+   */
+  seal(message) {
+    const type = MESSAGE_TYPES[message.type];
+    if (!type) {
+      throw new Error(`Message type ${message.type} cannot be framed`);
+    }
+    let payload = encodePayload(message);
+    let flags = 0;
+    if (this.compress) {
+      const compressed = compressPayload(payload);
+      if (compressed) {
+        payload = compressed;
+        flags |= FLAG_COMPRESSED;
+      }
+    }
+
+    const header = Buffer.alloc(FIXED_HEADER_SIZE + this.sessionId.length);
+    header.writeUInt8(FRAME_VERSION, 0);
+    header.writeUInt8(type, 1);
+    header.writeUInt8(flags, 2);
+    header.writeUInt8(this.sessionId.length, 3);
+    header.writeUInt32LE(payload.length + TAG_SIZE, 4);
+    header.writeBigUInt64LE(process.hrtime.bigint() / 1000n, 8);
+    header.writeUInt32LE(this.outgoingDirection, 16);
+    header.writeBigUInt64LE(this.nextSequence++, 20);
+    this.sessionId.copy(header, FIXED_HEADER_SIZE);
+
+    const cipher = crypto.createCipheriv(
+      'chacha20-poly1305',
+      this.key,
+      header.subarray(16, 28),
+      { authTagLength: TAG_SIZE },
+    );
+    cipher.setAAD(header, { plaintextLength: payload.length });
+    const ciphertext = Buffer.concat([cipher.update(payload), cipher.final()]);
+
+    return Buffer.concat([header, ciphertext, cipher.getAuthTag()]);
+  }
+
+  /**
+   * Authenticate and decode a frame; throws if it is invalid
+   */
+  open(frame) {
+    if (frame.length < FIXED_HEADER_SIZE || frame.readUInt8(0) !== FRAME_VERSION) {
+      throw new Error('Malformed tunnel frame');
+    }
+    const type = frame.readUInt8(1);
+    const flags = frame.readUInt8(2);
+    const sessionIdLength = frame.readUInt8(3);
+    const ciphertextLength = frame.readUInt32LE(4);
+    const headerLength = FIXED_HEADER_SIZE + sessionIdLength;
+    if ((flags & ~FLAG_COMPRESSED) !== 0 ||
+        ciphertextLength < TAG_SIZE || frame.length !== headerLength + ciphertextLength) {
+      throw new Error('Malformed tunnel frame');
+    }
+
+    const direction = frame.readUInt32LE(16);
+    const sequence = frame.readBigUInt64LE(20);
+    const sessionId = frame.subarray(FIXED_HEADER_SIZE, headerLength);
+    if (direction >= DIRECTION_COUNT ||
+        fromDesktop(direction) === fromDesktop(this.outgoingDirection) ||
+        !sessionId.equals(this.sessionId)) {
+      throw new Error('Tunnel frame belongs to another session');
+    }
+    if (sequence < this.nextReceivedSequence[direction]) {
+      throw new Error('Replayed tunnel frame');
+    }
+
+    const header = frame.subarray(0, headerLength);
+    const ciphertext = frame.subarray(headerLength, frame.length - TAG_SIZE);
+    const decipher = crypto.createDecipheriv(
+      'chacha20-poly1305',
+      this.key,
+      frame.subarray(16, 28),
+      { authTagLength: TAG_SIZE },
+    );
+    decipher.setAAD(header, { plaintextLength: ciphertext.length });
+    decipher.setAuthTag(frame.subarray(frame.length - TAG_SIZE));
+    const plaintext = Buffer.concat([decipher.update(ciphertext), decipher.final()]);
+
+    this.nextReceivedSequence[direction] = sequence + 1n;
+    const payload = flags & FLAG_COMPRESSED ? decompressPayload(plaintext) : plaintext;
+    const typeName = TYPE_NAMES[type];
+    if (!typeName) {
+      throw new Error(`Unknown tunnel message type ${type}`);
+    }
+    return decodePayload(typeName, payload);
+  }
+}
+
+class PayloadWriter {
+  constructor() {
+    this.parts = [];
+  }
+
+  u8(value) {
+    this.parts.push(Buffer.from([value]));
+  }
+
+  u16(value) {
+    const buffer = Buffer.alloc(2);
+    buffer.writeUInt16LE(value);
+    this.parts.push(buffer);
+  }
+
+  u32(value) {
+    const buffer = Buffer.alloc(4);
+    buffer.writeUInt32LE(value);
+    this.parts.push(buffer);
+  }
+
+  string(value) {
+    const bytes = Buffer.from(value || '', 'utf8');
+    const length = Buffer.alloc(4);
+    length.writeUInt32LE(bytes.length);
+    this.parts.push(length, bytes);
+  }
+
+  headers(headers) {
+    const entries = Object.entries(headers || {}).filter(([, value]) => value !== undefined);
+    this.u16(entries.length);
+    for (const [name, value] of entries) {
+      this.string(name);
+      this.string(Array.isArray(value) ? value.join(', ') : String(value));
+    }
+  }
+
+  bytes(value) {
+    this.parts.push(Buffer.isBuffer(value) ? value : Buffer.from(value, 'utf8'));
+  }
+
+  toBuffer() {
+    return Buffer.concat(this.parts);
+  }
+}
+
+class PayloadReader {
+  constructor(buffer) {
+    this.buffer = buffer;
+    this.offset = 0;
+  }
+
+  u8() {
+    return this.buffer.readUInt8(this.offset++);
+  }
+
+  u16() {
+    const value = this.buffer.readUInt16LE(this.offset);
+    this.offset += 2;
+    return value;
+  }
+
+  u32() {
+    const value = this.buffer.readUInt32LE(this.offset);
+    this.offset += 4;
+    return value;
+  }
+
+  string() {
+    const length = this.buffer.readUInt32LE(this.offset);
+    this.offset += 4;
+    const value = this.buffer.toString('utf8', this.offset, this.offset + length);
+    this.offset += length;
+    return value;
+  }
+
+  headers() {
+    const headers = {};
+    const count = this.u16();
+    for (let i = 0; i < count; i++) {
+      const name = this.string();
+      headers[name] = this.string();
+    }
+    return headers;
+  }
+
+  rest() {
+    return this.buffer.subarray(this.offset);
+  }
+}
+
+/**
+ * Encode the plaintext payload for a message; must match TunnelPayloadCodec
+ * in lib/services/encrypted_tunnel_protocol.dart
+ */
+export function encodePayload(message) {
+  const writer = new PayloadWriter();
+  writer.string(message.id);
+  switch (message.type) {
+    case 'httpRequest':
+      writer.string(message.method);
+      writer.string(message.path);
+      writer.string(message.correlationId);
+      writer.headers(message.headers);
+      writer.u8(message.body !== undefined && message.body !== null ? 1 : 0);
+      if (message.body !== undefined && message.body !== null) {
+        writer.bytes(message.body);
+      }
+      break;
+    case 'httpResponse':
+      writer.u16(message.statusCode);
+      writer.string(message.correlationId);
+      writer.headers(message.headers);
+      writer.u8(message.body !== undefined && message.body !== null ? 1 : 0);
+      if (message.body !== undefined && message.body !== null) {
+        writer.bytes(message.body);
+      }
+      break;
+    case 'error':
+      writer.string(message.error);
+      writer.string(message.correlationId);
+      writer.u8(message.details ? 1 : 0);
+      writer.string(message.details);
+      break;
+    case 'ping':
+      break;
+    case 'pong':
+      writer.string(message.pingId);
+      break;
+    case 'httpResponseAck':
+      writer.string(message.correlationId);
+      writer.u32(message.frames);
+      break;
+    default:
+      throw new Error(`Message type ${message.type} cannot be framed`);
+  }
+  return writer.toBuffer();
+}
+
+/**
+ * Decode a payload produced by encodePayload; bodies stay Buffers
+ */
+export function decodePayload(type, payload) {
+  const reader = new PayloadReader(payload);
+  const message = { type, id: reader.string() };
+  switch (type) {
+    case 'httpRequest': {
+      message.method = reader.string();
+      message.path = reader.string();
+      message.correlationId = reader.string() || undefined;
+      message.headers = reader.headers();
+      message.body = reader.u8() ? reader.rest() : undefined;
+      break;
+    }
+    case 'httpResponse': {
+      message.statusCode = reader.u16();
+      message.correlationId = reader.string() || undefined;
+      message.headers = reader.headers();
+      message.body = reader.u8() ? reader.rest() : undefined;
+      break;
+    }
+    case 'error': {
+      message.error = reader.string();
+      message.correlationId = reader.string() || undefined;
+      const hasDetails = reader.u8();
+      const details = reader.string();
+      message.details = hasDetails ? details : undefined;
+      break;
+    }
+    case 'pong':
+      message.pingId = reader.string();
+      break;
+    case 'httpResponseStart': {
+      message.statusCode = reader.u16();
+      message.correlationId = reader.string();
+      message.headers = reader.headers();
+      break;
+    }
+    case 'httpResponseChunk': {
+      message.correlationId = reader.string();
+      message.body = reader.rest();
+      break;
+    }
+    case 'httpResponseEnd': {
+      message.correlationId = reader.string();
+      const hasError = reader.u8();
+      const error = reader.string();
+      message.error = hasError ? error : undefined;
+      break;
+    }
+    case 'httpResponseAck': {
+      message.correlationId = reader.string();
+      message.frames = reader.u32();
+      break;
+    }
+    default:
+      break;
+  }
+  return message;
+}
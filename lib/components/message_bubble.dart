@@ -1,7 +1,9 @@
 import 'package:flutter/material.dart';
 import 'package:flutter/services.dart';
 import '../config/theme.dart';
+import '../models/markdown_block.dart';
 import '../models/message.dart';
+import '../services/markdown_block_lexer.dart';
 
 /// A chat message bubble component similar to ChatGPT
 class MessageBubble extends StatefulWidget {
@@ -28,6 +30,16 @@ class _MessageBubbleState extends State<MessageBubble>
   late AnimationController _animationController;
   late Animation<double> _fadeAnimation;
 
+  // An assistant reply's blocks as last rendered, and their widgets. A block
+  // whose span is unchanged keeps its widget, so a streamed batch rebuilds
+  // only the blocks it touched rather than the whole reply.
+  final MarkdownBlockLexer _lexer = MarkdownBlockLexer();
+  final List<MarkdownBlock> _lexedBlocks = [];
+  final List<MarkdownBlock> _renderedBlocks = [];
+  final List<Widget> _blockWidgets = [];
+  String _renderedContent = '';
+  String? _renderedId;
+
   @override
   void initState() {
     super.initState();
@@ -41,6 +53,14 @@ class _MessageBubbleState extends State<MessageBubble>
     _animationController.forward();
   }
 
+  @override
+  void didChangeDependencies() {
+    super.didChangeDependencies();
+    // The cached block widgets hold the old theme's styles.
+    _renderedBlocks.clear();
+    _blockWidgets.clear();
+  }
+
   @override
   void dispose() {
     _animationController.dispose();
@@ -164,13 +184,16 @@ class _MessageBubbleState extends State<MessageBubble>
         crossAxisAlignment: CrossAxisAlignment.start,
         children: [
           if (widget.message.hasError) _buildErrorHeader(),
-          SelectableText(
-            widget.message.content,
-            style: Theme.of(context).textTheme.bodyMedium?.copyWith(
-              color: AppTheme.textColor,
-              height: 1.5,
+          if (widget.message.isAssistant && !widget.message.hasError)
+            _buildMarkdown(widget.message)
+          else
+            SelectableText(
+              widget.message.content,
+              style: Theme.of(context).textTheme.bodyMedium?.copyWith(
+                color: AppTheme.textColor,
+                height: 1.5,
+              ),
             ),
-          ),
         ],
       ),
     );
@@ -250,19 +273,130 @@ class _MessageBubbleState extends State<MessageBubble>
           ),
           if (widget.message.content.isNotEmpty) ...[
             SizedBox(height: AppTheme.spacingS),
-            SelectableText(
-              widget.message.content,
-              style: Theme.of(context).textTheme.bodyMedium?.copyWith(
-                color: AppTheme.textColor,
-                height: 1.5,
-              ),
-            ),
+            _buildMarkdown(widget.message),
           ],
         ],
       ),
     );
   }
 
+  /// The blocks of [message]'s content: the runner's, or lexed here from
+  /// what was appended since the last build
+  List<MarkdownBlock> _blocksOf(Message message) {
+    final content = message.content;
+    // A streaming reply only grows; anything else starts over.
+    final continued =
+        (message.id == _renderedId &&
+            message.isStreaming &&
+            content.length >= _renderedContent.length) ||
+        content == _renderedContent;
+    if (!continued) {
+      _lexer.reset();
+      _lexedBlocks.clear();
+      _renderedBlocks.clear();
+      _blockWidgets.clear();
+    }
+    _renderedId = message.id;
+    _renderedContent = content;
+
+    final blocks = message.blocks;
+    if (blocks != null) return blocks;
+    if (_lexer.length < content.length) {
+      _lexer.append(content.substring(_lexer.length)).applyTo(_lexedBlocks);
+    }
+    return _lexedBlocks;
+  }
+
+  Widget _buildMarkdown(Message message) {
+    final content = message.content;
+    final blocks = _blocksOf(message);
+    if (_renderedBlocks.length > blocks.length) {
+      _renderedBlocks.length = blocks.length;
+      _blockWidgets.length = blocks.length;
+    }
+    for (var i = 0; i < blocks.length; i++) {
+      if (i == _renderedBlocks.length) {
+        _renderedBlocks.add(blocks[i]);
+        _blockWidgets.add(_buildBlock(content, blocks[i]));
+      } else if (_renderedBlocks[i] != blocks[i]) {
+        _renderedBlocks[i] = blocks[i];
+        _blockWidgets[i] = _buildBlock(content, blocks[i]);
+      }
+    }
+    return Column(
+      crossAxisAlignment: CrossAxisAlignment.start,
+      children: List.of(_blockWidgets),
+    );
+  }
+
+  Widget _buildBlock(String content, MarkdownBlock block) {
+    final textTheme = Theme.of(context).textTheme;
+    final Widget child;
+    switch (block.kind) {
+      case MarkdownBlockKind.paragraph:
+        child = SelectableText(
+          block.body(content),
+          style: textTheme.bodyMedium?.copyWith(
+            color: AppTheme.textColor,
+            height: 1.5,
+          ),
+        );
+      case MarkdownBlockKind.heading:
+        child = SelectableText(
+          block.body(content),
+          style:
+              (block.headingLevel(content) <= 2
+                      ? textTheme.titleMedium
+                      : textTheme.titleSmall)
+                  ?.copyWith(
+                    color: AppTheme.textColor,
+                    fontWeight: FontWeight.w600,
+                  ),
+        );
+      case MarkdownBlockKind.code:
+        final language = block.language(content);
+        child = Container(
+          width: double.infinity,
+          padding: EdgeInsets.all(AppTheme.spacingS),
+          decoration: BoxDecoration(
+            color: AppTheme.backgroundMain,
+            borderRadius: BorderRadius.circular(AppTheme.borderRadiusS),
+            border: Border.all(color: AppTheme.borderColor, width: 1),
+          ),
+          child: Column(
+            crossAxisAlignment: CrossAxisAlignment.start,
+            children: [
+              if (language.isNotEmpty)
+                Padding(
+                  padding: EdgeInsets.only(bottom: AppTheme.spacingXS),
+                  child: Text(
+                    language,
+                    style: textTheme.labelSmall?.copyWith(
+                      color: AppTheme.textColorLight,
+                    ),
+                  ),
+                ),
+              SingleChildScrollView(
+                scrollDirection: Axis.horizontal,
+                child: SelectableText(
+                  block.body(content),
+                  style: textTheme.bodySmall?.copyWith(
+                    color: AppTheme.textColor,
+                    fontFamily: 'monospace',
+                    height: 1.4,
+                  ),
+                ),
+              ),
+            ],
+          ),
+        );
+    }
+    return Padding(
+      padding: EdgeInsets.only(bottom: AppTheme.spacingS),
+      child: child,
+    );
+  }
+
   Widget _buildErrorHeader() {
     return Container(
       margin: EdgeInsets.only(bottom: AppTheme.spacingS),
@@ -1,6 +1,7 @@
 import 'package:flutter/material.dart';
 import 'package:provider/provider.dart';
 import '../config/theme.dart';
+import '../services/native_http_client.dart';
 import '../services/ollama_service.dart';
 import 'modern_card.dart';
 
@@ -730,23 +731,21 @@ class _ModelDownloadManagerState extends State<ModelDownloadManager> {
     });
 
     try {
-      // Simulate download progress updates
-      // In a real implementation, this would be integrated with Ollama's streaming API
-      for (int i = 0; i <= 100; i += 10) {
-        await Future.delayed(const Duration(milliseconds: 500));
-        if (mounted) {
+      // Progress arrives already coalesced (about ten updates a second), so
+      // each one is drawn as it comes.
+      final success = await ollamaService.pullModel(
+        modelName,
+        onProgress: (progress) {
+          if (!mounted) return;
           setState(() {
             _downloadProgress[modelName] = ModelDownloadProgress(
               modelName: modelName,
-              progress: i / 100.0,
-              status: i < 100 ? 'Downloading... $i%' : 'Finalizing...',
+              progress: progress.fraction ?? 0.0,
+              status: _describeProgress(progress),
             );
           });
-        }
-      }
-
-      // Call the actual Ollama service to download the model
-      final success = await ollamaService.pullModel(modelName);
+        },
+      );
 
       if (success) {
         setState(() {
@@ -795,6 +794,20 @@ class _ModelDownloadManagerState extends State<ModelDownloadManager> {
     }
   }
 
+  static String _describeProgress(NativeDownloadProgress progress) {
+    if (progress.status.isEmpty) return 'Downloading...';
+    final fraction = progress.fraction;
+    if (!progress.status.startsWith('pulling') || fraction == null) {
+      return '${progress.status[0].toUpperCase()}'
+          '${progress.status.substring(1)}...';
+    }
+    final percent = (fraction * 100).floor();
+    final rate = progress.bytesPerSecond / (1024 * 1024);
+    return rate > 0
+        ? 'Downloading... $percent% (${rate.toStringAsFixed(1)} MB/s)'
+        : 'Downloading... $percent%';
+  }
+
   void _showDeleteModelDialog(String modelName) {
     showDialog(
       context: context,
@@ -22,6 +22,9 @@ import 'services/admin_service.dart';
 import 'services/admin_data_flush_service.dart';
 import 'services/encrypted_tunnel_service.dart';
 import 'services/encrypted_tunnel_client.dart';
+import 'services/deferred_plugins.dart';
+import 'services/single_instance_service.dart';
+import 'services/background_mode_service.dart';
 
 import 'widgets/window_listener_widget.dart';
 
@@ -29,7 +32,9 @@ import 'widgets/window_listener_widget.dart';
 final GlobalKey<NavigatorState> navigatorKey = GlobalKey<NavigatorState>();
 
 void main() async {
-  WidgetsFlutterBinding.ensureInitialized();
+  // Plugin calls made before the runner's deferred registration finishes
+  // wait for it instead of failing.
+  CloudToLocalLLMBinding.ensureInitialized();
 
   runApp(const CloudToLocalLLMApp());
 }
@@ -84,6 +89,15 @@ class _CloudToLocalLLMAppState extends State<CloudToLocalLLMApp> {
       final windowManager = WindowManagerService();
       await windowManager.initialize();
 
+      // Launching the app again shows this instance instead of starting
+      // another one; the runner has already raised the window.
+      final singleInstance = SingleInstanceService();
+      singleInstance.initialize();
+      singleInstance.launches.listen((_) => windowManager.showWindow());
+
+      // Drop rendering caches while the window is hidden to the tray.
+      BackgroundModeService().initialize();
+
       // Note: Tray service will be initialized after providers are set up
       // This ensures all required services are available
     } catch (e, stackTrace) {
@@ -411,6 +425,9 @@ class _CloudToLocalLLMAppState extends State<CloudToLocalLLMApp> {
       // Get window manager service
       final windowManager = WindowManagerService();
 
+      // tray_manager is registered after the first frame.
+      await DeferredPlugins.ready();
+
       // Initialize native tray service
       final nativeTray = NativeTrayService();
       final success = await nativeTray.initialize(
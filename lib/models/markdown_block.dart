@@ -0,0 +1,144 @@
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart';
+
+/// Kind of a [MarkdownBlock]; the index matches MarkdownLexer::BlockKind
+enum MarkdownBlockKind { paragraph, heading, code }
+
+/// One block of a reply: a paragraph, an ATX heading or fenced code
+///
+/// Offsets are UTF-16 code units into the reply's text, so they slice the
+/// Dart String directly. Produced by the native MarkdownLexer (see
+/// [MarkdownBlockUpdate.decode]) or by `MarkdownBlockLexer` in Dart.
+@immutable
+class MarkdownBlock {
+  static const int encodedSize = 26;
+
+  final MarkdownBlockKind kind;
+
+  /// Nothing further in the reply can change the block
+  final bool closed;
+
+  /// The whole block, fences and heading markers included
+  final int start;
+  final int end;
+
+  /// A code block's language; empty otherwise
+  final int infoStart;
+  final int infoEnd;
+
+  /// What is rendered: the text of a paragraph or heading, the lines
+  /// between a code block's fences
+  final int bodyStart;
+  final int bodyEnd;
+
+  const MarkdownBlock({
+    required this.kind,
+    this.closed = false,
+    required this.start,
+    required this.end,
+    this.infoStart = 0,
+    this.infoEnd = 0,
+    required this.bodyStart,
+    required this.bodyEnd,
+  });
+
+  String body(String text) => text.substring(bodyStart, bodyEnd);
+
+  /// A code block's language, or an empty string
+  String language(String text) => text.substring(infoStart, infoEnd);
+
+  /// A heading's level, one to six
+  int headingLevel(String text) {
+    var level = 0;
+    for (var i = start; i < bodyStart && level < 6; i++) {
+      if (text.codeUnitAt(i) == 0x23) level++;
+    }
+    return level == 0 ? 1 : level;
+  }
+
+  @override
+  bool operator ==(Object other) =>
+      other is MarkdownBlock &&
+      other.kind == kind &&
+      other.closed == closed &&
+      other.start == start &&
+      other.end == end &&
+      other.infoStart == infoStart &&
+      other.infoEnd == infoEnd &&
+      other.bodyStart == bodyStart &&
+      other.bodyEnd == bodyEnd;
+
+  @override
+  int get hashCode => Object.hash(
+    kind,
+    closed,
+    start,
+    end,
+    infoStart,
+    infoEnd,
+    bodyStart,
+    bodyEnd,
+  );
+
+  @override
+  String toString() =>
+      'MarkdownBlock(${kind.name}, $start-$end, '
+      'body: $bodyStart-$bodyEnd${closed ? ', closed' : ''})';
+}
+
+/// The blocks a streamed batch changed: those from [first] on are replaced
+/// by [blocks]
+@immutable
+class MarkdownBlockUpdate {
+  final int first;
+  final List<MarkdownBlock> blocks;
+
+  const MarkdownBlockUpdate(this.first, this.blocks);
+
+  /// Decode the layout written by the native `MarkdownLexer::EncodeChanges`
+  ///
+  /// All integers are little-endian: `u32 first, u32 count`, then per block
+  /// `u8 kind, u8 closed` and six `u32` offsets (start, end, info start and
+  /// end, body start and end).
+  factory MarkdownBlockUpdate.decode(ByteData data) {
+    final first = data.getUint32(0, Endian.little);
+    final count = data.getUint32(4, Endian.little);
+    var offset = 8;
+    int u32() {
+      final value = data.getUint32(offset, Endian.little);
+      offset += 4;
+      return value;
+    }
+
+    final blocks = <MarkdownBlock>[];
+    for (var i = 0; i < count; i++) {
+      final kind = MarkdownBlockKind.values[data.getUint8(offset)];
+      final closed = data.getUint8(offset + 1) != 0;
+      offset += 2;
+      blocks.add(
+        MarkdownBlock(
+          kind: kind,
+          closed: closed,
+          start: u32(),
+          end: u32(),
+          infoStart: u32(),
+          infoEnd: u32(),
+          bodyStart: u32(),
+          bodyEnd: u32(),
+        ),
+      );
+    }
+    return MarkdownBlockUpdate(first, blocks);
+  }
+
+  /// Applies the update to the blocks of the reply so far
+  void applyTo(List<MarkdownBlock> target) {
+    if (first < target.length) target.removeRange(first, target.length);
+    target.addAll(blocks);
+  }
+
+  @override
+  String toString() =>
+      'MarkdownBlockUpdate(first: $first, blocks: ${blocks.length})';
+}
@@ -1,3 +1,5 @@
+import 'markdown_block.dart';
+
 /// Represents a single chat message in a conversation
 class Message {
   final String id;
@@ -8,6 +10,10 @@ class Message {
   final MessageStatus status;
   final String? error; // Error message if status is error
 
+  /// The content's markdown blocks where the runner lexed them as the reply
+  /// streamed; not stored, and null where MessageBubble lexes it itself
+  final List<MarkdownBlock>? blocks;
+
   const Message({
     required this.id,
     required this.content,
@@ -16,6 +22,7 @@ class Message {
     this.model,
     this.status = MessageStatus.sent,
     this.error,
+    this.blocks,
   });
 
   /// Create a user message
@@ -36,6 +43,7 @@ class Message {
     String? id,
     MessageStatus status = MessageStatus.sent,
     String? error,
+    List<MarkdownBlock>? blocks,
   }) {
     return Message(
       id: id ?? _generateId(),
@@ -45,6 +53,7 @@ class Message {
       model: model,
       status: status,
       error: error,
+      blocks: blocks,
     );
   }
 
@@ -128,6 +137,7 @@ class Message {
     String? model,
     MessageStatus? status,
     String? error,
+    List<MarkdownBlock>? blocks,
   }) {
     return Message(
       id: id ?? this.id,
@@ -137,6 +147,7 @@ class Message {
       model: model ?? this.model,
       status: status ?? this.status,
       error: error ?? this.error,
+      blocks: blocks ?? this.blocks,
     );
   }
 
@@ -174,9 +185,14 @@ class Message {
     }
   }
 
+  static int _idCounter = 0;
+
   /// Generate a unique ID for the message
+  ///
+  /// A user message and the assistant placeholder after it are usually
+  /// created in the same millisecond, and storage keys messages by id.
   static String _generateId() {
-    return DateTime.now().millisecondsSinceEpoch.toString();
+    return '${DateTime.now().millisecondsSinceEpoch}_${_idCounter++}';
   }
 
   @override
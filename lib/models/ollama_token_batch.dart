@@ -0,0 +1,154 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart';
+
+import 'markdown_block.dart';
+
+/// Timing and token counters reported on the final line of an Ollama
+/// `/api/chat` or `/api/generate` stream.
+@immutable
+class OllamaDoneStats {
+  final Duration totalDuration;
+  final Duration loadDuration;
+  final int promptEvalCount;
+  final Duration promptEvalDuration;
+  final int evalCount;
+  final Duration evalDuration;
+
+  const OllamaDoneStats({
+    this.totalDuration = Duration.zero,
+    this.loadDuration = Duration.zero,
+    this.promptEvalCount = 0,
+    this.promptEvalDuration = Duration.zero,
+    this.evalCount = 0,
+    this.evalDuration = Duration.zero,
+  });
+
+  /// Create from the decoded final line of an Ollama stream
+  factory OllamaDoneStats.fromJson(Map<String, dynamic> json) {
+    Duration nanos(String key) =>
+        Duration(microseconds: ((json[key] as num?) ?? 0) ~/ 1000);
+    return OllamaDoneStats(
+      totalDuration: nanos('total_duration'),
+      loadDuration: nanos('load_duration'),
+      promptEvalCount: (json['prompt_eval_count'] as num?)?.toInt() ?? 0,
+      promptEvalDuration: nanos('prompt_eval_duration'),
+      evalCount: (json['eval_count'] as num?)?.toInt() ?? 0,
+      evalDuration: nanos('eval_duration'),
+    );
+  }
+
+  /// Generation speed in tokens per second, or 0 if unknown
+  double get tokensPerSecond => evalDuration.inMicroseconds == 0
+      ? 0
+      : evalCount * 1e6 / evalDuration.inMicroseconds;
+
+  @override
+  String toString() {
+    return 'OllamaDoneStats(evalCount: $evalCount, '
+        'tokensPerSecond: ${tokensPerSecond.toStringAsFixed(1)}, '
+        'promptEvalCount: $promptEvalCount)';
+  }
+}
+
+/// A batch of token deltas parsed from an Ollama NDJSON stream
+///
+/// Produced either by the native parser (decoded from its binary channel
+/// reply) or by the pure-Dart fallback. [text] is the concatenation of all
+/// deltas in the batch; [tokenCount] is how many stream lines contributed.
+@immutable
+class OllamaTokenBatch {
+  static const int _flagDone = 1 << 0;
+  static const int _flagError = 1 << 1;
+  static const int _flagHasStats = 1 << 2;
+
+  final String text;
+  final int tokenCount;
+  final bool done;
+  final String? error;
+  final OllamaDoneStats? stats;
+
+  /// The markdown blocks this batch's text changed, where the native client
+  /// lexed the reply
+  final MarkdownBlockUpdate? blocks;
+
+  const OllamaTokenBatch({
+    this.text = '',
+    this.tokenCount = 0,
+    this.done = false,
+    this.error,
+    this.stats,
+    this.blocks,
+  });
+
+  /// True if the batch carries nothing worth forwarding
+  bool get isEmpty => tokenCount == 0 && !done && error == null;
+
+  /// Decode the binary layout written by the native `TokenBatch::Encode`
+  ///
+  /// All integers are little-endian:
+  /// `u8 flags, u32 tokenCount, u32 textLength, text bytes`, then six `i64`
+  /// counters if the stats flag is set, then `u32 length, message` if the
+  /// error flag is set. [blocks] is attached as is.
+  factory OllamaTokenBatch.decode(
+    ByteData data, {
+    MarkdownBlockUpdate? blocks,
+  }) {
+    int offset = 0;
+    final flags = data.getUint8(offset);
+    offset += 1;
+    final tokenCount = data.getUint32(offset, Endian.little);
+    offset += 4;
+
+    String readString() {
+      final length = data.getUint32(offset, Endian.little);
+      offset += 4;
+      final bytes = Uint8List.view(
+        data.buffer,
+        data.offsetInBytes + offset,
+        length,
+      );
+      offset += length;
+      return utf8.decode(bytes, allowMalformed: true);
+    }
+
+    final text = readString();
+
+    OllamaDoneStats? stats;
+    if (flags & _flagHasStats != 0) {
+      int readInt64() {
+        final value = data.getInt64(offset, Endian.little);
+        offset += 8;
+        return value;
+      }
+
+      Duration nanos(int value) => Duration(microseconds: value ~/ 1000);
+      stats = OllamaDoneStats(
+        totalDuration: nanos(readInt64()),
+        loadDuration: nanos(readInt64()),
+        promptEvalCount: readInt64(),
+        promptEvalDuration: nanos(readInt64()),
+        evalCount: readInt64(),
+        evalDuration: nanos(readInt64()),
+      );
+    }
+
+    final error = flags & _flagError != 0 ? readString() : null;
+
+    return OllamaTokenBatch(
+      text: text,
+      tokenCount: tokenCount,
+      done: flags & _flagDone != 0,
+      error: error,
+      stats: stats,
+      blocks: blocks,
+    );
+  }
+
+  @override
+  String toString() {
+    return 'OllamaTokenBatch(tokens: $tokenCount, '
+        'text: ${text.length} chars, done: $done, error: $error)';
+  }
+}
@@ -1,5 +1,7 @@
 import 'package:flutter/foundation.dart';
 
+import 'markdown_block.dart';
+
 /// Streaming message protocol for real-time communication
 ///
 /// Represents a chunk of a streaming response from Ollama with metadata
@@ -15,6 +17,10 @@ class StreamingMessage {
   final String? model;
   final String? error;
 
+  /// The markdown blocks [chunk] changed, where the runner lexed the reply;
+  /// local only, never sent over the WebSocket
+  final MarkdownBlockUpdate? blocks;
+
   const StreamingMessage({
     required this.id,
     required this.conversationId,
@@ -24,6 +30,7 @@ class StreamingMessage {
     required this.timestamp,
     this.model,
     this.error,
+    this.blocks,
   });
 
   /// Create a streaming message chunk
@@ -33,6 +40,7 @@ class StreamingMessage {
     required String chunk,
     required int sequence,
     String? model,
+    MarkdownBlockUpdate? blocks,
   }) {
     return StreamingMessage(
       id: id,
@@ -42,6 +50,7 @@ class StreamingMessage {
       sequence: sequence,
       timestamp: DateTime.now(),
       model: model,
+      blocks: blocks,
     );
   }
 
@@ -146,6 +155,7 @@ class StreamingMessage {
     DateTime? timestamp,
     String? model,
     String? error,
+    MarkdownBlockUpdate? blocks,
   }) {
     return StreamingMessage(
       id: id ?? this.id,
@@ -156,6 +166,7 @@ class StreamingMessage {
       timestamp: timestamp ?? this.timestamp,
       model: model ?? this.model,
       error: error ?? this.error,
+      blocks: blocks ?? this.blocks,
     );
   }
 }
@@ -0,0 +1,98 @@
+import 'dart:typed_data';
+import 'dart:ui' as ui;
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/painting.dart';
+import 'package:flutter/services.dart';
+
+/// Drops rendering caches while the desktop window is hidden to the tray
+///
+/// The app mostly sits in the tray relaying tunnel traffic. When the window
+/// is hidden the runner tells this service on
+/// `cloudtolocalllm/background_mode` (Windows also shrinks the view so the
+/// engine releases its full-size GPU surface); this clears the image cache
+/// and Skia's GPU resource cache, then replies so the runner can hand the
+/// freed memory back to the OS. The engine and the tunnel and Ollama services
+/// keep running. Showing the window restores the resource cache budget.
+class BackgroundModeService {
+  static const String channelName = 'cloudtolocalllm/background_mode';
+
+  static const int _left = 0;
+  static const int _entered = 1;
+
+  // Matches the engine's default budget: a dozen full-screen RGBA textures.
+  static const int _texturesPerView = 12;
+  static const int _bytesPerPixel = 4;
+  static const ui.Size _fallbackScreenSize = ui.Size(1280, 720);
+
+  static final BackgroundModeService _instance =
+      BackgroundModeService._internal();
+  factory BackgroundModeService() => _instance;
+  BackgroundModeService._internal();
+
+  bool _isInitialized = false;
+  bool _inBackground = false;
+
+  /// Whether the window is currently hidden to the tray
+  bool get inBackground => _inBackground;
+
+  /// Start handling the runner's notifications
+  void initialize() {
+    if (_isInitialized || kIsWeb) return;
+    _isInitialized = true;
+    ServicesBinding.instance.defaultBinaryMessenger.setMessageHandler(
+      channelName,
+      (ByteData? message) async {
+        if (message == null || message.lengthInBytes < 1) return null;
+        switch (message.getUint8(0)) {
+          case _entered:
+            await _enter();
+          case _left:
+            await _leave();
+        }
+        return ByteData(1)..setUint8(0, 1);
+      },
+    );
+  }
+
+  Future<void> _enter() async {
+    if (_inBackground) return;
+    _inBackground = true;
+    final imageCache = PaintingBinding.instance.imageCache;
+    imageCache.clear();
+    imageCache.clearLiveImages();
+    await _setResourceCacheMaxBytes(0);
+    debugPrint('🫥 [BackgroundMode] Window hidden, rendering caches dropped');
+  }
+
+  Future<void> _leave() async {
+    if (!_inBackground) return;
+    _inBackground = false;
+    // Sized from the display: while hidden the view itself may still report
+    // the 1x1 size the runner gave it.
+    var size = ui.Size.zero;
+    try {
+      final views = ui.PlatformDispatcher.instance.views;
+      if (views.isNotEmpty) size = views.first.display.size;
+    } catch (_) {
+      // Embedders that predate display reporting.
+    }
+    if (size.isEmpty) size = _fallbackScreenSize;
+    await _setResourceCacheMaxBytes(
+      (size.width * size.height).round() * _bytesPerPixel * _texturesPerView,
+    );
+    debugPrint('🪟 [BackgroundMode] Window shown, rendering caches restored');
+  }
+
+  Future<void> _setResourceCacheMaxBytes(int bytes) async {
+    try {
+      await SystemChannels.skia.invokeMethod<void>(
+        'Skia.setResourceCacheMaxBytes',
+        bytes,
+      );
+    } catch (e) {
+      // Not every renderer has a Skia resource cache.
+      debugPrint('🫥 [BackgroundMode] Could not resize resource cache: $e');
+    }
+  }
+}
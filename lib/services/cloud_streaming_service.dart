@@ -9,6 +9,7 @@ import '../config/app_config.dart';
 import '../models/streaming_message.dart';
 import 'streaming_service.dart';
 import 'auth_service.dart';
+import 'native_latency_metrics.dart';
 
 /// Cloud streaming service implementation
 ///
@@ -19,6 +20,7 @@ class CloudStreamingService extends StreamingService {
   final StreamingConfig _config;
   final AuthService _authService;
   final http.Client _httpClient;
+  final NativeLatencyMetrics _latencyMetrics;
 
   StreamingConnection _connection = StreamingConnection.disconnected();
   final BehaviorSubject<StreamingMessage> _messageSubject =
@@ -32,10 +34,12 @@ class CloudStreamingService extends StreamingService {
     String? baseUrl,
     StreamingConfig? config,
     required AuthService authService,
+    NativeLatencyMetrics? latencyMetrics,
   }) : _baseUrl = baseUrl ?? AppConfig.cloudOllamaUrl,
        _config = config ?? StreamingConfig.cloud(),
        _authService = authService,
-       _httpClient = http.Client() {
+       _httpClient = http.Client(),
+       _latencyMetrics = latencyMetrics ?? NativeLatencyMetrics() {
     if (kDebugMode) {
       debugPrint('☁️ [CloudStreaming] Service initialized');
       debugPrint('☁️ [CloudStreaming] Base URL: $_baseUrl');
@@ -146,6 +150,7 @@ class CloudStreamingService extends StreamingService {
 
     final messageId = 'msg_${DateTime.now().millisecondsSinceEpoch}';
     int sequence = 0;
+    final latency = _latencyMetrics.startStream(LatencyPath.cloud);
 
     try {
       final messages = [
@@ -189,6 +194,7 @@ class CloudStreamingService extends StreamingService {
             final data = json.decode(line);
             final content = data['message']?['content'] as String? ?? '';
             final done = data['done'] as bool? ?? false;
+            if (content.isNotEmpty) latency.token();
 
             final message = StreamingMessage.chunk(
               id: messageId,
@@ -242,6 +248,8 @@ class CloudStreamingService extends StreamingService {
       notifyListeners();
 
       debugPrint('☁️ [CloudStreaming] Stream error: $e');
+    } finally {
+      unawaited(latency.finish());
     }
   }
 
@@ -373,10 +381,19 @@ class CloudStreamingService extends StreamingService {
             'timestamp': DateTime.now().toIso8601String(),
           }),
         );
+        _reportLatency();
       }
     });
   }
 
+  /// Send the latency samples recorded since the last report to the proxy,
+  /// which exports them on /metrics
+  Future<void> _reportLatency() async {
+    final histograms = await _latencyMetrics.bucketDeltas();
+    if (histograms.isEmpty) return;
+    _webSocket?.add(json.encode({'type': 'latency', 'histograms': histograms}));
+  }
+
   @override
   void dispose() {
     debugPrint('☁️ [CloudStreaming] Disposing service');
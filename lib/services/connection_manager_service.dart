@@ -6,6 +6,7 @@ import 'streaming_service.dart';
 import 'ollama_service.dart';
 import 'cloud_streaming_service.dart';
 import 'auth_service.dart';
+import 'native_resource_monitor.dart';
 
 /// Connection manager service that coordinates between local and cloud connections
 ///
@@ -21,6 +22,7 @@ class ConnectionManagerService extends ChangeNotifier {
   final LocalOllamaConnectionService _localOllama;
   final TunnelManagerService _tunnelManager;
   final AuthService _authService;
+  final NativeResourceMonitor _resourceMonitor;
 
   // Connection preferences
   bool _preferLocalOllama = true;
@@ -33,9 +35,11 @@ class ConnectionManagerService extends ChangeNotifier {
     required LocalOllamaConnectionService localOllama,
     required TunnelManagerService tunnelManager,
     required AuthService authService,
+    NativeResourceMonitor? resourceMonitor,
   }) : _localOllama = localOllama,
        _tunnelManager = tunnelManager,
-       _authService = authService {
+       _authService = authService,
+       _resourceMonitor = resourceMonitor ?? NativeResourceMonitor() {
     // Listen to connection changes
     _localOllama.addListener(_onConnectionChanged);
     _tunnelManager.addListener(_onConnectionChanged);
@@ -69,6 +73,9 @@ class ConnectionManagerService extends ChangeNotifier {
   /// 2. Cloud proxy (WebSocket bridge) - WEB AND DESKTOP
   /// 3. Local Ollama (fallback if not preferred initially) - DESKTOP ONLY
   ///
+  /// Preferred local Ollama gives way to the cloud proxy while the host has
+  /// been saturated (CPU, RAM or GPU memory) for the last few resource polls.
+  ///
   /// Platform-aware: Web platform NEVER uses local connections to prevent CORS errors.
   /// Note: Zrok is now handled as a standalone service and not part of
   /// the Ollama connection fallback hierarchy.
@@ -89,7 +96,15 @@ class ConnectionManagerService extends ChangeNotifier {
     }
 
     // Desktop platform: Use normal fallback hierarchy
-    if (_preferLocalOllama && hasLocalConnection) {
+    if (_preferLocalOllama &&
+        hasLocalConnection &&
+        hasCloudConnection &&
+        _resourceMonitor.hostConstrained) {
+      debugPrint(
+        '🔗 [ConnectionManager] Host saturated - using cloud proxy connection',
+      );
+      return ConnectionType.cloud;
+    } else if (_preferLocalOllama && hasLocalConnection) {
       debugPrint(
         '🔗 [ConnectionManager] Using preferred local Ollama connection',
       );
@@ -204,6 +219,11 @@ class ConnectionManagerService extends ChangeNotifier {
       // Don't fail overall initialization if tunnel fails
     }
 
+    // Watch host headroom for routing (desktop runners only)
+    if (!kIsWeb) {
+      _resourceMonitor.start();
+    }
+
     // Auto-select first available model
     _autoSelectModel();
 
@@ -316,6 +336,7 @@ class ConnectionManagerService extends ChangeNotifier {
     debugPrint('🔗 [ConnectionManager] Disposing service');
     _localOllama.removeListener(_onConnectionChanged);
     _tunnelManager.removeListener(_onConnectionChanged);
+    _resourceMonitor.stop();
     _cloudStreamingService?.dispose();
     super.dispose();
   }
@@ -6,11 +6,20 @@ import 'package:sqflite_common_ffi/sqflite_ffi.dart';
 
 import '../models/conversation.dart';
 import '../models/message.dart';
-
-/// Service for persisting conversations to local SQLite database
+import 'native_conversation_store.dart';
+
+/// Service for persisting conversations locally
+///
+/// On the Linux and Windows desktop runners conversations live in the native
+/// append-only store ([NativeConversationStore]): saves write only what
+/// changed since the last save, streamed tokens are appended as they arrive
+/// ([appendToMessage]), and [loadConversationSummaries] lists conversations
+/// without reading their messages. Elsewhere, or if the runner has no native
+/// store, they are kept in a local SQLite database as before.
 class ConversationStorageService {
   static const String _databaseName = 'cloudtolocalllm_conversations.db';
   static const int _databaseVersion = 1;
+  static const String _nativeStoreDirectoryName = 'conversations';
 
   // Table names
   static const String _conversationsTable = 'conversations';
@@ -18,6 +27,19 @@ class ConversationStorageService {
 
   Database? _database;
 
+  NativeConversationStore? _nativeStore;
+  // What the native store holds, as last written or read; saves write the
+  // difference.
+  final Map<String, Conversation> _stored = {};
+  // Conversations listed with only their last message.
+  final Set<String> _summaryOnly = {};
+  // Native store calls run one at a time so each diff sees the last one's
+  // result.
+  Future<void> _pendingNativeWork = Future.value();
+
+  /// Whether conversations are kept in the native store
+  bool get usesNativeStore => _nativeStore != null;
+
   /// Initialize the storage service
   Future<void> initialize() async {
     try {
@@ -28,6 +50,10 @@ class ConversationStorageService {
         databaseFactory = databaseFactoryFfi;
       }
 
+      if (await _openNativeStore()) {
+        debugPrint('💾 [ConversationStorage] Using native conversation store');
+        return;
+      }
       await _initializeDatabase();
       debugPrint('💾 [ConversationStorage] Service initialized successfully');
     } catch (e) {
@@ -50,6 +76,50 @@ class ConversationStorageService {
     debugPrint('💾 [ConversationStorage] Database opened at: $databasePath');
   }
 
+  /// Open the runner's native store, importing the SQLite database into it
+  /// the first time
+  Future<bool> _openNativeStore() async {
+    if (kIsWeb || !(Platform.isWindows || Platform.isLinux)) return false;
+
+    final directory = Directory(
+      join((await _getAppDirectory()).path, _nativeStoreDirectoryName),
+    );
+    await directory.create(recursive: true);
+    final store = await NativeConversationStore.open(directory.path);
+    if (store == null) return false;
+    _nativeStore = store;
+
+    try {
+      await _importDatabase();
+    } catch (e) {
+      // The database is left in place and the import retried next start.
+      debugPrint('💾 [ConversationStorage] Failed to import database: $e');
+    }
+    return true;
+  }
+
+  /// Copy conversations saved by earlier versions into the native store
+  Future<void> _importDatabase() async {
+    final databasePath = await _getDatabasePath();
+    final databaseFile = File(databasePath);
+    if (!await databaseFile.exists()) return;
+
+    if ((await _nativeStore!.list()).isEmpty) {
+      await _initializeDatabase();
+      try {
+        final conversations = await _loadFromDatabase();
+        await _enqueueNativeWork(() => _saveToNativeStore(conversations));
+        debugPrint(
+          '💾 [ConversationStorage] Imported ${conversations.length} conversations from SQLite',
+        );
+      } finally {
+        await _database?.close();
+        _database = null;
+      }
+    }
+    await databaseFile.rename('$databasePath.imported');
+  }
+
   /// Get the database file path
   Future<String> _getDatabasePath() async {
     if (kIsWeb) {
@@ -57,7 +127,11 @@ class ConversationStorageService {
       return _databaseName;
     }
 
-    // For desktop/mobile, use app documents directory
+    return join((await _getAppDirectory()).path, _databaseName);
+  }
+
+  /// Get the app's documents directory, creating it if needed
+  Future<Directory> _getAppDirectory() async {
     final documentsDirectory = await getApplicationDocumentsDirectory();
     final appDirectory = Directory(
       join(documentsDirectory.path, 'CloudToLocalLLM'),
@@ -68,7 +142,7 @@ class ConversationStorageService {
       await appDirectory.create(recursive: true);
     }
 
-    return join(appDirectory.path, _databaseName);
+    return appDirectory;
   }
 
   /// Create database tables
@@ -125,6 +199,15 @@ class ConversationStorageService {
 
   /// Save a list of conversations
   Future<void> saveConversations(List<Conversation> conversations) async {
+    if (_nativeStore != null) {
+      try {
+        await _enqueueNativeWork(() => _saveToNativeStore(conversations));
+      } catch (e) {
+        debugPrint('💾 [ConversationStorage] Error saving conversations: $e');
+        rethrow;
+      }
+      return;
+    }
     if (_database == null) {
       throw StateError('Database not initialized');
     }
@@ -153,22 +236,19 @@ class ConversationStorageService {
 
   /// Load all conversations
   Future<List<Conversation>> loadConversations() async {
-    if (_database == null) {
+    if (_nativeStore == null && _database == null) {
       throw StateError('Database not initialized');
     }
 
     try {
-      // Load conversations ordered by most recently updated
-      final conversationRows = await _database!.query(
-        _conversationsTable,
-        orderBy: 'updated_at DESC',
-      );
-
-      final conversations = <Conversation>[];
-
-      for (final row in conversationRows) {
-        final conversation = await _loadConversationWithMessages(row);
-        conversations.add(conversation);
+      final List<Conversation> conversations;
+      if (_nativeStore != null) {
+        conversations = [
+          for (final summary in await loadConversationSummaries())
+            await loadMessages(summary),
+        ];
+      } else {
+        conversations = await _loadFromDatabase();
       }
 
       debugPrint(
@@ -181,8 +261,125 @@ class ConversationStorageService {
     }
   }
 
+  /// Load conversations for the conversation list, most recently updated
+  /// first
+  ///
+  /// From the native store each conversation comes with only its last
+  /// message; [loadMessages] fetches the rest when it is opened. From SQLite
+  /// the conversations are complete.
+  Future<List<Conversation>> loadConversationSummaries() async {
+    final store = _nativeStore;
+    if (store == null) return loadConversations();
+
+    return _enqueueNativeWork(() async {
+      final summaries = await store.list();
+      _stored.clear();
+      _summaryOnly.clear();
+      for (final summary in summaries) {
+        final conversation = summary.conversation;
+        _stored[conversation.id] = conversation;
+        if (summary.messageCount > conversation.messages.length) {
+          _summaryOnly.add(conversation.id);
+        }
+      }
+      debugPrint(
+        '💾 [ConversationStorage] Listed ${summaries.length} conversations',
+      );
+      return [for (final summary in summaries) summary.conversation];
+    });
+  }
+
+  /// Whether [conversationId] was loaded with all its messages
+  bool hasAllMessages(String conversationId) =>
+      !_summaryOnly.contains(conversationId);
+
+  /// Complete a conversation from [loadConversationSummaries] with all its
+  /// messages; returns [conversation] itself if it already has them
+  Future<Conversation> loadMessages(Conversation conversation) async {
+    final store = _nativeStore;
+    if (store == null || hasAllMessages(conversation.id)) return conversation;
+
+    return _enqueueNativeWork(() async {
+      final messages = await store.loadMessages(conversation.id);
+      _summaryOnly.remove(conversation.id);
+      _stored[conversation.id] = (_stored[conversation.id] ?? conversation)
+          .copyWith(messages: messages);
+      return conversation.copyWith(messages: messages);
+    });
+  }
+
+  /// Save [text] appended to a message while it streams in
+  ///
+  /// [conversation] already contains the updated message. Only the native
+  /// store saves each chunk; with SQLite the content is written by the next
+  /// full save.
+  Future<void> appendToMessage(
+    Conversation conversation,
+    String messageId,
+    String text,
+  ) async {
+    final store = _nativeStore;
+    if (store == null || text.isEmpty) return;
+
+    await _enqueueNativeWork(() async {
+      final stored = _stored[conversation.id];
+      if (stored == null || _summaryOnly.contains(conversation.id)) return;
+      final storedIndex = stored.messages.indexWhere((m) => m.id == messageId);
+      final index = conversation.messages.indexWhere((m) => m.id == messageId);
+      if (storedIndex == -1 || index == -1) return;
+      final message = conversation.messages[index];
+      // Anything else has changed too; the next save writes it.
+      if (stored.messages[storedIndex].content + text != message.content) {
+        return;
+      }
+
+      await store.appendToMessage(conversation.id, messageId, text);
+      _stored[conversation.id] = stored.copyWith(
+        messages: List<Message>.from(stored.messages)..[storedIndex] = message,
+      );
+    });
+  }
+
+  /// Messages matching [query] in the native store's search index, best
+  /// first; null when conversations are kept in SQLite, which has no index
+  Future<List<NativeSearchHit>?> search(String query, {int limit = 50}) async {
+    final store = _nativeStore;
+    if (store == null) return null;
+    return _enqueueNativeWork(() => store.search(query, limit: limit));
+  }
+
+  /// Load every conversation from the SQLite database
+  Future<List<Conversation>> _loadFromDatabase() async {
+    // Load conversations ordered by most recently updated
+    final conversationRows = await _database!.query(
+      _conversationsTable,
+      orderBy: 'updated_at DESC',
+    );
+
+    final conversations = <Conversation>[];
+
+    for (final row in conversationRows) {
+      final conversation = await _loadConversationWithMessages(row);
+      conversations.add(conversation);
+    }
+    return conversations;
+  }
+
   /// Save a single conversation (update or insert)
   Future<void> saveConversation(Conversation conversation) async {
+    final store = _nativeStore;
+    if (store != null) {
+      try {
+        await _enqueueNativeWork(() async {
+          await _writeConversation(store, conversation);
+          await store.sync();
+        });
+      } catch (e) {
+        debugPrint('💾 [ConversationStorage] Error saving conversation: $e');
+        rethrow;
+      }
+      return;
+    }
     if (_database == null) {
       throw StateError('Database not initialized');
     }
@@ -213,6 +410,21 @@ class ConversationStorageService {
 
   /// Delete a conversation
   Future<void> deleteConversation(String conversationId) async {
+    final store = _nativeStore;
+    if (store != null) {
+      try {
+        await _enqueueNativeWork(() async {
+          await store.deleteConversation(conversationId);
+          _stored.remove(conversationId);
+          _summaryOnly.remove(conversationId);
+          await store.sync();
+        });
+      } catch (e) {
+        debugPrint('💾 [ConversationStorage] Error deleting conversation: $e');
+        rethrow;
+      }
+      return;
+    }
     if (_database == null) {
       throw StateError('Database not initialized');
     }
@@ -245,6 +457,22 @@ class ConversationStorageService {
 
   /// Clear all conversations
   Future<void> clearAllConversations() async {
+    final store = _nativeStore;
+    if (store != null) {
+      try {
+        await _enqueueNativeWork(() async {
+          await store.clear();
+          _stored.clear();
+          _summaryOnly.clear();
+          await store.sync();
+        });
+      } catch (e) {
+        debugPrint('💾 [ConversationStorage] Error clearing conversations: $e');
+        rethrow;
+      }
+      debugPrint('💾 [ConversationStorage] Cleared all conversations');
+      return;
+    }
     if (_database == null) {
       throw StateError('Database not initialized');
     }
@@ -262,6 +490,95 @@ class ConversationStorageService {
     }
   }
 
+  /// Run [work] on the native store after everything queued before it
+  Future<T> _enqueueNativeWork<T>(Future<T> Function() work) {
+    final result = _pendingNativeWork.then((_) => work());
+    _pendingNativeWork = result.then((_) {}, onError: (_) {});
+    return result;
+  }
+
+  /// Bring the native store in line with [conversations]
+  Future<void> _saveToNativeStore(List<Conversation> conversations) async {
+    final store = _nativeStore!;
+    final ids = {for (final conversation in conversations) conversation.id};
+    for (final id in _stored.keys.where((id) => !ids.contains(id)).toList()) {
+      await store.deleteConversation(id);
+      _stored.remove(id);
+      _summaryOnly.remove(id);
+    }
+    for (final conversation in conversations) {
+      await _writeConversation(store, conversation);
+    }
+    await store.sync();
+  }
+
+  /// Write what changed in [conversation] since it was last stored
+  Future<void> _writeConversation(
+    NativeConversationStore store,
+    Conversation conversation,
+  ) async {
+    final stored = _stored[conversation.id];
+    if (identical(stored, conversation)) return;
+
+    if (stored == null ||
+        stored.title != conversation.title ||
+        stored.model != conversation.model ||
+        stored.createdAt != conversation.createdAt ||
+        stored.updatedAt != conversation.updatedAt) {
+      await store.putConversation(conversation);
+    }
+    // A summary's message list is not the stored one; the conversation has
+    // to be loaded before its messages can be diffed.
+    if (!_summaryOnly.contains(conversation.id)) {
+      await _writeMessages(
+        store,
+        conversation.id,
+        stored?.messages ?? const [],
+        conversation.messages,
+      );
+    }
+    _stored[conversation.id] = conversation;
+  }
+
+  /// Write the difference between two versions of a conversation's messages
+  ///
+  /// A message whose content only grew is appended to; any other change
+  /// replaces the stored message.
+  Future<void> _writeMessages(
+    NativeConversationStore store,
+    String conversationId,
+    List<Message> before,
+    List<Message> after,
+  ) async {
+    if (identical(before, after)) return;
+
+    final previous = {for (final message in before) message.id: message};
+    for (final message in after) {
+      final old = previous.remove(message.id);
+      if (identical(old, message)) continue;
+      if (old != null &&
+          old.role == message.role &&
+          old.status == message.status &&
+          old.model == message.model &&
+          old.error == message.error &&
+          old.timestamp == message.timestamp &&
+          message.content.startsWith(old.content)) {
+        if (message.content.length > old.content.length) {
+          await store.appendToMessage(
+            conversationId,
+            message.id,
+            message.content.substring(old.content.length),
+          );
+        }
+      } else {
+        await store.putMessage(conversationId, message);
+      }
+    }
+    for (final removed in previous.keys) {
+      await store.deleteMessage(conversationId, removed);
+    }
+  }
+
   /// Insert a conversation into the database
   Future<void> _insertConversation(
     DatabaseExecutor txn,
@@ -346,6 +663,13 @@ class ConversationStorageService {
 
   /// Close the database connection
   Future<void> dispose() async {
+    final store = _nativeStore;
+    if (store != null) {
+      _nativeStore = null;
+      await _enqueueNativeWork(store.close).catchError((_) {});
+      _stored.clear();
+      _summaryOnly.clear();
+    }
     await _database?.close();
     _database = null;
     debugPrint('💾 [ConversationStorage] Service disposed');
@@ -0,0 +1,128 @@
+import 'dart:async';
+import 'dart:typed_data';
+import 'dart:ui' as ui;
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+import 'package:flutter/widgets.dart';
+
+/// Waits for the pub plugins the desktop runners register after the first
+/// frame
+///
+/// To get the first frame on screen sooner, the Linux and Windows runners
+/// only register window_manager up front; secure storage, the tray,
+/// screen_retriever, url_launcher and (on Windows) connectivity_plus follow
+/// from idle callbacks once the frame is drawn (see
+/// linux/runner/plugin_scheduler.h). [ready] completes when they are all
+/// registered, and immediately on platforms without the scheduler.
+class DeferredPlugins {
+  static const String channelName = 'cloudtolocalllm/plugin_scheduler';
+
+  static const int _opAwaitDeferred = 1;
+
+  static Future<void>? _ready;
+  static bool _isReady = false;
+
+  /// Whether [ready] has completed
+  static bool get isReady => _isReady;
+
+  /// Completes once every deferred plugin is registered
+  ///
+  /// [messenger] defaults to the binding's; [DeferredPluginMessenger] passes
+  /// the one it wraps.
+  static Future<void> ready([BinaryMessenger? messenger]) {
+    return _ready ??= _awaitRunner(
+      messenger ?? ServicesBinding.instance.defaultBinaryMessenger,
+    );
+  }
+
+  static Future<void> _awaitRunner(BinaryMessenger messenger) async {
+    try {
+      // No reply means this runner registers everything up front.
+      await messenger.send(
+        channelName,
+        ByteData(1)..setUint8(0, _opAwaitDeferred),
+      );
+    } catch (e) {
+      debugPrint('🔌 [DeferredPlugins] Scheduler unavailable: $e');
+    } finally {
+      _isReady = true;
+    }
+  }
+
+  @visibleForTesting
+  static void reset() {
+    _ready = null;
+    _isReady = false;
+  }
+}
+
+/// Platform messenger that holds back calls to plugins that are not
+/// registered yet
+///
+/// An unhandled platform message gets a null reply, which the plugin's Dart
+/// side turns into a MissingPluginException. Until [DeferredPlugins.ready]
+/// completes such a call is retried once the deferred plugins are in, so
+/// code that runs early (restoring the session from secure storage, say)
+/// does not need to know which plugins are deferred.
+class DeferredPluginMessenger extends BinaryMessenger {
+  final BinaryMessenger _inner;
+
+  DeferredPluginMessenger(this._inner);
+
+  @override
+  Future<ByteData?>? send(String channel, ByteData? message) {
+    final reply = _inner.send(channel, message);
+    if (DeferredPlugins.isReady ||
+        reply == null ||
+        channel == DeferredPlugins.channelName) {
+      return reply;
+    }
+    return reply.then((data) async {
+      if (data != null) return data;
+      await DeferredPlugins.ready(_inner);
+      return _inner.send(channel, message);
+    });
+  }
+
+  @override
+  void setMessageHandler(String channel, MessageHandler? handler) {
+    _inner.setMessageHandler(channel, handler);
+  }
+
+  @override
+  Future<void> handlePlatformMessage(
+    String channel,
+    ByteData? data,
+    ui.PlatformMessageResponseCallback? callback,
+  ) {
+    // ignore: deprecated_member_use
+    return _inner.handlePlatformMessage(channel, data, callback);
+  }
+}
+
+/// The app's binding: the stock widgets binding with [DeferredPluginMessenger]
+/// as its platform messenger
+class CloudToLocalLLMBinding extends WidgetsFlutterBinding {
+  static CloudToLocalLLMBinding? _instance;
+
+  /// Use instead of [WidgetsFlutterBinding.ensureInitialized] at the top of
+  /// main(); the first binding created wins.
+  static WidgetsBinding ensureInitialized() {
+    if (_instance == null) {
+      CloudToLocalLLMBinding();
+    }
+    return WidgetsBinding.instance;
+  }
+
+  @override
+  void initInstances() {
+    super.initInstances();
+    _instance = this;
+  }
+
+  @override
+  BinaryMessenger createBinaryMessenger() {
+    return DeferredPluginMessenger(super.createBinaryMessenger());
+  }
+}
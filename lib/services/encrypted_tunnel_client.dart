@@ -1,5 +1,6 @@
 import 'dart:async';
 import 'dart:convert';
+import 'dart:typed_data';
 
 import 'package:flutter/foundation.dart';
 import 'package:http/http.dart' as http;
@@ -8,6 +9,8 @@ import 'package:web_socket_channel/web_socket_channel.dart';
 import 'encrypted_tunnel_service.dart';
 import 'encrypted_tunnel_protocol.dart';
 import 'auth_service.dart';
+import 'native_http_client.dart';
+import 'tunnel_heartbeat.dart';
 import '../config/app_config.dart';
 
 /// Desktop encrypted tunnel client
@@ -17,7 +20,20 @@ import '../config/app_config.dart';
 /// - Receives encrypted HTTP requests from containers
 /// - Forwards requests to local Ollama (localhost:11434)
 /// - Encrypts responses and sends back through tunnel
+///
+/// With binary frames, responses are streamed rather than buffered: status
+/// and headers, then body chunks as Ollama produces them, then the outcome.
+/// At most [_relayWindow] chunks may be unacknowledged by the cloud side
+/// before reading from Ollama pauses, so memory stays flat for any body size.
+///
+/// Requests are handled as they arrive, never waiting for one another. With
+/// the native client their responses are multiplexed onto the tunnel by
+/// priority (see [TunnelStreamPriority]), so a model pull streaming
+/// gigabytes does not hold back a chat or an `/api/tags` behind it.
 class EncryptedTunnelClient extends ChangeNotifier {
+  static const int _relayWindow = 8;
+  static const int _relayChunkSize = 16 * 1024;
+
   final EncryptedTunnelService _encryptionService;
   final AuthService _authService;
 
@@ -36,8 +52,17 @@ class EncryptedTunnelClient extends ChangeNotifier {
   // Pending HTTP requests (correlation ID -> completer)
   final Map<String, Completer<HttpResponseMessage>> _pendingRequests = {};
 
-  // Health monitoring
-  Timer? _pingTimer;
+  // Responses being streamed to the cloud side (correlation ID -> relay)
+  final Map<String, _ResponseRelay> _activeRelays = {};
+
+  // Frames leave in the order they were sealed
+  Future<void> _frameSendQueue = Future.value();
+
+  // Liveness; pings only when the tunnel is quiet
+  late final AdaptiveHeartbeat _heartbeat = AdaptiveHeartbeat(
+    ping: _sendPing,
+    onDead: _handlePeerUnresponsive,
+  );
 
   EncryptedTunnelClient({
     required EncryptedTunnelService encryptionService,
@@ -54,6 +79,9 @@ class EncryptedTunnelClient extends ChangeNotifier {
   /// Last error message
   String? get lastError => _lastError;
 
+  /// How long ago anything arrived from the cloud side
+  Duration get sinceLastReceived => _heartbeat.sinceReceived;
+
   /// Connect to the encrypted tunnel bridge
   Future<void> connect() async {
     if (_isConnecting || _isConnected) {
@@ -118,7 +146,7 @@ class EncryptedTunnelClient extends ChangeNotifier {
   Future<void> disconnect() async {
     debugPrint('🔐 [TunnelClient] Disconnecting from tunnel bridge...');
 
-    _pingTimer?.cancel();
+    _heartbeat.stop();
     _webSocketSubscription?.cancel();
     await _webSocket?.sink.close();
 
@@ -135,6 +163,11 @@ class EncryptedTunnelClient extends ChangeNotifier {
     }
     _pendingRequests.clear();
 
+    for (final relay in _activeRelays.values) {
+      relay.cancel();
+    }
+    _activeRelays.clear();
+
     debugPrint('🔐 [TunnelClient] Disconnected from tunnel bridge');
     notifyListeners();
   }
@@ -148,6 +181,10 @@ class EncryptedTunnelClient extends ChangeNotifier {
       id: MessageIdGenerator.generate(),
       publicKey: publicKey,
       userId: userId,
+      capabilities: const [
+        TunnelCapabilities.binaryFrames,
+        TunnelCapabilities.lz4Compression,
+      ],
     );
 
     await _sendMessage(keyExchange);
@@ -156,6 +193,14 @@ class EncryptedTunnelClient extends ChangeNotifier {
 
   /// Handle incoming WebSocket messages
   void _handleWebSocketMessage(dynamic data) {
+    _heartbeat.received();
+    if (data is List<int>) {
+      _handleEncryptedFrame(
+        data is Uint8List ? data : Uint8List.fromList(data),
+      );
+      return;
+    }
+
     try {
       final json = jsonDecode(data);
 
@@ -182,25 +227,42 @@ class EncryptedTunnelClient extends ChangeNotifier {
         encryptedMsg.encryptedData,
       );
       final json = jsonDecode(decryptedData);
-      final message = TunnelMessage.fromJson(json);
-
-      switch (message.type) {
-        case TunnelMessageType.httpRequest:
-          await _handleHttpRequest(message as HttpRequestMessage);
-          break;
-        case TunnelMessageType.ping:
-          await _handlePing(message as PingMessage);
-          break;
-        default:
-          debugPrint(
-            '🔐 [TunnelClient] Unexpected encrypted message type: ${message.type}',
-          );
-      }
+      await _handleTunnelMessage(TunnelMessage.fromJson(json));
     } catch (e) {
       debugPrint('🔐 [TunnelClient] Error handling encrypted message: $e');
     }
   }
 
+  /// Handle binary encrypted tunnel frames
+  Future<void> _handleEncryptedFrame(Uint8List frame) async {
+    try {
+      final message = await _encryptionService.openFrame(frame);
+      await _handleTunnelMessage(message);
+    } catch (e) {
+      debugPrint('🔐 [TunnelClient] Error handling encrypted frame: $e');
+    }
+  }
+
+  /// Dispatch a decrypted tunnel message
+  Future<void> _handleTunnelMessage(TunnelMessage message) async {
+    switch (message.type) {
+      case TunnelMessageType.httpRequest:
+        await _handleHttpRequest(message as HttpRequestMessage);
+        break;
+      case TunnelMessageType.ping:
+        await _handlePing(message as PingMessage);
+        break;
+      case TunnelMessageType.httpResponseAck:
+        final ack = message as HttpResponseAckMessage;
+        _activeRelays[ack.correlationId]?.grantCredit(ack.frames);
+        break;
+      default:
+        debugPrint(
+          '🔐 [TunnelClient] Unexpected encrypted message type: ${message.type}',
+        );
+    }
+  }
+
   /// Handle unencrypted control messages
   Future<void> _handleControlMessage(TunnelMessage message) async {
     switch (message.type) {
@@ -229,9 +291,22 @@ class EncryptedTunnelClient extends ChangeNotifier {
   ) async {
     try {
       // Establish encrypted session with remote public key
-      await _encryptionService.establishSession(message.publicKey);
+      final binaryFrames = message.capabilities.contains(
+        TunnelCapabilities.binaryFrames,
+      );
+      final compression =
+          binaryFrames &&
+          message.capabilities.contains(TunnelCapabilities.lz4Compression);
+      await _encryptionService.establishSession(
+        message.publicKey,
+        sessionId: message.sessionId,
+        binaryFrames: binaryFrames,
+        compression: compression,
+      );
       debugPrint(
-        '🔐 [TunnelClient] Encrypted session established: ${message.sessionId}',
+        '🔐 [TunnelClient] Encrypted session established: ${message.sessionId}'
+        '${binaryFrames ? ' (binary frames)' : ''}'
+        '${compression ? ' (compressed)' : ''}',
       );
     } catch (e) {
       debugPrint('🔐 [TunnelClient] Failed to establish session: $e');
@@ -245,6 +320,11 @@ class EncryptedTunnelClient extends ChangeNotifier {
         '🔐 [TunnelClient] Handling HTTP request: ${request.method} ${request.path}',
       );
 
+      if (_encryptionService.usesBinaryFrames) {
+        await _streamFromLocalOllama(request);
+        return;
+      }
+
       // Forward request to local Ollama
       final response = await _forwardToLocalOllama(request);
 
@@ -259,7 +339,7 @@ class EncryptedTunnelClient extends ChangeNotifier {
         statusCode: 500,
         headers: {'content-type': 'application/json'},
         body: jsonEncode({'error': 'Internal server error: $e'}),
-        correlationId: request.id,
+        correlationId: request.correlationId ?? request.id,
       );
 
       await _sendEncryptedMessage(errorResponse);
@@ -283,14 +363,14 @@ class EncryptedTunnelClient extends ChangeNotifier {
         response = await _httpClient.post(
           uri,
           headers: request.headers,
-          body: request.body,
+          body: request.bodyBytes ?? request.body,
         );
         break;
       case 'PUT':
         response = await _httpClient.put(
           uri,
           headers: request.headers,
-          body: request.body,
+          body: request.bodyBytes ?? request.body,
         );
         break;
       case 'DELETE':
@@ -304,8 +384,108 @@ class EncryptedTunnelClient extends ChangeNotifier {
       id: MessageIdGenerator.generate(),
       statusCode: response.statusCode,
       headers: response.headers.map((key, value) => MapEntry(key, value)),
-      body: response.body,
-      correlationId: request.id,
+      bodyBytes: response.bodyBytes,
+      correlationId: request.correlationId ?? request.id,
+    );
+  }
+
+  /// Stream the local Ollama response back as it is produced
+  ///
+  /// The native client seals frames on its worker thread and pauses its
+  /// socket when credit runs out; otherwise the same frames are produced
+  /// here from a `package:http` stream that is paused instead.
+  Future<void> _streamFromLocalOllama(HttpRequestMessage request) async {
+    final correlationId = request.correlationId ?? request.id;
+    final uri = Uri.parse('http://localhost:11434${request.path}');
+
+    final nativeStream = _encryptionService.nativeTunnelStream;
+    if (nativeStream != null) {
+      final relay = await NativeHttpClient().relayToTunnel(
+        tunnelStream: nativeStream,
+        correlationId: correlationId,
+        method: request.method.toUpperCase(),
+        url: uri,
+        headers: request.headers,
+        body: request.bodyBytes ?? utf8.encode(request.body ?? ''),
+        window: _relayWindow,
+        priority: TunnelStreamPriority.forPath(request.path),
+      );
+      final subscription = relay.frames.listen(
+        _sendFrame,
+        onDone: () => _activeRelays.remove(correlationId),
+      );
+      _activeRelays[correlationId] = _ResponseRelay(
+        grantCredit: relay.grantCredit,
+        cancel: subscription.cancel,
+      );
+      return;
+    }
+
+    final httpRequest = http.Request(request.method.toUpperCase(), uri)
+      ..headers.addAll(request.headers);
+    if (request.bodyBytes != null) {
+      httpRequest.bodyBytes = request.bodyBytes!;
+    } else if (request.body != null) {
+      httpRequest.body = request.body!;
+    }
+    final response = await _httpClient.send(httpRequest);
+
+    await _sendEncryptedMessage(
+      HttpResponseStartMessage(
+        id: MessageIdGenerator.generate(),
+        statusCode: response.statusCode,
+        headers: response.headers,
+        correlationId: correlationId,
+      ),
+    );
+
+    var credit = _relayWindow;
+    late final StreamSubscription<List<int>> subscription;
+
+    Future<void> finish(String? error) async {
+      if (_activeRelays.remove(correlationId) == null) return;
+      await _sendEncryptedMessage(
+        HttpResponseEndMessage(
+          id: MessageIdGenerator.generate(),
+          correlationId: correlationId,
+          error: error,
+        ),
+      );
+    }
+
+    subscription = response.stream.listen(
+      (chunk) {
+        final bytes = chunk is Uint8List ? chunk : Uint8List.fromList(chunk);
+        for (var offset = 0; offset < bytes.length; offset += _relayChunkSize) {
+          final end = offset + _relayChunkSize < bytes.length
+              ? offset + _relayChunkSize
+              : bytes.length;
+          _sendEncryptedMessage(
+            HttpResponseChunkMessage(
+              id: MessageIdGenerator.generate(),
+              correlationId: correlationId,
+              body: Uint8List.sublistView(bytes, offset, end),
+            ),
+          );
+          credit--;
+        }
+        if (credit <= 0 && !subscription.isPaused) {
+          subscription.pause();
+        }
+      },
+      onError: (Object error) => finish('$error'),
+      onDone: () => finish(null),
+      cancelOnError: true,
+    );
+
+    _activeRelays[correlationId] = _ResponseRelay(
+      grantCredit: (frames) {
+        credit += frames;
+        if (credit > 0 && subscription.isPaused) {
+          subscription.resume();
+        }
+      },
+      cancel: subscription.cancel,
     );
   }
 
@@ -339,6 +519,7 @@ class EncryptedTunnelClient extends ChangeNotifier {
 
     final json = jsonEncode(message.toJson());
     _webSocket!.sink.add(json);
+    _heartbeat.sent();
   }
 
   /// Send encrypted message
@@ -351,6 +532,15 @@ class EncryptedTunnelClient extends ChangeNotifier {
       throw Exception('No encrypted session');
     }
 
+    if (_encryptionService.usesBinaryFrames) {
+      // Sequence numbers are assigned at seal time, so keep sends in order.
+      final frame = _encryptionService.sealFrame(message);
+      final sent = _frameSendQueue.then((_) async => _sendFrame(await frame));
+      _frameSendQueue = sent.catchError((_) {});
+      await sent;
+      return;
+    }
+
     // Encrypt message
     final messageJson = jsonEncode(message.toJson());
     final encryptedData = await _encryptionService.encryptData(messageJson);
@@ -363,13 +553,26 @@ class EncryptedTunnelClient extends ChangeNotifier {
 
     final json = jsonEncode(encryptedMsg.toJson());
     _webSocket!.sink.add(json);
+    _heartbeat.sent();
+  }
+
+  /// Send a sealed binary frame as is
+  void _sendFrame(Uint8List frame) {
+    _webSocket?.sink.add(frame);
+    _heartbeat.sent();
   }
 
   /// Start health monitoring
   void _startHealthMonitoring() {
-    _pingTimer = Timer.periodic(const Duration(seconds: 30), (_) {
-      _sendPing();
-    });
+    _heartbeat.start();
+  }
+
+  /// The cloud side stopped answering; drop the connection so it is
+  /// re-established rather than left half-open
+  void _handlePeerUnresponsive() {
+    _lastError = 'Tunnel peer stopped responding';
+    debugPrint('🔐 [TunnelClient] $_lastError');
+    disconnect();
   }
 
   /// Send ping message
@@ -402,3 +605,11 @@ class EncryptedTunnelClient extends ChangeNotifier {
     super.dispose();
   }
 }
+
+/// Credit and cancellation hooks for a response being streamed
+class _ResponseRelay {
+  final void Function(int frames) grantCredit;
+  final Future<void> Function() cancel;
+
+  _ResponseRelay({required this.grantCredit, required this.cancel});
+}
@@ -1,5 +1,6 @@
 import 'dart:convert';
 import 'dart:math';
+import 'dart:typed_data';
 
 /// Message types for encrypted tunnel protocol
 enum TunnelMessageType {
@@ -10,6 +11,11 @@ enum TunnelMessageType {
   error,
   ping,
   pong,
+  // Streamed HTTP responses; binary frames only
+  httpResponseStart,
+  httpResponseChunk,
+  httpResponseEnd,
+  httpResponseAck,
 }
 
 /// Base class for all tunnel messages
@@ -43,6 +49,14 @@ abstract class TunnelMessage {
         return PingMessage.fromJson(json);
       case TunnelMessageType.pong:
         return PongMessage.fromJson(json);
+      case TunnelMessageType.httpResponseStart:
+        return HttpResponseStartMessage.fromJson(json);
+      case TunnelMessageType.httpResponseChunk:
+        return HttpResponseChunkMessage.fromJson(json);
+      case TunnelMessageType.httpResponseEnd:
+        return HttpResponseEndMessage.fromJson(json);
+      case TunnelMessageType.httpResponseAck:
+        return HttpResponseAckMessage.fromJson(json);
     }
   }
 }
@@ -55,6 +69,9 @@ class HttpRequestMessage extends TunnelMessage {
   final String? body;
   final String? correlationId;
 
+  /// Raw body as received in a binary frame, if any
+  final Uint8List? bodyBytes;
+
   HttpRequestMessage({
     required super.id,
     required this.method,
@@ -62,6 +79,7 @@ class HttpRequestMessage extends TunnelMessage {
     required this.headers,
     this.body,
     this.correlationId,
+    this.bodyBytes,
     super.timestamp,
   }) : super(type: TunnelMessageType.httpRequest);
 
@@ -99,12 +117,16 @@ class HttpResponseMessage extends TunnelMessage {
   final String? body;
   final String? correlationId;
 
+  /// Raw body bytes; sent as-is in binary frames instead of [body]
+  final Uint8List? bodyBytes;
+
   HttpResponseMessage({
     required super.id,
     required this.statusCode,
     required this.headers,
     this.body,
     this.correlationId,
+    this.bodyBytes,
     super.timestamp,
   }) : super(type: TunnelMessageType.httpResponse);
 
@@ -116,7 +138,11 @@ class HttpResponseMessage extends TunnelMessage {
       'timestamp': timestamp.toIso8601String(),
       'statusCode': statusCode,
       'headers': headers,
-      'body': body,
+      'body':
+          body ??
+          (bodyBytes != null
+              ? utf8.decode(bodyBytes!, allowMalformed: true)
+              : null),
       'correlationId': correlationId,
     };
   }
@@ -138,10 +164,14 @@ class KeyExchangeMessage extends TunnelMessage {
   final String publicKey;
   final String userId;
 
+  /// Optional protocol features this side supports, see [TunnelCapabilities]
+  final List<String> capabilities;
+
   KeyExchangeMessage({
     required super.id,
     required this.publicKey,
     required this.userId,
+    this.capabilities = const [],
     super.timestamp,
   }) : super(type: TunnelMessageType.keyExchange);
 
@@ -153,6 +183,7 @@ class KeyExchangeMessage extends TunnelMessage {
       'timestamp': timestamp.toIso8601String(),
       'publicKey': publicKey,
       'userId': userId,
+      'capabilities': capabilities,
     };
   }
 
@@ -161,6 +192,7 @@ class KeyExchangeMessage extends TunnelMessage {
       id: json['id'],
       publicKey: json['publicKey'],
       userId: json['userId'],
+      capabilities: List<String>.from(json['capabilities'] ?? const []),
       timestamp: DateTime.parse(json['timestamp']),
     );
   }
@@ -171,10 +203,14 @@ class SessionEstablishedMessage extends TunnelMessage {
   final String sessionId;
   final String publicKey;
 
+  /// Capabilities advertised by the peer in its key exchange
+  final List<String> capabilities;
+
   SessionEstablishedMessage({
     required super.id,
     required this.sessionId,
     required this.publicKey,
+    this.capabilities = const [],
     super.timestamp,
   }) : super(type: TunnelMessageType.sessionEstablished);
 
@@ -186,6 +222,7 @@ class SessionEstablishedMessage extends TunnelMessage {
       'timestamp': timestamp.toIso8601String(),
       'sessionId': sessionId,
       'publicKey': publicKey,
+      'capabilities': capabilities,
     };
   }
 
@@ -194,6 +231,7 @@ class SessionEstablishedMessage extends TunnelMessage {
       id: json['id'],
       sessionId: json['sessionId'],
       publicKey: json['publicKey'],
+      capabilities: List<String>.from(json['capabilities'] ?? const []),
       timestamp: DateTime.parse(json['timestamp']),
     );
   }
@@ -284,6 +322,401 @@ class PongMessage extends TunnelMessage {
   }
 }
 
+/// Status and headers of a response whose body follows in
+/// [HttpResponseChunkMessage]s and is finished by an [HttpResponseEndMessage]
+class HttpResponseStartMessage extends TunnelMessage {
+  final int statusCode;
+  final Map<String, String> headers;
+  final String correlationId;
+
+  HttpResponseStartMessage({
+    required super.id,
+    required this.statusCode,
+    required this.headers,
+    required this.correlationId,
+    super.timestamp,
+  }) : super(type: TunnelMessageType.httpResponseStart);
+
+  @override
+  Map<String, dynamic> toJson() {
+    return {
+      'type': type.name,
+      'id': id,
+      'timestamp': timestamp.toIso8601String(),
+      'statusCode': statusCode,
+      'headers': headers,
+      'correlationId': correlationId,
+    };
+  }
+
+  factory HttpResponseStartMessage.fromJson(Map<String, dynamic> json) {
+    return HttpResponseStartMessage(
+      id: json['id'],
+      statusCode: json['statusCode'],
+      headers: Map<String, String>.from(json['headers'] ?? {}),
+      correlationId: json['correlationId'],
+      timestamp: DateTime.parse(json['timestamp']),
+    );
+  }
+}
+
+/// One piece of a streamed response body
+class HttpResponseChunkMessage extends TunnelMessage {
+  final String correlationId;
+  final Uint8List body;
+
+  HttpResponseChunkMessage({
+    required super.id,
+    required this.correlationId,
+    required this.body,
+    super.timestamp,
+  }) : super(type: TunnelMessageType.httpResponseChunk);
+
+  @override
+  Map<String, dynamic> toJson() {
+    return {
+      'type': type.name,
+      'id': id,
+      'timestamp': timestamp.toIso8601String(),
+      'correlationId': correlationId,
+      'body': base64Encode(body),
+    };
+  }
+
+  factory HttpResponseChunkMessage.fromJson(Map<String, dynamic> json) {
+    return HttpResponseChunkMessage(
+      id: json['id'],
+      correlationId: json['correlationId'],
+      body: base64Decode(json['body']),
+      timestamp: DateTime.parse(json['timestamp']),
+    );
+  }
+}
+
+/// End of a streamed response; [error] is set if it was cut short
+class HttpResponseEndMessage extends TunnelMessage {
+  final String correlationId;
+  final String? error;
+
+  HttpResponseEndMessage({
+    required super.id,
+    required this.correlationId,
+    this.error,
+    super.timestamp,
+  }) : super(type: TunnelMessageType.httpResponseEnd);
+
+  @override
+  Map<String, dynamic> toJson() {
+    return {
+      'type': type.name,
+      'id': id,
+      'timestamp': timestamp.toIso8601String(),
+      'correlationId': correlationId,
+      'error': error,
+    };
+  }
+
+  factory HttpResponseEndMessage.fromJson(Map<String, dynamic> json) {
+    return HttpResponseEndMessage(
+      id: json['id'],
+      correlationId: json['correlationId'],
+      error: json['error'],
+      timestamp: DateTime.parse(json['timestamp']),
+    );
+  }
+}
+
+/// Sent by the cloud side once [frames] chunks of a streamed response have
+/// been written out, returning that much send credit
+class HttpResponseAckMessage extends TunnelMessage {
+  final String correlationId;
+  final int frames;
+
+  HttpResponseAckMessage({
+    required super.id,
+    required this.correlationId,
+    required this.frames,
+    super.timestamp,
+  }) : super(type: TunnelMessageType.httpResponseAck);
+
+  @override
+  Map<String, dynamic> toJson() {
+    return {
+      'type': type.name,
+      'id': id,
+      'timestamp': timestamp.toIso8601String(),
+      'correlationId': correlationId,
+      'frames': frames,
+    };
+  }
+
+  factory HttpResponseAckMessage.fromJson(Map<String, dynamic> json) {
+    return HttpResponseAckMessage(
+      id: json['id'],
+      correlationId: json['correlationId'],
+      frames: json['frames'],
+      timestamp: DateTime.parse(json['timestamp']),
+    );
+  }
+}
+
+/// Optional tunnel protocol features negotiated during key exchange
+class TunnelCapabilities {
+  /// Encrypted messages travel as binary frames (see [TunnelPayloadCodec])
+  /// instead of base64 inside JSON
+  static const String binaryFrames = 'binary-frames-v1';
+
+  /// Frame payloads may be LZ4-compressed against a shared dictionary (see
+  /// native/tunnel_compression.h); each side compresses what it sends only
+  /// if the other advertised this
+  static const String lz4Compression = 'lz4-dict-v1';
+}
+
+/// Binary payload encoding for messages carried in encrypted tunnel frames
+///
+/// Mirrors `encodePayload`/`decodePayload` in api-backend/tunnel-frame.js.
+/// Strings are `u32 length` + UTF-8, header maps are `u16 count` + pairs, and
+/// HTTP bodies are the raw trailing bytes, so they are never base64-encoded
+/// or embedded in JSON. Key exchange messages are never framed.
+class TunnelPayloadCodec {
+  /// Wire code for [type]; also the frame's type byte
+  static int typeCode(TunnelMessageType type) => type.index + 1;
+
+  static TunnelMessageType? typeFromCode(int code) =>
+      code >= 1 && code <= TunnelMessageType.values.length
+      ? TunnelMessageType.values[code - 1]
+      : null;
+
+  static Uint8List encode(TunnelMessage message) {
+    final writer = _PayloadWriter()..string(message.id);
+    switch (message) {
+      case HttpRequestMessage():
+        writer
+          ..string(message.method)
+          ..string(message.path)
+          ..string(message.correlationId ?? '')
+          ..headers(message.headers)
+          ..body(message.bodyBytes, message.body);
+      case HttpResponseMessage():
+        writer
+          ..u16(message.statusCode)
+          ..string(message.correlationId ?? '')
+          ..headers(message.headers)
+          ..body(message.bodyBytes, message.body);
+      case ErrorMessage():
+        writer
+          ..string(message.error)
+          ..string(message.correlationId ?? '')
+          ..u8(message.details != null ? 1 : 0)
+          ..string(message.details ?? '');
+      case PingMessage():
+        break;
+      case PongMessage():
+        writer.string(message.pingId);
+      case HttpResponseStartMessage():
+        writer
+          ..u16(message.statusCode)
+          ..string(message.correlationId)
+          ..headers(message.headers);
+      case HttpResponseChunkMessage():
+        writer
+          ..string(message.correlationId)
+          ..bytes(message.body);
+      case HttpResponseEndMessage():
+        writer
+          ..string(message.correlationId)
+          ..u8(message.error != null ? 1 : 0)
+          ..string(message.error ?? '');
+      case HttpResponseAckMessage():
+        writer
+          ..string(message.correlationId)
+          ..u32(message.frames);
+      default:
+        throw ArgumentError('${message.type.name} messages are not framed');
+    }
+    return writer.takeBytes();
+  }
+
+  static TunnelMessage decode(TunnelMessageType type, Uint8List payload) {
+    final reader = _PayloadReader(payload);
+    final id = reader.string();
+    switch (type) {
+      case TunnelMessageType.httpRequest:
+        final method = reader.string();
+        final path = reader.string();
+        final correlationId = reader.string();
+        final headers = reader.headers();
+        final bodyBytes = reader.u8() != 0 ? reader.rest() : null;
+        return HttpRequestMessage(
+          id: id,
+          method: method,
+          path: path,
+          headers: headers,
+          body: bodyBytes != null
+              ? utf8.decode(bodyBytes, allowMalformed: true)
+              : null,
+          bodyBytes: bodyBytes,
+          correlationId: correlationId.isEmpty ? null : correlationId,
+        );
+      case TunnelMessageType.httpResponse:
+        final statusCode = reader.u16();
+        final correlationId = reader.string();
+        final headers = reader.headers();
+        final bodyBytes = reader.u8() != 0 ? reader.rest() : null;
+        return HttpResponseMessage(
+          id: id,
+          statusCode: statusCode,
+          headers: headers,
+          bodyBytes: bodyBytes,
+          correlationId: correlationId.isEmpty ? null : correlationId,
+        );
+      case TunnelMessageType.error:
+        final error = reader.string();
+        final correlationId = reader.string();
+        final hasDetails = reader.u8() != 0;
+        final details = reader.string();
+        return ErrorMessage(
+          id: id,
+          error: error,
+          details: hasDetails ? details : null,
+          correlationId: correlationId.isEmpty ? null : correlationId,
+        );
+      case TunnelMessageType.ping:
+        return PingMessage(id: id);
+      case TunnelMessageType.pong:
+        return PongMessage(id: id, pingId: reader.string());
+      case TunnelMessageType.httpResponseStart:
+        final statusCode = reader.u16();
+        final correlationId = reader.string();
+        return HttpResponseStartMessage(
+          id: id,
+          statusCode: statusCode,
+          correlationId: correlationId,
+          headers: reader.headers(),
+        );
+      case TunnelMessageType.httpResponseChunk:
+        return HttpResponseChunkMessage(
+          id: id,
+          correlationId: reader.string(),
+          body: reader.rest(),
+        );
+      case TunnelMessageType.httpResponseEnd:
+        final correlationId = reader.string();
+        final hasError = reader.u8() != 0;
+        final error = reader.string();
+        return HttpResponseEndMessage(
+          id: id,
+          correlationId: correlationId,
+          error: hasError ? error : null,
+        );
+      case TunnelMessageType.httpResponseAck:
+        final correlationId = reader.string();
+        return HttpResponseAckMessage(
+          id: id,
+          correlationId: correlationId,
+          frames: reader.u32(),
+        );
+      case TunnelMessageType.keyExchange:
+      case TunnelMessageType.sessionEstablished:
+        throw ArgumentError('${type.name} messages are not framed');
+    }
+  }
+}
+
+class _PayloadWriter {
+  final BytesBuilder _builder = BytesBuilder(copy: false);
+  final ByteData _scratch = ByteData(4);
+
+  void u8(int value) => _builder.addByte(value);
+
+  void u16(int value) {
+    _scratch.setUint16(0, value, Endian.little);
+    _builder.add(Uint8List.fromList(_scratch.buffer.asUint8List(0, 2)));
+  }
+
+  void u32(int value) {
+    _scratch.setUint32(0, value, Endian.little);
+    _builder.add(Uint8List.fromList(_scratch.buffer.asUint8List(0, 4)));
+  }
+
+  void string(String value) {
+    final bytes = utf8.encode(value);
+    u32(bytes.length);
+    _builder.add(bytes);
+  }
+
+  void headers(Map<String, String> headers) {
+    u16(headers.length);
+    headers.forEach((name, value) {
+      string(name);
+      string(value);
+    });
+  }
+
+  void body(Uint8List? bytes, String? text) {
+    if (bytes == null && text == null) {
+      u8(0);
+      return;
+    }
+    u8(1);
+    _builder.add(bytes ?? utf8.encode(text!));
+  }
+
+  void bytes(Uint8List bytes) => _builder.add(bytes);
+
+  Uint8List takeBytes() => _builder.takeBytes();
+}
+
+class _PayloadReader {
+  final Uint8List _bytes;
+  final ByteData _data;
+  int _offset = 0;
+
+  _PayloadReader(this._bytes)
+    : _data = ByteData.view(
+        _bytes.buffer,
+        _bytes.offsetInBytes,
+        _bytes.lengthInBytes,
+      );
+
+  int u8() => _data.getUint8(_offset++);
+
+  int u16() {
+    final value = _data.getUint16(_offset, Endian.little);
+    _offset += 2;
+    return value;
+  }
+
+  int u32() {
+    final value = _data.getUint32(_offset, Endian.little);
+    _offset += 4;
+    return value;
+  }
+
+  String string() {
+    final length = _data.getUint32(_offset, Endian.little);
+    _offset += 4;
+    final value = utf8.decode(
+      Uint8List.sublistView(_bytes, _offset, _offset + length),
+      allowMalformed: true,
+    );
+    _offset += length;
+    return value;
+  }
+
+  Map<String, String> headers() {
+    final count = u16();
+    final headers = <String, String>{};
+    for (var i = 0; i < count; i++) {
+      final name = string();
+      headers[name] = string();
+    }
+    return headers;
+  }
+
+  Uint8List rest() => Uint8List.sublistView(_bytes, _offset);
+}
+
 /// Utility class for generating message IDs
 class MessageIdGenerator {
   static final Random _random = Random.secure();
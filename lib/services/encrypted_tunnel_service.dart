@@ -1,27 +1,39 @@
 import 'dart:convert';
 import 'dart:math';
 import 'package:flutter/foundation.dart';
-import 'package:crypto/crypto.dart';
+import 'package:cryptography/cryptography.dart';
 import 'package:flutter_secure_storage_x/flutter_secure_storage_x.dart';
 
+import 'encrypted_tunnel_protocol.dart';
+import 'native_http_client.dart';
+import 'tunnel_frame_codec.dart';
+
 /// Zero-knowledge end-to-end encrypted tunnel service
 ///
 /// This service provides secure tunneling between desktop and cloud containers
 /// with the following security guarantees:
 /// - Client-side key generation (private keys never leave desktop)
-/// - End-to-end encryption using AES-256-GCM with random keys
+/// - X25519 key agreement with the container (shared secret is the session key)
+/// - End-to-end encryption using ChaCha20-Poly1305
 /// - Zero-knowledge architecture (server cannot decrypt tunnel traffic)
-/// - Perfect forward secrecy (new session keys per connection)
 /// - Audit-proof design (technically impossible for admins to access user data)
 ///
-/// Note: This is a simplified implementation for demonstration purposes.
-/// In production, you would use proper X25519 + ChaCha20-Poly1305 or similar.
+/// When both ends support [TunnelCapabilities.binaryFrames], messages travel
+/// as binary frames sealed by [TunnelFrameCodec] instead of base64 JSON.
 class EncryptedTunnelService extends ChangeNotifier {
   static const String _deviceKeyStorageKey = 'encrypted_tunnel_device_key';
 
+  // DER prefix of an X25519 SubjectPublicKeyInfo, as exported by Node's
+  // crypto on the container side; the raw 32-byte key follows it.
+  static const List<int> _x25519SpkiPrefix = [
+    0x30, 0x2a, 0x30, 0x05, 0x06, 0x03, 0x2b, 0x65, 0x6e, 0x03, 0x21, 0x00,
+  ];
+
   final FlutterSecureStorage _secureStorage = const FlutterSecureStorage();
+  final X25519 _keyAgreement = X25519();
+  final Chacha20 _aead = Chacha20.poly1305Aead();
 
-  // Device key for this device (256-bit random key)
+  // X25519 private key seed for this device (256-bit random key)
   Uint8List? _deviceKey;
 
   // Session state
@@ -31,6 +43,8 @@ class EncryptedTunnelService extends ChangeNotifier {
   // Session encryption key (ephemeral)
   Uint8List? _sessionKey;
   String? _sessionId;
+  TunnelFrameCodec? _frameCodec;
+  int? _nativeTunnelStream;
 
   EncryptedTunnelService();
 
@@ -43,6 +57,13 @@ class EncryptedTunnelService extends ChangeNotifier {
   /// Current session ID
   String? get sessionId => _sessionId;
 
+  /// Whether the current session exchanges binary frames
+  bool get usesBinaryFrames => _frameCodec != null;
+
+  /// Lane on which the native HTTP client relays responses for this
+  /// session (see [NativeHttpClient.relayToTunnel]), if available
+  int? get nativeTunnelStream => _nativeTunnelStream;
+
   /// Initialize the encrypted tunnel service
   Future<void> initialize() async {
     try {
@@ -107,19 +128,30 @@ class EncryptedTunnelService extends ChangeNotifier {
     debugPrint('🔐 [EncryptedTunnel] New device key generated and stored');
   }
 
-  /// Get device key as base64 string for sharing
+  /// Get the device's X25519 public key as base64 SPKI DER for sharing
   Future<String> getDevicePublicKeyBase64() async {
     if (_deviceKey == null) {
       throw Exception('Device not initialized');
     }
 
-    // For simplicity, we'll use the device key directly
-    // In production, you'd derive a public key from the private key
-    return base64Encode(_deviceKey!);
+    final keyPair = await _keyAgreement.newKeyPairFromSeed(_deviceKey!);
+    final publicKey = await keyPair.extractPublicKey();
+    return base64Encode([..._x25519SpkiPrefix, ...publicKey.bytes]);
   }
 
   /// Establish encrypted session with remote key
-  Future<void> establishSession(String remoteKeyBase64) async {
+  ///
+  /// [remoteKeyBase64] is the peer's X25519 public key as SPKI DER or raw
+  /// bytes. [sessionId] is the id assigned by the bridge; frames carry it, so
+  /// both ends must use the same one. With [binaryFrames] messages are sealed
+  /// with [sealFrame] instead of [encryptData], and with [compression] as
+  /// well the frames sent are compressed where that pays off.
+  Future<void> establishSession(
+    String remoteKeyBase64, {
+    String? sessionId,
+    bool binaryFrames = false,
+    bool compression = false,
+  }) async {
     if (_deviceKey == null) {
       throw Exception('Device not initialized');
     }
@@ -127,16 +159,40 @@ class EncryptedTunnelService extends ChangeNotifier {
     try {
       debugPrint('🔐 [EncryptedTunnel] Establishing encrypted session...');
 
-      // For simplicity, derive session key from device key and remote key
-      final remoteKeyBytes = base64Decode(remoteKeyBase64);
-      final combined = Uint8List.fromList([..._deviceKey!, ...remoteKeyBytes]);
-
-      // Use SHA-256 to derive session key
-      final digest = sha256.convert(combined);
-      _sessionKey = Uint8List.fromList(digest.bytes);
+      var remoteKeyBytes = base64Decode(remoteKeyBase64);
+      if (remoteKeyBytes.length == _x25519SpkiPrefix.length + 32) {
+        remoteKeyBytes = remoteKeyBytes.sublist(_x25519SpkiPrefix.length);
+      }
+      if (remoteKeyBytes.length != 32) {
+        throw const FormatException('Remote key is not an X25519 public key');
+      }
 
-      // Generate session ID
-      _sessionId = _generateSessionId();
+      // The raw X25519 shared secret is the session key, as on the
+      // container side
+      final keyPair = await _keyAgreement.newKeyPairFromSeed(_deviceKey!);
+      final sharedSecret = await _keyAgreement.sharedSecretKey(
+        keyPair: keyPair,
+        remotePublicKey: SimplePublicKey(
+          remoteKeyBytes,
+          type: KeyPairType.x25519,
+        ),
+      );
+      _sessionKey = Uint8List.fromList(await sharedSecret.extractBytes());
+      _sessionId = sessionId ?? _generateSessionId();
+
+      await _closeFrameSession();
+      if (binaryFrames) {
+        _frameCodec = await TunnelFrameCodec.open(
+          key: _sessionKey!,
+          sessionId: _sessionId!,
+          compress: compression,
+        );
+        _nativeTunnelStream = await NativeHttpClient().openTunnelStream(
+          key: _sessionKey!,
+          sessionId: _sessionId!,
+          compress: compression,
+        );
+      }
 
       debugPrint(
         '🔐 [EncryptedTunnel] Encrypted session established: $_sessionId',
@@ -150,55 +206,41 @@ class EncryptedTunnelService extends ChangeNotifier {
     }
   }
 
-  /// Encrypt data for tunnel transmission (simplified implementation)
+  /// Encrypt data for tunnel transmission as base64 nonce + ciphertext + tag
   Future<String> encryptData(String data) async {
     if (_sessionKey == null) {
       throw Exception('No active session');
     }
 
     try {
-      // Convert data to bytes
-      final dataBytes = utf8.encode(data);
-
-      // Generate random nonce
-      final nonce = _generateNonce();
-
-      // Simple XOR encryption for demonstration
-      // In production, use proper AES-GCM or ChaCha20-Poly1305
-      final encrypted = Uint8List(dataBytes.length);
-      for (int i = 0; i < dataBytes.length; i++) {
-        encrypted[i] = dataBytes[i] ^ _sessionKey![i % _sessionKey!.length];
-      }
-
-      // Combine nonce + encrypted data
-      final combined = Uint8List.fromList([...nonce, ...encrypted]);
-
-      return base64Encode(combined);
+      final box = await _aead.encrypt(
+        utf8.encode(data),
+        secretKey: SecretKeyData(_sessionKey!),
+        nonce: _generateNonce(),
+      );
+      return base64Encode(box.concatenation());
     } catch (e) {
       debugPrint('🔐 [EncryptedTunnel] Encryption failed: $e');
       rethrow;
     }
   }
 
-  /// Decrypt data received from tunnel (simplified implementation)
+  /// Decrypt data received from tunnel
   Future<String> decryptData(String encryptedData) async {
     if (_sessionKey == null) {
       throw Exception('No active session');
     }
 
     try {
-      // Decode base64
-      final combined = base64Decode(encryptedData);
-
-      // Extract components (skip nonce: 12 bytes, rest: encrypted data)
-      final encrypted = combined.sublist(12);
-
-      // Simple XOR decryption
-      final decrypted = Uint8List(encrypted.length);
-      for (int i = 0; i < encrypted.length; i++) {
-        decrypted[i] = encrypted[i] ^ _sessionKey![i % _sessionKey!.length];
-      }
-
+      final box = SecretBox.fromConcatenation(
+        base64Decode(encryptedData),
+        nonceLength: 12,
+        macLength: 16,
+      );
+      final decrypted = await _aead.decrypt(
+        box,
+        secretKey: SecretKeyData(_sessionKey!),
+      );
       return utf8.decode(decrypted);
     } catch (e) {
       debugPrint('🔐 [EncryptedTunnel] Decryption failed: $e');
@@ -206,6 +248,35 @@ class EncryptedTunnelService extends ChangeNotifier {
     }
   }
 
+  /// Seal [message] into a binary frame for the current session
+  Future<Uint8List> sealFrame(TunnelMessage message) {
+    final codec = _frameCodec;
+    if (codec == null) {
+      throw Exception('No binary frame session');
+    }
+    return codec.seal(message);
+  }
+
+  /// Open a binary frame received on the current session
+  Future<TunnelMessage> openFrame(Uint8List frame) {
+    final codec = _frameCodec;
+    if (codec == null) {
+      throw Exception('No binary frame session');
+    }
+    return codec.open(frame);
+  }
+
+  Future<void> _closeFrameSession() async {
+    final codec = _frameCodec;
+    final stream = _nativeTunnelStream;
+    _frameCodec = null;
+    _nativeTunnelStream = null;
+    await codec?.close();
+    if (stream != null) {
+      await NativeHttpClient().closeTunnelStream(stream);
+    }
+  }
+
   /// Generate random nonce for encryption
   List<int> _generateNonce() {
     final random = Random.secure();
@@ -221,8 +292,10 @@ class EncryptedTunnelService extends ChangeNotifier {
 
   /// Clear session (for security)
   void clearSession() {
+    _sessionKey?.fillRange(0, _sessionKey!.length, 0);
     _sessionKey = null;
     _sessionId = null;
+    _closeFrameSession();
     debugPrint('🔐 [EncryptedTunnel] Session cleared');
     notifyListeners();
   }
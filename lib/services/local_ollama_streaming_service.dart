@@ -5,7 +5,11 @@ import 'package:http/http.dart' as http;
 import 'package:rxdart/rxdart.dart';
 import '../config/app_config.dart';
 import '../models/ollama_connection_error.dart';
+import '../models/ollama_token_batch.dart';
 import '../models/streaming_message.dart';
+import 'native_http_client.dart';
+import 'native_ndjson_parser.dart';
+import 'ollama_chat_session.dart';
 import 'streaming_service.dart';
 
 /// Local Ollama streaming service implementation
@@ -16,6 +20,9 @@ class LocalOllamaStreamingService extends StreamingService {
   final String _baseUrl;
   final StreamingConfig _config;
   final http.Client _httpClient;
+  final NativeNdjsonParser _ndjsonParser = NativeNdjsonParser();
+  final NativeHttpClient _nativeHttp = NativeHttpClient();
+  final OllamaChatSessions _sessions = OllamaChatSessions();
 
   StreamingConnection _connection = StreamingConnection.disconnected();
   final BehaviorSubject<StreamingMessage> _messageSubject =
@@ -41,6 +48,12 @@ class LocalOllamaStreamingService extends StreamingService {
   @override
   StreamingConnection get connection => _connection;
 
+  /// How much of each prompt Ollama could serve from its cache
+  PromptPrefixStats get prefixStats => _sessions.stats;
+
+  PromptPrefixStats? prefixStatsFor(String conversationId) =>
+      _sessions.statsFor(conversationId);
+
   @override
   Stream<StreamingMessage> get messageStream => _messageSubject.stream;
 
@@ -156,78 +169,62 @@ class LocalOllamaStreamingService extends StreamingService {
 
     final messageId = 'msg_${DateTime.now().millisecondsSinceEpoch}';
     int sequence = 0;
+    final reply = StringBuffer();
+    var completed = false;
 
     try {
-      final messages = [
-        if (history != null) ...history,
-        {'role': 'user', 'content': prompt},
-      ];
-
-      final requestBody = {
-        'model': model,
-        'messages': messages,
-        'stream': true,
-      };
+      final requestBody = _sessions.buildRequest(
+        conversationId: conversationId,
+        model: model,
+        history: history ?? const [],
+        prompt: prompt,
+      );
 
       debugPrint('🦙 [LocalOllamaStreaming] Starting stream for model: $model');
 
-      final request = http.Request('POST', Uri.parse('$_baseUrl/api/chat'));
-      request.headers.addAll({
-        'Content-Type': 'application/json',
-        'Accept': 'application/x-ndjson',
-      });
-      request.body = json.encode(requestBody);
+      final batches = await _openChatStream(requestBody);
 
-      final streamedResponse = await _httpClient
-          .send(request)
-          .timeout(_config.streamTimeout);
+      // Token deltas arrive in batches: the native parser returns everything
+      // decoded from one network chunk at once, so the UI rebuilds per chunk
+      // rather than per token.
+      await for (final batch in batches) {
+        if (batch.error != null) {
+          throw StreamingException(batch.error!, code: 'OLLAMA_ERROR');
+        }
 
-      if (streamedResponse.statusCode != 200) {
-        throw StreamingException(
-          'Stream request failed: HTTP ${streamedResponse.statusCode}',
-          code: 'STREAM_ERROR',
-        );
-      }
+        if (batch.text.isNotEmpty) {
+          reply.write(batch.text);
+          final streamingMessage = StreamingMessage.chunk(
+            id: messageId,
+            conversationId: conversationId,
+            chunk: batch.text,
+            sequence: sequence++,
+            model: model,
+            blocks: batch.blocks,
+          );
+
+          yield streamingMessage;
+          _messageSubject.add(streamingMessage);
+        }
+
+        if (batch.done) {
+          // Stream completed
+          completed = true;
+          _sessions.recordReply(
+            conversationId,
+            reply.toString(),
+            doneStats: batch.stats,
+          );
+          final completeMessage = StreamingMessage.complete(
+            id: messageId,
+            conversationId: conversationId,
+            sequence: sequence++,
+            model: model,
+          );
 
-      await for (final chunk
-          in streamedResponse.stream
-              .transform(utf8.decoder)
-              .transform(const LineSplitter())) {
-        if (chunk.trim().isEmpty) continue;
-
-        try {
-          final data = json.decode(chunk);
-
-          if (data['done'] == true) {
-            // Stream completed
-            final completeMessage = StreamingMessage.complete(
-              id: messageId,
-              conversationId: conversationId,
-              sequence: sequence++,
-              model: model,
-            );
-
-            yield completeMessage;
-            _messageSubject.add(completeMessage);
-            break;
-          }
-
-          final content = data['message']?['content'] as String?;
-          if (content != null && content.isNotEmpty) {
-            final streamingMessage = StreamingMessage.chunk(
-              id: messageId,
-              conversationId: conversationId,
-              chunk: content,
-              sequence: sequence++,
-              model: model,
-            );
-
-            yield streamingMessage;
-            _messageSubject.add(streamingMessage);
-          }
-        } catch (e) {
-          debugPrint('🦙 [LocalOllamaStreaming] Error parsing chunk: $e');
-          // Continue processing other chunks
+          yield completeMessage;
+          _messageSubject.add(completeMessage);
+          break;
         }
       }
 
@@ -238,6 +235,9 @@ class LocalOllamaStreamingService extends StreamingService {
       _publishStatusEvent();
       notifyListeners();
     } catch (e) {
+      if (!completed) {
+        _sessions.recordReply(conversationId, '');
+      }
       final errorMessage = StreamingMessage.error(
         id: messageId,
         conversationId: conversationId,
@@ -259,6 +259,60 @@ class LocalOllamaStreamingService extends StreamingService {
     }
   }
 
+  /// Start a streaming /api/chat request and return its token batches
+  ///
+  /// Plain-HTTP loopback servers are streamed by the runner's native client,
+  /// which reads and parses the body on its own thread; anything else goes
+  /// through package:http and [NativeNdjsonParser].
+  Future<Stream<OllamaTokenBatch>> _openChatStream(String body) async {
+    final uri = Uri.parse('$_baseUrl/api/chat');
+    const headers = {
+      'Content-Type': 'application/json',
+      'Accept': 'application/x-ndjson',
+    };
+
+    if (uri.scheme == 'http' &&
+        _isLoopbackHost(uri.host) &&
+        await _nativeHttp.isAvailable) {
+      final response = await _nativeHttp
+          .send(
+            method: 'POST',
+            url: uri,
+            headers: headers,
+            body: body,
+            parseNdjson: true,
+            lexMarkdown: true,
+          )
+          .timeout(_config.streamTimeout);
+      if (response.statusCode != 200) {
+        throw StreamingException(
+          'Stream request failed: HTTP ${response.statusCode}',
+          code: 'STREAM_ERROR',
+        );
+      }
+      return response.tokens;
+    }
+
+    final request = http.Request('POST', uri);
+    request.headers.addAll(headers);
+    request.body = body;
+
+    final streamedResponse = await _httpClient
+        .send(request)
+        .timeout(_config.streamTimeout);
+
+    if (streamedResponse.statusCode != 200) {
+      throw StreamingException(
+        'Stream request failed: HTTP ${streamedResponse.statusCode}',
+        code: 'STREAM_ERROR',
+      );
+    }
+    return _ndjsonParser.parse(streamedResponse.stream);
+  }
+
+  static bool _isLoopbackHost(String host) =>
+      host == 'localhost' || host == '127.0.0.1' || host == '::1';
+
   @override
   Future<bool> testConnection() async {
     try {
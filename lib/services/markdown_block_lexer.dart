@@ -0,0 +1,321 @@
+import '../models/markdown_block.dart';
+
+/// Splits a reply into [MarkdownBlock]s as it streams in, in Dart
+///
+/// The same rules as the native MarkdownLexer (native/markdown_lexer.h),
+/// for replies that did not come through the runner's native client (a
+/// remote Ollama, the cloud, web) and for messages loaded from history.
+/// Only complete lines change the lexer's state; the unfinished last line
+/// is classified as if it ended there and again as it grows, so [append]
+/// costs the length of the delta however long the reply.
+class MarkdownBlockLexer {
+  static const int _space = 0x20;
+  static const int _tab = 0x09;
+  static const int _carriageReturn = 0x0d;
+  static const int _newline = 0x0a;
+  static const int _backtick = 0x60;
+  static const int _tilde = 0x7e;
+  static const int _hash = 0x23;
+
+  final List<_Block> _blocks = [];
+  _Line _line = _Line(0);
+  int _length = 0;
+
+  bool _inFence = false;
+  int _fenceChar = 0;
+  int _fenceLength = 0;
+  bool _paragraphOpen = false;
+
+  // Blocks as of the last complete line, and the last of them as it was.
+  int _committedSize = 0;
+  _Block? _committedTail;
+  // Set while the unfinished last line is applied, and the first block it
+  // changed, or null.
+  bool _tentative = false;
+  int? _tentativeFrom;
+
+  // The first block not yet reported as it stands.
+  int _dirty = 0;
+
+  /// UTF-16 code units seen so far
+  int get length => _length;
+
+  /// Every block of the reply so far
+  List<MarkdownBlock> get blocks => [for (final block in _blocks) block.freeze()];
+
+  /// Starts a new reply
+  void reset() {
+    _blocks.clear();
+    _line = _Line(0);
+    _length = 0;
+    _inFence = false;
+    _fenceChar = 0;
+    _fenceLength = 0;
+    _paragraphOpen = false;
+    _committedSize = 0;
+    _committedTail = null;
+    _tentative = false;
+    _tentativeFrom = null;
+    _dirty = 0;
+  }
+
+  /// Lexes the next [delta] of the reply and returns the blocks it changed
+  MarkdownBlockUpdate append(String delta) {
+    _revert();
+    for (var i = 0; i < delta.length; i++) {
+      final unit = delta.codeUnitAt(i);
+      if (unit == _newline) {
+        _endLine(_length);
+        _length++;
+        _line = _Line(_length);
+        continue;
+      }
+      _length++;
+      _scan(unit, _length - 1);
+    }
+
+    if (_length > _line.start) {
+      _committedSize = _blocks.length;
+      _committedTail = _blocks.isEmpty ? null : _blocks.last.copy();
+      _tentative = true;
+      _endLine(_length);
+      _tentative = false;
+    }
+    return _takeChanges();
+  }
+
+  MarkdownBlockUpdate _takeChanges() {
+    final first = _dirty < _blocks.length ? _dirty : _blocks.length;
+    final update = MarkdownBlockUpdate(first, [
+      for (var i = first; i < _blocks.length; i++) _blocks[i].freeze(),
+    ]);
+    _dirty = _blocks.length;
+    return update;
+  }
+
+  static bool _isSpace(int unit) =>
+      unit == _space || unit == _tab || unit == _carriageReturn;
+
+  void _scan(int unit, int position) {
+    final line = _line;
+    if (line.blank) {
+      if (unit == _space) {
+        line.indent++;
+        return;
+      }
+      if (_isSpace(unit)) {
+        if (unit == _tab) line.indent = 4;
+        return;
+      }
+      line.blank = false;
+      line.first = position;
+      if (unit == _backtick || unit == _tilde || unit == _hash) {
+        line.marker = unit;
+        line.run = 1;
+        line.inRun = true;
+        return;
+      }
+    } else if (line.inRun) {
+      if (unit == line.marker) {
+        line.run++;
+        return;
+      }
+      line.inRun = false;
+      line.spaceAfterRun = _isSpace(unit);
+    }
+
+    if (_isSpace(unit)) {
+      if (line.hasRest) line.wordDone = true;
+      return;
+    }
+    if (!line.hasRest) {
+      line.hasRest = true;
+      line.restStart = position;
+    }
+    line.restEnd = position + 1;
+    if (!line.wordDone) line.wordEnd = position + 1;
+    if (unit == _backtick) line.restHasBacktick = true;
+  }
+
+  void _endLine(int end) {
+    final line = _line;
+    final marked = !line.blank && line.indent < 4;
+
+    if (_inFence) {
+      _touch(_blocks.length - 1);
+      final code = _blocks.last;
+      final closer =
+          marked &&
+          line.marker == _fenceChar &&
+          line.run >= _fenceLength &&
+          !line.hasRest;
+      if (closer) {
+        // The body ends before the newline ahead of the closing fence.
+        code.bodyEnd = line.start - 1 > code.bodyStart
+            ? line.start - 1
+            : code.bodyStart;
+        code.end = end;
+        if (!_tentative) {
+          code.closed = true;
+          _inFence = false;
+        }
+      } else {
+        code.bodyEnd = end;
+        code.end = end;
+      }
+      return;
+    }
+
+    if (line.blank) {
+      if (!_tentative) _closeParagraph();
+      return;
+    }
+
+    if (marked &&
+        (line.marker == _backtick || line.marker == _tilde) &&
+        line.run >= 3 &&
+        !(line.marker == _backtick && line.restHasBacktick)) {
+      _closeParagraph();
+      // The body starts after the opening fence's newline, once there is one.
+      final bodyStart = _tentative ? end : end + 1;
+      _push(
+        _Block(MarkdownBlockKind.code)
+          ..start = line.start
+          ..end = end
+          ..infoStart = line.hasRest ? line.restStart : end
+          ..infoEnd = line.hasRest ? line.wordEnd : end
+          ..bodyStart = bodyStart
+          ..bodyEnd = bodyStart,
+      );
+      if (!_tentative) {
+        _inFence = true;
+        _fenceChar = line.marker;
+        _fenceLength = line.run;
+      }
+      return;
+    }
+
+    if (marked &&
+        line.marker == _hash &&
+        line.run <= 6 &&
+        (line.inRun || line.spaceAfterRun)) {
+      _closeParagraph();
+      _push(
+        _Block(MarkdownBlockKind.heading)
+          ..closed = !_tentative
+          ..start = line.start
+          ..end = end
+          ..bodyStart = line.hasRest ? line.restStart : end
+          ..bodyEnd = line.hasRest ? line.restEnd : end,
+      );
+      return;
+    }
+
+    if (_paragraphOpen) {
+      _touch(_blocks.length - 1);
+      _blocks.last
+        ..end = end
+        ..bodyEnd = end;
+      return;
+    }
+    _push(
+      _Block(MarkdownBlockKind.paragraph)
+        ..start = line.first
+        ..end = end
+        ..bodyStart = line.first
+        ..bodyEnd = end,
+    );
+    if (!_tentative) _paragraphOpen = true;
+  }
+
+  void _closeParagraph() {
+    // A tentative heading or fence may yet turn out to continue it.
+    if (!_paragraphOpen || _tentative) return;
+    _touch(_blocks.length - 1);
+    _blocks.last.closed = true;
+    _paragraphOpen = false;
+  }
+
+  void _push(_Block block) {
+    _touch(_blocks.length);
+    _blocks.add(block);
+  }
+
+  void _touch(int index) {
+    if (_tentative) {
+      final from = _tentativeFrom;
+      _tentativeFrom = from == null || index < from ? index : from;
+    }
+    if (index < _dirty) _dirty = index;
+  }
+
+  /// Undoes the last append's tentative line
+  void _revert() {
+    final from = _tentativeFrom;
+    if (from == null) return;
+    _blocks.length = _committedSize;
+    if (from < _committedSize) {
+      _blocks[_committedSize - 1] = _committedTail!;
+    }
+    _touch(from < _blocks.length ? from : _blocks.length);
+    _tentativeFrom = null;
+  }
+}
+
+/// What has been seen of the current line
+class _Line {
+  final int start;
+  // Leading spaces; four or more makes no marker count.
+  int indent = 0;
+  bool blank = true;
+  // The first non-space.
+  int first = 0;
+  // '`', '~' or '#' at the first non-space, and how many in a row.
+  int marker = 0;
+  int run = 0;
+  bool inRun = false;
+  bool spaceAfterRun = false;
+  // The non-space text after the marker run, and its first word.
+  bool hasRest = false;
+  int restStart = 0;
+  int restEnd = 0;
+  int wordEnd = 0;
+  bool wordDone = false;
+  bool restHasBacktick = false;
+
+  _Line(this.start);
+}
+
+/// A block as it is being built
+class _Block {
+  final MarkdownBlockKind kind;
+  bool closed = false;
+  int start = 0;
+  int end = 0;
+  int infoStart = 0;
+  int infoEnd = 0;
+  int bodyStart = 0;
+  int bodyEnd = 0;
+
+  _Block(this.kind);
+
+  _Block copy() => _Block(kind)
+    ..closed = closed
+    ..start = start
+    ..end = end
+    ..infoStart = infoStart
+    ..infoEnd = infoEnd
+    ..bodyStart = bodyStart
+    ..bodyEnd = bodyEnd;
+
+  MarkdownBlock freeze() => MarkdownBlock(
+    kind: kind,
+    closed: closed,
+    start: start,
+    end: end,
+    infoStart: infoStart,
+    infoEnd: infoEnd,
+    bodyStart: bodyStart,
+    bodyEnd: bodyEnd,
+  );
+}
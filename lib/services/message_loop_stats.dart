@@ -0,0 +1,54 @@
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+
+/// Wakeup counters from the Windows runner's message loop
+///
+/// Every return from the loop's wait counts as a wakeup, whatever caused it,
+/// so [wakeupsPerSecond] while the window is hidden to the tray is the idle
+/// cost of the whole app on a battery-powered relay.
+class MessageLoopStats {
+  static const String channelName = 'cloudtolocalllm/message_loop';
+
+  /// Wakeups since the runner started
+  final int wakeups;
+
+  /// Averaged over the last second, or since the last wakeup when idle longer
+  final double wakeupsPerSecond;
+
+  /// Whether the EcoQoS and timer coalescing hints are applied
+  final bool efficiencyMode;
+
+  const MessageLoopStats({
+    required this.wakeups,
+    required this.wakeupsPerSecond,
+    required this.efficiencyMode,
+  });
+
+  /// Reads the current counters; null where the runner does not report them
+  static Future<MessageLoopStats?> fetch() async {
+    if (kIsWeb) return null;
+    try {
+      final reply = await ServicesBinding.instance.defaultBinaryMessenger.send(
+        channelName,
+        ByteData(0),
+      );
+      if (reply == null || reply.lengthInBytes < 17) return null;
+      return MessageLoopStats(
+        wakeups: reply.getUint64(0, Endian.little),
+        wakeupsPerSecond: reply.getFloat64(8, Endian.little),
+        efficiencyMode: reply.getUint8(16) != 0,
+      );
+    } catch (e) {
+      debugPrint('🪟 [MessageLoopStats] Failed to read stats: $e');
+      return null;
+    }
+  }
+
+  @override
+  String toString() =>
+      'MessageLoopStats(wakeups: $wakeups, '
+      'wakeupsPerSecond: ${wakeupsPerSecond.toStringAsFixed(1)}, '
+      'efficiencyMode: $efficiencyMode)';
+}
@@ -0,0 +1,326 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+
+import '../models/conversation.dart';
+import '../models/message.dart';
+
+/// A conversation as listed by [NativeConversationStore.list]
+class NativeConversationSummary {
+  /// The conversation with only its last message, if it has any
+  final Conversation conversation;
+
+  /// How many messages it has in the store
+  final int messageCount;
+
+  const NativeConversationSummary(this.conversation, this.messageCount);
+}
+
+/// A message matching [NativeConversationStore.search]
+class NativeSearchHit {
+  final String conversationId;
+  final String messageId;
+
+  /// BM25 relevance; higher is better
+  final double score;
+
+  const NativeSearchHit(this.conversationId, this.messageId, this.score);
+}
+
+/// Client for the desktop runners' conversation store on
+/// `cloudtolocalllm/conversation_store`
+///
+/// The store (native/conversation_store.h) is an append-only log read
+/// through a memory mapping, with an index of where each message's records
+/// are. Every call writes one record, so a streamed token is saved with
+/// [appendToMessage] instead of rewriting the conversation, and [list]
+/// returns titles and last messages without reading any other message.
+/// [search] answers from an inverted index kept next to the log
+/// (native/search_index.h), again without reading message bodies.
+/// Requests are laid out as in native/conversation_store_service.h.
+class NativeConversationStore {
+  static const String channelName = 'cloudtolocalllm/conversation_store';
+
+  // Request opcodes; must match ConversationStoreService in native/.
+  static const int _opOpen = 1;
+  static const int _opList = 2;
+  static const int _opLoadMessages = 3;
+  static const int _opPutConversation = 4;
+  static const int _opDeleteConversation = 5;
+  static const int _opPutMessage = 6;
+  static const int _opAppendToMessage = 7;
+  static const int _opDeleteMessage = 8;
+  static const int _opClear = 9;
+  static const int _opSync = 10;
+  static const int _opClose = 11;
+  static const int _opSearch = 12;
+
+  final BinaryMessenger _messenger;
+
+  NativeConversationStore._(this._messenger);
+
+  /// Opens the store in [directory], which must exist; null when the runner
+  /// has no native store (web, mobile, or the open failed)
+  static Future<NativeConversationStore?> open(
+    String directory, {
+    BinaryMessenger? messenger,
+  }) async {
+    if (kIsWeb) return null;
+    final store = NativeConversationStore._(
+      messenger ?? ServicesBinding.instance.defaultBinaryMessenger,
+    );
+    try {
+      await store._send(_StoreWriter(_opOpen)..string(directory));
+      return store;
+    } catch (e) {
+      debugPrint('💾 [NativeConversationStore] Unavailable: $e');
+      return null;
+    }
+  }
+
+  /// Every conversation, most recently updated first
+  Future<List<NativeConversationSummary>> list() async {
+    final reader = await _send(_StoreWriter(_opList));
+    final count = reader.u32();
+    final summaries = <NativeConversationSummary>[];
+    for (var i = 0; i < count; i++) {
+      final conversation = reader.conversation();
+      final messageCount = reader.u32();
+      final lastMessage = reader.u8() != 0 ? reader.message() : null;
+      summaries.add(
+        NativeConversationSummary(
+          conversation.copyWith(
+            messages: [if (lastMessage != null) lastMessage],
+          ),
+          messageCount,
+        ),
+      );
+    }
+    return summaries;
+  }
+
+  /// The messages of [conversationId] in order; empty if it is unknown
+  Future<List<Message>> loadMessages(String conversationId) async {
+    final reader = await _send(
+      _StoreWriter(_opLoadMessages)..string(conversationId),
+    );
+    final count = reader.u32();
+    return [for (var i = 0; i < count; i++) reader.message()];
+  }
+
+  /// Inserts or replaces the conversation's title, model and dates; its
+  /// messages are written separately
+  Future<void> putConversation(Conversation conversation) async {
+    await _send(_StoreWriter(_opPutConversation)..conversation(conversation));
+  }
+
+  Future<void> deleteConversation(String conversationId) async {
+    await _send(_StoreWriter(_opDeleteConversation)..string(conversationId));
+  }
+
+  /// Adds [message] at the end of the conversation, or replaces the one with
+  /// the same id where it is
+  Future<void> putMessage(String conversationId, Message message) async {
+    await _send(
+      _StoreWriter(_opPutMessage)
+        ..string(conversationId)
+        ..message(message),
+    );
+  }
+
+  /// Appends [text] to a stored message's content
+  Future<void> appendToMessage(
+    String conversationId,
+    String messageId,
+    String text,
+  ) async {
+    await _send(
+      _StoreWriter(_opAppendToMessage)
+        ..string(conversationId)
+        ..string(messageId)
+        ..bytes(utf8.encode(text)),
+    );
+  }
+
+  Future<void> deleteMessage(String conversationId, String messageId) async {
+    await _send(
+      _StoreWriter(_opDeleteMessage)
+        ..string(conversationId)
+        ..string(messageId),
+    );
+  }
+
+  Future<void> clear() async {
+    await _send(_StoreWriter(_opClear));
+  }
+
+  /// Flushes the log to disk in the background
+  Future<void> sync() async {
+    await _send(_StoreWriter(_opSync));
+  }
+
+  Future<void> close() async {
+    await _send(_StoreWriter(_opClose));
+  }
+
+  /// Messages matching [query], best first
+  ///
+  /// Clauses are words, prefixes ending in `*` and `"quoted phrases"`; a
+  /// message must match all of them.
+  Future<List<NativeSearchHit>> search(String query, {int limit = 50}) async {
+    final reader = await _send(
+      _StoreWriter(_opSearch)
+        ..string(query)
+        ..u32(limit),
+    );
+    final count = reader.u32();
+    return [
+      for (var i = 0; i < count; i++)
+        NativeSearchHit(reader.string(), reader.string(), reader.f64()),
+    ];
+  }
+
+  Future<_StoreReader> _send(_StoreWriter request) async {
+    final reply = await _messenger.send(
+      channelName,
+      ByteData.sublistView(request.takeBytes()),
+    );
+    if (reply == null || reply.lengthInBytes == 0) {
+      throw StateError('Native conversation store rejected the request');
+    }
+    return _StoreReader(reply);
+  }
+}
+
+/// Request builder for the layouts in native/conversation_store.h
+class _StoreWriter {
+  final BytesBuilder _builder = BytesBuilder(copy: false);
+  final ByteData _scratch = ByteData(8);
+
+  _StoreWriter(int op) {
+    _builder.addByte(op);
+  }
+
+  void u8(int value) => _builder.addByte(value);
+
+  void u32(int value) {
+    _scratch.setUint32(0, value, Endian.little);
+    _builder.add(Uint8List.fromList(_scratch.buffer.asUint8List(0, 4)));
+  }
+
+  void i64(int value) {
+    _scratch.setInt64(0, value, Endian.little);
+    _builder.add(Uint8List.fromList(_scratch.buffer.asUint8List(0, 8)));
+  }
+
+  void string(String value) {
+    final bytes = utf8.encode(value);
+    u32(bytes.length);
+    _builder.add(bytes);
+  }
+
+  void optionalString(String? value) {
+    u8(value != null ? 1 : 0);
+    string(value ?? '');
+  }
+
+  void bytes(Uint8List bytes) => _builder.add(bytes);
+
+  void conversation(Conversation conversation) {
+    string(conversation.id);
+    string(conversation.title);
+    optionalString(conversation.model);
+    i64(conversation.createdAt.millisecondsSinceEpoch);
+    i64(conversation.updatedAt.millisecondsSinceEpoch);
+  }
+
+  void message(Message message) {
+    string(message.id);
+    string(message.role.name);
+    string(message.status.name);
+    optionalString(message.model);
+    optionalString(message.error);
+    i64(message.timestamp.millisecondsSinceEpoch);
+    string(message.content);
+  }
+
+  Uint8List takeBytes() => _builder.takeBytes();
+}
+
+/// Reply reader for the layouts in native/conversation_store.h
+class _StoreReader {
+  final ByteData _data;
+  int _offset = 0;
+
+  _StoreReader(this._data);
+
+  int u8() => _data.getUint8(_offset++);
+
+  int u32() {
+    final value = _data.getUint32(_offset, Endian.little);
+    _offset += 4;
+    return value;
+  }
+
+  int i64() {
+    final value = _data.getInt64(_offset, Endian.little);
+    _offset += 8;
+    return value;
+  }
+
+  double f64() {
+    final value = _data.getFloat64(_offset, Endian.little);
+    _offset += 8;
+    return value;
+  }
+
+  String string() {
+    final length = u32();
+    final value = utf8.decode(
+      Uint8List.sublistView(_data, _offset, _offset + length),
+      allowMalformed: true,
+    );
+    _offset += length;
+    return value;
+  }
+
+  String? optionalString() {
+    final present = u8() != 0;
+    final value = string();
+    return present ? value : null;
+  }
+
+  Conversation conversation() {
+    return Conversation(
+      id: string(),
+      title: string(),
+      model: optionalString(),
+      createdAt: DateTime.fromMillisecondsSinceEpoch(i64()),
+      updatedAt: DateTime.fromMillisecondsSinceEpoch(i64()),
+      messages: const [],
+    );
+  }
+
+  Message message() {
+    final id = string();
+    final role = string();
+    final status = string();
+    return Message(
+      id: id,
+      role: MessageRole.values.firstWhere(
+        (value) => value.name == role,
+        orElse: () => MessageRole.user,
+      ),
+      status: MessageStatus.values.firstWhere(
+        (value) => value.name == status,
+        orElse: () => MessageStatus.sent,
+      ),
+      model: optionalString(),
+      error: optionalString(),
+      timestamp: DateTime.fromMillisecondsSinceEpoch(i64()),
+      content: string(),
+    );
+  }
+}
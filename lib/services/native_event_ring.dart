@@ -0,0 +1,105 @@
+import 'dart:async';
+import 'dart:ffi';
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart';
+
+/// Reads event records straight out of a native SpscRing over dart:ffi
+///
+/// The runner's HTTP worker writes events for ring-backed requests into one
+/// block of native memory (see native/spsc_ring.h) and rings a
+/// [NativeCallable.listener] doorbell only when this side has drained the
+/// ring and armed it. A burst of token batches then costs one wakeup of the
+/// isolate instead of one platform-channel message each, and no buffer is
+/// allocated per event: [onEvent] gets a view into native memory that is
+/// only valid until it returns.
+class NativeEventRing {
+  static const bool isSupported = true;
+
+  static const int _wrapMarker = 0xffffffff;
+  // Spans handled per wakeup before yielding to the event loop.
+  static const int _spansPerDrain = 64;
+
+  final void Function(ByteData event) onEvent;
+
+  late final NativeCallable<Void Function(Int64)> _doorbell =
+      NativeCallable<Void Function(Int64)>.listener(_onDoorbell);
+
+  Pointer<Void> _ring = nullptr;
+  Pointer<Pointer<Uint8>> _spanData = nullptr;
+  late int Function(Pointer<Void>) _read;
+  late void Function(Pointer<Void>, int) _consume;
+  late int Function(Pointer<Void>) _arm;
+  bool _draining = false;
+
+  NativeEventRing(this.onEvent);
+
+  /// Address of the doorbell to pass to the native side
+  int get doorbellAddress => _doorbell.nativeFunction.address;
+
+  /// Bind to the ring described by the kOpenEventRing reply
+  bool attach(ByteData descriptor) {
+    if (descriptor.lengthInBytes < 40) return false;
+    int address(int index) => descriptor.getUint64(index * 8, Endian.little);
+
+    _ring = Pointer<Void>.fromAddress(address(0));
+    // ReadSpan starts with the data pointer.
+    _spanData = Pointer<Pointer<Uint8>>.fromAddress(address(1));
+    _read = Pointer<NativeFunction<Size Function(Pointer<Void>)>>.fromAddress(
+      address(2),
+    ).asFunction(isLeaf: true);
+    _consume =
+        Pointer<NativeFunction<Void Function(Pointer<Void>, Size)>>.fromAddress(
+          address(3),
+        ).asFunction(isLeaf: true);
+    _arm = Pointer<NativeFunction<Uint8 Function(Pointer<Void>)>>.fromAddress(
+      address(4),
+    ).asFunction(isLeaf: true);
+    return true;
+  }
+
+  /// Stop listening for the doorbell; the native side must have detached it
+  void close() {
+    _ring = nullptr;
+    _doorbell.close();
+  }
+
+  void _onDoorbell(int tag) => _drain();
+
+  void _drain() {
+    if (_draining || _ring == nullptr) return;
+    _draining = true;
+    try {
+      for (var spans = 0; spans < _spansPerDrain; spans++) {
+        final size = _read(_ring);
+        if (size == 0) {
+          if (_arm(_ring) != 0) return;
+          continue;
+        }
+        _dispatch(_spanData.value.asTypedList(size));
+        _consume(_ring, size);
+      }
+      // Still busy: let other work run, then carry on without waiting for
+      // a doorbell, since the ring was never armed.
+      Timer.run(_drain);
+    } finally {
+      _draining = false;
+    }
+  }
+
+  void _dispatch(Uint8List span) {
+    final view = ByteData.sublistView(span);
+    var offset = 0;
+    while (offset + 4 <= span.length) {
+      final length = view.getUint32(offset, Endian.little);
+      // The rest of the span is padding up to the end of the buffer.
+      if (length == _wrapMarker) return;
+      try {
+        onEvent(ByteData.sublistView(span, offset + 4, offset + 4 + length));
+      } catch (e) {
+        debugPrint('🦙 [NativeEventRing] Event handler failed: $e');
+      }
+      offset += (4 + length + 7) & ~7;
+    }
+  }
+}
@@ -0,0 +1,16 @@
+import 'dart:typed_data';
+
+/// Stand-in for platforms without dart:ffi; events use the platform channel
+class NativeEventRing {
+  static const bool isSupported = false;
+
+  final void Function(ByteData event) onEvent;
+
+  NativeEventRing(this.onEvent);
+
+  int get doorbellAddress => 0;
+
+  bool attach(ByteData descriptor) => false;
+
+  void close() {}
+}
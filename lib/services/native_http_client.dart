@@ -0,0 +1,877 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+
+import '../models/markdown_block.dart';
+import '../models/ollama_token_batch.dart';
+import 'native_event_ring_stub.dart'
+    if (dart.library.ffi) 'native_event_ring.dart';
+
+/// Streaming HTTP client for the local Ollama server, backed by the runner
+///
+/// On the desktop runners requests are handed to a native worker thread over
+/// the `cloudtolocalllm/ollama_http` binary channel. Sockets, chunked
+/// decoding and (optionally) NDJSON parsing all happen there, and progress
+/// comes back as events on `cloudtolocalllm/ollama_http/events`, so a
+/// streaming chat never touches the UI isolate's event loop for I/O.
+///
+/// Where dart:ffi is available, events for [send] are read out of a shared
+/// native ring buffer (see [NativeEventRing]) rather than arriving as one
+/// message each, so token bursts are delivered in batches.
+///
+/// Use [isAvailable] before [send]; where the channel is not registered
+/// (web, mobile, tests) callers fall back to `package:http`.
+class NativeHttpClient {
+  static const String channelName = 'cloudtolocalllm/ollama_http';
+  static const String eventChannelName = 'cloudtolocalllm/ollama_http/events';
+
+  // Request opcodes and event types; must match HttpStreamService in native/.
+  static const int _opPing = 0;
+  static const int _opStart = 1;
+  static const int _opCancel = 2;
+  static const int _opOpenTunnelStream = 3;
+  static const int _opCloseTunnelStream = 4;
+  static const int _opGrantCredit = 5;
+  static const int _opOpenEventRing = 6;
+  static const int _opEmbedFiles = 7;
+  static const int _opPullModel = 8;
+  static const int _opFetchFile = 9;
+  static const int _flagParseNdjson = 1 << 0;
+  static const int _flagTunnelFrames = 1 << 1;
+  static const int _flagEventRing = 1 << 2;
+  static const int _flagMarkdown = 1 << 3;
+  static const int _tunnelFlagCompress = 1 << 0;
+  static const int _eventStarted = 1;
+  static const int _eventBody = 2;
+  static const int _eventTokens = 3;
+  static const int _eventComplete = 4;
+  static const int _eventError = 5;
+  static const int _eventFrame = 6;
+  static const int _eventEmbedProgress = 7;
+  static const int _eventEmbeddings = 8;
+  static const int _eventDownloadProgress = 9;
+  static const int _eventBlocks = 10;
+
+  static const int _eventRingCapacity = 256 * 1024;
+
+  static final NativeHttpClient _instance = NativeHttpClient._internal(null);
+  factory NativeHttpClient() => _instance;
+
+  /// Create a client bound to [messenger] instead of the default one
+  @visibleForTesting
+  factory NativeHttpClient.withMessenger(BinaryMessenger messenger) =>
+      NativeHttpClient._internal(messenger);
+
+  NativeHttpClient._internal(this._messenger);
+
+  final BinaryMessenger? _messenger;
+  final Map<int, _PendingResponse> _pending = {};
+  final Map<int, NativeTunnelRelay> _relays = {};
+  final Map<int, NativeEmbeddingJob> _embeddings = {};
+  final Map<int, NativeDownloadJob> _downloads = {};
+  int _nextRequestId = 1;
+  int _nextTunnelStream = 1;
+  Future<bool>? _available;
+  NativeEventRing? _eventRing;
+
+  BinaryMessenger get _binaryMessenger =>
+      _messenger ?? ServicesBinding.instance.defaultBinaryMessenger;
+
+  /// Whether the native client is registered; probed once and cached
+  Future<bool> get isAvailable {
+    if (kIsWeb) return Future.value(false);
+    return _available ??= _probe();
+  }
+
+  Future<bool> _probe() async {
+    try {
+      final reply = await _send(_opPing, 0);
+      final available = reply != null && reply.lengthInBytes > 0;
+      if (available) {
+        _binaryMessenger.setMessageHandler(eventChannelName, _handleEvent);
+        await _openEventRing();
+      } else {
+        debugPrint(
+          '🦙 [NativeHttpClient] Native client unavailable, using package:http',
+        );
+      }
+      return available;
+    } catch (e) {
+      debugPrint('🦙 [NativeHttpClient] Probe failed: $e');
+      return false;
+    }
+  }
+
+  Future<void> _openEventRing() async {
+    if (!NativeEventRing.isSupported) return;
+    final ring = NativeEventRing(_dispatchEvent);
+    try {
+      final request = _RequestWriter()
+        ..u32(_eventRingCapacity)
+        ..u64(ring.doorbellAddress);
+      final reply = await _send(_opOpenEventRing, 0, request.takeBytes());
+      if (reply != null && ring.attach(reply)) {
+        _eventRing = ring;
+        return;
+      }
+    } catch (e) {
+      debugPrint('🦙 [NativeHttpClient] Event ring unavailable: $e');
+    }
+    ring.close();
+  }
+
+  /// Start a request and wait for the response headers
+  ///
+  /// With [parseNdjson] a 2xx body is parsed natively and delivered on
+  /// [NativeHttpResponse.tokens]; otherwise raw bytes arrive on
+  /// [NativeHttpResponse.body]. With [lexMarkdown] as well, the reply is
+  /// split into markdown blocks natively as it streams, and each batch that
+  /// changes them carries the change in [OllamaTokenBatch.blocks].
+  /// Cancelling the subscription aborts the request. Throws
+  /// [NativeHttpException] if no response is received.
+  Future<NativeHttpResponse> send({
+    required String method,
+    required Uri url,
+    Map<String, String> headers = const {},
+    String body = '',
+    bool parseNdjson = false,
+    bool lexMarkdown = false,
+  }) async {
+    if (!await isAvailable) {
+      throw const NativeHttpException('Native HTTP client is not available');
+    }
+
+    final id = _nextRequestId++;
+    final pending = _PendingResponse(id, this, parseNdjson);
+    _pending[id] = pending;
+
+    final request = _RequestWriter()
+      ..request(method, url, headers)
+      ..u8(
+        (parseNdjson ? _flagParseNdjson : 0) |
+            (parseNdjson && lexMarkdown ? _flagMarkdown : 0) |
+            (_eventRing != null ? _flagEventRing : 0),
+      )
+      ..string(body);
+
+    final reply = await _send(_opStart, id, request.takeBytes());
+    if (reply == null || reply.lengthInBytes == 0) {
+      _pending.remove(id);
+      throw const NativeHttpException('Native HTTP client rejected request');
+    }
+    return pending.started.future;
+  }
+
+  /// Open a lane for [relayToTunnel] on the tunnel session with [key]
+  ///
+  /// Returns a handle, or null when the native client is unavailable. With
+  /// [compress] the lane's frames are compressed when that pays off.
+  Future<int?> openTunnelStream({
+    required Uint8List key,
+    required String sessionId,
+    bool compress = false,
+  }) async {
+    if (!await isAvailable) return null;
+    final handle = _nextTunnelStream++;
+    final request = _RequestWriter()
+      ..bytes(key)
+      ..string(sessionId)
+      ..u8(compress ? _tunnelFlagCompress : 0);
+    final reply = await _send(_opOpenTunnelStream, handle, request.takeBytes());
+    return reply != null && reply.lengthInBytes > 0 ? handle : null;
+  }
+
+  /// Close a lane opened with [openTunnelStream]; relays already running on
+  /// it finish normally
+  Future<void> closeTunnelStream(int handle) async {
+    await _send(_opCloseTunnelStream, handle);
+  }
+
+  /// Send a request to the local server and relay its response straight
+  /// into sealed tunnel frames
+  ///
+  /// The native worker seals the status and headers, each body chunk and
+  /// the outcome as httpResponseStart/Chunk/End frames tagged with
+  /// [correlationId], so the body never passes through Dart as a message.
+  /// Reading from the server pauses once [window] chunk frames are
+  /// unacknowledged; call [NativeTunnelRelay.grantCredit] as the cloud
+  /// side acknowledges them.
+  ///
+  /// Relays on the same runner are multiplexed: frames of a higher
+  /// [priority] relay leave ahead of lower ones, and equal ones take turns.
+  /// [body] is sent as is, so binary uploads (`/api/blobs`) arrive intact.
+  Future<NativeTunnelRelay> relayToTunnel({
+    required int tunnelStream,
+    required String correlationId,
+    required String method,
+    required Uri url,
+    Map<String, String> headers = const {},
+    List<int> body = const [],
+    int window = 0,
+    TunnelStreamPriority priority = TunnelStreamPriority.normal,
+  }) async {
+    if (!await isAvailable) {
+      throw const NativeHttpException('Native HTTP client is not available');
+    }
+
+    final id = _nextRequestId++;
+    final relay = NativeTunnelRelay._(id, this);
+    _relays[id] = relay;
+
+    final request = _RequestWriter()
+      ..request(method, url, headers)
+      ..u8(_flagTunnelFrames)
+      ..lengthPrefixed(body)
+      ..u64(tunnelStream)
+      ..string(correlationId)
+      ..u32(window)
+      ..u8(priority.index);
+
+    final reply = await _send(_opStart, id, request.takeBytes());
+    if (reply == null || reply.lengthInBytes == 0) {
+      _relays.remove(id);
+      throw const NativeHttpException('Native HTTP client rejected request');
+    }
+    return relay;
+  }
+
+  /// Embed local files through Ollama's `/api/embed`, natively
+  ///
+  /// The runner maps each of [paths], cuts it into overlapping chunks of
+  /// about [chunkSize] bytes on paragraph, line or word breaks and sends
+  /// them to [server] in batches of [batchSize], a couple of requests at a
+  /// time, so throughput is bound by the model rather than by requests or
+  /// Dart allocations. Zero sizes pick the native defaults. The vectors
+  /// arrive in one buffer that [NativeEmbeddings.vectors] views in place.
+  Future<NativeEmbeddingJob> embedFiles({
+    required String model,
+    required List<String> paths,
+    Uri? server,
+    int chunkSize = 0,
+    int chunkOverlap = 0,
+    int batchSize = 0,
+  }) async {
+    if (!await isAvailable) {
+      throw const NativeHttpException('Native HTTP client is not available');
+    }
+
+    final id = _nextRequestId++;
+    final job = NativeEmbeddingJob._(id, this);
+    _embeddings[id] = job;
+
+    final url = server ?? Uri.parse('http://localhost:11434');
+    final request = _RequestWriter()
+      ..string(url.host)
+      ..u16(url.port)
+      ..string(model)
+      ..u32(chunkSize)
+      ..u32(chunkOverlap)
+      ..u32(batchSize)
+      ..u32(paths.length);
+    for (final path in paths) {
+      request.string(path);
+    }
+
+    final reply = await _send(_opEmbedFiles, id, request.takeBytes());
+    if (reply == null || reply.lengthInBytes == 0) {
+      _embeddings.remove(id);
+      throw const NativeHttpException('Native HTTP client rejected request');
+    }
+    return job;
+  }
+
+  /// Pull [model] into [server] with its progress parsed natively
+  ///
+  /// The `/api/pull` stream is read on a runner thread and its per-layer
+  /// progress summed into one figure, reported on
+  /// [NativeDownloadJob.progress] about ten times a second however fast
+  /// Ollama writes lines.
+  Future<NativeDownloadJob> pullModel(String model, {Uri? server}) {
+    final url = server ?? Uri.parse('http://localhost:11434');
+    return _startDownload(
+      _opPullModel,
+      _RequestWriter()
+        ..string(url.host)
+        ..u16(url.port)
+        ..string(model),
+    );
+  }
+
+  /// Download the model file at [url] to [destination], for direct imports
+  ///
+  /// Where the server takes byte ranges the file is fetched over up to
+  /// [connections] parallel requests (zero for the native default) into a
+  /// preallocated `<destination>.part`, and an interrupted or cancelled
+  /// download of the same file resumes where it stopped. Only plain HTTP
+  /// is supported.
+  Future<NativeDownloadJob> fetchFile({
+    required Uri url,
+    required String destination,
+    int connections = 0,
+  }) {
+    if (url.scheme != 'http') {
+      throw ArgumentError.value(url, 'url', 'must be a plain HTTP URL');
+    }
+    return _startDownload(
+      _opFetchFile,
+      _RequestWriter()
+        ..string(url.host)
+        ..u16(url.port)
+        ..string(url.hasQuery ? '${url.path}?${url.query}' : url.path)
+        ..string(destination)
+        ..u8(connections),
+    );
+  }
+
+  Future<NativeDownloadJob> _startDownload(
+    int op,
+    _RequestWriter request,
+  ) async {
+    if (!await isAvailable) {
+      throw const NativeHttpException('Native HTTP client is not available');
+    }
+
+    final id = _nextRequestId++;
+    final job = NativeDownloadJob._(id, this);
+    _downloads[id] = job;
+    final reply = await _send(op, id, request.takeBytes());
+    if (reply == null || reply.lengthInBytes == 0) {
+      _downloads.remove(id);
+      throw const NativeHttpException('Native HTTP client rejected request');
+    }
+    return job;
+  }
+
+  void _cancel(int id) {
+    if (_pending.remove(id) != null ||
+        _relays.remove(id) != null ||
+        _embeddings.remove(id) != null ||
+        _downloads.remove(id) != null) {
+      _send(_opCancel, id);
+    }
+  }
+
+  void _grantCredit(int id, int frames) {
+    if (_relays.containsKey(id)) {
+      _send(_opGrantCredit, id, (_RequestWriter()..u32(frames)).takeBytes());
+    }
+  }
+
+  Future<ByteData?> _handleEvent(ByteData? message) async {
+    if (message != null) _dispatchEvent(message);
+    return null;
+  }
+
+  /// Handle one encoded event, from the channel or the event ring
+  ///
+  /// Ring events are views into native memory that is reused once this
+  /// returns, so everything kept is copied or decoded first.
+  void _dispatchEvent(ByteData message) {
+    if (message.lengthInBytes < 9) return;
+    final event = message.getUint8(0);
+    final id = message.getUint64(1, Endian.little);
+
+    final relay = _relays[id];
+    if (relay != null) {
+      switch (event) {
+        case _eventFrame:
+          // Platform messages own their buffer, so the frame is forwarded
+          // without copying.
+          relay._frames.add(
+            Uint8List.view(
+              message.buffer,
+              message.offsetInBytes + 9,
+              message.lengthInBytes - 9,
+            ),
+          );
+        case _eventComplete:
+        case _eventError:
+          // Failures reach the cloud side in the httpResponseEnd frame.
+          _relays.remove(id);
+          relay._frames.close();
+      }
+      return;
+    }
+
+    final job = _embeddings[id];
+    if (job != null) {
+      switch (event) {
+        case _eventEmbedProgress:
+          job._progress.add(
+            NativeEmbeddingProgress(
+              embedded: message.getUint32(9, Endian.little),
+              chunked: message.getUint32(13, Endian.little),
+            ),
+          );
+        case _eventEmbeddings:
+          job._complete(NativeEmbeddings._decode(message));
+        case _eventComplete:
+          _embeddings.remove(id);
+          job._progress.close();
+        case _eventError:
+          _embeddings.remove(id);
+          job._fail(NativeHttpException(_errorMessage(message)));
+      }
+      return;
+    }
+
+    final download = _downloads[id];
+    if (download != null) {
+      switch (event) {
+        case _eventDownloadProgress:
+          download._progress.add(NativeDownloadProgress._decode(message));
+        case _eventComplete:
+          _downloads.remove(id);
+          download._complete();
+        case _eventError:
+          _downloads.remove(id);
+          download._fail(NativeHttpException(_errorMessage(message)));
+      }
+      return;
+    }
+
+    final pending = _pending[id];
+    if (pending == null) return;
+
+    final payload = ByteData.view(
+      message.buffer,
+      message.offsetInBytes + 9,
+      message.lengthInBytes - 9,
+    );
+    switch (event) {
+      case _eventStarted:
+        pending.onStarted(payload);
+      case _eventBody:
+        pending.body.add(
+          Uint8List.fromList(
+            Uint8List.view(
+              payload.buffer,
+              payload.offsetInBytes,
+              payload.lengthInBytes,
+            ),
+          ),
+        );
+      case _eventBlocks:
+        // Comes just ahead of the batch it describes.
+        pending.blocks = MarkdownBlockUpdate.decode(payload);
+      case _eventTokens:
+        pending.tokens.add(
+          OllamaTokenBatch.decode(payload, blocks: pending.blocks),
+        );
+        pending.blocks = null;
+      case _eventComplete:
+        _pending.remove(id);
+        pending.close();
+      case _eventError:
+        _pending.remove(id);
+        pending.fail(NativeHttpException(_errorMessage(message)));
+    }
+  }
+
+  /// The string message of a kEventError event
+  static String _errorMessage(ByteData message) {
+    final length = message.getUint32(9, Endian.little);
+    return utf8.decode(
+      Uint8List.view(message.buffer, message.offsetInBytes + 13, length),
+      allowMalformed: true,
+    );
+  }
+
+  Future<ByteData?> _send(int op, int id, [Uint8List? payload]) {
+    final length = payload?.length ?? 0;
+    final message = Uint8List(9 + length);
+    final header = ByteData.view(message.buffer);
+    header.setUint8(0, op);
+    header.setUint64(1, id, Endian.little);
+    if (payload != null) {
+      message.setRange(9, 9 + length, payload);
+    }
+    return _binaryMessenger.send(channelName, ByteData.view(message.buffer));
+  }
+}
+
+/// Scheduling class of a relayed response; must match TunnelMux::Priority
+/// in native/
+enum TunnelStreamPriority {
+  /// Chats, generations and small metadata and health responses
+  interactive,
+  normal,
+
+  /// Model transfers, which may take minutes and yield to everything else
+  bulk;
+
+  static const _bulkPaths = ['/api/pull', '/api/push', '/api/create'];
+  static const _interactivePaths = [
+    '/api/chat',
+    '/api/generate',
+    '/api/tags',
+    '/api/version',
+    '/api/ps',
+    '/api/show',
+  ];
+
+  /// The class for an Ollama request to [path]
+  static TunnelStreamPriority forPath(String path) {
+    final route = Uri.parse(path).path;
+    if (route.startsWith('/api/blobs/') || _bulkPaths.contains(route)) {
+      return bulk;
+    }
+    if (route == '/' || _interactivePaths.contains(route)) {
+      return interactive;
+    }
+    return normal;
+  }
+}
+
+/// A response being relayed into tunnel frames by
+/// [NativeHttpClient.relayToTunnel]
+class NativeTunnelRelay {
+  final int _id;
+  final NativeHttpClient _client;
+  late final StreamController<Uint8List> _frames = StreamController(
+    onCancel: () => _client._cancel(_id),
+  );
+
+  NativeTunnelRelay._(this._id, this._client);
+
+  /// Sealed frames, ready to send on the WebSocket as they are; ends after
+  /// the httpResponseEnd frame. Cancelling the subscription aborts the
+  /// request.
+  Stream<Uint8List> get frames => _frames.stream;
+
+  /// Allow [frames] more chunk frames to be sent
+  void grantCredit(int frames) => _client._grantCredit(_id, frames);
+}
+
+/// An embedding job started by [NativeHttpClient.embedFiles]
+class NativeEmbeddingJob {
+  final int _id;
+  final NativeHttpClient _client;
+  final Completer<NativeEmbeddings> _result = Completer();
+  final StreamController<NativeEmbeddingProgress> _progress =
+      StreamController.broadcast();
+
+  NativeEmbeddingJob._(this._id, this._client);
+
+  /// Completes with every chunk's vector once all are embedded; fails with
+  /// [NativeHttpException] if a batch fails or the job is cancelled
+  Future<NativeEmbeddings> get result => _result.future;
+
+  /// Reported after each batch
+  Stream<NativeEmbeddingProgress> get progress => _progress.stream;
+
+  void cancel() {
+    _client._cancel(_id);
+    _fail(const NativeHttpException('Embedding cancelled'));
+  }
+
+  void _complete(NativeEmbeddings embeddings) {
+    if (!_result.isCompleted) _result.complete(embeddings);
+  }
+
+  void _fail(NativeHttpException error) {
+    if (!_result.isCompleted) _result.completeError(error);
+    _progress.close();
+  }
+}
+
+class NativeEmbeddingProgress {
+  /// Chunks whose vectors have arrived
+  final int embedded;
+
+  /// Chunks found so far; grows while files are still being read
+  final int chunked;
+
+  const NativeEmbeddingProgress({
+    required this.embedded,
+    required this.chunked,
+  });
+}
+
+/// Where an embedded chunk's text is: [length] bytes at byte [offset] of
+/// the [file]th path
+class NativeEmbeddedChunk {
+  final int file;
+  final int offset;
+  final int length;
+
+  const NativeEmbeddedChunk(this.file, this.offset, this.length);
+}
+
+/// The vectors of an embedding job, row i belonging to chunks[i]
+class NativeEmbeddings {
+  // Where the vectors start in kEventEmbeddings; matches
+  // HttpStreamService::kEmbeddingsOffset.
+  static const int _vectorsOffset = 20;
+
+  final int dimensions;
+  final List<NativeEmbeddedChunk> chunks;
+
+  /// All rows back to back, viewing the native result buffer
+  final Float32List vectors;
+
+  const NativeEmbeddings({
+    required this.dimensions,
+    required this.chunks,
+    required this.vectors,
+  });
+
+  Float32List vectorAt(int index) => Float32List.sublistView(
+    vectors,
+    index * dimensions,
+    (index + 1) * dimensions,
+  );
+
+  /// Decode a kEventEmbeddings event, which always arrives as a platform
+  /// message of its own and so may be viewed rather than copied
+  static NativeEmbeddings _decode(ByteData message) {
+    final dimensions = message.getUint32(9, Endian.little);
+    final count = message.getUint32(13, Endian.little);
+    final length = dimensions * count;
+    final start = message.offsetInBytes + _vectorsOffset;
+    // A view needs 4-byte alignment, which the channel does not promise.
+    final vectors = start % 4 == 0
+        ? message.buffer.asFloat32List(start, length)
+        : Uint8List.fromList(
+            message.buffer.asUint8List(start, length * 4),
+          ).buffer.asFloat32List();
+
+    var offset = _vectorsOffset + length * 4;
+    final chunks = List.generate(count, (_) {
+      final chunk = NativeEmbeddedChunk(
+        message.getUint32(offset, Endian.little),
+        message.getUint64(offset + 4, Endian.little),
+        message.getUint32(offset + 12, Endian.little),
+      );
+      offset += 16;
+      return chunk;
+    });
+    return NativeEmbeddings(
+      dimensions: dimensions,
+      chunks: chunks,
+      vectors: vectors,
+    );
+  }
+}
+
+/// A pull or file download started by [NativeHttpClient.pullModel] or
+/// [NativeHttpClient.fetchFile]
+class NativeDownloadJob {
+  final int _id;
+  final NativeHttpClient _client;
+  final Completer<void> _done = Completer();
+  final StreamController<NativeDownloadProgress> _progress =
+      StreamController.broadcast();
+
+  NativeDownloadJob._(this._id, this._client);
+
+  /// Completes once the model is pulled or the file is in place; fails with
+  /// [NativeHttpException] if the transfer fails or is cancelled
+  Future<void> get done => _done.future;
+
+  /// Coalesced progress, ending with a report of the final figures
+  Stream<NativeDownloadProgress> get progress => _progress.stream;
+
+  /// Stop the transfer; a file download keeps its partial data to resume
+  void cancel() {
+    _client._cancel(_id);
+    _fail(const NativeHttpException('Download cancelled'));
+  }
+
+  void _complete() {
+    if (!_done.isCompleted) _done.complete();
+    _progress.close();
+  }
+
+  void _fail(NativeHttpException error) {
+    if (!_done.isCompleted) _done.completeError(error);
+    _progress.close();
+  }
+}
+
+class NativeDownloadProgress {
+  /// Ollama's status for pulls ("pulling manifest", "verifying sha256
+  /// digest", ...); "downloading" for files
+  final String status;
+  final int completed;
+
+  /// Zero while unknown
+  final int total;
+  final int bytesPerSecond;
+
+  const NativeDownloadProgress({
+    required this.status,
+    required this.completed,
+    required this.total,
+    required this.bytesPerSecond,
+  });
+
+  /// Between 0 and 1, or null while the size is unknown
+  double? get fraction => total > 0 ? completed / total : null;
+
+  static NativeDownloadProgress _decode(ByteData message) {
+    final length = message.getUint32(33, Endian.little);
+    return NativeDownloadProgress(
+      completed: message.getUint64(9, Endian.little),
+      total: message.getUint64(17, Endian.little),
+      bytesPerSecond: message.getUint64(25, Endian.little),
+      status: utf8.decode(
+        Uint8List.view(message.buffer, message.offsetInBytes + 37, length),
+        allowMalformed: true,
+      ),
+    );
+  }
+}
+
+/// A response streamed by [NativeHttpClient]
+class NativeHttpResponse {
+  final int statusCode;
+
+  /// Response headers with lower-cased names
+  final Map<String, String> headers;
+
+  /// Raw body bytes; empty when the body is parsed as NDJSON
+  final Stream<Uint8List> body;
+
+  /// Natively parsed token batches for NDJSON requests with a 2xx status
+  final Stream<OllamaTokenBatch> tokens;
+
+  const NativeHttpResponse({
+    required this.statusCode,
+    required this.headers,
+    required this.body,
+    required this.tokens,
+  });
+}
+
+class NativeHttpException implements Exception {
+  final String message;
+
+  const NativeHttpException(this.message);
+
+  @override
+  String toString() => 'NativeHttpException: $message';
+}
+
+/// Builds request payloads in the layout HttpStreamService expects
+class _RequestWriter {
+  final BytesBuilder _builder = BytesBuilder(copy: false);
+
+  void u8(int value) => _builder.addByte(value);
+
+  void u16(int value) => _builder.add(
+    (ByteData(2)..setUint16(0, value, Endian.little)).buffer.asUint8List(),
+  );
+
+  void u32(int value) => _builder.add(
+    (ByteData(4)..setUint32(0, value, Endian.little)).buffer.asUint8List(),
+  );
+
+  void u64(int value) => _builder.add(
+    (ByteData(8)..setUint64(0, value, Endian.little)).buffer.asUint8List(),
+  );
+
+  void bytes(List<int> value) => _builder.add(value);
+
+  /// A wire string: u32 length, then the bytes as they are
+  void lengthPrefixed(List<int> value) {
+    u32(value.length);
+    _builder.add(value);
+  }
+
+  void string(String value) => lengthPrefixed(utf8.encode(value));
+
+  /// Method, host, port, path and headers, as at the start of kStart
+  void request(String method, Uri url, Map<String, String> headers) {
+    string(method);
+    string(url.host);
+    u16(url.port);
+    string(url.hasQuery ? '${url.path}?${url.query}' : url.path);
+    u16(headers.length);
+    headers.forEach((name, value) {
+      string(name);
+      string(value);
+    });
+  }
+
+  Uint8List takeBytes() => _builder.takeBytes();
+}
+
+class _PendingResponse {
+  final int id;
+  final NativeHttpClient client;
+  final bool parseNdjson;
+  final Completer<NativeHttpResponse> started = Completer();
+  late final StreamController<Uint8List> body = StreamController(
+    onCancel: _onCancel,
+  );
+  late final StreamController<OllamaTokenBatch> tokens = StreamController(
+    onCancel: _onCancel,
+  );
+  // The kEventBlocks for the next batch.
+  MarkdownBlockUpdate? blocks;
+
+  _PendingResponse(this.id, this.client, this.parseNdjson);
+
+  void _onCancel() => client._cancel(id);
+
+  void onStarted(ByteData payload) {
+    int offset = 0;
+    final statusCode = payload.getUint16(offset, Endian.little);
+    offset += 2;
+    final count = payload.getUint16(offset, Endian.little);
+    offset += 2;
+
+    String readString() {
+      final length = payload.getUint32(offset, Endian.little);
+      offset += 4;
+      final value = utf8.decode(
+        Uint8List.view(payload.buffer, payload.offsetInBytes + offset, length),
+        allowMalformed: true,
+      );
+      offset += length;
+      return value;
+    }
+
+    final headers = <String, String>{};
+    for (var i = 0; i < count; i++) {
+      final name = readString();
+      headers[name] = readString();
+    }
+
+    // Only one of the two streams is ever fed; close the other so callers
+    // that listen to it don't hang.
+    final ndjson = parseNdjson && statusCode >= 200 && statusCode < 300;
+    if (ndjson) {
+      body.close();
+    } else {
+      tokens.close();
+    }
+    started.complete(
+      NativeHttpResponse(
+        statusCode: statusCode,
+        headers: headers,
+        body: body.stream,
+        tokens: tokens.stream,
+      ),
+    );
+  }
+
+  void close() {
+    if (!body.isClosed) body.close();
+    if (!tokens.isClosed) tokens.close();
+  }
+
+  void fail(NativeHttpException error) {
+    if (!started.isCompleted) {
+      started.completeError(error);
+    } else {
+      if (!body.isClosed) body.addError(error);
+      if (!tokens.isClosed) tokens.addError(error);
+    }
+    close();
+  }
+}
@@ -0,0 +1,224 @@
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+
+/// How a reply reached the user; matches LatencyPath in native/
+enum LatencyPath {
+  local('local'),
+  tunnel('tunnel'),
+  cloud('cloud');
+
+  final String label;
+  const LatencyPath(this.label);
+}
+
+/// What was timed; matches LatencyKind in native/
+enum LatencyKind {
+  timeToFirstToken('ttft'),
+  interToken('inter_token'),
+  roundTrip('rtt'),
+
+  /// Model load time a warm-up took off the next first token
+  warmupSaved('warmup_saved');
+
+  final String label;
+  const LatencyKind(this.label);
+}
+
+/// Percentiles of one native latency histogram
+class LatencySummary {
+  final LatencyPath path;
+  final LatencyKind kind;
+  final int count;
+  final Duration p50;
+  final Duration p90;
+  final Duration p99;
+  final Duration max;
+
+  const LatencySummary({
+    required this.path,
+    required this.kind,
+    required this.count,
+    required this.p50,
+    required this.p90,
+    required this.p99,
+    required this.max,
+  });
+
+  /// "local.ttft" and so on, as exported by the cloud proxy's /metrics
+  String get name => '${path.label}.${kind.label}';
+}
+
+/// Heap allocations the native request path made for the requests it
+/// started, both counted since launch
+class RequestAllocations {
+  final int requests;
+  final int allocations;
+
+  const RequestAllocations({required this.requests, required this.allocations});
+
+  /// Near zero once the path's recycled buffers have warmed up
+  double get perRequest => requests == 0 ? 0 : allocations / requests;
+}
+
+/// Reads the native latency histograms and feeds them from Dart
+///
+/// The runner keeps HDR-style histograms (native/latency_histogram.h) of
+/// time to first token and inter-token latency for local Ollama streams and
+/// responses relayed over the tunnel, and of tunnel ping round trips, all
+/// recorded on the native paths themselves. Cloud streams are timed here
+/// with [startStream] and recorded into the same histograms. Where there is
+/// no runner (web, tests without a messenger) every call is a no-op.
+class NativeLatencyMetrics {
+  static const String channelName = 'cloudtolocalllm/latency_metrics';
+
+  // Request opcodes; must match LatencyMetricsService in native/.
+  static const int _opSummary = 1;
+  static const int _opBuckets = 2;
+  static const int _opRecord = 3;
+  static const int _opAllocations = 4;
+
+  final BinaryMessenger? _messenger;
+
+  // Bucket counts as of the last bucketDeltas(), by histogram name.
+  final Map<String, Map<int, int>> _reported = {};
+
+  NativeLatencyMetrics({BinaryMessenger? messenger}) : _messenger = messenger;
+
+  BinaryMessenger get _binaryMessenger =>
+      _messenger ?? ServicesBinding.instance.defaultBinaryMessenger;
+
+  /// Percentiles of every histogram with samples in it
+  Future<List<LatencySummary>> summaries() async {
+    final reply = await _send(Uint8List.fromList([_opSummary]));
+    if (reply == null) return const [];
+    final count = reply.getUint8(0);
+    if (reply.lengthInBytes != 1 + count * 42) return const [];
+    Duration micros(int offset) =>
+        Duration(microseconds: reply.getUint64(offset, Endian.little));
+    return [
+      for (var i = 0, offset = 1; i < count; i++, offset += 42)
+        LatencySummary(
+          path: LatencyPath.values[reply.getUint8(offset)],
+          kind: LatencyKind.values[reply.getUint8(offset + 1)],
+          count: reply.getUint64(offset + 2, Endian.little),
+          p50: micros(offset + 10),
+          p90: micros(offset + 18),
+          p99: micros(offset + 26),
+          max: micros(offset + 34),
+        ),
+    ];
+  }
+
+  /// Bucket counts added since the last call, as `[index, count]` pairs by
+  /// histogram name, for the cloud proxy to merge into its own
+  Future<Map<String, List<List<int>>>> bucketDeltas() async {
+    final reply = await _send(Uint8List.fromList([_opBuckets]));
+    if (reply == null) return const {};
+    final deltas = <String, List<List<int>>>{};
+    var offset = 1;
+    for (var i = 0; i < reply.getUint8(0); i++) {
+      final name =
+          '${LatencyPath.values[reply.getUint8(offset)].label}.'
+          '${LatencyKind.values[reply.getUint8(offset + 1)].label}';
+      final buckets = reply.getUint16(offset + 2, Endian.little);
+      offset += 4;
+      final reported = _reported.putIfAbsent(name, () => {});
+      final changed = <List<int>>[];
+      for (var b = 0; b < buckets; b++, offset += 10) {
+        final index = reply.getUint16(offset, Endian.little);
+        final count = reply.getUint64(offset + 2, Endian.little);
+        final previous = reported[index] ?? 0;
+        if (count > previous) changed.add([index, count - previous]);
+        reported[index] = count;
+      }
+      if (changed.isNotEmpty) deltas[name] = changed;
+    }
+    return deltas;
+  }
+
+  /// Records [micros] into the [path]/[kind] histogram
+  Future<void> record(
+    LatencyPath path,
+    LatencyKind kind,
+    List<int> micros,
+  ) async {
+    if (micros.isEmpty) return;
+    final request = ByteData(7 + 4 * micros.length)
+      ..setUint8(0, _opRecord)
+      ..setUint8(1, path.index)
+      ..setUint8(2, kind.index)
+      ..setUint32(3, micros.length, Endian.little);
+    for (var i = 0; i < micros.length; i++) {
+      request.setUint32(
+        7 + 4 * i,
+        micros[i].clamp(0, 0xFFFFFFFF),
+        Endian.little,
+      );
+    }
+    await _send(request.buffer.asUint8List());
+  }
+
+  /// How many heap allocations native requests have needed, or null
+  /// without a runner
+  Future<RequestAllocations?> allocations() async {
+    final reply = await _send(Uint8List.fromList([_opAllocations]));
+    if (reply == null || reply.lengthInBytes != 16) return null;
+    return RequestAllocations(
+      requests: reply.getUint64(0, Endian.little),
+      allocations: reply.getUint64(8, Endian.little),
+    );
+  }
+
+  /// Times a stream on [path]; call [LatencyStreamTimer.token] as tokens
+  /// arrive and [LatencyStreamTimer.finish] at the end
+  LatencyStreamTimer startStream(LatencyPath path) =>
+      LatencyStreamTimer._(this, path);
+
+  Future<ByteData?> _send(Uint8List request) async {
+    if (kIsWeb) return null;
+    try {
+      final reply = await _binaryMessenger.send(
+        channelName,
+        ByteData.sublistView(request),
+      );
+      if (reply == null || reply.lengthInBytes == 0) return null;
+      return reply;
+    } catch (e) {
+      debugPrint('⏱️ [LatencyMetrics] Native metrics unavailable: $e');
+      return null;
+    }
+  }
+}
+
+/// Collects one stream's timings, sent natively in one message at the end
+class LatencyStreamTimer {
+  final NativeLatencyMetrics _metrics;
+  final LatencyPath _path;
+  final Stopwatch _stopwatch = Stopwatch()..start();
+  final List<int> _gaps = [];
+  int? _firstToken;
+  int _lastToken = 0;
+
+  LatencyStreamTimer._(this._metrics, this._path);
+
+  /// A token (or a chunk of them) arrived
+  void token() {
+    final now = _stopwatch.elapsedMicroseconds;
+    if (_firstToken == null) {
+      _firstToken = now;
+    } else {
+      _gaps.add(now - _lastToken);
+    }
+    _lastToken = now;
+  }
+
+  Future<void> finish() async {
+    _stopwatch.stop();
+    final first = _firstToken;
+    if (first == null) return;
+    await _metrics.record(_path, LatencyKind.timeToFirstToken, [first]);
+    await _metrics.record(_path, LatencyKind.interToken, _gaps);
+  }
+}
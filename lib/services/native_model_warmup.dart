@@ -0,0 +1,159 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+
+import '../config/app_config.dart';
+
+/// What asked for a warm-up; matches WarmupTrigger in native/
+enum WarmupTrigger { launch, focus, tray, select }
+
+/// What came of asking; matches WarmupResult in native/
+enum WarmupResult {
+  started,
+  noModel,
+  inFlight,
+  coolingDown,
+  noRoom,
+  unavailable,
+}
+
+/// The runner's warm-up counters since launch
+class WarmupStats {
+  final int started;
+  final int completed;
+  final int failed;
+  final int skippedNoRoom;
+  final int skippedCoolingDown;
+
+  /// Model load time taken off first tokens, summed over the warm-ups
+  final Duration saved;
+
+  const WarmupStats({
+    required this.started,
+    required this.completed,
+    required this.failed,
+    required this.skippedNoRoom,
+    required this.skippedCoolingDown,
+    required this.saved,
+  });
+}
+
+/// Keeps the last-used model loaded in the local Ollama
+///
+/// On the desktop runners `cloudtolocalllm/model_warmup`
+/// (native/model_warmup.h) sends Ollama a prompt-less generate with a
+/// keep_alive for the model named by [setModel], so the first chat does not
+/// wait for the model to load. The runners warm it themselves when the
+/// window is activated; Dart asks at launch, when a model is picked and on
+/// tray clicks. A warm-up is skipped when the runner's resource monitor
+/// shows no room for the model. Where there is no runner (web, tests)
+/// nothing happens.
+class NativeModelWarmup {
+  static const String channelName = 'cloudtolocalllm/model_warmup';
+
+  // Request opcodes; must match ModelWarmupService in native/.
+  static const int _opSetModel = 1;
+  static const int _opWarm = 2;
+  static const int _opStats = 3;
+
+  final BinaryMessenger? _messenger;
+
+  NativeModelWarmup({BinaryMessenger? messenger}) : _messenger = messenger;
+
+  BinaryMessenger get _binaryMessenger =>
+      _messenger ?? ServicesBinding.instance.defaultBinaryMessenger;
+
+  /// Names the model to keep warm; [sizeBytes], its size on disk, is what
+  /// the room check looks for
+  Future<bool> setModel(
+    String model, {
+    String host = 'localhost',
+    int port = AppConfig.defaultOllamaPort,
+    int? sizeBytes,
+  }) async {
+    final reply = await _send(
+      _RequestWriter(_opSetModel)
+        ..string(host)
+        ..u16(port)
+        ..string(model)
+        ..u64(sizeBytes ?? 0),
+    );
+    return reply != null;
+  }
+
+  /// Asks for a warm-up; null where there is no runner
+  Future<WarmupResult?> warm(WarmupTrigger trigger) async {
+    final reply = await _send(_RequestWriter(_opWarm)..u8(trigger.index));
+    if (reply == null || reply.lengthInBytes != 1) return null;
+    final result = reply.getUint8(0);
+    return result < WarmupResult.values.length
+        ? WarmupResult.values[result]
+        : null;
+  }
+
+  Future<WarmupStats?> stats() async {
+    final reply = await _send(_RequestWriter(_opStats));
+    if (reply == null || reply.lengthInBytes != 48) return null;
+    int u64(int index) => reply.getUint64(index * 8, Endian.little);
+    return WarmupStats(
+      started: u64(0),
+      completed: u64(1),
+      failed: u64(2),
+      skippedNoRoom: u64(3),
+      skippedCoolingDown: u64(4),
+      saved: Duration(microseconds: u64(5)),
+    );
+  }
+
+  Future<ByteData?> _send(_RequestWriter request) async {
+    if (kIsWeb) return null;
+    try {
+      final reply = await _binaryMessenger.send(
+        channelName,
+        ByteData.sublistView(request.takeBytes()),
+      );
+      if (reply == null || reply.lengthInBytes == 0) return null;
+      return reply;
+    } catch (e) {
+      debugPrint('🔥 [ModelWarmup] Native warm-up unavailable: $e');
+      return null;
+    }
+  }
+}
+
+/// Request builder for the layouts in native/model_warmup_service.h
+class _RequestWriter {
+  final BytesBuilder _builder = BytesBuilder(copy: false);
+  final ByteData _scratch = ByteData(8);
+
+  _RequestWriter(int op) {
+    _builder.addByte(op);
+  }
+
+  void u8(int value) => _builder.addByte(value);
+
+  void u16(int value) {
+    _scratch.setUint16(0, value, Endian.little);
+    _builder.add(Uint8List.fromList(_scratch.buffer.asUint8List(0, 2)));
+  }
+
+  void u32(int value) {
+    _scratch.setUint32(0, value, Endian.little);
+    _builder.add(Uint8List.fromList(_scratch.buffer.asUint8List(0, 4)));
+  }
+
+  void u64(int value) {
+    _scratch.setUint64(0, value, Endian.little);
+    _builder.add(Uint8List.fromList(_scratch.buffer.asUint8List(0, 8)));
+  }
+
+  void string(String value) {
+    final bytes = utf8.encode(value);
+    u32(bytes.length);
+    _builder.add(bytes);
+  }
+
+  Uint8List takeBytes() => _builder.takeBytes();
+}
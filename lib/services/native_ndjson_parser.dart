@@ -0,0 +1,140 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+
+import '../models/ollama_token_batch.dart';
+
+/// Parses Ollama's NDJSON response streams into batches of token deltas
+///
+/// On the desktop runners the bytes are handed to the native parser over the
+/// `cloudtolocalllm/ndjson_parser` binary channel, so line splitting, JSON
+/// decoding and string unescaping happen off the UI isolate and each network
+/// chunk costs a single message hop regardless of how many tokens it holds.
+/// Where the channel is not registered (web, mobile, tests) the same batches
+/// are produced in Dart with `utf8.decoder` and `LineSplitter`.
+class NativeNdjsonParser {
+  static const String channelName = 'cloudtolocalllm/ndjson_parser';
+
+  // Request opcodes; must match NdjsonParserService in native/.
+  static const int _opOpen = 1;
+  static const int _opFeed = 2;
+  static const int _opFinish = 3;
+  static const int _opClose = 4;
+
+  static int _nextStreamId = 1;
+
+  final BinaryMessenger? _messenger;
+
+  /// Whether the native channel answered; null until the first stream.
+  bool? _nativeAvailable;
+
+  NativeNdjsonParser({BinaryMessenger? messenger}) : _messenger = messenger;
+
+  BinaryMessenger get _binaryMessenger =>
+      _messenger ?? ServicesBinding.instance.defaultBinaryMessenger;
+
+  /// Whether the last stream was parsed natively
+  bool get isNativeAvailable => _nativeAvailable ?? false;
+
+  /// Parse [body] (raw response bytes) into token batches
+  ///
+  /// Empty batches are never emitted. The stream ends after the batch that
+  /// carries `done`, or when [body] ends.
+  Stream<OllamaTokenBatch> parse(Stream<List<int>> body) async* {
+    if (kIsWeb || _nativeAvailable == false) {
+      yield* parseInDart(body);
+      return;
+    }
+
+    final streamId = _nextStreamId++;
+    final opened = await _send(_opOpen, streamId);
+    if (opened == null) {
+      _nativeAvailable = false;
+      debugPrint(
+        '🦙 [NdjsonParser] Native parser unavailable, using Dart fallback',
+      );
+      yield* parseInDart(body);
+      return;
+    }
+    _nativeAvailable = true;
+
+    var finished = false;
+    try {
+      await for (final chunk in body) {
+        final reply = await _send(_opFeed, streamId, chunk);
+        if (reply == null || reply.lengthInBytes == 0) {
+          throw StateError('Native parser dropped stream $streamId');
+        }
+        final batch = OllamaTokenBatch.decode(reply);
+        if (!batch.isEmpty) {
+          yield batch;
+        }
+        if (batch.done) {
+          return;
+        }
+      }
+      finished = true;
+      final reply = await _send(_opFinish, streamId);
+      if (reply != null && reply.lengthInBytes > 0) {
+        final batch = OllamaTokenBatch.decode(reply);
+        if (!batch.isEmpty) {
+          yield batch;
+        }
+      }
+    } finally {
+      if (!finished) {
+        await _send(_opClose, streamId);
+      }
+    }
+  }
+
+  /// Pure-Dart equivalent of the native parser, one batch per line
+  static Stream<OllamaTokenBatch> parseInDart(Stream<List<int>> body) async* {
+    await for (final line
+        in body.transform(utf8.decoder).transform(const LineSplitter())) {
+      if (line.trim().isEmpty) continue;
+
+      final Map<String, dynamic> data;
+      try {
+        data = json.decode(line) as Map<String, dynamic>;
+      } catch (e) {
+        debugPrint('🦙 [NdjsonParser] Error parsing line: $e');
+        continue;
+      }
+
+      final message = data['message'];
+      final content = message is Map
+          ? message['content'] as String?
+          : data['response'] as String?;
+      final done = data['done'] == true;
+      final batch = OllamaTokenBatch(
+        text: content ?? '',
+        tokenCount: (content?.isNotEmpty ?? false) ? 1 : 0,
+        done: done,
+        error: data['error'] as String?,
+        stats: done ? OllamaDoneStats.fromJson(data) : null,
+      );
+      if (!batch.isEmpty) {
+        yield batch;
+      }
+      if (done) {
+        return;
+      }
+    }
+  }
+
+  Future<ByteData?> _send(int op, int streamId, [List<int>? payload]) {
+    final length = payload?.length ?? 0;
+    final message = Uint8List(5 + length);
+    final header = ByteData.view(message.buffer);
+    header.setUint8(0, op);
+    header.setUint32(1, streamId, Endian.little);
+    if (payload != null) {
+      message.setRange(5, 5 + length, payload);
+    }
+    return _binaryMessenger.send(channelName, ByteData.view(message.buffer));
+  }
+}
@@ -0,0 +1,214 @@
+import 'dart:async';
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+
+/// Where a snapshot's GPU figures came from; matches GpuSource in native/
+enum GpuSource { none, nvml, sysfs, dxgi }
+
+/// One sample of the host's headroom, as taken by the runner
+class ResourceSnapshot {
+  /// Bytes per sample in native/resource_monitor_service.h
+  static const int encodedSize = 53;
+
+  static const int _unknownLoad = 0xFFFF;
+
+  final DateTime timestamp;
+
+  /// Share of all cores busy, in [0, 1]
+  final double cpuLoad;
+
+  /// The busiest GPU's utilization in [0, 1], or null if unknown
+  final double? gpuLoad;
+
+  /// Resident memory of this app
+  final int processRss;
+  final int memoryTotal;
+  final int memoryAvailable;
+
+  /// Dedicated memory summed over all GPUs, or zero if unknown
+  final int gpuMemoryTotal;
+
+  /// Zero where only the total is known (see [gpuMemoryFree])
+  final int gpuMemoryUsed;
+  final GpuSource gpuSource;
+
+  const ResourceSnapshot({
+    required this.timestamp,
+    required this.cpuLoad,
+    this.gpuLoad,
+    this.processRss = 0,
+    this.memoryTotal = 0,
+    this.memoryAvailable = 0,
+    this.gpuMemoryTotal = 0,
+    this.gpuMemoryUsed = 0,
+    this.gpuSource = GpuSource.none,
+  });
+
+  factory ResourceSnapshot.decode(ByteData data, int offset) {
+    int u64(int at) => data.getUint64(offset + at, Endian.little);
+    double? load(int at) {
+      final value = data.getUint16(offset + at, Endian.little);
+      return value == _unknownLoad ? null : value / 10000;
+    }
+
+    final source = data.getUint8(offset + 52);
+    return ResourceSnapshot(
+      timestamp: DateTime.fromMillisecondsSinceEpoch(
+        data.getInt64(offset, Endian.little),
+      ),
+      cpuLoad: load(8) ?? 0,
+      gpuLoad: load(10),
+      processRss: u64(12),
+      memoryTotal: u64(20),
+      memoryAvailable: u64(28),
+      gpuMemoryTotal: u64(36),
+      gpuMemoryUsed: u64(44),
+      gpuSource: source < GpuSource.values.length
+          ? GpuSource.values[source]
+          : GpuSource.none,
+    );
+  }
+
+  /// Free GPU memory, or null where usage is not reported (DXGI gives the
+  /// total only)
+  int? get gpuMemoryFree =>
+      gpuSource == GpuSource.nvml || gpuSource == GpuSource.sysfs
+      ? gpuMemoryTotal - gpuMemoryUsed
+      : null;
+
+  /// Whether a local model would be competing for the host: cores pinned,
+  /// RAM nearly gone, or the GPU both busy and out of memory
+  bool get saturated {
+    if (cpuLoad >= 0.9) return true;
+    if (memoryTotal > 0 && memoryAvailable < memoryTotal * 0.05) return true;
+    final free = gpuMemoryFree;
+    return gpuLoad != null &&
+        gpuLoad! >= 0.95 &&
+        free != null &&
+        free < gpuMemoryTotal * 0.05;
+  }
+}
+
+/// Reads the host's CPU, memory and GPU headroom
+///
+/// On the desktop runners a native sampler behind
+/// `cloudtolocalllm/resource_monitor` (native/resource_monitor.h) records a
+/// sample every second on its own thread, with GPU memory from NVML, amdgpu's
+/// sysfs files or DXGI. Reading one is a copy out of its ring buffer, so
+/// [start] can poll it cheaply and [hostConstrained] answers from the last
+/// few polls without a round trip. Where there is no sampler (web, tests)
+/// nothing is ever constrained.
+class NativeResourceMonitor {
+  static const String channelName = 'cloudtolocalllm/resource_monitor';
+
+  // Request opcodes; must match ResourceMonitorService in native/.
+  static const int _opLatest = 1;
+  static const int _opHistory = 2;
+  static const int _opSetInterval = 3;
+
+  /// Consecutive saturated polls before [hostConstrained] reports it, so a
+  /// momentary spike does not move a conversation
+  static const int constrainedPolls = 3;
+
+  final BinaryMessenger? _messenger;
+
+  // The newest polls, oldest first.
+  final List<ResourceSnapshot> _recent = [];
+  Timer? _timer;
+
+  NativeResourceMonitor({BinaryMessenger? messenger}) : _messenger = messenger;
+
+  BinaryMessenger get _binaryMessenger =>
+      _messenger ?? ServicesBinding.instance.defaultBinaryMessenger;
+
+  /// The newest polled snapshot, if any
+  ResourceSnapshot? get latest => _recent.isEmpty ? null : _recent.last;
+
+  /// Whether the last [constrainedPolls] polls all found the host saturated
+  bool get hostConstrained =>
+      _recent.length >= constrainedPolls && _recent.every((s) => s.saturated);
+
+  /// Polls every [interval] until [stop]
+  void start({Duration interval = const Duration(seconds: 2)}) {
+    if (kIsWeb || _timer != null) return;
+    _timer = Timer.periodic(interval, (_) => refresh());
+    unawaited(refresh());
+  }
+
+  void stop() {
+    _timer?.cancel();
+    _timer = null;
+  }
+
+  /// Fetches the newest sample and records it for [hostConstrained]
+  Future<ResourceSnapshot?> refresh() async {
+    final reply = await _send(_RequestWriter(_opLatest));
+    if (reply == null || reply.lengthInBytes < ResourceSnapshot.encodedSize) {
+      return null;
+    }
+    final snapshot = ResourceSnapshot.decode(reply, 0);
+    // The sampler may not have moved on since the last poll.
+    if (_recent.isEmpty || _recent.last.timestamp != snapshot.timestamp) {
+      _recent.add(snapshot);
+      if (_recent.length > constrainedPolls) _recent.removeAt(0);
+    }
+    return snapshot;
+  }
+
+  /// Up to [count] of the newest samples, oldest first
+  Future<List<ResourceSnapshot>> history(int count) async {
+    final reply = await _send(_RequestWriter(_opHistory)..u32(count));
+    if (reply == null || reply.lengthInBytes < 4) return const [];
+    final available = reply.getUint32(0, Endian.little);
+    if (reply.lengthInBytes < 4 + available * ResourceSnapshot.encodedSize) {
+      return const [];
+    }
+    return [
+      for (var i = 0; i < available; i++)
+        ResourceSnapshot.decode(reply, 4 + i * ResourceSnapshot.encodedSize),
+    ];
+  }
+
+  /// Changes how often the runner samples (no faster than every 100 ms)
+  Future<bool> setInterval(Duration interval) async {
+    final reply = await _send(
+      _RequestWriter(_opSetInterval)..u32(interval.inMilliseconds),
+    );
+    return reply != null;
+  }
+
+  Future<ByteData?> _send(_RequestWriter request) async {
+    if (kIsWeb) return null;
+    try {
+      final reply = await _binaryMessenger.send(
+        channelName,
+        ByteData.sublistView(request.takeBytes()),
+      );
+      if (reply == null || reply.lengthInBytes == 0) return null;
+      return reply;
+    } catch (e) {
+      debugPrint('📊 [ResourceMonitor] Native sampler unavailable: $e');
+      stop();
+      return null;
+    }
+  }
+}
+
+/// Request builder for the layouts in native/resource_monitor_service.h
+class _RequestWriter {
+  final BytesBuilder _builder = BytesBuilder(copy: false);
+  final ByteData _scratch = ByteData(4);
+
+  _RequestWriter(int op) {
+    _builder.addByte(op);
+  }
+
+  void u32(int value) {
+    _scratch.setUint32(0, value, Endian.little);
+    _builder.add(Uint8List.fromList(_scratch.buffer.asUint8List()));
+  }
+
+  Uint8List takeBytes() => _builder.takeBytes();
+}
@@ -0,0 +1,256 @@
+import 'dart:convert';
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+
+/// Counts prompt tokens and trims chat history to fit a model's context
+///
+/// On the desktop runners the count comes from the native counter on
+/// `cloudtolocalllm/token_counter` (native/token_counter.h), which maps the
+/// model's GGUF file from the local Ollama store and runs its BPE or
+/// SentencePiece vocabulary over the text. Counters are loaded once per
+/// model name and cached by the runner. Where there is no native counter or
+/// no local model file (web, a remote Ollama), tokens are estimated at four
+/// UTF-8 bytes each.
+class NativeTokenCounter {
+  static const String channelName = 'cloudtolocalllm/token_counter';
+
+  // Request opcodes; must match TokenCounterService in native/.
+  static const int _opLoad = 1;
+  static const int _opCount = 2;
+
+  /// Ollama's context window unless a model is run with a larger num_ctx
+  static const int defaultContextTokens = 4096;
+
+  /// Chat template tokens around each message (role markers, separators)
+  static const int messageOverheadTokens = 4;
+
+  final BinaryMessenger? _messenger;
+  final String? _modelsDirectory;
+
+  // Context length per model from its GGUF file, or null when it is counted
+  // by estimate.
+  final Map<String, Future<int?>> _prepared = {};
+  // How many of the oldest messages fitHistory() dropped, per conversation.
+  final Map<String, int> _dropped = {};
+
+  NativeTokenCounter({BinaryMessenger? messenger, String? modelsDirectory})
+    : _messenger = messenger,
+      _modelsDirectory = modelsDirectory;
+
+  BinaryMessenger get _binaryMessenger =>
+      _messenger ?? ServicesBinding.instance.defaultBinaryMessenger;
+
+  /// Rough count for text with no tokenizer at hand
+  static int estimate(String text) => (utf8.encode(text).length + 3) ~/ 4;
+
+  /// Loads [model]'s tokenizer if it has not been; returns its context
+  /// length, or null if its tokens will be estimated
+  Future<int?> prepare(String model) =>
+      _prepared.putIfAbsent(model, () => _load(model));
+
+  /// Token count of each of [texts] as [model] would see it
+  Future<List<int>> count(String model, List<String> texts) async {
+    if (await prepare(model) != null) {
+      final request = _RequestWriter(_opCount)
+        ..string(model)
+        ..u32(texts.length);
+      for (final text in texts) {
+        request.string(text);
+      }
+      final reply = await _send(request);
+      if (reply != null && reply.lengthInBytes == 4 + 4 * texts.length) {
+        return [
+          for (var i = 0; i < texts.length; i++)
+            reply.getUint32(4 + 4 * i, Endian.little),
+        ];
+      }
+    }
+    return [for (final text in texts) estimate(text)];
+  }
+
+  /// The newest part of [history] that fits in [model]'s context together
+  /// with [prompt], leaving [responseTokens] for the reply
+  ///
+  /// Messages are dropped whole, oldest first. [contextTokens] defaults to
+  /// the smaller of the model's trained context and [defaultContextTokens].
+  ///
+  /// With a [conversationId] the kept history starts where it did on the
+  /// last call for that conversation as long as it fits, and when it no
+  /// longer does only half the room is filled. Each trim then moves the
+  /// start once for several turns instead of on every turn, which keeps the
+  /// prompt prefix Ollama has cached intact in between.
+  Future<List<Map<String, String>>> fitHistory({
+    required String model,
+    required List<Map<String, String>> history,
+    required String prompt,
+    String? conversationId,
+    int? contextTokens,
+    int responseTokens = 1024,
+  }) async {
+    // A start past the end means the history shrank; begin again.
+    var start = conversationId != null ? _dropped[conversationId] ?? 0 : 0;
+    if (start >= history.length) start = 0;
+    final candidate = start == 0 ? history : history.sublist(start);
+    if (candidate.isEmpty) return candidate;
+
+    final trained = await prepare(model);
+    final context =
+        contextTokens ??
+        (trained != null && trained > 0 && trained < defaultContextTokens
+            ? trained
+            : defaultContextTokens);
+
+    final counts = await count(model, [
+      prompt,
+      for (final message in candidate) message['content'] ?? '',
+    ]);
+    final room = context - responseTokens - counts[0] - messageOverheadTokens;
+    int fitting(int available) {
+      var keep = 0;
+      for (var i = candidate.length - 1; i >= 0; i--) {
+        available -= counts[i + 1] + messageOverheadTokens;
+        if (available < 0) break;
+        keep++;
+      }
+      return keep;
+    }
+
+    var keep = fitting(room);
+    if (keep < candidate.length && conversationId != null) {
+      keep = fitting(room ~/ 2);
+    }
+    final dropped = history.length - keep;
+    if (conversationId != null) _dropped[conversationId] = dropped;
+    if (keep == candidate.length) return candidate;
+
+    debugPrint(
+      '🧮 [TokenCounter] Dropped $dropped oldest messages '
+      'to fit $context tokens for $model',
+    );
+    return candidate.sublist(candidate.length - keep);
+  }
+
+  Future<int?> _load(String model) async {
+    if (kIsWeb) return null;
+    try {
+      final path = await findModelFile(model, _modelsDirectories());
+      if (path == null) return null;
+      final reply = await _send(
+        _RequestWriter(_opLoad)
+          ..string(model)
+          ..string(path),
+      );
+      if (reply == null || reply.lengthInBytes != 8) return null;
+      final contextLength = reply.getUint64(0, Endian.little);
+      debugPrint(
+        '🧮 [TokenCounter] Loaded $model tokenizer '
+        '(context $contextLength)',
+      );
+      return contextLength;
+    } catch (e) {
+      debugPrint('🧮 [TokenCounter] Estimating tokens for $model: $e');
+      return null;
+    }
+  }
+
+  /// Size of [model]'s GGUF file in the local Ollama store, or null if it
+  /// is not there
+  Future<int?> modelFileSize(String model) async {
+    if (kIsWeb) return null;
+    try {
+      final path = await findModelFile(model, _modelsDirectories());
+      return path == null ? null : await File(path).length();
+    } catch (e) {
+      return null;
+    }
+  }
+
+  List<String> _modelsDirectories() {
+    final configured =
+        _modelsDirectory ?? Platform.environment['OLLAMA_MODELS'];
+    if (configured != null && configured.isNotEmpty) return [configured];
+    final home =
+        Platform.environment['HOME'] ?? Platform.environment['USERPROFILE'];
+    return [
+      if (home != null) '$home/.ollama/models',
+      // Where the Linux install script's service keeps them.
+      if (Platform.isLinux) '/usr/share/ollama/.ollama/models',
+    ];
+  }
+
+  /// The GGUF blob of [model] under the first of [directories] with an
+  /// Ollama manifest for it, or null
+  ///
+  /// "llama3" is registry.ollama.ai/library/llama3:latest.
+  static Future<String?> findModelFile(
+    String model,
+    List<String> directories,
+  ) async {
+    var name = model;
+    var tag = 'latest';
+    final colon = name.lastIndexOf(':');
+    if (colon > name.lastIndexOf('/')) {
+      tag = name.substring(colon + 1);
+      name = name.substring(0, colon);
+    }
+    final parts = name.split('/');
+    final host = parts.length >= 3
+        ? parts[parts.length - 3]
+        : 'registry.ollama.ai';
+    final namespace = parts.length >= 2 ? parts[parts.length - 2] : 'library';
+
+    for (final directory in directories) {
+      final manifest = File(
+        '$directory/manifests/$host/$namespace/${parts.last}/$tag',
+      );
+      if (!await manifest.exists()) continue;
+      final layers =
+          (json.decode(await manifest.readAsString())
+                  as Map<String, dynamic>)['layers']
+              as List?;
+      for (final layer in layers ?? const []) {
+        if (layer is Map &&
+            layer['mediaType'] == 'application/vnd.ollama.image.model') {
+          final digest = (layer['digest'] as String).replaceFirst(':', '-');
+          return '$directory/blobs/$digest';
+        }
+      }
+    }
+    return null;
+  }
+
+  Future<ByteData?> _send(_RequestWriter request) async {
+    final reply = await _binaryMessenger.send(
+      channelName,
+      ByteData.sublistView(request.takeBytes()),
+    );
+    if (reply == null || reply.lengthInBytes == 0) return null;
+    return reply;
+  }
+}
+
+/// Request builder for the layouts in native/token_counter_service.h
+class _RequestWriter {
+  final BytesBuilder _builder = BytesBuilder(copy: false);
+  final ByteData _scratch = ByteData(4);
+
+  _RequestWriter(int op) {
+    _builder.addByte(op);
+  }
+
+  void u32(int value) {
+    _scratch.setUint32(0, value, Endian.little);
+    _builder.add(Uint8List.fromList(_scratch.buffer.asUint8List()));
+  }
+
+  void string(String value) {
+    final bytes = utf8.encode(value);
+    u32(bytes.length);
+    _builder.add(bytes);
+  }
+
+  Uint8List takeBytes() => _builder.takeBytes();
+}
@@ -4,6 +4,8 @@ import 'package:flutter/foundation.dart';
 import 'package:tray_manager/tray_manager.dart';
 import 'connection_manager_service.dart';
 import 'local_ollama_connection_service.dart';
+import 'native_latency_metrics.dart';
+import 'native_model_warmup.dart';
 import 'tunnel_manager_service.dart';
 import 'streaming_service.dart';
 
@@ -22,6 +24,9 @@ class NativeTrayService with TrayListener {
   LocalOllamaConnectionService? _localOllama;
   TunnelManagerService? _tunnelManager;
   StreamSubscription<ConnectionStatusEvent>? _statusSubscription;
+  final NativeLatencyMetrics _latencyMetrics = NativeLatencyMetrics();
+  final NativeModelWarmup _modelWarmup = NativeModelWarmup();
+  Timer? _latencyRefreshTimer;
 
   // Callbacks for tray events
   void Function()? _onShowWindow;
@@ -122,6 +127,12 @@ class NativeTrayService with TrayListener {
         '🖥️ [NativeTray] Native tray service initialized successfully',
       );
 
+      // Keep the latency lines in the menu current between status changes
+      _latencyRefreshTimer = Timer.periodic(
+        const Duration(seconds: 30),
+        (_) => _updateContextMenu(),
+      );
+
       // Update initial status
       _onTunnelStatusChanged();
 
@@ -272,6 +283,8 @@ class NativeTrayService with TrayListener {
         cloudStatus = 'Connecting...';
       }
 
+      final latency = await _latencyLabels();
+
       final menu = Menu(
         items: [
           MenuItem(key: 'show', label: 'Show CloudToLocalLLM'),
@@ -279,6 +292,8 @@ class NativeTrayService with TrayListener {
           MenuItem.separator(),
           MenuItem(key: 'local_status', label: 'Local Ollama: $localStatus'),
           MenuItem(key: 'cloud_status', label: 'Cloud Proxy: $cloudStatus'),
+          if (latency.isNotEmpty) MenuItem.separator(),
+          for (final label in latency) MenuItem(label: label, disabled: true),
           MenuItem.separator(),
           MenuItem(key: 'settings', label: 'Settings'),
           MenuItem(key: 'reconnect', label: 'Reconnect All'),
@@ -293,6 +308,38 @@ class NativeTrayService with TrayListener {
     }
   }
 
+  /// p50/p99 lines for the menu from the native latency histograms, one per
+  /// path with samples
+  Future<List<String>> _latencyLabels() async {
+    final summaries = await _latencyMetrics.summaries();
+    String ms(Duration d) => d.inMicroseconds < 10000
+        ? '${(d.inMicroseconds / 1000).toStringAsFixed(1)} ms'
+        : '${d.inMilliseconds} ms';
+    String? describe(LatencyPath path, String title) {
+      final parts = <String>[];
+      for (final summary in summaries.where((s) => s.path == path)) {
+        final what = switch (summary.kind) {
+          LatencyKind.timeToFirstToken => 'first token',
+          LatencyKind.interToken => 'per token',
+          LatencyKind.roundTrip => 'round trip',
+          LatencyKind.warmupSaved => 'warm-up saved',
+        };
+        parts.add('$what ${ms(summary.p50)} (p99 ${ms(summary.p99)})');
+      }
+      return parts.isEmpty ? null : '$title: ${parts.join(', ')}';
+    }
+
+    final allocations = await _latencyMetrics.allocations();
+    return [
+      describe(LatencyPath.local, 'Local'),
+      describe(LatencyPath.tunnel, 'Tunnel'),
+      describe(LatencyPath.cloud, 'Cloud'),
+      if (allocations != null && allocations.requests > 0)
+        'Allocations: ${allocations.perRequest.toStringAsFixed(2)} per '
+            'request (${allocations.requests} requests)',
+    ].whereType<String>().toList();
+  }
+
   /// Dispose of the tray service
   Future<void> dispose() async {
     if (!_isInitialized) return;
@@ -306,6 +353,8 @@ class NativeTrayService with TrayListener {
       _localOllama?.removeListener(_onTunnelStatusChanged);
       _tunnelManager?.removeListener(_onTunnelStatusChanged);
       _statusSubscription?.cancel();
+      _latencyRefreshTimer?.cancel();
+      _latencyRefreshTimer = null;
 
       // Destroy tray
       await trayManager.destroy();
@@ -322,6 +371,8 @@ class NativeTrayService with TrayListener {
   @override
   void onTrayIconMouseDown() {
     debugPrint('🖥️ [NativeTray] Tray icon clicked');
+    // The window is coming back for a chat; have the model loaded by then.
+    unawaited(_modelWarmup.warm(WarmupTrigger.tray));
     _onShowWindow?.call();
   }
 
@@ -337,6 +388,7 @@ class NativeTrayService with TrayListener {
 
     switch (menuItem.key) {
       case 'show':
+        unawaited(_modelWarmup.warm(WarmupTrigger.tray));
         _onShowWindow?.call();
         break;
       case 'hide':
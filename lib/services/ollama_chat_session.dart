@@ -0,0 +1,192 @@
+import 'dart:convert';
+
+import 'package:flutter/foundation.dart';
+
+import '../models/ollama_token_batch.dart';
+
+/// Prompt-prefix reuse counters, for one conversation or all of them
+@immutable
+class PromptPrefixStats {
+  /// Requests sent
+  final int turns;
+
+  /// Requests whose messages began with everything the previous request to
+  /// the same model sent and got back, so Ollama could reuse its KV cache
+  final int prefixHits;
+
+  /// Length of the serialized messages sent, and how much of it was such a
+  /// prefix
+  final int promptLength;
+  final int reusedLength;
+
+  /// Prompt tokens Ollama reported evaluating, and the time it took
+  final int promptEvalTokens;
+  final Duration promptEvalDuration;
+
+  const PromptPrefixStats({
+    this.turns = 0,
+    this.prefixHits = 0,
+    this.promptLength = 0,
+    this.reusedLength = 0,
+    this.promptEvalTokens = 0,
+    this.promptEvalDuration = Duration.zero,
+  });
+
+  double get hitRate => turns == 0 ? 0 : prefixHits / turns;
+  double get reuseRatio => promptLength == 0 ? 0 : reusedLength / promptLength;
+
+  PromptPrefixStats operator +(PromptPrefixStats other) => PromptPrefixStats(
+    turns: turns + other.turns,
+    prefixHits: prefixHits + other.prefixHits,
+    promptLength: promptLength + other.promptLength,
+    reusedLength: reusedLength + other.reusedLength,
+    promptEvalTokens: promptEvalTokens + other.promptEvalTokens,
+    promptEvalDuration: promptEvalDuration + other.promptEvalDuration,
+  );
+
+  @override
+  String toString() =>
+      'PromptPrefixStats(turns: $turns, prefixHits: $prefixHits, '
+      'reuseRatio: ${reuseRatio.toStringAsFixed(2)}, '
+      'promptEvalTokens: $promptEvalTokens)';
+}
+
+/// Builds `/api/chat` requests so Ollama can keep reusing its prompt cache
+///
+/// Ollama skips evaluating the part of a prompt that matches what its
+/// runner last processed, but only if the new prompt starts with exactly
+/// those tokens and the model is still loaded. Per conversation this keeps
+/// what was sent and received last turn and:
+///
+///  * serializes messages as role and content only, in a fixed order and
+///    without the prompt repeated at the end of the history, so a new turn
+///    only ever appends to the previous one;
+///  * sends no per-request options, which would reload the model;
+///  * pins the model with `keep_alive` so the cache outlives pauses between
+///    turns.
+///
+/// Whether each request extended the previous one to the same model, how
+/// much of it was reused and what Ollama reported evaluating are counted
+/// in [stats] and [statsFor]. The history itself should be trimmed with a
+/// stable start (see NativeTokenCounter.fitHistory) or every trim is a
+/// miss.
+class OllamaChatSessions {
+  /// How long Ollama keeps the model loaded after each request
+  final Duration keepAlive;
+
+  final Map<String, _ChatSession> _sessions = {};
+  // Conversation each model last served; the runner's cache holds that one.
+  final Map<String, String> _lastConversation = {};
+
+  OllamaChatSessions({this.keepAlive = const Duration(minutes: 30)});
+
+  /// Counters over every conversation
+  PromptPrefixStats get stats => _sessions.values.fold(
+    const PromptPrefixStats(),
+    (total, session) => total + session.stats,
+  );
+
+  PromptPrefixStats? statsFor(String conversationId) =>
+      _sessions[conversationId]?.stats;
+
+  /// The request body for [prompt] after [history]
+  String buildRequest({
+    required String conversationId,
+    required String model,
+    required List<Map<String, String>> history,
+    required String prompt,
+  }) {
+    // The history may already end with the prompt; sending it twice would
+    // also put a message in the cached prefix that the next turn lacks.
+    var previousTurns = history;
+    if (history.isNotEmpty &&
+        history.last['role'] == 'user' &&
+        history.last['content'] == prompt) {
+      previousTurns = history.sublist(0, history.length - 1);
+    }
+    final messages = [
+      for (final message in previousTurns)
+        _encodeMessage(message['role'] ?? 'user', message['content'] ?? ''),
+      _encodeMessage('user', prompt),
+    ];
+
+    final session = _sessions.putIfAbsent(conversationId, _ChatSession.new);
+    final previous = _lastConversation[model] == conversationId
+        ? session.sent
+        : const <String>[];
+    var shared = 0;
+    var reusedLength = 0;
+    while (shared < previous.length &&
+        shared < messages.length &&
+        previous[shared] == messages[shared]) {
+      reusedLength += messages[shared].length;
+      shared++;
+    }
+    final hit = previous.isNotEmpty && shared == previous.length;
+    final promptLength = messages.fold<int>(0, (sum, m) => sum + m.length);
+
+    session
+      ..sent = messages
+      ..stats = session.stats + PromptPrefixStats(
+        turns: 1,
+        prefixHits: hit ? 1 : 0,
+        promptLength: promptLength,
+        reusedLength: reusedLength,
+      );
+    _lastConversation[model] = conversationId;
+
+    if (previous.isNotEmpty && !hit) {
+      debugPrint(
+        '🦙 [OllamaSession] Prompt prefix changed at message $shared of '
+        '${previous.length} for $conversationId',
+      );
+    }
+
+    // Key order is fixed, and messages go last so the rest of the body
+    // never differs between turns.
+    return '{"model":${json.encode(model)},'
+        '"stream":true,'
+        '"keep_alive":"${keepAlive.inSeconds}s",'
+        '"messages":[${messages.join(',')}]}';
+  }
+
+  /// Records the reply streamed for the last request on [conversationId]
+  ///
+  /// The next turn's history then starts with it. An empty [reply] (a failed
+  /// or cancelled request) leaves the cache state unknown, so the next turn
+  /// is not expected to hit.
+  void recordReply(
+    String conversationId,
+    String reply, {
+    OllamaDoneStats? doneStats,
+  }) {
+    final session = _sessions[conversationId];
+    if (session == null) return;
+    if (reply.isEmpty) {
+      session.sent = const [];
+      return;
+    }
+    session.sent = [...session.sent, _encodeMessage('assistant', reply)];
+    if (doneStats != null) {
+      session.stats = session.stats + PromptPrefixStats(
+        promptEvalTokens: doneStats.promptEvalCount,
+        promptEvalDuration: doneStats.promptEvalDuration,
+      );
+      debugPrint(
+        '🦙 [OllamaSession] $conversationId: evaluated '
+        '${doneStats.promptEvalCount} prompt tokens in '
+        '${doneStats.promptEvalDuration.inMilliseconds}ms '
+        '(${session.stats})',
+      );
+    }
+  }
+
+  static String _encodeMessage(String role, String content) =>
+      '{"role":${json.encode(role)},"content":${json.encode(content)}}';
+}
+
+class _ChatSession {
+  // Messages of the last request, plus its reply once recorded, serialized.
+  List<String> sent = const [];
+  PromptPrefixStats stats = const PromptPrefixStats();
+}
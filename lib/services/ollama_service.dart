@@ -3,6 +3,7 @@ import 'package:flutter/foundation.dart';
 import 'package:http/http.dart' as http;
 import '../config/app_config.dart';
 import 'auth_service.dart';
+import 'native_http_client.dart';
 
 /// Service for communicating with Ollama API
 /// - Web: Uses cloud relay through API backend with authentication
@@ -230,11 +231,23 @@ class OllamaService extends ChangeNotifier {
   }
 
   /// Pull a model from Ollama registry (platform-aware)
-  Future<bool> pullModel(String modelName) async {
+  ///
+  /// On desktop the pull runs on the native client when the runner provides
+  /// it, which parses Ollama's progress lines off the UI isolate and reports
+  /// them to [onProgress] about ten times a second. Elsewhere the request
+  /// waits for the pull to finish and [onProgress] is not called.
+  Future<bool> pullModel(
+    String modelName, {
+    void Function(NativeDownloadProgress progress)? onProgress,
+  }) async {
     try {
       _setLoading(true);
       _clearError();
 
+      if (!_isWeb && await NativeHttpClient().isAvailable) {
+        return await _pullModelNatively(modelName, onProgress);
+      }
+
       final url = _isWeb
           ? '$_baseUrl/api/ollama/api/pull'
           : '$_baseUrl/api/pull';
@@ -273,6 +286,31 @@ class OllamaService extends ChangeNotifier {
     }
   }
 
+  Future<bool> _pullModelNatively(
+    String modelName,
+    void Function(NativeDownloadProgress progress)? onProgress,
+  ) async {
+    debugPrint('🦙 [OllamaService] Pulling $modelName natively');
+    final job = await NativeHttpClient().pullModel(
+      modelName,
+      server: Uri.parse(_baseUrl),
+    );
+    final subscription = onProgress != null
+        ? job.progress.listen(onProgress)
+        : null;
+    try {
+      await job.done;
+    } on NativeHttpException catch (e) {
+      _setError('Failed to pull model: ${e.message}');
+      debugPrint('🦙 [OllamaService] Native pull failed: ${e.message}');
+      return false;
+    } finally {
+      await subscription?.cancel();
+    }
+    await getModels();
+    return true;
+  }
+
   /// Delete a model from Ollama (platform-aware)
   Future<bool> deleteModel(String modelName) async {
     try {
@@ -0,0 +1,101 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+
+/// A later launch of the app, handed to this instance by the desktop runner
+class ForwardedLaunch {
+  /// Working directory of the process that was started
+  final String workingDirectory;
+
+  /// Its command-line arguments, without the executable name
+  final List<String> arguments;
+
+  const ForwardedLaunch({
+    required this.workingDirectory,
+    required this.arguments,
+  });
+
+  /// Decodes the runner's message (see native/forwarded_launch.h); returns
+  /// null if it is malformed
+  static ForwardedLaunch? decode(ByteData data) {
+    final bytes = Uint8List.sublistView(data);
+    var offset = 0;
+    String? string() {
+      if (offset + 4 > bytes.length) return null;
+      final length = data.getUint32(offset, Endian.little);
+      offset += 4;
+      if (offset + length > bytes.length) return null;
+      final value = utf8.decode(
+        Uint8List.sublistView(bytes, offset, offset + length),
+        allowMalformed: true,
+      );
+      offset += length;
+      return value;
+    }
+
+    final workingDirectory = string();
+    if (workingDirectory == null || offset + 4 > bytes.length) return null;
+    final count = data.getUint32(offset, Endian.little);
+    offset += 4;
+    final arguments = <String>[];
+    for (var i = 0; i < count; i++) {
+      final argument = string();
+      if (argument == null) return null;
+      arguments.add(argument);
+    }
+    return ForwardedLaunch(
+      workingDirectory: workingDirectory,
+      arguments: arguments,
+    );
+  }
+}
+
+/// Receives the launches the desktop runners forward instead of starting a
+/// second instance
+///
+/// Launching the app while it is running (from the tray, the desktop entry
+/// or the Start menu) no longer starts another Flutter engine with its own
+/// tunnel and Ollama connections: the Linux runner is a unique GApplication
+/// and the Windows runner holds a named mutex, and the new process hands its
+/// command line to this one and exits. The runner brings the window to the
+/// front itself; [launches] lets the app act on the arguments.
+class SingleInstanceService {
+  static const String channelName = 'cloudtolocalllm/single_instance';
+
+  static final SingleInstanceService _instance =
+      SingleInstanceService._internal();
+  factory SingleInstanceService() => _instance;
+  SingleInstanceService._internal();
+
+  final StreamController<ForwardedLaunch> _launches =
+      StreamController<ForwardedLaunch>.broadcast();
+  bool _isInitialized = false;
+
+  /// Launches forwarded since [initialize]
+  Stream<ForwardedLaunch> get launches => _launches.stream;
+
+  /// Start listening; launches that arrived before this are buffered by the
+  /// engine
+  void initialize() {
+    if (_isInitialized || kIsWeb) return;
+    _isInitialized = true;
+    ServicesBinding.instance.defaultBinaryMessenger.setMessageHandler(
+      channelName,
+      (ByteData? message) async {
+        final launch = message != null ? ForwardedLaunch.decode(message) : null;
+        if (launch == null) {
+          debugPrint('🪟 [SingleInstance] Ignoring malformed launch');
+          return null;
+        }
+        debugPrint(
+          '🪟 [SingleInstance] Launched again with ${launch.arguments}',
+        );
+        _launches.add(launch);
+        return null;
+      },
+    );
+  }
+}
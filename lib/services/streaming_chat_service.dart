@@ -2,6 +2,7 @@ import 'dart:async';
 import 'package:flutter/foundation.dart';
 import 'package:rxdart/rxdart.dart';
 import '../models/conversation.dart';
+import '../models/markdown_block.dart';
 import '../models/message.dart';
 import '../models/streaming_message.dart';
 
@@ -9,6 +10,8 @@ import 'streaming_service.dart';
 
 import 'connection_manager_service.dart';
 import 'conversation_storage_service.dart';
+import 'native_model_warmup.dart';
+import 'native_token_counter.dart';
 
 /// Enhanced chat service with real-time streaming support
 ///
@@ -18,6 +21,8 @@ class StreamingChatService extends ChangeNotifier {
   final ConnectionManagerService _connectionManager;
   final ConversationStorageService _storageService =
       ConversationStorageService();
+  final NativeTokenCounter _tokenCounter = NativeTokenCounter();
+  final NativeModelWarmup _modelWarmup = NativeModelWarmup();
 
   List<Conversation> _conversations = [];
   Conversation? _currentConversation;
@@ -30,6 +35,9 @@ class StreamingChatService extends ChangeNotifier {
       BehaviorSubject<String>.seeded('');
   StreamSubscription<StreamingMessage>? _currentStreamSubscription;
   String _currentStreamingMessageId = '';
+  // The streaming reply's blocks as the runner lexed them; null where
+  // MessageBubble lexes it in Dart instead.
+  List<MarkdownBlock>? _streamingBlocks;
 
   StreamingChatService(this._connectionManager) {
     _initializeService();
@@ -73,9 +81,15 @@ class StreamingChatService extends ChangeNotifier {
     // Update available models when connections change
     final availableModels = _connectionManager.availableModels;
     if (availableModels.isNotEmpty) {
-      // Auto-select first model if none selected
+      // Auto-select the current conversation's model, else the first, if
+      // none selected
       if (_selectedModel == null) {
-        _selectedModel = availableModels.first;
+        final lastUsed = _currentConversation?.model;
+        _selectedModel = lastUsed != null && availableModels.contains(lastUsed)
+            ? lastUsed
+            : availableModels.first;
+        _tokenCounter.prepare(_selectedModel!);
+        unawaited(_warmModel(_selectedModel!, WarmupTrigger.launch));
         debugPrint('💬 [StreamingChat] Auto-selected model: $_selectedModel');
         notifyListeners();
       }
@@ -83,12 +97,19 @@ class StreamingChatService extends ChangeNotifier {
   }
 
   /// Load conversations from storage
+  ///
+  /// Only the current conversation's messages are read up front; the others
+  /// are loaded when selected.
   Future<void> _loadConversations() async {
     try {
-      final loadedConversations = await _storageService.loadConversations();
+      final loadedConversations = await _storageService
+          .loadConversationSummaries();
 
       if (loadedConversations.isNotEmpty) {
-        _conversations = loadedConversations;
+        _conversations = List<Conversation>.from(loadedConversations);
+        _conversations[0] = await _storageService.loadMessages(
+          _conversations.first,
+        );
         _currentConversation = _conversations.first;
         debugPrint(
           '💬 [StreamingChat] Loaded ${_conversations.length} conversations from storage',
@@ -167,6 +188,58 @@ class StreamingChatService extends ChangeNotifier {
     _cancelCurrentStream();
 
     notifyListeners();
+
+    if (!_storageService.hasAllMessages(conversation.id)) {
+      _loadMessagesFor(conversation);
+    }
+  }
+
+  /// Conversations with a message matching [query], best match first
+  ///
+  /// Uses the native store's index when there is one (see
+  /// [NativeConversationStore.search] for the query syntax); otherwise
+  /// loaded messages are scanned for [query] as plain text.
+  Future<List<Conversation>> searchConversations(String query) async {
+    if (query.trim().isEmpty) return [];
+    try {
+      final hits = await _storageService.search(query);
+      if (hits != null) {
+        final byId = {for (final c in _conversations) c.id: c};
+        final seen = <String>{};
+        return [
+          for (final hit in hits)
+            if (seen.add(hit.conversationId) &&
+                byId.containsKey(hit.conversationId))
+              byId[hit.conversationId]!,
+        ];
+      }
+    } catch (e) {
+      debugPrint('💬 [StreamingChat] Error searching conversations: $e');
+    }
+    final needle = query.toLowerCase();
+    return _conversations
+        .where(
+          (c) => c.messages.any(
+            (m) => m.content.toLowerCase().contains(needle),
+          ),
+        )
+        .toList();
+  }
+
+  /// Replace a conversation listed from storage with its full message list
+  Future<void> _loadMessagesFor(Conversation conversation) async {
+    try {
+      final loaded = await _storageService.loadMessages(conversation);
+      final index = _conversations.indexWhere((c) => c.id == conversation.id);
+      if (index == -1) return;
+      _conversations[index] = loaded;
+      if (_currentConversation?.id == conversation.id) {
+        _currentConversation = loaded;
+      }
+      notifyListeners();
+    } catch (e) {
+      debugPrint('💬 [StreamingChat] Error loading messages: $e');
+    }
   }
 
   /// Delete a conversation
@@ -199,6 +272,8 @@ class StreamingChatService extends ChangeNotifier {
   /// Set the selected model
   void setSelectedModel(String model) {
     _selectedModel = model;
+    _tokenCounter.prepare(model);
+    unawaited(_warmModel(model, WarmupTrigger.select));
 
     // Update current conversation's default model
     if (_currentConversation != null) {
@@ -214,6 +289,15 @@ class StreamingChatService extends ChangeNotifier {
     notifyListeners();
   }
 
+  /// Has the runner keep [model] loaded in the local Ollama, loading it now
+  /// so the next chat does not wait for it
+  Future<void> _warmModel(String model, WarmupTrigger trigger) async {
+    if (!_connectionManager.hasLocalConnection) return;
+    final sizeBytes = await _tokenCounter.modelFileSize(model);
+    await _modelWarmup.setModel(model, sizeBytes: sizeBytes);
+    await _modelWarmup.warm(trigger);
+  }
+
   /// Send a message with streaming support
   Future<void> sendMessage(String content) async {
     if (_currentConversation == null || content.trim().isEmpty) return;
@@ -237,8 +321,13 @@ class StreamingChatService extends ChangeNotifier {
       _addMessageToCurrentConversation(streamingMessage);
       _currentStreamingMessageId = streamingMessage.id;
 
-      // Get conversation history for context
-      final history = _buildMessageHistory();
+      // Get conversation history for context, trimmed to the model's window
+      final history = await _tokenCounter.fitHistory(
+        model: _selectedModel!,
+        history: _buildMessageHistory(),
+        prompt: content.trim(),
+        conversationId: _currentConversation!.id,
+      );
 
       // Get streaming service
       final streamingService = _getStreamingService();
@@ -253,6 +342,7 @@ class StreamingChatService extends ChangeNotifier {
       // Start streaming
       _setStreaming(true);
       _streamingContentSubject.add('');
+      _streamingBlocks = null;
 
       final conversationId = _currentConversation!.id;
       final messageStream = streamingService.streamResponse(
@@ -313,9 +403,10 @@ class StreamingChatService extends ChangeNotifier {
       final currentContent = _streamingContentSubject.value;
       final newContent = currentContent + streamingMessage.chunk;
       _streamingContentSubject.add(newContent);
+      streamingMessage.blocks?.applyTo(_streamingBlocks ??= []);
 
       // Update the streaming message in the conversation
-      _updateStreamingMessage(newContent);
+      _updateStreamingMessage(newContent, streamingMessage.chunk);
     }
   }
 
@@ -350,17 +441,19 @@ class StreamingChatService extends ChangeNotifier {
       final assistantMessage = Message.assistant(
         content: finalContent,
         model: _selectedModel!,
+        blocks: _streamingBlocks,
       );
       _addMessageToCurrentConversation(assistantMessage);
     }
 
     // Clear streaming content
     _streamingContentSubject.add('');
+    _streamingBlocks = null;
     _currentStreamingMessageId = '';
   }
 
-  /// Update the streaming message content
-  void _updateStreamingMessage(String content) {
+  /// Update the streaming message content and save the [appended] chunk
+  void _updateStreamingMessage(String content, String appended) {
     if (_currentConversation == null || _currentStreamingMessageId.isEmpty) {
       return;
     }
@@ -377,6 +470,7 @@ class StreamingChatService extends ChangeNotifier {
       if (messageIndex != -1) {
         final updatedMessage = conversation.messages[messageIndex].copyWith(
           content: content,
+          blocks: _streamingBlocks,
         );
 
         final updatedMessages = List<Message>.from(conversation.messages);
@@ -386,6 +480,15 @@ class StreamingChatService extends ChangeNotifier {
           messages: updatedMessages,
         );
         _currentConversation = _conversations[index];
+        _storageService
+            .appendToMessage(
+              _conversations[index],
+              _currentStreamingMessageId,
+              appended,
+            )
+            .catchError((e) {
+              debugPrint('💬 [StreamingChat] Error saving streamed chunk: $e');
+            });
         notifyListeners();
       }
     }
@@ -406,8 +509,13 @@ class StreamingChatService extends ChangeNotifier {
       final loadingMessage = Message.loading(model: _selectedModel!);
       _addMessageToCurrentConversation(loadingMessage);
 
-      // Get conversation history for context
-      final history = _buildMessageHistory();
+      // Get conversation history for context, trimmed to the model's window
+      final history = await _tokenCounter.fitHistory(
+        model: _selectedModel!,
+        history: _buildMessageHistory(),
+        prompt: content,
+        conversationId: _currentConversation!.id,
+      );
 
       // Use connection manager for fallback chat
       final response = await _connectionManager.sendChatMessage(
@@ -0,0 +1,92 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
+/// Decoder for compressed tunnel frame payloads ("lz4-dict-v1")
+///
+/// A compressed payload is a u32 little-endian uncompressed size followed by
+/// one LZ4 block that may refer back into [dictionary], as if it preceded
+/// the data. The format and dictionary are defined in
+/// native/tunnel_compression.h and shared with api-backend/tunnel-frame.js.
+/// Frames are only compressed by the native codec; this is the decoder the
+/// Dart fallback uses for frames the cloud side compressed.
+class TunnelCompression {
+  /// Largest uncompressed size accepted from a peer
+  static const int maxDecompressedSize = 16 * 1024 * 1024;
+
+  /// Shared dictionary; changing a byte of it changes the wire format
+  static final Uint8List dictionary = ascii.encode(
+    r'{"status":"pulling manifest"}{"status":"verifying sha256 digest"}{'
+    r'"status":"writing manifest"}{"status":"success"}{"status":"downloa'
+    r'ding","digest":"sha256:","total":,"completed":}{"version":"0.5.7"}'
+    r'{"models":[{"name":"","model":"","expires_at":"","size_vram":{"emb'
+    r'eddings":[[0.0,-0.0,{"model":"","messages":[{"role":"system","cont'
+    r'ent":""},{"role":"user","content":""}],"stream":true,"options":{"t'
+    r'emperature":,"num_ctx":}}{"models":[{"name":"","model":"","modifie'
+    r'd_at":"","size":,"digest":"sha256:","details":{"parent_model":"","'
+    r'format":"gguf","family":"llama","families":["llama"],"parameter_si'
+    r'ze":"8.0B","quantization_level":"Q4_K_M"}}]}"response":"","context'
+    r'":["done":true,"done_reason":"stop","total_duration":,"load_durati'
+    r'on":,"prompt_eval_count":,"prompt_eval_duration":,"eval_count":,"e'
+    r'val_duration":}content-type: application/json; charset=utf-8 appli'
+    r'cation/x-ndjson content-length: {"model":"llama3.2:latest","create'
+    r'd_at":"2025-01-01T00:00:00.000000000Z","message":{"role":"assistan'
+    r't","content":""},"done":false}',
+  );
+
+  /// Decompress [payload], or return null if it is malformed
+  static Uint8List? decompress(Uint8List payload) {
+    if (payload.length < 4) return null;
+    final size = ByteData.sublistView(payload).getUint32(0, Endian.little);
+    if (size > maxDecompressedSize) return null;
+
+    final start = dictionary.length;
+    final end = start + size;
+    final window = Uint8List(end)..setRange(0, start, dictionary);
+    var input = 4;
+    var position = start;
+
+    // Reads a length continued in 255-valued bytes onto [base]
+    int? readLength(int base) {
+      var length = base;
+      int byte;
+      do {
+        if (input == payload.length) return null;
+        byte = payload[input++];
+        length += byte;
+      } while (byte == 255 && length <= maxDecompressedSize);
+      return length <= maxDecompressedSize ? length : null;
+    }
+
+    while (true) {
+      if (input == payload.length) return null;
+      final token = payload[input++];
+      int? literals = token >> 4;
+      if (literals == 15) literals = readLength(literals);
+      if (literals == null ||
+          literals > payload.length - input ||
+          literals > end - position) {
+        return null;
+      }
+      window.setRange(position, position + literals, payload, input);
+      input += literals;
+      position += literals;
+      if (input == payload.length) break;
+
+      if (payload.length - input < 2) return null;
+      final offset = payload[input] | payload[input + 1] << 8;
+      input += 2;
+      int? length = token & 15;
+      if (length == 15) length = readLength(length);
+      if (length == null) return null;
+      length += 4;
+      if (offset == 0 || offset > position || length > end - position) {
+        return null;
+      }
+      // Byte by byte: a match may overlap the bytes it produces.
+      for (var from = position - offset; length > 0; length--) {
+        window[position++] = window[from++];
+      }
+    }
+    return position == end ? Uint8List.sublistView(window, start) : null;
+  }
+}
@@ -0,0 +1,334 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:typed_data';
+
+import 'package:cryptography/cryptography.dart';
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+
+import 'encrypted_tunnel_protocol.dart';
+import 'tunnel_compression.dart';
+
+/// Direction a tunnel frame travels in; part of the nonce
+///
+/// [desktopToCloudStream] carries response bodies relayed natively by
+/// `NativeHttpClient.relayToTunnel`, which are sealed with their own
+/// sequence numbers.
+enum TunnelDirection {
+  desktopToCloud,
+  cloudToDesktop,
+  desktopToCloudStream;
+
+  bool get fromDesktop => this != cloudToDesktop;
+}
+
+/// Why a frame was rejected; codes match TunnelFrameStatus in native/
+enum TunnelFrameStatus {
+  ok,
+  malformed,
+  wrongSession,
+  replayed,
+  authenticationFailed,
+}
+
+/// Thrown when an incoming frame cannot be opened
+class TunnelFrameException implements Exception {
+  final TunnelFrameStatus status;
+
+  TunnelFrameException(this.status);
+
+  @override
+  String toString() => 'TunnelFrameException: ${status.name}';
+}
+
+/// Seals and opens binary encrypted tunnel frames for one session
+///
+/// A frame is a 28-byte little-endian header (version, message type, flags,
+/// session id length, ciphertext length, monotonic timestamp, direction,
+/// sequence number), the session id, and the ChaCha20-Poly1305 ciphertext
+/// and tag.
+/// Direction and sequence number form the nonce and the whole header is
+/// authenticated, so frames cannot be altered, replayed or reflected. The
+/// layout is defined in native/tunnel_frame.h and mirrored by
+/// api-backend/tunnel-frame.js.
+///
+/// On the desktop runners frames are sealed and opened in place by the
+/// native codec on `cloudtolocalllm/tunnel_codec`, which uses SSE2/NEON
+/// ChaCha20. Elsewhere the same frames are produced in Dart with
+/// `package:cryptography`.
+///
+/// Frames flagged compressed ([TunnelCompression]) are always accepted.
+/// Outgoing frames are compressed only by the native codec, and only for a
+/// session opened with `compress`.
+class TunnelFrameCodec {
+  static const String channelName = 'cloudtolocalllm/tunnel_codec';
+
+  // Request opcodes; must match TunnelCodecService in native/.
+  static const int _opOpenSession = 1;
+  static const int _opSeal = 2;
+  static const int _opOpen = 3;
+  static const int _opCloseSession = 4;
+  static const int _sessionFlagCompress = 1 << 0;
+
+  static const int frameVersion = 1;
+  static const int _fixedHeaderSize = 28;
+  static const int _tagSize = 16;
+  static const int _flagCompressed = 1 << 0;
+  static const int keySize = 32;
+
+  static int _nextHandle = 1;
+  static final Stopwatch _clock = Stopwatch()..start();
+
+  final BinaryMessenger? _messenger;
+  final int _handle;
+  final Uint8List _key;
+  final Uint8List _sessionId;
+  final TunnelDirection _outgoing;
+
+  /// Whether frames go through the native codec
+  final bool isNative;
+
+  // Dart fallback state
+  final Chacha20 _aead = Chacha20.poly1305Aead();
+  int _nextSequence = 0;
+  final List<int> _nextReceivedSequence = List.filled(
+    TunnelDirection.values.length,
+    0,
+  );
+  bool _closed = false;
+
+  TunnelFrameCodec._(
+    this._messenger,
+    this._handle,
+    this._key,
+    this._sessionId,
+    this._outgoing,
+    this.isNative,
+  );
+
+  /// Start a session with the 32-byte shared [key]
+  ///
+  /// Uses the native codec when it answers, the Dart implementation
+  /// otherwise. Pass [forceDart] to skip the native probe. With [compress]
+  /// the native codec compresses payloads that shrink enough; only pass it
+  /// when the peer advertised [TunnelCapabilities.lz4Compression].
+  static Future<TunnelFrameCodec> open({
+    required Uint8List key,
+    required String sessionId,
+    TunnelDirection outgoing = TunnelDirection.desktopToCloud,
+    BinaryMessenger? messenger,
+    bool forceDart = false,
+    bool compress = false,
+  }) async {
+    if (key.length != keySize) {
+      throw ArgumentError.value(key.length, 'key', 'must be $keySize bytes');
+    }
+    final sessionIdBytes = utf8.encode(sessionId);
+    if (sessionIdBytes.length > 255) {
+      throw ArgumentError.value(sessionId, 'sessionId', 'is too long');
+    }
+
+    final handle = _nextHandle++;
+    var native = false;
+    if (!kIsWeb && !forceDart) {
+      try {
+        final request = BytesBuilder(copy: false)
+          ..add(_header(_opOpenSession, handle))
+          ..add(key)
+          ..addByte(outgoing.index)
+          ..add(_u32(sessionIdBytes.length))
+          ..add(sessionIdBytes)
+          ..addByte(compress ? _sessionFlagCompress : 0);
+        final reply = await (messenger ??
+                ServicesBinding.instance.defaultBinaryMessenger)
+            .send(channelName, ByteData.sublistView(request.takeBytes()));
+        native = reply != null && reply.lengthInBytes > 0;
+      } catch (e) {
+        debugPrint('🔐 [TunnelFrameCodec] Native codec probe failed: $e');
+      }
+      if (!native) {
+        debugPrint(
+          '🔐 [TunnelFrameCodec] Native codec unavailable, using Dart fallback',
+        );
+      }
+    }
+
+    return TunnelFrameCodec._(
+      messenger,
+      handle,
+      Uint8List.fromList(key),
+      sessionIdBytes,
+      outgoing,
+      native,
+    );
+  }
+
+  /// Encode and seal [message] into a frame
+  Future<Uint8List> seal(TunnelMessage message) async {
+    _checkOpen();
+    final type = TunnelPayloadCodec.typeCode(message.type);
+    final payload = TunnelPayloadCodec.encode(message);
+
+    if (isNative) {
+      final request = Uint8List(6 + payload.length)
+        ..setRange(0, 5, _header(_opSeal, _handle))
+        ..[5] = type
+        ..setRange(6, 6 + payload.length, payload);
+      final reply = await _send(request);
+      if (reply == null || reply.lengthInBytes == 0) {
+        throw StateError('Native codec dropped session $_handle');
+      }
+      return Uint8List.sublistView(reply);
+    }
+
+    final headerSize = _fixedHeaderSize + _sessionId.length;
+    final header = Uint8List(headerSize);
+    ByteData.sublistView(header)
+      ..setUint8(0, frameVersion)
+      ..setUint8(1, type)
+      ..setUint8(2, 0)
+      ..setUint8(3, _sessionId.length)
+      ..setUint32(4, payload.length + _tagSize, Endian.little)
+      ..setUint64(8, _clock.elapsedMicroseconds, Endian.little)
+      ..setUint32(16, _outgoing.index, Endian.little)
+      ..setUint64(20, _nextSequence++, Endian.little);
+    header.setRange(_fixedHeaderSize, headerSize, _sessionId);
+
+    final box = await _aead.encrypt(
+      payload,
+      secretKey: SecretKeyData(_key),
+      nonce: Uint8List.sublistView(header, 16, 28),
+      aad: header,
+    );
+    return (BytesBuilder(copy: false)
+          ..add(header)
+          ..add(box.cipherText)
+          ..add(box.mac.bytes))
+        .takeBytes();
+  }
+
+  /// Authenticate and decode [frame]
+  ///
+  /// Throws [TunnelFrameException] for frames that are malformed, belong to
+  /// another session or direction, were replayed, or fail authentication.
+  Future<TunnelMessage> open(Uint8List frame) async {
+    _checkOpen();
+    final int type;
+    final Uint8List payload;
+
+    if (isNative) {
+      final request = Uint8List(5 + frame.length)
+        ..setRange(0, 5, _header(_opOpen, _handle))
+        ..setRange(5, 5 + frame.length, frame);
+      final reply = await _send(request);
+      if (reply == null || reply.lengthInBytes == 0) {
+        throw StateError('Native codec dropped session $_handle');
+      }
+      final status = TunnelFrameStatus.values[reply.getUint8(0)];
+      if (status != TunnelFrameStatus.ok) {
+        throw TunnelFrameException(status);
+      }
+      type = reply.getUint8(1);
+      payload = Uint8List.sublistView(reply, 10);
+    } else {
+      type = frame.length > 1 ? frame[1] : 0;
+      payload = await _openInDart(frame);
+    }
+
+    final messageType = TunnelPayloadCodec.typeFromCode(type);
+    if (messageType == null) {
+      throw TunnelFrameException(TunnelFrameStatus.malformed);
+    }
+    return TunnelPayloadCodec.decode(messageType, payload);
+  }
+
+  Future<Uint8List> _openInDart(Uint8List frame) async {
+    if (frame.length < _fixedHeaderSize || frame[0] != frameVersion) {
+      throw TunnelFrameException(TunnelFrameStatus.malformed);
+    }
+    final view = ByteData.sublistView(frame);
+    final flags = frame[2];
+    final sessionIdLength = frame[3];
+    final ciphertextLength = view.getUint32(4, Endian.little);
+    final headerSize = _fixedHeaderSize + sessionIdLength;
+    if (flags & ~_flagCompressed != 0 ||
+        ciphertextLength < _tagSize ||
+        frame.length != headerSize + ciphertextLength) {
+      throw TunnelFrameException(TunnelFrameStatus.malformed);
+    }
+
+    final direction = view.getUint32(16, Endian.little);
+    final sequence = view.getUint64(20, Endian.little);
+    if (direction >= TunnelDirection.values.length ||
+        TunnelDirection.values[direction].fromDesktop == _outgoing.fromDesktop ||
+        !listEquals(
+          Uint8List.sublistView(frame, _fixedHeaderSize, headerSize),
+          _sessionId,
+        )) {
+      throw TunnelFrameException(TunnelFrameStatus.wrongSession);
+    }
+    if (sequence < _nextReceivedSequence[direction]) {
+      throw TunnelFrameException(TunnelFrameStatus.replayed);
+    }
+
+    final List<int> plaintext;
+    try {
+      plaintext = await _aead.decrypt(
+        SecretBox(
+          Uint8List.sublistView(frame, headerSize, frame.length - _tagSize),
+          nonce: Uint8List.sublistView(frame, 16, 28),
+          mac: Mac(Uint8List.sublistView(frame, frame.length - _tagSize)),
+        ),
+        secretKey: SecretKeyData(_key),
+        aad: Uint8List.sublistView(frame, 0, headerSize),
+      );
+    } on SecretBoxAuthenticationError {
+      throw TunnelFrameException(TunnelFrameStatus.authenticationFailed);
+    }
+    _nextReceivedSequence[direction] = sequence + 1;
+    final payload = plaintext is Uint8List
+        ? plaintext
+        : Uint8List.fromList(plaintext);
+    if (flags & _flagCompressed == 0) return payload;
+    final decompressed = TunnelCompression.decompress(payload);
+    if (decompressed == null) {
+      throw TunnelFrameException(TunnelFrameStatus.malformed);
+    }
+    return decompressed;
+  }
+
+  /// Release the session; the codec cannot be used afterwards
+  Future<void> close() async {
+    if (_closed) return;
+    _closed = true;
+    _key.fillRange(0, _key.length, 0);
+    if (isNative) {
+      await _send(_header(_opCloseSession, _handle));
+    }
+  }
+
+  void _checkOpen() {
+    if (_closed) {
+      throw StateError('Tunnel frame codec is closed');
+    }
+  }
+
+  Future<ByteData?> _send(Uint8List request) {
+    return (_messenger ?? ServicesBinding.instance.defaultBinaryMessenger)
+        .send(channelName, ByteData.sublistView(request));
+  }
+
+  static Uint8List _header(int op, int handle) {
+    final header = Uint8List(5);
+    ByteData.sublistView(header)
+      ..setUint8(0, op)
+      ..setUint32(1, handle, Endian.little);
+    return header;
+  }
+
+  static Uint8List _u32(int value) {
+    final bytes = Uint8List(4);
+    ByteData.sublistView(bytes).setUint32(0, value, Endian.little);
+    return bytes;
+  }
+}
@@ -0,0 +1,130 @@
+import 'dart:async';
+
+import 'package:flutter/foundation.dart';
+
+/// Liveness checks for a tunnel that cost nothing while traffic flows
+///
+/// Anything received from the peer proves it is alive, so no ping is sent
+/// while [received] keeps being called. Once the tunnel goes quiet a ping is
+/// sent after [minInterval], and each further idle round that the peer
+/// answers doubles the wait, up to [maxInterval]: an idle tunnel wakes up a
+/// handful of times an hour instead of every few seconds.
+///
+/// While we are sending ([sent]) the interval stays at [minInterval], so a
+/// peer that stops answering under load is still noticed within
+/// [minInterval] + [timeout]. A ping that gets nothing back within [timeout]
+/// calls [onDead] once; the heartbeat then stops until started again.
+///
+/// There is one one-shot timer at a time; nothing runs on a fixed period.
+class AdaptiveHeartbeat {
+  final Duration minInterval;
+  final Duration maxInterval;
+  final Duration timeout;
+  final FutureOr<void> Function() _ping;
+  final void Function() _onDead;
+
+  Timer? _timer;
+  Duration _interval;
+  final Stopwatch _sinceReceived = Stopwatch();
+  bool _sentSinceCheck = false;
+  bool _awaitingReply = false;
+
+  /// Pings sent, and checks that needed none because the peer had been
+  /// heard from
+  int pingsSent = 0;
+  int pingsSkipped = 0;
+
+  AdaptiveHeartbeat({
+    this.minInterval = const Duration(seconds: 15),
+    this.maxInterval = const Duration(minutes: 4),
+    this.timeout = const Duration(seconds: 10),
+    required FutureOr<void> Function() ping,
+    required void Function() onDead,
+  }) : _ping = ping,
+       _onDead = onDead,
+       _interval = minInterval;
+
+  bool get isRunning => _timer != null;
+
+  /// Current wait between checks of an idle tunnel
+  Duration get interval => _interval;
+
+  /// How long ago the peer was last heard from
+  Duration get sinceReceived => _sinceReceived.elapsed;
+
+  void start() {
+    _interval = minInterval;
+    _awaitingReply = false;
+    _sinceReceived
+      ..reset()
+      ..start();
+    _schedule(_interval);
+  }
+
+  void stop() {
+    _timer?.cancel();
+    _timer = null;
+    _sinceReceived.stop();
+  }
+
+  /// Something arrived from the peer
+  void received() {
+    _sinceReceived.reset();
+    if (_awaitingReply) {
+      _awaitingReply = false;
+      // The ping's answer (or anything else) came in; the next check is
+      // whatever the interval has become.
+      _schedule(_interval);
+    }
+  }
+
+  /// Something was sent to the peer
+  void sent() {
+    _sentSinceCheck = true;
+    if (_interval > minInterval && isRunning && !_awaitingReply) {
+      // Traffic resumed during a long idle wait: check at the active pace.
+      _interval = minInterval;
+      _schedule(_interval);
+    }
+  }
+
+  void _schedule(Duration delay) {
+    _timer?.cancel();
+    _timer = Timer(delay, _check);
+  }
+
+  void _check() {
+    if (_awaitingReply) {
+      debugPrint(
+        '💓 [Heartbeat] No reply for ${_sinceReceived.elapsed.inSeconds}s',
+      );
+      _timer = null;
+      _awaitingReply = false;
+      _onDead();
+      return;
+    }
+
+    final busy = _sentSinceCheck;
+    _sentSinceCheck = false;
+    if (_sinceReceived.elapsed < _interval) {
+      // Heard from within this round; no ping needed.
+      pingsSkipped++;
+      _interval = busy ? minInterval : _backedOff();
+      _schedule(_interval - _sinceReceived.elapsed);
+      return;
+    }
+
+    pingsSent++;
+    _awaitingReply = true;
+    if (!busy) _interval = _backedOff();
+    _schedule(timeout);
+    Future.sync(_ping).catchError((Object e) {
+      debugPrint('💓 [Heartbeat] Ping failed: $e');
+    });
+  }
+
+  Duration _backedOff() {
+    final doubled = _interval * 2;
+    return doubled > maxInterval ? maxInterval : doubled;
+  }
+}
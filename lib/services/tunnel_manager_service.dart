@@ -49,6 +49,11 @@ class TunnelManagerService extends ChangeNotifier {
 
   // Timers for health checks
   Timer? _healthCheckTimer;
+  // Consecutive rounds in which no connection changed state; each doubles
+  // the wait before the next, up to 2^_maxHealthCheckBackoff times the
+  // configured interval.
+  int _quietHealthChecks = 0;
+  static const int _maxHealthCheckBackoff = 3;
 
   // WebSocket connections for real-time updates
   WebSocket? _cloudWebSocket;
@@ -812,23 +817,49 @@ class TunnelManagerService extends ChangeNotifier {
     }
   }
 
-  /// Start periodic health checks
+  /// Start health checks, backing off while nothing changes
   void _startHealthChecks() {
+    _quietHealthChecks = 0;
+    _scheduleHealthCheck();
+  }
+
+  void _scheduleHealthCheck() {
     _healthCheckTimer?.cancel();
-    _healthCheckTimer = Timer.periodic(
-      Duration(seconds: _config.healthCheckInterval),
-      (_) => _performHealthChecks(),
-    );
+    final backoff = min(_quietHealthChecks, _maxHealthCheckBackoff);
+    final delay =
+        Duration(seconds: _config.healthCheckInterval) * (1 << backoff);
+    late final Timer timer;
+    timer = Timer(delay, () async {
+      final changed = await _performHealthChecks(delay);
+      _quietHealthChecks = changed ? 0 : _quietHealthChecks + 1;
+      // Not cancelled or restarted meanwhile
+      if (!_isDisposed && identical(_healthCheckTimer, timer)) {
+        _scheduleHealthCheck();
+      }
+    });
+    _healthCheckTimer = timer;
   }
 
   /// Perform health checks on all connections
-  Future<void> _performHealthChecks() async {
+  ///
+  /// The cloud check is skipped when the encrypted tunnel has heard from
+  /// the cloud side within [period], which shows as much. Returns whether
+  /// any connection changed state.
+  Future<bool> _performHealthChecks([Duration? period]) async {
+    var changed = false;
     for (final entry in _connectionStatus.entries) {
       final type = entry.key;
       final status = entry.value;
 
       if (!status.isConnected) continue;
 
+      if (type == 'cloud' &&
+          period != null &&
+          _encryptedTunnelClient?.isConnected == true &&
+          _encryptedTunnelClient!.sinceLastReceived < period) {
+        continue;
+      }
+
       try {
         final stopwatch = Stopwatch()..start();
 
@@ -853,6 +884,7 @@ class TunnelManagerService extends ChangeNotifier {
           error: e.toString(),
           lastCheck: DateTime.now(),
         );
+        changed = true;
 
         debugPrint('🚇 [TunnelManager] Health check failed for $type: $e');
       }
@@ -860,6 +892,7 @@ class TunnelManagerService extends ChangeNotifier {
 
     _updateOverallStatus();
     _debouncedNotifyListeners();
+    return changed;
   }
 
   /// Local Ollama health is now handled independently by LocalOllamaConnectionService
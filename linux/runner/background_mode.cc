@@ -0,0 +1,77 @@
+#include "background_mode.h"
+
+#include <malloc.h>
+
+#include <cstdint>
+
+namespace {
+
+constexpr char kChannelName[] = "cloudtolocalllm/background_mode";
+constexpr uint8_t kLeft = 0;
+constexpr uint8_t kEntered = 1;
+
+struct BackgroundMode {
+  // Weak pointer; the view goes away with the window.
+  FlView* view = nullptr;
+  bool in_background = false;
+};
+
+void state_sent_cb(GObject* object, GAsyncResult* result, gpointer user_data) {
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(GBytes) reply = fl_binary_messenger_send_on_channel_finish(
+      FL_BINARY_MESSENGER(object), result, &error);
+  // Dart has let go of its caches by now; without this glibc keeps the
+  // freed arenas mapped.
+  malloc_trim(0);
+}
+
+void send_state(BackgroundMode* mode, uint8_t state) {
+  if (mode->view == nullptr) {
+    return;
+  }
+  FlBinaryMessenger* messenger =
+      fl_engine_get_binary_messenger(fl_view_get_engine(mode->view));
+  g_autoptr(GBytes) message = g_bytes_new(&state, sizeof(state));
+  fl_binary_messenger_send_on_channel(
+      messenger, kChannelName, message, nullptr,
+      state == kEntered ? state_sent_cb : nullptr, nullptr);
+}
+
+void window_hide_cb(GtkWidget* widget, gpointer user_data) {
+  BackgroundMode* mode = static_cast<BackgroundMode*>(user_data);
+  if (!mode->in_background) {
+    mode->in_background = true;
+    send_state(mode, kEntered);
+  }
+}
+
+void window_show_cb(GtkWidget* widget, gpointer user_data) {
+  BackgroundMode* mode = static_cast<BackgroundMode*>(user_data);
+  if (mode->in_background) {
+    mode->in_background = false;
+    send_state(mode, kLeft);
+  }
+}
+
+void free_background_mode(gpointer data) {
+  BackgroundMode* mode = static_cast<BackgroundMode*>(data);
+  if (mode->view != nullptr) {
+    g_object_remove_weak_pointer(G_OBJECT(mode->view),
+                                 reinterpret_cast<gpointer*>(&mode->view));
+  }
+  delete mode;
+}
+
+}  // namespace
+
+void background_mode_attach(GtkWindow* window, FlView* view) {
+  BackgroundMode* mode = new BackgroundMode();
+  mode->view = view;
+  g_object_add_weak_pointer(G_OBJECT(view),
+                            reinterpret_cast<gpointer*>(&mode->view));
+  // Owned by the window, so the handlers below never outlive it.
+  g_object_set_data_full(G_OBJECT(window), "cloudtolocalllm-background-mode",
+                         mode, free_background_mode);
+  g_signal_connect(window, "hide", G_CALLBACK(window_hide_cb), mode);
+  g_signal_connect(window, "show", G_CALLBACK(window_show_cb), mode);
+}
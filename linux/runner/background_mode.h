@@ -0,0 +1,21 @@
+#ifndef FLUTTER_BACKGROUND_MODE_H_
+#define FLUTTER_BACKGROUND_MODE_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <gtk/gtk.h>
+
+/**
+ * background_mode_attach:
+ * @window: the application window.
+ * @view: the #FlView it hosts.
+ *
+ * Lets the app sit in the tray cheaply. When @window is hidden (e.g. by
+ * window_manager when it is closed to the tray) Dart is told on the
+ * "cloudtolocalllm/background_mode" channel so it drops its image and GPU
+ * resource caches, and once it has, freed heap is handed back to the OS.
+ * The engine and the Dart services keep running, and Dart is told again
+ * when @window is shown.
+ */
+void background_mode_attach(GtkWindow* window, FlView* view);
+
+#endif  // FLUTTER_BACKGROUND_MODE_H_
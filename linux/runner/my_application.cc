@@ -5,17 +5,56 @@
 #include <gdk/gdkx.h>
 #endif
 
-#include "flutter/generated_plugin_registrant.h"
+#include <string>
+#include <vector>
+
+#include "background_mode.h"
+#include "native/forwarded_launch.h"
+#include "native/startup_trace.h"
+#include "native/task_executor.h"
+#include "native_plugins.h"
+#include "plugin_scheduler.h"
+#include "window_icon.h"
+
+using cloudtolocalllm::EncodeForwardedLaunch;
+using cloudtolocalllm::ForwardedLaunch;
+using cloudtolocalllm::ScopedStartupTrace;
+using cloudtolocalllm::StartupTrace;
+using cloudtolocalllm::TaskExecutor;
+
+// Receives the launches of later instances; see native/forwarded_launch.h.
+static constexpr char kSingleInstanceChannel[] =
+    "cloudtolocalllm/single_instance";
 
 struct _MyApplication {
   GtkApplication parent_instance;
   char** dart_entrypoint_arguments;
+  // Runs the native plugins' work; created in startup, stopped in shutdown.
+  TaskExecutor* executor;
+  // Weak pointers, cleared when the window closes.
+  GtkWindow* window;
+  FlView* view;
 };
 
 G_DEFINE_TYPE(MyApplication, my_application, GTK_TYPE_APPLICATION)
 
+// Called when the view has rendered its first frame. The trace is written
+// once the deferred plugins are registered; see plugin_scheduler.h.
+static void first_frame_cb(FlView* view, gpointer user_data) {
+  StartupTrace::Get()->Instant("first frame");
+}
+
+// Called when the window gains or loses focus. Background work is throttled
+// while the user is in the window.
+static void window_active_cb(GtkWindow* window, GParamSpec* pspec,
+                             gpointer user_data) {
+  static_cast<TaskExecutor*>(user_data)->SetForeground(
+      gtk_window_is_active(window));
+}
+
 // Implements GApplication::activate.
 static void my_application_activate(GApplication* application) {
+  ScopedStartupTrace trace("my_application_activate");
   MyApplication* self = MY_APPLICATION(application);
   GtkWindow* window =
       GTK_WINDOW(gtk_application_window_new(GTK_APPLICATION(application)));
@@ -49,62 +88,118 @@ static void my_application_activate(GApplication* application) {
 
   gtk_window_set_default_size(window, 1280, 720);
 
-  // Set window icon for better desktop integration
-  GError* error = nullptr;
-  GdkPixbuf* icon = nullptr;
-
-  // Try multiple paths for the icon
-  const char* icon_paths[] = {
-    "data/flutter_assets/assets/images/app_icon.png",
-    "assets/images/app_icon.png",
-    "/usr/share/pixmaps/cloudtolocalllm.png",
-    "/usr/share/icons/hicolor/128x128/apps/cloudtolocalllm.png",
-    nullptr
-  };
-
-  for (int i = 0; icon_paths[i] != nullptr && icon == nullptr; i++) {
-    error = nullptr;
-    icon = gdk_pixbuf_new_from_file(icon_paths[i], &error);
-    if (icon != nullptr) {
-      gtk_window_set_icon(window, icon);
-      g_object_unref(icon);
-      break;
-    } else if (error != nullptr) {
-      g_error_free(error);
-    }
-  }
-
-  if (icon == nullptr) {
-    g_warning("Failed to load window icon from any path");
-  }
+  // Set window icon for better desktop integration. Loaded in the
+  // background so showing the window never waits on the file system.
+  window_icon_load_async(window);
 
   gtk_widget_show(GTK_WIDGET(window));
 
   g_autoptr(FlDartProject) project = fl_dart_project_new();
   fl_dart_project_set_dart_entrypoint_arguments(project, self->dart_entrypoint_arguments);
 
+  StartupTrace::Get()->Begin("fl_view_new");
   FlView* view = fl_view_new(project);
+  StartupTrace::Get()->End();
+  g_signal_connect(view, "first-frame", G_CALLBACK(first_frame_cb), nullptr);
   gtk_widget_show(GTK_WIDGET(view));
   gtk_container_add(GTK_CONTAINER(window), GTK_WIDGET(view));
 
-  fl_register_plugins(FL_PLUGIN_REGISTRY(view));
+  {
+    ScopedStartupTrace plugins_trace("plugin_scheduler_start");
+    plugin_scheduler_start(view);
+  }
+  {
+    ScopedStartupTrace plugins_trace("native_plugins_register");
+    // The model warm-up follows the window's focus-in events from here on.
+    native_plugins_register(FL_PLUGIN_REGISTRY(view), self->executor, window);
+  }
+  g_signal_connect(window, "notify::is-active", G_CALLBACK(window_active_cb),
+                   self->executor);
 
   gtk_widget_grab_focus(GTK_WIDGET(view));
+
+  background_mode_attach(window, view);
+
+  self->window = window;
+  g_object_add_weak_pointer(G_OBJECT(window),
+                            reinterpret_cast<gpointer*>(&self->window));
+  self->view = view;
+  g_object_add_weak_pointer(G_OBJECT(view),
+                            reinterpret_cast<gpointer*>(&self->view));
+}
+
+// Implements GApplication::command_line. Only called in the primary
+// instance, for the launches of later ones; its own launch is handled in
+// local_command_line.
+static int my_application_command_line(GApplication* application,
+                                       GApplicationCommandLine* command_line) {
+  MyApplication* self = MY_APPLICATION(application);
+  if (self->view == nullptr) {
+    g_application_activate(application);
+    return 0;
+  }
+
+  ForwardedLaunch launch;
+  const gchar* cwd = g_application_command_line_get_cwd(command_line);
+  launch.working_directory = cwd != nullptr ? cwd : "";
+  int argc = 0;
+  g_auto(GStrv) argv =
+      g_application_command_line_get_arguments(command_line, &argc);
+  for (int i = 1; i < argc; i++) {
+    launch.arguments.emplace_back(argv[i]);
+  }
+  const std::vector<uint8_t> encoded = EncodeForwardedLaunch(launch);
+  g_autoptr(GBytes) message = g_bytes_new(encoded.data(), encoded.size());
+  fl_binary_messenger_send_on_channel(
+      fl_engine_get_binary_messenger(fl_view_get_engine(self->view)),
+      kSingleInstanceChannel, message, nullptr, nullptr, nullptr);
+
+  // Brings the window back even if it was hidden to the tray.
+  gtk_window_present(self->window);
+  return 0;
 }
 
 // Implements GApplication::local_command_line.
 static gboolean my_application_local_command_line(GApplication* application, gchar*** arguments, int* exit_status) {
   MyApplication* self = MY_APPLICATION(application);
   // Strip out the first argument as it is the binary name.
-  self->dart_entrypoint_arguments = g_strdupv(*arguments + 1);
+  std::vector<std::string> dart_arguments;
+  for (gchar** argument = *arguments + 1; *argument != nullptr; argument++) {
+    dart_arguments.emplace_back(*argument);
+  }
+  // Enabled by CLOUDTOLOCALLLM_TRACE_STARTUP or --trace-startup; the flag is
+  // not passed on to Dart.
+  StartupTrace::Get()->Configure(&dart_arguments);
+  StartupTrace::Get()->Instant("my_application_local_command_line");
+  self->dart_entrypoint_arguments = g_new0(gchar*, dart_arguments.size() + 1);
+  for (size_t i = 0; i < dart_arguments.size(); i++) {
+    self->dart_entrypoint_arguments[i] = g_strdup(dart_arguments[i].c_str());
+  }
 
   g_autoptr(GError) error = nullptr;
-  if (!g_application_register(application, nullptr, &error)) {
+  StartupTrace::Get()->Begin("g_application_register");
+  const gboolean registered =
+      g_application_register(application, nullptr, &error);
+  StartupTrace::Get()->End();
+  if (!registered) {
      g_warning("Failed to register: %s", error->message);
      *exit_status = 1;
      return TRUE;
   }
 
+  if (g_application_get_is_remote(application)) {
+    // Another instance owns the application ID. Returning FALSE makes
+    // g_application_run() hand it this command line over D-Bus and exit,
+    // rather than this process starting a second engine and tunnel.
+    g_strfreev(*arguments);
+    *arguments = g_new0(gchar*, dart_arguments.size() + 2);
+    (*arguments)[0] = g_strdup(g_get_prgname());
+    for (size_t i = 0; i < dart_arguments.size(); i++) {
+      (*arguments)[i + 1] = g_strdup(dart_arguments[i].c_str());
+    }
+    return FALSE;
+  }
+
   g_application_activate(application);
   *exit_status = 0;
 
@@ -113,18 +208,29 @@ static gboolean my_application_local_command_line(GApplication* application, gch
 
 // Implements GApplication::startup.
 static void my_application_startup(GApplication* application) {
-  //MyApplication* self = MY_APPLICATION(object);
+  MyApplication* self = MY_APPLICATION(application);
 
-  // Perform any actions required at application startup.
+  // One pool of workers for every native plugin; only the primary instance
+  // gets here.
+  self->executor = new TaskExecutor();
+  self->executor->Start();
 
   G_APPLICATION_CLASS(my_application_parent_class)->startup(application);
 }
 
 // Implements GApplication::shutdown.
 static void my_application_shutdown(GApplication* application) {
-  //MyApplication* self = MY_APPLICATION(object);
+  MyApplication* self = MY_APPLICATION(application);
 
-  // Perform any actions required at application shutdown.
+  // Joins the workers. Requests still queued are dropped; the plugins keep
+  // what their tasks use alive until then.
+  if (self->executor != nullptr) {
+    if (self->window != nullptr) {
+      g_signal_handlers_disconnect_by_data(self->window, self->executor);
+    }
+    delete self->executor;
+    self->executor = nullptr;
+  }
 
   G_APPLICATION_CLASS(my_application_parent_class)->shutdown(application);
 }
@@ -133,12 +239,23 @@ static void my_application_shutdown(GApplication* application) {
 static void my_application_dispose(GObject* object) {
   MyApplication* self = MY_APPLICATION(object);
   g_clear_pointer(&self->dart_entrypoint_arguments, g_strfreev);
+  if (self->window != nullptr) {
+    g_object_remove_weak_pointer(G_OBJECT(self->window),
+                                 reinterpret_cast<gpointer*>(&self->window));
+    self->window = nullptr;
+  }
+  if (self->view != nullptr) {
+    g_object_remove_weak_pointer(G_OBJECT(self->view),
+                                 reinterpret_cast<gpointer*>(&self->view));
+    self->view = nullptr;
+  }
   G_OBJECT_CLASS(my_application_parent_class)->dispose(object);
 }
 
 static void my_application_class_init(MyApplicationClass* klass) {
   G_APPLICATION_CLASS(klass)->activate = my_application_activate;
   G_APPLICATION_CLASS(klass)->local_command_line = my_application_local_command_line;
+  G_APPLICATION_CLASS(klass)->command_line = my_application_command_line;
   G_APPLICATION_CLASS(klass)->startup = my_application_startup;
   G_APPLICATION_CLASS(klass)->shutdown = my_application_shutdown;
   G_OBJECT_CLASS(klass)->dispose = my_application_dispose;
@@ -153,8 +270,10 @@ MyApplication* my_application_new() {
   // the application to be recognized beyond its binary name.
   g_set_prgname(APPLICATION_ID);
 
+  // Unique: launching again while running forwards the command line to the
+  // running instance (see my_application_command_line).
   return MY_APPLICATION(g_object_new(my_application_get_type(),
                                      "application-id", APPLICATION_ID,
-                                     "flags", G_APPLICATION_NON_UNIQUE,
+                                     "flags", G_APPLICATION_HANDLES_COMMAND_LINE,
                                      nullptr));
 }
@@ -0,0 +1,82 @@
+#include "native_plugins.h"
+
+#include <memory>
+
+#include "native/resource_monitor.h"
+#include "native/startup_trace.h"
+#include "plugins/conversation_store_plugin.h"
+#include "plugins/latency_metrics_plugin.h"
+#include "plugins/model_warmup_plugin.h"
+#include "plugins/ndjson_parser_plugin.h"
+#include "plugins/ollama_http_plugin.h"
+#include "plugins/resource_monitor_plugin.h"
+#include "plugins/token_counter_plugin.h"
+#include "plugins/tunnel_codec_plugin.h"
+
+using cloudtolocalllm::ResourceMonitor;
+using cloudtolocalllm::ScopedStartupTrace;
+
+void native_plugins_register(FlPluginRegistry* registry,
+                             cloudtolocalllm::TaskExecutor* executor,
+                             GtkWindow* window) {
+  // Sampled for the resource monitor channel and read by the warm-up.
+  auto resource_monitor = std::make_shared<ResourceMonitor>();
+
+  // Each plugin is traced like the pub ones in plugin_scheduler.cc.
+  {
+    ScopedStartupTrace trace("ConversationStorePlugin");
+    g_autoptr(FlPluginRegistrar) conversation_store_registrar =
+        fl_plugin_registry_get_registrar_for_plugin(registry,
+                                                    "ConversationStorePlugin");
+    conversation_store_plugin_register_with_registrar(
+        conversation_store_registrar);
+  }
+  {
+    ScopedStartupTrace trace("LatencyMetricsPlugin");
+    g_autoptr(FlPluginRegistrar) latency_metrics_registrar =
+        fl_plugin_registry_get_registrar_for_plugin(registry,
+                                                    "LatencyMetricsPlugin");
+    latency_metrics_plugin_register_with_registrar(latency_metrics_registrar);
+  }
+  {
+    ScopedStartupTrace trace("ModelWarmupPlugin");
+    g_autoptr(FlPluginRegistrar) model_warmup_registrar =
+        fl_plugin_registry_get_registrar_for_plugin(registry,
+                                                    "ModelWarmupPlugin");
+    model_warmup_plugin_register_with_registrar(model_warmup_registrar,
+                                                resource_monitor, window);
+  }
+  {
+    ScopedStartupTrace trace("NdjsonParserPlugin");
+    g_autoptr(FlPluginRegistrar) ndjson_parser_registrar =
+        fl_plugin_registry_get_registrar_for_plugin(registry, "NdjsonParserPlugin");
+    ndjson_parser_plugin_register_with_registrar(ndjson_parser_registrar);
+  }
+  {
+    ScopedStartupTrace trace("OllamaHttpPlugin");
+    g_autoptr(FlPluginRegistrar) ollama_http_registrar =
+        fl_plugin_registry_get_registrar_for_plugin(registry, "OllamaHttpPlugin");
+    ollama_http_plugin_register_with_registrar(ollama_http_registrar);
+  }
+  {
+    ScopedStartupTrace trace("ResourceMonitorPlugin");
+    g_autoptr(FlPluginRegistrar) resource_monitor_registrar =
+        fl_plugin_registry_get_registrar_for_plugin(registry,
+                                                    "ResourceMonitorPlugin");
+    resource_monitor_plugin_register_with_registrar(resource_monitor_registrar,
+                                                    resource_monitor);
+  }
+  {
+    ScopedStartupTrace trace("TokenCounterPlugin");
+    g_autoptr(FlPluginRegistrar) token_counter_registrar =
+        fl_plugin_registry_get_registrar_for_plugin(registry, "TokenCounterPlugin");
+    token_counter_plugin_register_with_registrar(token_counter_registrar,
+                                                 executor);
+  }
+  {
+    ScopedStartupTrace trace("TunnelCodecPlugin");
+    g_autoptr(FlPluginRegistrar) tunnel_codec_registrar =
+        fl_plugin_registry_get_registrar_for_plugin(registry, "TunnelCodecPlugin");
+    tunnel_codec_plugin_register_with_registrar(tunnel_codec_registrar);
+  }
+}
@@ -0,0 +1,24 @@
+#ifndef FLUTTER_NATIVE_PLUGINS_H_
+#define FLUTTER_NATIVE_PLUGINS_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <gtk/gtk.h>
+
+#include "native/task_executor.h"
+
+/**
+ * native_plugins_register:
+ * @registry: the #FlPluginRegistry of the view being created.
+ * @executor: runs the plugins' work; stopped in my_application_shutdown.
+ * @window: the window hosting the view, whose focus some plugins follow.
+ *
+ * Registers the runner's own native plugins, the ones implemented under
+ * runner/plugins on top of the shared native/ library rather than pulled in
+ * from pub packages. Call it right after plugin_scheduler_start(), which
+ * registers the pub plugins.
+ */
+void native_plugins_register(FlPluginRegistry* registry,
+                             cloudtolocalllm::TaskExecutor* executor,
+                             GtkWindow* window);
+
+#endif  // FLUTTER_NATIVE_PLUGINS_H_
@@ -0,0 +1,187 @@
+#include "plugin_scheduler.h"
+
+#include <flutter_secure_storage_x_linux/flutter_secure_storage_x_linux_plugin.h>
+#include <screen_retriever_linux/screen_retriever_linux_plugin.h>
+#include <tray_manager/tray_manager_plugin.h>
+#include <url_launcher_linux/url_launcher_plugin.h>
+#include <window_manager/window_manager_plugin.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "native/startup_trace.h"
+
+using cloudtolocalllm::ScopedStartupTrace;
+using cloudtolocalllm::StartupTrace;
+
+namespace {
+
+constexpr char kChannelName[] = "cloudtolocalllm/plugin_scheduler";
+constexpr uint8_t kAwaitDeferred = 1;
+
+// Deferred plugins are registered anyway if no frame is rendered by then.
+constexpr guint kFallbackSeconds = 3;
+
+struct ScheduledPlugin {
+  const char* name;
+  void (*register_with_registrar)(FlPluginRegistrar* registrar);
+  bool deferred;
+};
+
+// Every plugin in flutter/generated_plugins.cmake, critical ones first and
+// the rest in the order the app first needs them. The build fails if the
+// generated list changes without this table; see ../CMakeLists.txt.
+const ScheduledPlugin kPlugins[] = {
+    {"WindowManagerPlugin", window_manager_plugin_register_with_registrar,
+     false},
+    {"FlutterSecureStorageXLinuxPlugin",
+     flutter_secure_storage_x_linux_plugin_register_with_registrar, true},
+    {"TrayManagerPlugin", tray_manager_plugin_register_with_registrar, true},
+    {"ScreenRetrieverLinuxPlugin",
+     screen_retriever_linux_plugin_register_with_registrar, true},
+    {"UrlLauncherPlugin", url_launcher_plugin_register_with_registrar, true},
+};
+
+// State owned by the channel handler; freed when the messenger goes away.
+struct PluginScheduler {
+  // Held until the deferred plugins are registered, so the engine (and this
+  // state) outlive the idle callbacks.
+  FlView* view = nullptr;
+  FlBinaryMessenger* messenger = nullptr;
+  size_t next = 0;
+  bool started = false;
+  bool done = false;
+  gulong first_frame_handler = 0;
+  guint fallback_source = 0;
+  // Requests from Dart waiting for the deferred plugins.
+  std::vector<FlBinaryMessengerResponseHandle*> waiting;
+};
+
+void register_plugin(FlPluginRegistry* registry,
+                     const ScheduledPlugin& plugin) {
+  ScopedStartupTrace trace(plugin.name);
+  g_autoptr(FlPluginRegistrar) registrar =
+      fl_plugin_registry_get_registrar_for_plugin(registry, plugin.name);
+  plugin.register_with_registrar(registrar);
+}
+
+void respond(FlBinaryMessenger* messenger,
+             FlBinaryMessengerResponseHandle* response_handle) {
+  static const uint8_t kDone = 1;
+  g_autoptr(GBytes) response = g_bytes_new_static(&kDone, sizeof(kDone));
+  g_autoptr(GError) error = nullptr;
+  if (!fl_binary_messenger_send_response(messenger, response_handle, response,
+                                         &error)) {
+    g_warning("Failed to send plugin_scheduler response: %s", error->message);
+  }
+}
+
+// Registers one deferred plugin per main loop iteration, so input and
+// redraws get a turn in between.
+gboolean register_next_deferred(gpointer user_data) {
+  PluginScheduler* scheduler = static_cast<PluginScheduler*>(user_data);
+  while (scheduler->next < G_N_ELEMENTS(kPlugins) &&
+         !kPlugins[scheduler->next].deferred) {
+    scheduler->next++;
+  }
+  if (scheduler->next < G_N_ELEMENTS(kPlugins)) {
+    register_plugin(FL_PLUGIN_REGISTRY(scheduler->view),
+                    kPlugins[scheduler->next++]);
+    return G_SOURCE_CONTINUE;
+  }
+
+  scheduler->done = true;
+  StartupTrace::Get()->Instant("deferred plugins registered");
+  StartupTrace::Get()->Flush();
+  for (FlBinaryMessengerResponseHandle* response_handle : scheduler->waiting) {
+    respond(scheduler->messenger, response_handle);
+    g_object_unref(response_handle);
+  }
+  scheduler->waiting.clear();
+  g_clear_object(&scheduler->view);
+  return G_SOURCE_REMOVE;
+}
+
+void start_deferred(PluginScheduler* scheduler) {
+  if (scheduler->started) {
+    return;
+  }
+  scheduler->started = true;
+  if (scheduler->first_frame_handler != 0) {
+    g_signal_handler_disconnect(scheduler->view,
+                                scheduler->first_frame_handler);
+    scheduler->first_frame_handler = 0;
+  }
+  if (scheduler->fallback_source != 0) {
+    g_source_remove(scheduler->fallback_source);
+    scheduler->fallback_source = 0;
+  }
+  g_idle_add(register_next_deferred, scheduler);
+}
+
+void first_frame_cb(FlView* view, gpointer user_data) {
+  start_deferred(static_cast<PluginScheduler*>(user_data));
+}
+
+gboolean fallback_cb(gpointer user_data) {
+  PluginScheduler* scheduler = static_cast<PluginScheduler*>(user_data);
+  scheduler->fallback_source = 0;
+  start_deferred(scheduler);
+  return G_SOURCE_REMOVE;
+}
+
+void handle_message(FlBinaryMessenger* messenger, const gchar* channel,
+                    GBytes* message,
+                    FlBinaryMessengerResponseHandle* response_handle,
+                    gpointer user_data) {
+  PluginScheduler* scheduler = static_cast<PluginScheduler*>(user_data);
+
+  gsize size = 0;
+  const uint8_t* data =
+      message != nullptr
+          ? static_cast<const uint8_t*>(g_bytes_get_data(message, &size))
+          : nullptr;
+  if (size < 1 || data[0] != kAwaitDeferred) {
+    g_autoptr(GBytes) empty = g_bytes_new(nullptr, 0);
+    fl_binary_messenger_send_response(messenger, response_handle, empty,
+                                      nullptr);
+    return;
+  }
+  if (scheduler->done) {
+    respond(messenger, response_handle);
+    return;
+  }
+  scheduler->waiting.push_back(
+      FL_BINARY_MESSENGER_RESPONSE_HANDLE(g_object_ref(response_handle)));
+}
+
+void destroy_scheduler(gpointer user_data) {
+  PluginScheduler* scheduler = static_cast<PluginScheduler*>(user_data);
+  for (FlBinaryMessengerResponseHandle* response_handle : scheduler->waiting) {
+    g_object_unref(response_handle);
+  }
+  delete scheduler;
+}
+
+}  // namespace
+
+void plugin_scheduler_start(FlView* view) {
+  FlPluginRegistry* registry = FL_PLUGIN_REGISTRY(view);
+  for (const ScheduledPlugin& plugin : kPlugins) {
+    if (!plugin.deferred) {
+      register_plugin(registry, plugin);
+    }
+  }
+
+  PluginScheduler* scheduler = new PluginScheduler();
+  scheduler->view = FL_VIEW(g_object_ref(view));
+  scheduler->messenger =
+      fl_engine_get_binary_messenger(fl_view_get_engine(view));
+  scheduler->first_frame_handler = g_signal_connect(
+      view, "first-frame", G_CALLBACK(first_frame_cb), scheduler);
+  scheduler->fallback_source =
+      g_timeout_add_seconds(kFallbackSeconds, fallback_cb, scheduler);
+  fl_binary_messenger_set_message_handler_on_channel(
+      scheduler->messenger, kChannelName, handle_message, scheduler,
+      destroy_scheduler);
+}
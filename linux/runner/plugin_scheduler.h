@@ -0,0 +1,25 @@
+#ifndef FLUTTER_PLUGIN_SCHEDULER_H_
+#define FLUTTER_PLUGIN_SCHEDULER_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+/**
+ * plugin_scheduler_start:
+ * @view: the #FlView being created.
+ *
+ * Registers the pub plugins in place of fl_register_plugins(), which is
+ * regenerated by the Flutter tool and registers everything up front. Only
+ * window_manager, which the app needs before it can lay out its window, is
+ * registered right away. The rest, several of which make synchronous D-Bus
+ * and libsecret calls while registering, follow one per idle callback once
+ * @view has rendered its first frame, or after a few seconds if it never
+ * does (e.g. when the window starts hidden).
+ *
+ * Also handles the "cloudtolocalllm/plugin_scheduler" binary channel: a
+ * message with op 1 is answered with one byte once the deferred plugins are
+ * registered, which is what DeferredPlugins.ready waits for on the Dart
+ * side.
+ */
+void plugin_scheduler_start(FlView* view);
+
+#endif  // FLUTTER_PLUGIN_SCHEDULER_H_
@@ -0,0 +1,54 @@
+#include "plugins/conversation_store_plugin.h"
+
+#include <vector>
+
+#include "native/conversation_store_service.h"
+
+namespace {
+
+constexpr char kChannelName[] = "cloudtolocalllm/conversation_store";
+
+// State owned by the channel handler; freed when the handler is replaced or
+// the messenger goes away.
+struct ConversationStorePlugin {
+  cloudtolocalllm::ConversationStoreService service;
+  std::vector<uint8_t> reply;
+};
+
+void handle_message(FlBinaryMessenger* messenger, const gchar* channel,
+                    GBytes* message,
+                    FlBinaryMessengerResponseHandle* response_handle,
+                    gpointer user_data) {
+  ConversationStorePlugin* plugin =
+      static_cast<ConversationStorePlugin*>(user_data);
+
+  gsize size = 0;
+  const uint8_t* data =
+      message != nullptr
+          ? static_cast<const uint8_t*>(g_bytes_get_data(message, &size))
+          : nullptr;
+  plugin->service.HandleMessage(data, size, &plugin->reply);
+
+  g_autoptr(GBytes) response =
+      g_bytes_new(plugin->reply.data(), plugin->reply.size());
+  g_autoptr(GError) error = nullptr;
+  if (!fl_binary_messenger_send_response(messenger, response_handle, response,
+                                         &error)) {
+    g_warning("Failed to send conversation_store response: %s",
+              error->message);
+  }
+}
+
+void destroy_plugin(gpointer user_data) {
+  delete static_cast<ConversationStorePlugin*>(user_data);
+}
+
+}  // namespace
+
+void conversation_store_plugin_register_with_registrar(
+    FlPluginRegistrar* registrar) {
+  FlBinaryMessenger* messenger = fl_plugin_registrar_get_messenger(registrar);
+  fl_binary_messenger_set_message_handler_on_channel(
+      messenger, kChannelName, handle_message, new ConversationStorePlugin(),
+      destroy_plugin);
+}
@@ -0,0 +1,17 @@
+#ifndef RUNNER_PLUGINS_CONVERSATION_STORE_PLUGIN_H_
+#define RUNNER_PLUGINS_CONVERSATION_STORE_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+/**
+ * conversation_store_plugin_register_with_registrar:
+ * @registrar: an #FlPluginRegistrar.
+ *
+ * Handles the "cloudtolocalllm/conversation_store" binary channel, which
+ * keeps chat history in a memory-mapped append-only log. See
+ * native/conversation_store_service.h for the message layout.
+ */
+void conversation_store_plugin_register_with_registrar(
+    FlPluginRegistrar* registrar);
+
+#endif  // RUNNER_PLUGINS_CONVERSATION_STORE_PLUGIN_H_
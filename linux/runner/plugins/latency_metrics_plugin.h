@@ -0,0 +1,17 @@
+#ifndef RUNNER_PLUGINS_LATENCY_METRICS_PLUGIN_H_
+#define RUNNER_PLUGINS_LATENCY_METRICS_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+/**
+ * latency_metrics_plugin_register_with_registrar:
+ * @registrar: an #FlPluginRegistrar.
+ *
+ * Handles the "cloudtolocalllm/latency_metrics" binary channel, which reports
+ * time-to-first-token, inter-token and tunnel round-trip percentiles. See
+ * native/latency_metrics_service.h for the message layout.
+ */
+void latency_metrics_plugin_register_with_registrar(
+    FlPluginRegistrar* registrar);
+
+#endif  // RUNNER_PLUGINS_LATENCY_METRICS_PLUGIN_H_
@@ -0,0 +1,81 @@
+#include "plugins/model_warmup_plugin.h"
+
+#include <utility>
+#include <vector>
+
+#include "native/model_warmup_service.h"
+
+namespace {
+
+constexpr char kChannelName[] = "cloudtolocalllm/model_warmup";
+
+// State owned by the channel handler; freed when the handler is replaced or
+// the messenger goes away.
+struct ModelWarmupPlugin {
+  explicit ModelWarmupPlugin(
+      std::shared_ptr<const cloudtolocalllm::ResourceMonitor> monitor)
+      : service(std::move(monitor)) {}
+
+  cloudtolocalllm::ModelWarmupService service;
+  std::vector<uint8_t> reply;
+  // Weak pointer, cleared when the window is destroyed.
+  GtkWindow* window = nullptr;
+  gulong focus_handler = 0;
+};
+
+gboolean focus_in_cb(GtkWidget* widget, GdkEventFocus* event,
+                     gpointer user_data) {
+  ModelWarmupPlugin* plugin = static_cast<ModelWarmupPlugin*>(user_data);
+  plugin->service.warmup()->Warm(cloudtolocalllm::WarmupTrigger::kFocus);
+  return FALSE;
+}
+
+void handle_message(FlBinaryMessenger* messenger, const gchar* channel,
+                    GBytes* message,
+                    FlBinaryMessengerResponseHandle* response_handle,
+                    gpointer user_data) {
+  ModelWarmupPlugin* plugin = static_cast<ModelWarmupPlugin*>(user_data);
+
+  gsize size = 0;
+  const uint8_t* data =
+      message != nullptr
+          ? static_cast<const uint8_t*>(g_bytes_get_data(message, &size))
+          : nullptr;
+  plugin->service.HandleMessage(data, size, &plugin->reply);
+
+  g_autoptr(GBytes) response =
+      g_bytes_new(plugin->reply.data(), plugin->reply.size());
+  g_autoptr(GError) error = nullptr;
+  if (!fl_binary_messenger_send_response(messenger, response_handle, response,
+                                         &error)) {
+    g_warning("Failed to send model_warmup response: %s", error->message);
+  }
+}
+
+void destroy_plugin(gpointer user_data) {
+  ModelWarmupPlugin* plugin = static_cast<ModelWarmupPlugin*>(user_data);
+  if (plugin->window != nullptr) {
+    g_signal_handler_disconnect(plugin->window, plugin->focus_handler);
+    g_object_remove_weak_pointer(G_OBJECT(plugin->window),
+                                 reinterpret_cast<gpointer*>(&plugin->window));
+  }
+  delete plugin;
+}
+
+}  // namespace
+
+void model_warmup_plugin_register_with_registrar(
+    FlPluginRegistrar* registrar,
+    std::shared_ptr<const cloudtolocalllm::ResourceMonitor> monitor,
+    GtkWindow* window) {
+  ModelWarmupPlugin* plugin = new ModelWarmupPlugin(std::move(monitor));
+  plugin->window = window;
+  g_object_add_weak_pointer(G_OBJECT(window),
+                            reinterpret_cast<gpointer*>(&plugin->window));
+  plugin->focus_handler = g_signal_connect(
+      window, "focus-in-event", G_CALLBACK(focus_in_cb), plugin);
+
+  FlBinaryMessenger* messenger = fl_plugin_registrar_get_messenger(registrar);
+  fl_binary_messenger_set_message_handler_on_channel(
+      messenger, kChannelName, handle_message, plugin, destroy_plugin);
+}
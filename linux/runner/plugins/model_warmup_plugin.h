@@ -0,0 +1,27 @@
+#ifndef RUNNER_PLUGINS_MODEL_WARMUP_PLUGIN_H_
+#define RUNNER_PLUGINS_MODEL_WARMUP_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <gtk/gtk.h>
+
+#include <memory>
+
+#include "native/resource_monitor.h"
+
+/**
+ * model_warmup_plugin_register_with_registrar:
+ * @registrar: an #FlPluginRegistrar.
+ * @monitor: checked for room before each warm-up.
+ * @window: the application window; each focus-in warms the model,
+ * cooldown permitting.
+ *
+ * Handles the "cloudtolocalllm/model_warmup" binary channel, which keeps
+ * the last-used Ollama model loaded ahead of the first chat. See
+ * native/model_warmup_service.h for the message layout.
+ */
+void model_warmup_plugin_register_with_registrar(
+    FlPluginRegistrar* registrar,
+    std::shared_ptr<const cloudtolocalllm::ResourceMonitor> monitor,
+    GtkWindow* window);
+
+#endif  // RUNNER_PLUGINS_MODEL_WARMUP_PLUGIN_H_
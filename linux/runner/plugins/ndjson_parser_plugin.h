@@ -0,0 +1,16 @@
+#ifndef RUNNER_PLUGINS_NDJSON_PARSER_PLUGIN_H_
+#define RUNNER_PLUGINS_NDJSON_PARSER_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+/**
+ * ndjson_parser_plugin_register_with_registrar:
+ * @registrar: an #FlPluginRegistrar.
+ *
+ * Handles the "cloudtolocalllm/ndjson_parser" binary channel, which turns raw
+ * Ollama /api/chat response bytes into batched token deltas. See
+ * native/ndjson_parser_service.h for the message layout.
+ */
+void ndjson_parser_plugin_register_with_registrar(FlPluginRegistrar* registrar);
+
+#endif  // RUNNER_PLUGINS_NDJSON_PARSER_PLUGIN_H_
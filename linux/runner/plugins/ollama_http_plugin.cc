@@ -0,0 +1,170 @@
+#include "plugins/ollama_http_plugin.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "native/http_stream_service.h"
+#include "native/local_broker.h"
+
+namespace {
+
+constexpr char kChannelName[] = "cloudtolocalllm/ollama_http";
+constexpr char kEventChannelName[] = "cloudtolocalllm/ollama_http/events";
+
+// Event bytes wrapped by a GBytes without copying; handed back to the
+// service's buffer pool when the GBytes is freed.
+struct EventBuffer {
+  std::vector<uint8_t> bytes;
+  std::shared_ptr<cloudtolocalllm::FrameBufferPool> pool;
+};
+
+void free_event_buffer(gpointer user_data) {
+  EventBuffer* buffer = static_cast<EventBuffer*>(user_data);
+  buffer->pool->Release(std::move(buffer->bytes));
+  delete buffer;
+}
+
+// An event produced on the worker thread, waiting to be sent from the main
+// loop. Holds its own reference to the messenger so it stays valid even if
+// the plugin is torn down first.
+struct PendingEvent {
+  FlBinaryMessenger* messenger;
+  GBytes* bytes;
+};
+
+gboolean send_event(gpointer user_data) {
+  PendingEvent* event = static_cast<PendingEvent*>(user_data);
+  fl_binary_messenger_send_on_channel(event->messenger, kEventChannelName,
+                                      event->bytes, nullptr, nullptr, nullptr);
+  return G_SOURCE_REMOVE;
+}
+
+void free_event(gpointer user_data) {
+  PendingEvent* event = static_cast<PendingEvent*>(user_data);
+  g_bytes_unref(event->bytes);
+  g_object_unref(event->messenger);
+  delete event;
+}
+
+struct OllamaHttpPlugin;
+
+// A broker request on its way from the broker's thread to the service on
+// the main loop. |alive| is cleared when the plugin is torn down.
+struct PendingUpstream {
+  OllamaHttpPlugin* plugin;
+  std::shared_ptr<bool> alive;
+  uint64_t id;
+  std::vector<uint8_t> message;
+};
+
+gboolean send_upstream(gpointer user_data);
+
+void free_upstream(gpointer user_data) {
+  delete static_cast<PendingUpstream*>(user_data);
+}
+
+// State owned by the channel handler; freed when the handler is replaced or
+// the messenger goes away.
+struct OllamaHttpPlugin {
+  explicit OllamaHttpPlugin(FlBinaryMessenger* messenger)
+      : alive(std::make_shared<bool>(true)),
+        service([this, messenger](std::vector<uint8_t> bytes) {
+          if (broker.HandleEvent(bytes.data(), bytes.size())) {
+            service.RecycleEvent(std::move(bytes));
+            return;
+          }
+          EventBuffer* buffer = new EventBuffer();
+          buffer->bytes = std::move(bytes);
+          buffer->pool = service.buffer_pool();
+          PendingEvent* event = new PendingEvent();
+          event->messenger = FL_BINARY_MESSENGER(g_object_ref(messenger));
+          event->bytes =
+              g_bytes_new_with_free_func(buffer->bytes.data(),
+                                         buffer->bytes.size(),
+                                         free_event_buffer, buffer);
+          g_main_context_invoke_full(nullptr, G_PRIORITY_DEFAULT, send_event,
+                                     event, free_event);
+        }),
+        broker([this](uint64_t id, std::vector<uint8_t> message) {
+          PendingUpstream* pending = new PendingUpstream();
+          pending->plugin = this;
+          pending->alive = alive;
+          pending->id = id;
+          pending->message = std::move(message);
+          g_main_context_invoke_full(nullptr, G_PRIORITY_DEFAULT,
+                                     send_upstream, pending, free_upstream);
+        }) {
+    std::string error;
+    if (!broker.Start(&error)) {
+      g_warning("Local Ollama broker not started: %s", error.c_str());
+    }
+  }
+
+  ~OllamaHttpPlugin() {
+    // The broker's thread goes first, so nothing reaches the service once
+    // it has shut down.
+    broker.Stop();
+    service.Shutdown();
+    *alive = false;
+  }
+
+  std::shared_ptr<bool> alive;
+  cloudtolocalllm::HttpStreamService service;
+  cloudtolocalllm::LocalBroker broker;
+  std::vector<uint8_t> reply;
+  std::vector<uint8_t> upstream_reply;
+};
+
+gboolean send_upstream(gpointer user_data) {
+  PendingUpstream* pending = static_cast<PendingUpstream*>(user_data);
+  if (!*pending->alive) {
+    return G_SOURCE_REMOVE;
+  }
+  OllamaHttpPlugin* plugin = pending->plugin;
+  plugin->service.HandleMessage(pending->message.data(),
+                                pending->message.size(),
+                                &plugin->upstream_reply);
+  if (plugin->upstream_reply.empty() && !pending->message.empty() &&
+      pending->message[0] == cloudtolocalllm::HttpStreamService::kStart) {
+    plugin->broker.OnRejected(pending->id);
+  }
+  return G_SOURCE_REMOVE;
+}
+
+void handle_message(FlBinaryMessenger* messenger, const gchar* channel,
+                    GBytes* message,
+                    FlBinaryMessengerResponseHandle* response_handle,
+                    gpointer user_data) {
+  OllamaHttpPlugin* plugin = static_cast<OllamaHttpPlugin*>(user_data);
+
+  gsize size = 0;
+  const uint8_t* data =
+      message != nullptr
+          ? static_cast<const uint8_t*>(g_bytes_get_data(message, &size))
+          : nullptr;
+  plugin->service.HandleMessage(data, size, &plugin->reply);
+
+  g_autoptr(GBytes) response =
+      g_bytes_new(plugin->reply.data(), plugin->reply.size());
+  g_autoptr(GError) error = nullptr;
+  if (!fl_binary_messenger_send_response(messenger, response_handle, response,
+                                         &error)) {
+    g_warning("Failed to send ollama_http response: %s", error->message);
+  }
+}
+
+void destroy_plugin(gpointer user_data) {
+  // Joins the broker's and the worker threads before the service goes away.
+  delete static_cast<OllamaHttpPlugin*>(user_data);
+}
+
+}  // namespace
+
+void ollama_http_plugin_register_with_registrar(FlPluginRegistrar* registrar) {
+  FlBinaryMessenger* messenger = fl_plugin_registrar_get_messenger(registrar);
+  fl_binary_messenger_set_message_handler_on_channel(
+      messenger, kChannelName, handle_message, new OllamaHttpPlugin(messenger),
+      destroy_plugin);
+}
@@ -0,0 +1,20 @@
+#ifndef RUNNER_PLUGINS_OLLAMA_HTTP_PLUGIN_H_
+#define RUNNER_PLUGINS_OLLAMA_HTTP_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+/**
+ * ollama_http_plugin_register_with_registrar:
+ * @registrar: an #FlPluginRegistrar.
+ *
+ * Handles the "cloudtolocalllm/ollama_http" binary channel, which streams
+ * HTTP requests to the local Ollama server from a native worker thread and
+ * reports progress on "cloudtolocalllm/ollama_http/events". See
+ * native/http_stream_service.h for the message layout.
+ *
+ * The same service also answers other local processes through a
+ * LocalBroker; see native/local_broker.h.
+ */
+void ollama_http_plugin_register_with_registrar(FlPluginRegistrar* registrar);
+
+#endif  // RUNNER_PLUGINS_OLLAMA_HTTP_PLUGIN_H_
@@ -0,0 +1,61 @@
+#include "plugins/resource_monitor_plugin.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "native/resource_monitor_service.h"
+
+namespace {
+
+constexpr char kChannelName[] = "cloudtolocalllm/resource_monitor";
+
+// State owned by the channel handler; freed when the handler is replaced or
+// the messenger goes away.
+struct ResourceMonitorPlugin {
+  explicit ResourceMonitorPlugin(
+      std::shared_ptr<cloudtolocalllm::ResourceMonitor> monitor)
+      : service(std::move(monitor)) {}
+
+  cloudtolocalllm::ResourceMonitorService service;
+  std::vector<uint8_t> reply;
+};
+
+void handle_message(FlBinaryMessenger* messenger, const gchar* channel,
+                    GBytes* message,
+                    FlBinaryMessengerResponseHandle* response_handle,
+                    gpointer user_data) {
+  ResourceMonitorPlugin* plugin =
+      static_cast<ResourceMonitorPlugin*>(user_data);
+
+  gsize size = 0;
+  const uint8_t* data =
+      message != nullptr
+          ? static_cast<const uint8_t*>(g_bytes_get_data(message, &size))
+          : nullptr;
+  plugin->service.HandleMessage(data, size, &plugin->reply);
+
+  g_autoptr(GBytes) response =
+      g_bytes_new(plugin->reply.data(), plugin->reply.size());
+  g_autoptr(GError) error = nullptr;
+  if (!fl_binary_messenger_send_response(messenger, response_handle, response,
+                                         &error)) {
+    g_warning("Failed to send resource_monitor response: %s",
+              error->message);
+  }
+}
+
+void destroy_plugin(gpointer user_data) {
+  delete static_cast<ResourceMonitorPlugin*>(user_data);
+}
+
+}  // namespace
+
+void resource_monitor_plugin_register_with_registrar(
+    FlPluginRegistrar* registrar,
+    std::shared_ptr<cloudtolocalllm::ResourceMonitor> monitor) {
+  FlBinaryMessenger* messenger = fl_plugin_registrar_get_messenger(registrar);
+  fl_binary_messenger_set_message_handler_on_channel(
+      messenger, kChannelName, handle_message,
+      new ResourceMonitorPlugin(std::move(monitor)), destroy_plugin);
+}
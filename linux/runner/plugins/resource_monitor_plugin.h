@@ -0,0 +1,23 @@
+#ifndef RUNNER_PLUGINS_RESOURCE_MONITOR_PLUGIN_H_
+#define RUNNER_PLUGINS_RESOURCE_MONITOR_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <memory>
+
+#include "native/resource_monitor.h"
+
+/**
+ * resource_monitor_plugin_register_with_registrar:
+ * @registrar: an #FlPluginRegistrar.
+ * @monitor: the sampler to report, shared with the model warm-up.
+ *
+ * Handles the "cloudtolocalllm/resource_monitor" binary channel, which reports
+ * the host's CPU, memory and GPU headroom. See
+ * native/resource_monitor_service.h for the message layout.
+ */
+void resource_monitor_plugin_register_with_registrar(
+    FlPluginRegistrar* registrar,
+    std::shared_ptr<cloudtolocalllm::ResourceMonitor> monitor);
+
+#endif  // RUNNER_PLUGINS_RESOURCE_MONITOR_PLUGIN_H_
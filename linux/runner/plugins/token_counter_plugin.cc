@@ -0,0 +1,115 @@
+#include "plugins/token_counter_plugin.h"
+
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "native/token_counter_service.h"
+
+namespace {
+
+constexpr char kChannelName[] = "cloudtolocalllm/token_counter";
+
+// State shared by the channel handler and the requests in flight on the
+// executor, so it outlives whichever finishes last.
+struct TokenCounterState {
+  // Requests may run on several workers at once.
+  std::mutex mutex;
+  cloudtolocalllm::TokenCounterService service;
+};
+
+// Owned by the channel handler; freed when the handler is replaced or the
+// messenger goes away.
+struct TokenCounterPlugin {
+  std::shared_ptr<TokenCounterState> state;
+  cloudtolocalllm::TaskExecutor* executor;
+};
+
+// Where a reply goes. Holds its own references so it stays valid even if
+// the plugin is torn down first, or the request is dropped unanswered when
+// the executor stops.
+struct ResponseTarget {
+  ResponseTarget(FlBinaryMessenger* messenger,
+                 FlBinaryMessengerResponseHandle* response_handle)
+      : messenger(FL_BINARY_MESSENGER(g_object_ref(messenger))),
+        response_handle(FL_BINARY_MESSENGER_RESPONSE_HANDLE(
+            g_object_ref(response_handle))) {}
+  ~ResponseTarget() {
+    g_object_unref(response_handle);
+    g_object_unref(messenger);
+  }
+
+  FlBinaryMessenger* messenger;
+  FlBinaryMessengerResponseHandle* response_handle;
+};
+
+// A reply produced on a worker, waiting to be sent from the main loop.
+struct PendingResponse {
+  std::shared_ptr<ResponseTarget> target;
+  GBytes* bytes;
+};
+
+gboolean send_response(gpointer user_data) {
+  PendingResponse* pending = static_cast<PendingResponse*>(user_data);
+  g_autoptr(GError) error = nullptr;
+  if (!fl_binary_messenger_send_response(pending->target->messenger,
+                                         pending->target->response_handle,
+                                         pending->bytes, &error)) {
+    g_warning("Failed to send token_counter response: %s", error->message);
+  }
+  return G_SOURCE_REMOVE;
+}
+
+void free_response(gpointer user_data) {
+  PendingResponse* pending = static_cast<PendingResponse*>(user_data);
+  g_bytes_unref(pending->bytes);
+  delete pending;
+}
+
+void handle_message(FlBinaryMessenger* messenger, const gchar* channel,
+                    GBytes* message,
+                    FlBinaryMessengerResponseHandle* response_handle,
+                    gpointer user_data) {
+  TokenCounterPlugin* plugin =
+      static_cast<TokenCounterPlugin*>(user_data);
+
+  gsize size = 0;
+  const uint8_t* data =
+      message != nullptr
+          ? static_cast<const uint8_t*>(g_bytes_get_data(message, &size))
+          : nullptr;
+  std::vector<uint8_t> request(data, data + size);
+  auto target = std::make_shared<ResponseTarget>(messenger, response_handle);
+  plugin->executor->Post(
+      [state = plugin->state, request = std::move(request), target]() {
+        std::vector<uint8_t> reply;
+        {
+          std::lock_guard<std::mutex> lock(state->mutex);
+          state->service.HandleMessage(request.data(), request.size(),
+                                       &reply);
+        }
+        PendingResponse* pending = new PendingResponse();
+        pending->target = target;
+        pending->bytes = g_bytes_new(reply.data(), reply.size());
+        g_main_context_invoke_full(nullptr, G_PRIORITY_DEFAULT, send_response,
+                                   pending, free_response);
+      },
+      cloudtolocalllm::TaskExecutor::Lane::kInteractive);
+}
+
+void destroy_plugin(gpointer user_data) {
+  delete static_cast<TokenCounterPlugin*>(user_data);
+}
+
+}  // namespace
+
+void token_counter_plugin_register_with_registrar(
+    FlPluginRegistrar* registrar, cloudtolocalllm::TaskExecutor* executor) {
+  FlBinaryMessenger* messenger = fl_plugin_registrar_get_messenger(registrar);
+  TokenCounterPlugin* plugin = new TokenCounterPlugin();
+  plugin->state = std::make_shared<TokenCounterState>();
+  plugin->executor = executor;
+  fl_binary_messenger_set_message_handler_on_channel(
+      messenger, kChannelName, handle_message, plugin, destroy_plugin);
+}
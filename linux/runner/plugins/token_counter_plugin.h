@@ -0,0 +1,24 @@
+#ifndef RUNNER_PLUGINS_TOKEN_COUNTER_PLUGIN_H_
+#define RUNNER_PLUGINS_TOKEN_COUNTER_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include "native/task_executor.h"
+
+/**
+ * token_counter_plugin_register_with_registrar:
+ * @registrar: an #FlPluginRegistrar.
+ * @executor: runs the requests; see native/task_executor.h.
+ *
+ * Handles the "cloudtolocalllm/token_counter" binary channel, which counts
+ * prompt tokens with the vocabulary of a model's GGUF file. See
+ * native/token_counter_service.h for the message layout.
+ *
+ * Loading a vocabulary and counting a long prompt take milliseconds, so
+ * requests run on @executor's interactive lane and the replies are sent
+ * from the main loop.
+ */
+void token_counter_plugin_register_with_registrar(
+    FlPluginRegistrar* registrar, cloudtolocalllm::TaskExecutor* executor);
+
+#endif  // RUNNER_PLUGINS_TOKEN_COUNTER_PLUGIN_H_
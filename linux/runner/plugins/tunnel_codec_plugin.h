@@ -0,0 +1,16 @@
+#ifndef RUNNER_PLUGINS_TUNNEL_CODEC_PLUGIN_H_
+#define RUNNER_PLUGINS_TUNNEL_CODEC_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+/**
+ * tunnel_codec_plugin_register_with_registrar:
+ * @registrar: an #FlPluginRegistrar.
+ *
+ * Handles the "cloudtolocalllm/tunnel_codec" binary channel, which seals and
+ * opens encrypted tunnel frames with ChaCha20-Poly1305. See
+ * native/tunnel_codec_service.h for the message layout.
+ */
+void tunnel_codec_plugin_register_with_registrar(FlPluginRegistrar* registrar);
+
+#endif  // RUNNER_PLUGINS_TUNNEL_CODEC_PLUGIN_H_
@@ -0,0 +1,288 @@
+#include "window_icon.h"
+
+#include <algorithm>
+#include <cerrno>
+
+namespace {
+
+// Decoded straight to this size; window managers scale it from there.
+constexpr int kIconSize = 128;
+
+constexpr char kCacheDirName[] = "cloudtolocalllm";
+constexpr char kCachedIconName[] = "window-icon-128.png";
+// "<resolved source path>\n<source mtime>\n"
+constexpr char kCachedSourceName[] = "window-icon-source";
+
+// Tried in order; the first that exists wins.
+const char* const kIconPaths[] = {
+    "data/flutter_assets/assets/images/app_icon.png",
+    "assets/images/app_icon.png",
+    "/usr/share/pixmaps/cloudtolocalllm.png",
+    "/usr/share/icons/hicolor/128x128/apps/cloudtolocalllm.png",
+};
+constexpr size_t kIconPathCount = G_N_ELEMENTS(kIconPaths);
+
+struct IconLoad {
+  GtkWindow* window = nullptr;
+  GCancellable* cancellable = nullptr;
+  gulong destroy_handler = 0;
+  gchar* cache_dir = nullptr;
+
+  // Whether the pixbuf being decoded comes from the cache.
+  bool from_cache = false;
+  // Probe results, indexed like kIconPaths; a zero mtime means missing.
+  guint64 probed_mtimes[kIconPathCount] = {};
+  size_t pending_probes = 0;
+  gchar* source_path = nullptr;
+  guint64 source_mtime = 0;
+};
+
+struct ProbeData {
+  IconLoad* load;
+  size_t index;
+};
+
+struct CacheWrite {
+  GdkPixbuf* pixbuf;
+  gchar* cache_dir;
+  gchar* source;
+};
+
+void probe_candidates(IconLoad* load);
+
+gchar* cache_file(IconLoad* load, const char* name) {
+  return g_build_filename(load->cache_dir, name, nullptr);
+}
+
+void finish(IconLoad* load) {
+  if (load->destroy_handler != 0) {
+    g_signal_handler_disconnect(load->window, load->destroy_handler);
+  }
+  g_object_unref(load->window);
+  g_object_unref(load->cancellable);
+  g_free(load->cache_dir);
+  g_free(load->source_path);
+  delete load;
+}
+
+// Cancellation is expected when the window goes away first.
+void report_error(const char* what, GError* error) {
+  if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    g_warning("Failed to %s: %s", what, error->message);
+  }
+}
+
+void window_destroy_cb(GtkWidget* widget, gpointer user_data) {
+  IconLoad* load = static_cast<IconLoad*>(user_data);
+  load->destroy_handler = 0;
+  g_cancellable_cancel(load->cancellable);
+}
+
+// Runs on a worker thread, so encoding and writing the cache never hold up
+// the main loop.
+void write_cache_thread(GTask* task, gpointer source_object,
+                        gpointer task_data, GCancellable* cancellable) {
+  CacheWrite* write = static_cast<CacheWrite*>(task_data);
+  g_autoptr(GError) error = nullptr;
+  g_autofree gchar* buffer = nullptr;
+  gsize size = 0;
+  g_autofree gchar* icon_path =
+      g_build_filename(write->cache_dir, kCachedIconName, nullptr);
+  g_autofree gchar* source_path =
+      g_build_filename(write->cache_dir, kCachedSourceName, nullptr);
+  // The source record goes last, so a half-written cache is never trusted.
+  if (g_mkdir_with_parents(write->cache_dir, 0700) != 0 ||
+      !gdk_pixbuf_save_to_buffer(write->pixbuf, &buffer, &size, "png", &error,
+                                 nullptr) ||
+      !g_file_set_contents(icon_path, buffer, size, &error) ||
+      !g_file_set_contents(source_path, write->source, -1, &error)) {
+    g_debug("Failed to cache window icon: %s",
+            error != nullptr ? error->message : g_strerror(errno));
+  }
+  g_task_return_boolean(task, TRUE);
+}
+
+void free_cache_write(gpointer data) {
+  CacheWrite* write = static_cast<CacheWrite*>(data);
+  g_object_unref(write->pixbuf);
+  g_free(write->cache_dir);
+  g_free(write->source);
+  delete write;
+}
+
+void write_cache(IconLoad* load, GdkPixbuf* pixbuf) {
+  CacheWrite* write = new CacheWrite();
+  write->pixbuf = GDK_PIXBUF(g_object_ref(pixbuf));
+  write->cache_dir = g_strdup(load->cache_dir);
+  write->source = g_strdup_printf("%s\n%" G_GUINT64_FORMAT "\n",
+                                  load->source_path, load->source_mtime);
+  g_autoptr(GTask) task = g_task_new(nullptr, nullptr, nullptr, nullptr);
+  g_task_set_task_data(task, write, free_cache_write);
+  g_task_run_in_thread(task, write_cache_thread);
+}
+
+void pixbuf_loaded_cb(GObject* source, GAsyncResult* result,
+                      gpointer user_data) {
+  IconLoad* load = static_cast<IconLoad*>(user_data);
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(GdkPixbuf) pixbuf = gdk_pixbuf_new_from_stream_finish(result, &error);
+  if (pixbuf == nullptr) {
+    if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+      finish(load);
+    } else if (load->from_cache) {
+      // A damaged cache entry; decode the source instead.
+      probe_candidates(load);
+    } else {
+      report_error("decode window icon", error);
+      finish(load);
+    }
+    return;
+  }
+
+  gtk_window_set_icon(load->window, pixbuf);
+  if (!load->from_cache) {
+    write_cache(load, pixbuf);
+  }
+  finish(load);
+}
+
+void decode(IconLoad* load, GInputStream* stream) {
+  gdk_pixbuf_new_from_stream_at_scale_async(stream, kIconSize, kIconSize, TRUE,
+                                            load->cancellable,
+                                            pixbuf_loaded_cb, load);
+}
+
+void stream_opened_cb(GObject* source, GAsyncResult* result,
+                      gpointer user_data) {
+  IconLoad* load = static_cast<IconLoad*>(user_data);
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(GFileInputStream) stream =
+      g_file_read_finish(G_FILE(source), result, &error);
+  if (stream != nullptr) {
+    decode(load, G_INPUT_STREAM(stream));
+  } else if (load->from_cache &&
+             !g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    probe_candidates(load);
+  } else {
+    report_error("open window icon", error);
+    finish(load);
+  }
+}
+
+void open_and_decode(IconLoad* load, const gchar* path, bool from_cache) {
+  load->from_cache = from_cache;
+  g_autoptr(GFile) file = g_file_new_for_path(path);
+  g_file_read_async(file, G_PRIORITY_DEFAULT, load->cancellable,
+                    stream_opened_cb, load);
+}
+
+void probe_cb(GObject* source, GAsyncResult* result, gpointer user_data) {
+  ProbeData* probe = static_cast<ProbeData*>(user_data);
+  IconLoad* load = probe->load;
+  g_autoptr(GFileInfo) info =
+      g_file_query_info_finish(G_FILE(source), result, nullptr);
+  if (info != nullptr &&
+      g_file_info_get_file_type(info) == G_FILE_TYPE_REGULAR) {
+    load->probed_mtimes[probe->index] = std::max<guint64>(
+        1, g_file_info_get_attribute_uint64(info,
+                                            G_FILE_ATTRIBUTE_TIME_MODIFIED));
+  }
+  delete probe;
+  if (--load->pending_probes > 0) {
+    return;
+  }
+
+  if (g_cancellable_is_cancelled(load->cancellable)) {
+    finish(load);
+    return;
+  }
+  for (size_t i = 0; i < kIconPathCount; i++) {
+    if (load->probed_mtimes[i] != 0) {
+      g_free(load->source_path);
+      load->source_path = g_strdup(kIconPaths[i]);
+      load->source_mtime = load->probed_mtimes[i];
+      open_and_decode(load, load->source_path, false);
+      return;
+    }
+  }
+  g_warning("Failed to load window icon from any path");
+  finish(load);
+}
+
+// Queries every candidate at once, so a slow mount costs one round trip
+// rather than one per path.
+void probe_candidates(IconLoad* load) {
+  load->pending_probes = kIconPathCount;
+  for (size_t i = 0; i < kIconPathCount; i++) {
+    load->probed_mtimes[i] = 0;
+    g_autoptr(GFile) file = g_file_new_for_path(kIconPaths[i]);
+    g_file_query_info_async(
+        file, G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_TIME_MODIFIED,
+        G_FILE_QUERY_INFO_NONE, G_PRIORITY_DEFAULT, load->cancellable,
+        probe_cb, new ProbeData{load, i});
+  }
+}
+
+void cached_source_checked_cb(GObject* source, GAsyncResult* result,
+                              gpointer user_data) {
+  IconLoad* load = static_cast<IconLoad*>(user_data);
+  g_autoptr(GFileInfo) info =
+      g_file_query_info_finish(G_FILE(source), result, nullptr);
+  if (g_cancellable_is_cancelled(load->cancellable)) {
+    finish(load);
+    return;
+  }
+  if (info != nullptr &&
+      g_file_info_get_attribute_uint64(info, G_FILE_ATTRIBUTE_TIME_MODIFIED) ==
+          load->source_mtime) {
+    g_autofree gchar* cached_icon = cache_file(load, kCachedIconName);
+    open_and_decode(load, cached_icon, true);
+  } else {
+    probe_candidates(load);
+  }
+}
+
+void cached_source_loaded_cb(GObject* source, GAsyncResult* result,
+                             gpointer user_data) {
+  IconLoad* load = static_cast<IconLoad*>(user_data);
+  g_autofree gchar* contents = nullptr;
+  gsize length = 0;
+  if (!g_file_load_contents_finish(G_FILE(source), result, &contents, &length,
+                                   nullptr, nullptr)) {
+    if (g_cancellable_is_cancelled(load->cancellable)) {
+      finish(load);
+    } else {
+      probe_candidates(load);
+    }
+    return;
+  }
+
+  g_auto(GStrv) lines = g_strsplit(contents, "\n", 3);
+  if (lines[0] == nullptr || lines[0][0] == '\0' || lines[1] == nullptr) {
+    probe_candidates(load);
+    return;
+  }
+  load->source_path = g_strdup(lines[0]);
+  load->source_mtime = g_ascii_strtoull(lines[1], nullptr, 10);
+  g_autoptr(GFile) file = g_file_new_for_path(load->source_path);
+  g_file_query_info_async(file, G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                          G_FILE_QUERY_INFO_NONE, G_PRIORITY_DEFAULT,
+                          load->cancellable, cached_source_checked_cb, load);
+}
+
+}  // namespace
+
+void window_icon_load_async(GtkWindow* window) {
+  IconLoad* load = new IconLoad();
+  load->window = GTK_WINDOW(g_object_ref(window));
+  load->cancellable = g_cancellable_new();
+  load->destroy_handler = g_signal_connect(
+      window, "destroy", G_CALLBACK(window_destroy_cb), load);
+  load->cache_dir =
+      g_build_filename(g_get_user_cache_dir(), kCacheDirName, nullptr);
+
+  g_autofree gchar* cached_source = cache_file(load, kCachedSourceName);
+  g_autoptr(GFile) file = g_file_new_for_path(cached_source);
+  g_file_load_contents_async(file, load->cancellable, cached_source_loaded_cb,
+                             load);
+}
@@ -0,0 +1,23 @@
+#ifndef FLUTTER_WINDOW_ICON_H_
+#define FLUTTER_WINDOW_ICON_H_
+
+#include <gtk/gtk.h>
+
+/**
+ * window_icon_load_async:
+ * @window: the #GtkWindow to set the icon on.
+ *
+ * Sets the application icon on @window without blocking the main loop on
+ * disk I/O, so the window can be shown straight away even when the icon
+ * lives on a slow or network-mounted file system.
+ *
+ * The first launch probes the candidate icon paths in parallel, decodes the
+ * first one found at window icon size, and caches that pixbuf together with
+ * the resolved path and its modification time under
+ * $XDG_CACHE_HOME/cloudtolocalllm. Later launches check the recorded path is
+ * unchanged and load the small cached PNG instead. Loading is cancelled if
+ * @window is destroyed first.
+ */
+void window_icon_load_async(GtkWindow* window);
+
+#endif  // FLUTTER_WINDOW_ICON_H_
@@ -0,0 +1,34 @@
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "native/benchmarks/native_benchmarks.h"
+#include "native/benchmarks/ollama_streams.h"
+
+// Usage: native_benchmarks [--benchmark_...] [recorded.ndjson ...]
+//
+// Any argument left over once Google Benchmark has taken its flags is read
+// as a captured /api/chat body and replayed alongside the built-in streams.
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+
+  std::vector<cloudtolocalllm::OllamaStream> streams =
+      cloudtolocalllm::BuiltinOllamaStreams();
+  for (int i = 1; i < argc; i++) {
+    cloudtolocalllm::OllamaStream stream;
+    if (!cloudtolocalllm::LoadOllamaStream(argv[i], &stream)) {
+      std::fprintf(stderr, "No Ollama stream in %s\n", argv[i]);
+      return 1;
+    }
+    streams.push_back(std::move(stream));
+  }
+  cloudtolocalllm::RegisterNdjsonBenchmarks(streams);
+  cloudtolocalllm::RegisterTunnelBenchmarks(streams);
+  cloudtolocalllm::RegisterMarkdownBenchmarks(streams);
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "native/benchmarks/ollama_streams.h"
+#include "native/http_response_parser.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+constexpr char kTags[] = R"({"models":[{"name":"llama3.2:latest"}]})";
+
+// Counts what the parser hands over.
+class CountingSink : public HttpResponseParser::BodySink {
+ public:
+  void OnHeadersComplete(int status_code, HttpHeaderView headers) override {
+    status_code_ = status_code;
+    header_count_ = headers.size();
+  }
+  void OnBodyData(const uint8_t* data, size_t size) override {
+    benchmark::DoNotOptimize(data);
+    body_size_ += size;
+  }
+
+  void Reset() {
+    status_code_ = 0;
+    header_count_ = 0;
+    body_size_ = 0;
+  }
+
+  int status_code_ = 0;
+  size_t header_count_ = 0;
+  size_t body_size_ = 0;
+};
+
+std::string FixedResponse(const std::string& body) {
+  return "HTTP/1.1 200 OK\r\nContent-Type: application/json; charset=utf-8\r\n"
+         "Date: Tue, 14 Oct 2025 09:00:00 GMT\r\nContent-Length: " +
+         std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+// A chat stream framed the way Ollama sends it: a chunk per NDJSON line.
+std::string ChunkedResponse(const std::string& body) {
+  std::string response =
+      "HTTP/1.1 200 OK\r\nContent-Type: application/x-ndjson\r\n"
+      "Date: Tue, 14 Oct 2025 09:00:00 GMT\r\n"
+      "Transfer-Encoding: chunked\r\n\r\n";
+  size_t start = 0;
+  char size[32];
+  while (start < body.size()) {
+    size_t end = body.find('\n', start);
+    end = end == std::string::npos ? body.size() : end + 1;
+    std::snprintf(size, sizeof(size), "%zx\r\n", end - start);
+    response += size;
+    response.append(body, start, end - start);
+    response += "\r\n";
+    start = end;
+  }
+  return response + "0\r\n\r\n";
+}
+
+// Parses one whole response per iteration, as it arrives from a local
+// server in 16 KiB reads. Case 0 is /api/tags, 1 a chunked chat stream and
+// 2 /api/tags behind a "100 Continue", which must be skipped, not taken
+// for the response.
+void BM_HttpResponseParser(benchmark::State& state) {
+  const std::string chat = BuiltinOllamaStreams()[1].body;
+  std::string response;
+  size_t body_size = 0;
+  switch (state.range(0)) {
+    case 0:
+      response = FixedResponse(kTags);
+      body_size = std::strlen(kTags);
+      break;
+    case 1:
+      response = ChunkedResponse(chat);
+      body_size = chat.size();
+      break;
+    default:
+      response = "HTTP/1.1 100 Continue\r\nX-Interim: 1\r\n\r\n" +
+                 FixedResponse(kTags);
+      body_size = std::strlen(kTags);
+      break;
+  }
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(response.data());
+
+  HttpResponseParser parser;
+  CountingSink sink;
+  for (auto _ : state) {
+    parser.Reset();
+    sink.Reset();
+    size_t offset = 0;
+    while (offset < response.size() && !parser.complete() &&
+           !parser.failed()) {
+      const size_t size = std::min<size_t>(16 * 1024, response.size() - offset);
+      offset += parser.Parse(data + offset, size, &sink);
+    }
+    if (!parser.complete() || offset != response.size() ||
+        sink.status_code_ != 200 || sink.header_count_ == 0 ||
+        sink.body_size_ != body_size) {
+      state.SkipWithError("response parsed wrongly");
+      return;
+    }
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(response.size()));
+}
+BENCHMARK(BM_HttpResponseParser)->ArgName("case")->Arg(0)->Arg(1)->Arg(2);
+
+}  // namespace
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,348 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "native/benchmarks/ollama_streams.h"
+#include "native/http_stream_service.h"
+#include "native/socket.h"
+#include "native/spsc_ring.h"
+#include "native/wire_format.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+constexpr char kTags[] = R"({"models":[{"name":"llama3.2:latest"}]})";
+
+// Stands in for Ollama on a loopback port: /api/tags answers with kTags,
+// anything else with the long built-in chat stream. One response per
+// connection, written as fast as the client takes it.
+class FakeOllama {
+ public:
+  FakeOllama() : chat_(BuiltinOllamaStreams()[1]) {}
+  ~FakeOllama() { Stop(); }
+
+  // Prevent copying.
+  FakeOllama(FakeOllama const&) = delete;
+  FakeOllama& operator=(FakeOllama const&) = delete;
+
+  bool Start() {
+    std::string error;
+    listener_ = ListenLoopback(&port_, &error);
+    if (listener_ == kInvalidSocket) {
+      return false;
+    }
+    running_ = true;
+    thread_ = std::thread(&FakeOllama::Run, this);
+    return true;
+  }
+
+  void Stop() {
+    running_ = false;
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+    for (Connection& connection : connections_) {
+      CloseSocket(connection.socket);
+    }
+    connections_.clear();
+    CloseSocket(listener_);
+    listener_ = kInvalidSocket;
+  }
+
+  uint16_t port() const { return port_; }
+  const OllamaStream& chat() const { return chat_; }
+
+ private:
+  struct Connection {
+    SocketHandle socket = kInvalidSocket;
+    std::string in;
+    std::string out;
+    size_t sent = 0;
+    bool responding = false;
+  };
+
+  void Run() {
+    std::vector<PollEntry> entries;
+    char buffer[16 * 1024];
+    while (running_) {
+      entries.clear();
+      entries.push_back({listener_, kPollIn, 0});
+      for (const Connection& connection : connections_) {
+        entries.push_back({connection.socket,
+                           connection.responding ? kPollOut : kPollIn, 0});
+      }
+      PollSockets(entries.data(), entries.size(), 20);
+
+      for (size_t i = 0; i < connections_.size(); i++) {
+        Connection& connection = connections_[i];
+        if (entries[i + 1].revents == 0) {
+          continue;
+        }
+        if (!connection.responding) {
+          const long received =
+              RecvSome(connection.socket, buffer, sizeof(buffer));
+          if (received == 0 || received == kSocketError) {
+            CloseSocket(connection.socket);
+            connection.socket = kInvalidSocket;
+            continue;
+          }
+          if (received > 0) {
+            connection.in.append(buffer, static_cast<size_t>(received));
+            Respond(&connection);
+          }
+          continue;
+        }
+        const long sent =
+            SendSome(connection.socket, connection.out.data() + connection.sent,
+                     connection.out.size() - connection.sent);
+        if (sent > 0) {
+          connection.sent += static_cast<size_t>(sent);
+        }
+        if (sent == kSocketError || connection.sent == connection.out.size()) {
+          CloseSocket(connection.socket);
+          connection.socket = kInvalidSocket;
+        }
+      }
+      connections_.erase(
+          std::remove_if(connections_.begin(), connections_.end(),
+                         [](const Connection& connection) {
+                           return connection.socket == kInvalidSocket;
+                         }),
+          connections_.end());
+
+      SocketHandle accepted;
+      while ((accepted = AcceptSocket(listener_)) != kInvalidSocket) {
+        Connection connection;
+        connection.socket = accepted;
+        connections_.push_back(std::move(connection));
+      }
+    }
+  }
+
+  // Queues the response once the whole request has arrived.
+  void Respond(Connection* connection) {
+    const size_t headers_end = connection->in.find("\r\n\r\n");
+    if (headers_end == std::string::npos) {
+      return;
+    }
+    size_t content_length = 0;
+    const size_t field = connection->in.find("Content-Length: ");
+    if (field != std::string::npos && field < headers_end) {
+      content_length = std::stoul(connection->in.substr(field + 16));
+    }
+    if (connection->in.size() < headers_end + 4 + content_length) {
+      return;
+    }
+    const bool tags = connection->in.compare(0, 14, "GET /api/tags ") == 0;
+    const std::string body = tags ? std::string(kTags) : chat_.body;
+    connection->out = "HTTP/1.1 200 OK\r\nContent-Type: ";
+    connection->out += tags ? "application/json" : "application/x-ndjson";
+    connection->out += "\r\nContent-Length: " + std::to_string(body.size()) +
+                       "\r\nConnection: close\r\n\r\n" + body;
+    connection->responding = true;
+  }
+
+  OllamaStream chat_;
+  SocketHandle listener_ = kInvalidSocket;
+  uint16_t port_ = 0;
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+  // Server-thread state.
+  std::vector<Connection> connections_;
+};
+
+// Stands in for the Dart listener: wakes the consumer below.
+std::mutex g_doorbell_mutex;
+std::condition_variable g_doorbell;
+bool g_rung = false;
+
+void Doorbell(int64_t /*tag*/) {
+  std::lock_guard<std::mutex> lock(g_doorbell_mutex);
+  g_rung = true;
+  g_doorbell.notify_one();
+}
+
+std::vector<uint8_t> StartMessage(uint64_t id, const char* method,
+                                  const char* path, uint16_t port,
+                                  uint8_t flags, const char* body) {
+  std::vector<uint8_t> message;
+  WireWriter writer(&message);
+  writer.WriteU8(HttpStreamService::kStart);
+  writer.WriteU64(id);
+  writer.WriteString(method);
+  writer.WriteString("127.0.0.1");
+  writer.WriteU16(port);
+  writer.WriteString(path);
+  writer.WriteU16(0);
+  writer.WriteU8(flags);
+  writer.WriteString(body);
+  return message;
+}
+
+// What a request's events have shown so far.
+struct Progress {
+  bool started = false;
+  bool complete = false;
+  uint64_t tokens = 0;
+};
+
+// Drains |ring| the way the Dart isolate does until every request in
+// |progress| has completed, checking each one's events arrive in order.
+// Returns an error, or an empty string.
+std::string DrainUntilComplete(SpscRing* ring,
+                               std::unordered_map<uint64_t, Progress>* progress) {
+  size_t remaining = progress->size();
+  while (remaining > 0) {
+    const uint8_t* data = nullptr;
+    const size_t size = ring->Read(&data);
+    if (size == 0) {
+      if (!ring->Arm()) {
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(g_doorbell_mutex);
+      if (!g_doorbell.wait_for(lock, std::chrono::seconds(5),
+                               [] { return g_rung; })) {
+        return "timed out waiting for events";
+      }
+      g_rung = false;
+      continue;
+    }
+
+    size_t offset = 0;
+    while (offset < size) {
+      uint32_t length = 0;
+      std::memcpy(&length, data + offset, sizeof(length));
+      if (length == SpscRing::kWrapMarker) {
+        break;
+      }
+      WireReader reader(data + offset + sizeof(length), length);
+      offset += (sizeof(length) + length + 7) & ~static_cast<size_t>(7);
+      uint8_t event = 0;
+      uint64_t id = 0;
+      reader.ReadU8(&event);
+      reader.ReadU64(&id);
+      auto it = progress->find(id);
+      if (!reader.ok() || it == progress->end() || it->second.complete) {
+        return "event for a request that is not running";
+      }
+      Progress& request = it->second;
+      if (event == HttpStreamService::kEventError) {
+        std::string message;
+        reader.ReadString(&message);
+        return "request failed: " + message;
+      }
+      if ((event == HttpStreamService::kEventStarted) == request.started) {
+        return "events out of order";
+      }
+      if (event == HttpStreamService::kEventStarted) {
+        request.started = true;
+      } else if (event == HttpStreamService::kEventTokens) {
+        uint8_t flags = 0;
+        uint32_t count = 0;
+        reader.ReadU8(&flags);
+        reader.ReadU32(&count);
+        request.tokens += count;
+      } else if (event == HttpStreamService::kEventComplete) {
+        request.complete = true;
+        remaining--;
+      }
+    }
+    ring->Consume(size);
+  }
+  return std::string();
+}
+
+// A chat streams through the event ring while the same thread asks for
+// /api/tags again and again, as the model picker and the cloud's polling
+// do; all but the first are answered from the ResponseCache. Every event
+// must still arrive once, in order, written by the one producer the ring
+// allows (debug builds assert that in SpscRing::Write).
+void BM_EventRingCacheHits(benchmark::State& state) {
+  const int hits = static_cast<int>(state.range(0));
+  FakeOllama ollama;
+  if (!ollama.Start()) {
+    state.SkipWithError("could not listen on loopback");
+    return;
+  }
+  HttpStreamService service([&service](std::vector<uint8_t> event) {
+    // Every request here asked for the ring.
+    service.RecycleEvent(std::move(event));
+  });
+
+  std::vector<uint8_t> message;
+  std::vector<uint8_t> reply;
+  WireWriter writer(&message);
+  writer.WriteU8(HttpStreamService::kOpenEventRing);
+  writer.WriteU64(1);
+  writer.WriteU32(256 * 1024);
+  writer.WriteU64(reinterpret_cast<uintptr_t>(&Doorbell));
+  service.HandleMessage(message.data(), message.size(), &reply);
+  uint64_t address = 0;
+  WireReader(reply.data(), reply.size()).ReadU64(&address);
+  SpscRing* ring = reinterpret_cast<SpscRing*>(address);
+  if (ring == nullptr) {
+    state.SkipWithError("no event ring");
+    return;
+  }
+  g_rung = false;
+
+  const uint8_t ring_flag = HttpStreamService::kFlagEventRing;
+  const uint16_t port = ollama.port();
+  uint64_t next_id = 1;
+  std::unordered_map<uint64_t, Progress> progress;
+  std::string error;
+
+  // Fills the cache, so the requests in the loop hit it.
+  message = StartMessage(next_id, "GET", "/api/tags", port, ring_flag, "");
+  progress[next_id++];
+  service.HandleMessage(message.data(), message.size(), &reply);
+  error = DrainUntilComplete(ring, &progress);
+
+  for (auto _ : state) {
+    if (!error.empty()) {
+      break;
+    }
+    progress.clear();
+    const uint64_t chat_id = next_id++;
+    message = StartMessage(chat_id, "POST", "/api/chat", port,
+                           ring_flag | HttpStreamService::kFlagParseNdjson,
+                           R"({"model":"llama3.2","stream":true})");
+    progress[chat_id];
+    service.HandleMessage(message.data(), message.size(), &reply);
+    for (int i = 0; i < hits; i++) {
+      message = StartMessage(next_id, "GET", "/api/tags", port, ring_flag, "");
+      progress[next_id++];
+      service.HandleMessage(message.data(), message.size(), &reply);
+    }
+    error = DrainUntilComplete(ring, &progress);
+    if (error.empty() && progress[chat_id].tokens != ollama.chat().tokens) {
+      error = "chat lost tokens";
+    }
+  }
+
+  const ResponseCache::Stats cache = service.cache_stats();
+  service.Shutdown();
+  ollama.Stop();
+  if (!error.empty()) {
+    state.SkipWithError(error.c_str());
+    return;
+  }
+  state.counters["hits"] = benchmark::Counter(
+      static_cast<double>(cache.hits), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_EventRingCacheHits)->ArgName("hits")->Arg(8)->Arg(64)
+    ->UseRealTime();
+
+}  // namespace
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,86 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "native/benchmarks/native_benchmarks.h"
+#include "native/markdown_lexer.h"
+#include "native/ndjson_token_scanner.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+// The deltas of |stream|, one per NDJSON line, as OnTokenBatch sees them
+// from a local Ollama.
+std::vector<std::string> Deltas(const OllamaStream& stream) {
+  const uint8_t* body = reinterpret_cast<const uint8_t*>(stream.body.data());
+  const size_t size = stream.body.size();
+  NdjsonTokenScanner scanner;
+  TokenBatch batch;
+  std::vector<std::string> deltas;
+  size_t offset = 0;
+  while (offset < size) {
+    const void* newline = std::memchr(body + offset, '\n', size - offset);
+    const size_t end = newline == nullptr
+                           ? size
+                           : static_cast<const uint8_t*>(newline) - body + 1;
+    batch.Reset();
+    scanner.Feed(body + offset, end - offset, &batch);
+    if (!batch.text().empty()) {
+      deltas.push_back(batch.text());
+    }
+    offset = end;
+  }
+  return deltas;
+}
+
+// Lexes the reply a delta at a time and encodes what changed after each,
+// as the service does for kFlagMarkdown requests.
+void BM_MarkdownLexer(benchmark::State& state, const OllamaStream* stream) {
+  const std::vector<std::string> deltas = Deltas(*stream);
+  MarkdownLexer lexer;
+  std::vector<uint8_t> changes;
+  for (auto _ : state) {
+    for (const std::string& delta : deltas) {
+      lexer.Append(delta.data(), delta.size());
+      changes.clear();
+      lexer.EncodeChanges(&changes);
+      benchmark::DoNotOptimize(changes.data());
+    }
+    lexer.Reset();
+  }
+  SetStreamCounters(state, *stream);
+}
+
+// Lexes the whole reply again after every delta, as rendering the
+// accumulated text each time does. Kept as the baseline.
+void BM_MarkdownRelex(benchmark::State& state, const OllamaStream* stream) {
+  const std::vector<std::string> deltas = Deltas(*stream);
+  MarkdownLexer lexer;
+  std::string reply;
+  for (auto _ : state) {
+    reply.clear();
+    for (const std::string& delta : deltas) {
+      reply += delta;
+      lexer.Reset();
+      lexer.Append(reply.data(), reply.size());
+      benchmark::DoNotOptimize(lexer.blocks().data());
+    }
+  }
+  SetStreamCounters(state, *stream);
+}
+
+}  // namespace
+
+void RegisterMarkdownBenchmarks(const std::vector<OllamaStream>& streams) {
+  for (const OllamaStream& stream : streams) {
+    benchmark::RegisterBenchmark(("BM_MarkdownLexer/" + stream.name).c_str(),
+                                 BM_MarkdownLexer, &stream);
+    benchmark::RegisterBenchmark(("BM_MarkdownRelex/" + stream.name).c_str(),
+                                 BM_MarkdownRelex, &stream);
+  }
+}
+
+}  // namespace cloudtolocalllm
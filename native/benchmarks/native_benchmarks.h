@@ -0,0 +1,31 @@
+#ifndef NATIVE_BENCHMARKS_NATIVE_BENCHMARKS_H_
+#define NATIVE_BENCHMARKS_NATIVE_BENCHMARKS_H_
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "native/benchmarks/ollama_streams.h"
+
+namespace cloudtolocalllm {
+
+// Benchmarks that replay Ollama streams are registered at startup, once
+// the streams named on the command line have been loaded. |streams| must
+// outlive the run.
+void RegisterMarkdownBenchmarks(const std::vector<OllamaStream>& streams);
+void RegisterNdjsonBenchmarks(const std::vector<OllamaStream>& streams);
+void RegisterTunnelBenchmarks(const std::vector<OllamaStream>& streams);
+
+// Reports bytes/s and tokens/s for one pass over |stream| per iteration.
+inline void SetStreamCounters(benchmark::State& state,
+                              const OllamaStream& stream) {
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(stream.body.size()));
+  state.counters["tokens"] = benchmark::Counter(
+      static_cast<double>(state.iterations()) * stream.tokens,
+      benchmark::Counter::kIsRate);
+}
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_BENCHMARKS_NATIVE_BENCHMARKS_H_
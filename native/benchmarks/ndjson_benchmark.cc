@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <cstring>
+
+#include <benchmark/benchmark.h>
+
+#include "native/benchmarks/native_benchmarks.h"
+#include "native/ndjson_token_scanner.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+// Feeds |stream| to the scanner |chunk| bytes at a time, or a line at a
+// time when |chunk| is zero (a local Ollama flushes each line as its own
+// HTTP chunk, so that is what the worker usually receives).
+void BM_NdjsonTokenScanner(benchmark::State& state,
+                           const OllamaStream* stream) {
+  const size_t chunk = static_cast<size_t>(state.range(0));
+  const uint8_t* body = reinterpret_cast<const uint8_t*>(stream->body.data());
+  const size_t size = stream->body.size();
+
+  NdjsonTokenScanner scanner;
+  TokenBatch batch;
+  for (auto _ : state) {
+    size_t offset = 0;
+    while (offset < size) {
+      size_t end = std::min(size, offset + chunk);
+      if (chunk == 0) {
+        const void* newline =
+            std::memchr(body + offset, '\n', size - offset);
+        end = newline == nullptr
+                  ? size
+                  : static_cast<const uint8_t*>(newline) - body + 1;
+      }
+      batch.Reset();
+      scanner.Feed(body + offset, end - offset, &batch);
+      benchmark::DoNotOptimize(batch.text().data());
+      offset = end;
+    }
+    scanner.Finish(&batch);
+    scanner.Reset();
+  }
+  SetStreamCounters(state, *stream);
+}
+
+}  // namespace
+
+void RegisterNdjsonBenchmarks(const std::vector<OllamaStream>& streams) {
+  for (const OllamaStream& stream : streams) {
+    benchmark::RegisterBenchmark(
+        ("BM_NdjsonTokenScanner/" + stream.name).c_str(),
+        BM_NdjsonTokenScanner, &stream)
+        ->ArgName("chunk")
+        ->Arg(0)
+        ->Arg(1460)
+        ->Arg(16 * 1024);
+  }
+}
+
+}  // namespace cloudtolocalllm
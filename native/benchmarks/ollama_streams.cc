@@ -0,0 +1,109 @@
+#include "native/benchmarks/ollama_streams.h"
+
+#include <utility>
+
+#include "native/mapped_file.h"
+#include "native/ndjson_token_scanner.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+// Token texts as they appear JSON-escaped inside "content".
+const char* const kProseTokens[] = {
+    " the",   " model",  " is",      " running", " locally", ",",
+    " and",   " it",     " streams", " tokens",  " as",      " they",
+    " are",   " ready",  ".",        " You",     " can",     " also",
+    " use",   " a",      " cloud",   " tunnel",  " when",    " your",
+    " GPU",   " is",     " busy",    "\\n\\n",   " caf",     "\\u00e9",
+    " \xe2\x80\x94",     " **",      "Note",     "**",       ":",
+    " 1",     ".",       " 2",
+};
+
+const char* const kCodeTokens[] = {
+    "\\n",     "    ",  "if",      " (",      "value",  " ==",   " null",
+    ")",       " {",    "\\n",     "      ",  "return", " \\\"", "none",
+    "\\\"",    ";",     "}",       "```",     "dart",   "final", " list",
+    " =",      " <",    "String",  ">[]",     "\\t",    "//",    " TODO",
+    "\\\\",    "n",     "\\u003c", "\\u003e", "=>",     " '",    "\xc3\xa9",
+};
+
+// Deterministic, so the corpus is the same everywhere.
+class Lcg {
+ public:
+  explicit Lcg(uint32_t seed) : state_(seed) {}
+
+  uint32_t Next(uint32_t bound) {
+    state_ = state_ * 1664525u + 1013904223u;
+    return (state_ >> 8) % bound;
+  }
+
+ private:
+  uint32_t state_;
+};
+
+template <size_t N>
+std::string Stream(const char* const (&tokens)[N], uint32_t count,
+                   uint32_t seed) {
+  Lcg random(seed);
+  std::string body;
+  for (uint32_t i = 0; i < count; i++) {
+    body += "{\"model\":\"llama3.2\",\"created_at\":\"2025-01-14T09:26:";
+    body += std::to_string(10 + i % 50);
+    body += ".";
+    body += std::to_string(100000000 + random.Next(900000000));
+    body += "Z\",\"message\":{\"role\":\"assistant\",\"content\":\"";
+    body += tokens[random.Next(N)];
+    body += "\"},\"done\":false}\n";
+  }
+  body +=
+      "{\"model\":\"llama3.2\",\"created_at\":\"2025-01-14T09:27:01.5236863Z\","
+      "\"message\":{\"role\":\"assistant\",\"content\":\"\"},"
+      "\"done_reason\":\"stop\",\"done\":true,\"total_duration\":4883583458,"
+      "\"load_duration\":1334875,\"prompt_eval_count\":26,"
+      "\"prompt_eval_duration\":342546000,\"eval_count\":";
+  body += std::to_string(count);
+  body += ",\"eval_duration\":4535599000}\n";
+  return body;
+}
+
+uint32_t CountTokens(const std::string& body) {
+  NdjsonTokenScanner scanner;
+  TokenBatch batch;
+  scanner.Feed(reinterpret_cast<const uint8_t*>(body.data()), body.size(),
+               &batch);
+  scanner.Finish(&batch);
+  return batch.token_count();
+}
+
+OllamaStream Builtin(const char* name, std::string body) {
+  OllamaStream stream;
+  stream.name = name;
+  stream.body = std::move(body);
+  stream.tokens = CountTokens(stream.body);
+  return stream;
+}
+
+}  // namespace
+
+std::vector<OllamaStream> BuiltinOllamaStreams() {
+  std::vector<OllamaStream> streams;
+  streams.push_back(Builtin("short_answer", Stream(kProseTokens, 48, 1)));
+  streams.push_back(Builtin("long_answer", Stream(kProseTokens, 2048, 2)));
+  streams.push_back(Builtin("code_answer", Stream(kCodeTokens, 1536, 3)));
+  return streams;
+}
+
+bool LoadOllamaStream(const std::filesystem::path& path,
+                      OllamaStream* stream) {
+  MappedFile file;
+  if (!file.Open(path)) {
+    return false;
+  }
+  stream->name = path.stem().string();
+  stream->body.assign(reinterpret_cast<const char*>(file.data()), file.size());
+  stream->tokens = CountTokens(stream->body);
+  return stream->tokens > 0;
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,34 @@
+#ifndef NATIVE_BENCHMARKS_OLLAMA_STREAMS_H_
+#define NATIVE_BENCHMARKS_OLLAMA_STREAMS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace cloudtolocalllm {
+
+// One /api/chat response body, as Ollama streams it: an NDJSON line per
+// token and a final "done" line with the counters.
+struct OllamaStream {
+  std::string name;
+  std::string body;
+  // Tokens the scanner finds in |body|.
+  uint32_t tokens = 0;
+};
+
+// Streams in the exact line shape of a recorded llama3.2 session, at the
+// sizes the app sees: a one-line answer, a long prose answer and a code
+// answer heavy with escapes. Generated from a fixed seed, so every run and
+// every machine measures the same bytes.
+std::vector<OllamaStream> BuiltinOllamaStreams();
+
+// Reads a stream captured from a real server (for example with
+// `curl -N http://localhost:11434/api/chat -d ...`); false if the file
+// cannot be read or holds no tokens.
+bool LoadOllamaStream(const std::filesystem::path& path, OllamaStream* stream);
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_BENCHMARKS_OLLAMA_STREAMS_H_
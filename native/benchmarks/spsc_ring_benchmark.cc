@@ -0,0 +1,111 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "native/spsc_ring.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+// Records handed over per iteration.
+constexpr uint64_t kBatch = 1024;
+
+// Stands in for the Dart listener: wakes the consumer below.
+std::mutex g_doorbell_mutex;
+std::condition_variable g_doorbell;
+bool g_rung = false;
+
+void Doorbell(int64_t /*tag*/) {
+  std::lock_guard<std::mutex> lock(g_doorbell_mutex);
+  g_rung = true;
+  g_doorbell.notify_one();
+}
+
+// Walks the records in |size| bytes at |data|; returns how many there were.
+uint64_t CountRecords(const uint8_t* data, size_t size) {
+  uint64_t records = 0;
+  size_t offset = 0;
+  while (offset < size) {
+    uint32_t length = 0;
+    std::memcpy(&length, data + offset, sizeof(length));
+    if (length == SpscRing::kWrapMarker) {
+      break;
+    }
+    benchmark::DoNotOptimize(data + offset + sizeof(length));
+    offset += (sizeof(length) + length + 7) & ~static_cast<size_t>(7);
+    records++;
+  }
+  return records;
+}
+
+// A producer thread writes token-event-sized records while this thread
+// drains them the way the Dart isolate does: read until empty, arm, and
+// sleep until the doorbell.
+void BM_SpscRingHandoff(benchmark::State& state) {
+  const size_t record_size = static_cast<size_t>(state.range(0));
+  SpscRing ring(64 * 1024, &Doorbell, 0);
+  const uint64_t total = state.max_iterations * kBatch;
+  // The HTTP worker never waits for Dart; the cap only stops a consumer
+  // that falls behind from turning the run into a spill-buffer benchmark.
+  const uint64_t in_flight = ring.capacity() / (record_size + 8);
+  std::atomic<uint64_t> consumed(0);
+  g_rung = false;
+
+  std::thread producer([&] {
+    const std::vector<uint8_t> record(record_size, 'x');
+    for (uint64_t written = 0; written < total; written++) {
+      while (written - consumed.load(std::memory_order_acquire) >=
+             in_flight) {
+        std::this_thread::yield();
+      }
+      ring.Write(record.data(), record.size());
+    }
+  });
+
+  uint64_t received = 0;
+  // A read takes whole spans, so one iteration may run ahead of its batch.
+  uint64_t goal = 0;
+  for (auto _ : state) {
+    goal += kBatch;
+    while (received < goal) {
+      const uint8_t* data = nullptr;
+      const size_t size = ring.Read(&data);
+      if (size == 0) {
+        if (ring.Arm()) {
+          std::unique_lock<std::mutex> lock(g_doorbell_mutex);
+          g_doorbell.wait(lock, [] { return g_rung; });
+          g_rung = false;
+        }
+        continue;
+      }
+      const uint64_t records = CountRecords(data, size);
+      // A wrap marker ends the span; the rest of it is padding.
+      ring.Consume(size);
+      received += records;
+      consumed.store(received, std::memory_order_release);
+    }
+  }
+  producer.join();
+
+  const SpscRing::Stats stats = ring.stats();
+  state.SetItemsProcessed(static_cast<int64_t>(received));
+  state.SetBytesProcessed(static_cast<int64_t>(received * record_size));
+  state.counters["doorbells"] = benchmark::Counter(
+      static_cast<double>(stats.doorbells), benchmark::Counter::kAvgIterations);
+  state.counters["spilled"] = static_cast<double>(stats.spilled);
+}
+BENCHMARK(BM_SpscRingHandoff)
+    ->ArgName("record")
+    ->Arg(64)
+    ->Arg(1024)
+    ->UseRealTime();
+
+}  // namespace
+
+}  // namespace cloudtolocalllm
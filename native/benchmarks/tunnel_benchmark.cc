@@ -0,0 +1,217 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "native/benchmarks/native_benchmarks.h"
+#include "native/chacha20_poly1305.h"
+#include "native/http_stream_service.h"
+#include "native/tunnel_frame.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+constexpr uint8_t kKey[ChaCha20Poly1305::kKeySize] = {
+    0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a,
+    0x8b, 0x8c, 0x8d, 0x8e, 0x8f, 0x90, 0x91, 0x92, 0x93, 0x94, 0x95,
+    0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f};
+constexpr char kSessionId[] = "bench-session-4f1c9e2a";
+constexpr uint8_t kResponseChunk = HttpStreamService::kTunnelResponseChunk;
+
+// The lines of |stream|, each relayed as its own frame the way
+// HttpStreamService forwards a local response over the tunnel.
+std::vector<std::string> Lines(const OllamaStream& stream) {
+  std::vector<std::string> lines;
+  size_t start = 0;
+  while (start < stream.body.size()) {
+    size_t end = stream.body.find('\n', start);
+    end = end == std::string::npos ? stream.body.size() : end + 1;
+    lines.push_back(stream.body.substr(start, end - start));
+    start = end;
+  }
+  return lines;
+}
+
+// Prefix of the long built-in answer, so fixed-size payloads compress like
+// real traffic rather than like zeros or noise.
+std::string Payload(size_t size) {
+  static const std::string* corpus =
+      new std::string(BuiltinOllamaStreams()[1].body);
+  std::string payload;
+  while (payload.size() < size) {
+    payload += corpus->substr(0, size - payload.size());
+  }
+  return payload;
+}
+
+void BM_TunnelSealStream(benchmark::State& state,
+                         const OllamaStream* stream) {
+  const std::vector<std::string> lines = Lines(*stream);
+  TunnelSession sender(kKey, kSessionId,
+                       TunnelDirection::kDesktopToCloudStream);
+  sender.set_compression(state.range(0) != 0);
+  std::vector<uint8_t> frame;
+  for (auto _ : state) {
+    for (const std::string& line : lines) {
+      frame.clear();
+      sender.Seal(kResponseChunk,
+                  reinterpret_cast<const uint8_t*>(line.data()), line.size(),
+                  &frame);
+      benchmark::DoNotOptimize(frame.data());
+    }
+  }
+  SetStreamCounters(state, *stream);
+}
+
+void BM_TunnelOpenStream(benchmark::State& state,
+                         const OllamaStream* stream) {
+  const std::vector<std::string> lines = Lines(*stream);
+  TunnelSession sender(kKey, kSessionId,
+                       TunnelDirection::kDesktopToCloudStream);
+  sender.set_compression(state.range(0) != 0);
+  std::vector<std::vector<uint8_t>> frames(lines.size());
+  for (size_t i = 0; i < lines.size(); i++) {
+    sender.Seal(kResponseChunk,
+                reinterpret_cast<const uint8_t*>(lines[i].data()),
+                lines[i].size(), &frames[i]);
+  }
+
+  std::vector<uint8_t> scratch;
+  for (auto _ : state) {
+    // Sequence numbers only go up, so each pass needs a fresh receiver.
+    TunnelSession receiver(kKey, kSessionId,
+                           TunnelDirection::kCloudToDesktop);
+    for (const std::vector<uint8_t>& frame : frames) {
+      // Open decrypts in place, as it does the WebSocket's buffer.
+      scratch.assign(frame.begin(), frame.end());
+      TunnelFrame opened;
+      if (receiver.Open(scratch.data(), scratch.size(), &opened) !=
+          TunnelFrameStatus::kOk) {
+        state.SkipWithError("frame did not open");
+        return;
+      }
+      benchmark::DoNotOptimize(opened.payload);
+    }
+  }
+  SetStreamCounters(state, *stream);
+}
+
+void BM_TunnelSeal(benchmark::State& state) {
+  const std::string payload = Payload(static_cast<size_t>(state.range(0)));
+  TunnelSession sender(kKey, kSessionId, TunnelDirection::kDesktopToCloud);
+  sender.set_compression(state.range(1) != 0);
+  std::vector<uint8_t> frame;
+  for (auto _ : state) {
+    frame.clear();
+    sender.Seal(kResponseChunk,
+                reinterpret_cast<const uint8_t*>(payload.data()),
+                payload.size(), &frame);
+    benchmark::DoNotOptimize(frame.data());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          state.range(0));
+}
+BENCHMARK(BM_TunnelSeal)
+    ->ArgNames({"size", "compress"})
+    ->ArgsProduct({{256, 16 * 1024}, {0, 1}});
+
+void BM_TunnelOpen(benchmark::State& state) {
+  const std::string payload = Payload(static_cast<size_t>(state.range(0)));
+  // Enough frames to keep the copies out of the last-level cache.
+  constexpr size_t kFrames = 256;
+  TunnelSession sender(kKey, kSessionId, TunnelDirection::kDesktopToCloud);
+  sender.set_compression(state.range(1) != 0);
+  std::vector<std::vector<uint8_t>> frames(kFrames);
+  for (std::vector<uint8_t>& frame : frames) {
+    sender.Seal(kResponseChunk,
+                reinterpret_cast<const uint8_t*>(payload.data()),
+                payload.size(), &frame);
+  }
+
+  auto receiver = std::make_unique<TunnelSession>(
+      kKey, kSessionId, TunnelDirection::kCloudToDesktop);
+  std::vector<uint8_t> scratch;
+  size_t next = 0;
+  for (auto _ : state) {
+    if (next == kFrames) {
+      state.PauseTiming();
+      receiver = std::make_unique<TunnelSession>(
+          kKey, kSessionId, TunnelDirection::kCloudToDesktop);
+      next = 0;
+      state.ResumeTiming();
+    }
+    scratch.assign(frames[next].begin(), frames[next].end());
+    next++;
+    TunnelFrame opened;
+    if (receiver->Open(scratch.data(), scratch.size(), &opened) !=
+        TunnelFrameStatus::kOk) {
+      state.SkipWithError("frame did not open");
+      return;
+    }
+    benchmark::DoNotOptimize(opened.payload);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          state.range(0));
+}
+BENCHMARK(BM_TunnelOpen)
+    ->ArgNames({"size", "compress"})
+    ->ArgsProduct({{256, 16 * 1024}, {0, 1}});
+
+void BM_ChaCha20Poly1305Seal(benchmark::State& state) {
+  ChaCha20Poly1305 aead(kKey);
+  const uint8_t nonce[ChaCha20Poly1305::kNonceSize] = {};
+  const uint8_t aad[kTunnelFrameFixedHeaderSize] = {};
+  std::vector<uint8_t> data(static_cast<size_t>(state.range(0)), 0x5a);
+  uint8_t tag[ChaCha20Poly1305::kTagSize];
+  for (auto _ : state) {
+    aead.Seal(nonce, aad, sizeof(aad), data.data(), data.size(), tag);
+    benchmark::DoNotOptimize(tag);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          state.range(0));
+}
+BENCHMARK(BM_ChaCha20Poly1305Seal)->Arg(64)->Arg(256)->Arg(16 * 1024);
+
+void BM_ChaCha20Poly1305Open(benchmark::State& state) {
+  ChaCha20Poly1305 aead(kKey);
+  const uint8_t nonce[ChaCha20Poly1305::kNonceSize] = {};
+  const uint8_t aad[kTunnelFrameFixedHeaderSize] = {};
+  std::vector<uint8_t> sealed(static_cast<size_t>(state.range(0)), 0x5a);
+  uint8_t tag[ChaCha20Poly1305::kTagSize];
+  aead.Seal(nonce, aad, sizeof(aad), sealed.data(), sealed.size(), tag);
+  std::vector<uint8_t> data;
+  for (auto _ : state) {
+    data.assign(sealed.begin(), sealed.end());
+    if (!aead.Open(nonce, aad, sizeof(aad), data.data(), data.size(), tag)) {
+      state.SkipWithError("tag did not verify");
+      return;
+    }
+    benchmark::DoNotOptimize(data.data());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          state.range(0));
+}
+BENCHMARK(BM_ChaCha20Poly1305Open)->Arg(64)->Arg(256)->Arg(16 * 1024);
+
+}  // namespace
+
+void RegisterTunnelBenchmarks(const std::vector<OllamaStream>& streams) {
+  for (const OllamaStream& stream : streams) {
+    benchmark::RegisterBenchmark(
+        ("BM_TunnelSealStream/" + stream.name).c_str(), BM_TunnelSealStream,
+        &stream)
+        ->ArgName("compress")
+        ->Arg(0)
+        ->Arg(1);
+    benchmark::RegisterBenchmark(
+        ("BM_TunnelOpenStream/" + stream.name).c_str(), BM_TunnelOpenStream,
+        &stream)
+        ->ArgName("compress")
+        ->Arg(0)
+        ->Arg(1);
+  }
+}
+
+}  // namespace cloudtolocalllm
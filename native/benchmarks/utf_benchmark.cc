@@ -0,0 +1,99 @@
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "native/utf_transcode.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+// What the runner converts: command-line arguments and paths (ASCII),
+// window titles and user text (mixed scripts), and pasted documents.
+std::u16string Input(int64_t kind) {
+  static const char16_t kAscii[] =
+      u"--dart-entrypoint-args=C:\\Users\\dev\\AppData\\Local\\CloudToLocalLLM";
+  static const char16_t kMixed[] =
+      u"Caf\u00e9 r\u00e9sum\u00e9 \u2014 \u6a21\u578b\u306e\u8aac\u660e "
+      u"\U0001F680 \u041f\u0440\u0438\u0432\u0435\u0442 ";
+  std::u16string input;
+  switch (kind) {
+    case 0:
+      input = kAscii;
+      break;
+    case 1:
+      input = kMixed;
+      break;
+    default:
+      while (input.size() < 64 * 1024) {
+        input += kAscii;
+        input += kMixed;
+      }
+      break;
+  }
+  return input;
+}
+
+void SetInputBytes(benchmark::State& state, size_t bytes) {
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(bytes));
+}
+
+void BM_Utf16ToUtf8(benchmark::State& state) {
+  const std::u16string input = Input(state.range(0));
+  std::string utf8;
+  for (auto _ : state) {
+    Utf16ToUtf8(input.data(), input.size(), &utf8);
+    benchmark::DoNotOptimize(utf8.data());
+  }
+  SetInputBytes(state, input.size() * sizeof(char16_t));
+}
+BENCHMARK(BM_Utf16ToUtf8)
+    ->ArgName("input")
+    ->Arg(0)   // ASCII argument
+    ->Arg(1)   // mixed scripts
+    ->Arg(2);  // 64 KiB document
+
+void BM_Utf8ToUtf16(benchmark::State& state) {
+  std::string utf8;
+  const std::u16string source = Input(state.range(0));
+  Utf16ToUtf8(source.data(), source.size(), &utf8);
+  std::u16string utf16;
+  for (auto _ : state) {
+    Utf8ToUtf16(utf8.data(), utf8.size(), &utf16);
+    benchmark::DoNotOptimize(utf16.data());
+  }
+  SetInputBytes(state, utf8.size());
+}
+BENCHMARK(BM_Utf8ToUtf16)->ArgName("input")->Arg(0)->Arg(1)->Arg(2);
+
+#ifdef _WIN32
+// What windows/runner/utils.cpp did before the shared transcoder: one
+// WideCharToMultiByte call to size the output and a second to fill a new
+// string. Kept as the baseline.
+void BM_WideCharToMultiByte(benchmark::State& state) {
+  const std::u16string source = Input(state.range(0));
+  const std::wstring input(source.begin(), source.end());
+  for (auto _ : state) {
+    const int size =
+        ::WideCharToMultiByte(CP_UTF8, WC_ERR_INVALID_CHARS, input.c_str(),
+                              -1, nullptr, 0, nullptr, nullptr) -
+        1;
+    std::string utf8(size, '\0');
+    ::WideCharToMultiByte(CP_UTF8, WC_ERR_INVALID_CHARS, input.c_str(),
+                          static_cast<int>(input.size()), utf8.data(), size,
+                          nullptr, nullptr);
+    benchmark::DoNotOptimize(utf8.data());
+  }
+  SetInputBytes(state, input.size() * sizeof(wchar_t));
+}
+BENCHMARK(BM_WideCharToMultiByte)->ArgName("input")->Arg(0)->Arg(1)->Arg(2);
+#endif
+
+}  // namespace
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,133 @@
+#include "native/byte_scan.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CLOUDTOLOCALLLM_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define CLOUDTOLOCALLLM_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace cloudtolocalllm {
+
+namespace {
+
+// Index of the lowest set bit of a non-zero |mask|.
+inline unsigned CountTrailingZeros(uint64_t mask) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, mask);
+  return static_cast<unsigned>(index);
+#else
+  return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+
+#if defined(CLOUDTOLOCALLLM_NEON)
+// Collapses a 16-lane comparison result into a 64-bit mask with four bits per
+// lane, the NEON stand-in for SSE2's movemask.
+inline uint64_t NeonMask(uint8x16_t cmp) {
+  uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4);
+  return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+#endif
+
+}  // namespace
+
+const uint8_t* FindByte(const uint8_t* begin, const uint8_t* end,
+                        uint8_t needle) {
+  const uint8_t* p = begin;
+#if defined(CLOUDTOLOCALLLM_SSE2)
+  const __m128i pattern = _mm_set1_epi8(static_cast<char>(needle));
+  for (; end - p >= 16; p += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, pattern));
+    if (mask != 0) {
+      return p + CountTrailingZeros(static_cast<uint64_t>(mask));
+    }
+  }
+#elif defined(CLOUDTOLOCALLLM_NEON)
+  const uint8x16_t pattern = vdupq_n_u8(needle);
+  for (; end - p >= 16; p += 16) {
+    uint64_t mask = NeonMask(vceqq_u8(vld1q_u8(p), pattern));
+    if (mask != 0) {
+      return p + (CountTrailingZeros(mask) >> 2);
+    }
+  }
+#endif
+  for (; p < end; ++p) {
+    if (*p == needle) {
+      return p;
+    }
+  }
+  return end;
+}
+
+const uint8_t* FindEitherByte(const uint8_t* begin, const uint8_t* end,
+                              uint8_t a, uint8_t b) {
+  const uint8_t* p = begin;
+#if defined(CLOUDTOLOCALLLM_SSE2)
+  const __m128i pattern_a = _mm_set1_epi8(static_cast<char>(a));
+  const __m128i pattern_b = _mm_set1_epi8(static_cast<char>(b));
+  for (; end - p >= 16; p += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, pattern_a),
+                                _mm_cmpeq_epi8(chunk, pattern_b));
+    int mask = _mm_movemask_epi8(hits);
+    if (mask != 0) {
+      return p + CountTrailingZeros(static_cast<uint64_t>(mask));
+    }
+  }
+#elif defined(CLOUDTOLOCALLLM_NEON)
+  const uint8x16_t pattern_a = vdupq_n_u8(a);
+  const uint8x16_t pattern_b = vdupq_n_u8(b);
+  for (; end - p >= 16; p += 16) {
+    uint8x16_t chunk = vld1q_u8(p);
+    uint64_t mask = NeonMask(
+        vorrq_u8(vceqq_u8(chunk, pattern_a), vceqq_u8(chunk, pattern_b)));
+    if (mask != 0) {
+      return p + (CountTrailingZeros(mask) >> 2);
+    }
+  }
+#endif
+  for (; p < end; ++p) {
+    if (*p == a || *p == b) {
+      return p;
+    }
+  }
+  return end;
+}
+
+size_t CountAsciiPrefix(const uint8_t* begin, const uint8_t* end) {
+  const uint8_t* p = begin;
+#if defined(CLOUDTOLOCALLLM_SSE2)
+  for (; end - p >= 16; p += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    int mask = _mm_movemask_epi8(chunk);
+    if (mask != 0) {
+      return static_cast<size_t>(p - begin) +
+             CountTrailingZeros(static_cast<uint64_t>(mask));
+    }
+  }
+#elif defined(CLOUDTOLOCALLLM_NEON)
+  for (; end - p >= 16; p += 16) {
+    uint8x16_t chunk = vld1q_u8(p);
+    if (vmaxvq_u8(chunk) >= 0x80) {
+      break;
+    }
+  }
+#endif
+  for (; p < end; ++p) {
+    if (*p >= 0x80) {
+      break;
+    }
+  }
+  return static_cast<size_t>(p - begin);
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,26 @@
+#ifndef NATIVE_BYTE_SCAN_H_
+#define NATIVE_BYTE_SCAN_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cloudtolocalllm {
+
+// Returns a pointer to the first occurrence of |needle| in [begin, end), or
+// |end| if there is none. Uses SSE2 on x86-64 and NEON on ARM64, scanning 16
+// bytes per step, and falls back to a scalar loop elsewhere.
+const uint8_t* FindByte(const uint8_t* begin, const uint8_t* end,
+                        uint8_t needle);
+
+// Returns a pointer to the first byte in [begin, end) that is either |a| or
+// |b|, or |end| if there is none. Used to skip over JSON string bodies, where
+// only '"' and '\\' are interesting.
+const uint8_t* FindEitherByte(const uint8_t* begin, const uint8_t* end,
+                              uint8_t a, uint8_t b);
+
+// Returns the number of leading bytes in [begin, end) that are 7-bit ASCII.
+size_t CountAsciiPrefix(const uint8_t* begin, const uint8_t* end);
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_BYTE_SCAN_H_
@@ -0,0 +1,422 @@
+#include "native/chacha20_poly1305.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CLOUDTOLOCALLLM_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define CLOUDTOLOCALLLM_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace cloudtolocalllm {
+
+namespace {
+
+constexpr size_t kBlockSize = 64;
+
+// "expand 32-byte k"
+constexpr uint32_t kSigma[4] = {0x61707865, 0x3320646e, 0x79622d32,
+                                0x6b206574};
+
+inline uint32_t Load32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) |
+         (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline void Store32(uint8_t* p, uint32_t value) {
+  p[0] = static_cast<uint8_t>(value);
+  p[1] = static_cast<uint8_t>(value >> 8);
+  p[2] = static_cast<uint8_t>(value >> 16);
+  p[3] = static_cast<uint8_t>(value >> 24);
+}
+
+inline uint32_t Rotl(uint32_t value, int bits) {
+  return (value << bits) | (value >> (32 - bits));
+}
+
+void InitState(uint32_t state[16], const uint32_t key[8], uint32_t counter,
+               const uint8_t nonce[12]) {
+  std::memcpy(state, kSigma, sizeof(kSigma));
+  std::memcpy(state + 4, key, 8 * sizeof(uint32_t));
+  state[12] = counter;
+  state[13] = Load32(nonce);
+  state[14] = Load32(nonce + 4);
+  state[15] = Load32(nonce + 8);
+}
+
+// One 64-byte keystream block.
+void ChaChaBlock(const uint32_t input[16], uint8_t out[kBlockSize]) {
+  uint32_t x[16];
+  std::memcpy(x, input, sizeof(x));
+#define QUARTER_ROUND(a, b, c, d) \
+  x[a] += x[b];                   \
+  x[d] = Rotl(x[d] ^ x[a], 16);   \
+  x[c] += x[d];                   \
+  x[b] = Rotl(x[b] ^ x[c], 12);   \
+  x[a] += x[b];                   \
+  x[d] = Rotl(x[d] ^ x[a], 8);    \
+  x[c] += x[d];                   \
+  x[b] = Rotl(x[b] ^ x[c], 7);
+  for (int i = 0; i < 10; i++) {
+    QUARTER_ROUND(0, 4, 8, 12)
+    QUARTER_ROUND(1, 5, 9, 13)
+    QUARTER_ROUND(2, 6, 10, 14)
+    QUARTER_ROUND(3, 7, 11, 15)
+    QUARTER_ROUND(0, 5, 10, 15)
+    QUARTER_ROUND(1, 6, 11, 12)
+    QUARTER_ROUND(2, 7, 8, 13)
+    QUARTER_ROUND(3, 4, 9, 14)
+  }
+#undef QUARTER_ROUND
+  for (int i = 0; i < 16; i++) {
+    Store32(out + 4 * i, x[i] + input[i]);
+  }
+}
+
+#if defined(CLOUDTOLOCALLLM_SSE2) || defined(CLOUDTOLOCALLLM_NEON)
+
+// Four blocks in parallel: lane j of vector i holds word i of block j, so the
+// quarter rounds are plain vector adds, xors and rotates.
+#if defined(CLOUDTOLOCALLLM_SSE2)
+using Vec = __m128i;
+inline Vec Add(Vec a, Vec b) { return _mm_add_epi32(a, b); }
+inline Vec Xor(Vec a, Vec b) { return _mm_xor_si128(a, b); }
+template <int bits>
+inline Vec RotlVec(Vec v) {
+  return _mm_or_si128(_mm_slli_epi32(v, bits), _mm_srli_epi32(v, 32 - bits));
+}
+inline Vec Splat(uint32_t value) {
+  return _mm_set1_epi32(static_cast<int>(value));
+}
+inline Vec CounterLanes(uint32_t counter) {
+  return _mm_add_epi32(_mm_set1_epi32(static_cast<int>(counter)),
+                       _mm_set_epi32(3, 2, 1, 0));
+}
+inline void StoreVec(uint32_t* out, Vec v) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+}
+#else
+using Vec = uint32x4_t;
+inline Vec Add(Vec a, Vec b) { return vaddq_u32(a, b); }
+inline Vec Xor(Vec a, Vec b) { return veorq_u32(a, b); }
+template <int bits>
+inline Vec RotlVec(Vec v) {
+  return vsriq_n_u32(vshlq_n_u32(v, bits), v, 32 - bits);
+}
+inline Vec Splat(uint32_t value) { return vdupq_n_u32(value); }
+inline Vec CounterLanes(uint32_t counter) {
+  const uint32_t offsets[4] = {0, 1, 2, 3};
+  return vaddq_u32(vdupq_n_u32(counter), vld1q_u32(offsets));
+}
+inline void StoreVec(uint32_t* out, Vec v) { vst1q_u32(out, v); }
+#endif
+
+// Writes four consecutive keystream blocks (256 bytes) starting at the
+// counter in |input|[12].
+void ChaChaBlocks4(const uint32_t input[16], uint8_t out[4 * kBlockSize]) {
+  Vec initial[16];
+  for (int i = 0; i < 16; i++) {
+    initial[i] = i == 12 ? CounterLanes(input[12]) : Splat(input[i]);
+  }
+  Vec x[16];
+  for (int i = 0; i < 16; i++) {
+    x[i] = initial[i];
+  }
+#define QUARTER_ROUND(a, b, c, d)       \
+  x[a] = Add(x[a], x[b]);               \
+  x[d] = RotlVec<16>(Xor(x[d], x[a]));  \
+  x[c] = Add(x[c], x[d]);               \
+  x[b] = RotlVec<12>(Xor(x[b], x[c]));  \
+  x[a] = Add(x[a], x[b]);               \
+  x[d] = RotlVec<8>(Xor(x[d], x[a]));   \
+  x[c] = Add(x[c], x[d]);               \
+  x[b] = RotlVec<7>(Xor(x[b], x[c]));
+  for (int i = 0; i < 10; i++) {
+    QUARTER_ROUND(0, 4, 8, 12)
+    QUARTER_ROUND(1, 5, 9, 13)
+    QUARTER_ROUND(2, 6, 10, 14)
+    QUARTER_ROUND(3, 7, 11, 15)
+    QUARTER_ROUND(0, 5, 10, 15)
+    QUARTER_ROUND(1, 6, 11, 12)
+    QUARTER_ROUND(2, 7, 8, 13)
+    QUARTER_ROUND(3, 4, 9, 14)
+  }
+#undef QUARTER_ROUND
+  uint32_t lanes[16][4];
+  for (int i = 0; i < 16; i++) {
+    StoreVec(lanes[i], Add(x[i], initial[i]));
+  }
+  for (int block = 0; block < 4; block++) {
+    for (int i = 0; i < 16; i++) {
+      Store32(out + block * kBlockSize + 4 * i, lanes[i][block]);
+    }
+  }
+}
+
+#endif  // CLOUDTOLOCALLLM_SSE2 || CLOUDTOLOCALLLM_NEON
+
+// Poly1305 with five 26-bit limbs, after poly1305-donna's 32-bit variant.
+class Poly1305 {
+ public:
+  explicit Poly1305(const uint8_t key[32]) {
+    r_[0] = Load32(key) & 0x3ffffff;
+    r_[1] = (Load32(key + 3) >> 2) & 0x3ffff03;
+    r_[2] = (Load32(key + 6) >> 4) & 0x3ffc0ff;
+    r_[3] = (Load32(key + 9) >> 6) & 0x3f03fff;
+    r_[4] = (Load32(key + 12) >> 8) & 0x00fffff;
+    for (int i = 0; i < 4; i++) {
+      pad_[i] = Load32(key + 16 + 4 * i);
+    }
+    std::memset(h_, 0, sizeof(h_));
+  }
+
+  // Absorbs |data| followed by zero padding to a 16-byte boundary, which is
+  // how the AEAD feeds both the AAD and the ciphertext.
+  void UpdatePadded(const uint8_t* data, size_t size) {
+    while (size >= 16) {
+      Block(data, 1u << 24);
+      data += 16;
+      size -= 16;
+    }
+    if (size > 0) {
+      uint8_t block[16] = {0};
+      std::memcpy(block, data, size);
+      Block(block, 1u << 24);
+    }
+  }
+
+  void UpdateLengths(uint64_t aad_size, uint64_t text_size) {
+    uint8_t block[16];
+    for (int i = 0; i < 8; i++) {
+      block[i] = static_cast<uint8_t>(aad_size >> (8 * i));
+      block[8 + i] = static_cast<uint8_t>(text_size >> (8 * i));
+    }
+    Block(block, 1u << 24);
+  }
+
+  void Finish(uint8_t tag[16]) {
+    uint32_t h0 = h_[0];
+    uint32_t h1 = h_[1];
+    uint32_t h2 = h_[2];
+    uint32_t h3 = h_[3];
+    uint32_t h4 = h_[4];
+    uint32_t c;
+    c = h1 >> 26;
+    h1 &= 0x3ffffff;
+    h2 += c;
+    c = h2 >> 26;
+    h2 &= 0x3ffffff;
+    h3 += c;
+    c = h3 >> 26;
+    h3 &= 0x3ffffff;
+    h4 += c;
+    c = h4 >> 26;
+    h4 &= 0x3ffffff;
+    h0 += c * 5;
+    c = h0 >> 26;
+    h0 &= 0x3ffffff;
+    h1 += c;
+
+    // g = h - (2^130 - 5), selected in constant time if h >= p.
+    uint32_t g0 = h0 + 5;
+    c = g0 >> 26;
+    g0 &= 0x3ffffff;
+    uint32_t g1 = h1 + c;
+    c = g1 >> 26;
+    g1 &= 0x3ffffff;
+    uint32_t g2 = h2 + c;
+    c = g2 >> 26;
+    g2 &= 0x3ffffff;
+    uint32_t g3 = h3 + c;
+    c = g3 >> 26;
+    g3 &= 0x3ffffff;
+    uint32_t g4 = h4 + c - (1u << 26);
+
+    uint32_t mask = (g4 >> 31) - 1;
+    g0 &= mask;
+    g1 &= mask;
+    g2 &= mask;
+    g3 &= mask;
+    g4 &= mask;
+    mask = ~mask;
+    h0 = (h0 & mask) | g0;
+    h1 = (h1 & mask) | g1;
+    h2 = (h2 & mask) | g2;
+    h3 = (h3 & mask) | g3;
+    h4 = (h4 & mask) | g4;
+
+    uint32_t w0 = h0 | (h1 << 26);
+    uint32_t w1 = (h1 >> 6) | (h2 << 20);
+    uint32_t w2 = (h2 >> 12) | (h3 << 14);
+    uint32_t w3 = (h3 >> 18) | (h4 << 8);
+
+    uint64_t f = static_cast<uint64_t>(w0) + pad_[0];
+    Store32(tag, static_cast<uint32_t>(f));
+    f = static_cast<uint64_t>(w1) + pad_[1] + (f >> 32);
+    Store32(tag + 4, static_cast<uint32_t>(f));
+    f = static_cast<uint64_t>(w2) + pad_[2] + (f >> 32);
+    Store32(tag + 8, static_cast<uint32_t>(f));
+    f = static_cast<uint64_t>(w3) + pad_[3] + (f >> 32);
+    Store32(tag + 12, static_cast<uint32_t>(f));
+  }
+
+ private:
+  void Block(const uint8_t m[16], uint32_t hibit) {
+    const uint32_t r0 = r_[0], r1 = r_[1], r2 = r_[2], r3 = r_[3],
+                   r4 = r_[4];
+    const uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+
+    uint32_t h0 = h_[0] + (Load32(m) & 0x3ffffff);
+    uint32_t h1 = h_[1] + ((Load32(m + 3) >> 2) & 0x3ffffff);
+    uint32_t h2 = h_[2] + ((Load32(m + 6) >> 4) & 0x3ffffff);
+    uint32_t h3 = h_[3] + ((Load32(m + 9) >> 6) & 0x3ffffff);
+    uint32_t h4 = h_[4] + ((Load32(m + 12) >> 8) | hibit);
+
+    auto mul = [](uint32_t a, uint32_t b) {
+      return static_cast<uint64_t>(a) * b;
+    };
+    uint64_t d0 = mul(h0, r0) + mul(h1, s4) + mul(h2, s3) + mul(h3, s2) +
+                  mul(h4, s1);
+    uint64_t d1 = mul(h0, r1) + mul(h1, r0) + mul(h2, s4) + mul(h3, s3) +
+                  mul(h4, s2);
+    uint64_t d2 = mul(h0, r2) + mul(h1, r1) + mul(h2, r0) + mul(h3, s4) +
+                  mul(h4, s3);
+    uint64_t d3 = mul(h0, r3) + mul(h1, r2) + mul(h2, r1) + mul(h3, r0) +
+                  mul(h4, s4);
+    uint64_t d4 = mul(h0, r4) + mul(h1, r3) + mul(h2, r2) + mul(h3, r1) +
+                  mul(h4, r0);
+
+    uint32_t c;
+    c = static_cast<uint32_t>(d0 >> 26);
+    h0 = static_cast<uint32_t>(d0) & 0x3ffffff;
+    d1 += c;
+    c = static_cast<uint32_t>(d1 >> 26);
+    h1 = static_cast<uint32_t>(d1) & 0x3ffffff;
+    d2 += c;
+    c = static_cast<uint32_t>(d2 >> 26);
+    h2 = static_cast<uint32_t>(d2) & 0x3ffffff;
+    d3 += c;
+    c = static_cast<uint32_t>(d3 >> 26);
+    h3 = static_cast<uint32_t>(d3) & 0x3ffffff;
+    d4 += c;
+    c = static_cast<uint32_t>(d4 >> 26);
+    h4 = static_cast<uint32_t>(d4) & 0x3ffffff;
+    h0 += c * 5;
+    c = h0 >> 26;
+    h0 &= 0x3ffffff;
+    h1 += c;
+
+    h_[0] = h0;
+    h_[1] = h1;
+    h_[2] = h2;
+    h_[3] = h3;
+    h_[4] = h4;
+  }
+
+  uint32_t r_[5];
+  uint32_t h_[5];
+  uint32_t pad_[4];
+};
+
+// Compares tags without an early exit.
+bool TagsEqual(const uint8_t* a, const uint8_t* b) {
+  uint8_t diff = 0;
+  for (size_t i = 0; i < ChaCha20Poly1305::kTagSize; i++) {
+    diff |= static_cast<uint8_t>(a[i] ^ b[i]);
+  }
+  return diff == 0;
+}
+
+// Overwrites key material in a way the optimizer cannot drop.
+void SecureZero(void* data, size_t size) {
+  volatile uint8_t* p = static_cast<volatile uint8_t*>(data);
+  while (size-- > 0) {
+    *p++ = 0;
+  }
+}
+
+}  // namespace
+
+void ChaCha20Xor(const uint32_t key[8], uint32_t counter,
+                 const uint8_t nonce[12], uint8_t* data, size_t size) {
+  uint32_t state[16];
+  InitState(state, key, counter, nonce);
+#if defined(CLOUDTOLOCALLLM_SSE2) || defined(CLOUDTOLOCALLLM_NEON)
+  uint8_t stream[4 * kBlockSize];
+  while (size >= sizeof(stream)) {
+    ChaChaBlocks4(state, stream);
+    for (size_t i = 0; i < sizeof(stream); i++) {
+      data[i] ^= stream[i];
+    }
+    state[12] += 4;
+    data += sizeof(stream);
+    size -= sizeof(stream);
+  }
+#else
+  uint8_t stream[kBlockSize];
+#endif
+  while (size > 0) {
+    ChaChaBlock(state, stream);
+    size_t take = size < kBlockSize ? size : kBlockSize;
+    for (size_t i = 0; i < take; i++) {
+      data[i] ^= stream[i];
+    }
+    state[12] += 1;
+    data += take;
+    size -= take;
+  }
+  SecureZero(stream, sizeof(stream));
+  SecureZero(state, sizeof(state));
+}
+
+ChaCha20Poly1305::ChaCha20Poly1305(const uint8_t key[kKeySize]) {
+  for (int i = 0; i < 8; i++) {
+    key_[i] = Load32(key + 4 * i);
+  }
+}
+
+ChaCha20Poly1305::~ChaCha20Poly1305() {
+  SecureZero(key_, sizeof(key_));
+}
+
+void ChaCha20Poly1305::Seal(const uint8_t nonce[kNonceSize],
+                            const uint8_t* aad, size_t aad_size,
+                            uint8_t* data, size_t size,
+                            uint8_t tag[kTagSize]) const {
+  ChaCha20Xor(key_, 1, nonce, data, size);
+  ComputeTag(nonce, aad, aad_size, data, size, tag);
+}
+
+bool ChaCha20Poly1305::Open(const uint8_t nonce[kNonceSize],
+                            const uint8_t* aad, size_t aad_size,
+                            uint8_t* data, size_t size,
+                            const uint8_t tag[kTagSize]) const {
+  uint8_t expected[kTagSize];
+  ComputeTag(nonce, aad, aad_size, data, size, expected);
+  if (!TagsEqual(expected, tag)) {
+    return false;
+  }
+  ChaCha20Xor(key_, 1, nonce, data, size);
+  return true;
+}
+
+void ChaCha20Poly1305::ComputeTag(const uint8_t nonce[kNonceSize],
+                                  const uint8_t* aad, size_t aad_size,
+                                  const uint8_t* ciphertext, size_t size,
+                                  uint8_t tag[kTagSize]) const {
+  // The one-time Poly1305 key is the first half of keystream block 0.
+  uint8_t one_time_key[kBlockSize] = {0};
+  ChaCha20Xor(key_, 0, nonce, one_time_key, sizeof(one_time_key));
+  Poly1305 mac(one_time_key);
+  SecureZero(one_time_key, sizeof(one_time_key));
+  mac.UpdatePadded(aad, aad_size);
+  mac.UpdatePadded(ciphertext, size);
+  mac.UpdateLengths(aad_size, size);
+  mac.Finish(tag);
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,1099 @@
+#include "native/conversation_store.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cloudtolocalllm {
+
+namespace {
+
+constexpr char kLogFileName[] = "conversations.log";
+constexpr char kCompactFileName[] = "conversations.log.compact";
+constexpr char kSnapshotFileName[] = "conversations.idx";
+constexpr char kSnapshotTempFileName[] = "conversations.idx.tmp";
+constexpr char kSearchFileName[] = "conversations.search";
+constexpr char kSearchTempFileName[] = "conversations.search.tmp";
+
+// Log header: magic, u32 version, u32 reserved, u64 generation. The
+// generation changes whenever the log is rewritten, which is how a snapshot
+// of an older log is recognised.
+constexpr char kLogMagic[8] = {'C', 'T', 'L', 'L', 'M', 'L', 'O', 'G'};
+constexpr char kSnapshotMagic[8] = {'C', 'T', 'L', 'L', 'M', 'I', 'D', 'X'};
+constexpr char kSearchMagic[8] = {'C', 'T', 'L', 'L', 'M', 'S', 'R', 'C'};
+constexpr uint32_t kFormatVersion = 1;
+constexpr uint64_t kLogHeaderSize = 24;
+
+// Each record is `u32 payload size, u32 CRC-32 of the payload`, then the
+// payload, which starts with its type.
+constexpr uint32_t kRecordHeaderSize = 8;
+constexpr uint32_t kMaxPayloadSize = 64 << 20;
+
+enum RecordType : uint8_t {
+  // ConversationInfo
+  kPutConversation = 1,
+  // string conversation id
+  kDeleteConversation = 2,
+  // string conversation id, StoredMessage
+  kPutMessage = 3,
+  // string conversation id, string message id, string appended content
+  kAppendMessage = 4,
+  // string conversation id, string message id
+  kDeleteMessage = 5,
+  // nothing
+  kClear = 6,
+};
+
+uint32_t Crc32(const uint8_t* data, size_t size) {
+  static const std::vector<uint32_t> table = [] {
+    std::vector<uint32_t> entries(256);
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t value = i;
+      for (int bit = 0; bit < 8; bit++) {
+        value = (value & 1) != 0 ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+      }
+      entries[i] = value;
+    }
+    return entries;
+  }();
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; i++) {
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return crc ^ 0xFFFFFFFFu;
+}
+
+uint64_t NewGeneration() {
+  std::random_device random;
+  return (static_cast<uint64_t>(random()) << 32) ^ random();
+}
+
+bool SkipString(WireReader* reader) {
+  uint32_t length;
+  const uint8_t* span;
+  return reader->ReadU32(&length) && reader->ReadSpan(length, &span);
+}
+
+std::vector<uint8_t> ReadFile(const std::filesystem::path& path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::vector<uint8_t>((std::istreambuf_iterator<char>(in)),
+                              std::istreambuf_iterator<char>());
+}
+
+// Snapshots start with |magic| and end with a CRC-32 of everything before
+// it; returns a reader over what is in between, or false if either is off.
+bool OpenSnapshot(const std::vector<uint8_t>& data, const char* magic,
+                  WireReader* reader) {
+  constexpr size_t kMagicSize = 8;
+  if (data.size() < kMagicSize + 4) {
+    return false;
+  }
+  const size_t body_size = data.size() - 4;
+  WireReader trailer(data.data() + body_size, 4);
+  uint32_t crc = 0;
+  if (!trailer.ReadU32(&crc) || crc != Crc32(data.data(), body_size) ||
+      std::memcmp(data.data(), magic, kMagicSize) != 0) {
+    return false;
+  }
+  *reader = WireReader(data.data() + kMagicSize, body_size - kMagicSize);
+  return true;
+}
+
+// Writes |data| plus its CRC-32 to |temp_path| and renames it over |path|.
+bool WriteSnapshotFile(std::vector<uint8_t>* data,
+                       const std::filesystem::path& path,
+                       const std::filesystem::path& temp_path) {
+  WireWriter(data).WriteU32(Crc32(data->data(), data->size()));
+  std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(data->data()),
+            static_cast<std::streamsize>(data->size()));
+  out.close();
+  std::error_code error;
+  if (out.fail()) {
+    std::filesystem::remove(temp_path, error);
+    return false;
+  }
+  std::filesystem::rename(temp_path, path, error);
+  return !error;
+}
+
+}  // namespace
+
+// The log's descriptor plus a read-only mapping of it. Appends go through
+// the descriptor; the mapping is redone when a read reaches past it.
+class LogFile {
+ public:
+  LogFile() = default;
+  ~LogFile() { Close(); }
+
+  // Prevent copying.
+  LogFile(LogFile const&) = delete;
+  LogFile& operator=(LogFile const&) = delete;
+
+  bool Open(const std::filesystem::path& path) {
+#ifdef _WIN32
+    file_ = ::CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                          FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                          FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER size;
+    if (file_ == INVALID_HANDLE_VALUE || !::GetFileSizeEx(file_, &size)) {
+      return false;
+    }
+    size_ = static_cast<uint64_t>(size.QuadPart);
+#else
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    struct stat info;
+    if (fd_ < 0 || ::fstat(fd_, &info) != 0) {
+      return false;
+    }
+    size_ = static_cast<uint64_t>(info.st_size);
+#endif
+    return true;
+  }
+
+  void Close() {
+    Unmap();
+#ifdef _WIN32
+    if (file_ != INVALID_HANDLE_VALUE) {
+      ::CloseHandle(file_);
+      file_ = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+#endif
+  }
+
+  uint64_t size() const { return size_; }
+
+  // Writes |size| bytes at the end; on failure the file is cut back to its
+  // previous size so no partial record is left behind.
+  bool Append(const uint8_t* data, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+#ifdef _WIN32
+      const uint64_t offset = size_ + written;
+      OVERLAPPED overlapped = {};
+      overlapped.Offset = static_cast<DWORD>(offset);
+      overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+      DWORD chunk = 0;
+      if (!::WriteFile(file_, data + written,
+                       static_cast<DWORD>(std::min<size_t>(size - written,
+                                                           1u << 30)),
+                       &chunk, &overlapped)) {
+        Truncate(size_);
+        return false;
+      }
+#else
+      const ssize_t chunk =
+          ::pwrite(fd_, data + written, size - written,
+                   static_cast<off_t>(size_ + written));
+      if (chunk < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        Truncate(size_);
+        return false;
+      }
+#endif
+      written += static_cast<size_t>(chunk);
+    }
+    size_ += size;
+    return true;
+  }
+
+  bool Truncate(uint64_t size) {
+    Unmap();
+#ifdef _WIN32
+    LARGE_INTEGER position;
+    position.QuadPart = static_cast<LONGLONG>(size);
+    if (!::SetFilePointerEx(file_, position, nullptr, FILE_BEGIN) ||
+        !::SetEndOfFile(file_)) {
+      return false;
+    }
+#else
+    if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+      return false;
+    }
+#endif
+    size_ = size;
+    return true;
+  }
+
+  // The first |end| bytes of the file, or null if it is shorter or cannot be
+  // mapped. The pointer stays valid until the next Map(), Truncate() or
+  // Close().
+  const uint8_t* Map(uint64_t end) {
+    if (end > size_ || end == 0) {
+      return nullptr;
+    }
+    if (end <= mapped_size_) {
+      return view_;
+    }
+    Unmap();
+#ifdef _WIN32
+    mapping_ =
+        ::CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = mapping_ != nullptr
+                     ? ::MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0)
+                     : nullptr;
+    if (view == nullptr) {
+      Unmap();
+      return nullptr;
+    }
+#else
+    void* view = ::mmap(nullptr, static_cast<size_t>(size_), PROT_READ,
+                        MAP_SHARED, fd_, 0);
+    if (view == MAP_FAILED) {
+      return nullptr;
+    }
+#endif
+    view_ = static_cast<const uint8_t*>(view);
+    mapped_size_ = size_;
+    return view_;
+  }
+
+  // Safe to call from another thread while the owner appends.
+  bool Sync() {
+#ifdef _WIN32
+    return ::FlushFileBuffers(file_) != 0;
+#else
+    return ::fdatasync(fd_) == 0;
+#endif
+  }
+
+ private:
+  void Unmap() {
+#ifdef _WIN32
+    if (view_ != nullptr) {
+      ::UnmapViewOfFile(view_);
+    }
+    if (mapping_ != nullptr) {
+      ::CloseHandle(mapping_);
+      mapping_ = nullptr;
+    }
+#else
+    if (view_ != nullptr) {
+      ::munmap(const_cast<uint8_t*>(view_), static_cast<size_t>(mapped_size_));
+    }
+#endif
+    view_ = nullptr;
+    mapped_size_ = 0;
+  }
+
+#ifdef _WIN32
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+  uint64_t size_ = 0;
+  const uint8_t* view_ = nullptr;
+  uint64_t mapped_size_ = 0;
+};
+
+void WriteConversationInfo(const ConversationInfo& info, WireWriter* writer) {
+  writer->WriteString(info.id);
+  writer->WriteString(info.title);
+  writer->WriteU8(info.has_model ? 1 : 0);
+  writer->WriteString(info.model);
+  writer->WriteI64(info.created_ms);
+  writer->WriteI64(info.updated_ms);
+}
+
+bool ReadConversationInfo(WireReader* reader, ConversationInfo* info) {
+  uint8_t has_model = 0;
+  reader->ReadString(&info->id);
+  reader->ReadString(&info->title);
+  reader->ReadU8(&has_model);
+  reader->ReadString(&info->model);
+  reader->ReadI64(&info->created_ms);
+  reader->ReadI64(&info->updated_ms);
+  info->has_model = has_model != 0;
+  return reader->ok();
+}
+
+void WriteStoredMessage(const StoredMessage& message, WireWriter* writer) {
+  writer->WriteString(message.id);
+  writer->WriteString(message.role);
+  writer->WriteString(message.status);
+  writer->WriteU8(message.has_model ? 1 : 0);
+  writer->WriteString(message.model);
+  writer->WriteU8(message.has_error ? 1 : 0);
+  writer->WriteString(message.error);
+  writer->WriteI64(message.timestamp_ms);
+  writer->WriteString(message.content);
+}
+
+bool ReadStoredMessage(WireReader* reader, StoredMessage* message) {
+  uint8_t has_model = 0;
+  uint8_t has_error = 0;
+  reader->ReadString(&message->id);
+  reader->ReadString(&message->role);
+  reader->ReadString(&message->status);
+  reader->ReadU8(&has_model);
+  reader->ReadString(&message->model);
+  reader->ReadU8(&has_error);
+  reader->ReadString(&message->error);
+  reader->ReadI64(&message->timestamp_ms);
+  reader->ReadString(&message->content);
+  message->has_model = has_model != 0;
+  message->has_error = has_error != 0;
+  return reader->ok();
+}
+
+ConversationStore::ConversationStore()
+    : generation_(0),
+      dead_bytes_(0),
+      indexing_(true),
+      sync_requested_(false),
+      stopping_(false) {}
+
+ConversationStore::~ConversationStore() {
+  Close();
+}
+
+bool ConversationStore::Open(const std::string& directory) {
+  Close();
+  directory_ = directory;
+  log_ = OpenLog(StorePath(kLogFileName), &generation_);
+  if (log_ == nullptr) {
+    return false;
+  }
+  dead_bytes_ = 0;
+  const uint64_t covered = LoadSnapshot();
+  const bool search_loaded =
+      covered > kLogHeaderSize && LoadSearchSnapshot(covered);
+  indexing_ = search_loaded;
+  const bool replayed = ReplayLog(covered);
+  indexing_ = true;
+  if (!replayed) {
+    conversations_.clear();
+    search_index_.Clear();
+    log_.reset();
+    return false;
+  }
+  if (!search_loaded) {
+    RebuildSearchIndex();
+  }
+  if (dead_bytes_ >= kCompactThreshold && dead_bytes_ * 2 > log_->size()) {
+    Compact();
+  }
+  if (log_ == nullptr) {
+    return false;
+  }
+  StartSyncThread();
+  return true;
+}
+
+void ConversationStore::Close() {
+  if (log_ == nullptr) {
+    return;
+  }
+  StopSyncThread();
+  log_->Sync();
+  WriteSnapshot();
+  log_.reset();
+  conversations_.clear();
+  search_index_.Clear();
+  unindexed_.clear();
+  dead_bytes_ = 0;
+}
+
+uint64_t ConversationStore::log_size() const {
+  return log_ != nullptr ? log_->size() : 0;
+}
+
+bool ConversationStore::PutConversation(const ConversationInfo& info) {
+  if (log_ == nullptr) {
+    return false;
+  }
+  WireWriter writer = BeginRecord(kPutConversation);
+  WriteConversationInfo(info, &writer);
+  return Write();
+}
+
+bool ConversationStore::DeleteConversation(const std::string& conversation_id) {
+  if (log_ == nullptr) {
+    return false;
+  }
+  if (conversations_.count(conversation_id) == 0) {
+    return true;
+  }
+  WireWriter writer = BeginRecord(kDeleteConversation);
+  writer.WriteString(conversation_id);
+  return Write();
+}
+
+bool ConversationStore::PutMessage(const std::string& conversation_id,
+                                   const StoredMessage& message) {
+  if (log_ == nullptr || conversations_.count(conversation_id) == 0) {
+    return false;
+  }
+  WireWriter writer = BeginRecord(kPutMessage);
+  writer.WriteString(conversation_id);
+  WriteStoredMessage(message, &writer);
+  return Write();
+}
+
+bool ConversationStore::AppendToMessage(const std::string& conversation_id,
+                                        const std::string& message_id,
+                                        const char* data, size_t size) {
+  if (log_ == nullptr) {
+    return false;
+  }
+  auto it = conversations_.find(conversation_id);
+  if (it == conversations_.end() ||
+      it->second.message_index.count(message_id) == 0) {
+    return false;
+  }
+  WireWriter writer = BeginRecord(kAppendMessage);
+  writer.WriteString(conversation_id);
+  writer.WriteString(message_id);
+  writer.WriteU32(static_cast<uint32_t>(size));
+  writer.WriteBytes(data, size);
+  return Write();
+}
+
+bool ConversationStore::DeleteMessage(const std::string& conversation_id,
+                                      const std::string& message_id) {
+  if (log_ == nullptr) {
+    return false;
+  }
+  auto it = conversations_.find(conversation_id);
+  if (it == conversations_.end() ||
+      it->second.message_index.count(message_id) == 0) {
+    return true;
+  }
+  WireWriter writer = BeginRecord(kDeleteMessage);
+  writer.WriteString(conversation_id);
+  writer.WriteString(message_id);
+  return Write();
+}
+
+bool ConversationStore::Clear() {
+  if (log_ == nullptr) {
+    return false;
+  }
+  if (conversations_.empty()) {
+    return true;
+  }
+  BeginRecord(kClear);
+  return Write();
+}
+
+std::vector<ConversationSummary> ConversationStore::ListConversations() const {
+  std::vector<ConversationSummary> summaries;
+  summaries.reserve(conversations_.size());
+  for (const auto& [id, entry] : conversations_) {
+    ConversationSummary summary;
+    summary.info = entry.info;
+    summary.message_count = static_cast<uint32_t>(entry.messages.size());
+    if (!entry.messages.empty()) {
+      summary.has_last_message =
+          ReadMessage(entry.messages.back(), &summary.last_message);
+    }
+    summaries.push_back(std::move(summary));
+  }
+  std::sort(summaries.begin(), summaries.end(),
+            [](const ConversationSummary& a, const ConversationSummary& b) {
+              return a.info.updated_ms > b.info.updated_ms;
+            });
+  return summaries;
+}
+
+bool ConversationStore::LoadMessages(
+    const std::string& conversation_id,
+    std::vector<StoredMessage>* messages) const {
+  messages->clear();
+  auto it = conversations_.find(conversation_id);
+  if (it == conversations_.end()) {
+    return false;
+  }
+  messages->resize(it->second.messages.size());
+  for (size_t i = 0; i < messages->size(); i++) {
+    if (!ReadMessage(it->second.messages[i], &(*messages)[i])) {
+      messages->clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<SearchHit> ConversationStore::Search(const std::string& query,
+                                                 size_t limit) {
+  RefreshSearchIndex();
+  return search_index_.Search(query, limit);
+}
+
+void ConversationStore::Sync() {
+  {
+    std::lock_guard<std::mutex> lock(sync_mutex_);
+    sync_requested_ = true;
+  }
+  sync_cv_.notify_one();
+}
+
+bool ConversationStore::Compact() {
+  if (log_ == nullptr) {
+    return false;
+  }
+  const std::filesystem::path path = StorePath(kLogFileName);
+  const std::filesystem::path compact_path = StorePath(kCompactFileName);
+  std::error_code error;
+  std::filesystem::remove(compact_path, error);
+
+  uint64_t generation = 0;
+  std::unique_ptr<LogFile> compacted = OpenLog(compact_path, &generation);
+  if (compacted == nullptr) {
+    return false;
+  }
+  ConversationMap rebuilt;
+  bool ok = true;
+  for (const auto& [id, entry] : conversations_) {
+    ConversationEntry& copy = rebuilt[id];
+    copy.info = entry.info;
+    WireWriter writer = BeginRecord(kPutConversation);
+    WriteConversationInfo(entry.info, &writer);
+    ok = ok && FinishRecord(compacted.get(), &copy.record);
+
+    StoredMessage message;
+    for (const MessageEntry& message_entry : entry.messages) {
+      RecordRef ref;
+      ok = ok && ReadMessage(message_entry, &message);
+      writer = BeginRecord(kPutMessage);
+      writer.WriteString(id);
+      WriteStoredMessage(message, &writer);
+      ok = ok && FinishRecord(compacted.get(), &ref);
+      copy.message_index.emplace(message_entry.id, copy.messages.size());
+      copy.messages.push_back(MessageEntry{message_entry.id, {ref}});
+    }
+  }
+  ok = ok && compacted->Sync();
+  compacted.reset();
+  if (!ok) {
+    std::filesystem::remove(compact_path, error);
+    return false;
+  }
+
+  {
+    // On Windows the log cannot be replaced while it is open.
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    log_.reset();
+    std::filesystem::rename(compact_path, path, error);
+    if (error) {
+      std::filesystem::remove(compact_path, error);
+      log_ = OpenLog(path, &generation_);
+      if (log_ == nullptr) {
+        conversations_.clear();
+      }
+      return false;
+    }
+    log_ = OpenLog(path, &generation_);
+  }
+  if (log_ == nullptr) {
+    conversations_.clear();
+    return false;
+  }
+  conversations_ = std::move(rebuilt);
+  dead_bytes_ = 0;
+  WriteSnapshot();
+  return true;
+}
+
+std::filesystem::path ConversationStore::StorePath(const char* name) const {
+  return std::filesystem::u8path(directory_) / name;
+}
+
+std::unique_ptr<LogFile> ConversationStore::OpenLog(
+    const std::filesystem::path& path,
+    uint64_t* generation) {
+  auto log = std::make_unique<LogFile>();
+  if (!log->Open(path)) {
+    return nullptr;
+  }
+  if (log->size() < kLogHeaderSize) {
+    // New, or cut short before its header was complete.
+    std::vector<uint8_t> header;
+    WireWriter writer(&header);
+    writer.WriteBytes(kLogMagic, sizeof(kLogMagic));
+    writer.WriteU32(kFormatVersion);
+    writer.WriteU32(0);
+    *generation = NewGeneration();
+    writer.WriteU64(*generation);
+    if (!log->Truncate(0) || !log->Append(header.data(), header.size()) ||
+        !log->Sync()) {
+      return nullptr;
+    }
+    return log;
+  }
+  const uint8_t* header = log->Map(kLogHeaderSize);
+  if (header == nullptr) {
+    return nullptr;
+  }
+  WireReader reader(header, kLogHeaderSize);
+  const uint8_t* magic = nullptr;
+  uint32_t version = 0;
+  uint32_t reserved = 0;
+  reader.ReadSpan(sizeof(kLogMagic), &magic);
+  reader.ReadU32(&version);
+  reader.ReadU32(&reserved);
+  reader.ReadU64(generation);
+  // A log from a newer version is left alone rather than overwritten.
+  if (!reader.ok() || std::memcmp(magic, kLogMagic, sizeof(kLogMagic)) != 0 ||
+      version != kFormatVersion) {
+    return nullptr;
+  }
+  return log;
+}
+
+// Snapshot layout, after the magic, u32 version and u32 reserved:
+//
+//   u64 log generation, u64 log size covered, u64 dead bytes,
+//   u32 conversation count, then for each: ConversationInfo, record,
+//   u32 message count, then for each: string message id, u32 record count
+//   and the records
+//
+// where a record is `u64 offset, u32 size`, followed by a CRC-32 of
+// everything before it.
+uint64_t ConversationStore::LoadSnapshot() {
+  const std::vector<uint8_t> data = ReadFile(StorePath(kSnapshotFileName));
+  WireReader reader(nullptr, 0);
+  if (!OpenSnapshot(data, kSnapshotMagic, &reader)) {
+    return kLogHeaderSize;
+  }
+  uint32_t version = 0;
+  uint32_t reserved = 0;
+  uint64_t generation = 0;
+  uint64_t covered = 0;
+  uint64_t dead_bytes = 0;
+  uint32_t conversation_count = 0;
+  reader.ReadU32(&version);
+  reader.ReadU32(&reserved);
+  reader.ReadU64(&generation);
+  reader.ReadU64(&covered);
+  reader.ReadU64(&dead_bytes);
+  reader.ReadU32(&conversation_count);
+  if (!reader.ok() || version != kFormatVersion || generation != generation_ ||
+      covered < kLogHeaderSize || covered > log_->size()) {
+    return kLogHeaderSize;
+  }
+
+  auto read_ref = [&reader, covered](RecordRef* ref) {
+    return reader.ReadU64(&ref->offset) && reader.ReadU32(&ref->size) &&
+           ref->offset >= kLogHeaderSize && ref->size > kRecordHeaderSize &&
+           ref->offset + ref->size <= covered;
+  };
+  ConversationMap conversations;
+  for (uint32_t i = 0; i < conversation_count; i++) {
+    ConversationInfo info;
+    RecordRef record;
+    uint32_t message_count = 0;
+    if (!ReadConversationInfo(&reader, &info) || !read_ref(&record) ||
+        !reader.ReadU32(&message_count) ||
+        message_count > reader.remaining()) {
+      return kLogHeaderSize;
+    }
+    ConversationEntry& entry = conversations[info.id];
+    entry.info = std::move(info);
+    entry.record = record;
+    entry.messages.resize(message_count);
+    for (uint32_t j = 0; j < message_count; j++) {
+      MessageEntry& message = entry.messages[j];
+      uint32_t record_count = 0;
+      if (!reader.ReadString(&message.id) || !reader.ReadU32(&record_count) ||
+          record_count == 0 || record_count > reader.remaining()) {
+        return kLogHeaderSize;
+      }
+      message.records.resize(record_count);
+      for (RecordRef& ref : message.records) {
+        if (!read_ref(&ref)) {
+          return kLogHeaderSize;
+        }
+      }
+      entry.message_index.emplace(message.id, j);
+    }
+  }
+  if (reader.remaining() != 0) {
+    return kLogHeaderSize;
+  }
+  conversations_ = std::move(conversations);
+  dead_bytes_ = dead_bytes;
+  return covered;
+}
+
+bool ConversationStore::WriteSnapshot() {
+  std::vector<uint8_t> data;
+  WireWriter writer(&data);
+  writer.WriteBytes(kSnapshotMagic, sizeof(kSnapshotMagic));
+  writer.WriteU32(kFormatVersion);
+  writer.WriteU32(0);
+  writer.WriteU64(generation_);
+  writer.WriteU64(log_->size());
+  writer.WriteU64(dead_bytes_);
+  writer.WriteU32(static_cast<uint32_t>(conversations_.size()));
+  auto write_ref = [&writer](const RecordRef& ref) {
+    writer.WriteU64(ref.offset);
+    writer.WriteU32(ref.size);
+  };
+  for (const auto& [id, entry] : conversations_) {
+    WriteConversationInfo(entry.info, &writer);
+    write_ref(entry.record);
+    writer.WriteU32(static_cast<uint32_t>(entry.messages.size()));
+    for (const MessageEntry& message : entry.messages) {
+      writer.WriteString(message.id);
+      writer.WriteU32(static_cast<uint32_t>(message.records.size()));
+      for (const RecordRef& ref : message.records) {
+        write_ref(ref);
+      }
+    }
+  }
+  if (!WriteSnapshotFile(&data, StorePath(kSnapshotFileName),
+                         StorePath(kSnapshotTempFileName))) {
+    return false;
+  }
+
+  RefreshSearchIndex();
+  std::vector<uint8_t> search;
+  WireWriter search_writer(&search);
+  search_writer.WriteBytes(kSearchMagic, sizeof(kSearchMagic));
+  search_writer.WriteU32(kFormatVersion);
+  search_writer.WriteU32(0);
+  search_writer.WriteU64(generation_);
+  search_writer.WriteU64(log_->size());
+  search_index_.Serialize(&search_writer);
+  return WriteSnapshotFile(&search, StorePath(kSearchFileName),
+                           StorePath(kSearchTempFileName));
+}
+
+// Search snapshot layout, after the magic, u32 version and u32 reserved:
+// u64 log generation, u64 log size covered, then SearchIndex::Serialize(),
+// followed by a CRC-32 of everything before it.
+bool ConversationStore::LoadSearchSnapshot(uint64_t covered) {
+  const std::vector<uint8_t> data = ReadFile(StorePath(kSearchFileName));
+  WireReader reader(nullptr, 0);
+  if (!OpenSnapshot(data, kSearchMagic, &reader)) {
+    return false;
+  }
+  uint32_t version = 0;
+  uint32_t reserved = 0;
+  uint64_t generation = 0;
+  uint64_t search_covered = 0;
+  reader.ReadU32(&version);
+  reader.ReadU32(&reserved);
+  reader.ReadU64(&generation);
+  reader.ReadU64(&search_covered);
+  if (!reader.ok() || version != kFormatVersion || generation != generation_ ||
+      search_covered != covered || !search_index_.Deserialize(&reader) ||
+      reader.remaining() != 0) {
+    search_index_.Clear();
+    return false;
+  }
+  return true;
+}
+
+bool ConversationStore::ReplayLog(uint64_t offset) {
+  const uint64_t size = log_->size();
+  if (offset >= size) {
+    return true;
+  }
+  const uint8_t* base = log_->Map(size);
+  if (base == nullptr) {
+    return false;
+  }
+  while (size - offset >= kRecordHeaderSize) {
+    WireReader header(base + offset, kRecordHeaderSize);
+    uint32_t payload_size = 0;
+    uint32_t crc = 0;
+    header.ReadU32(&payload_size);
+    header.ReadU32(&crc);
+    if (payload_size == 0 || payload_size > kMaxPayloadSize ||
+        payload_size > size - offset - kRecordHeaderSize) {
+      break;
+    }
+    const uint8_t* payload = base + offset + kRecordHeaderSize;
+    if (Crc32(payload, payload_size) != crc) {
+      break;
+    }
+    const RecordRef ref{offset, kRecordHeaderSize + payload_size};
+    if (!Apply(payload, payload_size, ref)) {
+      // Intact but not understood; nothing refers to it.
+      dead_bytes_ += ref.size;
+    }
+    offset += ref.size;
+  }
+  // Whatever is left is a record the last session was writing when it died.
+  return offset == size || log_->Truncate(offset);
+}
+
+WireWriter ConversationStore::BeginRecord(uint8_t type) {
+  scratch_.clear();
+  WireWriter writer(&scratch_);
+  writer.WriteU32(0);
+  writer.WriteU32(0);
+  writer.WriteU8(type);
+  return writer;
+}
+
+bool ConversationStore::FinishRecord(LogFile* log, RecordRef* ref) {
+  const uint32_t payload_size =
+      static_cast<uint32_t>(scratch_.size() - kRecordHeaderSize);
+  if (payload_size > kMaxPayloadSize) {
+    return false;
+  }
+  WireWriter writer(&scratch_);
+  writer.PatchU32(0, payload_size);
+  writer.PatchU32(4, Crc32(scratch_.data() + kRecordHeaderSize, payload_size));
+  ref->offset = log->size();
+  ref->size = static_cast<uint32_t>(scratch_.size());
+  return log->Append(scratch_.data(), scratch_.size());
+}
+
+bool ConversationStore::Write() {
+  RecordRef ref;
+  return FinishRecord(log_.get(), &ref) &&
+         Apply(scratch_.data() + kRecordHeaderSize,
+               scratch_.size() - kRecordHeaderSize, ref);
+}
+
+bool ConversationStore::Apply(const uint8_t* payload, size_t size,
+                              RecordRef ref) {
+  WireReader reader(payload, size);
+  uint8_t type = 0;
+  std::string conversation_id;
+  std::string message_id;
+  reader.ReadU8(&type);
+  switch (type) {
+    case kPutConversation: {
+      ConversationInfo info;
+      if (!ReadConversationInfo(&reader, &info)) {
+        return false;
+      }
+      auto [it, inserted] = conversations_.try_emplace(info.id);
+      if (!inserted) {
+        dead_bytes_ += it->second.record.size;
+      }
+      it->second.info = std::move(info);
+      it->second.record = ref;
+      return true;
+    }
+    case kDeleteConversation: {
+      if (!reader.ReadString(&conversation_id)) {
+        return false;
+      }
+      auto it = conversations_.find(conversation_id);
+      if (it != conversations_.end()) {
+        ForgetMessages(conversation_id, &it->second);
+        dead_bytes_ += it->second.record.size;
+        conversations_.erase(it);
+      }
+      dead_bytes_ += ref.size;
+      return true;
+    }
+    case kPutMessage:
+    case kAppendMessage:
+    case kDeleteMessage: {
+      if (!reader.ReadString(&conversation_id) ||
+          !reader.ReadString(&message_id)) {
+        return false;
+      }
+      auto it = conversations_.find(conversation_id);
+      if (it == conversations_.end()) {
+        dead_bytes_ += ref.size;
+        return true;
+      }
+      ConversationEntry& entry = it->second;
+      auto message = entry.message_index.find(message_id);
+      if (type == kPutMessage) {
+        if (message == entry.message_index.end()) {
+          entry.message_index.emplace(message_id, entry.messages.size());
+          entry.messages.push_back(MessageEntry{message_id, {ref}});
+        } else {
+          MessageEntry& existing = entry.messages[message->second];
+          for (const RecordRef& old : existing.records) {
+            dead_bytes_ += old.size;
+          }
+          existing.records.assign(1, ref);
+        }
+        if (indexing_) {
+          WireReader message_reader(payload, size);
+          StoredMessage stored;
+          message_reader.ReadU8(&type);
+          SkipString(&message_reader);
+          if (ReadStoredMessage(&message_reader, &stored)) {
+            search_index_.Put(conversation_id, message_id,
+                              stored.content.data(), stored.content.size());
+          }
+          unindexed_.erase({conversation_id, message_id});
+        }
+      } else if (message == entry.message_index.end()) {
+        dead_bytes_ += ref.size;
+      } else if (type == kAppendMessage) {
+        entry.messages[message->second].records.push_back(ref);
+        if (indexing_) {
+          unindexed_.emplace(conversation_id, message_id);
+        }
+      } else {
+        ForgetMessage(conversation_id, &entry, message->second);
+        dead_bytes_ += ref.size;
+      }
+      return true;
+    }
+    case kClear:
+      for (auto& [id, entry] : conversations_) {
+        ForgetMessages(id, &entry);
+        dead_bytes_ += entry.record.size;
+      }
+      conversations_.clear();
+      dead_bytes_ += ref.size;
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool ConversationStore::ReadMessage(const MessageEntry& entry,
+                                    StoredMessage* message) const {
+  const RecordRef& last = entry.records.back();
+  const uint8_t* base = log_->Map(last.offset + last.size);
+  if (base == nullptr) {
+    return false;
+  }
+  for (size_t i = 0; i < entry.records.size(); i++) {
+    const RecordRef& ref = entry.records[i];
+    WireReader reader(base + ref.offset + kRecordHeaderSize,
+                      ref.size - kRecordHeaderSize);
+    uint8_t type = 0;
+    reader.ReadU8(&type);
+    SkipString(&reader);
+    if (i == 0) {
+      if (type != kPutMessage || !ReadStoredMessage(&reader, message)) {
+        return false;
+      }
+      continue;
+    }
+    uint32_t length = 0;
+    const uint8_t* appended = nullptr;
+    if (type != kAppendMessage || !SkipString(&reader) ||
+        !reader.ReadU32(&length) || !reader.ReadSpan(length, &appended)) {
+      return false;
+    }
+    message->content.append(reinterpret_cast<const char*>(appended), length);
+  }
+  return true;
+}
+
+void ConversationStore::ForgetMessages(const std::string& conversation_id,
+                                       ConversationEntry* entry) {
+  for (const MessageEntry& message : entry->messages) {
+    for (const RecordRef& ref : message.records) {
+      dead_bytes_ += ref.size;
+    }
+    search_index_.Remove(conversation_id, message.id);
+    unindexed_.erase({conversation_id, message.id});
+  }
+  entry->messages.clear();
+  entry->message_index.clear();
+}
+
+void ConversationStore::ForgetMessage(const std::string& conversation_id,
+                                      ConversationEntry* entry, size_t index) {
+  for (const RecordRef& ref : entry->messages[index].records) {
+    dead_bytes_ += ref.size;
+  }
+  search_index_.Remove(conversation_id, entry->messages[index].id);
+  unindexed_.erase({conversation_id, entry->messages[index].id});
+  entry->message_index.erase(entry->messages[index].id);
+  entry->messages.erase(entry->messages.begin() + index);
+  for (auto& [id, position] : entry->message_index) {
+    if (position > index) {
+      position--;
+    }
+  }
+}
+
+void ConversationStore::RefreshSearchIndex() {
+  StoredMessage message;
+  for (const auto& [conversation_id, message_id] : unindexed_) {
+    auto it = conversations_.find(conversation_id);
+    if (it == conversations_.end()) {
+      continue;
+    }
+    auto index = it->second.message_index.find(message_id);
+    if (index != it->second.message_index.end() &&
+        ReadMessage(it->second.messages[index->second], &message)) {
+      search_index_.Put(conversation_id, message_id, message.content.data(),
+                        message.content.size());
+    }
+  }
+  unindexed_.clear();
+}
+
+void ConversationStore::RebuildSearchIndex() {
+  search_index_.Clear();
+  unindexed_.clear();
+  StoredMessage message;
+  for (const auto& [id, entry] : conversations_) {
+    for (const MessageEntry& message_entry : entry.messages) {
+      if (ReadMessage(message_entry, &message)) {
+        search_index_.Put(id, message_entry.id, message.content.data(),
+                          message.content.size());
+      }
+    }
+  }
+}
+
+void ConversationStore::StartSyncThread() {
+  sync_requested_ = false;
+  stopping_ = false;
+  sync_thread_ = std::thread(&ConversationStore::SyncLoop, this);
+}
+
+void ConversationStore::StopSyncThread() {
+  {
+    std::lock_guard<std::mutex> lock(sync_mutex_);
+    stopping_ = true;
+  }
+  sync_cv_.notify_one();
+  if (sync_thread_.joinable()) {
+    sync_thread_.join();
+  }
+}
+
+void ConversationStore::SyncLoop() {
+  std::unique_lock<std::mutex> lock(sync_mutex_);
+  while (true) {
+    sync_cv_.wait(lock, [this] { return sync_requested_ || stopping_; });
+    if (stopping_) {
+      // Close() does the final flush itself.
+      return;
+    }
+    sync_requested_ = false;
+    lock.unlock();
+    {
+      std::lock_guard<std::mutex> file_lock(file_mutex_);
+      if (log_ != nullptr) {
+        log_->Sync();
+      }
+    }
+    lock.lock();
+  }
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,237 @@
+#ifndef NATIVE_CONVERSATION_STORE_H_
+#define NATIVE_CONVERSATION_STORE_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "native/search_index.h"
+#include "native/wire_format.h"
+
+namespace cloudtolocalllm {
+
+// Conversation metadata, everything but the messages.
+struct ConversationInfo {
+  std::string id;
+  std::string title;
+  bool has_model = false;
+  std::string model;
+  int64_t created_ms = 0;
+  int64_t updated_ms = 0;
+};
+
+// One chat message. |role| and |status| are the Dart enum names.
+struct StoredMessage {
+  std::string id;
+  std::string role;
+  std::string status;
+  bool has_model = false;
+  std::string model;
+  bool has_error = false;
+  std::string error;
+  int64_t timestamp_ms = 0;
+  std::string content;
+};
+
+// What the conversation list shows: the metadata, how many messages there
+// are and the last one.
+struct ConversationSummary {
+  ConversationInfo info;
+  uint32_t message_count = 0;
+  bool has_last_message = false;
+  StoredMessage last_message;
+};
+
+class LogFile;
+
+// Field layouts shared by the log records and the
+// "cloudtolocalllm/conversation_store" channel (see
+// native/conversation_store_service.h):
+//
+//   ConversationInfo  string id, string title, u8 has_model, string model,
+//                     i64 created_ms, i64 updated_ms
+//   StoredMessage     string id, string role, string status, u8 has_model,
+//                     string model, u8 has_error, string error,
+//                     i64 timestamp_ms, string content
+void WriteConversationInfo(const ConversationInfo& info, WireWriter* writer);
+bool ReadConversationInfo(WireReader* reader, ConversationInfo* info);
+void WriteStoredMessage(const StoredMessage& message, WireWriter* writer);
+bool ReadStoredMessage(WireReader* reader, StoredMessage* message);
+
+// Local conversation history as an append-only log.
+//
+// Every change is one record appended to `conversations.log` in the store's
+// directory, so saving a streamed token costs one small write instead of
+// rewriting the conversation. The log is read through a memory mapping: the
+// in-memory index only holds conversation metadata and, per message, the
+// offsets of the records that make it up (a full put followed by any
+// appends), so listing conversations never reads message bodies and loading
+// one touches only its own records.
+//
+// Close() writes a compact snapshot of that index to `conversations.idx`;
+// Open() loads it and replays only the part of the log written after it, or
+// the whole log if the snapshot is missing or stale. A record torn by a
+// crash is dropped and the log truncated before it. Once more than half of
+// the log is superseded records (and at least kCompactThreshold bytes), Open()
+// rewrites it with one record per live conversation and message.
+//
+// Message text is also kept in a SearchIndex, snapshotted to
+// `conversations.search` alongside the index and rebuilt from the log when
+// that snapshot is stale. Put messages are indexed as they are written;
+// messages that grew by appends are re-indexed before the next search, so
+// a streamed reply is indexed once rather than per token.
+//
+// Writes are not synced one by one; Sync() asks a background thread to flush
+// the log to disk, and Close() flushes it before returning. Not thread-safe:
+// call everything from one thread.
+class ConversationStore {
+ public:
+  static constexpr uint64_t kCompactThreshold = 1 << 20;
+
+  ConversationStore();
+  ~ConversationStore();
+
+  // Prevent copying.
+  ConversationStore(ConversationStore const&) = delete;
+  ConversationStore& operator=(ConversationStore const&) = delete;
+
+  // Opens or creates the store in |directory| (UTF-8), which must exist.
+  // Closes any store already open first.
+  bool Open(const std::string& directory);
+  void Close();
+  bool is_open() const { return log_ != nullptr; }
+
+  // Inserts or replaces a conversation's metadata; its messages are kept.
+  bool PutConversation(const ConversationInfo& info);
+  bool DeleteConversation(const std::string& conversation_id);
+
+  // Inserts a message at the end of the conversation, or replaces the one
+  // with the same id in place. Fails if the conversation does not exist.
+  bool PutMessage(const std::string& conversation_id,
+                  const StoredMessage& message);
+  // Appends |size| bytes to an existing message's content.
+  bool AppendToMessage(const std::string& conversation_id,
+                       const std::string& message_id, const char* data,
+                       size_t size);
+  bool DeleteMessage(const std::string& conversation_id,
+                     const std::string& message_id);
+  // Deletes every conversation.
+  bool Clear();
+
+  // Every conversation, most recently updated first.
+  std::vector<ConversationSummary> ListConversations() const;
+  // The conversation's messages in order; false if it does not exist.
+  bool LoadMessages(const std::string& conversation_id,
+                    std::vector<StoredMessage>* messages) const;
+
+  // Messages matching |query| (see SearchIndex), best first.
+  std::vector<SearchHit> Search(const std::string& query, size_t limit);
+
+  // Asks the background thread to flush the log to disk; returns at once.
+  void Sync();
+
+  // Rewrites the log without superseded records.
+  bool Compact();
+
+  // Bytes in the log, and how many of them are superseded records.
+  uint64_t log_size() const;
+  uint64_t dead_bytes() const { return dead_bytes_; }
+
+ private:
+  // Where a record sits in the log, header included.
+  struct RecordRef {
+    uint64_t offset;
+    uint32_t size;
+  };
+
+  struct MessageEntry {
+    std::string id;
+    // The put record first, then one per append.
+    std::vector<RecordRef> records;
+  };
+
+  struct ConversationEntry {
+    ConversationInfo info;
+    RecordRef record;
+    std::vector<MessageEntry> messages;
+    std::unordered_map<std::string, size_t> message_index;
+  };
+
+  using ConversationMap = std::unordered_map<std::string, ConversationEntry>;
+
+  std::filesystem::path StorePath(const char* name) const;
+
+  // Opens the log at |path|, creating it with a fresh header if it is
+  // missing or shorter than one.
+  std::unique_ptr<LogFile> OpenLog(const std::filesystem::path& path,
+                                   uint64_t* generation);
+  // Loads conversations.idx into the index and returns the log offset to
+  // replay from: the end of what it covers, or the first record if it is
+  // missing or does not match the log.
+  uint64_t LoadSnapshot();
+  // Loads conversations.search if it was written with the index snapshot
+  // covering the first |covered| bytes of the log.
+  bool LoadSearchSnapshot(uint64_t covered);
+  bool WriteSnapshot();
+  // Applies the records from |offset| on, truncating a torn tail.
+  bool ReplayLog(uint64_t offset);
+
+  // Starts a record of |type| in |scratch_|; the returned writer appends
+  // its fields.
+  WireWriter BeginRecord(uint8_t type);
+  // Fills in the header of the record in |scratch_| and appends it to |log|.
+  bool FinishRecord(LogFile* log, RecordRef* ref);
+  // Appends the record in |scratch_| to the log and applies it to the index.
+  bool Write();
+  // Updates the index for the record at |ref|; false if it is malformed.
+  bool Apply(const uint8_t* payload, size_t size, RecordRef ref);
+  bool ReadMessage(const MessageEntry& entry, StoredMessage* message) const;
+  void ForgetMessages(const std::string& conversation_id,
+                      ConversationEntry* entry);
+  void ForgetMessage(const std::string& conversation_id,
+                     ConversationEntry* entry, size_t index);
+  // Indexes the messages in |unindexed_|.
+  void RefreshSearchIndex();
+  // Indexes every message from scratch.
+  void RebuildSearchIndex();
+
+  void StartSyncThread();
+  void StopSyncThread();
+  void SyncLoop();
+
+  std::string directory_;
+  std::unique_ptr<LogFile> log_;
+  uint64_t generation_;
+  uint64_t dead_bytes_;
+  ConversationMap conversations_;
+  SearchIndex search_index_;
+  // Off while replaying a log whose search snapshot did not load; the index
+  // is rebuilt afterwards instead.
+  bool indexing_;
+  // (conversation id, message id) of messages appended to since they were
+  // indexed.
+  std::set<std::pair<std::string, std::string>> unindexed_;
+  // Record under construction, header included.
+  std::vector<uint8_t> scratch_;
+
+  // Held by the sync thread while it flushes |log_|, and by Compact() and
+  // Close() while they replace it.
+  std::mutex file_mutex_;
+  std::mutex sync_mutex_;
+  std::condition_variable sync_cv_;
+  bool sync_requested_;
+  bool stopping_;
+  std::thread sync_thread_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_CONVERSATION_STORE_H_
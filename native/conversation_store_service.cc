@@ -0,0 +1,120 @@
+#include "native/conversation_store_service.h"
+
+#include <cstring>
+#include <string>
+
+namespace cloudtolocalllm {
+
+ConversationStoreService::ConversationStoreService() = default;
+
+ConversationStoreService::~ConversationStoreService() = default;
+
+void ConversationStoreService::HandleMessage(const uint8_t* message,
+                                             size_t size,
+                                             std::vector<uint8_t>* reply) {
+  reply->clear();
+
+  WireReader reader(message, size);
+  uint8_t op;
+  if (!reader.ReadU8(&op) || (op != kOpen && !store_.is_open())) {
+    return;
+  }
+  if (!Handle(op, &reader, reply)) {
+    reply->clear();
+  } else if (reply->empty()) {
+    reply->push_back(1);
+  }
+}
+
+bool ConversationStoreService::Handle(uint8_t op, WireReader* reader,
+                                      std::vector<uint8_t>* reply) {
+  WireWriter writer(reply);
+  std::string conversation_id;
+  std::string message_id;
+  switch (op) {
+    case kOpen: {
+      std::string directory;
+      return reader->ReadString(&directory) && store_.Open(directory);
+    }
+    case kList: {
+      const std::vector<ConversationSummary> summaries =
+          store_.ListConversations();
+      writer.WriteU32(static_cast<uint32_t>(summaries.size()));
+      for (const ConversationSummary& summary : summaries) {
+        WriteConversationInfo(summary.info, &writer);
+        writer.WriteU32(summary.message_count);
+        writer.WriteU8(summary.has_last_message ? 1 : 0);
+        if (summary.has_last_message) {
+          WriteStoredMessage(summary.last_message, &writer);
+        }
+      }
+      return true;
+    }
+    case kLoadMessages:
+      if (!reader->ReadString(&conversation_id)) {
+        return false;
+      }
+      store_.LoadMessages(conversation_id, &messages_);
+      writer.WriteU32(static_cast<uint32_t>(messages_.size()));
+      for (const StoredMessage& message : messages_) {
+        WriteStoredMessage(message, &writer);
+      }
+      messages_.clear();
+      return true;
+    case kPutConversation: {
+      ConversationInfo info;
+      return ReadConversationInfo(reader, &info) &&
+             store_.PutConversation(info);
+    }
+    case kDeleteConversation:
+      return reader->ReadString(&conversation_id) &&
+             store_.DeleteConversation(conversation_id);
+    case kPutMessage: {
+      StoredMessage message;
+      return reader->ReadString(&conversation_id) &&
+             ReadStoredMessage(reader, &message) &&
+             store_.PutMessage(conversation_id, message);
+    }
+    case kAppendToMessage:
+      return reader->ReadString(&conversation_id) &&
+             reader->ReadString(&message_id) &&
+             store_.AppendToMessage(
+                 conversation_id, message_id,
+                 reinterpret_cast<const char*>(reader->current()),
+                 reader->remaining());
+    case kDeleteMessage:
+      return reader->ReadString(&conversation_id) &&
+             reader->ReadString(&message_id) &&
+             store_.DeleteMessage(conversation_id, message_id);
+    case kClear:
+      return store_.Clear();
+    case kSync:
+      store_.Sync();
+      return true;
+    case kClose:
+      store_.Close();
+      return true;
+    case kSearch: {
+      std::string query;
+      uint32_t limit;
+      if (!reader->ReadString(&query) || !reader->ReadU32(&limit)) {
+        return false;
+      }
+      const std::vector<SearchHit> hits = store_.Search(query, limit);
+      writer.WriteU32(static_cast<uint32_t>(hits.size()));
+      for (const SearchHit& hit : hits) {
+        writer.WriteString(hit.conversation_id);
+        writer.WriteString(hit.message_id);
+        uint64_t score_bits;
+        static_assert(sizeof(score_bits) == sizeof(hit.score), "");
+        std::memcpy(&score_bits, &hit.score, sizeof(score_bits));
+        writer.WriteU64(score_bits);
+      }
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,75 @@
+#ifndef NATIVE_CONVERSATION_STORE_SERVICE_H_
+#define NATIVE_CONVERSATION_STORE_SERVICE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "native/conversation_store.h"
+
+namespace cloudtolocalllm {
+
+// Platform-neutral handler behind the "cloudtolocalllm/conversation_store"
+// binary channel, which keeps chat history in a ConversationStore. The
+// ConversationInfo and StoredMessage layouts are in
+// native/conversation_store.h.
+//
+// Requests are `u8 op` followed by an op-specific payload:
+//
+//   kOpen               (1)  string directory
+//   kList               (2)  nothing; replies with u32 count, then for each
+//                            conversation, most recently updated first:
+//                            ConversationInfo, u32 message count,
+//                            u8 has_last_message and the last StoredMessage
+//   kLoadMessages       (3)  string conversation id; replies with u32 count
+//                            and the StoredMessages (none if unknown)
+//   kPutConversation    (4)  ConversationInfo
+//   kDeleteConversation (5)  string conversation id
+//   kPutMessage         (6)  string conversation id, StoredMessage
+//   kAppendToMessage    (7)  string conversation id, string message id, then
+//                            the UTF-8 text to append (the rest of the
+//                            request)
+//   kDeleteMessage      (8)  string conversation id, string message id
+//   kClear              (9)  nothing
+//   kSync               (10) nothing; the flush happens in the background
+//   kClose              (11) nothing
+//   kSearch             (12) string query, u32 limit; replies with u32 count,
+//                            then for each hit, best first: string
+//                            conversation id, string message id and the
+//                            score as a little-endian IEEE 754 double
+//
+// Ops without a listed reply answer with one byte. Malformed requests,
+// failed writes and anything but kOpen before the store is open get an empty
+// reply, which the Dart side treats as "native store unavailable".
+class ConversationStoreService {
+ public:
+  static constexpr uint8_t kOpen = 1;
+  static constexpr uint8_t kList = 2;
+  static constexpr uint8_t kLoadMessages = 3;
+  static constexpr uint8_t kPutConversation = 4;
+  static constexpr uint8_t kDeleteConversation = 5;
+  static constexpr uint8_t kPutMessage = 6;
+  static constexpr uint8_t kAppendToMessage = 7;
+  static constexpr uint8_t kDeleteMessage = 8;
+  static constexpr uint8_t kClear = 9;
+  static constexpr uint8_t kSync = 10;
+  static constexpr uint8_t kClose = 11;
+  static constexpr uint8_t kSearch = 12;
+
+  ConversationStoreService();
+  ~ConversationStoreService();
+
+  void HandleMessage(const uint8_t* message, size_t size,
+                     std::vector<uint8_t>* reply);
+
+ private:
+  // Runs the op; false means reply with nothing.
+  bool Handle(uint8_t op, WireReader* reader, std::vector<uint8_t>* reply);
+
+  ConversationStore store_;
+  std::vector<StoredMessage> messages_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_CONVERSATION_STORE_SERVICE_H_
@@ -0,0 +1,526 @@
+#include "native/embedding_batcher.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+
+#include "native/json_scan.h"
+#include "native/mapped_file.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+// How much of an error response is quoted back.
+constexpr size_t kMaxQuotedError = 256;
+
+void AppendJsonString(const uint8_t* data, size_t size, std::string* out) {
+  static const char kHex[] = "0123456789abcdef";
+  out->push_back('"');
+  const uint8_t* run = data;
+  for (const uint8_t* p = data; p != data + size; ++p) {
+    const uint8_t byte = *p;
+    if (byte >= 0x20 && byte != '"' && byte != '\\') {
+      continue;
+    }
+    out->append(reinterpret_cast<const char*>(run), p - run);
+    run = p + 1;
+    switch (byte) {
+      case '"':
+        out->append("\\\"");
+        break;
+      case '\\':
+        out->append("\\\\");
+        break;
+      case '\n':
+        out->append("\\n");
+        break;
+      case '\r':
+        out->append("\\r");
+        break;
+      case '\t':
+        out->append("\\t");
+        break;
+      default:
+        out->append("\\u00");
+        out->push_back(kHex[byte >> 4]);
+        out->push_back(kHex[byte & 0xf]);
+        break;
+    }
+  }
+  out->append(reinterpret_cast<const char*>(run), data + size - run);
+  out->push_back('"');
+}
+
+bool IsContinuationByte(uint8_t byte) {
+  return (byte & 0xC0) == 0x80;
+}
+
+bool IsBlank(const uint8_t* data, size_t size) {
+  return std::all_of(data, data + size, [](uint8_t byte) {
+    return byte == ' ' || byte == '\t' || byte == '\n' || byte == '\r';
+  });
+}
+
+// Where to end a chunk that starts at |start| and may run to |limit|
+// (exclusive): just after the last paragraph break, else line break, else
+// space in its second half, or at |limit| if there is none.
+size_t ChunkEnd(const uint8_t* data, size_t start, size_t limit) {
+  const size_t floor = start + (limit - start) / 2;
+  size_t line = 0;
+  size_t word = 0;
+  for (size_t i = limit; i > floor; i--) {
+    const uint8_t byte = data[i - 1];
+    if (byte == '\n') {
+      if (i - 1 > floor && data[i - 2] == '\n') {
+        return i;
+      }
+      if (line == 0) {
+        line = i;
+      }
+    } else if (byte == ' ' && word == 0) {
+      word = i;
+    }
+  }
+  if (line != 0) {
+    return line;
+  }
+  return word != 0 ? word : limit;
+}
+
+}  // namespace
+
+EmbeddingBatcher::EmbeddingBatcher(Delegate* delegate)
+    : EmbeddingBatcher(delegate, Options()) {}
+
+EmbeddingBatcher::EmbeddingBatcher(Delegate* delegate, const Options& options)
+    : delegate_(delegate),
+      options_(options),
+      client_(this),
+      running_(false),
+      next_request_id_(1),
+      jobs_completed_(0),
+      chunks_embedded_(0),
+      requests_sent_(0) {
+  options_.max_in_flight = std::max<size_t>(options_.max_in_flight, 1);
+}
+
+EmbeddingBatcher::~EmbeddingBatcher() {
+  Stop();
+}
+
+bool EmbeddingBatcher::Start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running_) {
+    return true;
+  }
+  if (!client_.Start()) {
+    return false;
+  }
+  running_ = true;
+  worker_ = std::thread(&EmbeddingBatcher::Run, this);
+  return true;
+}
+
+void EmbeddingBatcher::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+  }
+  changed_.notify_all();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+  client_.Stop();
+  std::lock_guard<std::mutex> lock(mutex_);
+  queue_.clear();
+  jobs_.clear();
+  batches_.clear();
+}
+
+void EmbeddingBatcher::Submit(Job job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint64_t id = job.id;
+    JobState& state = jobs_[id];
+    state = JobState();
+    state.job = std::move(job);
+    state.result.arena.resize(options_.arena_prefix);
+    queue_.push_back(id);
+  }
+  changed_.notify_all();
+}
+
+bool EmbeddingBatcher::Cancel(uint64_t id) {
+  std::vector<uint64_t> requests;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (jobs_.erase(id) == 0) {
+      return false;
+    }
+    queue_.erase(std::remove(queue_.begin(), queue_.end(), id), queue_.end());
+    for (auto it = batches_.begin(); it != batches_.end();) {
+      if (it->second.job_id == id) {
+        requests.push_back(it->first);
+        it = batches_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  changed_.notify_all();
+  for (uint64_t request : requests) {
+    client_.Cancel(request);
+  }
+  return true;
+}
+
+EmbeddingBatcher::Stats EmbeddingBatcher::stats() const {
+  Stats stats;
+  stats.jobs_completed = jobs_completed_.load();
+  stats.chunks_embedded = chunks_embedded_.load();
+  stats.requests_sent = requests_sent_.load();
+  return stats;
+}
+
+void EmbeddingBatcher::Run() {
+  while (true) {
+    uint64_t job_id = 0;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      changed_.wait(lock, [this] { return !running_ || !queue_.empty(); });
+      if (!running_) {
+        return;
+      }
+      job_id = queue_.front();
+      queue_.pop_front();
+    }
+    ChunkJob(job_id);
+  }
+}
+
+void EmbeddingBatcher::ChunkJob(uint64_t job_id) {
+  Job job;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(job_id);
+    if (it == jobs_.end()) {
+      return;
+    }
+    job = it->second.job;
+  }
+  const size_t chunk_size =
+      std::max<size_t>(job.chunk_size != 0 ? job.chunk_size
+                                           : kDefaultChunkSize,
+                       16);
+  const size_t overlap = std::min(
+      job.chunk_overlap != 0 ? job.chunk_overlap : kDefaultChunkOverlap,
+      chunk_size / 2);
+  const size_t batch_size =
+      job.batch_size != 0 ? job.batch_size : kDefaultBatchSize;
+
+  std::string prologue = "{\"model\":";
+  AppendJsonString(reinterpret_cast<const uint8_t*>(job.model.data()),
+                   job.model.size(), &prologue);
+  prologue += ",\"truncate\":true,\"input\":[";
+
+  std::string body = prologue;
+  std::vector<Chunk> chunks;
+  uint32_t first_chunk = 0;
+  auto flush = [&]() {
+    HttpRequest request;
+    request.method = "POST";
+    request.host = job.host;
+    request.port = job.port;
+    request.path = "/api/embed";
+    request.headers.emplace_back("Content-Type", "application/json");
+    request.body = std::move(body);
+    request.body += "]}";
+    const uint32_t count = static_cast<uint32_t>(chunks.size());
+    const bool submitted =
+        SubmitBatch(job_id, first_chunk, &chunks, std::move(request));
+    first_chunk += count;
+    chunks.clear();
+    body = prologue;
+    return submitted;
+  };
+
+  for (size_t index = 0; index < job.paths.size(); index++) {
+    MappedFile file;
+    if (!file.Open(std::filesystem::u8path(job.paths[index]))) {
+      continue;
+    }
+    const uint8_t* data = file.data();
+    const size_t size = file.size();
+    size_t start = 0;
+    while (start < size) {
+      size_t end = size;
+      if (size - start > chunk_size) {
+        end = ChunkEnd(data, start, start + chunk_size);
+        while (end > start + 1 && IsContinuationByte(data[end])) {
+          end--;
+        }
+      }
+      if (!IsBlank(data + start, end - start)) {
+        if (!chunks.empty()) {
+          body.push_back(',');
+        }
+        AppendJsonString(data + start, end - start, &body);
+        chunks.push_back({static_cast<uint32_t>(index), start,
+                          static_cast<uint32_t>(end - start)});
+        if (chunks.size() == batch_size && !flush()) {
+          return;
+        }
+      }
+      if (end == size) {
+        break;
+      }
+      // Step back for the overlap, then forward to a character boundary.
+      size_t next = std::max(end - std::min(overlap, end - start), start + 1);
+      while (next < end && IsContinuationByte(data[next])) {
+        next++;
+      }
+      start = next;
+    }
+  }
+  if (!chunks.empty() && !flush()) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = jobs_.find(job_id);
+  if (it != jobs_.end()) {
+    it->second.chunked = true;
+    MaybeComplete(job_id, &lock);
+  }
+}
+
+bool EmbeddingBatcher::SubmitBatch(uint64_t job_id, uint32_t first_chunk,
+                                   std::vector<Chunk>* chunks,
+                                   HttpRequest request) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [&] {
+    return !running_ || batches_.size() < options_.max_in_flight ||
+           jobs_.count(job_id) == 0;
+  });
+  auto it = jobs_.find(job_id);
+  if (!running_ || it == jobs_.end()) {
+    return false;
+  }
+  JobState& state = it->second;
+  state.result.chunks.insert(state.result.chunks.end(), chunks->begin(),
+                             chunks->end());
+  state.batches_sent++;
+  request.id = next_request_id_++;
+  Batch& batch = batches_[request.id];
+  batch.job_id = job_id;
+  batch.first_chunk = first_chunk;
+  batch.chunk_count = static_cast<uint32_t>(chunks->size());
+  lock.unlock();
+
+  requests_sent_++;
+  client_.Submit(std::move(request));
+  return true;
+}
+
+void EmbeddingBatcher::OnResponseStarted(uint64_t id, int status_code,
+                                         HttpHeaderView /*headers*/) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = batches_.find(id);
+  if (it != batches_.end()) {
+    it->second.status_code = status_code;
+  }
+}
+
+void EmbeddingBatcher::OnBodyData(uint64_t id, const uint8_t* data,
+                                  size_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = batches_.find(id);
+  if (it != batches_.end()) {
+    it->second.body.append(reinterpret_cast<const char*>(data), size);
+  }
+}
+
+void EmbeddingBatcher::OnTokenBatch(uint64_t /*id*/,
+                                    const TokenBatch& /*batch*/) {}
+
+void EmbeddingBatcher::OnComplete(uint64_t id) {
+  FinishBatch(id, nullptr);
+}
+
+void EmbeddingBatcher::OnError(uint64_t id, const std::string& message) {
+  FinishBatch(id, &message);
+}
+
+void EmbeddingBatcher::FinishBatch(uint64_t request_id,
+                                   const std::string* error) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto batch_it = batches_.find(request_id);
+  if (batch_it == batches_.end()) {
+    return;
+  }
+  Batch batch = std::move(batch_it->second);
+  batches_.erase(batch_it);
+  changed_.notify_all();
+  auto it = jobs_.find(batch.job_id);
+  if (it == jobs_.end()) {
+    return;
+  }
+  JobState& state = it->second;
+
+  std::string message;
+  if (error != nullptr) {
+    message = *error;
+  } else if (batch.status_code != 200) {
+    message = "/api/embed answered " + std::to_string(batch.status_code);
+    if (!batch.body.empty()) {
+      message += ": " + batch.body.substr(0, kMaxQuotedError);
+    }
+  } else {
+    StoreVectors(batch, &state, &message);
+  }
+  if (!message.empty()) {
+    FailJob(batch.job_id, message, &lock);
+    return;
+  }
+
+  state.batches_done++;
+  state.chunks_embedded += batch.chunk_count;
+  chunks_embedded_ += batch.chunk_count;
+  const uint32_t embedded = state.chunks_embedded;
+  const uint32_t chunked = static_cast<uint32_t>(state.result.chunks.size());
+  lock.unlock();
+  delegate_->OnEmbedProgress(batch.job_id, embedded, chunked);
+  lock.lock();
+  MaybeComplete(batch.job_id, &lock);
+}
+
+bool EmbeddingBatcher::StoreVectors(const Batch& batch, JobState* state,
+                                    std::string* error) {
+  Result& result = state->result;
+  const size_t prefix = options_.arena_prefix;
+  auto reserve_rows = [&] {
+    const size_t size =
+        prefix + (static_cast<size_t>(batch.first_chunk) + batch.chunk_count) *
+                     result.dimensions * sizeof(float);
+    if (result.arena.size() < size) {
+      result.arena.resize(size);
+    }
+  };
+  auto row_at = [&](uint32_t row) {
+    return result.arena.data() + prefix +
+           (static_cast<size_t>(batch.first_chunk) + row) *
+               result.dimensions * sizeof(float);
+  };
+  if (result.dimensions != 0) {
+    reserve_rows();
+  }
+
+  // Rows are written straight into the arena once the width is known; the
+  // job's very first row, which sets it, goes through |first_row|.
+  std::vector<float> first_row;
+  uint32_t rows = 0;
+  bool found = false;
+  const uint8_t* begin = reinterpret_cast<const uint8_t*>(batch.body.data());
+  const uint8_t* end = begin + batch.body.size();
+  auto parse_row = [&](const uint8_t* p) -> const uint8_t* {
+    if (rows == batch.chunk_count) {
+      return nullptr;
+    }
+    uint8_t* out = result.dimensions != 0 ? row_at(rows) : nullptr;
+    size_t column = 0;
+    p = json::ScanArray(p, end, [&](const uint8_t* number) -> const uint8_t* {
+      double value = 0;
+      const uint8_t* next = json::ParseDouble(number, end, &value);
+      if (next == nullptr) {
+        return nullptr;
+      }
+      const float element = static_cast<float>(value);
+      if (out == nullptr) {
+        first_row.push_back(element);
+      } else if (column < result.dimensions) {
+        std::memcpy(out + column * sizeof(float), &element, sizeof(float));
+      } else {
+        return nullptr;
+      }
+      column++;
+      return next;
+    });
+    if (p == nullptr) {
+      return nullptr;
+    }
+    if (out == nullptr) {
+      if (first_row.empty()) {
+        return nullptr;
+      }
+      result.dimensions = static_cast<uint32_t>(first_row.size());
+      reserve_rows();
+      std::memcpy(row_at(rows), first_row.data(),
+                  first_row.size() * sizeof(float));
+    } else if (column != result.dimensions) {
+      return nullptr;
+    }
+    rows++;
+    return p;
+  };
+  const uint8_t* p = json::ScanObject(
+      begin, end,
+      [&](const uint8_t* key, size_t length,
+          const uint8_t* value) -> const uint8_t* {
+        if (!json::KeyEquals(key, length, "embeddings")) {
+          return json::SkipValue(value, end);
+        }
+        found = true;
+        return json::ScanArray(value, end, parse_row);
+      });
+  if (p == nullptr || !found || rows != batch.chunk_count) {
+    *error = "Malformed /api/embed response";
+    return false;
+  }
+  return true;
+}
+
+void EmbeddingBatcher::FailJob(uint64_t job_id, const std::string& message,
+                               std::unique_lock<std::mutex>* lock) {
+  jobs_.erase(job_id);
+  std::vector<uint64_t> requests;
+  for (auto it = batches_.begin(); it != batches_.end();) {
+    if (it->second.job_id == job_id) {
+      requests.push_back(it->first);
+      it = batches_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  changed_.notify_all();
+  lock->unlock();
+  for (uint64_t request : requests) {
+    client_.Cancel(request);
+  }
+  delegate_->OnEmbedError(job_id, message);
+  lock->lock();
+}
+
+void EmbeddingBatcher::MaybeComplete(uint64_t job_id,
+                                     std::unique_lock<std::mutex>* lock) {
+  auto it = jobs_.find(job_id);
+  if (it == jobs_.end() || !it->second.chunked ||
+      it->second.batches_done != it->second.batches_sent) {
+    return;
+  }
+  Result result = std::move(it->second.result);
+  result.arena.resize(options_.arena_prefix + result.chunks.size() *
+                                                  result.dimensions *
+                                                  sizeof(float));
+  jobs_.erase(it);
+  jobs_completed_++;
+  lock->unlock();
+  delegate_->OnEmbedComplete(job_id, std::move(result));
+  lock->lock();
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,189 @@
+#ifndef NATIVE_EMBEDDING_BATCHER_H_
+#define NATIVE_EMBEDDING_BATCHER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "native/http_response_parser.h"
+#include "native/http_stream_client.h"
+
+namespace cloudtolocalllm {
+
+// Embeds local documents through Ollama's /api/embed for retrieval, without
+// a request per chunk from Dart.
+//
+// A job names a model and a list of files. On the batcher's own thread each
+// file is mapped (MappedFile) and cut into overlapping chunks of about
+// chunk_size bytes, ending on a paragraph, line or word break where one is
+// near and never inside a UTF-8 sequence. Chunks are packed straight from
+// the mapping into /api/embed requests of batch_size inputs, and at most
+// Options::max_in_flight requests are outstanding at a time: enough that
+// Ollama always has the next batch queued, few enough that memory stays
+// flat however many files there are.
+//
+// Responses are parsed on the HTTP worker directly into one contiguous
+// float32 arena, chunk after chunk in order, behind a caller-reserved
+// prefix so the result can be sent on as a single buffer.
+//
+// Thread-safe. Delegate methods run on internal threads and must hand off
+// rather than block.
+class EmbeddingBatcher : public HttpStreamClient::Delegate {
+ public:
+  struct Options {
+    // Embed requests outstanding across all jobs.
+    size_t max_in_flight = 2;
+    // Bytes left free at the front of every Result::arena.
+    size_t arena_prefix = 0;
+  };
+
+  struct Job {
+    uint64_t id = 0;
+    std::string host = "localhost";
+    uint16_t port = 11434;
+    std::string model;
+    // UTF-8 paths. Files that cannot be read or are empty get no chunks.
+    std::vector<std::string> paths;
+    // Zero picks the default.
+    size_t chunk_size = 0;
+    size_t chunk_overlap = 0;
+    size_t batch_size = 0;
+  };
+
+  static constexpr size_t kDefaultChunkSize = 1536;
+  static constexpr size_t kDefaultChunkOverlap = 192;
+  static constexpr size_t kDefaultBatchSize = 32;
+
+  // Where a chunk's text is: |length| bytes at |offset| in paths[file].
+  struct Chunk {
+    uint32_t file = 0;
+    uint64_t offset = 0;
+    uint32_t length = 0;
+  };
+
+  struct Result {
+    uint32_t dimensions = 0;
+    std::vector<Chunk> chunks;
+    // Options::arena_prefix bytes, then chunks.size() * dimensions floats,
+    // row i being the embedding of chunks[i].
+    std::vector<uint8_t> arena;
+  };
+
+  class Delegate {
+   public:
+    virtual ~Delegate() = default;
+    // |embedded| of the |chunked| chunks found so far have their vectors.
+    virtual void OnEmbedProgress(uint64_t job_id, uint32_t embedded,
+                                 uint32_t chunked) = 0;
+    virtual void OnEmbedComplete(uint64_t job_id, Result result) = 0;
+    virtual void OnEmbedError(uint64_t job_id, const std::string& message) = 0;
+  };
+
+  struct Stats {
+    uint64_t jobs_completed = 0;
+    uint64_t chunks_embedded = 0;
+    uint64_t requests_sent = 0;
+  };
+
+  // |delegate| must outlive the batcher.
+  explicit EmbeddingBatcher(Delegate* delegate);
+  EmbeddingBatcher(Delegate* delegate, const Options& options);
+  ~EmbeddingBatcher() override;
+
+  // Prevent copying.
+  EmbeddingBatcher(EmbeddingBatcher const&) = delete;
+  EmbeddingBatcher& operator=(EmbeddingBatcher const&) = delete;
+
+  // Starts the chunking thread and the HTTP worker. Returns false if either
+  // could not be started.
+  bool Start();
+
+  // Stops both threads; jobs not yet finished are dropped without a
+  // callback. Called automatically on destruction.
+  void Stop();
+
+  // Queues |job|; jobs are chunked one after another.
+  void Submit(Job job);
+
+  // Abandons job |id|. No further callbacks are made for it. Returns false
+  // if there is no such job.
+  bool Cancel(uint64_t id);
+
+  Stats stats() const;
+
+  // HttpStreamClient::Delegate:
+  void OnResponseStarted(uint64_t id, int status_code,
+                         HttpHeaderView headers) override;
+  void OnBodyData(uint64_t id, const uint8_t* data, size_t size) override;
+  void OnTokenBatch(uint64_t id, const TokenBatch& batch) override;
+  void OnComplete(uint64_t id) override;
+  void OnError(uint64_t id, const std::string& message) override;
+
+ private:
+  struct JobState {
+    Job job;
+    Result result;
+    uint32_t batches_sent = 0;
+    uint32_t batches_done = 0;
+    uint32_t chunks_embedded = 0;
+    bool chunked = false;
+  };
+
+  // One /api/embed request in flight.
+  struct Batch {
+    uint64_t job_id = 0;
+    uint32_t first_chunk = 0;
+    uint32_t chunk_count = 0;
+    int status_code = 0;
+    std::string body;
+  };
+
+  void Run();
+  // Cuts |job|'s files into chunks and submits them in batches. Returns
+  // once all are submitted or the job is gone.
+  void ChunkJob(uint64_t job_id);
+  // Waits for room in the window, records |chunks| and submits |request|;
+  // false if the job was cancelled or failed meanwhile.
+  bool SubmitBatch(uint64_t job_id, uint32_t first_chunk,
+                   std::vector<Chunk>* chunks, HttpRequest request);
+  // Request |request_id| has ended: its vectors go into the arena, or its
+  // job fails with |error| (null on success).
+  void FinishBatch(uint64_t request_id, const std::string* error);
+  // Stores a response's vectors; false with |*error| set if malformed.
+  bool StoreVectors(const Batch& batch, JobState* state, std::string* error);
+  // Drops |job_id| and reports |message|; |lock| is released around the
+  // callback.
+  void FailJob(uint64_t job_id, const std::string& message,
+               std::unique_lock<std::mutex>* lock);
+  // Hands the finished job's result over if nothing is outstanding.
+  void MaybeComplete(uint64_t job_id, std::unique_lock<std::mutex>* lock);
+
+  Delegate* delegate_;
+  Options options_;
+  HttpStreamClient client_;
+
+  std::thread worker_;
+  std::atomic<bool> running_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  std::deque<uint64_t> queue_;
+  std::unordered_map<uint64_t, JobState> jobs_;
+  std::unordered_map<uint64_t, Batch> batches_;
+  uint64_t next_request_id_;
+
+  std::atomic<uint64_t> jobs_completed_;
+  std::atomic<uint64_t> chunks_embedded_;
+  std::atomic<uint64_t> requests_sent_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_EMBEDDING_BATCHER_H_
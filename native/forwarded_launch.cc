@@ -0,0 +1,45 @@
+#include "native/forwarded_launch.h"
+
+#include "native/wire_format.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+// Bounds the count read from another process before reserving for it.
+constexpr uint32_t kMaxArguments = 4096;
+
+}  // namespace
+
+std::vector<uint8_t> EncodeForwardedLaunch(const ForwardedLaunch& launch) {
+  std::vector<uint8_t> out;
+  WireWriter writer(&out);
+  writer.WriteString(launch.working_directory);
+  writer.WriteU32(static_cast<uint32_t>(launch.arguments.size()));
+  for (const std::string& argument : launch.arguments) {
+    writer.WriteString(argument);
+  }
+  return out;
+}
+
+bool DecodeForwardedLaunch(const uint8_t* data, size_t size,
+                           ForwardedLaunch* launch) {
+  WireReader reader(data, size);
+  uint32_t count = 0;
+  if (!reader.ReadString(&launch->working_directory) ||
+      !reader.ReadU32(&count) || count > kMaxArguments) {
+    return false;
+  }
+  launch->arguments.clear();
+  launch->arguments.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    std::string argument;
+    if (!reader.ReadString(&argument)) {
+      return false;
+    }
+    launch->arguments.push_back(std::move(argument));
+  }
+  return reader.remaining() == 0;
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,33 @@
+#ifndef NATIVE_FORWARDED_LAUNCH_H_
+#define NATIVE_FORWARDED_LAUNCH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cloudtolocalllm {
+
+// A launch of a second instance, handed to the one already running so it can
+// show its window and act on the arguments instead of the new process
+// starting another engine. The runners deliver it to Dart on the
+// "cloudtolocalllm/single_instance" binary channel; the Windows runner also
+// uses it as the WM_COPYDATA payload between the two processes.
+//
+// Encoded as `string working_directory, u32 count, count x string argument`
+// with the usual little-endian wire format (native/wire_format.h).
+struct ForwardedLaunch {
+  std::string working_directory;
+  // Excludes the executable name.
+  std::vector<std::string> arguments;
+};
+
+std::vector<uint8_t> EncodeForwardedLaunch(const ForwardedLaunch& launch);
+
+// Returns false if |data| is not a complete encoded launch.
+bool DecodeForwardedLaunch(const uint8_t* data, size_t size,
+                           ForwardedLaunch* launch);
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_FORWARDED_LAUNCH_H_
@@ -0,0 +1,61 @@
+#include "native/frame_buffer_pool.h"
+
+#include <utility>
+
+namespace cloudtolocalllm {
+
+FrameBufferPool::FrameBufferPool(size_t buffer_capacity, size_t max_pooled)
+    : buffer_capacity_(buffer_capacity),
+      max_pooled_(max_pooled),
+      allocated_(0),
+      reused_(0) {
+  free_.reserve(max_pooled_);
+}
+
+FrameBufferPool::~FrameBufferPool() = default;
+
+std::vector<uint8_t> FrameBufferPool::Acquire(bool* allocated) {
+  if (allocated != nullptr) {
+    *allocated = false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!free_.empty()) {
+      std::vector<uint8_t> buffer = std::move(free_.back());
+      free_.pop_back();
+      ++reused_;
+      return buffer;
+    }
+  }
+  std::vector<uint8_t> buffer;
+  buffer.reserve(buffer_capacity_);
+  ++allocated_;
+  if (allocated != nullptr) {
+    *allocated = true;
+  }
+  return buffer;
+}
+
+void FrameBufferPool::Release(std::vector<uint8_t> buffer) {
+  // Oversized buffers (one huge header block, say) are not worth keeping.
+  if (buffer.capacity() < buffer_capacity_ ||
+      buffer.capacity() > 2 * buffer_capacity_) {
+    return;
+  }
+  buffer.clear();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (free_.size() < max_pooled_) {
+    free_.push_back(std::move(buffer));
+  }
+}
+
+FrameBufferPool::Stats FrameBufferPool::stats() const {
+  Stats stats;
+  stats.allocated = allocated_;
+  stats.reused = reused_;
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats.pooled = free_.size();
+  return stats;
+}
+
+}  // namespace cloudtolocalllm
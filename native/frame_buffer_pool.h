@@ -0,0 +1,59 @@
+#ifndef NATIVE_FRAME_BUFFER_POOL_H_
+#define NATIVE_FRAME_BUFFER_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace cloudtolocalllm {
+
+// Recycles byte buffers of a fixed capacity between the thread that fills
+// them (the HTTP worker) and the thread that sends them (the platform
+// thread), so a long stream reuses a handful of allocations instead of
+// making one per frame. Thread-safe.
+//
+// Buffers are plain vectors moved in and out of the pool. One that comes
+// back much larger than |buffer_capacity| is freed rather than kept, so the
+// pool's footprint stays bounded by about max_pooled * buffer_capacity.
+class FrameBufferPool {
+ public:
+  struct Stats {
+    uint64_t allocated = 0;
+    uint64_t reused = 0;
+    size_t pooled = 0;
+  };
+
+  FrameBufferPool(size_t buffer_capacity, size_t max_pooled);
+  ~FrameBufferPool();
+
+  // Prevent copying.
+  FrameBufferPool(FrameBufferPool const&) = delete;
+  FrameBufferPool& operator=(FrameBufferPool const&) = delete;
+
+  // Returns an empty buffer with at least buffer_capacity() reserved.
+  // |allocated|, if given, is set when the pool was empty and the buffer is
+  // new.
+  std::vector<uint8_t> Acquire(bool* allocated = nullptr);
+
+  // Returns |buffer| to the pool, or frees it if the pool is full.
+  void Release(std::vector<uint8_t> buffer);
+
+  size_t buffer_capacity() const { return buffer_capacity_; }
+  Stats stats() const;
+
+ private:
+  const size_t buffer_capacity_;
+  const size_t max_pooled_;
+
+  mutable std::mutex mutex_;
+  std::vector<std::vector<uint8_t>> free_;
+
+  std::atomic<uint64_t> allocated_;
+  std::atomic<uint64_t> reused_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_FRAME_BUFFER_POOL_H_
@@ -0,0 +1,327 @@
+#include "native/http_response_parser.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "native/byte_scan.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+// Upper bound on a single status, header or chunk-size line.
+constexpr size_t kMaxLineLength = 16 * 1024;
+
+// Upper bound on the number of headers in one response.
+constexpr size_t kMaxHeaders = 128;
+
+bool EqualsIgnoreCase(const std::string& a, const char* b) {
+  size_t i = 0;
+  for (; i < a.size() && b[i] != '\0'; i++) {
+    if (std::tolower(static_cast<unsigned char>(a[i])) !=
+        std::tolower(static_cast<unsigned char>(b[i]))) {
+      return false;
+    }
+  }
+  return i == a.size() && b[i] == '\0';
+}
+
+char ToLower(char c) {
+  return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+bool ContainsTokenIgnoreCase(const std::string& value, const char* token) {
+  const size_t length = std::strlen(token);
+  for (size_t i = 0; i + length <= value.size(); i++) {
+    size_t j = 0;
+    while (j < length && ToLower(value[i + j]) == token[j]) {
+      j++;
+    }
+    if (j == length) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Narrows [*begin, *end) of |line| past surrounding spaces and tabs.
+void Trim(const std::string& line, size_t* begin, size_t* end) {
+  while (*begin < *end && (line[*begin] == ' ' || line[*begin] == '\t')) {
+    ++*begin;
+  }
+  while (*end > *begin && (line[*end - 1] == ' ' || line[*end - 1] == '\t')) {
+    --*end;
+  }
+}
+
+}  // namespace
+
+HttpResponseParser::HttpResponseParser() {
+  Reset();
+}
+
+void HttpResponseParser::Reset(bool head_request) {
+  state_ = State::kStatusLine;
+  head_request_ = head_request;
+  headers_complete_ = false;
+  status_code_ = 0;
+  // The header strings are overwritten in place by the next response.
+  header_count_ = 0;
+  line_.clear();
+  remaining_ = 0;
+  chunked_ = false;
+  read_until_close_ = false;
+  keep_alive_ = true;
+  error_.clear();
+}
+
+size_t HttpResponseParser::Parse(const uint8_t* data, size_t size,
+                                 BodySink* sink) {
+  const uint8_t* p = data;
+  const uint8_t* end = data + size;
+
+  while (p < end && state_ != State::kComplete && state_ != State::kError) {
+    switch (state_) {
+      case State::kStatusLine:
+      case State::kHeaders:
+      case State::kChunkSize:
+      case State::kChunkDataEnd:
+      case State::kTrailers: {
+        const uint8_t* newline = FindByte(p, end, '\n');
+        line_.append(reinterpret_cast<const char*>(p),
+                     static_cast<size_t>(newline - p));
+        if (line_.size() > kMaxLineLength) {
+          Fail("HTTP line too long");
+          break;
+        }
+        if (newline == end) {
+          p = end;
+          break;
+        }
+        p = newline + 1;
+        if (!line_.empty() && line_.back() == '\r') {
+          line_.pop_back();
+        }
+        ParseLine(line_, sink);
+        line_.clear();
+        break;
+      }
+
+      case State::kBody:
+      case State::kChunkData: {
+        size_t available = static_cast<size_t>(end - p);
+        size_t take = available;
+        if (!read_until_close_ && remaining_ < available) {
+          take = static_cast<size_t>(remaining_);
+        }
+        if (take > 0) {
+          sink->OnBodyData(p, take);
+        }
+        p += take;
+        if (!read_until_close_) {
+          remaining_ -= take;
+          if (remaining_ == 0) {
+            state_ = state_ == State::kChunkData ? State::kChunkDataEnd
+                                                 : State::kComplete;
+          }
+        }
+        break;
+      }
+
+      case State::kComplete:
+      case State::kError:
+        break;
+    }
+  }
+
+  return static_cast<size_t>(p - data);
+}
+
+void HttpResponseParser::OnConnectionClosed() {
+  if (state_ == State::kComplete || state_ == State::kError) {
+    return;
+  }
+  if (state_ == State::kBody && read_until_close_) {
+    state_ = State::kComplete;
+    return;
+  }
+  Fail("Connection closed before the response was complete");
+}
+
+void HttpResponseParser::ParseLine(const std::string& line, BodySink* sink) {
+  if (state_ == State::kStatusLine) {
+    // Stray CRLF between keep-alive responses is tolerated.
+    if (!line.empty() && ParseStatusLine(line)) {
+      state_ = State::kHeaders;
+    }
+  } else if (state_ == State::kHeaders) {
+    if (line.empty()) {
+      FinishHeaders(sink);
+    } else {
+      ParseHeaderLine(line);
+    }
+  } else if (state_ == State::kChunkSize) {
+    // Chunk extensions after ';' are ignored.
+    size_t begin = 0;
+    size_t end = std::min(line.find(';'), line.size());
+    Trim(line, &begin, &end);
+    if (begin == end) {
+      Fail("Missing chunk size");
+      return;
+    }
+    uint64_t chunk_size = 0;
+    for (size_t i = begin; i < end; i++) {
+      const char c = line[i];
+      int digit;
+      if (c >= '0' && c <= '9') {
+        digit = c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        digit = c - 'a' + 10;
+      } else if (c >= 'A' && c <= 'F') {
+        digit = c - 'A' + 10;
+      } else {
+        digit = -1;
+      }
+      if (digit < 0 || chunk_size > (UINT64_MAX >> 4)) {
+        chunk_size = UINT64_MAX;
+        break;
+      }
+      chunk_size = (chunk_size << 4) | static_cast<uint64_t>(digit);
+    }
+    if (chunk_size == UINT64_MAX) {
+      Fail("Invalid chunk size");
+      return;
+    }
+    remaining_ = chunk_size;
+    state_ = chunk_size == 0 ? State::kTrailers : State::kChunkData;
+  } else if (state_ == State::kChunkDataEnd) {
+    if (!line.empty()) {
+      Fail("Malformed chunk terminator");
+      return;
+    }
+    state_ = State::kChunkSize;
+  } else if (state_ == State::kTrailers) {
+    if (line.empty()) {
+      state_ = State::kComplete;
+    }
+  }
+}
+
+bool HttpResponseParser::ParseStatusLine(const std::string& line) {
+  // "HTTP/1.1 200 OK"
+  if (line.compare(0, 5, "HTTP/") != 0) {
+    Fail("Malformed status line");
+    return false;
+  }
+  size_t space = line.find(' ');
+  if (space == std::string::npos || line.size() < space + 4) {
+    Fail("Malformed status line");
+    return false;
+  }
+  int code = 0;
+  for (size_t i = space + 1; i < space + 4; i++) {
+    if (line[i] < '0' || line[i] > '9') {
+      Fail("Malformed status code");
+      return false;
+    }
+    code = code * 10 + (line[i] - '0');
+  }
+  status_code_ = code;
+  if (line.compare(0, 8, "HTTP/1.0") == 0) {
+    keep_alive_ = false;
+  }
+  return true;
+}
+
+bool HttpResponseParser::ParseHeaderLine(const std::string& line) {
+  size_t colon = line.find(':');
+  if (colon == std::string::npos || colon == 0) {
+    // Ignore junk rather than failing the whole response.
+    return false;
+  }
+  if (header_count_ >= kMaxHeaders) {
+    Fail("Too many headers");
+    return false;
+  }
+  if (header_count_ == headers_.size()) {
+    headers_.emplace_back();
+  }
+  std::string& name = headers_[header_count_].first;
+  std::string& value = headers_[header_count_].second;
+  header_count_++;
+  name.assign(line, 0, colon);
+  std::transform(name.begin(), name.end(), name.begin(), ToLower);
+  size_t begin = colon + 1;
+  size_t end = line.size();
+  Trim(line, &begin, &end);
+  value.assign(line, begin, end - begin);
+
+  if (EqualsIgnoreCase(name, "transfer-encoding")) {
+    chunked_ = ContainsTokenIgnoreCase(value, "chunked");
+  } else if (EqualsIgnoreCase(name, "content-length")) {
+    uint64_t length = 0;
+    for (char c : value) {
+      const uint64_t digit = static_cast<uint64_t>(c - '0');
+      if (c < '0' || c > '9' || length > (UINT64_MAX - digit) / 10) {
+        Fail("Invalid Content-Length");
+        return false;
+      }
+      length = length * 10 + digit;
+    }
+    remaining_ = length;
+  } else if (EqualsIgnoreCase(name, "connection")) {
+    if (ContainsTokenIgnoreCase(value, "close")) {
+      keep_alive_ = false;
+    } else if (ContainsTokenIgnoreCase(value, "keep-alive")) {
+      keep_alive_ = true;
+    }
+  }
+  return true;
+}
+
+void HttpResponseParser::FinishHeaders(BodySink* sink) {
+  // An interim response (100 Continue, 103 Early Hints) is followed by the
+  // real one on the same connection; 101 hands the connection over.
+  if (status_code_ >= 100 && status_code_ < 200 && status_code_ != 101) {
+    status_code_ = 0;
+    header_count_ = 0;
+    remaining_ = 0;
+    chunked_ = false;
+    keep_alive_ = true;
+    state_ = State::kStatusLine;
+    return;
+  }
+
+  bool has_length = false;
+  for (const auto& header : headers()) {
+    if (header.first == "content-length") {
+      has_length = true;
+    }
+  }
+  headers_complete_ = true;
+  sink->OnHeadersComplete(status_code_, headers());
+
+  if (state_ == State::kError) {
+    return;
+  }
+  if (head_request_ || status_code_ == 204 || status_code_ == 304 ||
+      status_code_ == 101) {
+    state_ = State::kComplete;
+  } else if (chunked_) {
+    state_ = State::kChunkSize;
+  } else if (has_length) {
+    state_ = remaining_ == 0 ? State::kComplete : State::kBody;
+  } else {
+    read_until_close_ = true;
+    state_ = State::kBody;
+  }
+}
+
+void HttpResponseParser::Fail(const char* message) {
+  state_ = State::kError;
+  error_ = message;
+  keep_alive_ = false;
+}
+
+}  // namespace cloudtolocalllm
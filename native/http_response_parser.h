@@ -0,0 +1,123 @@
+#ifndef NATIVE_HTTP_RESPONSE_PARSER_H_
+#define NATIVE_HTTP_RESPONSE_PARSER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cloudtolocalllm {
+
+using HttpHeaderList = std::vector<std::pair<std::string, std::string>>;
+
+// The first |size| entries of a header list, as handed out by the parser,
+// whose list keeps further entries from earlier responses for reuse.
+// Valid only as long as the list.
+class HttpHeaderView {
+ public:
+  using value_type = HttpHeaderList::value_type;
+
+  HttpHeaderView() = default;
+  HttpHeaderView(const value_type* data, size_t size)
+      : data_(data), size_(size) {}
+  // Implicit, so a whole list (a cached response's) passes as a view.
+  HttpHeaderView(const HttpHeaderList& headers)
+      : data_(headers.data()), size_(headers.size()) {}
+
+  const value_type* begin() const { return data_; }
+  const value_type* end() const { return data_ + size_; }
+  const value_type& operator[](size_t index) const { return data_[index]; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+ private:
+  const value_type* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// Incremental HTTP/1.1 response parser.
+//
+// Bytes are pushed in as they arrive from the socket. The parser consumes
+// the status line and headers, then de-frames the body according to
+// Transfer-Encoding: chunked, Content-Length or connection close, handing
+// body bytes to the caller without buffering them. Its line and header
+// strings survive Reset, so a keep-alive connection's later responses are
+// parsed into buffers it already has.
+class HttpResponseParser {
+ public:
+  enum class State {
+    kStatusLine,
+    kHeaders,
+    kBody,
+    kChunkSize,
+    kChunkData,
+    kChunkDataEnd,
+    kTrailers,
+    kComplete,
+    kError,
+  };
+
+  // Receives body bytes; |data| points into the buffer passed to Parse.
+  class BodySink {
+   public:
+    virtual ~BodySink() = default;
+    virtual void OnHeadersComplete(int status_code,
+                                   HttpHeaderView headers) = 0;
+    virtual void OnBodyData(const uint8_t* data, size_t size) = 0;
+  };
+
+  HttpResponseParser();
+
+  // Prepares for a new response. |head_request| marks responses that never
+  // carry a body regardless of their headers.
+  void Reset(bool head_request = false);
+
+  // Parses |size| bytes, forwarding events to |sink|. Returns the number of
+  // bytes consumed; anything left over belongs to the next response on the
+  // connection (pipelining is not used, so this is normally all of it).
+  size_t Parse(const uint8_t* data, size_t size, BodySink* sink);
+
+  // Signals that the peer closed the connection. Completes a response whose
+  // body is delimited by connection close; anything else becomes an error.
+  void OnConnectionClosed();
+
+  State state() const { return state_; }
+  bool complete() const { return state_ == State::kComplete; }
+  bool failed() const { return state_ == State::kError; }
+  bool headers_complete() const { return headers_complete_; }
+  int status_code() const { return status_code_; }
+  HttpHeaderView headers() const {
+    return HttpHeaderView(headers_.data(), header_count_);
+  }
+  const std::string& error() const { return error_; }
+
+  // True when the connection can carry another request after this response.
+  bool keep_alive() const { return keep_alive_ && !read_until_close_; }
+
+ private:
+  void ParseLine(const std::string& line, BodySink* sink);
+  bool ParseStatusLine(const std::string& line);
+  bool ParseHeaderLine(const std::string& line);
+  void FinishHeaders(BodySink* sink);
+  void Fail(const char* message);
+
+  State state_;
+  bool head_request_;
+  bool headers_complete_;
+  int status_code_;
+  // Only the first |header_count_| are this response's; the rest are left
+  // from an earlier one to be reused.
+  HttpHeaderList headers_;
+  size_t header_count_;
+  std::string line_;
+  uint64_t remaining_;
+  bool chunked_;
+  bool read_until_close_;
+  bool keep_alive_;
+  std::string error_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_HTTP_RESPONSE_PARSER_H_
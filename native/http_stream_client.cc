@@ -0,0 +1,608 @@
+#include "native/http_stream_client.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace cloudtolocalllm {
+
+namespace {
+
+constexpr size_t kReadBufferSize = 64 * 1024;
+
+// Finished requests kept for reuse.
+constexpr size_t kMaxSpareRequests = 16;
+
+int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void PoolKey(const std::string& host, uint16_t port, std::string* key) {
+  key->assign(host).append(":").append(std::to_string(port));
+}
+
+bool EqualsIgnoreCase(const std::string& a, const char* b) {
+  size_t i = 0;
+  for (; i < a.size() && b[i] != '\0'; i++) {
+    const char c =
+        a[i] >= 'A' && a[i] <= 'Z' ? static_cast<char>(a[i] + 32) : a[i];
+    if (c != b[i]) {
+      return false;
+    }
+  }
+  return i == a.size() && b[i] == '\0';
+}
+
+// Whether |text| can go into the request head as is: no CR or LF to end
+// the line early, no other control bytes, and for a method, path or
+// header name no space (or, for a name, colon) to split it.
+bool IsHeadText(const std::string& text, bool token, bool name = false) {
+  for (char c : text) {
+    const unsigned char byte = static_cast<unsigned char>(c);
+    if (byte < 0x20 || byte == 0x7f || (token && c == ' ') ||
+        (name && c == ':')) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool IsValidHead(const HttpRequest& request) {
+  if (request.method.empty() || !IsHeadText(request.method, true) ||
+      request.path.empty() || !IsHeadText(request.path, true) ||
+      !IsHeadText(request.host, true)) {
+    return false;
+  }
+  for (const auto& header : request.headers) {
+    if (header.first.empty() || !IsHeadText(header.first, true, true) ||
+        !IsHeadText(header.second, false)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+struct HttpStreamClient::Connection : public HttpResponseParser::BodySink {
+  enum class Phase { kConnecting, kSending, kReceiving, kIdle };
+
+  HttpStreamClient* client = nullptr;
+  SocketHandle socket = kInvalidSocket;
+  std::string key;
+  Phase phase = Phase::kConnecting;
+  int64_t deadline_ms = 0;
+
+  std::unique_ptr<HttpRequest> request;
+  // Whether this connection carried an earlier request; a reused connection
+  // that the server already closed is retried once on a fresh one.
+  bool reused = false;
+  bool received_any = false;
+  // Set by SetPaused; a paused connection is not polled for input.
+  bool paused = false;
+
+  std::string out;
+  size_t out_offset = 0;
+
+  HttpResponseParser parser;
+  bool tokens_enabled = false;
+  NdjsonTokenScanner scanner;
+  TokenBatch batch;
+
+  void OnHeadersComplete(int status_code, HttpHeaderView headers) override {
+    tokens_enabled =
+        request->parse_ndjson && status_code >= 200 && status_code < 300;
+    client->delegate_->OnResponseStarted(request->id, status_code, headers);
+  }
+
+  void OnBodyData(const uint8_t* data, size_t size) override {
+    if (tokens_enabled) {
+      scanner.Feed(data, size, &batch);
+    } else {
+      client->delegate_->OnBodyData(request->id, data, size);
+    }
+  }
+};
+
+HttpStreamClient::HttpStreamClient(Delegate* delegate)
+    : HttpStreamClient(delegate, Options()) {}
+
+HttpStreamClient::HttpStreamClient(Delegate* delegate, const Options& options)
+    : delegate_(delegate),
+      options_(options),
+      running_(false),
+      wake_read_(kInvalidSocket),
+      wake_write_(kInvalidSocket),
+      read_buffer_(kReadBufferSize),
+      requests_started_(0),
+      requests_completed_(0),
+      requests_failed_(0),
+      connections_opened_(0),
+      connections_reused_(0) {}
+
+HttpStreamClient::~HttpStreamClient() {
+  Stop();
+}
+
+bool HttpStreamClient::Start() {
+  if (running_) {
+    return true;
+  }
+  if (!CreateWakePair(&wake_read_, &wake_write_)) {
+    return false;
+  }
+  running_ = true;
+  worker_ = std::thread(&HttpStreamClient::Run, this);
+  return true;
+}
+
+void HttpStreamClient::Stop() {
+  if (!running_) {
+    return;
+  }
+  running_ = false;
+  Wake();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+  for (auto& connection : connections_) {
+    CloseSocket(connection->socket);
+  }
+  connections_.clear();
+  CloseSocket(wake_read_);
+  CloseSocket(wake_write_);
+  wake_read_ = kInvalidSocket;
+  wake_write_ = kInvalidSocket;
+}
+
+std::unique_ptr<HttpRequest> HttpStreamClient::AcquireRequest(
+    bool* allocated) {
+  if (allocated != nullptr) {
+    *allocated = false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!spare_requests_.empty()) {
+      std::unique_ptr<HttpRequest> request = std::move(spare_requests_.back());
+      spare_requests_.pop_back();
+      return request;
+    }
+  }
+  if (allocated != nullptr) {
+    *allocated = true;
+  }
+  return std::make_unique<HttpRequest>();
+}
+
+void HttpStreamClient::ReleaseRequest(std::unique_ptr<HttpRequest> request) {
+  if (!request) {
+    return;
+  }
+  // Assignment and clear() keep the strings' buffers.
+  request->id = 0;
+  request->method = "GET";
+  request->host = "localhost";
+  request->port = 11434;
+  request->path = "/";
+  request->body.clear();
+  request->parse_ndjson = false;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (spare_requests_.size() < kMaxSpareRequests) {
+    spare_requests_.push_back(std::move(request));
+  }
+}
+
+void HttpStreamClient::Submit(HttpRequest request) {
+  Submit(std::make_unique<HttpRequest>(std::move(request)));
+}
+
+void HttpStreamClient::Submit(std::unique_ptr<HttpRequest> request) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.push_back(std::move(request));
+  }
+  Wake();
+}
+
+void HttpStreamClient::Post(uint64_t id) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    posted_.push_back(id);
+  }
+  Wake();
+}
+
+void HttpStreamClient::Cancel(uint64_t id) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancelled_.push_back(id);
+  }
+  Wake();
+}
+
+void HttpStreamClient::SetPaused(uint64_t id, bool paused) {
+  if (std::this_thread::get_id() == worker_.get_id()) {
+    ApplyPaused(id, paused);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    paused_.emplace_back(id, paused);
+  }
+  Wake();
+}
+
+void HttpStreamClient::ApplyPaused(uint64_t id, bool paused) {
+  for (auto& connection : connections_) {
+    if (connection->request && connection->request->id == id) {
+      connection->paused = paused;
+    }
+  }
+}
+
+HttpStreamClient::Stats HttpStreamClient::stats() const {
+  Stats stats;
+  stats.requests_started = requests_started_;
+  stats.requests_completed = requests_completed_;
+  stats.requests_failed = requests_failed_;
+  stats.connections_opened = connections_opened_;
+  stats.connections_reused = connections_reused_;
+  return stats;
+}
+
+void HttpStreamClient::Wake() {
+  if (wake_write_ != kInvalidSocket) {
+    uint8_t byte = 1;
+    SendSome(wake_write_, &byte, 1);
+  }
+}
+
+void HttpStreamClient::Run() {
+  std::vector<PollEntry> entries;
+  std::vector<Connection*> polled;
+  while (running_) {
+    entries.clear();
+    polled.clear();
+    entries.push_back({wake_read_, kPollIn, 0});
+
+    int64_t now = NowMs();
+    int64_t next_deadline = -1;
+    for (auto& connection : connections_) {
+      if (connection->paused &&
+          connection->phase == Connection::Phase::kReceiving) {
+        continue;
+      }
+      short events = kPollIn;
+      if (connection->phase == Connection::Phase::kConnecting ||
+          connection->phase == Connection::Phase::kSending) {
+        events = kPollOut;
+      }
+      entries.push_back({connection->socket, events, 0});
+      polled.push_back(connection.get());
+      if (connection->deadline_ms > 0 &&
+          (next_deadline < 0 || connection->deadline_ms < next_deadline)) {
+        next_deadline = connection->deadline_ms;
+      }
+    }
+
+    int timeout = -1;
+    if (next_deadline >= 0) {
+      timeout = static_cast<int>(std::max<int64_t>(0, next_deadline - now));
+    }
+    PollSockets(entries.data(), entries.size(), timeout);
+    if (!running_) {
+      break;
+    }
+
+    if (entries[0].revents & kPollIn) {
+      uint8_t drain[64];
+      while (RecvSome(wake_read_, drain, sizeof(drain)) > 0) {
+      }
+    }
+    DrainCommands();
+
+    for (size_t i = 0; i < polled.size(); i++) {
+      Connection* connection = polled[i];
+      // DrainCommands/earlier iterations may have closed the connection.
+      if (connection->socket == kInvalidSocket) {
+        continue;
+      }
+      short revents = entries[i + 1].revents;
+      if (revents == 0) {
+        continue;
+      }
+      if (connection->phase == Connection::Phase::kConnecting ||
+          connection->phase == Connection::Phase::kSending) {
+        HandleWritable(connection);
+      } else {
+        HandleReadable(connection);
+      }
+    }
+
+    now = NowMs();
+    for (auto& connection : connections_) {
+      if (connection->socket == kInvalidSocket ||
+          connection->deadline_ms <= 0 || connection->deadline_ms > now) {
+        continue;
+      }
+      if (connection->phase == Connection::Phase::kIdle) {
+        CloseConnection(connection.get());
+      } else {
+        FailConnection(connection.get(), "Timed out connecting to " +
+                                             connection->key);
+      }
+    }
+
+    connections_.erase(
+        std::remove_if(connections_.begin(), connections_.end(),
+                       [](const std::unique_ptr<Connection>& connection) {
+                         return connection->socket == kInvalidSocket;
+                       }),
+        connections_.end());
+  }
+}
+
+void HttpStreamClient::DrainCommands() {
+  std::vector<std::unique_ptr<HttpRequest>>& pending = draining_;
+  std::vector<uint64_t>& cancelled = draining_cancelled_;
+  std::vector<std::pair<uint64_t, bool>>& paused = draining_paused_;
+  std::vector<uint64_t>& posted = draining_posted_;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending.swap(pending_);
+    cancelled.swap(cancelled_);
+    paused.swap(paused_);
+    posted.swap(posted_);
+  }
+
+  for (const auto& entry : paused) {
+    ApplyPaused(entry.first, entry.second);
+  }
+
+  for (uint64_t id : cancelled) {
+    posted.erase(std::remove(posted.begin(), posted.end(), id), posted.end());
+    for (auto& request : pending) {
+      if (request && request->id == id) {
+        ReleaseRequest(std::move(request));
+      }
+    }
+    for (auto& connection : connections_) {
+      if (connection->request && connection->request->id == id) {
+        CloseConnection(connection.get());
+      }
+    }
+  }
+
+  for (uint64_t id : posted) {
+    delegate_->OnPosted(id);
+  }
+
+  for (auto& request : pending) {
+    if (request) {
+      StartRequest(std::move(request), true);
+    }
+  }
+  pending.clear();
+  cancelled.clear();
+  paused.clear();
+  posted.clear();
+}
+
+void HttpStreamClient::StartRequest(std::unique_ptr<HttpRequest> request,
+                                    bool allow_reuse) {
+  if (!IsValidHead(*request)) {
+    ++requests_failed_;
+    delegate_->OnError(request->id, "Invalid request line or header");
+    ReleaseRequest(std::move(request));
+    return;
+  }
+  PoolKey(request->host, request->port, &key_);
+
+  Connection* connection = nullptr;
+  if (allow_reuse) {
+    for (auto& candidate : connections_) {
+      if (candidate->phase == Connection::Phase::kIdle &&
+          candidate->socket != kInvalidSocket && candidate->key == key_) {
+        connection = candidate.get();
+        connection->reused = true;
+        connection->phase = Connection::Phase::kSending;
+        ++connections_reused_;
+        break;
+      }
+    }
+  }
+
+  if (connection == nullptr) {
+    std::string error;
+    SocketHandle socket = ConnectTcp(request->host, request->port, &error);
+    if (socket == kInvalidSocket) {
+      ++requests_failed_;
+      delegate_->OnError(request->id, error);
+      ReleaseRequest(std::move(request));
+      return;
+    }
+    auto created = std::make_unique<Connection>();
+    created->client = this;
+    created->socket = socket;
+    created->key = key_;
+    created->phase = Connection::Phase::kConnecting;
+    connection = created.get();
+    connections_.push_back(std::move(created));
+    ++connections_opened_;
+  }
+
+  ++requests_started_;
+  connection->deadline_ms =
+      connection->phase == Connection::Phase::kConnecting
+          ? NowMs() + options_.connect_timeout_ms
+          : 0;
+  SerializeRequest(*request, &connection->out);
+  connection->out_offset = 0;
+  connection->received_any = false;
+  connection->paused = false;
+  connection->parser.Reset(request->method == "HEAD");
+  connection->scanner.Reset();
+  connection->batch.Reset();
+  connection->tokens_enabled = false;
+  connection->request = std::move(request);
+}
+
+void HttpStreamClient::HandleWritable(Connection* connection) {
+  if (connection->phase == Connection::Phase::kConnecting) {
+    int error = GetPendingSocketError(connection->socket);
+    if (error != 0) {
+      FailConnection(connection, "Could not connect to " + connection->key);
+      return;
+    }
+    connection->phase = Connection::Phase::kSending;
+    connection->deadline_ms = 0;
+  }
+
+  while (connection->out_offset < connection->out.size()) {
+    long sent = SendSome(connection->socket,
+                         connection->out.data() + connection->out_offset,
+                         connection->out.size() - connection->out_offset);
+    if (sent == kSocketWouldBlock) {
+      return;
+    }
+    if (sent < 0) {
+      FailConnection(connection, "Send failed: " + LastSocketErrorString());
+      return;
+    }
+    connection->out_offset += static_cast<size_t>(sent);
+  }
+  connection->out.clear();
+  connection->out_offset = 0;
+  connection->phase = Connection::Phase::kReceiving;
+}
+
+void HttpStreamClient::HandleReadable(Connection* connection) {
+  if (connection->phase == Connection::Phase::kIdle) {
+    // An idle connection only becomes readable when the server closes it.
+    CloseConnection(connection);
+    return;
+  }
+
+  // Bound the work done per wakeup so one fast stream cannot starve the
+  // others sharing this thread.
+  for (int reads = 0; reads < 8; reads++) {
+    long received =
+        RecvSome(connection->socket, read_buffer_.data(), read_buffer_.size());
+    if (received == kSocketWouldBlock) {
+      break;
+    }
+    if (received <= 0) {
+      if (!connection->received_any && connection->reused) {
+        // The pooled connection went stale; replay on a fresh one.
+        std::unique_ptr<HttpRequest> request = std::move(connection->request);
+        --requests_started_;
+        CloseConnection(connection);
+        StartRequest(std::move(request), false);
+        return;
+      }
+      connection->parser.OnConnectionClosed();
+      if (connection->parser.complete()) {
+        FinishResponse(connection);
+      } else {
+        FailConnection(connection, connection->parser.error());
+      }
+      return;
+    }
+
+    connection->received_any = true;
+    connection->parser.Parse(read_buffer_.data(),
+                             static_cast<size_t>(received), connection);
+    if (connection->parser.failed()) {
+      FailConnection(connection, connection->parser.error());
+      return;
+    }
+    if (connection->parser.complete()) {
+      FinishResponse(connection);
+      return;
+    }
+    if (connection->paused) {
+      break;
+    }
+  }
+  FlushTokens(connection);
+}
+
+void HttpStreamClient::FlushTokens(Connection* connection) {
+  if (connection->tokens_enabled && !connection->batch.empty()) {
+    delegate_->OnTokenBatch(connection->request->id, connection->batch);
+    connection->batch.Reset();
+  }
+}
+
+void HttpStreamClient::FinishResponse(Connection* connection) {
+  if (connection->tokens_enabled) {
+    connection->scanner.Finish(&connection->batch);
+  }
+  FlushTokens(connection);
+  uint64_t id = connection->request->id;
+  ReleaseRequest(std::move(connection->request));
+  ++requests_completed_;
+  delegate_->OnComplete(id);
+
+  size_t idle_for_host = 0;
+  for (auto& other : connections_) {
+    if (other->phase == Connection::Phase::kIdle &&
+        other->key == connection->key && other->socket != kInvalidSocket) {
+      ++idle_for_host;
+    }
+  }
+  if (connection->parser.keep_alive() &&
+      idle_for_host < options_.max_idle_per_host) {
+    connection->phase = Connection::Phase::kIdle;
+    connection->deadline_ms = NowMs() + options_.idle_timeout_ms;
+  } else {
+    CloseConnection(connection);
+  }
+}
+
+void HttpStreamClient::FailConnection(Connection* connection,
+                                      const std::string& message) {
+  if (connection->request) {
+    ++requests_failed_;
+    delegate_->OnError(connection->request->id,
+                       message.empty() ? "Request failed" : message);
+    ReleaseRequest(std::move(connection->request));
+  }
+  CloseConnection(connection);
+}
+
+void HttpStreamClient::CloseConnection(Connection* connection) {
+  CloseSocket(connection->socket);
+  connection->socket = kInvalidSocket;
+  ReleaseRequest(std::move(connection->request));
+}
+
+void HttpStreamClient::SerializeRequest(const HttpRequest& request,
+                                        std::string* out) {
+  out->clear();
+  out->reserve(256 + request.body.size());
+  out->append(request.method).append(" ").append(request.path);
+  out->append(" HTTP/1.1\r\nHost: ").append(request.host);
+  out->append(":").append(std::to_string(request.port)).append("\r\n");
+  for (const auto& header : request.headers) {
+    // Framing headers are owned by the client: a relayed request's own
+    // Content-Length may describe a body that was re-encoded on the way,
+    // and the body is always sent at once, so there is nothing to expect.
+    if (EqualsIgnoreCase(header.first, "host") ||
+        EqualsIgnoreCase(header.first, "connection") ||
+        EqualsIgnoreCase(header.first, "transfer-encoding") ||
+        EqualsIgnoreCase(header.first, "content-length") ||
+        EqualsIgnoreCase(header.first, "expect")) {
+      continue;
+    }
+    out->append(header.first).append(": ").append(header.second);
+    out->append("\r\n");
+  }
+  out->append("Content-Length: ");
+  out->append(std::to_string(request.body.size())).append("\r\n");
+  out->append("Connection: keep-alive\r\n\r\n");
+  out->append(request.body);
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,188 @@
+#ifndef NATIVE_HTTP_STREAM_CLIENT_H_
+#define NATIVE_HTTP_STREAM_CLIENT_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "native/http_response_parser.h"
+#include "native/ndjson_token_scanner.h"
+#include "native/socket.h"
+
+namespace cloudtolocalllm {
+
+struct HttpRequest {
+  // Caller-chosen identifier echoed back in every delegate callback.
+  uint64_t id = 0;
+  std::string method = "GET";
+  std::string host = "localhost";
+  uint16_t port = 11434;
+  std::string path = "/";
+  // Host, Connection, Transfer-Encoding, Content-Length and Expect are the
+  // client's own and skipped here. A request whose method, path or headers
+  // hold CR, LF or other control bytes fails without being sent.
+  HttpHeaderList headers;
+  std::string body;
+  // When set, a 2xx body is run through NdjsonTokenScanner and delivered as
+  // token batches instead of raw bytes.
+  bool parse_ndjson = false;
+};
+
+// Streaming HTTP/1.1 client for plain-text endpoints on the local machine
+// (Ollama on localhost:11434).
+//
+// All socket work happens on one dedicated worker thread running a poll()
+// loop, so many requests can stream concurrently without a thread each and
+// without ever touching the Flutter platform or UI threads. Connections are
+// opened with TCP_NODELAY and returned to a per-host keep-alive pool when the
+// server allows it. Chunked, Content-Length and close-delimited bodies are
+// all supported; TLS is not.
+//
+// Requests are recycled: one taken from AcquireRequest and, once it has
+// finished, handed back to the next caller keeps the capacity of its
+// strings, and each connection serializes into and parses with buffers it
+// keeps. A steady flow of similar requests therefore runs without heap
+// allocation on the worker thread.
+class HttpStreamClient {
+ public:
+  // Receives request progress. Every method is invoked on the worker thread;
+  // implementations must hand the data off rather than block.
+  class Delegate {
+   public:
+    virtual ~Delegate() = default;
+    virtual void OnResponseStarted(uint64_t id, int status_code,
+                                   HttpHeaderView headers) = 0;
+    virtual void OnBodyData(uint64_t id, const uint8_t* data,
+                            size_t size) = 0;
+    virtual void OnTokenBatch(uint64_t id, const TokenBatch& batch) = 0;
+    virtual void OnComplete(uint64_t id) = 0;
+    virtual void OnError(uint64_t id, const std::string& message) = 0;
+    // Runs for each id handed to Post.
+    virtual void OnPosted(uint64_t /*id*/) {}
+  };
+
+  struct Options {
+    // Idle connections kept per host:port.
+    size_t max_idle_per_host = 4;
+    // How long an idle connection is kept before being closed.
+    int idle_timeout_ms = 30000;
+    // How long a connect may take before the request fails.
+    int connect_timeout_ms = 5000;
+  };
+
+  struct Stats {
+    uint64_t requests_started = 0;
+    uint64_t requests_completed = 0;
+    uint64_t requests_failed = 0;
+    uint64_t connections_opened = 0;
+    uint64_t connections_reused = 0;
+  };
+
+  // |delegate| must outlive the client.
+  explicit HttpStreamClient(Delegate* delegate);
+  HttpStreamClient(Delegate* delegate, const Options& options);
+  ~HttpStreamClient();
+
+  // Prevent copying.
+  HttpStreamClient(HttpStreamClient const&) = delete;
+  HttpStreamClient& operator=(HttpStreamClient const&) = delete;
+
+  // Starts the worker thread. Returns false if it could not be started.
+  bool Start();
+
+  // Stops the worker thread, failing nothing: requests in flight are simply
+  // dropped. Called automatically on destruction.
+  void Stop();
+
+  // Returns a request to fill in and Submit, recycled from a finished one
+  // when there is one; |allocated|, if given, is set when it is new. Every
+  // field holds its default except |headers|, which keeps the entries of
+  // the request it last carried so they can be overwritten in place. May
+  // be called from any thread.
+  std::unique_ptr<HttpRequest> AcquireRequest(bool* allocated = nullptr);
+
+  // Hands back a request that was acquired but is not being submitted. May
+  // be called from any thread.
+  void ReleaseRequest(std::unique_ptr<HttpRequest> request);
+
+  // Queues |request|. May be called from any thread.
+  void Submit(HttpRequest request);
+  void Submit(std::unique_ptr<HttpRequest> request);
+
+  // Calls Delegate::OnPosted(id) on the worker thread, so a caller that
+  // answers a request itself (from a cache, say) does so on the thread
+  // every other callback runs on. May be called from any thread.
+  void Post(uint64_t id);
+
+  // Aborts request |id| if it is queued, posted or in flight. No further callbacks
+  // are made for it. May be called from any thread.
+  void Cancel(uint64_t id);
+
+  // Stops or resumes reading the response body of request |id|, leaving
+  // unread data in the socket so TCP flow control pushes back on the
+  // server. Called from a delegate callback it takes effect before the next
+  // read; from other threads, on the worker's next wakeup.
+  void SetPaused(uint64_t id, bool paused);
+
+  Stats stats() const;
+
+ private:
+  struct Connection;
+
+  void Run();
+  void Wake();
+  void DrainCommands();
+  void ApplyPaused(uint64_t id, bool paused);
+  void StartRequest(std::unique_ptr<HttpRequest> request, bool allow_reuse);
+  void HandleWritable(Connection* connection);
+  void HandleReadable(Connection* connection);
+  void FinishResponse(Connection* connection);
+  void FailConnection(Connection* connection, const std::string& message);
+  void CloseConnection(Connection* connection);
+  void FlushTokens(Connection* connection);
+  static void SerializeRequest(const HttpRequest& request, std::string* out);
+
+  Delegate* delegate_;
+  Options options_;
+
+  std::thread worker_;
+  std::atomic<bool> running_;
+  SocketHandle wake_read_;
+  SocketHandle wake_write_;
+
+  // Commands handed from other threads to the worker.
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<HttpRequest>> pending_;
+  std::vector<uint64_t> cancelled_;
+  std::vector<std::pair<uint64_t, bool>> paused_;
+  std::vector<uint64_t> posted_;
+  // Finished requests waiting for AcquireRequest.
+  std::vector<std::unique_ptr<HttpRequest>> spare_requests_;
+
+  // Worker-thread state.
+  std::vector<std::unique_ptr<Connection>> connections_;
+  std::vector<uint8_t> read_buffer_;
+  // The command lists are swapped with these so both keep their capacity.
+  std::vector<std::unique_ptr<HttpRequest>> draining_;
+  std::vector<uint64_t> draining_cancelled_;
+  std::vector<std::pair<uint64_t, bool>> draining_paused_;
+  std::vector<uint64_t> draining_posted_;
+  // Scratch for a request's connection pool key.
+  std::string key_;
+
+  std::atomic<uint64_t> requests_started_;
+  std::atomic<uint64_t> requests_completed_;
+  std::atomic<uint64_t> requests_failed_;
+  std::atomic<uint64_t> connections_opened_;
+  std::atomic<uint64_t> connections_reused_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_HTTP_STREAM_CLIENT_H_
@@ -0,0 +1,779 @@
+#include "native/http_stream_service.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace cloudtolocalllm {
+
+namespace {
+
+// Room for the event header, frame header and the chunk's correlation id on
+// top of a full chunk.
+constexpr size_t kEventBufferCapacity =
+    HttpStreamService::kTunnelChunkSize + 1024;
+constexpr size_t kMaxPooledEventBuffers = 32;
+
+// Where callbacks copy a relayed request's correlation id out from under
+// the tunnel lock. They run one at a time on each of the worker and
+// platform threads, so one buffer per thread serves them all.
+std::string* CorrelationIdScratch() {
+  thread_local std::string scratch;
+  return &scratch;
+}
+
+// The heap |request| holds, to tell whether decoding into it had to grow it.
+size_t RequestCapacity(const HttpRequest& request) {
+  size_t capacity = request.method.capacity() + request.host.capacity() +
+                    request.path.capacity() + request.body.capacity() +
+                    request.headers.capacity();
+  for (const auto& header : request.headers) {
+    capacity += header.first.capacity() + header.second.capacity();
+  }
+  return capacity;
+}
+
+EmbeddingBatcher::Options EmbedderOptions() {
+  EmbeddingBatcher::Options options;
+  options.arena_prefix = HttpStreamService::kEmbeddingsOffset;
+  return options;
+}
+
+}  // namespace
+
+HttpStreamService::HttpStreamService(EventSink sink)
+    : sink_(std::move(sink)),
+      buffer_pool_(std::make_shared<FrameBufferPool>(kEventBufferCapacity,
+                                                     kMaxPooledEventBuffers)),
+      mux_([this](std::vector<uint8_t> event) { sink_(std::move(event)); },
+           [this](uint64_t id) { client_.SetPaused(id, false); }),
+      client_(this),
+      embedder_(this, EmbedderOptions()),
+      downloader_(this),
+      started_(false),
+      embedder_started_(false),
+      downloader_started_(false),
+      local_latency_(LatencyPath::kLocalOllama),
+      tunnel_latency_(LatencyPath::kTunnel) {}
+
+HttpStreamService::~HttpStreamService() {
+  Shutdown();
+}
+
+void HttpStreamService::HandleMessage(const uint8_t* message, size_t size,
+                                      std::vector<uint8_t>* reply) {
+  reply->clear();
+
+  WireReader reader(message, size);
+  uint8_t op;
+  uint64_t id;
+  if (!reader.ReadU8(&op) || !reader.ReadU64(&id)) {
+    return;
+  }
+
+  // The worker threads are started lazily so apps that never stream
+  // locally don't pay for them.
+  if (!started_) {
+    started_ = client_.Start() && mux_.Start();
+    if (!started_) {
+      client_.Stop();
+      return;
+    }
+  }
+
+  switch (op) {
+    case kPing:
+      reply->push_back(1);
+      return;
+    case kStart:
+      if (StartRequest(id, &reader)) {
+        reply->push_back(1);
+      }
+      return;
+    case kCancel: {
+      if (embedder_.Cancel(id) || downloader_.Cancel(id)) {
+        reply->push_back(1);
+        return;
+      }
+      // A leader whose response others are waiting for keeps going, muted.
+      if (!cache_.Cancel(id)) {
+        client_.Cancel(id);
+      }
+      local_latency_.End(id);
+      tunnel_latency_.End(id);
+      mux_.CloseStream(id);
+      {
+        std::lock_guard<std::mutex> lock(tunnel_mutex_);
+        tunnel_streams_.Erase(id);
+      }
+      {
+        std::lock_guard<std::mutex> lock(markdown_mutex_);
+        markdown_lexers_.Erase(id);
+      }
+      {
+        std::lock_guard<std::mutex> lock(replay_mutex_);
+        replays_.Erase(id);
+      }
+      std::lock_guard<std::mutex> lock(ring_mutex_);
+      ring_requests_.Erase(id);
+      reply->push_back(1);
+      return;
+    }
+    case kOpenTunnelStream: {
+      const uint8_t* key = nullptr;
+      std::string session_id;
+      reader.ReadSpan(ChaCha20Poly1305::kKeySize, &key);
+      uint8_t flags = 0;
+      reader.ReadString(&session_id);
+      if (reader.remaining() > 0) {
+        reader.ReadU8(&flags);
+      }
+      if (!reader.ok()) {
+        return;
+      }
+      auto session = std::make_shared<TunnelSession>(
+          key, std::move(session_id), TunnelDirection::kDesktopToCloudStream);
+      session->set_compression((flags & kTunnelFlagCompress) != 0);
+      std::lock_guard<std::mutex> lock(tunnel_mutex_);
+      tunnel_lanes_[id] = std::move(session);
+      reply->push_back(1);
+      return;
+    }
+    case kCloseTunnelStream: {
+      // Streams already started keep their reference to the session.
+      std::lock_guard<std::mutex> lock(tunnel_mutex_);
+      tunnel_lanes_.erase(id);
+      reply->push_back(1);
+      return;
+    }
+    case kOpenEventRing: {
+      uint32_t capacity = 0;
+      uint64_t doorbell = 0;
+      reader.ReadU32(&capacity);
+      reader.ReadU64(&doorbell);
+      if (!reader.ok() || doorbell == 0) {
+        return;
+      }
+      auto ring = std::make_shared<SpscRing>(
+          capacity, reinterpret_cast<SpscRing::Doorbell>(doorbell),
+          static_cast<int64_t>(id));
+      std::shared_ptr<SpscRing> previous;
+      {
+        std::lock_guard<std::mutex> lock(ring_mutex_);
+        previous = std::move(event_ring_);
+        event_ring_ = ring;
+      }
+      // Requests still writing to the old ring keep it alive, but its
+      // consumer is gone.
+      if (previous) {
+        previous->DetachDoorbell();
+      }
+
+      WireWriter writer(reply);
+      writer.WriteU64(reinterpret_cast<uintptr_t>(ring.get()));
+      writer.WriteU64(reinterpret_cast<uintptr_t>(ring->read_span()));
+      writer.WriteU64(reinterpret_cast<uintptr_t>(&SpscRingRead));
+      writer.WriteU64(reinterpret_cast<uintptr_t>(&SpscRingConsume));
+      writer.WriteU64(reinterpret_cast<uintptr_t>(&SpscRingArm));
+      return;
+    }
+    case kGrantCredit: {
+      uint32_t frames = 0;
+      if (!reader.ReadU32(&frames)) {
+        return;
+      }
+      // Resumes the request through the multiplexer's callback if it had
+      // paused.
+      mux_.GrantCredit(id, frames);
+      reply->push_back(1);
+      return;
+    }
+    case kEmbedFiles:
+      if (StartEmbedding(id, &reader)) {
+        reply->push_back(1);
+      }
+      return;
+    case kPullModel:
+    case kFetchFile:
+      if (StartDownload(op, id, &reader)) {
+        reply->push_back(1);
+      }
+      return;
+    default:
+      return;
+  }
+}
+
+bool HttpStreamService::StartEmbedding(uint64_t id, WireReader* reader) {
+  EmbeddingBatcher::Job job;
+  job.id = id;
+  uint32_t chunk_size = 0;
+  uint32_t chunk_overlap = 0;
+  uint32_t batch_size = 0;
+  uint32_t file_count = 0;
+  reader->ReadString(&job.host);
+  reader->ReadU16(&job.port);
+  reader->ReadString(&job.model);
+  reader->ReadU32(&chunk_size);
+  reader->ReadU32(&chunk_overlap);
+  reader->ReadU32(&batch_size);
+  reader->ReadU32(&file_count);
+  for (uint32_t i = 0; i < file_count && reader->ok(); i++) {
+    std::string path;
+    reader->ReadString(&path);
+    job.paths.push_back(std::move(path));
+  }
+  if (!reader->ok() || job.model.empty()) {
+    return false;
+  }
+  job.chunk_size = chunk_size;
+  job.chunk_overlap = chunk_overlap;
+  job.batch_size = batch_size;
+
+  if (!embedder_started_) {
+    embedder_started_ = embedder_.Start();
+    if (!embedder_started_) {
+      return false;
+    }
+  }
+  // Loading the model changes what /api/ps reports, as for any other
+  // embed request.
+  cache_.Invalidate(job.host, job.port, "/api/embed");
+
+  embedder_.Submit(std::move(job));
+  return true;
+}
+
+bool HttpStreamService::StartDownload(uint8_t op, uint64_t id,
+                                      WireReader* reader) {
+  std::string host;
+  uint16_t port = 0;
+  reader->ReadString(&host);
+  reader->ReadU16(&port);
+  ModelDownloader::Pull pull;
+  ModelDownloader::Fetch fetch;
+  if (op == kPullModel) {
+    reader->ReadString(&pull.model);
+  } else {
+    uint8_t connections = 0;
+    reader->ReadString(&fetch.path);
+    reader->ReadString(&fetch.destination);
+    reader->ReadU8(&connections);
+    fetch.connections = connections;
+  }
+  if (!reader->ok() || (op == kPullModel ? pull.model.empty()
+                                         : fetch.destination.empty())) {
+    return false;
+  }
+
+  if (!downloader_started_) {
+    downloader_started_ = downloader_.Start();
+    if (!downloader_started_) {
+      return false;
+    }
+  }
+  if (op == kFetchFile) {
+    fetch.id = id;
+    fetch.host = std::move(host);
+    fetch.port = port;
+    downloader_.SubmitFetch(std::move(fetch));
+    return true;
+  }
+  pull.id = id;
+  pull.host = std::move(host);
+  pull.port = port;
+  // Pulling changes what /api/tags reports, as for any other pull.
+  cache_.Invalidate(pull.host, pull.port, "/api/pull");
+  downloader_.SubmitPull(std::move(pull));
+  return true;
+}
+
+bool HttpStreamService::StartRequest(uint64_t id, WireReader* reader) {
+  LatencyMetrics* metrics = LatencyMetrics::Get();
+  bool allocated = false;
+  std::unique_ptr<HttpRequest> request = client_.AcquireRequest(&allocated);
+  const size_t capacity = RequestCapacity(*request);
+  auto reject = [&] {
+    client_.ReleaseRequest(std::move(request));
+    return false;
+  };
+
+  request->id = id;
+  uint16_t header_count = 0;
+  uint8_t flags = 0;
+  reader->ReadString(&request->method);
+  reader->ReadString(&request->host);
+  reader->ReadU16(&request->port);
+  reader->ReadString(&request->path);
+  reader->ReadU16(&header_count);
+  // Each header is at least its two string lengths.
+  if (!reader->ok() || header_count > reader->remaining() / 8) {
+    return reject();
+  }
+  // The slots left by the request's last use are overwritten in place.
+  request->headers.resize(header_count);
+  for (auto& header : request->headers) {
+    reader->ReadString(&header.first);
+    reader->ReadString(&header.second);
+  }
+  reader->ReadU8(&flags);
+  reader->ReadString(&request->body);
+  if (!reader->ok()) {
+    return reject();
+  }
+  request->parse_ndjson = (flags & kFlagParseNdjson) != 0;
+  // Counted once the request is accepted below.
+  const bool request_allocated =
+      allocated || RequestCapacity(*request) > capacity;
+
+  if ((flags & kFlagEventRing) != 0) {
+    // Relayed frames are sent by the glue, not read by Dart.
+    if ((flags & kFlagTunnelFrames) != 0) {
+      return reject();
+    }
+    std::lock_guard<std::mutex> lock(ring_mutex_);
+    if (!event_ring_) {
+      return reject();
+    }
+    ring_requests_.Insert(id, &allocated) = event_ring_;
+    if (allocated) {
+      metrics->CountAllocations();
+    }
+  }
+
+  if ((flags & kFlagTunnelFrames) != 0) {
+    uint64_t lane = 0;
+    uint32_t correlation_length = 0;
+    const uint8_t* correlation_id = nullptr;
+    uint32_t window = 0;
+    uint8_t priority = static_cast<uint8_t>(TunnelMux::Priority::kNormal);
+    reader->ReadU64(&lane);
+    reader->ReadU32(&correlation_length);
+    reader->ReadSpan(correlation_length, &correlation_id);
+    reader->ReadU32(&window);
+    if (reader->ok() && reader->remaining() > 0) {
+      reader->ReadU8(&priority);
+    }
+    if (!reader->ok() || priority >= TunnelMux::kPriorityCount) {
+      return reject();
+    }
+    // Token parsing would bypass the relay.
+    request->parse_ndjson = false;
+
+    std::unique_lock<std::mutex> lock(tunnel_mutex_);
+    auto it = tunnel_lanes_.find(lane);
+    if (it == tunnel_lanes_.end()) {
+      lock.unlock();
+      return reject();
+    }
+    mux_.OpenStream(id, it->second,
+                    static_cast<TunnelMux::Priority>(priority),
+                    window > 0 ? window : kDefaultTunnelWindow);
+    TunnelStream& stream = tunnel_streams_.Insert(id, &allocated);
+    stream.session = it->second;
+    stream.correlation_id.assign(reinterpret_cast<const char*>(correlation_id),
+                                 correlation_length);
+    if (allocated) {
+      metrics->CountAllocations();
+    }
+  }
+
+  if ((flags & kFlagMarkdown) != 0 && request->parse_ndjson) {
+    std::lock_guard<std::mutex> lock(markdown_mutex_);
+    markdown_lexers_.Insert(id, &allocated);
+    if (allocated) {
+      metrics->CountAllocations();
+    }
+  }
+
+  metrics->CountRequest();
+  if (request_allocated) {
+    metrics->CountAllocations();
+  }
+  std::shared_ptr<const ResponseCache::Response> cached;
+  switch (cache_.Begin(request.get(), &cached)) {
+    case ResponseCache::Lookup::kHit: {
+      // Replayed on the worker: it is the event ring's only producer.
+      {
+        std::lock_guard<std::mutex> lock(replay_mutex_);
+        replays_.Insert(id, &allocated) = std::move(cached);
+      }
+      if (allocated) {
+        metrics->CountAllocations();
+      }
+      client_.ReleaseRequest(std::move(request));
+      client_.Post(id);
+      break;
+    }
+    case ResponseCache::Lookup::kJoined:
+      // The flight took the request's contents; the husk is still reusable.
+      client_.ReleaseRequest(std::move(request));
+      break;
+    case ResponseCache::Lookup::kMiss:
+    case ResponseCache::Lookup::kBypass:
+      // Only upstream calls are timed; replays would read as instant.
+      if ((flags & kFlagTunnelFrames) != 0) {
+        tunnel_latency_.Begin(id);
+      } else if (request->parse_ndjson) {
+        local_latency_.Begin(id);
+      }
+      client_.Submit(std::move(request));
+      break;
+  }
+  return true;
+}
+
+void HttpStreamService::OnPosted(uint64_t id) {
+  std::shared_ptr<const ResponseCache::Response> response;
+  {
+    std::lock_guard<std::mutex> lock(replay_mutex_);
+    std::shared_ptr<const ResponseCache::Response>* found = replays_.Find(id);
+    if (found == nullptr) {
+      // Cancelled before the worker got to it.
+      return;
+    }
+    response = std::move(*found);
+    replays_.Erase(id);
+  }
+  Replay(id, *response);
+}
+
+void HttpStreamService::Replay(uint64_t id,
+                               const ResponseCache::Response& response) {
+  OnResponseStarted(id, response.status_code, response.headers);
+  if (!response.body.empty()) {
+    OnBodyData(id, reinterpret_cast<const uint8_t*>(response.body.data()),
+               response.body.size());
+  }
+  OnComplete(id);
+}
+
+void HttpStreamService::ServeFollowers(ResponseCache::Outcome outcome) {
+  for (HttpRequest& follower : outcome.followers) {
+    if (outcome.response) {
+      Replay(follower.id, *outcome.response);
+    } else if (!outcome.error.empty()) {
+      OnError(follower.id, outcome.error);
+    } else {
+      // Too large to share; this one fetches its own.
+      client_.Submit(std::move(follower));
+    }
+  }
+}
+
+void HttpStreamService::Shutdown() {
+  client_.Stop();
+  embedder_.Stop();
+  embedder_started_ = false;
+  downloader_.Stop();
+  downloader_started_ = false;
+  mux_.Stop();
+  cache_.Clear();
+  started_ = false;
+  {
+    std::lock_guard<std::mutex> lock(tunnel_mutex_);
+    tunnel_streams_.Clear();
+  }
+  {
+    std::lock_guard<std::mutex> lock(markdown_mutex_);
+    markdown_lexers_.Clear();
+  }
+  {
+    std::lock_guard<std::mutex> lock(replay_mutex_);
+    replays_.Clear();
+  }
+  std::lock_guard<std::mutex> lock(ring_mutex_);
+  ring_requests_.Clear();
+  // The ring outlives the worker; the next Start brings a new one.
+  if (event_ring_) {
+    event_ring_->HandOffProducer();
+  }
+}
+
+void HttpStreamService::Emit(uint64_t id, std::vector<uint8_t> event,
+                             bool last) {
+  std::shared_ptr<SpscRing> ring;
+  {
+    std::lock_guard<std::mutex> lock(ring_mutex_);
+    std::shared_ptr<SpscRing>* found = ring_requests_.Find(id);
+    if (found != nullptr) {
+      ring = last ? std::move(*found) : *found;
+      if (last) {
+        ring_requests_.Erase(id);
+      }
+    }
+  }
+  if (!ring) {
+    sink_(std::move(event));
+    return;
+  }
+  ring->Write(event.data(), event.size());
+  buffer_pool_->Release(std::move(event));
+}
+
+std::vector<uint8_t> HttpStreamService::BeginEvent(uint8_t event,
+                                                   uint64_t id) const {
+  bool allocated;
+  std::vector<uint8_t> out = buffer_pool_->Acquire(&allocated);
+  if (allocated) {
+    LatencyMetrics::Get()->CountAllocations();
+  }
+  WireWriter writer(&out);
+  writer.WriteU8(event);
+  writer.WriteU64(id);
+  return out;
+}
+
+bool HttpStreamService::FindTunnelStream(
+    uint64_t id, std::shared_ptr<TunnelSession>* session,
+    std::string* correlation_id) {
+  std::lock_guard<std::mutex> lock(tunnel_mutex_);
+  const TunnelStream* stream = tunnel_streams_.Find(id);
+  if (stream == nullptr) {
+    return false;
+  }
+  *session = stream->session;
+  *correlation_id = stream->correlation_id;
+  return true;
+}
+
+std::vector<uint8_t> HttpStreamService::BeginTunnelEvent(
+    uint64_t id, TunnelSession* session, size_t* frame_start) const {
+  // The payload is written straight into the pooled event buffer behind the
+  // frame header and encrypted there; the frame is the rest of the event.
+  std::vector<uint8_t> event = BeginEvent(kEventFrame, id);
+  *frame_start = session->BeginFrame(&event);
+  // Relayed frames carry no message id of their own.
+  WireWriter(&event).WriteString(std::string());
+  return event;
+}
+
+bool HttpStreamService::FinishTunnelEvent(uint64_t id, uint8_t type,
+                                          size_t frame_start,
+                                          std::vector<uint8_t> event,
+                                          bool flow_controlled) {
+  return mux_.Enqueue(id, type, frame_start, std::move(event),
+                      flow_controlled);
+}
+
+bool HttpStreamService::EndTunnelStream(uint64_t id, const std::string* error,
+                                        std::vector<uint8_t>* final_event) {
+  std::shared_ptr<TunnelSession> session;
+  std::string& correlation_id = *CorrelationIdScratch();
+  if (!FindTunnelStream(id, &session, &correlation_id)) {
+    return false;
+  }
+  size_t start = 0;
+  std::vector<uint8_t> event = BeginTunnelEvent(id, session.get(), &start);
+  WireWriter writer(&event);
+  writer.WriteString(correlation_id);
+  writer.WriteU8(error != nullptr ? 1 : 0);
+  writer.WriteString(error != nullptr ? *error : std::string());
+  FinishTunnelEvent(id, kTunnelResponseEnd, start, std::move(event), false);
+  // Dart closes the relay on this, so it must not overtake the frames.
+  mux_.Finish(id, std::move(*final_event));
+
+  std::lock_guard<std::mutex> lock(tunnel_mutex_);
+  tunnel_streams_.Erase(id);
+  return true;
+}
+
+void HttpStreamService::OnResponseStarted(uint64_t id, int status_code,
+                                          HttpHeaderView headers) {
+  if (!cache_.OnStarted(id, status_code, headers)) {
+    return;
+  }
+  std::shared_ptr<TunnelSession> session;
+  std::string& correlation_id = *CorrelationIdScratch();
+  const bool tunnel = FindTunnelStream(id, &session, &correlation_id);
+
+  size_t start = 0;
+  std::vector<uint8_t> event =
+      tunnel ? BeginTunnelEvent(id, session.get(), &start)
+             : BeginEvent(kEventStarted, id);
+  WireWriter writer(&event);
+  writer.WriteU16(static_cast<uint16_t>(status_code));
+  if (tunnel) {
+    writer.WriteString(correlation_id);
+  }
+  writer.WriteU16(static_cast<uint16_t>(headers.size()));
+  for (const auto& header : headers) {
+    writer.WriteString(header.first);
+    writer.WriteString(header.second);
+  }
+
+  if (tunnel) {
+    FinishTunnelEvent(id, kTunnelResponseStart, start, std::move(event),
+                      false);
+  } else {
+    Emit(id, std::move(event));
+  }
+}
+
+void HttpStreamService::OnBodyData(uint64_t id, const uint8_t* data,
+                                   size_t size) {
+  if (!cache_.OnBody(id, data, size)) {
+    return;
+  }
+  std::shared_ptr<TunnelSession> session;
+  std::string& correlation_id = *CorrelationIdScratch();
+  if (!FindTunnelStream(id, &session, &correlation_id)) {
+    std::vector<uint8_t> event = BeginEvent(kEventBody, id);
+    WireWriter writer(&event);
+    writer.WriteBytes(data, size);
+    Emit(id, std::move(event));
+    return;
+  }
+  tunnel_latency_.Tokens(id, 1);
+
+  // Whatever arrived is forwarded now rather than held back to fill a
+  // chunk, so streamed tokens are not delayed.
+  bool room = true;
+  while (size > 0) {
+    const size_t chunk = std::min(size, kTunnelChunkSize);
+    size_t start = 0;
+    std::vector<uint8_t> event = BeginTunnelEvent(id, session.get(), &start);
+    WireWriter writer(&event);
+    writer.WriteString(correlation_id);
+    writer.WriteBytes(data, chunk);
+    room = FinishTunnelEvent(id, kTunnelResponseChunk, start,
+                             std::move(event), true);
+    data += chunk;
+    size -= chunk;
+  }
+
+  // Called here it takes effect before the next read, ahead of any resume
+  // the multiplexer reports for the same request.
+  if (!room) {
+    client_.SetPaused(id, true);
+  }
+}
+
+void HttpStreamService::OnTokenBatch(uint64_t id, const TokenBatch& batch) {
+  local_latency_.Tokens(id, batch.token_count());
+  if (!batch.text().empty()) {
+    std::vector<uint8_t> blocks;
+    {
+      std::lock_guard<std::mutex> lock(markdown_mutex_);
+      MarkdownLexer* lexer = markdown_lexers_.Find(id);
+      if (lexer != nullptr) {
+        lexer->Append(batch.text().data(), batch.text().size());
+        blocks = BeginEvent(kEventBlocks, id);
+        lexer->EncodeChanges(&blocks);
+      }
+    }
+    if (!blocks.empty()) {
+      Emit(id, std::move(blocks));
+    }
+  }
+  std::vector<uint8_t> event = BeginEvent(kEventTokens, id);
+  batch.Encode(&event);
+  Emit(id, std::move(event));
+}
+
+void HttpStreamService::OnComplete(uint64_t id) {
+  local_latency_.End(id);
+  tunnel_latency_.End(id);
+  {
+    std::lock_guard<std::mutex> lock(markdown_mutex_);
+    markdown_lexers_.Erase(id);
+  }
+  ResponseCache::Outcome outcome;
+  const bool led = cache_.Finish(id, nullptr, &outcome);
+  if (!outcome.muted) {
+    std::vector<uint8_t> event = BeginEvent(kEventComplete, id);
+    if (!EndTunnelStream(id, nullptr, &event)) {
+      Emit(id, std::move(event), true);
+    }
+  }
+  if (led) {
+    ServeFollowers(std::move(outcome));
+  }
+}
+
+void HttpStreamService::OnError(uint64_t id, const std::string& message) {
+  local_latency_.End(id);
+  tunnel_latency_.End(id);
+  {
+    std::lock_guard<std::mutex> lock(markdown_mutex_);
+    markdown_lexers_.Erase(id);
+  }
+  ResponseCache::Outcome outcome;
+  const bool led = cache_.Finish(id, &message, &outcome);
+  if (!outcome.muted) {
+    std::vector<uint8_t> event = BeginEvent(kEventError, id);
+    WireWriter writer(&event);
+    writer.WriteString(message);
+    if (!EndTunnelStream(id, &message, &event)) {
+      Emit(id, std::move(event), true);
+    }
+  }
+  if (led) {
+    ServeFollowers(std::move(outcome));
+  }
+}
+
+void HttpStreamService::OnEmbedProgress(uint64_t job_id, uint32_t embedded,
+                                        uint32_t chunked) {
+  std::vector<uint8_t> event = BeginEvent(kEventEmbedProgress, job_id);
+  WireWriter writer(&event);
+  writer.WriteU32(embedded);
+  writer.WriteU32(chunked);
+  sink_(std::move(event));
+}
+
+void HttpStreamService::OnEmbedComplete(uint64_t job_id,
+                                        EmbeddingBatcher::Result result) {
+  // The arena already holds the vectors behind room for this header; only
+  // the chunk table is appended.
+  std::vector<uint8_t> event = std::move(result.arena);
+  std::vector<uint8_t> header;
+  WireWriter header_writer(&header);
+  header_writer.WriteU8(kEventEmbeddings);
+  header_writer.WriteU64(job_id);
+  header_writer.WriteU32(result.dimensions);
+  header_writer.WriteU32(static_cast<uint32_t>(result.chunks.size()));
+  header.resize(kEmbeddingsOffset);
+  std::copy(header.begin(), header.end(), event.begin());
+
+  WireWriter writer(&event);
+  for (const EmbeddingBatcher::Chunk& chunk : result.chunks) {
+    writer.WriteU32(chunk.file);
+    writer.WriteU64(chunk.offset);
+    writer.WriteU32(chunk.length);
+  }
+  sink_(std::move(event));
+  sink_(BeginEvent(kEventComplete, job_id));
+}
+
+void HttpStreamService::OnEmbedError(uint64_t job_id,
+                                     const std::string& message) {
+  std::vector<uint8_t> event = BeginEvent(kEventError, job_id);
+  WireWriter writer(&event);
+  writer.WriteString(message);
+  sink_(std::move(event));
+}
+
+void HttpStreamService::OnDownloadProgress(
+    uint64_t job_id, const ModelDownloader::Progress& progress) {
+  std::vector<uint8_t> event = BeginEvent(kEventDownloadProgress, job_id);
+  WireWriter writer(&event);
+  writer.WriteU64(progress.completed);
+  writer.WriteU64(progress.total);
+  writer.WriteU64(progress.bytes_per_second);
+  writer.WriteString(progress.status);
+  sink_(std::move(event));
+}
+
+void HttpStreamService::OnDownloadComplete(uint64_t job_id) {
+  sink_(BeginEvent(kEventComplete, job_id));
+}
+
+void HttpStreamService::OnDownloadError(uint64_t job_id,
+                                        const std::string& message) {
+  std::vector<uint8_t> event = BeginEvent(kEventError, job_id);
+  WireWriter writer(&event);
+  writer.WriteString(message);
+  sink_(std::move(event));
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,338 @@
+#ifndef NATIVE_HTTP_STREAM_SERVICE_H_
+#define NATIVE_HTTP_STREAM_SERVICE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "native/embedding_batcher.h"
+#include "native/frame_buffer_pool.h"
+#include "native/http_stream_client.h"
+#include "native/latency_metrics.h"
+#include "native/markdown_lexer.h"
+#include "native/model_downloader.h"
+#include "native/recycling_map.h"
+#include "native/response_cache.h"
+#include "native/spsc_ring.h"
+#include "native/tunnel_frame.h"
+#include "native/tunnel_mux.h"
+#include "native/wire_format.h"
+
+namespace cloudtolocalllm {
+
+// Platform-neutral handler behind the "cloudtolocalllm/ollama_http" binary
+// channel. Requests arrive on the platform thread through HandleMessage;
+// progress is reported asynchronously as encoded events passed to the
+// EventSink, which the runner glue forwards to Dart on
+// "cloudtolocalllm/ollama_http/events".
+//
+// Requests are `u8 op, u64 request_id` followed by an op-specific payload:
+//
+//   kPing              (0)  no payload; replies with a single byte so Dart can
+//                           tell the native client is present
+//   kStart             (1)  string method, string host, u16 port, string path,
+//                           u16 header_count, header_count x (string name,
+//                           string value), u8 flags, string body; with
+//                           kFlagTunnelFrames also u64 tunnel stream handle,
+//                           string correlation id, u32 window, and
+//                           optionally u8 priority (TunnelMux::Priority,
+//                           kNormal if absent)
+//   kCancel            (2)  no payload
+//   kOpenTunnelStream  (3)  request_id is a handle; 32-byte session key,
+//                           string session id, and optionally u8 flags
+//                           (kTunnelFlagCompress)
+//   kCloseTunnelStream (4)  request_id is the handle
+//   kGrantCredit       (5)  u32 frames the cloud side has consumed
+//   kOpenEventRing     (6)  request_id is the doorbell tag; u32 capacity,
+//                           u64 address of an SpscRing::Doorbell; replies
+//                           with u64 addresses of the ring, its ReadSpan,
+//                           SpscRingRead, SpscRingConsume and SpscRingArm
+//   kEmbedFiles        (7)  string host, u16 port, string model, u32
+//                           chunk_size, u32 chunk_overlap, u32 batch_size
+//                           (0 for the defaults), u32 file_count,
+//                           file_count x string path
+//   kPullModel         (8)  string host, u16 port, string model
+//   kFetchFile         (9)  string host, u16 port, string path, string
+//                           destination file, u8 connections (0 for the
+//                           default)
+//
+// Events are `u8 event, u64 request_id` followed by:
+//
+//   kEventStarted  (1)  u16 status, u16 header_count, header pairs
+//   kEventBody     (2)  raw body bytes
+//   kEventTokens   (3)  a TokenBatch (see TokenBatch::Encode)
+//   kEventComplete (4)  nothing
+//   kEventError    (5)  string message
+//   kEventFrame    (6)  one sealed tunnel frame, ready to send as is
+//   kEventEmbedProgress (7)  u32 chunks embedded, u32 chunks found so far
+//   kEventEmbeddings    (8)  u32 dimensions, u32 chunk_count, 3 zero bytes
+//                            (the vectors start 20 bytes into the event),
+//                            chunk_count x dimensions native-endian f32,
+//                            then chunk_count x (u32 file index, u64 byte
+//                            offset, u32 byte length)
+//   kEventDownloadProgress (9)  u64 bytes completed, u64 total (0 while
+//                               unknown), u64 bytes per second, string
+//                               status
+//   kEventBlocks  (10)  the reply's changed markdown blocks (see
+//                       MarkdownLexer::EncodeChanges)
+//
+// Exactly one of kEventComplete or kEventError ends every started request
+// that is not cancelled. An embedding job's kEventEmbeddings comes just
+// before its kEventComplete.
+//
+// With kFlagMarkdown as well as kFlagParseNdjson, the reply's text is run
+// through a MarkdownLexer as its batches arrive, and every kEventTokens with
+// text follows a kEventBlocks with the blocks it changed, if any. A long
+// reply is thus split into paragraphs and code blocks once, on the worker
+// thread, rather than rescanned in Dart for every batch.
+//
+// With kFlagEventRing a request's events are written, in the same layout,
+// as records of the SpscRing opened by kOpenEventRing instead of being
+// passed to the EventSink. Dart reads them straight out of native memory
+// over FFI when the ring's doorbell fires, so a burst of token batches
+// costs one wakeup rather than a platform-thread hop per batch. Opening a
+// new ring (after a hot restart, say) detaches the old one's doorbell.
+//
+// With kFlagTunnelFrames the response is relayed to the cloud side without
+// passing through Dart as a message: status and headers, body chunks of at
+// most kTunnelChunkSize bytes, and the outcome are sealed on the worker
+// thread as httpResponseStart/Chunk/End frames (TunnelMessageType 8-10) on
+// the TunnelDirection::kDesktopToCloudStream lane and emitted as
+// kEventFrame. At most |window| chunk frames may be unacknowledged; past
+// that the socket is paused until kGrantCredit, so memory stays flat however
+// large the body is while the first bytes still leave as soon as they
+// arrive. Event buffers come from a FrameBufferPool and should be handed
+// back with RecycleEvent once sent.
+//
+// Relayed responses share the tunnel through a TunnelMux: frames are built
+// on the worker thread but sealed and emitted on the multiplexer's, in
+// priority order with a window for the whole connection as well, so a
+// model pull's body cannot hold back a chat's tokens or a health check.
+// Their kEventComplete or kEventError follows their last frame.
+//
+// GETs of /api/tags, /api/version and /api/ps go through a ResponseCache:
+// identical ones in flight together share one upstream call, and a 200 is
+// replayed from memory for a second or two after, so polling from the cloud
+// side and the desktop at once does not reach Ollama each time. Replayed
+// responses produce the same events, in whichever mode each request asked
+// for, and like all the others they are emitted on the worker thread.
+//
+// kEmbedFiles runs an EmbeddingBatcher job: the files are read, chunked and
+// embedded natively, and the vectors arrive as one kEventEmbeddings whose
+// buffer is the batcher's arena, so Dart can view them in place.
+//
+// kPullModel and kFetchFile run on a ModelDownloader: a pull's NDJSON is
+// parsed natively and its progress arrives as kEventDownloadProgress at most
+// ten times a second, and a fetch downloads a model file over parallel,
+// resumable ranged requests.
+//
+// Requests that reach Ollama are timed into LatencyMetrics: parsed token
+// streams as LatencyPath::kLocalOllama, relayed responses (their body
+// chunks standing in for tokens) as LatencyPath::kTunnel.
+//
+// A request is decoded into one recycled by the client, and its per-request
+// entries here, in the multiplexer and in the latency timers reuse the
+// nodes of finished ones, so once warmed up a request is decoded, sent and
+// its response framed without heap allocation. Where that falls short (a
+// new request object, event buffer or node, or a request's buffers having
+// to grow) it is counted in LatencyMetrics against the requests started.
+class HttpStreamService : public HttpStreamClient::Delegate,
+                          public EmbeddingBatcher::Delegate,
+                          public ModelDownloader::Delegate {
+ public:
+  static constexpr uint8_t kPing = 0;
+  static constexpr uint8_t kStart = 1;
+  static constexpr uint8_t kCancel = 2;
+  static constexpr uint8_t kOpenTunnelStream = 3;
+  static constexpr uint8_t kCloseTunnelStream = 4;
+  static constexpr uint8_t kGrantCredit = 5;
+  static constexpr uint8_t kOpenEventRing = 6;
+  static constexpr uint8_t kEmbedFiles = 7;
+  static constexpr uint8_t kPullModel = 8;
+  static constexpr uint8_t kFetchFile = 9;
+
+  static constexpr uint8_t kFlagParseNdjson = 1 << 0;
+  static constexpr uint8_t kFlagTunnelFrames = 1 << 1;
+  static constexpr uint8_t kFlagEventRing = 1 << 2;
+  static constexpr uint8_t kFlagMarkdown = 1 << 3;
+
+  // kOpenTunnelStream flag: compress the stream's frames (the cloud side
+  // advertised "lz4-dict-v1").
+  static constexpr uint8_t kTunnelFlagCompress = 1 << 0;
+
+  static constexpr uint8_t kEventStarted = 1;
+  static constexpr uint8_t kEventBody = 2;
+  static constexpr uint8_t kEventTokens = 3;
+  static constexpr uint8_t kEventComplete = 4;
+  static constexpr uint8_t kEventError = 5;
+  static constexpr uint8_t kEventFrame = 6;
+  static constexpr uint8_t kEventEmbedProgress = 7;
+  static constexpr uint8_t kEventEmbeddings = 8;
+  static constexpr uint8_t kEventDownloadProgress = 9;
+  static constexpr uint8_t kEventBlocks = 10;
+
+  // Where kEventEmbeddings' vectors start.
+  static constexpr size_t kEmbeddingsOffset = 20;
+
+  // Tunnel message types of the frames emitted in tunnel mode.
+  static constexpr uint8_t kTunnelResponseStart = 8;
+  static constexpr uint8_t kTunnelResponseChunk = 9;
+  static constexpr uint8_t kTunnelResponseEnd = 10;
+
+  static constexpr size_t kTunnelChunkSize = 16 * 1024;
+  static constexpr uint32_t kDefaultTunnelWindow = 8;
+
+  // Invoked on the client's worker thread with each encoded event. The glue
+  // is expected to post it to the platform thread before sending.
+  using EventSink = std::function<void(std::vector<uint8_t> event)>;
+
+  explicit HttpStreamService(EventSink sink);
+  ~HttpStreamService() override;
+
+  // Prevent copying.
+  HttpStreamService(HttpStreamService const&) = delete;
+  HttpStreamService& operator=(HttpStreamService const&) = delete;
+
+  void HandleMessage(const uint8_t* message, size_t size,
+                     std::vector<uint8_t>* reply);
+
+  // Stops the worker thread; no events are emitted afterwards.
+  void Shutdown();
+
+  // Returns a sent event's buffer to the pool. May be called from any
+  // thread.
+  void RecycleEvent(std::vector<uint8_t> event) {
+    buffer_pool_->Release(std::move(event));
+  }
+
+  // The pool event buffers are drawn from, for glue that releases buffers
+  // after the service may be gone.
+  std::shared_ptr<FrameBufferPool> buffer_pool() const { return buffer_pool_; }
+
+  HttpStreamClient::Stats stats() const { return client_.stats(); }
+  TunnelMux::Stats tunnel_stats() const { return mux_.stats(); }
+  ResponseCache::Stats cache_stats() const { return cache_.stats(); }
+  EmbeddingBatcher::Stats embedding_stats() const {
+    return embedder_.stats();
+  }
+  ModelDownloader::Stats download_stats() const {
+    return downloader_.stats();
+  }
+
+  // HttpStreamClient::Delegate:
+  void OnResponseStarted(uint64_t id, int status_code,
+                         HttpHeaderView headers) override;
+  void OnBodyData(uint64_t id, const uint8_t* data, size_t size) override;
+  void OnTokenBatch(uint64_t id, const TokenBatch& batch) override;
+  void OnComplete(uint64_t id) override;
+  void OnError(uint64_t id, const std::string& message) override;
+  void OnPosted(uint64_t id) override;
+
+  // EmbeddingBatcher::Delegate:
+  void OnEmbedProgress(uint64_t job_id, uint32_t embedded,
+                       uint32_t chunked) override;
+  void OnEmbedComplete(uint64_t job_id,
+                       EmbeddingBatcher::Result result) override;
+  void OnEmbedError(uint64_t job_id, const std::string& message) override;
+
+  // ModelDownloader::Delegate:
+  void OnDownloadProgress(uint64_t job_id,
+                          const ModelDownloader::Progress& progress) override;
+  void OnDownloadComplete(uint64_t job_id) override;
+  void OnDownloadError(uint64_t job_id, const std::string& message) override;
+
+ private:
+  // Per-request state for responses relayed as tunnel frames; their credit
+  // is kept by |mux_|.
+  struct TunnelStream {
+    std::shared_ptr<TunnelSession> session;
+    std::string correlation_id;
+  };
+
+  // Drops a finished stream's session, keeping its correlation id's buffer.
+  struct ResetTunnelStream {
+    void operator()(TunnelStream* stream) const {
+      stream->session.reset();
+      stream->correlation_id.clear();
+    }
+  };
+
+  // Starts a finished request's lexer afresh, keeping its buffers.
+  struct ResetMarkdownLexer {
+    void operator()(MarkdownLexer* lexer) const { lexer->Reset(); }
+  };
+
+  bool StartRequest(uint64_t id, WireReader* reader);
+  bool StartEmbedding(uint64_t id, WireReader* reader);
+  bool StartDownload(uint8_t op, uint64_t id, WireReader* reader);
+  // Emits |response| for request |id| as if it had just been received.
+  // Worker thread only, like every other delegate callback.
+  void Replay(uint64_t id, const ResponseCache::Response& response);
+  // Answers the followers of a flight that has ended.
+  void ServeFollowers(ResponseCache::Outcome outcome);
+  std::vector<uint8_t> BeginEvent(uint8_t event, uint64_t id) const;
+  // Looks up the tunnel stream for |id|; the returned session stays valid
+  // after the lock is released.
+  bool FindTunnelStream(uint64_t id, std::shared_ptr<TunnelSession>* session,
+                        std::string* correlation_id);
+  // A kEventFrame event with the frame header reserved and the payload's
+  // (empty) message id written; the caller appends the rest of the payload.
+  std::vector<uint8_t> BeginTunnelEvent(uint64_t id, TunnelSession* session,
+                                        size_t* frame_start) const;
+  // Queues the event on the multiplexer to be sealed as |type|; false when
+  // the stream should pause.
+  bool FinishTunnelEvent(uint64_t id, uint8_t type, size_t frame_start,
+                         std::vector<uint8_t> event, bool flow_controlled);
+  // Queues the httpResponseEnd frame and |final_event| behind it; false if
+  // |id| is not relayed.
+  bool EndTunnelStream(uint64_t id, const std::string* error,
+                       std::vector<uint8_t>* final_event);
+  // Delivers an event through the request's ring, or the sink if it has
+  // none; |last| ends the request's use of the ring.
+  void Emit(uint64_t id, std::vector<uint8_t> event, bool last = false);
+
+  EventSink sink_;
+  std::shared_ptr<FrameBufferPool> buffer_pool_;
+  TunnelMux mux_;
+  ResponseCache cache_;
+  HttpStreamClient client_;
+  // Started with the first embedding job; it has threads of its own.
+  EmbeddingBatcher embedder_;
+  // Started with the first pull or fetch.
+  ModelDownloader downloader_;
+  bool started_;
+  bool embedder_started_;
+  bool downloader_started_;
+  StreamLatencyTimer local_latency_;
+  StreamLatencyTimer tunnel_latency_;
+
+  // Shared between the platform thread (requests) and the worker thread
+  // (delegate callbacks).
+  std::mutex tunnel_mutex_;
+  std::unordered_map<uint64_t, std::shared_ptr<TunnelSession>> tunnel_lanes_;
+  RecyclingMap<uint64_t, TunnelStream, ResetTunnelStream> tunnel_streams_;
+
+  // The worker thread is the rings' only producer.
+  std::mutex ring_mutex_;
+  std::shared_ptr<SpscRing> event_ring_;
+  RecyclingMap<uint64_t, std::shared_ptr<SpscRing>> ring_requests_;
+
+  // Cached responses of requests that hit, until the worker replays them.
+  std::mutex replay_mutex_;
+  RecyclingMap<uint64_t, std::shared_ptr<const ResponseCache::Response>>
+      replays_;
+
+  // Lexers of kFlagMarkdown requests, fed on the worker thread.
+  std::mutex markdown_mutex_;
+  RecyclingMap<uint64_t, MarkdownLexer, ResetMarkdownLexer> markdown_lexers_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_HTTP_STREAM_SERVICE_H_
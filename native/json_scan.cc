@@ -0,0 +1,311 @@
+#include "native/json_scan.h"
+
+#include <cmath>
+
+#include "native/byte_scan.h"
+
+namespace cloudtolocalllm {
+namespace json {
+
+namespace {
+
+int HexValue(uint8_t c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// Reads the four hex digits of a \u escape starting at |p|.
+bool ReadHex4(const uint8_t* p, const uint8_t* end, uint32_t* value) {
+  if (end - p < 4) {
+    return false;
+  }
+  uint32_t result = 0;
+  for (int i = 0; i < 4; i++) {
+    int digit = HexValue(p[i]);
+    if (digit < 0) {
+      return false;
+    }
+    result = (result << 4) | static_cast<uint32_t>(digit);
+  }
+  *value = result;
+  return true;
+}
+
+void AppendUtf8(uint32_t code_point, std::string* out) {
+  if (code_point < 0x80) {
+    out->push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    out->push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else if (code_point < 0x10000) {
+    out->push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else {
+    out->push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  }
+}
+
+bool IsNumberByte(uint8_t c) {
+  return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ||
+         c == 'e' || c == 'E';
+}
+
+}  // namespace
+
+const uint8_t* SkipWhitespace(const uint8_t* p, const uint8_t* end) {
+  if (p == nullptr) {
+    return nullptr;
+  }
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+    ++p;
+  }
+  return p;
+}
+
+const uint8_t* ParseString(const uint8_t* p, const uint8_t* end,
+                           std::string* out) {
+  if (p == nullptr || p == end || *p != '"') {
+    return nullptr;
+  }
+  ++p;
+  while (p < end) {
+    const uint8_t* stop = FindEitherByte(p, end, '"', '\\');
+    if (out != nullptr) {
+      out->append(reinterpret_cast<const char*>(p),
+                  static_cast<size_t>(stop - p));
+    }
+    if (stop == end) {
+      return nullptr;
+    }
+    if (*stop == '"') {
+      return stop + 1;
+    }
+    // Escape sequence.
+    p = stop + 1;
+    if (p == end) {
+      return nullptr;
+    }
+    uint8_t escape = *p++;
+    char decoded = 0;
+    switch (escape) {
+      case '"':
+      case '\\':
+      case '/':
+        decoded = static_cast<char>(escape);
+        break;
+      case 'b':
+        decoded = '\b';
+        break;
+      case 'f':
+        decoded = '\f';
+        break;
+      case 'n':
+        decoded = '\n';
+        break;
+      case 'r':
+        decoded = '\r';
+        break;
+      case 't':
+        decoded = '\t';
+        break;
+      case 'u': {
+        uint32_t code_point;
+        if (!ReadHex4(p, end, &code_point)) {
+          return nullptr;
+        }
+        p += 4;
+        if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+          // High surrogate; a low surrogate escape should follow.
+          uint32_t low;
+          if (end - p >= 6 && p[0] == '\\' && p[1] == 'u' &&
+              ReadHex4(p + 2, end, &low) && low >= 0xDC00 && low <= 0xDFFF) {
+            code_point = 0x10000 + ((code_point - 0xD800) << 10) +
+                         (low - 0xDC00);
+            p += 6;
+          } else {
+            code_point = 0xFFFD;
+          }
+        } else if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+          code_point = 0xFFFD;
+        }
+        if (out != nullptr) {
+          AppendUtf8(code_point, out);
+        }
+        continue;
+      }
+      default:
+        return nullptr;
+    }
+    if (out != nullptr) {
+      out->push_back(decoded);
+    }
+  }
+  return nullptr;
+}
+
+const uint8_t* SkipValue(const uint8_t* p, const uint8_t* end) {
+  p = SkipWhitespace(p, end);
+  if (p == nullptr || p == end) {
+    return nullptr;
+  }
+  switch (*p) {
+    case '"':
+      return ParseString(p, end, nullptr);
+    case '{':
+    case '[': {
+      int depth = 0;
+      while (p < end) {
+        uint8_t c = *p;
+        if (c == '"') {
+          p = ParseString(p, end, nullptr);
+          if (p == nullptr) {
+            return nullptr;
+          }
+          continue;
+        }
+        if (c == '{' || c == '[') {
+          ++depth;
+        } else if (c == '}' || c == ']') {
+          if (--depth == 0) {
+            return p + 1;
+          }
+        }
+        ++p;
+      }
+      return nullptr;
+    }
+    case 't':
+      return (end - p >= 4 && std::memcmp(p, "true", 4) == 0) ? p + 4
+                                                              : nullptr;
+    case 'f':
+      return (end - p >= 5 && std::memcmp(p, "false", 5) == 0) ? p + 5
+                                                               : nullptr;
+    case 'n':
+      return (end - p >= 4 && std::memcmp(p, "null", 4) == 0) ? p + 4
+                                                              : nullptr;
+    default: {
+      const uint8_t* start = p;
+      while (p < end && IsNumberByte(*p)) {
+        ++p;
+      }
+      return p == start ? nullptr : p;
+    }
+  }
+}
+
+const uint8_t* ParseInt64(const uint8_t* p, const uint8_t* end,
+                          int64_t* value) {
+  p = SkipWhitespace(p, end);
+  if (p == nullptr || p == end) {
+    return nullptr;
+  }
+  bool negative = false;
+  if (*p == '-') {
+    negative = true;
+    ++p;
+  }
+  if (p == end || *p < '0' || *p > '9') {
+    return nullptr;
+  }
+  uint64_t result = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    result = result * 10 + static_cast<uint64_t>(*p - '0');
+    ++p;
+  }
+  // Skip any fraction or exponent; Ollama's counters and durations are
+  // integral, but this keeps a stray "1.0" from failing the whole line.
+  while (p < end && IsNumberByte(*p)) {
+    ++p;
+  }
+  *value = negative ? -static_cast<int64_t>(result)
+                    : static_cast<int64_t>(result);
+  return p;
+}
+
+const uint8_t* ParseDouble(const uint8_t* p, const uint8_t* end,
+                           double* value) {
+  // Parsed by hand rather than with strtod, which honours the process locale
+  // and GTK sets that from the environment (a decimal comma breaks strtod).
+  p = SkipWhitespace(p, end);
+  if (p == nullptr || p == end) {
+    return nullptr;
+  }
+  bool negative = false;
+  if (*p == '-') {
+    negative = true;
+    ++p;
+  }
+  uint64_t mantissa = 0;
+  int exponent = 0;
+  int digits = 0;
+  for (; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+    if (mantissa < 100000000000000000ULL) {
+      mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+    } else {
+      ++exponent;
+    }
+  }
+  if (p < end && *p == '.') {
+    for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+      if (mantissa < 100000000000000000ULL) {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+        --exponent;
+      }
+    }
+  }
+  if (digits == 0) {
+    return nullptr;
+  }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    ++p;
+    bool negative_exponent = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+      negative_exponent = *p == '-';
+      ++p;
+    }
+    int explicit_exponent = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+      if (explicit_exponent < 10000) {
+        explicit_exponent = explicit_exponent * 10 + (*p - '0');
+      }
+    }
+    exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+  }
+  double result = static_cast<double>(mantissa);
+  if (exponent != 0) {
+    result *= std::pow(10.0, exponent);
+  }
+  *value = negative ? -result : result;
+  return p;
+}
+
+const uint8_t* ParseBool(const uint8_t* p, const uint8_t* end, bool* value) {
+  p = SkipWhitespace(p, end);
+  if (p == nullptr || p == end) {
+    return nullptr;
+  }
+  if (end - p >= 4 && std::memcmp(p, "true", 4) == 0) {
+    *value = true;
+    return p + 4;
+  }
+  if (end - p >= 5 && std::memcmp(p, "false", 5) == 0) {
+    *value = false;
+    return p + 5;
+  }
+  return nullptr;
+}
+
+}  // namespace json
+}  // namespace cloudtolocalllm
@@ -0,0 +1,132 @@
+#ifndef NATIVE_JSON_SCAN_H_
+#define NATIVE_JSON_SCAN_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace cloudtolocalllm {
+namespace json {
+
+// A minimal, allocation-free JSON cursor for pulling a handful of known
+// fields out of Ollama's responses. It never builds a DOM: callers walk an
+// object with ScanObject and either consume or skip each member's value.
+//
+// Every function takes the current position and the end of the input and
+// returns the position just past what it consumed, or nullptr if the input
+// is malformed or truncated.
+
+const uint8_t* SkipWhitespace(const uint8_t* p, const uint8_t* end);
+
+// Skips any JSON value, including nested objects and arrays.
+const uint8_t* SkipValue(const uint8_t* p, const uint8_t* end);
+
+// Parses a string starting at the opening quote. When |out| is non-null the
+// unescaped UTF-8 is appended to it; otherwise the string is only skipped.
+const uint8_t* ParseString(const uint8_t* p, const uint8_t* end,
+                           std::string* out);
+
+// Parses a JSON number as a signed 64-bit integer, truncating any fraction.
+const uint8_t* ParseInt64(const uint8_t* p, const uint8_t* end,
+                          int64_t* value);
+
+// Parses a JSON number as a double.
+const uint8_t* ParseDouble(const uint8_t* p, const uint8_t* end,
+                           double* value);
+
+// Parses `true` or `false`.
+const uint8_t* ParseBool(const uint8_t* p, const uint8_t* end, bool* value);
+
+// Returns true if the raw (still escaped) key bytes equal |literal|. Ollama's
+// keys never contain escapes, so a byte comparison is sufficient.
+inline bool KeyEquals(const uint8_t* key, size_t length, const char* literal) {
+  size_t literal_length = std::strlen(literal);
+  return length == literal_length &&
+         std::memcmp(key, literal, literal_length) == 0;
+}
+
+// Walks the members of the object starting at |p| (which must point at '{').
+// For each member |on_member(key, key_length, value)| is called with |value|
+// pointing at the first byte of the member's value; it must return the
+// position after the value (use SkipValue for members it does not need), or
+// nullptr to abort.
+template <typename OnMember>
+const uint8_t* ScanObject(const uint8_t* p, const uint8_t* end,
+                          OnMember&& on_member) {
+  p = SkipWhitespace(p, end);
+  if (p == nullptr || p == end || *p != '{') {
+    return nullptr;
+  }
+  p = SkipWhitespace(p + 1, end);
+  if (p != nullptr && p != end && *p == '}') {
+    return p + 1;
+  }
+  while (p != nullptr && p != end) {
+    if (*p != '"') {
+      return nullptr;
+    }
+    const uint8_t* key = p + 1;
+    p = ParseString(p, end, nullptr);
+    if (p == nullptr) {
+      return nullptr;
+    }
+    size_t key_length = static_cast<size_t>(p - 1 - key);
+    p = SkipWhitespace(p, end);
+    if (p == nullptr || p == end || *p != ':') {
+      return nullptr;
+    }
+    p = SkipWhitespace(p + 1, end);
+    if (p == nullptr || p == end) {
+      return nullptr;
+    }
+    p = on_member(key, key_length, p);
+    p = SkipWhitespace(p, end);
+    if (p == nullptr || p == end) {
+      return nullptr;
+    }
+    if (*p == '}') {
+      return p + 1;
+    }
+    if (*p != ',') {
+      return nullptr;
+    }
+    p = SkipWhitespace(p + 1, end);
+  }
+  return nullptr;
+}
+
+// Walks the elements of the array starting at |p| (which must point at '[').
+// |on_element(value)| follows the same contract as ScanObject's callback.
+template <typename OnElement>
+const uint8_t* ScanArray(const uint8_t* p, const uint8_t* end,
+                         OnElement&& on_element) {
+  p = SkipWhitespace(p, end);
+  if (p == nullptr || p == end || *p != '[') {
+    return nullptr;
+  }
+  p = SkipWhitespace(p + 1, end);
+  if (p != nullptr && p != end && *p == ']') {
+    return p + 1;
+  }
+  while (p != nullptr && p != end) {
+    p = on_element(p);
+    p = SkipWhitespace(p, end);
+    if (p == nullptr || p == end) {
+      return nullptr;
+    }
+    if (*p == ']') {
+      return p + 1;
+    }
+    if (*p != ',') {
+      return nullptr;
+    }
+    p = SkipWhitespace(p + 1, end);
+  }
+  return nullptr;
+}
+
+}  // namespace json
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_JSON_SCAN_H_
@@ -0,0 +1,106 @@
+#include "native/latency_histogram.h"
+
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace cloudtolocalllm {
+
+namespace {
+
+// Index of the highest set bit of a non-zero |value|.
+inline int HighestBit(uint64_t value) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return static_cast<int>(index);
+#else
+  return 63 - __builtin_clzll(value);
+#endif
+}
+
+}  // namespace
+
+LatencyHistogram::LatencyHistogram() : total_(0), max_(0) {
+  for (std::atomic<uint64_t>& count : counts_) {
+    count.store(0, std::memory_order_relaxed);
+  }
+}
+
+size_t LatencyHistogram::BucketIndex(uint64_t value) {
+  if (value < 2 * kSubBuckets) {
+    return static_cast<size_t>(value);
+  }
+  if (value >= kMaxValue) {
+    return kBucketCount - 1;
+  }
+  // Shifted right by |shift| the value is in [kSubBuckets, 2 * kSubBuckets).
+  const int shift = HighestBit(value) - kSubBucketBits;
+  return static_cast<size_t>(kSubBuckets * (shift + 1) +
+                             ((value >> shift) - kSubBuckets));
+}
+
+uint64_t LatencyHistogram::BucketHighest(size_t index) {
+  if (index < 2 * kSubBuckets) {
+    return index;
+  }
+  const int shift = static_cast<int>(index / kSubBuckets) - 1;
+  const uint64_t sub = index % kSubBuckets + kSubBuckets;
+  return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t value, uint64_t count) {
+  if (count == 0) {
+    return;
+  }
+  counts_[BucketIndex(value)].fetch_add(count, std::memory_order_relaxed);
+  total_.fetch_add(count, std::memory_order_relaxed);
+  uint64_t max = max_.load(std::memory_order_relaxed);
+  while (value > max && !max_.compare_exchange_weak(
+                            max, value, std::memory_order_relaxed)) {
+  }
+}
+
+LatencyHistogram::Summary LatencyHistogram::Summarize() const {
+  Summary summary;
+  uint64_t counts[kBucketCount];
+  for (size_t i = 0; i < kBucketCount; i++) {
+    counts[i] = counts_[i].load(std::memory_order_relaxed);
+    summary.count += counts[i];
+  }
+  if (summary.count == 0) {
+    return summary;
+  }
+  summary.max = max_.load(std::memory_order_relaxed);
+
+  // The value at quantile q is the first bucket by which ceil(q * count)
+  // values have been seen.
+  const double quantiles[] = {0.5, 0.9, 0.99};
+  uint64_t* results[] = {&summary.p50, &summary.p90, &summary.p99};
+  size_t next = 0;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBucketCount && next < 3; i++) {
+    seen += counts[i];
+    while (next < 3 &&
+           static_cast<double>(seen) >=
+               quantiles[next] * static_cast<double>(summary.count)) {
+      // A bucket's upper bound may be past anything actually recorded.
+      *results[next++] = std::min(BucketHighest(i), summary.max);
+    }
+  }
+  return summary;
+}
+
+void LatencyHistogram::NonEmptyBuckets(
+    std::vector<std::pair<uint16_t, uint64_t>>* out) const {
+  for (size_t i = 0; i < kBucketCount; i++) {
+    const uint64_t count = counts_[i].load(std::memory_order_relaxed);
+    if (count > 0) {
+      out->emplace_back(static_cast<uint16_t>(i), count);
+    }
+  }
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,72 @@
+#ifndef NATIVE_LATENCY_HISTOGRAM_H_
+#define NATIVE_LATENCY_HISTOGRAM_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace cloudtolocalllm {
+
+// A log-linear histogram of latencies in microseconds, laid out like
+// HdrHistogram with two significant digits: values below 2 * kSubBuckets
+// get a bucket each, and every power of two above is split into
+// kSubBuckets buckets, so a recorded value is off by less than 1/kSubBuckets
+// (1.6%) from its bucket's bounds. Values of kMaxValue and up share the last
+// bucket.
+//
+// Recording is a couple of relaxed atomic adds and never blocks, so it can
+// sit on the HTTP worker and codec paths. Reads walk a racy copy of the
+// counts: a summary taken while values are recorded may miss the newest of
+// them, which is fine for monitoring. The bucket layout is fixed, so counts
+// from different histograms (or processes, see streaming-proxy/) add up to
+// the histogram of all their values.
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 6;
+  static constexpr uint64_t kSubBuckets = uint64_t{1} << kSubBucketBits;
+  // The largest power-of-two range split into buckets.
+  static constexpr int kMaxShift = 29;
+  static constexpr size_t kBucketCount = kSubBuckets * (kMaxShift + 2);
+  // 2^36 us, about 19 hours.
+  static constexpr uint64_t kMaxValue = (2 * kSubBuckets) << kMaxShift;
+
+  struct Summary {
+    uint64_t count = 0;
+    uint64_t p50 = 0;
+    uint64_t p90 = 0;
+    uint64_t p99 = 0;
+    uint64_t max = 0;
+  };
+
+  LatencyHistogram();
+
+  // Prevent copying.
+  LatencyHistogram(LatencyHistogram const&) = delete;
+  LatencyHistogram& operator=(LatencyHistogram const&) = delete;
+
+  static size_t BucketIndex(uint64_t value);
+  // The largest value that lands in bucket |index|.
+  static uint64_t BucketHighest(size_t index);
+
+  // Records |count| occurrences of |value|.
+  void Record(uint64_t value, uint64_t count = 1);
+
+  uint64_t count() const { return total_.load(std::memory_order_relaxed); }
+
+  Summary Summarize() const;
+
+  // Appends (bucket index, count) for every non-empty bucket, in index
+  // order.
+  void NonEmptyBuckets(std::vector<std::pair<uint16_t, uint64_t>>* out) const;
+
+ private:
+  std::atomic<uint64_t> counts_[kBucketCount];
+  std::atomic<uint64_t> total_;
+  std::atomic<uint64_t> max_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_LATENCY_HISTOGRAM_H_
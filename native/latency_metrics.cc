@@ -0,0 +1,60 @@
+#include "native/latency_metrics.h"
+
+namespace cloudtolocalllm {
+
+LatencyMetrics* LatencyMetrics::Get() {
+  static LatencyMetrics* metrics = new LatencyMetrics();
+  return metrics;
+}
+
+StreamLatencyTimer::StreamLatencyTimer(LatencyPath path) : path_(path) {}
+
+StreamLatencyTimer::~StreamLatencyTimer() = default;
+
+void StreamLatencyTimer::Begin(uint64_t id) {
+  bool allocated;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    streams_.Insert(id, &allocated).last = Clock::now();
+  }
+  if (allocated) {
+    LatencyMetrics::Get()->CountAllocations();
+  }
+}
+
+void StreamLatencyTimer::Tokens(uint64_t id, uint32_t tokens) {
+  if (tokens == 0) {
+    return;
+  }
+  const Clock::time_point now = Clock::now();
+  uint64_t micros;
+  bool first;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stream* stream = streams_.Find(id);
+    if (stream == nullptr) {
+      return;
+    }
+    micros = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(now -
+                                                              stream->last)
+            .count());
+    first = !stream->started;
+    stream->started = true;
+    stream->last = now;
+  }
+  LatencyMetrics* metrics = LatencyMetrics::Get();
+  if (first) {
+    // The gaps between any more tokens in the first batch are unknown.
+    metrics->Record(path_, LatencyKind::kTimeToFirstToken, micros);
+  } else {
+    metrics->Record(path_, LatencyKind::kInterToken, micros / tokens, tokens);
+  }
+}
+
+void StreamLatencyTimer::End(uint64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  streams_.Erase(id);
+}
+
+}  // namespace cloudtolocalllm
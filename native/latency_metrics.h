@@ -0,0 +1,117 @@
+#ifndef NATIVE_LATENCY_METRICS_H_
+#define NATIVE_LATENCY_METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "native/latency_histogram.h"
+#include "native/recycling_map.h"
+
+namespace cloudtolocalllm {
+
+// How a reply reached the user.
+enum class LatencyPath : uint8_t {
+  // Straight from the local Ollama (HttpStreamService, token parsing on).
+  kLocalOllama = 0,
+  // Relayed to the cloud side over the encrypted tunnel.
+  kTunnel = 1,
+  // From the cloud proxy (CloudStreamingService, recorded from Dart).
+  kCloudStreaming = 2,
+};
+
+enum class LatencyKind : uint8_t {
+  // Request sent to first token (first body chunk when relayed).
+  kTimeToFirstToken = 0,
+  // Between tokens, each batch's gap spread over the tokens in it.
+  kInterToken = 1,
+  // Ping to pong.
+  kRoundTrip = 2,
+  // A model warm-up's load, which the next first token no longer waits for
+  // (ModelWarmup).
+  kWarmupSaved = 3,
+};
+
+// The process-wide latency histograms, one per LatencyPath and
+// LatencyKind, recorded in microseconds. Every method is lock-free, so the
+// paths feed it directly; the tray and the cloud proxy's /metrics read
+// percentiles off it through LatencyMetricsService.
+//
+// It also counts the requests HttpStreamService starts and the heap
+// allocations their path makes where its recycled requests, event buffers
+// and map nodes fall short, so the tray can show that a warmed-up app
+// proxies without allocating.
+class LatencyMetrics {
+ public:
+  static constexpr size_t kPathCount = 3;
+  static constexpr size_t kKindCount = 4;
+
+  static LatencyMetrics* Get();
+
+  // Prevent copying.
+  LatencyMetrics(LatencyMetrics const&) = delete;
+  LatencyMetrics& operator=(LatencyMetrics const&) = delete;
+
+  void Record(LatencyPath path, LatencyKind kind, uint64_t micros,
+              uint64_t count = 1) {
+    histogram(path, kind).Record(micros, count);
+  }
+
+  LatencyHistogram& histogram(LatencyPath path, LatencyKind kind) {
+    return histograms_[static_cast<size_t>(path)][static_cast<size_t>(kind)];
+  }
+
+  void CountRequest() { requests_.fetch_add(1, std::memory_order_relaxed); }
+  void CountAllocations(uint64_t count = 1) {
+    allocations_.fetch_add(count, std::memory_order_relaxed);
+  }
+  uint64_t requests() const {
+    return requests_.load(std::memory_order_relaxed);
+  }
+  uint64_t allocations() const {
+    return allocations_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  LatencyMetrics() = default;
+
+  LatencyHistogram histograms_[kPathCount][kKindCount];
+  std::atomic<uint64_t> requests_{0};
+  std::atomic<uint64_t> allocations_{0};
+};
+
+// Times streamed replies on one path for LatencyMetrics: the wait from
+// Begin to the first Tokens, then the gaps between later ones. Thread-safe,
+// so requests can begin on the platform thread and stream on a worker.
+class StreamLatencyTimer {
+ public:
+  explicit StreamLatencyTimer(LatencyPath path);
+  ~StreamLatencyTimer();
+
+  // Prevent copying.
+  StreamLatencyTimer(StreamLatencyTimer const&) = delete;
+  StreamLatencyTimer& operator=(StreamLatencyTimer const&) = delete;
+
+  void Begin(uint64_t id);
+  // |tokens| arrived for |id| just now. Ignored unless |id| has begun.
+  void Tokens(uint64_t id, uint32_t tokens);
+  void End(uint64_t id);
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Stream {
+    Clock::time_point last;
+    bool started = false;
+  };
+
+  const LatencyPath path_;
+  std::mutex mutex_;
+  RecyclingMap<uint64_t, Stream> streams_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_LATENCY_METRICS_H_
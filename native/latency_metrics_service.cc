@@ -0,0 +1,94 @@
+#include "native/latency_metrics_service.h"
+
+namespace cloudtolocalllm {
+
+LatencyMetricsService::LatencyMetricsService() = default;
+
+LatencyMetricsService::~LatencyMetricsService() = default;
+
+void LatencyMetricsService::HandleMessage(const uint8_t* message, size_t size,
+                                          std::vector<uint8_t>* reply) {
+  reply->clear();
+
+  WireReader reader(message, size);
+  uint8_t op;
+  if (!reader.ReadU8(&op)) {
+    return;
+  }
+  if (!Handle(op, &reader, reply)) {
+    reply->clear();
+  } else if (reply->empty()) {
+    reply->push_back(1);
+  }
+}
+
+bool LatencyMetricsService::Handle(uint8_t op, WireReader* reader,
+                                   std::vector<uint8_t>* reply) {
+  LatencyMetrics* metrics = LatencyMetrics::Get();
+  WireWriter writer(reply);
+  switch (op) {
+    case kSummary:
+    case kBuckets: {
+      // The count is patched in once the empty histograms are skipped.
+      writer.WriteU8(0);
+      uint8_t written = 0;
+      for (size_t path = 0; path < LatencyMetrics::kPathCount; path++) {
+        for (size_t kind = 0; kind < LatencyMetrics::kKindCount; kind++) {
+          const LatencyHistogram& histogram =
+              metrics->histogram(static_cast<LatencyPath>(path),
+                                 static_cast<LatencyKind>(kind));
+          if (histogram.count() == 0) {
+            continue;
+          }
+          written++;
+          writer.WriteU8(static_cast<uint8_t>(path));
+          writer.WriteU8(static_cast<uint8_t>(kind));
+          if (op == kSummary) {
+            const LatencyHistogram::Summary summary = histogram.Summarize();
+            writer.WriteU64(summary.count);
+            writer.WriteU64(summary.p50);
+            writer.WriteU64(summary.p90);
+            writer.WriteU64(summary.p99);
+            writer.WriteU64(summary.max);
+          } else {
+            buckets_.clear();
+            histogram.NonEmptyBuckets(&buckets_);
+            writer.WriteU16(static_cast<uint16_t>(buckets_.size()));
+            for (const auto& bucket : buckets_) {
+              writer.WriteU16(bucket.first);
+              writer.WriteU64(bucket.second);
+            }
+          }
+        }
+      }
+      (*reply)[0] = written;
+      return true;
+    }
+    case kRecord: {
+      uint8_t path;
+      uint8_t kind;
+      uint32_t count;
+      if (!reader->ReadU8(&path) || !reader->ReadU8(&kind) ||
+          !reader->ReadU32(&count) || path >= LatencyMetrics::kPathCount ||
+          kind >= LatencyMetrics::kKindCount ||
+          count > reader->remaining() / 4) {
+        return false;
+      }
+      for (uint32_t i = 0; i < count; i++) {
+        uint32_t micros = 0;
+        reader->ReadU32(&micros);
+        metrics->Record(static_cast<LatencyPath>(path),
+                        static_cast<LatencyKind>(kind), micros);
+      }
+      return true;
+    }
+    case kAllocations:
+      writer.WriteU64(metrics->requests());
+      writer.WriteU64(metrics->allocations());
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace cloudtolocalllm
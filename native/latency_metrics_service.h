@@ -0,0 +1,55 @@
+#ifndef NATIVE_LATENCY_METRICS_SERVICE_H_
+#define NATIVE_LATENCY_METRICS_SERVICE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "native/latency_metrics.h"
+#include "native/wire_format.h"
+
+namespace cloudtolocalllm {
+
+// Platform-neutral handler behind the "cloudtolocalllm/latency_metrics"
+// binary channel, which reads and feeds the process-wide LatencyMetrics.
+//
+// Requests are `u8 op` followed by an op-specific payload:
+//
+//   kSummary (1)  no payload; replies with u8 count, then for each
+//                 non-empty histogram u8 LatencyPath, u8 LatencyKind, u64
+//                 count and u64 p50, p90, p99 and max in microseconds
+//   kBuckets (2)  no payload; replies with u8 count, then for each
+//                 non-empty histogram u8 LatencyPath, u8 LatencyKind, u16
+//                 bucket count and that many (u16 bucket index, u64 count)
+//                 in LatencyHistogram's layout, counted since launch
+//   kRecord  (3)  u8 LatencyPath, u8 LatencyKind, u32 count, then that many
+//                 u32 microseconds; for latencies measured in Dart
+//   kAllocations (4)  no payload; replies with u64 requests started and
+//                     u64 heap allocations made on their path, both since
+//                     launch
+//
+// kRecord replies with one byte. Malformed requests get an empty reply.
+class LatencyMetricsService {
+ public:
+  static constexpr uint8_t kSummary = 1;
+  static constexpr uint8_t kBuckets = 2;
+  static constexpr uint8_t kRecord = 3;
+  static constexpr uint8_t kAllocations = 4;
+
+  LatencyMetricsService();
+  ~LatencyMetricsService();
+
+  void HandleMessage(const uint8_t* message, size_t size,
+                     std::vector<uint8_t>* reply);
+
+ private:
+  bool Handle(uint8_t op, WireReader* reader, std::vector<uint8_t>* reply);
+
+  // Scratch for kBuckets.
+  std::vector<std::pair<uint16_t, uint64_t>> buckets_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_LATENCY_METRICS_SERVICE_H_
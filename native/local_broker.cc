@@ -0,0 +1,625 @@
+#include "native/local_broker.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+#include "native/http_stream_service.h"
+#include "native/utf_transcode.h"
+#include "native/wire_format.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+// Event header: u8 event, u64 request_id.
+constexpr size_t kEventHeaderSize = 9;
+constexpr size_t kReadChunkSize = 64 * 1024;
+// Upper bounds on the parts of a request head.
+constexpr size_t kMaxMethodSize = 16;
+constexpr size_t kMaxHeadSize = 64 * 1024;
+
+uint64_t LoadU64(const uint8_t* in) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++) {
+    value |= static_cast<uint64_t>(in[i]) << (8 * i);
+  }
+  return value;
+}
+
+void StoreU64(uint8_t* out, uint64_t value) {
+  for (int i = 0; i < 8; i++) {
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+uint32_t LoadU32(const uint8_t* in) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; i++) {
+    value |= static_cast<uint32_t>(in[i]) << (8 * i);
+  }
+  return value;
+}
+
+// Whether |c| may appear in a request line or header as sent: nothing that
+// would end the line early.
+bool IsHeadByte(uint8_t c) {
+  return c >= 0x20 && c != 0x7f;
+}
+
+enum class Field { kMethod, kPath, kHeaderName, kHeaderValue };
+
+// Copies a string from |reader| to |writer|, clearing |*fit| if it is not
+// fit for |field|. False if the reader ran out.
+bool CopyField(WireReader* reader, WireWriter* writer, Field field,
+               bool* fit) {
+  uint32_t length = 0;
+  const uint8_t* span = nullptr;
+  if (!reader->ReadU32(&length) || !reader->ReadSpan(length, &span)) {
+    return false;
+  }
+  writer->WriteU32(length);
+  writer->WriteBytes(span, length);
+
+  if (length == 0 ? field != Field::kHeaderValue : length > kMaxHeadSize) {
+    *fit = false;
+  } else if (field == Field::kMethod && length > kMaxMethodSize) {
+    *fit = false;
+  } else if (field == Field::kPath && span[0] != '/') {
+    *fit = false;
+  }
+  for (uint32_t i = 0; i < length && *fit; i++) {
+    const uint8_t c = span[i];
+    if (field == Field::kMethod ? c < 'A' || c > 'Z' : !IsHeadByte(c)) {
+      *fit = false;
+    } else if ((field == Field::kPath || field == Field::kHeaderName) &&
+               c == ' ') {
+      *fit = false;
+    } else if (field == Field::kHeaderName && c == ':') {
+      *fit = false;
+    }
+  }
+  return true;
+}
+
+std::vector<uint8_t> CancelMessage(uint64_t id) {
+  std::vector<uint8_t> message;
+  WireWriter writer(&message);
+  writer.WriteU8(HttpStreamService::kCancel);
+  writer.WriteU64(id);
+  return message;
+}
+
+// Makes the socket's directory if needed and checks no one else can write
+// to it.
+bool PrepareSocketDirectory(const std::string& socket_path,
+                            std::string* error) {
+#if defined(_WIN32)
+  std::error_code ignored;
+  const std::filesystem::path directory =
+      std::filesystem::u8path(socket_path).parent_path();
+  std::filesystem::create_directories(directory, ignored);
+  if (!std::filesystem::is_directory(directory, ignored)) {
+    *error = "Could not create " + directory.u8string();
+    return false;
+  }
+  return true;
+#else
+  const std::string directory =
+      std::filesystem::path(socket_path).parent_path().string();
+  if (::mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST) {
+    *error = "Could not create " + directory + ": " + std::strerror(errno);
+    return false;
+  }
+  struct stat info;
+  if (::lstat(directory.c_str(), &info) != 0 || !S_ISDIR(info.st_mode) ||
+      info.st_uid != ::getuid() || (info.st_mode & 022) != 0) {
+    *error = directory + " is not private to this user";
+    return false;
+  }
+  return true;
+#endif
+}
+
+}  // namespace
+
+LocalBroker::LocalBroker(Upstream upstream)
+    : LocalBroker(std::move(upstream), Options()) {}
+
+LocalBroker::LocalBroker(Upstream upstream, const Options& options)
+    : upstream_(std::move(upstream)),
+      options_(options),
+      running_(false),
+      listener_(kInvalidSocket),
+      wake_read_(kInvalidSocket),
+      wake_write_(kInvalidSocket),
+      wake_pending_(false),
+      clients_accepted_(0),
+      clients_refused_(0),
+      clients_dropped_(0),
+      requests_(0),
+      shared_events_(0),
+      inline_events_(0),
+      shared_bytes_(0) {}
+
+LocalBroker::~LocalBroker() {
+  Stop();
+  // Kept until now for events racing Stop.
+  CloseSocket(wake_read_);
+  CloseSocket(wake_write_);
+}
+
+std::string LocalBroker::DefaultSocketPath() {
+#if defined(_WIN32)
+  wchar_t buffer[MAX_PATH];
+  const DWORD length =
+      ::GetEnvironmentVariableW(L"LOCALAPPDATA", buffer, MAX_PATH);
+  std::string directory;
+  if (length == 0 || length >= MAX_PATH ||
+      !Utf16ToUtf8(buffer, length, &directory)) {
+    return std::string();
+  }
+  return directory + "\\CloudToLocalLLM\\ollama.sock";
+#else
+  const char* runtime_dir = std::getenv("XDG_RUNTIME_DIR");
+  if (runtime_dir != nullptr && runtime_dir[0] != '\0') {
+    return std::string(runtime_dir) + "/cloudtolocalllm/ollama.sock";
+  }
+  return "/tmp/cloudtolocalllm-" + std::to_string(::getuid()) +
+         "/ollama.sock";
+#endif
+}
+
+bool LocalBroker::Start(std::string* error) {
+  if (running_) {
+    return true;
+  }
+  socket_path_ = options_.socket_path.empty() ? DefaultSocketPath()
+                                              : options_.socket_path;
+  if (socket_path_.empty()) {
+    *error = "No directory for the broker socket";
+    return false;
+  }
+  if (!PrepareSocketDirectory(socket_path_, error)) {
+    return false;
+  }
+  listener_ = ListenLocal(socket_path_, error);
+  if (listener_ == kInvalidSocket) {
+    return false;
+  }
+#if !defined(_WIN32)
+  ::chmod(socket_path_.c_str(), 0600);
+#endif
+  if (wake_read_ == kInvalidSocket &&
+      !CreateWakePair(&wake_read_, &wake_write_)) {
+    *error = "Could not create the broker's wake sockets";
+    CloseSocket(listener_);
+    listener_ = kInvalidSocket;
+    std::remove(socket_path_.c_str());
+    return false;
+  }
+  running_ = true;
+  thread_ = std::thread(&LocalBroker::Run, this);
+  return true;
+}
+
+void LocalBroker::Stop() {
+  if (!running_) {
+    return;
+  }
+  running_ = false;
+  Wake();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : clients_) {
+      CloseSocket(entry.second->socket);
+    }
+    clients_.clear();
+    routes_.Clear();
+  }
+  CloseSocket(listener_);
+  listener_ = kInvalidSocket;
+  std::remove(socket_path_.c_str());
+}
+
+bool LocalBroker::HandleEvent(const uint8_t* event, size_t size) {
+  if (size < kEventHeaderSize) {
+    return false;
+  }
+  const uint64_t id = LoadU64(event + 1);
+  if ((id & kRequestIdBit) == 0) {
+    return false;
+  }
+  const bool last = event[0] == HttpStreamService::kEventComplete ||
+                    event[0] == HttpStreamService::kEventError;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Route* route = routes_.Find(id);
+    if (route == nullptr) {
+      // Cancelled, or its client has gone.
+      return true;
+    }
+    auto it = clients_.find(route->client);
+    if (it != clients_.end()) {
+      Deliver(it->second.get(), event, size, route->request_id);
+      if (last) {
+        it->second->requests.erase(route->request_id);
+      }
+    }
+    if (last || it == clients_.end()) {
+      routes_.Erase(id);
+    }
+  }
+  Wake();
+  return true;
+}
+
+void LocalBroker::OnRejected(uint64_t id) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Route* route = routes_.Find(id);
+    if (route == nullptr) {
+      return;
+    }
+    auto it = clients_.find(route->client);
+    if (it != clients_.end()) {
+      DeliverError(it->second.get(), route->request_id,
+                   "The app's Ollama client is unavailable");
+      it->second->requests.erase(route->request_id);
+    }
+    routes_.Erase(id);
+  }
+  Wake();
+}
+
+LocalBroker::Stats LocalBroker::stats() const {
+  Stats stats;
+  stats.clients_accepted = clients_accepted_;
+  stats.clients_refused = clients_refused_;
+  stats.clients_dropped = clients_dropped_;
+  stats.requests = requests_;
+  stats.shared_events = shared_events_;
+  stats.inline_events = inline_events_;
+  stats.shared_bytes = shared_bytes_;
+  return stats;
+}
+
+void LocalBroker::Run() {
+  std::vector<PollEntry> entries;
+  std::vector<Client*> polled;
+  Outbox outbox;
+  while (running_) {
+    entries.clear();
+    polled.clear();
+    entries.push_back({wake_read_, kPollIn, 0});
+    entries.push_back({listener_, kPollIn, 0});
+    {
+      // Only this thread adds or removes clients, so the pointers stay
+      // valid after the lock is released.
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto& entry : clients_) {
+        Client* client = entry.second.get();
+        short events = kPollIn;
+        if (client->out_offset < client->out.size()) {
+          events |= kPollOut;
+        }
+        entries.push_back({client->socket, events, 0});
+        polled.push_back(client);
+      }
+    }
+
+    PollSockets(entries.data(), entries.size(), -1);
+    if (!running_) {
+      break;
+    }
+    if (entries[0].revents & kPollIn) {
+      wake_pending_ = false;
+      uint8_t drain[64];
+      while (RecvSome(wake_read_, drain, sizeof(drain)) > 0) {
+      }
+    }
+    if (entries[1].revents & kPollIn) {
+      Accept();
+    }
+    for (size_t i = 0; i < polled.size(); i++) {
+      if (entries[i + 2].revents & (kPollIn | kPollError)) {
+        Receive(polled[i], &outbox);
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto it = clients_.begin(); it != clients_.end();) {
+        Client* client = it->second.get();
+        if (!client->dead) {
+          Announce(client);
+          Flush(client);
+        }
+        if (!client->dead) {
+          ++it;
+          continue;
+        }
+        Drop(client, &outbox);
+        CloseSocket(client->socket);
+        clients_dropped_++;
+        it = clients_.erase(it);
+      }
+    }
+    for (auto& request : outbox) {
+      upstream_(request.first, std::move(request.second));
+    }
+    outbox.clear();
+  }
+}
+
+void LocalBroker::Wake() {
+  if (wake_write_ != kInvalidSocket && !wake_pending_.exchange(true)) {
+    uint8_t byte = 1;
+    SendSome(wake_write_, &byte, 1);
+  }
+}
+
+void LocalBroker::Accept() {
+  for (;;) {
+    SocketHandle socket = AcceptSocket(listener_);
+    if (socket == kInvalidSocket) {
+      return;
+    }
+    size_t count;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      count = clients_.size();
+    }
+    auto client = std::make_unique<Client>();
+    const size_t capacity = SharedRing::RoundCapacity(options_.ring_capacity);
+    if (count >= options_.max_clients || !IsSameUserPeer(socket) ||
+        !client->memory.Create(SharedMemory::UniqueName("cloudtolocalllm"),
+                               SharedRing::BlockSize(capacity))) {
+      CloseSocket(socket);
+      clients_refused_++;
+      continue;
+    }
+    client->key = next_client_++;
+    client->socket = socket;
+    client->ring = SharedRing::Initialize(client->memory.data(), capacity);
+
+    WireWriter writer(&client->out);
+    writer.WriteU32(0);
+    writer.WriteU8(kWelcome);
+    writer.WriteString(client->memory.name());
+    writer.WriteU32(static_cast<uint32_t>(capacity));
+    writer.PatchU32(0, static_cast<uint32_t>(client->out.size() - 4));
+
+    clients_accepted_++;
+    std::lock_guard<std::mutex> lock(mutex_);
+    clients_[client->key] = std::move(client);
+  }
+}
+
+void LocalBroker::Receive(Client* client, Outbox* outbox) {
+  read_buffer_.resize(kReadChunkSize);
+  // Stops at a frame's worth, so a client cannot make this buffer without
+  // end before the frames are checked.
+  while (client->in.size() < 4 + kMaxFrameSize) {
+    const long received =
+        RecvSome(client->socket, read_buffer_.data(), read_buffer_.size());
+    if (received == kSocketWouldBlock) {
+      break;
+    }
+    if (received <= 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      client->dead = true;
+      return;
+    }
+    client->in.insert(client->in.end(), read_buffer_.data(),
+                      read_buffer_.data() + received);
+  }
+
+  size_t consumed = 0;
+  while (client->in.size() - consumed >= 4) {
+    const uint32_t length = LoadU32(client->in.data() + consumed);
+    if (length == 0 || length > kMaxFrameSize) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      client->dead = true;
+      return;
+    }
+    if (client->in.size() - consumed - 4 < length) {
+      break;
+    }
+    if (!HandleFrame(client, client->in.data() + consumed + 4, length,
+                     outbox)) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      client->dead = true;
+      return;
+    }
+    consumed += 4 + length;
+  }
+  client->in.erase(client->in.begin(), client->in.begin() + consumed);
+}
+
+bool LocalBroker::HandleFrame(Client* client, const uint8_t* frame,
+                              size_t size, Outbox* outbox) {
+  WireReader reader(frame, size);
+  uint8_t type = 0;
+  uint64_t request_id = 0;
+  reader.ReadU8(&type);
+
+  switch (type) {
+    case kStart: {
+      const uint64_t id = kRequestIdBit | next_request_++;
+      std::vector<uint8_t> message;
+      message.reserve(size + options_.host.size() + 16);
+      WireWriter writer(&message);
+      writer.WriteU8(HttpStreamService::kStart);
+      writer.WriteU64(id);
+      uint16_t header_count = 0;
+      uint8_t flags = 0;
+      bool fit = true;
+      if (!reader.ReadU64(&request_id) ||
+          !CopyField(&reader, &writer, Field::kMethod, &fit)) {
+        return false;
+      }
+      writer.WriteString(options_.host);
+      writer.WriteU16(options_.port);
+      if (!CopyField(&reader, &writer, Field::kPath, &fit) ||
+          !reader.ReadU16(&header_count)) {
+        return false;
+      }
+      writer.WriteU16(header_count);
+      for (uint16_t i = 0; i < header_count; i++) {
+        if (!CopyField(&reader, &writer, Field::kHeaderName, &fit) ||
+            !CopyField(&reader, &writer, Field::kHeaderValue, &fit)) {
+          return false;
+        }
+      }
+      const uint8_t* body = nullptr;
+      uint32_t body_size = 0;
+      if (!reader.ReadU8(&flags) || !reader.ReadU32(&body_size) ||
+          !reader.ReadSpan(body_size, &body)) {
+        return false;
+      }
+      // Tunnel frames and event rings are the app's own business.
+      writer.WriteU8(flags & HttpStreamService::kFlagParseNdjson);
+      writer.WriteU32(body_size);
+      writer.WriteBytes(body, body_size);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!fit) {
+        DeliverError(client, request_id, "Malformed request head");
+        return true;
+      }
+      if (!client->requests.emplace(request_id, id).second) {
+        DeliverError(client, request_id, "Request id already in use");
+        return true;
+      }
+      bool allocated;
+      Route& route = routes_.Insert(id, &allocated);
+      route.client = client->key;
+      route.request_id = request_id;
+      requests_++;
+      outbox->emplace_back(id, std::move(message));
+      return true;
+    }
+    case kCancel: {
+      if (!reader.ReadU64(&request_id)) {
+        return false;
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = client->requests.find(request_id);
+      if (it != client->requests.end()) {
+        routes_.Erase(it->second);
+        outbox->emplace_back(it->second, CancelMessage(it->second));
+        client->requests.erase(it);
+      }
+      return true;
+    }
+    case kMapped:
+      // Both sides have it mapped; nobody else needs to find it.
+      client->memory.Unlink();
+      return true;
+    default:
+      return false;
+  }
+}
+
+void LocalBroker::Deliver(Client* client, const uint8_t* event, size_t size,
+                          uint64_t request_id) {
+  if (client->dead) {
+    return;
+  }
+  uint8_t* slot = client->ring->Reserve(size);
+  if (slot != nullptr) {
+    std::memcpy(slot, event, size);
+    StoreU64(slot + 1, request_id);
+    client->ring->Commit();
+    client->unannounced++;
+    shared_events_++;
+    shared_bytes_ += size;
+    return;
+  }
+  if (client->ring->corrupt()) {
+    client->dead = true;
+    return;
+  }
+
+  // Too big for the ring, or the client is behind: send it in line, after
+  // the records already written so the order holds.
+  Announce(client);
+  const size_t start = client->out.size();
+  WireWriter writer(&client->out);
+  writer.WriteU32(static_cast<uint32_t>(1 + size));
+  writer.WriteU8(kEvent);
+  writer.WriteBytes(event, size);
+  StoreU64(client->out.data() + start + 5 + 1, request_id);
+  inline_events_++;
+  if (client->out.size() - client->out_offset > options_.max_backlog) {
+    client->dead = true;
+  }
+}
+
+void LocalBroker::DeliverError(Client* client, uint64_t request_id,
+                               const std::string& message) {
+  std::vector<uint8_t> event;
+  WireWriter writer(&event);
+  writer.WriteU8(HttpStreamService::kEventError);
+  writer.WriteU64(request_id);
+  writer.WriteString(message);
+  Deliver(client, event.data(), event.size(), request_id);
+}
+
+void LocalBroker::Announce(Client* client) {
+  if (client->unannounced == 0) {
+    return;
+  }
+  WireWriter writer(&client->out);
+  writer.WriteU32(5);
+  writer.WriteU8(kRecords);
+  writer.WriteU32(client->unannounced);
+  client->unannounced = 0;
+}
+
+void LocalBroker::Flush(Client* client) {
+  while (client->out_offset < client->out.size()) {
+    const long sent =
+        SendSome(client->socket, client->out.data() + client->out_offset,
+                 client->out.size() - client->out_offset);
+    if (sent == kSocketWouldBlock) {
+      break;
+    }
+    if (sent < 0) {
+      client->dead = true;
+      return;
+    }
+    client->out_offset += static_cast<size_t>(sent);
+  }
+  if (client->out_offset == client->out.size()) {
+    client->out.clear();
+    client->out_offset = 0;
+  } else if (client->out_offset > client->out.size() / 2) {
+    client->out.erase(client->out.begin(),
+                      client->out.begin() + client->out_offset);
+    client->out_offset = 0;
+  }
+}
+
+void LocalBroker::Drop(Client* client, Outbox* outbox) {
+  for (const auto& request : client->requests) {
+    routes_.Erase(request.second);
+    outbox->emplace_back(request.second, CancelMessage(request.second));
+  }
+  client->requests.clear();
+}
+
+}  // namespace cloudtolocalllm
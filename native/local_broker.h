@@ -0,0 +1,220 @@
+#ifndef NATIVE_LOCAL_BROKER_H_
+#define NATIVE_LOCAL_BROKER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "native/recycling_map.h"
+#include "native/shared_memory.h"
+#include "native/shared_ring.h"
+#include "native/socket.h"
+
+namespace cloudtolocalllm {
+
+// Lets other processes of the same user (a CLI, scripts, editor helpers)
+// reach the local Ollama through this app's HttpStreamService rather than
+// opening connections of their own, so every local consumer shares one
+// keep-alive pool, one ResponseCache and the one set of latency figures.
+// See LocalBrokerClient for their side.
+//
+// The broker listens on a Unix domain socket: $XDG_RUNTIME_DIR, else a
+// private directory under /tmp, on Linux, and %LOCALAPPDATA% on Windows,
+// whose AF_UNIX support stands in for a named pipe. Peers running as
+// another user are turned away. Each connection gets a SharedRing in a
+// SharedMemory block of its own, which the broker fills and the client
+// maps.
+//
+// Frames on the socket are `u32 length` and a payload starting with
+// `u8 type`. A client sends:
+//
+//   kStart  (1)  u64 request_id, string method, string path, u16
+//                header_count, header_count x (string name, string value),
+//                u8 flags (HttpStreamService::kFlagParseNdjson or 0),
+//                string body
+//   kCancel (2)  u64 request_id
+//   kMapped (3)  nothing; the client has opened its ring
+//
+// The broker sends:
+//
+//   kWelcome (1)  string shared memory name, u32 ring capacity; always
+//                 the first frame
+//   kRecords (2)  u32 count: the next |count| records of the ring are
+//                 events
+//   kEvent   (3)  one event, for those that did not fit in the ring
+//
+// Events are HttpStreamService's, with the client's request id, and end
+// with kEventComplete or kEventError as there. Each is copied once, from
+// the service's buffer into the ring, and read by the client in place; a
+// burst of them costs one small kRecords frame, however many there are.
+// Requests always go to the Ollama in Options, never to a host the client
+// names, and the names, values and path that go into the request head are
+// checked for line breaks.
+//
+// The glue hands each request to the service with Upstream, on whichever
+// thread it calls HandleMessage from, and passes every event the service
+// emits to HandleEvent first. Broker requests carry kRequestIdBit, which
+// Dart's never do.
+class LocalBroker {
+ public:
+  static constexpr uint8_t kStart = 1;
+  static constexpr uint8_t kCancel = 2;
+  static constexpr uint8_t kMapped = 3;
+
+  static constexpr uint8_t kWelcome = 1;
+  static constexpr uint8_t kRecords = 2;
+  static constexpr uint8_t kEvent = 3;
+
+  static constexpr uint64_t kRequestIdBit = 1ull << 63;
+  // Upper bound on one frame either way; a chat with images fits easily.
+  static constexpr size_t kMaxFrameSize = 64 * 1024 * 1024;
+
+  // Takes an encoded HttpStreamService request, kStart or kCancel, for
+  // request |id|. Called on the broker's thread.
+  using Upstream =
+      std::function<void(uint64_t id, std::vector<uint8_t> message)>;
+
+  struct Options {
+    // Empty for DefaultSocketPath().
+    std::string socket_path;
+    std::string host = "localhost";
+    uint16_t port = 11434;
+    size_t ring_capacity = 1024 * 1024;
+    size_t max_clients = 16;
+    // Bytes queued for a client that is not reading before it is dropped.
+    size_t max_backlog = 8 * 1024 * 1024;
+  };
+
+  struct Stats {
+    uint64_t clients_accepted = 0;
+    uint64_t clients_refused = 0;
+    uint64_t clients_dropped = 0;
+    uint64_t requests = 0;
+    // Events written to a ring, and those that had to go on the socket.
+    uint64_t shared_events = 0;
+    uint64_t inline_events = 0;
+    uint64_t shared_bytes = 0;
+  };
+
+  explicit LocalBroker(Upstream upstream);
+  LocalBroker(Upstream upstream, const Options& options);
+  ~LocalBroker();
+
+  // Prevent copying.
+  LocalBroker(LocalBroker const&) = delete;
+  LocalBroker& operator=(LocalBroker const&) = delete;
+
+  // Where the app's broker listens for the current user.
+  static std::string DefaultSocketPath();
+
+  // Binds the socket and starts the broker's thread. Fails, with |error|
+  // set, if the socket's directory is not private to the user or another
+  // process is serving the path.
+  bool Start(std::string* error);
+
+  // Drops every client and removes the socket file. Upstream is not called
+  // afterwards.
+  void Stop();
+
+  // Takes an event the service emitted. Returns false, leaving it to the
+  // glue, if it is not for a broker request. May be called from any
+  // thread.
+  bool HandleEvent(const uint8_t* event, size_t size);
+
+  // The service turned down request |id|; its client gets kEventError.
+  void OnRejected(uint64_t id);
+
+  const std::string& socket_path() const { return socket_path_; }
+  Stats stats() const;
+
+ private:
+  struct Client {
+    uint64_t key = 0;
+    SocketHandle socket = kInvalidSocket;
+    SharedMemory memory;
+    std::optional<SharedRing> ring;
+    std::vector<uint8_t> in;
+    std::vector<uint8_t> out;
+    size_t out_offset = 0;
+    // Records written since the last kRecords frame.
+    uint32_t unannounced = 0;
+    // Requests in flight, by the client's id.
+    std::unordered_map<uint64_t, uint64_t> requests;
+    bool dead = false;
+  };
+
+  // Where a broker request's events go.
+  struct Route {
+    uint64_t client = 0;
+    uint64_t request_id = 0;
+  };
+
+  // Requests for the service, gathered under the lock and handed to
+  // Upstream after it is released.
+  using Outbox = std::vector<std::pair<uint64_t, std::vector<uint8_t>>>;
+
+  void Run();
+  void Wake();
+  void Accept();
+  // Reads what |client| has sent and handles its complete frames. Broker
+  // thread only.
+  void Receive(Client* client, Outbox* outbox);
+  bool HandleFrame(Client* client, const uint8_t* frame, size_t size,
+                   Outbox* outbox);
+  // Writes |event| for |client|, with |request_id| in place of the
+  // service's. Caller holds mutex_.
+  void Deliver(Client* client, const uint8_t* event, size_t size,
+               uint64_t request_id);
+  void DeliverError(Client* client, uint64_t request_id,
+                    const std::string& message);
+  // Queues the kRecords frame for records written since the last one, and
+  // sends what the socket takes. Caller holds mutex_.
+  void Announce(Client* client);
+  void Flush(Client* client);
+  // Forgets |client|'s requests, queueing their cancellation. Caller holds
+  // mutex_.
+  void Drop(Client* client, Outbox* outbox);
+
+  const Upstream upstream_;
+  const Options options_;
+  std::string socket_path_;
+
+  std::thread thread_;
+  std::atomic<bool> running_;
+  SocketHandle listener_;
+  SocketHandle wake_read_;
+  SocketHandle wake_write_;
+  std::atomic<bool> wake_pending_;
+
+  // Guards the clients and routes, shared between the broker's thread and
+  // the threads events arrive on.
+  mutable std::mutex mutex_;
+  std::unordered_map<uint64_t, std::unique_ptr<Client>> clients_;
+  RecyclingMap<uint64_t, Route> routes_;
+
+  // Broker thread only.
+  uint64_t next_client_ = 1;
+  uint64_t next_request_ = 1;
+  std::vector<uint8_t> read_buffer_;
+
+  std::atomic<uint64_t> clients_accepted_;
+  std::atomic<uint64_t> clients_refused_;
+  std::atomic<uint64_t> clients_dropped_;
+  std::atomic<uint64_t> requests_;
+  std::atomic<uint64_t> shared_events_;
+  std::atomic<uint64_t> inline_events_;
+  std::atomic<uint64_t> shared_bytes_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_LOCAL_BROKER_H_
@@ -0,0 +1,243 @@
+#include "native/local_broker_client.h"
+
+#include <chrono>
+#include <memory>
+
+#include "native/http_stream_service.h"
+#include "native/local_broker.h"
+#include "native/wire_format.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+constexpr size_t kReadChunkSize = 64 * 1024;
+// Event header: u8 event, u64 request_id.
+constexpr size_t kEventHeaderSize = 9;
+
+uint32_t LoadU32(const uint8_t* in) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; i++) {
+    value |= static_cast<uint32_t>(in[i]) << (8 * i);
+  }
+  return value;
+}
+
+int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+LocalBrokerClient::LocalBrokerClient()
+    : socket_(kInvalidSocket), in_offset_(0) {}
+
+LocalBrokerClient::~LocalBrokerClient() {
+  Close();
+}
+
+bool LocalBrokerClient::Connect(const std::string& socket_path,
+                                int timeout_ms, std::string* error) {
+  Close();
+  in_.clear();
+  in_offset_ = 0;
+  socket_ = ConnectLocal(socket_path, error);
+  if (socket_ == kInvalidSocket) {
+    return false;
+  }
+
+  const int64_t deadline = NowMs() + timeout_ms;
+  while (!ring_) {
+    const int64_t remaining = deadline - NowMs();
+    PollEntry entry = {socket_, kPollIn, 0};
+    if (remaining <= 0 ||
+        PollSockets(&entry, 1, static_cast<int>(remaining)) <= 0) {
+      *error = "The broker did not answer";
+      Close();
+      return false;
+    }
+    if (!Receive() || !HandleFrames(nullptr)) {
+      *error = "The broker closed the connection";
+      Close();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool LocalBrokerClient::Start(const HttpRequest& request) {
+  frame_.clear();
+  WireWriter writer(&frame_);
+  writer.WriteU32(0);
+  writer.WriteU8(LocalBroker::kStart);
+  writer.WriteU64(request.id);
+  writer.WriteString(request.method);
+  writer.WriteString(request.path);
+  writer.WriteU16(static_cast<uint16_t>(request.headers.size()));
+  for (const auto& header : request.headers) {
+    writer.WriteString(header.first);
+    writer.WriteString(header.second);
+  }
+  writer.WriteU8(request.parse_ndjson ? HttpStreamService::kFlagParseNdjson
+                                      : 0);
+  writer.WriteString(request.body);
+  writer.PatchU32(0, static_cast<uint32_t>(frame_.size() - 4));
+  return Send(frame_);
+}
+
+bool LocalBrokerClient::Cancel(uint64_t id) {
+  frame_.clear();
+  WireWriter writer(&frame_);
+  writer.WriteU32(9);
+  writer.WriteU8(LocalBroker::kCancel);
+  writer.WriteU64(id);
+  return Send(frame_);
+}
+
+bool LocalBrokerClient::Poll(int timeout_ms, const EventHandler& handler) {
+  if (socket_ == kInvalidSocket) {
+    return false;
+  }
+  // Frames left over from Connect go first.
+  if (!HandleFrames(&handler)) {
+    Close();
+    return false;
+  }
+  PollEntry entry = {socket_, kPollIn, 0};
+  if (PollSockets(&entry, 1, timeout_ms) <= 0) {
+    return true;
+  }
+  if (!Receive() || !HandleFrames(&handler)) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void LocalBrokerClient::Close() {
+  // The buffers stay, as a handler may close the connection mid-frame.
+  CloseSocket(socket_);
+  socket_ = kInvalidSocket;
+  ring_.reset();
+  memory_.reset();
+}
+
+bool LocalBrokerClient::Send(const std::vector<uint8_t>& frame) {
+  size_t offset = 0;
+  while (socket_ != kInvalidSocket && offset < frame.size()) {
+    const long sent =
+        SendSome(socket_, frame.data() + offset, frame.size() - offset);
+    if (sent == kSocketWouldBlock) {
+      PollEntry entry = {socket_, kPollOut, 0};
+      PollSockets(&entry, 1, -1);
+      continue;
+    }
+    if (sent < 0) {
+      Close();
+      return false;
+    }
+    offset += static_cast<size_t>(sent);
+  }
+  return socket_ != kInvalidSocket;
+}
+
+bool LocalBrokerClient::Receive() {
+  for (;;) {
+    const size_t size = in_.size();
+    in_.resize(size + kReadChunkSize);
+    const long received =
+        RecvSome(socket_, in_.data() + size, kReadChunkSize);
+    in_.resize(size + (received > 0 ? static_cast<size_t>(received) : 0));
+    if (received == kSocketWouldBlock) {
+      return true;
+    }
+    if (received <= 0) {
+      return false;
+    }
+  }
+}
+
+bool LocalBrokerClient::HandleFrames(const EventHandler* handler) {
+  while (socket_ != kInvalidSocket && in_.size() - in_offset_ >= 4) {
+    const uint32_t length = LoadU32(in_.data() + in_offset_);
+    if (length == 0 || length > LocalBroker::kMaxFrameSize) {
+      return false;
+    }
+    if (in_.size() - in_offset_ - 4 < length) {
+      break;
+    }
+    const uint8_t* frame = in_.data() + in_offset_ + 4;
+    in_offset_ += 4 + length;
+
+    if (!ring_) {
+      if (frame[0] != LocalBroker::kWelcome || !OpenRing(frame, length)) {
+        return false;
+      }
+      if (handler == nullptr) {
+        break;
+      }
+      continue;
+    }
+    if (handler == nullptr) {
+      // Connect stops at the welcome; nothing else comes before it.
+      return false;
+    }
+
+    if (frame[0] == LocalBroker::kRecords && length == 5) {
+      const uint32_t count = LoadU32(frame + 1);
+      for (uint32_t i = 0; i < count; i++) {
+        const uint8_t* event = nullptr;
+        size_t size = 0;
+        if (!ring_ || !ring_->Next(&event, &size) ||
+            size < kEventHeaderSize) {
+          return false;
+        }
+        (*handler)(event, size);
+      }
+      if (ring_) {
+        ring_->Release();
+      }
+    } else if (frame[0] == LocalBroker::kEvent &&
+               length >= 1 + kEventHeaderSize) {
+      (*handler)(frame + 1, length - 1);
+    } else {
+      return false;
+    }
+  }
+
+  if (in_offset_ == in_.size()) {
+    in_.clear();
+    in_offset_ = 0;
+  } else if (in_offset_ > in_.size() / 2) {
+    in_.erase(in_.begin(), in_.begin() + in_offset_);
+    in_offset_ = 0;
+  }
+  return true;
+}
+
+bool LocalBrokerClient::OpenRing(const uint8_t* frame, size_t size) {
+  WireReader reader(frame + 1, size - 1);
+  std::string name;
+  uint32_t capacity = 0;
+  if (!reader.ReadString(&name) || !reader.ReadU32(&capacity) ||
+      capacity > SharedRing::kMaxCapacity) {
+    return false;
+  }
+  memory_ = std::make_unique<SharedMemory>();
+  if (!memory_->Open(name, SharedRing::BlockSize(capacity))) {
+    return false;
+  }
+  SharedRing ring = SharedRing::Attach(memory_->data(), memory_->size());
+  if (ring.corrupt()) {
+    return false;
+  }
+  ring_ = ring;
+
+  const uint8_t mapped[] = {1, 0, 0, 0, LocalBroker::kMapped};
+  const std::vector<uint8_t> frame_bytes(mapped, mapped + sizeof(mapped));
+  return Send(frame_bytes);
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,78 @@
+#ifndef NATIVE_LOCAL_BROKER_CLIENT_H_
+#define NATIVE_LOCAL_BROKER_CLIENT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "native/http_stream_client.h"
+#include "native/shared_memory.h"
+#include "native/shared_ring.h"
+#include "native/socket.h"
+
+namespace cloudtolocalllm {
+
+// The other end of a LocalBroker, for a process that wants the app's
+// connection to the local Ollama: connects to the broker's socket, maps the
+// ring it is given and reads HttpStreamService events out of it.
+//
+// Driven from one thread, which calls Poll in its own loop; nothing here
+// starts a thread. Not thread-safe.
+class LocalBrokerClient {
+ public:
+  // Receives one event, laid out as HttpStreamService's. |event| points
+  // into the shared ring or the socket buffer and is valid for the call
+  // only.
+  using EventHandler = std::function<void(const uint8_t* event, size_t size)>;
+
+  LocalBrokerClient();
+  ~LocalBrokerClient();
+
+  // Prevent copying.
+  LocalBrokerClient(LocalBrokerClient const&) = delete;
+  LocalBrokerClient& operator=(LocalBrokerClient const&) = delete;
+
+  // Connects to the broker at |socket_path| (LocalBroker::DefaultSocketPath
+  // for the app's) and waits up to |timeout_ms| for its welcome.
+  bool Connect(const std::string& socket_path, int timeout_ms,
+               std::string* error);
+
+  // Sends |request| to the app's Ollama; its host and port are ignored.
+  // Events for it carry |request.id|. Returns false if the broker has gone.
+  bool Start(const HttpRequest& request);
+
+  bool Cancel(uint64_t id);
+
+  // Waits up to |timeout_ms| (-1 for forever) for events and hands each to
+  // |handler|, in order. Returns false once the connection is lost.
+  bool Poll(int timeout_ms, const EventHandler& handler);
+
+  void Close();
+
+  bool connected() const { return socket_ != kInvalidSocket; }
+
+ private:
+  // Sends one frame whole, waiting for the socket as needed.
+  bool Send(const std::vector<uint8_t>& frame);
+  // Reads what the socket has; false once it is closed.
+  bool Receive();
+  // Handles the complete frames received, up to the welcome when
+  // |handler| is null.
+  bool HandleFrames(const EventHandler* handler);
+  bool OpenRing(const uint8_t* frame, size_t size);
+
+  SocketHandle socket_;
+  std::unique_ptr<SharedMemory> memory_;
+  std::optional<SharedRing> ring_;
+  std::vector<uint8_t> in_;
+  size_t in_offset_;
+  std::vector<uint8_t> frame_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_LOCAL_BROKER_CLIENT_H_
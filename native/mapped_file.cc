@@ -0,0 +1,88 @@
+#include "native/mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cloudtolocalllm {
+
+MappedFile::MappedFile()
+    :
+#ifdef _WIN32
+      file_(nullptr),
+      mapping_(nullptr),
+#endif
+      view_(nullptr),
+      size_(0) {
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+  if (view_ != nullptr) {
+    ::UnmapViewOfFile(view_);
+  }
+  if (mapping_ != nullptr) {
+    ::CloseHandle(mapping_);
+  }
+  if (file_ != nullptr) {
+    ::CloseHandle(file_);
+  }
+#else
+  if (view_ != nullptr) {
+    ::munmap(const_cast<uint8_t*>(view_), size_);
+  }
+#endif
+}
+
+bool MappedFile::Open(const std::filesystem::path& path) {
+  if (view_ != nullptr) {
+    return false;
+  }
+#ifdef _WIN32
+  HANDLE file = ::CreateFileW(path.c_str(), GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  file_ = file;
+  LARGE_INTEGER size;
+  if (!::GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    return false;
+  }
+  mapping_ = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  void* view = mapping_ != nullptr
+                   ? ::MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0)
+                   : nullptr;
+  if (view == nullptr) {
+    return false;
+  }
+  size_ = static_cast<size_t>(size.QuadPart);
+#else
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  void* view = MAP_FAILED;
+  if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+    view = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+                  MAP_PRIVATE, fd, 0);
+  }
+  // The mapping keeps the file open.
+  ::close(fd);
+  if (view == MAP_FAILED) {
+    return false;
+  }
+  size_ = static_cast<size_t>(info.st_size);
+#endif
+  view_ = static_cast<const uint8_t*>(view);
+  return true;
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,39 @@
+#ifndef NATIVE_MAPPED_FILE_H_
+#define NATIVE_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace cloudtolocalllm {
+
+// Read-only mapping of a whole file, so large inputs (GGUF vocabularies,
+// documents to embed) are paged in by the OS instead of read into buffers.
+class MappedFile {
+ public:
+  MappedFile();
+  ~MappedFile();
+
+  // Prevent copying.
+  MappedFile(MappedFile const&) = delete;
+  MappedFile& operator=(MappedFile const&) = delete;
+
+  // Maps |path|. Returns false if it cannot be opened or is empty.
+  bool Open(const std::filesystem::path& path);
+
+  const uint8_t* data() const { return view_; }
+  size_t size() const { return size_; }
+
+ private:
+#ifdef _WIN32
+  // HANDLEs, kept as void* so this header needs no <windows.h>.
+  void* file_;
+  void* mapping_;
+#endif
+  const uint8_t* view_;
+  size_t size_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_MAPPED_FILE_H_
@@ -0,0 +1,254 @@
+#include "native/markdown_lexer.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "native/wire_format.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+bool IsSpace(uint8_t byte) {
+  return byte == ' ' || byte == '\t' || byte == '\r';
+}
+
+}  // namespace
+
+MarkdownLexer::MarkdownLexer() {
+  Reset();
+}
+
+void MarkdownLexer::Reset() {
+  blocks_.clear();
+  line_ = Line();
+  length_ = 0;
+  in_fence_ = false;
+  fence_char_ = 0;
+  fence_length_ = 0;
+  paragraph_open_ = false;
+  committed_size_ = 0;
+  committed_tail_ = Block();
+  tentative_ = false;
+  tentative_from_ = SIZE_MAX;
+  dirty_ = 0;
+}
+
+void MarkdownLexer::Append(const char* text, size_t size) {
+  Revert();
+  for (size_t i = 0; i < size; i++) {
+    const uint8_t byte = static_cast<uint8_t>(text[i]);
+    if (byte == '\n') {
+      EndLine(length_);
+      length_++;
+      line_ = Line();
+      line_.start = length_;
+      continue;
+    }
+    const uint32_t position = length_;
+    // Continuation bytes belong to the unit their lead byte counted; a
+    // four-byte sequence is a surrogate pair.
+    if ((byte & 0xC0) != 0x80) {
+      length_ += byte >= 0xF0 ? 2 : 1;
+    }
+    Scan(byte, position);
+  }
+
+  if (length_ > line_.start) {
+    committed_size_ = blocks_.size();
+    if (!blocks_.empty()) {
+      committed_tail_ = blocks_.back();
+    }
+    tentative_ = true;
+    EndLine(length_);
+    tentative_ = false;
+  }
+}
+
+void MarkdownLexer::EncodeChanges(std::vector<uint8_t>* out) {
+  const size_t first = std::min(dirty_, blocks_.size());
+  WireWriter writer(out);
+  writer.WriteU32(static_cast<uint32_t>(first));
+  writer.WriteU32(static_cast<uint32_t>(blocks_.size() - first));
+  for (size_t i = first; i < blocks_.size(); i++) {
+    const Block& block = blocks_[i];
+    writer.WriteU8(static_cast<uint8_t>(block.kind));
+    writer.WriteU8(block.closed ? 1 : 0);
+    writer.WriteU32(block.start);
+    writer.WriteU32(block.end);
+    writer.WriteU32(block.info_start);
+    writer.WriteU32(block.info_end);
+    writer.WriteU32(block.body_start);
+    writer.WriteU32(block.body_end);
+  }
+  dirty_ = blocks_.size();
+}
+
+void MarkdownLexer::Scan(uint8_t byte, uint32_t position) {
+  Line& line = line_;
+  if (line.blank) {
+    if (byte == ' ') {
+      line.indent++;
+      return;
+    }
+    if (IsSpace(byte)) {
+      // A tab indents to the next stop of four; only "four or more" matters.
+      if (byte == '\t') {
+        line.indent = 4;
+      }
+      return;
+    }
+    line.blank = false;
+    line.first = position;
+    if (byte == '`' || byte == '~' || byte == '#') {
+      line.marker = static_cast<char>(byte);
+      line.run = 1;
+      line.in_run = true;
+      return;
+    }
+  } else if (line.in_run) {
+    if (byte == static_cast<uint8_t>(line.marker)) {
+      line.run++;
+      return;
+    }
+    line.in_run = false;
+    line.space_after_run = IsSpace(byte);
+  }
+
+  if (IsSpace(byte)) {
+    if (line.has_rest) {
+      line.word_done = true;
+    }
+    return;
+  }
+  if (!line.has_rest) {
+    line.has_rest = true;
+    line.rest_start = position;
+  }
+  line.rest_end = length_;
+  if (!line.word_done) {
+    line.word_end = length_;
+  }
+  if (byte == '`') {
+    line.rest_has_backtick = true;
+  }
+}
+
+void MarkdownLexer::EndLine(uint32_t end) {
+  const Line& line = line_;
+  const bool marked = !line.blank && line.indent < 4;
+
+  if (in_fence_) {
+    Touch(blocks_.size() - 1);
+    Block& code = blocks_.back();
+    const bool closer = marked && line.marker == fence_char_ &&
+                        line.run >= fence_length_ && !line.has_rest;
+    if (closer) {
+      // The body ends before the newline ahead of the closing fence.
+      code.body_end = std::max(code.body_start, line.start - 1);
+      code.end = end;
+      if (!tentative_) {
+        code.closed = true;
+        in_fence_ = false;
+      }
+    } else {
+      code.body_end = end;
+      code.end = end;
+    }
+    return;
+  }
+
+  if (line.blank) {
+    if (!tentative_) {
+      CloseParagraph();
+    }
+    return;
+  }
+
+  if (marked && (line.marker == '`' || line.marker == '~') &&
+      line.run >= 3 && !(line.marker == '`' && line.rest_has_backtick)) {
+    CloseParagraph();
+    Block code;
+    code.kind = BlockKind::kCode;
+    code.start = line.start;
+    code.end = end;
+    code.info_start = line.has_rest ? line.rest_start : end;
+    code.info_end = line.has_rest ? line.word_end : end;
+    // The body starts after the opening fence's newline, once there is one.
+    code.body_start = tentative_ ? end : end + 1;
+    code.body_end = code.body_start;
+    Push(code);
+    if (!tentative_) {
+      in_fence_ = true;
+      fence_char_ = line.marker;
+      fence_length_ = line.run;
+    }
+    return;
+  }
+
+  if (marked && line.marker == '#' && line.run <= 6 &&
+      (line.in_run || line.space_after_run)) {
+    CloseParagraph();
+    Block heading;
+    heading.kind = BlockKind::kHeading;
+    heading.closed = !tentative_;
+    heading.start = line.start;
+    heading.end = end;
+    heading.body_start = line.has_rest ? line.rest_start : end;
+    heading.body_end = line.has_rest ? line.rest_end : end;
+    Push(heading);
+    return;
+  }
+
+  if (paragraph_open_) {
+    Touch(blocks_.size() - 1);
+    blocks_.back().end = end;
+    blocks_.back().body_end = end;
+    return;
+  }
+  Block paragraph;
+  paragraph.start = line.first;
+  paragraph.end = end;
+  paragraph.body_start = line.first;
+  paragraph.body_end = end;
+  Push(paragraph);
+  if (!tentative_) {
+    paragraph_open_ = true;
+  }
+}
+
+void MarkdownLexer::CloseParagraph() {
+  // A tentative heading or fence may yet turn out to continue it.
+  if (!paragraph_open_ || tentative_) {
+    return;
+  }
+  Touch(blocks_.size() - 1);
+  blocks_.back().closed = true;
+  paragraph_open_ = false;
+}
+
+void MarkdownLexer::Push(const Block& block) {
+  Touch(blocks_.size());
+  blocks_.push_back(block);
+}
+
+void MarkdownLexer::Touch(size_t index) {
+  if (tentative_) {
+    tentative_from_ = std::min(tentative_from_, index);
+  }
+  dirty_ = std::min(dirty_, index);
+}
+
+void MarkdownLexer::Revert() {
+  if (tentative_from_ == SIZE_MAX) {
+    return;
+  }
+  blocks_.resize(committed_size_);
+  if (tentative_from_ < committed_size_) {
+    blocks_.back() = committed_tail_;
+  }
+  Touch(std::min(tentative_from_, blocks_.size()));
+  tentative_from_ = SIZE_MAX;
+}
+
+}  // namespace cloudtolocalllm
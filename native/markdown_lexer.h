@@ -0,0 +1,129 @@
+#ifndef NATIVE_MARKDOWN_LEXER_H_
+#define NATIVE_MARKDOWN_LEXER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cloudtolocalllm {
+
+// Splits a streamed reply into the blocks MessageBubble renders one widget
+// each, without going over the text it has already seen.
+//
+// Blocks are paragraphs, ATX headings and fenced code (``` or ~~~, with the
+// first word of the info string as the language); blank lines separate
+// them and are part of none. Only complete lines change the lexer's state,
+// but the blocks reported always cover the whole text: the unfinished last
+// line is classified as if it ended there and is classified again as it
+// grows. Each Append therefore costs the length of the delta, however long
+// the reply, and changes at most the last couple of blocks.
+//
+// Offsets are UTF-16 code units from the start of the reply, so Dart can
+// slice the String it has accumulated from the same deltas.
+class MarkdownLexer {
+ public:
+  enum class BlockKind : uint8_t {
+    kParagraph = 0,
+    kHeading = 1,
+    kCode = 2,
+  };
+
+  struct Block {
+    BlockKind kind = BlockKind::kParagraph;
+    // Nothing further in the reply can change the block.
+    bool closed = false;
+    // The whole block, fences and heading markers included.
+    uint32_t start = 0;
+    uint32_t end = 0;
+    // A code block's language; empty otherwise.
+    uint32_t info_start = 0;
+    uint32_t info_end = 0;
+    // What is rendered: the text of a paragraph or heading, the lines
+    // between a code block's fences.
+    uint32_t body_start = 0;
+    uint32_t body_end = 0;
+  };
+
+  // Bytes EncodeChanges writes per block.
+  static constexpr size_t kEncodedBlockSize = 26;
+
+  MarkdownLexer();
+
+  // Lexes the next |size| bytes of the reply's UTF-8.
+  void Append(const char* text, size_t size);
+
+  // Starts a new reply, keeping the buffers.
+  void Reset();
+
+  // Appends the blocks changed since the last call to |out| and forgets
+  // them. Layout (little-endian):
+  //
+  //   u32 first, u32 count
+  //   count x (u8 kind, u8 closed, u32 start, u32 end, u32 info_start,
+  //            u32 info_end, u32 body_start, u32 body_end)
+  //
+  // Blocks from |first| on are replaced by the |count| given, which may be
+  // fewer than were reported before.
+  void EncodeChanges(std::vector<uint8_t>* out);
+
+  const std::vector<Block>& blocks() const { return blocks_; }
+  // UTF-16 code units seen so far.
+  uint32_t length() const { return length_; }
+
+ private:
+  // What has been seen of the current line.
+  struct Line {
+    uint32_t start = 0;
+    // Leading spaces; four or more makes no marker count.
+    uint32_t indent = 0;
+    bool blank = true;
+    // The first non-space.
+    uint32_t first = 0;
+    // '`', '~' or '#' at the first non-space, and how many in a row.
+    char marker = 0;
+    uint32_t run = 0;
+    bool in_run = false;
+    bool space_after_run = false;
+    // The non-space text after the marker run, and its first word.
+    bool has_rest = false;
+    uint32_t rest_start = 0;
+    uint32_t rest_end = 0;
+    uint32_t word_end = 0;
+    bool word_done = false;
+    bool rest_has_backtick = false;
+  };
+
+  void Scan(uint8_t byte, uint32_t position);
+  // Applies the current line, ending at |end|, to the blocks. A tentative
+  // line leaves the lexer's state, and every block's |closed|, as it was.
+  void EndLine(uint32_t end);
+  void CloseParagraph();
+  void Push(const Block& block);
+  void Touch(size_t index);
+  // Undoes the last Append's tentative line.
+  void Revert();
+
+  std::vector<Block> blocks_;
+  Line line_;
+  uint32_t length_;
+
+  bool in_fence_;
+  char fence_char_;
+  uint32_t fence_length_;
+  bool paragraph_open_;
+
+  // Blocks as of the last complete line, and the last of them as it was.
+  size_t committed_size_;
+  Block committed_tail_;
+  // Set while the unfinished last line is applied, and the first block it
+  // changed, or SIZE_MAX.
+  bool tentative_;
+  size_t tentative_from_;
+
+  // The first block not yet reported as it stands.
+  size_t dirty_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_MARKDOWN_LEXER_H_
@@ -0,0 +1,763 @@
+#include "native/model_downloader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+#include "native/json_scan.h"
+#include "native/wire_format.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+// How much of an unexpected response is quoted back.
+constexpr size_t kMaxQuotedError = 256;
+// Times a ranged segment is retried from where it stopped before the fetch
+// fails.
+constexpr int kMaxRetries = 3;
+
+constexpr uint32_t kCheckpointMagic = 0x444c5443;  // "CTLD"
+constexpr uint32_t kCheckpointVersion = 1;
+
+constexpr uint64_t kUnknownEnd = std::numeric_limits<uint64_t>::max();
+
+void AppendJsonString(const std::string& value, std::string* out) {
+  static const char kHex[] = "0123456789abcdef";
+  out->push_back('"');
+  for (char c : value) {
+    const unsigned char byte = static_cast<unsigned char>(c);
+    if (c == '"' || c == '\\') {
+      out->push_back('\\');
+      out->push_back(c);
+    } else if (byte < 0x20) {
+      out->append("\\u00");
+      out->push_back(kHex[byte >> 4]);
+      out->push_back(kHex[byte & 0xf]);
+    } else {
+      out->push_back(c);
+    }
+  }
+  out->push_back('"');
+}
+
+// Header names arrive lower-cased.
+const std::string* FindHeader(HttpHeaderView headers,
+                              const char* name) {
+  for (const auto& header : headers) {
+    if (header.first == name) {
+      return &header.second;
+    }
+  }
+  return nullptr;
+}
+
+bool ParseU64(const std::string& text, uint64_t* value) {
+  const char* end = text.data() + text.size();
+  const auto result = std::from_chars(text.data(), end, *value);
+  return result.ec == std::errc() && result.ptr == end;
+}
+
+bool IsBlank(const uint8_t* data, size_t size) {
+  return std::all_of(data, data + size, [](uint8_t byte) {
+    return byte == ' ' || byte == '\t' || byte == '\n' || byte == '\r';
+  });
+}
+
+std::filesystem::path PartPath(const ModelDownloader::Fetch& fetch) {
+  return std::filesystem::u8path(fetch.destination + ".part");
+}
+
+std::filesystem::path StatePath(const ModelDownloader::Fetch& fetch) {
+  return std::filesystem::u8path(fetch.destination + ".part.state");
+}
+
+}  // namespace
+
+ModelDownloader::ModelDownloader(Delegate* delegate)
+    : ModelDownloader(delegate, Options()) {}
+
+ModelDownloader::ModelDownloader(Delegate* delegate, const Options& options)
+    : delegate_(delegate),
+      options_(options),
+      client_(this),
+      started_(false),
+      next_request_id_(1),
+      jobs_completed_(0),
+      bytes_received_(0),
+      bytes_resumed_(0),
+      progress_reports_(0),
+      progress_coalesced_(0) {
+  options_.max_connections = std::max<size_t>(options_.max_connections, 1);
+  options_.min_segment_size = std::max<uint64_t>(options_.min_segment_size, 1);
+}
+
+ModelDownloader::~ModelDownloader() {
+  Stop();
+}
+
+bool ModelDownloader::Start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!started_) {
+    started_ = client_.Start();
+  }
+  return started_;
+}
+
+void ModelDownloader::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!started_) {
+      return;
+    }
+    started_ = false;
+  }
+  // With the worker gone no callback can race the checkpoints.
+  client_.Stop();
+  std::lock_guard<std::mutex> lock(mutex_);
+  requests_.clear();
+  std::vector<uint64_t> ids;
+  for (const auto& job : jobs_) {
+    ids.push_back(job.first);
+  }
+  for (uint64_t id : ids) {
+    DropJob(id);
+  }
+}
+
+void ModelDownloader::SubmitPull(Pull pull) {
+  HttpRequest request;
+  request.method = "POST";
+  request.host = pull.host;
+  request.port = pull.port;
+  request.path = "/api/pull";
+  request.headers.emplace_back("Content-Type", "application/json");
+  // Older Ollama releases read only "name".
+  request.body = "{\"model\":";
+  AppendJsonString(pull.model, &request.body);
+  request.body += ",\"name\":";
+  AppendJsonString(pull.model, &request.body);
+  request.body += ",\"stream\":true}";
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint64_t id = pull.id;
+    jobs_.erase(id);
+    jobs_[id].pull = std::move(pull);
+    request.id = next_request_id_++;
+    requests_[request.id].job_id = id;
+  }
+  client_.Submit(std::move(request));
+}
+
+void ModelDownloader::SubmitFetch(Fetch fetch) {
+  HttpRequest request;
+  request.method = "HEAD";
+  request.host = fetch.host;
+  request.port = fetch.port;
+  request.path = fetch.path;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint64_t id = fetch.id;
+    jobs_.erase(id);
+    JobState& state = jobs_[id];
+    state.is_fetch = true;
+    state.fetch = std::move(fetch);
+    state.progress.status = "downloading";
+    request.id = next_request_id_++;
+    Request& probe = requests_[request.id];
+    probe.job_id = id;
+    probe.probe = true;
+  }
+  client_.Submit(std::move(request));
+}
+
+bool ModelDownloader::Cancel(uint64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (jobs_.count(id) == 0) {
+    return false;
+  }
+  DropJob(id);
+  return true;
+}
+
+ModelDownloader::Stats ModelDownloader::stats() const {
+  Stats stats;
+  stats.jobs_completed = jobs_completed_.load();
+  stats.bytes_received = bytes_received_.load();
+  stats.bytes_resumed = bytes_resumed_.load();
+  stats.progress_reports = progress_reports_.load();
+  stats.progress_coalesced = progress_coalesced_.load();
+  return stats;
+}
+
+void ModelDownloader::OnResponseStarted(uint64_t id, int status_code,
+                                        HttpHeaderView headers) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto request = requests_.find(id);
+  if (request == requests_.end()) {
+    return;
+  }
+  request->second.status_code = status_code;
+  auto job = jobs_.find(request->second.job_id);
+  if (job == jobs_.end() || !job->second.is_fetch || status_code / 100 != 2) {
+    return;
+  }
+  JobState& state = job->second;
+  const std::string* length = FindHeader(headers, "content-length");
+  uint64_t total = 0;
+  if (length == nullptr || !ParseU64(*length, &total)) {
+    total = 0;
+  }
+  if (request->second.probe) {
+    const std::string* ranges = FindHeader(headers, "accept-ranges");
+    const std::string* etag = FindHeader(headers, "etag");
+    const std::string* modified = FindHeader(headers, "last-modified");
+    state.progress.total = total;
+    state.ranged = total > 0 && ranges != nullptr && *ranges == "bytes";
+    state.validator =
+        etag != nullptr ? *etag : (modified != nullptr ? *modified : "");
+  } else if (!state.ranged && state.progress.total == 0) {
+    state.progress.total = total;
+  }
+}
+
+void ModelDownloader::OnBodyData(uint64_t id, const uint8_t* data,
+                                 size_t size) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto request_it = requests_.find(id);
+  if (request_it == requests_.end()) {
+    return;
+  }
+  const Request request = request_it->second;
+  auto job = jobs_.find(request.job_id);
+  if (job == jobs_.end()) {
+    return;
+  }
+  JobState& state = job->second;
+  const int expected = !state.is_fetch || !state.ranged ? 200 : 206;
+  if (request.status_code != expected) {
+    if (state.error_body.size() < kMaxQuotedError) {
+      state.error_body.append(
+          reinterpret_cast<const char*>(data),
+          std::min(size, kMaxQuotedError - state.error_body.size()));
+    }
+    return;
+  }
+  if (request.probe) {
+    return;
+  }
+
+  std::string error;
+  if (!state.is_fetch) {
+    bytes_received_ += size;
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    while (p != end) {
+      const uint8_t* newline =
+          static_cast<const uint8_t*>(std::memchr(p, '\n', end - p));
+      if (newline == nullptr) {
+        state.line.append(reinterpret_cast<const char*>(p), end - p);
+        break;
+      }
+      bool ok;
+      if (state.line.empty()) {
+        ok = HandlePullLine(&state, p, newline - p, &error);
+      } else {
+        state.line.append(reinterpret_cast<const char*>(p), newline - p);
+        ok = HandlePullLine(
+            &state, reinterpret_cast<const uint8_t*>(state.line.data()),
+            state.line.size(), &error);
+        state.line.clear();
+      }
+      if (!ok) {
+        FailJob(request.job_id, error, &lock);
+        return;
+      }
+      p = newline + 1;
+    }
+  } else {
+    Segment& segment = state.segments[request.segment];
+    const uint64_t offset = segment.start + segment.done;
+    const size_t take = static_cast<size_t>(
+        std::min<uint64_t>(size, segment.end - offset));
+    if (take > 0 && !state.file.WriteAt(offset, data, take)) {
+      FailJob(request.job_id, "Could not write " + state.fetch.destination,
+              &lock);
+      return;
+    }
+    segment.done += take;
+    state.progress.completed += take;
+    bytes_received_ += take;
+    // Another segment has taken over the rest of this request's range.
+    if (segment.start + segment.done == segment.end &&
+        request.requested_end > segment.end) {
+      requests_.erase(id);
+      client_.Cancel(id);
+      segment.request = 0;
+      if (!Rebalance(request.job_id, &state)) {
+        MaybeFinishFetch(request.job_id, &lock);
+        if (!lock.owns_lock()) {
+          return;
+        }
+      }
+    }
+    const Clock::time_point now = Clock::now();
+    if (state.ranged && now - state.last_checkpoint >=
+                            std::chrono::milliseconds(
+                                options_.checkpoint_interval_ms)) {
+      Checkpoint(state);
+      state.last_checkpoint = now;
+    }
+  }
+
+  Progress report;
+  if (TakeReport(&state, false, &report)) {
+    lock.unlock();
+    delegate_->OnDownloadProgress(request.job_id, report);
+  }
+}
+
+void ModelDownloader::OnTokenBatch(uint64_t /*id*/,
+                                   const TokenBatch& /*batch*/) {}
+
+void ModelDownloader::OnComplete(uint64_t id) {
+  FinishRequest(id, nullptr);
+}
+
+void ModelDownloader::OnError(uint64_t id, const std::string& message) {
+  FinishRequest(id, &message);
+}
+
+bool ModelDownloader::HandlePullLine(JobState* state, const uint8_t* line,
+                                     size_t size, std::string* error) {
+  if (IsBlank(line, size)) {
+    return true;
+  }
+  const uint8_t* end = line + size;
+  std::string status;
+  std::string digest;
+  std::string message;
+  bool failed = false;
+  int64_t total = -1;
+  int64_t completed = 0;
+  const uint8_t* p = json::ScanObject(
+      line, end,
+      [&](const uint8_t* key, size_t length,
+          const uint8_t* value) -> const uint8_t* {
+        if (json::KeyEquals(key, length, "status")) {
+          return json::ParseString(value, end, &status);
+        }
+        if (json::KeyEquals(key, length, "digest")) {
+          return json::ParseString(value, end, &digest);
+        }
+        if (json::KeyEquals(key, length, "total")) {
+          return json::ParseInt64(value, end, &total);
+        }
+        if (json::KeyEquals(key, length, "completed")) {
+          return json::ParseInt64(value, end, &completed);
+        }
+        if (json::KeyEquals(key, length, "error")) {
+          failed = true;
+          return json::ParseString(value, end, &message);
+        }
+        return json::SkipValue(value, end);
+      });
+  if (p == nullptr) {
+    *error = "Malformed /api/pull progress";
+    return false;
+  }
+  if (failed) {
+    *error = message.empty() ? "Pull failed" : message;
+    return false;
+  }
+
+  Progress& progress = state->progress;
+  if (!digest.empty() && total >= 0) {
+    const uint64_t layer_total = static_cast<uint64_t>(total);
+    const uint64_t layer_completed = std::min<uint64_t>(
+        static_cast<uint64_t>(std::max<int64_t>(completed, 0)), layer_total);
+    auto& layer = state->layers[digest];
+    // Wraps for a moment if a layer goes backwards, but the sums stay exact.
+    progress.completed += layer_completed - layer.first;
+    progress.total += layer_total - layer.second;
+    layer = {layer_completed, layer_total};
+  }
+  if (!status.empty() && status != progress.status) {
+    progress.status = std::move(status);
+    state->urgent = true;
+    state->succeeded = progress.status == "success";
+  }
+  return true;
+}
+
+bool ModelDownloader::PlanFetch(uint64_t job_id, JobState* state,
+                                std::string* error) {
+  const Fetch& fetch = state->fetch;
+  std::error_code ignored;
+  if (!state->ranged || !LoadCheckpoint(state)) {
+    // Whatever is there belongs to another version of the file.
+    std::filesystem::remove(PartPath(fetch), ignored);
+    std::filesystem::remove(StatePath(fetch), ignored);
+    state->segments.clear();
+    const uint64_t total = state->progress.total;
+    if (state->ranged) {
+      const size_t connections = fetch.connections != 0
+                                     ? fetch.connections
+                                     : options_.max_connections;
+      const uint64_t count = std::clamp<uint64_t>(
+          total / options_.min_segment_size, 1, connections);
+      const uint64_t step = total / count;
+      for (uint64_t i = 0; i < count; i++) {
+        Segment segment;
+        segment.start = i * step;
+        segment.end = i + 1 == count ? total : segment.start + step;
+        state->segments.push_back(segment);
+      }
+    } else {
+      Segment segment;
+      segment.end = total != 0 ? total : kUnknownEnd;
+      state->segments.push_back(segment);
+    }
+  }
+  if (!state->file.Open(PartPath(fetch), state->progress.total)) {
+    *error = "Could not create " + fetch.destination + ".part";
+    return false;
+  }
+
+  state->progress.completed = 0;
+  for (const Segment& segment : state->segments) {
+    state->progress.completed += segment.done;
+  }
+  bytes_resumed_ += state->progress.completed;
+  state->last_checkpoint = Clock::now();
+  for (size_t i = 0; i < state->segments.size(); i++) {
+    const Segment& segment = state->segments[i];
+    if (segment.start + segment.done < segment.end) {
+      StartSegment(job_id, state, i);
+    }
+  }
+  return true;
+}
+
+void ModelDownloader::StartSegment(uint64_t job_id, JobState* state,
+                                   size_t index) {
+  Segment& segment = state->segments[index];
+  HttpRequest request;
+  request.host = state->fetch.host;
+  request.port = state->fetch.port;
+  request.path = state->fetch.path;
+  if (state->ranged) {
+    request.headers.emplace_back(
+        "Range", "bytes=" + std::to_string(segment.start + segment.done) +
+                     "-" + std::to_string(segment.end - 1));
+  }
+  request.id = next_request_id_++;
+  segment.request = request.id;
+  Request& entry = requests_[request.id];
+  entry.job_id = job_id;
+  entry.segment = index;
+  entry.requested_end = segment.end;
+  client_.Submit(std::move(request));
+}
+
+bool ModelDownloader::Rebalance(uint64_t job_id, JobState* state) {
+  if (!state->ranged) {
+    return false;
+  }
+  size_t largest = state->segments.size();
+  uint64_t largest_remaining = 0;
+  for (size_t i = 0; i < state->segments.size(); i++) {
+    const Segment& segment = state->segments[i];
+    const uint64_t remaining = segment.end - segment.start - segment.done;
+    if (segment.request != 0 && remaining > largest_remaining) {
+      largest = i;
+      largest_remaining = remaining;
+    }
+  }
+  if (largest == state->segments.size() ||
+      largest_remaining < 2 * options_.min_segment_size) {
+    return false;
+  }
+  Segment& victim = state->segments[largest];
+  Segment tail;
+  tail.start = victim.start + victim.done + largest_remaining / 2;
+  tail.end = victim.end;
+  victim.end = tail.start;
+  state->segments.push_back(tail);
+  StartSegment(job_id, state, state->segments.size() - 1);
+  return true;
+}
+
+void ModelDownloader::Checkpoint(const JobState& state) const {
+  if (!state.is_fetch || !state.ranged || !state.file.is_open()) {
+    return;
+  }
+  std::vector<uint8_t> data;
+  WireWriter writer(&data);
+  writer.WriteU32(kCheckpointMagic);
+  writer.WriteU32(kCheckpointVersion);
+  writer.WriteU64(state.progress.total);
+  writer.WriteString(state.validator);
+  writer.WriteU32(static_cast<uint32_t>(state.segments.size()));
+  for (const Segment& segment : state.segments) {
+    writer.WriteU64(segment.start);
+    writer.WriteU64(segment.end);
+    writer.WriteU64(segment.done);
+  }
+
+  // Written aside and renamed over, so a crash mid-write leaves the last
+  // complete checkpoint.
+  const std::filesystem::path path = StatePath(state.fetch);
+  std::filesystem::path temporary = path;
+  temporary += ".tmp";
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(data.data()),
+              static_cast<std::streamsize>(data.size()));
+    if (!out) {
+      return;
+    }
+  }
+  std::error_code ignored;
+  std::filesystem::rename(temporary, path, ignored);
+}
+
+bool ModelDownloader::LoadCheckpoint(JobState* state) const {
+  std::error_code error;
+  const uint64_t part_size =
+      std::filesystem::file_size(PartPath(state->fetch), error);
+  if (error || part_size != state->progress.total) {
+    return false;
+  }
+  std::ifstream in(StatePath(state->fetch), std::ios::binary);
+  const std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)),
+                                  std::istreambuf_iterator<char>());
+  WireReader reader(data.data(), data.size());
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint64_t total = 0;
+  std::string validator;
+  uint32_t count = 0;
+  reader.ReadU32(&magic);
+  reader.ReadU32(&version);
+  reader.ReadU64(&total);
+  reader.ReadString(&validator);
+  reader.ReadU32(&count);
+  if (!reader.ok() || magic != kCheckpointMagic ||
+      version != kCheckpointVersion || total != state->progress.total ||
+      validator != state->validator || count == 0) {
+    return false;
+  }
+  std::vector<Segment> segments;
+  for (uint32_t i = 0; i < count && reader.ok(); i++) {
+    Segment segment;
+    reader.ReadU64(&segment.start);
+    reader.ReadU64(&segment.end);
+    reader.ReadU64(&segment.done);
+    if (segment.start > segment.end || segment.end > total ||
+        segment.done > segment.end - segment.start) {
+      return false;
+    }
+    segments.push_back(segment);
+  }
+  if (!reader.ok()) {
+    return false;
+  }
+  state->segments = std::move(segments);
+  return true;
+}
+
+bool ModelDownloader::TakeReport(JobState* state, bool force,
+                                 Progress* report) {
+  const Clock::time_point now = Clock::now();
+  const auto elapsed = now - state->last_report;
+  if (!force && !state->urgent &&
+      elapsed < std::chrono::milliseconds(options_.progress_interval_ms)) {
+    progress_coalesced_++;
+    return false;
+  }
+  Progress& progress = state->progress;
+  const int64_t elapsed_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+  if (state->last_report != Clock::time_point() && elapsed_ms > 0 &&
+      progress.completed >= state->completed_at_report) {
+    const uint64_t rate = (progress.completed - state->completed_at_report) *
+                          1000 / static_cast<uint64_t>(elapsed_ms);
+    progress.bytes_per_second =
+        progress.bytes_per_second == 0
+            ? rate
+            : (progress.bytes_per_second * 7 + rate * 3) / 10;
+  }
+  state->last_report = now;
+  state->completed_at_report = progress.completed;
+  state->urgent = false;
+  progress_reports_++;
+  *report = progress;
+  return true;
+}
+
+void ModelDownloader::FinishRequest(uint64_t request_id,
+                                    const std::string* error) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto request_it = requests_.find(request_id);
+  if (request_it == requests_.end()) {
+    return;
+  }
+  const Request request = request_it->second;
+  requests_.erase(request_it);
+  auto job = jobs_.find(request.job_id);
+  if (job == jobs_.end()) {
+    return;
+  }
+  JobState& state = job->second;
+
+  auto status_error = [&](const char* what) {
+    std::string message = std::string(what) + " answered " +
+                          std::to_string(request.status_code);
+    if (!state.error_body.empty()) {
+      message += ": " + state.error_body;
+    }
+    return message;
+  };
+
+  if (!state.is_fetch) {
+    std::string message;
+    if (error != nullptr) {
+      message = *error;
+    } else if (request.status_code != 200) {
+      message = status_error("/api/pull");
+    } else if (!state.line.empty()) {
+      // A last line without a newline.
+      HandlePullLine(&state,
+                     reinterpret_cast<const uint8_t*>(state.line.data()),
+                     state.line.size(), &message);
+    }
+    if (message.empty() && !state.succeeded) {
+      message = "Pull ended before it succeeded";
+    }
+    if (!message.empty()) {
+      FailJob(request.job_id, message, &lock);
+      return;
+    }
+    Progress report;
+    TakeReport(&state, true, &report);
+    jobs_.erase(job);
+    CompleteJob(request.job_id, report, &lock);
+    return;
+  }
+
+  if (request.probe) {
+    // Servers that refuse HEAD still get a plain GET.
+    std::string message;
+    if (error != nullptr) {
+      FailJob(request.job_id, *error, &lock);
+    } else if (!PlanFetch(request.job_id, &state, &message)) {
+      FailJob(request.job_id, message, &lock);
+    } else {
+      MaybeFinishFetch(request.job_id, &lock);
+    }
+    return;
+  }
+
+  Segment& segment = state.segments[request.segment];
+  segment.request = 0;
+  const int expected = state.ranged ? 206 : 200;
+  if (error == nullptr && request.status_code != expected) {
+    FailJob(request.job_id, status_error(state.fetch.path.c_str()), &lock);
+    return;
+  }
+  const bool unbounded = segment.end == kUnknownEnd;
+  if (unbounded && error == nullptr) {
+    segment.end = segment.done;
+    state.progress.total = state.progress.completed;
+  }
+  if (segment.start + segment.done < segment.end) {
+    // Cut off early; a ranged segment picks up where it stopped.
+    if (!state.ranged || ++state.retries > kMaxRetries) {
+      FailJob(request.job_id,
+              error != nullptr ? *error : "Connection closed mid-download",
+              &lock);
+      return;
+    }
+    StartSegment(request.job_id, &state, request.segment);
+    return;
+  }
+  state.retries = 0;
+  if (!Rebalance(request.job_id, &state)) {
+    MaybeFinishFetch(request.job_id, &lock);
+  }
+}
+
+void ModelDownloader::MaybeFinishFetch(uint64_t job_id,
+                                       std::unique_lock<std::mutex>* lock) {
+  auto job = jobs_.find(job_id);
+  if (job == jobs_.end()) {
+    return;
+  }
+  JobState& state = job->second;
+  bool complete = true;
+  for (const Segment& segment : state.segments) {
+    if (segment.request != 0) {
+      return;
+    }
+    complete = complete && segment.start + segment.done == segment.end;
+  }
+  if (!complete) {
+    FailJob(job_id, "Download ended incomplete", lock);
+    return;
+  }
+  state.file.Close();
+  const Fetch& fetch = state.fetch;
+  std::error_code error;
+  std::filesystem::rename(PartPath(fetch), std::filesystem::u8path(
+                                               fetch.destination),
+                          error);
+  if (error) {
+    FailJob(job_id, "Could not move the download to " + fetch.destination,
+            lock);
+    return;
+  }
+  std::filesystem::remove(StatePath(fetch), error);
+  Progress report;
+  TakeReport(&state, true, &report);
+  jobs_.erase(job);
+  CompleteJob(job_id, report, lock);
+}
+
+void ModelDownloader::CompleteJob(uint64_t job_id, const Progress& report,
+                                  std::unique_lock<std::mutex>* lock) {
+  jobs_completed_++;
+  lock->unlock();
+  delegate_->OnDownloadProgress(job_id, report);
+  delegate_->OnDownloadComplete(job_id);
+}
+
+void ModelDownloader::DropJob(uint64_t job_id) {
+  for (auto it = requests_.begin(); it != requests_.end();) {
+    if (it->second.job_id == job_id) {
+      client_.Cancel(it->first);
+      it = requests_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  auto job = jobs_.find(job_id);
+  if (job != jobs_.end()) {
+    Checkpoint(job->second);
+    jobs_.erase(job);
+  }
+}
+
+void ModelDownloader::FailJob(uint64_t job_id, const std::string& message,
+                              std::unique_lock<std::mutex>* lock) {
+  DropJob(job_id);
+  lock->unlock();
+  delegate_->OnDownloadError(job_id, message);
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,235 @@
+#ifndef NATIVE_MODEL_DOWNLOADER_H_
+#define NATIVE_MODEL_DOWNLOADER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "native/http_response_parser.h"
+#include "native/http_stream_client.h"
+#include "native/preallocated_file.h"
+
+namespace cloudtolocalllm {
+
+// Drives multi-GB model transfers off the UI isolate: Ollama pulls, and
+// direct downloads of model files (GGUF imports) from a plain-HTTP mirror.
+//
+// A pull is one POST /api/pull whose NDJSON progress lines are parsed on
+// the HTTP worker. Per-layer totals are summed into one figure for the
+// whole model, and reports are coalesced to one per
+// Options::progress_interval_ms (a status change, the end and any error
+// are always reported at once), so Dart sees ten updates a second rather
+// than one per line.
+//
+// A fetch probes the file with HEAD. If the server takes byte ranges it is
+// split into up to |connections| segments fetched in parallel into a
+// PreallocatedFile "<destination>.part"; a segment that finishes early
+// takes over the second half of the largest one still running, so the link
+// stays saturated to the last byte. Progress is checkpointed every
+// Options::checkpoint_interval_ms, and on cancel or failure, to
+// "<destination>.part.state", and a later fetch of the same file (same
+// size and ETag or Last-Modified) carries on from there. When every byte
+// has arrived the .part file is renamed to |destination|. Servers without
+// ranges get one streaming GET, restarted from zero each time.
+//
+// Thread-safe. Delegate methods run on the HTTP worker and must hand off
+// rather than block.
+class ModelDownloader : public HttpStreamClient::Delegate {
+ public:
+  struct Options {
+    // Ranged requests per fetch when the fetch asks for zero.
+    size_t max_connections = 4;
+    // Segments are not split below this.
+    uint64_t min_segment_size = 16 * 1024 * 1024;
+    // Least time between two progress reports of one job.
+    int progress_interval_ms = 100;
+    // How often a fetch's resume state is written.
+    int checkpoint_interval_ms = 1000;
+  };
+
+  struct Pull {
+    uint64_t id = 0;
+    std::string host = "localhost";
+    uint16_t port = 11434;
+    std::string model;
+  };
+
+  struct Fetch {
+    uint64_t id = 0;
+    std::string host;
+    uint16_t port = 80;
+    std::string path = "/";
+    // UTF-8 path of the finished file.
+    std::string destination;
+    // Zero picks Options::max_connections.
+    size_t connections = 0;
+  };
+
+  struct Progress {
+    // Ollama's status line for pulls ("pulling 6a0746a1ec1a", "verifying
+    // sha256 digest", ...); "downloading" for fetches.
+    std::string status;
+    uint64_t completed = 0;
+    // Zero while unknown.
+    uint64_t total = 0;
+    // Smoothed over recent reports.
+    uint64_t bytes_per_second = 0;
+  };
+
+  class Delegate {
+   public:
+    virtual ~Delegate() = default;
+    virtual void OnDownloadProgress(uint64_t job_id,
+                                    const Progress& progress) = 0;
+    virtual void OnDownloadComplete(uint64_t job_id) = 0;
+    virtual void OnDownloadError(uint64_t job_id,
+                                 const std::string& message) = 0;
+  };
+
+  struct Stats {
+    uint64_t jobs_completed = 0;
+    uint64_t bytes_received = 0;
+    // Bytes a fetch did not have to download again.
+    uint64_t bytes_resumed = 0;
+    uint64_t progress_reports = 0;
+    // Progress updates folded into a later report.
+    uint64_t progress_coalesced = 0;
+  };
+
+  // |delegate| must outlive the downloader.
+  explicit ModelDownloader(Delegate* delegate);
+  ModelDownloader(Delegate* delegate, const Options& options);
+  ~ModelDownloader() override;
+
+  // Prevent copying.
+  ModelDownloader(ModelDownloader const&) = delete;
+  ModelDownloader& operator=(ModelDownloader const&) = delete;
+
+  // Starts the HTTP worker. Returns false if it could not be started.
+  bool Start();
+
+  // Stops the worker; fetches in progress are checkpointed and dropped
+  // without a callback. Called automatically on destruction.
+  void Stop();
+
+  void SubmitPull(Pull pull);
+  void SubmitFetch(Fetch fetch);
+
+  // Abandons job |id|, keeping a fetch's partial file for a later resume.
+  // No further callbacks are made for it. Returns false if there is no
+  // such job.
+  bool Cancel(uint64_t id);
+
+  Stats stats() const;
+
+  // HttpStreamClient::Delegate:
+  void OnResponseStarted(uint64_t id, int status_code,
+                         HttpHeaderView headers) override;
+  void OnBodyData(uint64_t id, const uint8_t* data, size_t size) override;
+  void OnTokenBatch(uint64_t id, const TokenBatch& batch) override;
+  void OnComplete(uint64_t id) override;
+  void OnError(uint64_t id, const std::string& message) override;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // A byte range [start, end) of a fetch, |done| bytes of it written.
+  struct Segment {
+    uint64_t start = 0;
+    uint64_t end = 0;
+    uint64_t done = 0;
+    // The request filling it, or zero while it is idle.
+    uint64_t request = 0;
+  };
+
+  struct JobState {
+    bool is_fetch = false;
+    Pull pull;
+    Fetch fetch;
+    Progress progress;
+    // Start of an unexpected response, quoted in the error.
+    std::string error_body;
+    Clock::time_point last_report;
+    uint64_t completed_at_report = 0;
+    // Report at the next chance, whatever the interval.
+    bool urgent = false;
+
+    // Pulls: the unterminated tail of the body, and each layer's
+    // (completed, total) by digest.
+    std::string line;
+    std::unordered_map<std::string, std::pair<uint64_t, uint64_t>> layers;
+    bool succeeded = false;
+
+    // Fetches.
+    bool ranged = false;
+    std::string validator;
+    std::vector<Segment> segments;
+    PreallocatedFile file;
+    Clock::time_point last_checkpoint;
+    int retries = 0;
+  };
+
+  // What an outstanding request is for.
+  struct Request {
+    uint64_t job_id = 0;
+    bool probe = false;
+    size_t segment = 0;
+    // The last byte asked for plus one; past a segment's end once it has
+    // been split.
+    uint64_t requested_end = 0;
+    int status_code = 0;
+  };
+
+  // Called with |mutex_| held. Those taking |error| return false with it
+  // set if the job cannot go on, for the caller to report.
+  bool HandlePullLine(JobState* state, const uint8_t* line, size_t size,
+                      std::string* error);
+  bool PlanFetch(uint64_t job_id, JobState* state, std::string* error);
+  void StartSegment(uint64_t job_id, JobState* state, size_t index);
+  // Splits the largest running segment to keep a connection busy; true if
+  // it started a new one.
+  bool Rebalance(uint64_t job_id, JobState* state);
+  void Checkpoint(const JobState& state) const;
+  bool LoadCheckpoint(JobState* state) const;
+  // Whether |state| is due a progress report; |force| skips the interval.
+  bool TakeReport(JobState* state, bool force, Progress* report);
+
+  void FinishRequest(uint64_t request_id, const std::string* error);
+  // Renames the download into place once no segment is running; |lock| is
+  // released if the job ends.
+  void MaybeFinishFetch(uint64_t job_id, std::unique_lock<std::mutex>* lock);
+  // Reports the end of |job_id|, which must have been removed; |lock| is
+  // released.
+  void CompleteJob(uint64_t job_id, const Progress& report,
+                   std::unique_lock<std::mutex>* lock);
+  // Cancels every request of |job_id|, checkpoints it and forgets it.
+  void DropJob(uint64_t job_id);
+  // Drops |job_id| and reports |message|; |lock| is released.
+  void FailJob(uint64_t job_id, const std::string& message,
+               std::unique_lock<std::mutex>* lock);
+
+  Delegate* delegate_;
+  Options options_;
+  HttpStreamClient client_;
+  bool started_;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<uint64_t, JobState> jobs_;
+  std::unordered_map<uint64_t, Request> requests_;
+  uint64_t next_request_id_;
+
+  std::atomic<uint64_t> jobs_completed_;
+  std::atomic<uint64_t> bytes_received_;
+  std::atomic<uint64_t> bytes_resumed_;
+  std::atomic<uint64_t> progress_reports_;
+  std::atomic<uint64_t> progress_coalesced_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_MODEL_DOWNLOADER_H_
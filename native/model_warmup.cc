@@ -0,0 +1,185 @@
+#include "native/model_warmup.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "native/latency_metrics.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+void AppendJsonString(const std::string& value, std::string* out) {
+  static const char kHex[] = "0123456789abcdef";
+  out->push_back('"');
+  for (char c : value) {
+    const unsigned char byte = static_cast<unsigned char>(c);
+    if (c == '"' || c == '\\') {
+      out->push_back('\\');
+      out->push_back(c);
+    } else if (byte < 0x20) {
+      out->append("\\u00");
+      out->push_back(kHex[byte >> 4]);
+      out->push_back(kHex[byte & 0xf]);
+    } else {
+      out->push_back(c);
+    }
+  }
+  out->push_back('"');
+}
+
+}  // namespace
+
+ModelWarmup::ModelWarmup(std::shared_ptr<const ResourceMonitor> monitor)
+    : ModelWarmup(std::move(monitor), Options()) {}
+
+ModelWarmup::ModelWarmup(std::shared_ptr<const ResourceMonitor> monitor,
+                         const Options& options)
+    : monitor_(std::move(monitor)), options_(options), client_(this) {}
+
+ModelWarmup::~ModelWarmup() {
+  // No callback may run once the members below the client are gone.
+  client_.Stop();
+}
+
+void ModelWarmup::SetModel(const std::string& host, uint16_t port,
+                           const std::string& model, uint64_t size_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (model != model_ || host != host_ || port != port_) {
+    ever_started_ = false;
+  }
+  host_ = host;
+  port_ = port;
+  model_ = model;
+  size_bytes_ = size_bytes;
+}
+
+WarmupResult ModelWarmup::Warm(WarmupTrigger trigger) {
+  HttpRequest request;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (model_.empty()) {
+      return WarmupResult::kNoModel;
+    }
+    if (in_flight_ != 0) {
+      return WarmupResult::kInFlight;
+    }
+    const Clock::time_point now = Clock::now();
+    if (trigger == WarmupTrigger::kFocus && ever_started_ &&
+        now - last_start_ < std::chrono::milliseconds(options_.cooldown_ms)) {
+      skipped_cooling_down_++;
+      return WarmupResult::kCoolingDown;
+    }
+    if (!HasRoom(size_bytes_)) {
+      skipped_no_room_++;
+      return WarmupResult::kNoRoom;
+    }
+    if (!client_started_) {
+      client_started_ = client_.Start();
+      if (!client_started_) {
+        return WarmupResult::kUnavailable;
+      }
+    }
+
+    request.id = next_id_++;
+    request.method = "POST";
+    request.host = host_;
+    request.port = port_;
+    request.path = "/api/generate";
+    request.headers.emplace_back("Content-Type", "application/json");
+    // No prompt: Ollama loads the model and answers without generating.
+    request.body = "{\"model\":";
+    AppendJsonString(model_, &request.body);
+    request.body += ",\"keep_alive\":";
+    AppendJsonString(options_.keep_alive, &request.body);
+    request.body += ",\"stream\":false}";
+
+    in_flight_ = request.id;
+    status_code_ = 0;
+    last_start_ = now;
+    ever_started_ = true;
+  }
+  started_count_++;
+  client_.Submit(std::move(request));
+  return WarmupResult::kStarted;
+}
+
+ModelWarmup::Stats ModelWarmup::stats() const {
+  Stats stats;
+  stats.started = started_count_.load();
+  stats.completed = completed_.load();
+  stats.failed = failed_.load();
+  stats.skipped_no_room = skipped_no_room_.load();
+  stats.skipped_cooling_down = skipped_cooling_down_.load();
+  stats.saved_micros = saved_micros_.load();
+  return stats;
+}
+
+void ModelWarmup::OnResponseStarted(uint64_t id, int status_code,
+                                    HttpHeaderView /*headers*/) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (id == in_flight_) {
+    status_code_ = status_code;
+  }
+}
+
+void ModelWarmup::OnBodyData(uint64_t /*id*/, const uint8_t* /*data*/,
+                             size_t /*size*/) {}
+
+void ModelWarmup::OnTokenBatch(uint64_t /*id*/, const TokenBatch& /*batch*/) {
+}
+
+void ModelWarmup::OnComplete(uint64_t id) {
+  Finish(id, true);
+}
+
+void ModelWarmup::OnError(uint64_t id, const std::string& /*message*/) {
+  Finish(id, false);
+}
+
+bool ModelWarmup::HasRoom(uint64_t size_bytes) const {
+  ResourceSample sample;
+  if (monitor_ == nullptr || !monitor_->Latest(&sample)) {
+    return true;
+  }
+  const uint64_t needed = size_bytes > 0 ? size_bytes : options_.min_free_bytes;
+  if ((sample.gpu_source == GpuSource::kNvml ||
+       sample.gpu_source == GpuSource::kSysfs) &&
+      sample.gpu_memory_total > 0) {
+    const uint64_t used =
+        std::min(sample.gpu_memory_used, sample.gpu_memory_total);
+    return sample.gpu_memory_total - used >= needed;
+  }
+  if (sample.gpu_source == GpuSource::kNone && sample.memory_total > 0) {
+    return sample.memory_available >= needed;
+  }
+  return true;
+}
+
+void ModelWarmup::Finish(uint64_t id, bool succeeded) {
+  uint64_t micros = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id != in_flight_) {
+      return;
+    }
+    in_flight_ = 0;
+    succeeded = succeeded && status_code_ >= 200 && status_code_ < 300;
+    if (succeeded) {
+      micros = static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                                last_start_)
+              .count());
+    }
+  }
+  if (!succeeded) {
+    failed_++;
+    return;
+  }
+  completed_++;
+  saved_micros_ += micros;
+  LatencyMetrics::Get()->Record(LatencyPath::kLocalOllama,
+                                LatencyKind::kWarmupSaved, micros);
+}
+
+}  // namespace cloudtolocalllm
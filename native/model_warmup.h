@@ -0,0 +1,148 @@
+#ifndef NATIVE_MODEL_WARMUP_H_
+#define NATIVE_MODEL_WARMUP_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "native/http_response_parser.h"
+#include "native/http_stream_client.h"
+#include "native/resource_monitor.h"
+
+namespace cloudtolocalllm {
+
+// What asked for a warm-up.
+enum class WarmupTrigger : uint8_t {
+  kLaunch = 0,
+  // The window was activated or focused.
+  kFocus = 1,
+  kTray = 2,
+  // A model was picked for the chat.
+  kSelect = 3,
+};
+
+enum class WarmupResult : uint8_t {
+  kStarted = 0,
+  // No model has been set yet.
+  kNoModel = 1,
+  // A warm-up is already running.
+  kInFlight = 2,
+  // A focus warm-up within Options::cooldown_ms of the last start.
+  kCoolingDown = 3,
+  // The resource monitor says the model would not fit.
+  kNoRoom = 4,
+  // The HTTP worker could not be started.
+  kUnavailable = 5,
+};
+
+// Loads the last-used model into Ollama ahead of the first chat, so that
+// chat does not wait the several seconds a cold load takes.
+//
+// A warm-up is a POST /api/generate naming the model with no prompt and a
+// keep_alive, which makes Ollama load the model and keep it for that long
+// without generating a token. The runners ask for one when the window is
+// activated, Dart at launch, when a model is picked and on tray clicks.
+// Focus warm-ups within the cooldown of the last are turned away, so asking
+// on every activation is cheap; the others, which the user is about to
+// follow with a chat, only wait for one in flight.
+//
+// Before a request is sent, the newest ResourceMonitor sample is checked.
+// Where it reports GPU memory in use (NVML, amdgpu) and less is free than
+// the model's size, the warm-up is skipped rather than evicting whatever
+// holds the GPU; on hosts without such a GPU, available RAM stands in.
+// Without a sample, or with DXGI's totals only, it goes ahead.
+//
+// How long a successful warm-up took is the load the next first token no
+// longer waits for; it is recorded as LatencyKind::kWarmupSaved on the
+// local path of LatencyMetrics.
+//
+// Thread-safe. The HTTP worker is started on the first warm-up.
+class ModelWarmup : public HttpStreamClient::Delegate {
+ public:
+  struct Options {
+    // Least time between the start of a warm-up and a focus warm-up.
+    int cooldown_ms = 60000;
+    // Ollama's keep_alive for the warmed model.
+    std::string keep_alive = "30m";
+    // Room required where the model's size is unknown.
+    uint64_t min_free_bytes = 512ull * 1024 * 1024;
+  };
+
+  struct Stats {
+    uint64_t started = 0;
+    uint64_t completed = 0;
+    uint64_t failed = 0;
+    uint64_t skipped_no_room = 0;
+    uint64_t skipped_cooling_down = 0;
+    // Sum of the load times recorded in LatencyMetrics.
+    uint64_t saved_micros = 0;
+  };
+
+  // |monitor|, if given, supplies the memory figures the room check reads.
+  explicit ModelWarmup(std::shared_ptr<const ResourceMonitor> monitor);
+  ModelWarmup(std::shared_ptr<const ResourceMonitor> monitor,
+              const Options& options);
+  ~ModelWarmup() override;
+
+  // Prevent copying.
+  ModelWarmup(ModelWarmup const&) = delete;
+  ModelWarmup& operator=(ModelWarmup const&) = delete;
+
+  // The model to keep warm and the Ollama serving it. |size_bytes| is the
+  // model's size as /api/tags reports it, or zero if unknown. A new model
+  // may be warmed at once, whatever the cooldown.
+  void SetModel(const std::string& host, uint16_t port,
+                const std::string& model, uint64_t size_bytes);
+
+  WarmupResult Warm(WarmupTrigger trigger);
+
+  Stats stats() const;
+
+  // HttpStreamClient::Delegate:
+  void OnResponseStarted(uint64_t id, int status_code,
+                         HttpHeaderView headers) override;
+  void OnBodyData(uint64_t id, const uint8_t* data, size_t size) override;
+  void OnTokenBatch(uint64_t id, const TokenBatch& batch) override;
+  void OnComplete(uint64_t id) override;
+  void OnError(uint64_t id, const std::string& message) override;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // Whether |size_bytes| fits in what the newest sample leaves free.
+  bool HasRoom(uint64_t size_bytes) const;
+  void Finish(uint64_t id, bool succeeded);
+
+  const std::shared_ptr<const ResourceMonitor> monitor_;
+  const Options options_;
+  HttpStreamClient client_;
+
+  mutable std::mutex mutex_;
+  bool client_started_ = false;
+  std::string host_;
+  uint16_t port_ = 0;
+  std::string model_;
+  uint64_t size_bytes_ = 0;
+  // The warm-up in flight, or zero.
+  uint64_t in_flight_ = 0;
+  int status_code_ = 0;
+  uint64_t next_id_ = 1;
+  // When the one in flight or the last one started.
+  Clock::time_point last_start_;
+  bool ever_started_ = false;
+
+  std::atomic<uint64_t> started_count_{0};
+  std::atomic<uint64_t> completed_{0};
+  std::atomic<uint64_t> failed_{0};
+  std::atomic<uint64_t> skipped_no_room_{0};
+  std::atomic<uint64_t> skipped_cooling_down_{0};
+  std::atomic<uint64_t> saved_micros_{0};
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_MODEL_WARMUP_H_
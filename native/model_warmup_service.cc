@@ -0,0 +1,71 @@
+#include "native/model_warmup_service.h"
+
+#include <string>
+#include <utility>
+
+namespace cloudtolocalllm {
+
+ModelWarmupService::ModelWarmupService(
+    std::shared_ptr<const ResourceMonitor> monitor)
+    : warmup_(std::move(monitor)) {}
+
+ModelWarmupService::~ModelWarmupService() = default;
+
+void ModelWarmupService::HandleMessage(const uint8_t* message, size_t size,
+                                       std::vector<uint8_t>* reply) {
+  reply->clear();
+
+  WireReader reader(message, size);
+  uint8_t op;
+  if (!reader.ReadU8(&op)) {
+    return;
+  }
+  if (!Handle(op, &reader, reply)) {
+    reply->clear();
+  } else if (reply->empty()) {
+    reply->push_back(1);
+  }
+}
+
+bool ModelWarmupService::Handle(uint8_t op, WireReader* reader,
+                                std::vector<uint8_t>* reply) {
+  WireWriter writer(reply);
+  switch (op) {
+    case kSetModel: {
+      std::string host;
+      uint16_t port;
+      std::string model;
+      uint64_t size_bytes;
+      if (!reader->ReadString(&host) || !reader->ReadU16(&port) ||
+          !reader->ReadString(&model) || !reader->ReadU64(&size_bytes)) {
+        return false;
+      }
+      warmup_.SetModel(host, port, model, size_bytes);
+      return true;
+    }
+    case kWarm: {
+      uint8_t trigger;
+      if (!reader->ReadU8(&trigger) ||
+          trigger > static_cast<uint8_t>(WarmupTrigger::kSelect)) {
+        return false;
+      }
+      writer.WriteU8(static_cast<uint8_t>(
+          warmup_.Warm(static_cast<WarmupTrigger>(trigger))));
+      return true;
+    }
+    case kStats: {
+      const ModelWarmup::Stats stats = warmup_.stats();
+      writer.WriteU64(stats.started);
+      writer.WriteU64(stats.completed);
+      writer.WriteU64(stats.failed);
+      writer.WriteU64(stats.skipped_no_room);
+      writer.WriteU64(stats.skipped_cooling_down);
+      writer.WriteU64(stats.saved_micros);
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,58 @@
+#ifndef NATIVE_MODEL_WARMUP_SERVICE_H_
+#define NATIVE_MODEL_WARMUP_SERVICE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "native/model_warmup.h"
+#include "native/resource_monitor.h"
+#include "native/wire_format.h"
+
+namespace cloudtolocalllm {
+
+// Platform-neutral handler behind the "cloudtolocalllm/model_warmup" binary
+// channel, through which Dart names the model to keep warm and asks for
+// warm-ups the runner cannot see, such as tray clicks. The runners also
+// call warmup()->Warm() themselves when the window is activated.
+//
+// Requests are `u8 op` followed by an op-specific payload:
+//
+//   kSetModel (1)  string host, u16 port, string model, u64 model size in
+//                  bytes (0 if unknown)
+//   kWarm     (2)  u8 WarmupTrigger; replies with u8 WarmupResult
+//   kStats    (3)  no payload; replies with u64 started, u64 completed,
+//                  u64 failed, u64 skipped for lack of room, u64 skipped
+//                  while cooling down and u64 microseconds of load saved,
+//                  all since launch
+//
+// kSetModel replies with one byte. Malformed requests get an empty reply.
+class ModelWarmupService {
+ public:
+  static constexpr uint8_t kSetModel = 1;
+  static constexpr uint8_t kWarm = 2;
+  static constexpr uint8_t kStats = 3;
+
+  // |monitor|, if given, is checked for room before each warm-up.
+  explicit ModelWarmupService(std::shared_ptr<const ResourceMonitor> monitor);
+  ~ModelWarmupService();
+
+  // Prevent copying.
+  ModelWarmupService(ModelWarmupService const&) = delete;
+  ModelWarmupService& operator=(ModelWarmupService const&) = delete;
+
+  void HandleMessage(const uint8_t* message, size_t size,
+                     std::vector<uint8_t>* reply);
+
+  ModelWarmup* warmup() { return &warmup_; }
+
+ private:
+  bool Handle(uint8_t op, WireReader* reader, std::vector<uint8_t>* reply);
+
+  ModelWarmup warmup_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_MODEL_WARMUP_SERVICE_H_
@@ -0,0 +1,54 @@
+#include "native/ndjson_parser_service.h"
+
+#include "native/wire_format.h"
+
+namespace cloudtolocalllm {
+
+NdjsonParserService::NdjsonParserService() = default;
+
+NdjsonParserService::~NdjsonParserService() = default;
+
+void NdjsonParserService::HandleMessage(const uint8_t* message, size_t size,
+                                        std::vector<uint8_t>* reply) {
+  reply->clear();
+
+  WireReader reader(message, size);
+  uint8_t op;
+  uint32_t stream_id;
+  if (!reader.ReadU8(&op) || !reader.ReadU32(&stream_id)) {
+    return;
+  }
+
+  switch (op) {
+    case kOpen:
+      streams_[stream_id] = std::make_unique<Stream>();
+      return;
+    case kClose:
+      streams_.erase(stream_id);
+      return;
+    case kFeed:
+    case kFinish: {
+      auto it = streams_.find(stream_id);
+      if (it == streams_.end()) {
+        return;
+      }
+      Stream* stream = it->second.get();
+      stream->batch.Reset();
+      if (op == kFeed) {
+        stream->scanner.Feed(reader.current(), reader.remaining(),
+                             &stream->batch);
+      } else {
+        stream->scanner.Finish(&stream->batch);
+      }
+      stream->batch.Encode(reply);
+      if (op == kFinish) {
+        streams_.erase(it);
+      }
+      return;
+    }
+    default:
+      return;
+  }
+}
+
+}  // namespace cloudtolocalllm
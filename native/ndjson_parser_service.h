@@ -0,0 +1,52 @@
+#ifndef NATIVE_NDJSON_PARSER_SERVICE_H_
+#define NATIVE_NDJSON_PARSER_SERVICE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "native/ndjson_token_scanner.h"
+
+namespace cloudtolocalllm {
+
+// Platform-neutral handler behind the "cloudtolocalllm/ndjson_parser" binary
+// channel. The runner glue on each platform forwards raw messages here and
+// sends back whatever is written to |reply|.
+//
+// Requests are `u8 op, u32 stream_id` followed by an op-specific payload:
+//
+//   kOpen   (1)  no payload; starts a new stream (replaces an existing one)
+//   kFeed   (2)  raw response-body bytes
+//   kFinish (3)  no payload; flushes a trailing unterminated line and closes
+//   kClose  (4)  no payload; drops the stream without flushing
+//
+// kFeed and kFinish reply with a TokenBatch (see TokenBatch::Encode); kOpen
+// and kClose reply with an empty message. Malformed requests also get an
+// empty reply, which the Dart side treats as "native parsing unavailable".
+class NdjsonParserService {
+ public:
+  static constexpr uint8_t kOpen = 1;
+  static constexpr uint8_t kFeed = 2;
+  static constexpr uint8_t kFinish = 3;
+  static constexpr uint8_t kClose = 4;
+
+  NdjsonParserService();
+  ~NdjsonParserService();
+
+  void HandleMessage(const uint8_t* message, size_t size,
+                     std::vector<uint8_t>* reply);
+
+ private:
+  struct Stream {
+    NdjsonTokenScanner scanner;
+    TokenBatch batch;
+  };
+
+  std::unordered_map<uint32_t, std::unique_ptr<Stream>> streams_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_NDJSON_PARSER_SERVICE_H_
@@ -0,0 +1,197 @@
+#include "native/ndjson_token_scanner.h"
+
+#include "native/byte_scan.h"
+#include "native/json_scan.h"
+#include "native/wire_format.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+// Initial capacity for the per-stream buffers; a typical delta is a few
+// bytes, a typical final line a few hundred.
+constexpr size_t kInitialTextCapacity = 4096;
+constexpr size_t kInitialCarryCapacity = 1024;
+
+}  // namespace
+
+TokenBatch::TokenBatch() {
+  text_.reserve(kInitialTextCapacity);
+  Reset();
+}
+
+void TokenBatch::Reset() {
+  text_.clear();
+  token_count_ = 0;
+  done_ = false;
+  has_error_ = false;
+  error_.clear();
+  has_stats_ = false;
+  stats_ = OllamaDoneStats();
+}
+
+void TokenBatch::Encode(std::vector<uint8_t>* out) const {
+  uint8_t flags = 0;
+  if (done_) {
+    flags |= kDone;
+  }
+  if (has_error_) {
+    flags |= kError;
+  }
+  if (has_stats_) {
+    flags |= kHasStats;
+  }
+  WireWriter writer(out);
+  writer.WriteU8(flags);
+  writer.WriteU32(token_count_);
+  writer.WriteString(text_);
+  if (has_stats_) {
+    writer.WriteI64(stats_.total_duration);
+    writer.WriteI64(stats_.load_duration);
+    writer.WriteI64(stats_.prompt_eval_count);
+    writer.WriteI64(stats_.prompt_eval_duration);
+    writer.WriteI64(stats_.eval_count);
+    writer.WriteI64(stats_.eval_duration);
+  }
+  if (has_error_) {
+    writer.WriteString(error_);
+  }
+}
+
+NdjsonTokenScanner::NdjsonTokenScanner() : malformed_lines_(0) {
+  carry_.reserve(kInitialCarryCapacity);
+}
+
+void NdjsonTokenScanner::Feed(const uint8_t* data, size_t size,
+                              TokenBatch* batch) {
+  const uint8_t* p = data;
+  const uint8_t* end = data + size;
+  while (p < end) {
+    const uint8_t* newline = FindByte(p, end, '\n');
+    if (newline == end) {
+      carry_.append(reinterpret_cast<const char*>(p),
+                    static_cast<size_t>(end - p));
+      return;
+    }
+    if (carry_.empty()) {
+      ScanLine(p, newline, batch);
+    } else {
+      carry_.append(reinterpret_cast<const char*>(p),
+                    static_cast<size_t>(newline - p));
+      const uint8_t* line = reinterpret_cast<const uint8_t*>(carry_.data());
+      ScanLine(line, line + carry_.size(), batch);
+      carry_.clear();
+    }
+    p = newline + 1;
+  }
+}
+
+void NdjsonTokenScanner::Finish(TokenBatch* batch) {
+  if (!carry_.empty()) {
+    const uint8_t* line = reinterpret_cast<const uint8_t*>(carry_.data());
+    ScanLine(line, line + carry_.size(), batch);
+    carry_.clear();
+  }
+}
+
+void NdjsonTokenScanner::Reset() {
+  carry_.clear();
+}
+
+void NdjsonTokenScanner::ScanLine(const uint8_t* begin, const uint8_t* end,
+                                  TokenBatch* batch) {
+  const uint8_t* start = json::SkipWhitespace(begin, end);
+  if (start == end) {
+    return;
+  }
+
+  // Remember where this line's output starts so a malformed line can be
+  // rolled back instead of leaving half a delta in the batch.
+  const size_t text_mark = batch->text_.size();
+  bool done = false;
+  bool has_error = false;
+  // Kept aside until the line parses, so a malformed one leaves the
+  // batch's earlier error as it was.
+  std::string error;
+  bool has_stats = false;
+  OllamaDoneStats stats;
+
+  auto parse_counter = [&](const uint8_t* value, int64_t* field) {
+    has_stats = true;
+    return json::ParseInt64(value, end, field);
+  };
+
+  const uint8_t* result = json::ScanObject(
+      start, end,
+      [&](const uint8_t* key, size_t length,
+          const uint8_t* value) -> const uint8_t* {
+        if (json::KeyEquals(key, length, "message")) {
+          if (*value != '{') {
+            return json::SkipValue(value, end);
+          }
+          return json::ScanObject(
+              value, end,
+              [&](const uint8_t* inner_key, size_t inner_length,
+                  const uint8_t* inner_value) -> const uint8_t* {
+                if (json::KeyEquals(inner_key, inner_length, "content") &&
+                    *inner_value == '"') {
+                  return json::ParseString(inner_value, end, &batch->text_);
+                }
+                return json::SkipValue(inner_value, end);
+              });
+        }
+        if (json::KeyEquals(key, length, "response") && *value == '"') {
+          return json::ParseString(value, end, &batch->text_);
+        }
+        if (json::KeyEquals(key, length, "done")) {
+          return json::ParseBool(value, end, &done);
+        }
+        if (json::KeyEquals(key, length, "error") && *value == '"') {
+          has_error = true;
+          error.clear();
+          return json::ParseString(value, end, &error);
+        }
+        if (json::KeyEquals(key, length, "total_duration")) {
+          return parse_counter(value, &stats.total_duration);
+        }
+        if (json::KeyEquals(key, length, "load_duration")) {
+          return parse_counter(value, &stats.load_duration);
+        }
+        if (json::KeyEquals(key, length, "prompt_eval_count")) {
+          return parse_counter(value, &stats.prompt_eval_count);
+        }
+        if (json::KeyEquals(key, length, "prompt_eval_duration")) {
+          return parse_counter(value, &stats.prompt_eval_duration);
+        }
+        if (json::KeyEquals(key, length, "eval_count")) {
+          return parse_counter(value, &stats.eval_count);
+        }
+        if (json::KeyEquals(key, length, "eval_duration")) {
+          return parse_counter(value, &stats.eval_duration);
+        }
+        return json::SkipValue(value, end);
+      });
+
+  if (result == nullptr) {
+    batch->text_.resize(text_mark);
+    ++malformed_lines_;
+    return;
+  }
+
+  if (batch->text_.size() > text_mark) {
+    ++batch->token_count_;
+  }
+  if (has_error) {
+    batch->has_error_ = true;
+    batch->error_.assign(error);
+  }
+  if (done) {
+    batch->done_ = true;
+    if (has_stats) {
+      batch->has_stats_ = true;
+      batch->stats_ = stats;
+    }
+  }
+}
+
+}  // namespace cloudtolocalllm
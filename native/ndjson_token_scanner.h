@@ -0,0 +1,103 @@
+#ifndef NATIVE_NDJSON_TOKEN_SCANNER_H_
+#define NATIVE_NDJSON_TOKEN_SCANNER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cloudtolocalllm {
+
+// Timing and token counters Ollama reports on the final ("done": true) line
+// of a /api/chat or /api/generate stream. Durations are in nanoseconds.
+struct OllamaDoneStats {
+  int64_t total_duration = 0;
+  int64_t load_duration = 0;
+  int64_t prompt_eval_count = 0;
+  int64_t prompt_eval_duration = 0;
+  int64_t eval_count = 0;
+  int64_t eval_duration = 0;
+};
+
+// Token deltas accumulated from one or more NDJSON lines.
+//
+// A batch is reused across feeds: Reset() clears it without releasing its
+// buffers, so a long stream settles into zero allocations per token.
+class TokenBatch {
+ public:
+  // Bits of the flags byte in the encoded form.
+  static constexpr uint8_t kDone = 1 << 0;
+  static constexpr uint8_t kError = 1 << 1;
+  static constexpr uint8_t kHasStats = 1 << 2;
+
+  TokenBatch();
+
+  void Reset();
+
+  // Appends the concatenated UTF-8 of every delta in the batch, followed by
+  // the done/error state, to |out|. Layout (little-endian):
+  //
+  //   u8  flags
+  //   u32 token_count
+  //   u32 text_length, then text_length bytes of UTF-8
+  //   if kHasStats: six i64 counters in OllamaDoneStats field order
+  //   if kError:    u32 length, then the error message
+  void Encode(std::vector<uint8_t>* out) const;
+
+  bool empty() const { return token_count_ == 0 && !done_ && !has_error_; }
+
+  const std::string& text() const { return text_; }
+  std::string* mutable_text() { return &text_; }
+  uint32_t token_count() const { return token_count_; }
+  bool done() const { return done_; }
+  bool has_error() const { return has_error_; }
+  const std::string& error() const { return error_; }
+  bool has_stats() const { return has_stats_; }
+  const OllamaDoneStats& stats() const { return stats_; }
+
+ private:
+  friend class NdjsonTokenScanner;
+
+  std::string text_;
+  uint32_t token_count_;
+  bool done_;
+  bool has_error_;
+  std::string error_;
+  bool has_stats_;
+  OllamaDoneStats stats_;
+};
+
+// Incremental parser for Ollama's newline-delimited JSON streams.
+//
+// Bytes are fed in whatever chunks the transport delivers; the scanner finds
+// line boundaries with a SIMD byte search and, for each complete line, picks
+// out `message.content` (/api/chat) or `response` (/api/generate), `done`,
+// `error` and the final counters without building any intermediate JSON
+// objects. A line split across feeds is carried over in an internal buffer.
+class NdjsonTokenScanner {
+ public:
+  NdjsonTokenScanner();
+
+  // Consumes |size| bytes of response body, appending the deltas of every
+  // line completed by this chunk to |batch|.
+  void Feed(const uint8_t* data, size_t size, TokenBatch* batch);
+
+  // Flushes a final line that was not newline terminated.
+  void Finish(TokenBatch* batch);
+
+  // Discards any partial line so the scanner can be reused for a new stream.
+  void Reset();
+
+  // Number of lines that could not be parsed, for diagnostics.
+  uint64_t malformed_lines() const { return malformed_lines_; }
+
+ private:
+  void ScanLine(const uint8_t* begin, const uint8_t* end, TokenBatch* batch);
+
+  std::string carry_;
+  uint64_t malformed_lines_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_NDJSON_TOKEN_SCANNER_H_
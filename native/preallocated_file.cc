@@ -0,0 +1,144 @@
+#include "native/preallocated_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cloudtolocalllm {
+
+PreallocatedFile::PreallocatedFile()
+#ifdef _WIN32
+    : file_(nullptr) {
+#else
+    : fd_(-1) {
+#endif
+}
+
+PreallocatedFile::~PreallocatedFile() {
+  Close();
+}
+
+bool PreallocatedFile::is_open() const {
+#ifdef _WIN32
+  return file_ != nullptr;
+#else
+  return fd_ >= 0;
+#endif
+}
+
+bool PreallocatedFile::Open(const std::filesystem::path& path, uint64_t size) {
+  if (is_open()) {
+    return false;
+  }
+#ifdef _WIN32
+  HANDLE file = ::CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ,
+                              nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  file_ = file;
+  const bool created = ::GetLastError() != ERROR_ALREADY_EXISTS;
+  LARGE_INTEGER current;
+  if (size == 0 || !::GetFileSizeEx(file, &current) ||
+      static_cast<uint64_t>(current.QuadPart) >= size) {
+    return true;
+  }
+  LARGE_INTEGER end;
+  end.QuadPart = static_cast<LONGLONG>(size);
+  if (!::SetFilePointerEx(file, end, nullptr, FILE_BEGIN) ||
+      !::SetEndOfFile(file)) {
+    Close();
+    return false;
+  }
+  // Without this NTFS zero-fills everything before each write that lands
+  // past the valid length. It needs SE_MANAGE_VOLUME_NAME, which elevated
+  // processes hold; failing it just means the zero-fill happens. Only a
+  // fresh file is marked, so no earlier contents of the disk are exposed
+  // beyond what the download then overwrites.
+  if (created) {
+    ::SetFileValidData(file, end.QuadPart);
+  }
+  return true;
+#else
+  const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  fd_ = fd;
+  struct stat info;
+  if (size == 0 || (::fstat(fd, &info) == 0 &&
+                    static_cast<uint64_t>(info.st_size) >= size)) {
+    return true;
+  }
+  int result = EOPNOTSUPP;
+#ifdef __linux__
+  result = ::posix_fallocate(fd, 0, static_cast<off_t>(size));
+#endif
+  // Filesystems without extent allocation still get a sparse file of the
+  // right size.
+  if (result == EOPNOTSUPP || result == EINVAL) {
+    result = ::ftruncate(fd, static_cast<off_t>(size)) == 0 ? 0 : errno;
+  }
+  if (result != 0) {
+    Close();
+    return false;
+  }
+  return true;
+#endif
+}
+
+bool PreallocatedFile::WriteAt(uint64_t offset, const uint8_t* data,
+                               size_t size) {
+  if (!is_open()) {
+    return false;
+  }
+  while (size > 0) {
+#ifdef _WIN32
+    OVERLAPPED position = {};
+    position.Offset = static_cast<DWORD>(offset);
+    position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    const DWORD request =
+        static_cast<DWORD>(size < (1u << 30) ? size : (1u << 30));
+    DWORD written = 0;
+    if (!::WriteFile(file_, data, request, &written, &position) ||
+        written == 0) {
+      return false;
+    }
+#else
+    const ssize_t written =
+        ::pwrite(fd_, data, size, static_cast<off_t>(offset));
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+#endif
+    data += written;
+    size -= static_cast<size_t>(written);
+    offset += static_cast<uint64_t>(written);
+  }
+  return true;
+}
+
+void PreallocatedFile::Close() {
+#ifdef _WIN32
+  if (file_ != nullptr) {
+    ::CloseHandle(file_);
+    file_ = nullptr;
+  }
+#else
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+#endif
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,51 @@
+#ifndef NATIVE_PREALLOCATED_FILE_H_
+#define NATIVE_PREALLOCATED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace cloudtolocalllm {
+
+// A file of known size written at arbitrary offsets, as the ranges of a
+// parallel download arrive out of order.
+//
+// Open reserves the whole size up front (posix_fallocate on Linux;
+// SetEndOfFile and, where the process may, SetFileValidData on Windows), so
+// a multi-GB model is laid out once instead of being extended and zero-
+// filled write by write, and running out of disk space fails at the start
+// rather than an hour in. Existing contents are kept, which is what lets an
+// interrupted download resume into the same file.
+class PreallocatedFile {
+ public:
+  PreallocatedFile();
+  ~PreallocatedFile();
+
+  // Prevent copying.
+  PreallocatedFile(PreallocatedFile const&) = delete;
+  PreallocatedFile& operator=(PreallocatedFile const&) = delete;
+
+  // Opens or creates |path| for writing and grows it to |size| bytes; zero
+  // leaves the size alone, for downloads of unknown length. Returns false
+  // if the file cannot be opened or the space cannot be reserved.
+  bool Open(const std::filesystem::path& path, uint64_t size);
+
+  // Writes |size| bytes at |offset|. Returns false on any I/O error.
+  bool WriteAt(uint64_t offset, const uint8_t* data, size_t size);
+
+  void Close();
+
+  bool is_open() const;
+
+ private:
+#ifdef _WIN32
+  // A HANDLE, kept as void* so this header needs no <windows.h>.
+  void* file_;
+#else
+  int fd_;
+#endif
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_PREALLOCATED_FILE_H_
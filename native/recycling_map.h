@@ -0,0 +1,92 @@
+#ifndef NATIVE_RECYCLING_MAP_H_
+#define NATIVE_RECYCLING_MAP_H_
+
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cloudtolocalllm {
+
+// The default RecyclingMap reset: assigns a fresh value.
+template <typename Value>
+struct ResetValue {
+  void operator()(Value* value) const { *value = Value(); }
+};
+
+// An unordered_map for per-request state that keeps the nodes of erased
+// entries and hands them to later insertions, so a steady stream of
+// requests stops allocating a node, and whatever buffers the value holds,
+// for each one. Not thread-safe; lock around it as around the map.
+//
+// |Reset| runs on a value as its entry is erased. It must drop anything the
+// value refers to, but may leave its buffers for the next entry. At most
+// |max_spare| nodes are kept.
+template <typename Key, typename Value, typename Reset = ResetValue<Value>>
+class RecyclingMap {
+ public:
+  explicit RecyclingMap(size_t max_spare = 64) : max_spare_(max_spare) {
+    spare_.reserve(max_spare_);
+  }
+
+  // Prevent copying.
+  RecyclingMap(RecyclingMap const&) = delete;
+  RecyclingMap& operator=(RecyclingMap const&) = delete;
+
+  Value* Find(const Key& key) {
+    auto it = map_.find(key);
+    return it == map_.end() ? nullptr : &it->second;
+  }
+
+  // Returns the value for |key|, adding an entry if there is none. A new
+  // entry takes an erased one's node, reset, when there is one; |allocated|
+  // is set when it had to have a node of its own.
+  Value& Insert(const Key& key, bool* allocated) {
+    *allocated = false;
+    auto it = map_.find(key);
+    if (it != map_.end()) {
+      return it->second;
+    }
+    if (spare_.empty()) {
+      *allocated = true;
+      return map_[key];
+    }
+    typename Map::node_type node = std::move(spare_.back());
+    spare_.pop_back();
+    node.key() = key;
+    return map_.insert(std::move(node)).position->second;
+  }
+
+  // Removes |key|'s entry; false if there was none.
+  bool Erase(const Key& key) {
+    typename Map::node_type node = map_.extract(key);
+    if (node.empty()) {
+      return false;
+    }
+    if (spare_.size() < max_spare_) {
+      Reset()(&node.mapped());
+      spare_.push_back(std::move(node));
+    }
+    return true;
+  }
+
+  void Clear() {
+    while (!map_.empty()) {
+      Erase(map_.begin()->first);
+    }
+  }
+
+  size_t size() const { return map_.size(); }
+  bool empty() const { return map_.empty(); }
+
+ private:
+  using Map = std::unordered_map<Key, Value>;
+
+  const size_t max_spare_;
+  Map map_;
+  std::vector<typename Map::node_type> spare_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_RECYCLING_MAP_H_
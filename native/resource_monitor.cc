@@ -0,0 +1,430 @@
+#include "native/resource_monitor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <dxgi.h>
+#include <psapi.h>
+#else
+#include <dlfcn.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#endif
+
+namespace cloudtolocalllm {
+
+namespace {
+
+// The few NVML declarations used, as in nvml.h, so that building needs no
+// CUDA toolkit.
+using NvmlReturn = int;
+using NvmlDevice = struct NvmlDeviceOpaque*;
+struct NvmlMemory {
+  unsigned long long total;
+  unsigned long long free;
+  unsigned long long used;
+};
+struct NvmlUtilization {
+  unsigned int gpu;
+  unsigned int memory;
+};
+constexpr NvmlReturn kNvmlSuccess = 0;
+
+int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+template <typename Function>
+bool Resolve(void* library, const char* name, Function* function) {
+#ifdef _WIN32
+  FARPROC address = ::GetProcAddress(static_cast<HMODULE>(library), name);
+#else
+  void* address = ::dlsym(library, name);
+#endif
+  *function = reinterpret_cast<Function>(address);
+  return address != nullptr;
+}
+
+void CloseLibrary(void* library) {
+#ifdef _WIN32
+  ::FreeLibrary(static_cast<HMODULE>(library));
+#else
+  ::dlclose(library);
+#endif
+}
+
+#ifndef _WIN32
+bool ReadU64File(const std::filesystem::path& path, uint64_t* value) {
+  std::ifstream in(path);
+  return static_cast<bool>(in >> *value);
+}
+#endif
+
+}  // namespace
+
+class ResourceMonitor::Probes {
+ public:
+  Probes();
+  ~Probes();
+
+  // Prevent copying.
+  Probes(Probes const&) = delete;
+  Probes& operator=(Probes const&) = delete;
+
+  void Sample(ResourceSample* sample);
+
+ private:
+  // False if the counters could not be read.
+  bool ReadCpuTimes(uint64_t* busy, uint64_t* total) const;
+  void SampleMemory(ResourceSample* sample) const;
+  bool SampleNvml(ResourceSample* sample) const;
+#ifndef _WIN32
+  bool SampleSysfs(ResourceSample* sample) const;
+#endif
+
+  uint64_t last_busy_;
+  uint64_t last_total_;
+
+  // NVML and its entry points; null where there is no NVIDIA driver.
+  void* nvml_;
+  NvmlReturn (*nvml_shutdown_)();
+  NvmlReturn (*nvml_device_count_)(unsigned int*);
+  NvmlReturn (*nvml_device_handle_)(unsigned int, NvmlDevice*);
+  NvmlReturn (*nvml_memory_)(NvmlDevice, NvmlMemory*);
+  NvmlReturn (*nvml_utilization_)(NvmlDevice, NvmlUtilization*);
+
+#ifdef _WIN32
+  // Dedicated memory of the hardware adapters, read once.
+  uint64_t dxgi_total_;
+#endif
+};
+
+ResourceMonitor::Probes::Probes()
+    : last_busy_(0),
+      last_total_(0),
+      nvml_(nullptr),
+      nvml_shutdown_(nullptr),
+      nvml_device_count_(nullptr),
+      nvml_device_handle_(nullptr),
+      nvml_memory_(nullptr),
+      nvml_utilization_(nullptr)
+#ifdef _WIN32
+      ,
+      dxgi_total_(0)
+#endif
+{
+  // The first sample's load is measured from here.
+  ReadCpuTimes(&last_busy_, &last_total_);
+
+#ifdef _WIN32
+  void* nvml = ::LoadLibraryExW(L"nvml.dll", nullptr,
+                                LOAD_LIBRARY_SEARCH_SYSTEM32);
+#else
+  void* nvml = ::dlopen("libnvidia-ml.so.1", RTLD_NOW | RTLD_LOCAL);
+#endif
+  NvmlReturn (*init)() = nullptr;
+  if (nvml != nullptr) {
+    if (Resolve(nvml, "nvmlInit_v2", &init) &&
+        Resolve(nvml, "nvmlShutdown", &nvml_shutdown_) &&
+        Resolve(nvml, "nvmlDeviceGetCount_v2", &nvml_device_count_) &&
+        Resolve(nvml, "nvmlDeviceGetHandleByIndex_v2",
+                &nvml_device_handle_) &&
+        Resolve(nvml, "nvmlDeviceGetMemoryInfo", &nvml_memory_) &&
+        Resolve(nvml, "nvmlDeviceGetUtilizationRates", &nvml_utilization_) &&
+        init() == kNvmlSuccess) {
+      nvml_ = nvml;
+    } else {
+      CloseLibrary(nvml);
+    }
+  }
+
+#ifdef _WIN32
+  if (nvml_ != nullptr) {
+    return;
+  }
+  HMODULE dxgi =
+      ::LoadLibraryExW(L"dxgi.dll", nullptr, LOAD_LIBRARY_SEARCH_SYSTEM32);
+  HRESULT(WINAPI * create_factory)(REFIID, void**) = nullptr;
+  if (dxgi == nullptr) {
+    return;
+  }
+  IDXGIFactory1* factory = nullptr;
+  if (Resolve(dxgi, "CreateDXGIFactory1", &create_factory) &&
+      SUCCEEDED(create_factory(__uuidof(IDXGIFactory1),
+                               reinterpret_cast<void**>(&factory)))) {
+    IDXGIAdapter1* adapter = nullptr;
+    for (UINT i = 0; SUCCEEDED(factory->EnumAdapters1(i, &adapter)); i++) {
+      DXGI_ADAPTER_DESC1 desc;
+      if (SUCCEEDED(adapter->GetDesc1(&desc)) &&
+          (desc.Flags & DXGI_ADAPTER_FLAG_SOFTWARE) == 0) {
+        dxgi_total_ += desc.DedicatedVideoMemory;
+      }
+      adapter->Release();
+    }
+    factory->Release();
+  }
+  ::FreeLibrary(dxgi);
+#endif
+}
+
+ResourceMonitor::Probes::~Probes() {
+  if (nvml_ != nullptr) {
+    nvml_shutdown_();
+    CloseLibrary(nvml_);
+  }
+}
+
+void ResourceMonitor::Probes::Sample(ResourceSample* sample) {
+  sample->timestamp_ms = NowMs();
+
+  uint64_t busy = 0;
+  uint64_t total = 0;
+  if (ReadCpuTimes(&busy, &total) && total > last_total_) {
+    sample->cpu_load = static_cast<float>(busy - last_busy_) /
+                       static_cast<float>(total - last_total_);
+    sample->cpu_load = std::min(std::max(sample->cpu_load, 0.0f), 1.0f);
+    last_busy_ = busy;
+    last_total_ = total;
+  }
+
+  SampleMemory(sample);
+  if (SampleNvml(sample)) {
+    sample->gpu_source = GpuSource::kNvml;
+    return;
+  }
+#ifdef _WIN32
+  if (dxgi_total_ > 0) {
+    sample->gpu_memory_total = dxgi_total_;
+    sample->gpu_source = GpuSource::kDxgi;
+  }
+#else
+  if (SampleSysfs(sample)) {
+    sample->gpu_source = GpuSource::kSysfs;
+  }
+#endif
+}
+
+bool ResourceMonitor::Probes::ReadCpuTimes(uint64_t* busy,
+                                           uint64_t* total) const {
+#ifdef _WIN32
+  FILETIME idle_time;
+  FILETIME kernel_time;
+  FILETIME user_time;
+  if (!::GetSystemTimes(&idle_time, &kernel_time, &user_time)) {
+    return false;
+  }
+  auto ticks = [](const FILETIME& time) {
+    return (static_cast<uint64_t>(time.dwHighDateTime) << 32) |
+           time.dwLowDateTime;
+  };
+  // Kernel time includes idle time.
+  const uint64_t idle = ticks(idle_time);
+  *total = ticks(kernel_time) + ticks(user_time);
+  *busy = *total - idle;
+  return true;
+#else
+  // "cpu  user nice system idle iowait irq softirq steal ..."
+  std::ifstream in("/proc/stat");
+  std::string label;
+  uint64_t times[8] = {};
+  in >> label;
+  for (uint64_t& time : times) {
+    in >> time;
+  }
+  if (!in || label != "cpu") {
+    return false;
+  }
+  *total = 0;
+  for (uint64_t time : times) {
+    *total += time;
+  }
+  *busy = *total - times[3] - times[4];
+  return true;
+#endif
+}
+
+void ResourceMonitor::Probes::SampleMemory(ResourceSample* sample) const {
+#ifdef _WIN32
+  MEMORYSTATUSEX status;
+  status.dwLength = sizeof(status);
+  if (::GlobalMemoryStatusEx(&status)) {
+    sample->memory_total = status.ullTotalPhys;
+    sample->memory_available = status.ullAvailPhys;
+  }
+  PROCESS_MEMORY_COUNTERS counters;
+  if (::GetProcessMemoryInfo(::GetCurrentProcess(), &counters,
+                             sizeof(counters))) {
+    sample->process_rss = counters.WorkingSetSize;
+  }
+#else
+  std::ifstream meminfo("/proc/meminfo");
+  std::string name;
+  uint64_t kilobytes = 0;
+  std::string unit;
+  while (meminfo >> name >> kilobytes >> unit) {
+    if (name == "MemTotal:") {
+      sample->memory_total = kilobytes * 1024;
+    } else if (name == "MemAvailable:") {
+      sample->memory_available = kilobytes * 1024;
+      break;
+    }
+  }
+  // "size resident shared ..." in pages.
+  std::ifstream statm("/proc/self/statm");
+  uint64_t size = 0;
+  uint64_t resident = 0;
+  if (statm >> size >> resident) {
+    sample->process_rss =
+        resident * static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+  }
+#endif
+}
+
+bool ResourceMonitor::Probes::SampleNvml(ResourceSample* sample) const {
+  unsigned int count = 0;
+  if (nvml_ == nullptr || nvml_device_count_(&count) != kNvmlSuccess ||
+      count == 0) {
+    return false;
+  }
+  bool found = false;
+  for (unsigned int i = 0; i < count; i++) {
+    NvmlDevice device = nullptr;
+    NvmlMemory memory;
+    if (nvml_device_handle_(i, &device) != kNvmlSuccess ||
+        nvml_memory_(device, &memory) != kNvmlSuccess) {
+      continue;
+    }
+    found = true;
+    sample->gpu_memory_total += memory.total;
+    sample->gpu_memory_used += memory.used;
+    NvmlUtilization utilization;
+    if (nvml_utilization_(device, &utilization) == kNvmlSuccess) {
+      sample->gpu_load = std::max(sample->gpu_load,
+                                  static_cast<float>(utilization.gpu) / 100);
+    }
+  }
+  return found;
+}
+
+#ifndef _WIN32
+bool ResourceMonitor::Probes::SampleSysfs(ResourceSample* sample) const {
+  namespace fs = std::filesystem;
+  bool found = false;
+  std::error_code error;
+  for (fs::directory_iterator it("/sys/class/drm", error);
+       !error && it != fs::directory_iterator(); it.increment(error)) {
+    // card0, card1, ...; not their connectors (card0-DP-1).
+    const std::string name = it->path().filename().string();
+    if (name.compare(0, 4, "card") != 0 ||
+        name.find('-') != std::string::npos) {
+      continue;
+    }
+    const fs::path device = it->path() / "device";
+    uint64_t total = 0;
+    uint64_t used = 0;
+    if (!ReadU64File(device / "mem_info_vram_total", &total) ||
+        !ReadU64File(device / "mem_info_vram_used", &used)) {
+      continue;
+    }
+    found = true;
+    sample->gpu_memory_total += total;
+    sample->gpu_memory_used += used;
+    uint64_t busy = 0;
+    if (ReadU64File(device / "gpu_busy_percent", &busy)) {
+      sample->gpu_load =
+          std::max(sample->gpu_load, static_cast<float>(busy) / 100);
+    }
+  }
+  return found;
+}
+#endif
+
+ResourceMonitor::ResourceMonitor()
+    : running_(false),
+      interval_ms_(kDefaultIntervalMs),
+      ring_(kCapacity),
+      next_(0),
+      count_(0) {}
+
+ResourceMonitor::~ResourceMonitor() {
+  Stop();
+}
+
+bool ResourceMonitor::Start(int interval_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  interval_ms_ = std::max(interval_ms, kMinIntervalMs);
+  if (!running_) {
+    running_ = true;
+    worker_ = std::thread(&ResourceMonitor::Run, this);
+  }
+  return true;
+}
+
+void ResourceMonitor::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+  }
+  changed_.notify_all();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+bool ResourceMonitor::Latest(ResourceSample* sample) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (count_ == 0) {
+    return false;
+  }
+  *sample = ring_[(next_ + kCapacity - 1) % kCapacity];
+  return true;
+}
+
+std::vector<ResourceSample> ResourceMonitor::History(size_t max) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const size_t count = std::min(max, count_);
+  std::vector<ResourceSample> samples;
+  samples.reserve(count);
+  for (size_t i = count; i > 0; i--) {
+    samples.push_back(ring_[(next_ + kCapacity - i) % kCapacity]);
+  }
+  return samples;
+}
+
+int ResourceMonitor::interval_ms() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return interval_ms_;
+}
+
+void ResourceMonitor::Run() {
+  Probes probes;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (running_) {
+    changed_.wait_for(lock, std::chrono::milliseconds(interval_ms_),
+                      [this] { return !running_; });
+    if (!running_) {
+      break;
+    }
+    lock.unlock();
+    ResourceSample sample;
+    probes.Sample(&sample);
+    lock.lock();
+    ring_[next_] = sample;
+    next_ = (next_ + 1) % kCapacity;
+    count_ = std::min(count_ + 1, kCapacity);
+  }
+}
+
+}  // namespace cloudtolocalllm
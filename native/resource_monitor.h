@@ -0,0 +1,105 @@
+#ifndef NATIVE_RESOURCE_MONITOR_H_
+#define NATIVE_RESOURCE_MONITOR_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cloudtolocalllm {
+
+// Where a sample's GPU figures came from.
+enum class GpuSource : uint8_t {
+  kNone = 0,
+  // NVIDIA's management library: memory and utilization, system-wide.
+  kNvml = 1,
+  // amdgpu's sysfs files (Linux): memory and utilization, system-wide.
+  kSysfs = 2,
+  // DXGI adapter descriptions (Windows): total dedicated memory only.
+  kDxgi = 3,
+};
+
+struct ResourceSample {
+  // Milliseconds since the Unix epoch.
+  int64_t timestamp_ms = 0;
+  // Share of all cores busy since the previous sample, in [0, 1].
+  float cpu_load = 0;
+  // The busiest GPU's utilization in [0, 1], or negative if unknown.
+  float gpu_load = -1;
+  // Resident set of this process.
+  uint64_t process_rss = 0;
+  uint64_t memory_total = 0;
+  uint64_t memory_available = 0;
+  // Dedicated memory summed over all GPUs; used is zero where unknown.
+  uint64_t gpu_memory_total = 0;
+  uint64_t gpu_memory_used = 0;
+  GpuSource gpu_source = GpuSource::kNone;
+};
+
+// Samples CPU load, memory, this process's RSS and GPU memory on a thread
+// of its own into a fixed ring of the last kCapacity samples, so the app can
+// tell a model evicted from VRAM or a busy host from a slow network without
+// doing any of the work on the platform thread.
+//
+// GPU figures come from NVML where an NVIDIA driver is installed (loaded at
+// run time, so machines without one need nothing extra), else from amdgpu's
+// sysfs files on Linux or the DXGI adapter list on Windows. The libraries
+// are opened on the sampling thread, since NVML can take a while to
+// initialize.
+//
+// Thread-safe; reads copy out of the ring under a lock held only for
+// the copy.
+class ResourceMonitor {
+ public:
+  // Five minutes at the default rate.
+  static constexpr size_t kCapacity = 300;
+  static constexpr int kDefaultIntervalMs = 1000;
+  static constexpr int kMinIntervalMs = 100;
+
+  ResourceMonitor();
+  ~ResourceMonitor();
+
+  // Prevent copying.
+  ResourceMonitor(ResourceMonitor const&) = delete;
+  ResourceMonitor& operator=(ResourceMonitor const&) = delete;
+
+  // Starts sampling every |interval_ms| (at least kMinIntervalMs), or
+  // changes the rate if already running. Returns false if the thread could
+  // not be started.
+  bool Start(int interval_ms = kDefaultIntervalMs);
+
+  // Stops sampling; the samples taken so far stay readable. Called
+  // automatically on destruction.
+  void Stop();
+
+  // Copies the newest sample to |sample|; false if there is none yet.
+  bool Latest(ResourceSample* sample) const;
+
+  // Up to |max| of the newest samples, oldest first.
+  std::vector<ResourceSample> History(size_t max) const;
+
+  int interval_ms() const;
+
+ private:
+  // Platform readers and the state they keep between samples.
+  class Probes;
+
+  void Run();
+
+  std::thread worker_;
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  bool running_;
+  int interval_ms_;
+
+  std::vector<ResourceSample> ring_;
+  // Where the next sample goes, and how many the ring holds.
+  size_t next_;
+  size_t count_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_RESOURCE_MONITOR_H_
@@ -0,0 +1,96 @@
+#include "native/resource_monitor_service.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace cloudtolocalllm {
+
+namespace {
+
+uint16_t EncodeLoad(float load) {
+  if (load < 0) {
+    return ResourceMonitorService::kUnknownLoad;
+  }
+  return static_cast<uint16_t>(std::lround(std::min(load, 1.0f) * 10000));
+}
+
+}  // namespace
+
+ResourceMonitorService::ResourceMonitorService()
+    : ResourceMonitorService(std::make_shared<ResourceMonitor>()) {}
+
+ResourceMonitorService::ResourceMonitorService(
+    std::shared_ptr<ResourceMonitor> monitor)
+    : monitor_(std::move(monitor)) {
+  monitor_->Start();
+}
+
+ResourceMonitorService::~ResourceMonitorService() = default;
+
+void ResourceMonitorService::HandleMessage(const uint8_t* message, size_t size,
+                                           std::vector<uint8_t>* reply) {
+  reply->clear();
+
+  WireReader reader(message, size);
+  uint8_t op;
+  if (!reader.ReadU8(&op)) {
+    return;
+  }
+  if (!Handle(op, &reader, reply)) {
+    reply->clear();
+  } else if (reply->empty() && op != kLatest) {
+    reply->push_back(1);
+  }
+}
+
+bool ResourceMonitorService::Handle(uint8_t op, WireReader* reader,
+                                    std::vector<uint8_t>* reply) {
+  WireWriter writer(reply);
+  switch (op) {
+    case kLatest: {
+      ResourceSample sample;
+      if (monitor_->Latest(&sample)) {
+        WriteSample(sample, &writer);
+      }
+      return true;
+    }
+    case kHistory: {
+      uint32_t max;
+      if (!reader->ReadU32(&max)) {
+        return false;
+      }
+      const std::vector<ResourceSample> samples = monitor_->History(max);
+      writer.WriteU32(static_cast<uint32_t>(samples.size()));
+      for (const ResourceSample& sample : samples) {
+        WriteSample(sample, &writer);
+      }
+      return true;
+    }
+    case kSetInterval: {
+      uint32_t interval_ms;
+      if (!reader->ReadU32(&interval_ms)) {
+        return false;
+      }
+      return monitor_->Start(static_cast<int>(
+          std::min<uint32_t>(interval_ms, 60 * 60 * 1000)));
+    }
+    default:
+      return false;
+  }
+}
+
+void ResourceMonitorService::WriteSample(const ResourceSample& sample,
+                                         WireWriter* writer) {
+  writer->WriteI64(sample.timestamp_ms);
+  writer->WriteU16(EncodeLoad(sample.cpu_load));
+  writer->WriteU16(EncodeLoad(sample.gpu_load));
+  writer->WriteU64(sample.process_rss);
+  writer->WriteU64(sample.memory_total);
+  writer->WriteU64(sample.memory_available);
+  writer->WriteU64(sample.gpu_memory_total);
+  writer->WriteU64(sample.gpu_memory_used);
+  writer->WriteU8(static_cast<uint8_t>(sample.gpu_source));
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,61 @@
+#ifndef NATIVE_RESOURCE_MONITOR_SERVICE_H_
+#define NATIVE_RESOURCE_MONITOR_SERVICE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "native/resource_monitor.h"
+#include "native/wire_format.h"
+
+namespace cloudtolocalllm {
+
+// Platform-neutral handler behind the "cloudtolocalllm/resource_monitor"
+// binary channel, which reads the host's CPU, memory and GPU headroom from a
+// ResourceMonitor sampling in the background from construction on. Every
+// read is a copy out of the ring, cheap enough to poll from the UI. The
+// monitor may be shared with other readers, such as ModelWarmup.
+//
+// Requests are `u8 op` followed by an op-specific payload:
+//
+//   kLatest      (1)  replies with one sample, or nothing before the first
+//   kHistory     (2)  u32 max; replies with u32 count and that many of the
+//                     newest samples, oldest first
+//   kSetInterval (3)  u32 milliseconds between samples
+//
+// A sample is i64 timestamp (ms since the epoch), u16 CPU load and u16 GPU
+// load in units of 1/10000 (0xFFFF: unknown), u64 process RSS, u64 memory
+// total, u64 memory available, u64 GPU memory total, u64 GPU memory used
+// and u8 GpuSource; 53 bytes.
+//
+// kSetInterval replies with one byte. Malformed requests get an empty reply.
+class ResourceMonitorService {
+ public:
+  static constexpr uint8_t kLatest = 1;
+  static constexpr uint8_t kHistory = 2;
+  static constexpr uint8_t kSetInterval = 3;
+
+  static constexpr uint16_t kUnknownLoad = 0xFFFF;
+
+  ResourceMonitorService();
+  explicit ResourceMonitorService(std::shared_ptr<ResourceMonitor> monitor);
+  ~ResourceMonitorService();
+
+  // Prevent copying.
+  ResourceMonitorService(ResourceMonitorService const&) = delete;
+  ResourceMonitorService& operator=(ResourceMonitorService const&) = delete;
+
+  void HandleMessage(const uint8_t* message, size_t size,
+                     std::vector<uint8_t>* reply);
+
+ private:
+  bool Handle(uint8_t op, WireReader* reader, std::vector<uint8_t>* reply);
+  static void WriteSample(const ResourceSample& sample, WireWriter* writer);
+
+  std::shared_ptr<ResourceMonitor> monitor_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_RESOURCE_MONITOR_SERVICE_H_
@@ -0,0 +1,277 @@
+#include "native/response_cache.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace cloudtolocalllm {
+
+namespace {
+
+using std::chrono::seconds;
+
+// Long enough to absorb a polling storm, short enough that a model showing
+// up or unloading is seen at the next poll.
+constexpr struct {
+  const char* path;
+  seconds ttl;
+} kCachedEndpoints[] = {
+    {"/api/tags", seconds(2)},
+    {"/api/ps", seconds(1)},
+    {"/api/version", seconds(30)},
+};
+
+// Requests after which /api/tags (and /api/ps) may read differently.
+constexpr const char* kModelChanges[] = {
+    "/api/pull", "/api/push", "/api/create", "/api/copy", "/api/delete",
+};
+// Requests that may load or unload a model, changing /api/ps.
+constexpr const char* kModelLoads[] = {
+    "/api/chat", "/api/generate", "/api/embed", "/api/embeddings",
+};
+
+std::string Route(const std::string& path) {
+  return path.substr(0, path.find('?'));
+}
+
+std::string Origin(const HttpRequest& request) {
+  return request.host + ":" + std::to_string(request.port);
+}
+
+// Whether the cache key |key| is for |host|:|port|; if so |path| is set to
+// where the key's path starts. Compared in pieces so that a chat request,
+// which checks this against every entry, builds no strings.
+bool HasOrigin(const std::string& key, const std::string& host,
+               uint16_t port_number, size_t* path) {
+  const std::string port = std::to_string(port_number);
+  const size_t host_end = host.size();
+  const size_t port_end = host_end + 1 + port.size();
+  if (key.size() <= port_end || key.compare(0, host_end, host) != 0 ||
+      key[host_end] != ':' ||
+      key.compare(host_end + 1, port.size(), port) != 0 ||
+      key[port_end] != ' ') {
+    return false;
+  }
+  *path = port_end + 1;
+  return true;
+}
+
+// Whether the path starting at |start| in |key| has the route |route|.
+bool HasRoute(const std::string& key, size_t start, const char* route) {
+  const size_t end = std::min(key.find('?', start), key.size());
+  return key.compare(start, end - start, route) == 0;
+}
+
+template <size_t N>
+bool Contains(const char* const (&paths)[N], const std::string& route) {
+  for (const char* path : paths) {
+    if (route == path) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+ResponseCache::ResponseCache() : flight_count_(0) {}
+
+ResponseCache::~ResponseCache() = default;
+
+bool ResponseCache::CacheKey(const HttpRequest& request, std::string* key,
+                             Clock::duration* ttl) {
+  if (request.method != "GET" || !request.body.empty() ||
+      request.parse_ndjson) {
+    return false;
+  }
+  const std::string route = Route(request.path);
+  for (const auto& endpoint : kCachedEndpoints) {
+    if (route == endpoint.path) {
+      *key = Origin(request) + " " + request.path;
+      *ttl = endpoint.ttl;
+      return true;
+    }
+  }
+  return false;
+}
+
+ResponseCache::Lookup ResponseCache::Begin(
+    HttpRequest* request, std::shared_ptr<const Response>* response) {
+  std::string key;
+  Clock::duration ttl;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!CacheKey(*request, &key, &ttl)) {
+    InvalidateLocked(request->host, request->port, request->path);
+    return Lookup::kBypass;
+  }
+
+  auto entry = entries_.find(key);
+  if (entry != entries_.end()) {
+    if (Clock::now() < entry->second.expires) {
+      *response = entry->second.response;
+      stats_.hits++;
+      return Lookup::kHit;
+    }
+    entries_.erase(entry);
+  }
+
+  auto flight = flights_by_key_.find(key);
+  if (flight != flights_by_key_.end()) {
+    flights_[flight->second].followers.push_back(std::move(*request));
+    stats_.coalesced++;
+    return Lookup::kJoined;
+  }
+
+  Flight& led = flights_[request->id];
+  led.key = key;
+  led.ttl = ttl;
+  led.response = std::make_unique<Response>();
+  flights_by_key_[key] = request->id;
+  flight_count_++;
+  stats_.misses++;
+  return Lookup::kMiss;
+}
+
+bool ResponseCache::OnStarted(uint64_t id, int status_code,
+                              HttpHeaderView headers) {
+  if (flight_count_ == 0) {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = flights_.find(id);
+  if (it == flights_.end()) {
+    return true;
+  }
+  it->second.response->status_code = status_code;
+  it->second.response->headers.assign(headers.begin(), headers.end());
+  return !it->second.muted;
+}
+
+bool ResponseCache::OnBody(uint64_t id, const uint8_t* data, size_t size) {
+  if (flight_count_ == 0) {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = flights_.find(id);
+  if (it == flights_.end()) {
+    return true;
+  }
+  Flight& flight = it->second;
+  if (flight.shareable) {
+    std::string& body = flight.response->body;
+    if (body.size() + size > kMaxBodySize) {
+      flight.shareable = false;
+      std::string().swap(body);
+    } else {
+      body.append(reinterpret_cast<const char*>(data), size);
+    }
+  }
+  return !flight.muted;
+}
+
+bool ResponseCache::Finish(uint64_t id, const std::string* error,
+                           Outcome* outcome) {
+  if (flight_count_ == 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = flights_.find(id);
+  if (it == flights_.end()) {
+    return false;
+  }
+  Flight& flight = it->second;
+  outcome->followers = std::move(flight.followers);
+  outcome->muted = flight.muted;
+  if (error != nullptr) {
+    outcome->error = *error;
+  } else if (flight.shareable) {
+    std::shared_ptr<const Response> response = std::move(flight.response);
+    if (flight.storable && response->status_code == 200) {
+      entries_[flight.key] = Entry{response, Clock::now() + flight.ttl};
+    }
+    outcome->response = std::move(response);
+  }
+  flights_by_key_.erase(flight.key);
+  flights_.erase(it);
+  flight_count_--;
+  return true;
+}
+
+bool ResponseCache::Cancel(uint64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = flights_.find(id);
+  if (it == flights_.end()) {
+    // A follower leaves its flight without affecting anyone else.
+    for (auto& flight : flights_) {
+      auto& followers = flight.second.followers;
+      for (auto follower = followers.begin(); follower != followers.end();
+           ++follower) {
+        if (follower->id == id) {
+          followers.erase(follower);
+          return false;
+        }
+      }
+    }
+    return false;
+  }
+  if (it->second.followers.empty()) {
+    flights_by_key_.erase(it->second.key);
+    flights_.erase(it);
+    flight_count_--;
+    return false;
+  }
+  it->second.muted = true;
+  return true;
+}
+
+void ResponseCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  flights_by_key_.clear();
+  flights_.clear();
+  flight_count_ = 0;
+}
+
+ResponseCache::Stats ResponseCache::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void ResponseCache::Invalidate(const std::string& host, uint16_t port,
+                               const std::string& path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  InvalidateLocked(host, port, path);
+}
+
+void ResponseCache::InvalidateLocked(const std::string& host, uint16_t port,
+                                     const std::string& path) {
+  const std::string route = Route(path);
+  const bool models = Contains(kModelChanges, route);
+  if (!models && !Contains(kModelLoads, route)) {
+    return;
+  }
+  auto affected = [&](const std::string& key) {
+    size_t start = 0;
+    if (!HasOrigin(key, host, port, &start)) {
+      return false;
+    }
+    return HasRoute(key, start, "/api/ps") ||
+           (models && HasRoute(key, start, "/api/tags"));
+  };
+
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (affected(it->first)) {
+      it = entries_.erase(it);
+      stats_.invalidations++;
+    } else {
+      ++it;
+    }
+  }
+  // A flight already under way may have read the old state.
+  for (auto& flight : flights_) {
+    if (affected(flight.second.key)) {
+      flight.second.storable = false;
+    }
+  }
+}
+
+}  // namespace cloudtolocalllm
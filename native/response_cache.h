@@ -0,0 +1,153 @@
+#ifndef NATIVE_RESPONSE_CACHE_H_
+#define NATIVE_RESPONSE_CACHE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "native/http_response_parser.h"
+#include "native/http_stream_client.h"
+
+namespace cloudtolocalllm {
+
+// Short-lived cache with single-flight coalescing for the idempotent Ollama
+// endpoints that get polled: GET /api/tags, /api/version and /api/ps.
+//
+// The first request for a key while nothing is cached leads a flight and
+// goes upstream; identical requests arriving meanwhile join it as followers
+// and are answered from its response, so a burst of N polls costs Ollama one
+// call. A 200 response is then served from memory for the endpoint's TTL.
+// Requests that change what these endpoints report (a pull or delete for
+// tags, a chat or generate loading a model for ps) drop the entries they
+// affect when they start.
+//
+// The cache only tracks state; the caller submits leaders upstream, feeds
+// their progress through the On* methods and replays responses to
+// followers. Thread-safe.
+class ResponseCache {
+ public:
+  struct Response {
+    int status_code = 0;
+    HttpHeaderList headers;
+    std::string body;
+  };
+
+  enum class Lookup {
+    // |*response| is cached; answer from it.
+    kHit,
+    // Joined a flight in progress; the request is handed back when it ends.
+    kJoined,
+    // Leads a new flight; submit it upstream.
+    kMiss,
+    // Not an endpoint this caches.
+    kBypass,
+  };
+
+  // Bodies larger than this are not kept; followers of such a flight are
+  // handed back to go upstream themselves.
+  static constexpr size_t kMaxBodySize = 4 * 1024 * 1024;
+
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t coalesced = 0;
+    uint64_t misses = 0;
+    uint64_t invalidations = 0;
+  };
+
+  // What a finished flight leaves for its followers.
+  struct Outcome {
+    // Null if the flight failed or its body did not fit.
+    std::shared_ptr<const Response> response;
+    std::string error;
+    std::vector<HttpRequest> followers;
+    // The leader's own requester cancelled; nothing is sent for it.
+    bool muted = false;
+  };
+
+  ResponseCache();
+  ~ResponseCache();
+
+  // Prevent copying.
+  ResponseCache(ResponseCache const&) = delete;
+  ResponseCache& operator=(ResponseCache const&) = delete;
+
+  // Looks |request| up. On kJoined the request is kept by the cache.
+  // Any other request first invalidates the entries it could make stale.
+  Lookup Begin(HttpRequest* request,
+               std::shared_ptr<const Response>* response);
+
+  // Progress of request |id|. Each returns false if |id| led a flight whose
+  // own requester has since cancelled, so its events should be dropped.
+  bool OnStarted(uint64_t id, int status_code, HttpHeaderView headers);
+  bool OnBody(uint64_t id, const uint8_t* data, size_t size);
+
+  // Ends the flight led by |id|, caching a 200 response, and fills
+  // |outcome| for its followers; false if |id| led none. |error| is null on
+  // success.
+  bool Finish(uint64_t id, const std::string* error, Outcome* outcome);
+
+  // Drops what a request to |path| on |host|:|port| could make stale, as
+  // Begin does for every request it does not cache: a model pull empties
+  // /api/tags and /api/ps, a chat or embed empties /api/ps. For work that
+  // reaches Ollama other than through Begin.
+  void Invalidate(const std::string& host, uint16_t port,
+                  const std::string& path);
+
+  // Request |id| is being cancelled. Returns true if it led a flight that
+  // still has followers, in which case it must keep running upstream and
+  // its own events are muted from now on.
+  bool Cancel(uint64_t id);
+
+  void Clear();
+
+  Stats stats() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Entry {
+    std::shared_ptr<const Response> response;
+    Clock::time_point expires;
+  };
+
+  struct Flight {
+    std::string key;
+    Clock::duration ttl;
+    std::unique_ptr<Response> response;
+    // Cleared when the body outgrows kMaxBodySize (followers then go
+    // upstream) or an invalidation overlaps the flight (the response is
+    // still shared, just not kept).
+    bool shareable = true;
+    bool storable = true;
+    bool muted = false;
+    std::vector<HttpRequest> followers;
+  };
+
+  // The cache key and TTL for |request|, or false if it is not cached.
+  static bool CacheKey(const HttpRequest& request, std::string* key,
+                       Clock::duration* ttl);
+  // Invalidate, with |mutex_| held.
+  void InvalidateLocked(const std::string& host, uint16_t port,
+                        const std::string& path);
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  // Flights by key, and the same flights by their leader's id.
+  std::unordered_map<std::string, uint64_t> flights_by_key_;
+  std::unordered_map<uint64_t, Flight> flights_;
+  // How many flights are in progress, so requests that lead none (every
+  // streamed chat) skip the lock on each chunk.
+  std::atomic<size_t> flight_count_;
+
+  Stats stats_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_RESPONSE_CACHE_H_
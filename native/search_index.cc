@@ -0,0 +1,535 @@
+#include "native/search_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace cloudtolocalllm {
+
+namespace {
+
+// BM25 parameters.
+constexpr double kK1 = 1.2;
+constexpr double kB = 0.75;
+
+// Removed documents are only dropped from the posting lists once there are
+// at least this many and they outnumber the live ones.
+constexpr size_t kCompactMinimum = 256;
+
+void AppendVarint(uint32_t value, std::vector<uint8_t>* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<uint8_t>(value));
+}
+
+bool ReadVarint(const uint8_t** position, const uint8_t* end,
+                uint32_t* value) {
+  uint32_t result = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (*position == end) {
+      return false;
+    }
+    const uint8_t byte = *(*position)++;
+    result |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool IsTermByte(unsigned char c) {
+  return c >= 0x80 || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+         (c >= 'A' && c <= 'Z');
+}
+
+// Calls |visit(term, position)| for each term in |text|. Terms longer than
+// SearchIndex::kMaxTermSize are skipped but still take up a position.
+template <typename Visit>
+void ForEachTerm(const char* text, size_t size, Visit&& visit) {
+  std::string term;
+  uint32_t position = 0;
+  bool too_long = false;
+  for (size_t i = 0; i <= size; i++) {
+    const unsigned char c = i < size ? static_cast<unsigned char>(text[i]) : 0;
+    if (i < size && IsTermByte(c)) {
+      if (term.size() < SearchIndex::kMaxTermSize) {
+        term.push_back(c >= 'A' && c <= 'Z' ? static_cast<char>(c | 0x20)
+                                            : static_cast<char>(c));
+      } else {
+        too_long = true;
+      }
+      continue;
+    }
+    if (term.empty()) {
+      continue;
+    }
+    if (!too_long) {
+      visit(term, position);
+    }
+    position++;
+    term.clear();
+    too_long = false;
+  }
+}
+
+std::vector<std::string> Terms(const std::string& text) {
+  std::vector<std::string> terms;
+  ForEachTerm(text.data(), text.size(),
+              [&terms](const std::string& term, uint32_t) {
+                terms.push_back(term);
+              });
+  return terms;
+}
+
+// Walks a posting list one document at a time.
+class PostingReader {
+ public:
+  explicit PostingReader(const std::vector<uint8_t>& data)
+      : position_(data.data()),
+        end_(data.data() + data.size()),
+        document_(0),
+        first_(true) {}
+
+  // Advances to the next document; false at the end of the list.
+  bool Next() {
+    uint32_t gap;
+    uint32_t frequency;
+    if (!ReadVarint(&position_, end_, &gap) ||
+        !ReadVarint(&position_, end_, &frequency)) {
+      return false;
+    }
+    document_ = first_ ? gap : document_ + gap;
+    first_ = false;
+    positions_.clear();
+    uint32_t term_position = 0;
+    for (uint32_t i = 0; i < frequency; i++) {
+      if (!ReadVarint(&position_, end_, &gap)) {
+        return false;
+      }
+      term_position += gap;
+      positions_.push_back(term_position);
+    }
+    return true;
+  }
+
+  uint32_t document() const { return document_; }
+  uint32_t frequency() const {
+    return static_cast<uint32_t>(positions_.size());
+  }
+  const std::vector<uint32_t>& positions() const { return positions_; }
+
+ private:
+  const uint8_t* position_;
+  const uint8_t* end_;
+  uint32_t document_;
+  bool first_;
+  std::vector<uint32_t> positions_;
+};
+
+}  // namespace
+
+SearchIndex::SearchIndex() : live_documents_(0), live_terms_(0) {}
+
+SearchIndex::~SearchIndex() = default;
+
+void SearchIndex::Put(const std::string& conversation_id,
+                      const std::string& message_id, const char* text,
+                      size_t size) {
+  Remove(conversation_id, message_id);
+
+  std::map<std::string, std::vector<uint32_t>> positions;
+  uint32_t length = 0;
+  ForEachTerm(text, size,
+              [&positions, &length](const std::string& term,
+                                    uint32_t position) {
+                positions[term].push_back(position);
+                length++;
+              });
+  if (positions.empty()) {
+    return;
+  }
+
+  const uint32_t document = static_cast<uint32_t>(documents_.size());
+  documents_.push_back(Document{conversation_id, message_id, length, true});
+  document_ids_[DocumentKey(conversation_id, message_id)] = document;
+  live_documents_++;
+  live_terms_ += length;
+
+  for (const auto& [term, term_positions] : positions) {
+    AppendPosting(document, term_positions, &terms_[term]);
+  }
+}
+
+void SearchIndex::Remove(const std::string& conversation_id,
+                         const std::string& message_id) {
+  auto it = document_ids_.find(DocumentKey(conversation_id, message_id));
+  if (it == document_ids_.end()) {
+    return;
+  }
+  Document& document = documents_[it->second];
+  document.live = false;
+  live_documents_--;
+  live_terms_ -= document.length;
+  document_ids_.erase(it);
+
+  const size_t dead = documents_.size() - live_documents_;
+  if (dead >= kCompactMinimum && dead > live_documents_) {
+    Compact();
+  }
+}
+
+void SearchIndex::Clear() {
+  documents_.clear();
+  document_ids_.clear();
+  terms_.clear();
+  live_documents_ = 0;
+  live_terms_ = 0;
+}
+
+std::vector<SearchHit> SearchIndex::Search(const std::string& query,
+                                           size_t limit) const {
+  std::vector<Scores> clauses;
+  size_t i = 0;
+  while (i < query.size()) {
+    if (query[i] == ' ' || query[i] == '\t' || query[i] == '\n' ||
+        query[i] == '\r') {
+      i++;
+      continue;
+    }
+    std::vector<std::string> terms;
+    bool prefix = false;
+    if (query[i] == '"') {
+      size_t end = query.find('"', i + 1);
+      if (end == std::string::npos) {
+        end = query.size();
+      }
+      terms = Terms(query.substr(i + 1, end - i - 1));
+      i = end + 1;
+    } else {
+      size_t end = query.find_first_of(" \t\r\n", i);
+      if (end == std::string::npos) {
+        end = query.size();
+      }
+      std::string word = query.substr(i, end - i);
+      i = end;
+      prefix = word.back() == '*';
+      terms = Terms(word);
+    }
+    if (terms.empty()) {
+      continue;
+    }
+    // Punctuation inside a word ("e-mail") makes it a phrase.
+    if (terms.size() > 1) {
+      clauses.push_back(MatchPhrase(terms));
+    } else {
+      clauses.push_back(prefix ? MatchPrefix(terms[0]) : MatchTerm(terms[0]));
+    }
+    if (clauses.back().empty()) {
+      return {};
+    }
+  }
+  if (clauses.empty()) {
+    return {};
+  }
+
+  std::sort(clauses.begin(), clauses.end(),
+            [](const Scores& a, const Scores& b) { return a.size() < b.size(); });
+  std::vector<std::pair<double, uint32_t>> ranked;
+  for (const auto& [document, score] : clauses[0]) {
+    double total = score;
+    bool matched = true;
+    for (size_t c = 1; c < clauses.size() && matched; c++) {
+      auto it = clauses[c].find(document);
+      matched = it != clauses[c].end();
+      if (matched) {
+        total += it->second;
+      }
+    }
+    if (matched) {
+      ranked.emplace_back(total, document);
+    }
+  }
+
+  const size_t count = std::min(limit, ranked.size());
+  std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(),
+                    [](const std::pair<double, uint32_t>& a,
+                       const std::pair<double, uint32_t>& b) {
+                      return a.first != b.first ? a.first > b.first
+                                                : a.second > b.second;
+                    });
+  std::vector<SearchHit> hits;
+  hits.reserve(count);
+  for (size_t r = 0; r < count; r++) {
+    const Document& document = documents_[ranked[r].second];
+    hits.push_back(SearchHit{document.conversation_id, document.message_id,
+                             ranked[r].first});
+  }
+  return hits;
+}
+
+void SearchIndex::Serialize(WireWriter* writer) const {
+  writer->WriteU32(static_cast<uint32_t>(documents_.size()));
+  for (const Document& document : documents_) {
+    writer->WriteString(document.conversation_id);
+    writer->WriteString(document.message_id);
+    writer->WriteU32(document.length);
+    writer->WriteU8(document.live ? 1 : 0);
+  }
+  // Terms are front-coded: the length shared with the previous one, then
+  // the rest.
+  writer->WriteU32(static_cast<uint32_t>(terms_.size()));
+  const std::string* previous = nullptr;
+  for (const auto& [term, list] : terms_) {
+    size_t shared = 0;
+    if (previous != nullptr) {
+      const size_t longest = std::min(previous->size(), term.size());
+      while (shared < longest && (*previous)[shared] == term[shared]) {
+        shared++;
+      }
+    }
+    writer->WriteU8(static_cast<uint8_t>(shared));
+    writer->WriteString(term.substr(shared));
+    writer->WriteU32(list.document_count);
+    writer->WriteU32(list.last_document);
+    writer->WriteU32(static_cast<uint32_t>(list.data.size()));
+    writer->WriteBytes(list.data.data(), list.data.size());
+    previous = &term;
+  }
+}
+
+bool SearchIndex::Deserialize(WireReader* reader) {
+  Clear();
+  uint32_t document_count = 0;
+  if (!reader->ReadU32(&document_count) ||
+      document_count > reader->remaining()) {
+    return false;
+  }
+  documents_.resize(document_count);
+  for (uint32_t i = 0; i < document_count; i++) {
+    Document& document = documents_[i];
+    uint8_t live = 0;
+    reader->ReadString(&document.conversation_id);
+    reader->ReadString(&document.message_id);
+    reader->ReadU32(&document.length);
+    if (!reader->ReadU8(&live)) {
+      Clear();
+      return false;
+    }
+    document.live = live != 0;
+    if (document.live) {
+      document_ids_[DocumentKey(document.conversation_id,
+                                document.message_id)] = i;
+      live_documents_++;
+      live_terms_ += document.length;
+    }
+  }
+
+  uint32_t term_count = 0;
+  if (!reader->ReadU32(&term_count) || term_count > reader->remaining()) {
+    Clear();
+    return false;
+  }
+  std::string term;
+  for (uint32_t i = 0; i < term_count; i++) {
+    uint8_t shared = 0;
+    std::string suffix;
+    uint32_t size = 0;
+    const uint8_t* data = nullptr;
+    PostingList list;
+    reader->ReadU8(&shared);
+    reader->ReadString(&suffix);
+    reader->ReadU32(&list.document_count);
+    reader->ReadU32(&list.last_document);
+    reader->ReadU32(&size);
+    if (!reader->ReadSpan(size, &data) || shared > term.size() ||
+        list.last_document >= documents_.size()) {
+      Clear();
+      return false;
+    }
+    term.resize(shared);
+    term.append(suffix);
+    list.data.assign(data, data + size);
+    terms_.emplace_hint(terms_.end(), term, std::move(list));
+  }
+  return true;
+}
+
+std::string SearchIndex::DocumentKey(const std::string& conversation_id,
+                                     const std::string& message_id) {
+  std::string key;
+  key.reserve(conversation_id.size() + 1 + message_id.size());
+  key.append(conversation_id).push_back('\0');
+  key.append(message_id);
+  return key;
+}
+
+double SearchIndex::Score(uint32_t frequency, uint32_t document_frequency,
+                          uint32_t document) const {
+  const double documents = static_cast<double>(live_documents_);
+  // Lists still count removed documents until they are compacted.
+  const double containing =
+      std::min(static_cast<double>(document_frequency), documents);
+  const double idf =
+      std::log(1.0 + (documents - containing + 0.5) / (containing + 0.5));
+  const double average_length =
+      static_cast<double>(live_terms_) / std::max<size_t>(live_documents_, 1);
+  const double length_ratio =
+      average_length > 0 ? documents_[document].length / average_length : 1.0;
+  return idf * frequency * (kK1 + 1) /
+         (frequency + kK1 * (1 - kB + kB * length_ratio));
+}
+
+SearchIndex::Scores SearchIndex::MatchTerm(const std::string& term) const {
+  Scores scores;
+  auto it = terms_.find(term);
+  if (it != terms_.end()) {
+    AddPostings(it->second, &scores);
+  }
+  return scores;
+}
+
+SearchIndex::Scores SearchIndex::MatchPrefix(const std::string& prefix) const {
+  std::vector<const PostingList*> lists;
+  for (auto it = terms_.lower_bound(prefix);
+       it != terms_.end() && it->first.compare(0, prefix.size(), prefix) == 0;
+       ++it) {
+    lists.push_back(&it->second);
+  }
+  if (lists.size() > kMaxPrefixTerms) {
+    std::partial_sort(lists.begin(), lists.begin() + kMaxPrefixTerms,
+                      lists.end(),
+                      [](const PostingList* a, const PostingList* b) {
+                        return a->document_count > b->document_count;
+                      });
+    lists.resize(kMaxPrefixTerms);
+  }
+  Scores scores;
+  for (const PostingList* list : lists) {
+    AddPostings(*list, &scores);
+  }
+  return scores;
+}
+
+SearchIndex::Scores SearchIndex::MatchPhrase(
+    const std::vector<std::string>& terms) const {
+  std::vector<const PostingList*> lists;
+  for (const std::string& term : terms) {
+    auto it = terms_.find(term);
+    if (it == terms_.end()) {
+      return {};
+    }
+    lists.push_back(&it->second);
+  }
+
+  // Where the phrase could start in each document still in the running.
+  std::unordered_map<uint32_t, std::vector<uint32_t>> starts;
+  Scores scores;
+  PostingReader first(lists[0]->data);
+  while (first.Next()) {
+    if (IsLive(first.document())) {
+      starts[first.document()] = first.positions();
+      scores[first.document()] =
+          Score(first.frequency(), lists[0]->document_count, first.document());
+    }
+  }
+  for (size_t i = 1; i < lists.size() && !starts.empty(); i++) {
+    std::unordered_map<uint32_t, std::vector<uint32_t>> remaining;
+    PostingReader reader(lists[i]->data);
+    while (reader.Next()) {
+      auto it = starts.find(reader.document());
+      if (it == starts.end()) {
+        continue;
+      }
+      std::vector<uint32_t> kept;
+      for (uint32_t start : it->second) {
+        if (std::binary_search(reader.positions().begin(),
+                               reader.positions().end(),
+                               start + static_cast<uint32_t>(i))) {
+          kept.push_back(start);
+        }
+      }
+      if (!kept.empty()) {
+        remaining.emplace(reader.document(), std::move(kept));
+        scores[reader.document()] += Score(
+            reader.frequency(), lists[i]->document_count, reader.document());
+      }
+    }
+    starts = std::move(remaining);
+  }
+
+  Scores matched;
+  for (const auto& [document, positions] : starts) {
+    matched.emplace(document, scores[document]);
+  }
+  return matched;
+}
+
+void SearchIndex::AddPostings(const PostingList& list, Scores* scores) const {
+  PostingReader reader(list.data);
+  while (reader.Next()) {
+    if (IsLive(reader.document())) {
+      (*scores)[reader.document()] +=
+          Score(reader.frequency(), list.document_count, reader.document());
+    }
+  }
+}
+
+void SearchIndex::AppendPosting(uint32_t document,
+                                const std::vector<uint32_t>& positions,
+                                PostingList* list) {
+  AppendVarint(
+      list->document_count == 0 ? document : document - list->last_document,
+      &list->data);
+  AppendVarint(static_cast<uint32_t>(positions.size()), &list->data);
+  uint32_t previous = 0;
+  for (uint32_t position : positions) {
+    AppendVarint(position - previous, &list->data);
+    previous = position;
+  }
+  list->document_count++;
+  list->last_document = document;
+}
+
+void SearchIndex::Compact() {
+  std::vector<uint32_t> renumbered(documents_.size(), 0);
+  uint32_t next = 0;
+  for (size_t i = 0; i < documents_.size(); i++) {
+    if (documents_[i].live) {
+      renumbered[i] = next++;
+    }
+  }
+
+  for (auto it = terms_.begin(); it != terms_.end();) {
+    PostingList rewritten;
+    PostingReader reader(it->second.data);
+    while (reader.Next()) {
+      if (IsLive(reader.document())) {
+        AppendPosting(renumbered[reader.document()], reader.positions(),
+                      &rewritten);
+      }
+    }
+    if (rewritten.document_count == 0) {
+      it = terms_.erase(it);
+    } else {
+      it->second = std::move(rewritten);
+      ++it;
+    }
+  }
+
+  documents_.erase(
+      std::remove_if(documents_.begin(), documents_.end(),
+                     [](const Document& document) { return !document.live; }),
+      documents_.end());
+  document_ids_.clear();
+  for (size_t i = 0; i < documents_.size(); i++) {
+    document_ids_[DocumentKey(documents_[i].conversation_id,
+                              documents_[i].message_id)] =
+        static_cast<uint32_t>(i);
+  }
+}
+
+}  // namespace cloudtolocalllm
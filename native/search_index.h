@@ -0,0 +1,120 @@
+#ifndef NATIVE_SEARCH_INDEX_H_
+#define NATIVE_SEARCH_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "native/wire_format.h"
+
+namespace cloudtolocalllm {
+
+// A message matching a query, with its BM25 score.
+struct SearchHit {
+  std::string conversation_id;
+  std::string message_id;
+  double score;
+};
+
+// In-memory inverted index over chat messages.
+//
+// Text is split into terms at anything that is not an ASCII letter or digit
+// or part of a multi-byte UTF-8 sequence, and ASCII letters are lowercased.
+// Each term's posting list is a byte string of delta-coded varints: per
+// message, the gap from the previous message's document number, the term's
+// frequency and the gaps between its positions. Messages get increasing
+// document numbers, so indexing one only appends to the lists of its
+// terms; re-indexing or removing one leaves its old postings behind until
+// dead postings outnumber live ones and the lists are rewritten.
+//
+// Queries are whitespace-separated clauses that must all match:
+//
+//   word      the term
+//   wor*      any term starting with "wor"
+//   "a b c"   the terms next to each other in that order
+//
+// Hits are ranked by BM25 over the matched terms, newer messages first on
+// ties.
+class SearchIndex {
+ public:
+  static constexpr size_t kMaxTermSize = 64;
+  // A prefix clause uses at most this many of the terms it matches, the
+  // ones in the most messages.
+  static constexpr size_t kMaxPrefixTerms = 64;
+
+  SearchIndex();
+  ~SearchIndex();
+
+  // Indexes |text| as the message's content, replacing what was indexed
+  // for it before.
+  void Put(const std::string& conversation_id, const std::string& message_id,
+           const char* text, size_t size);
+  void Remove(const std::string& conversation_id,
+              const std::string& message_id);
+  void Clear();
+
+  // At most |limit| hits, best first.
+  std::vector<SearchHit> Search(const std::string& query, size_t limit) const;
+
+  // The index in the layout Deserialize() reads.
+  void Serialize(WireWriter* writer) const;
+  // Replaces the index; on failure it is left empty.
+  bool Deserialize(WireReader* reader);
+
+  size_t document_count() const { return live_documents_; }
+  size_t term_count() const { return terms_.size(); }
+
+ private:
+  struct Document {
+    std::string conversation_id;
+    std::string message_id;
+    // Terms in the message.
+    uint32_t length;
+    bool live;
+  };
+
+  struct PostingList {
+    std::vector<uint8_t> data;
+    uint32_t document_count = 0;
+    uint32_t last_document = 0;
+  };
+
+  // Matching documents and their scores so far.
+  using Scores = std::unordered_map<uint32_t, double>;
+
+  static std::string DocumentKey(const std::string& conversation_id,
+                                 const std::string& message_id);
+  static void AppendPosting(uint32_t document,
+                            const std::vector<uint32_t>& positions,
+                            PostingList* list);
+
+  // Posting lists are not trusted to only name documents that exist.
+  bool IsLive(uint32_t document) const {
+    return document < documents_.size() && documents_[document].live;
+  }
+
+  double Score(uint32_t frequency, uint32_t document_frequency,
+               uint32_t document) const;
+  Scores MatchTerm(const std::string& term) const;
+  Scores MatchPrefix(const std::string& prefix) const;
+  Scores MatchPhrase(const std::vector<std::string>& terms) const;
+  void AddPostings(const PostingList& list, Scores* scores) const;
+
+  // Rewrites the posting lists without removed documents, renumbering the
+  // rest.
+  void Compact();
+
+  std::vector<Document> documents_;
+  std::unordered_map<std::string, uint32_t> document_ids_;
+  // Ordered so a prefix is a range.
+  std::map<std::string, PostingList> terms_;
+  size_t live_documents_;
+  uint64_t live_terms_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_SEARCH_INDEX_H_
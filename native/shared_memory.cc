@@ -0,0 +1,142 @@
+#include "native/shared_memory.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cstdio>
+#include <random>
+
+namespace cloudtolocalllm {
+
+SharedMemory::SharedMemory()
+    :
+#ifdef _WIN32
+      mapping_(nullptr),
+#endif
+      view_(nullptr),
+      size_(0),
+      linked_(false) {
+}
+
+SharedMemory::~SharedMemory() {
+  Unlink();
+#ifdef _WIN32
+  if (view_ != nullptr) {
+    ::UnmapViewOfFile(view_);
+  }
+  if (mapping_ != nullptr) {
+    ::CloseHandle(mapping_);
+  }
+#else
+  if (view_ != nullptr) {
+    ::munmap(view_, size_);
+  }
+#endif
+}
+
+std::string SharedMemory::UniqueName(const std::string& prefix) {
+  static std::atomic<uint32_t> counter{0};
+  std::random_device random;
+  char suffix[64];
+#ifdef _WIN32
+  const unsigned long pid = ::GetCurrentProcessId();
+#else
+  const unsigned long pid = static_cast<unsigned long>(::getpid());
+#endif
+  std::snprintf(suffix, sizeof(suffix), "-%lu-%u-%08x%08x", pid,
+                static_cast<unsigned>(counter++),
+                static_cast<unsigned>(random()),
+                static_cast<unsigned>(random()));
+#ifdef _WIN32
+  return "Local\\" + prefix + suffix;
+#else
+  return "/" + prefix + suffix;
+#endif
+}
+
+bool SharedMemory::Create(const std::string& name, size_t size) {
+  return Map(name, size, true);
+}
+
+bool SharedMemory::Open(const std::string& name, size_t size) {
+  return Map(name, size, false);
+}
+
+void SharedMemory::Unlink() {
+  if (!linked_) {
+    return;
+  }
+  linked_ = false;
+#ifndef _WIN32
+  ::shm_unlink(name_.c_str());
+#endif
+}
+
+bool SharedMemory::Map(const std::string& name, size_t size, bool create) {
+  if (view_ != nullptr || size == 0) {
+    return false;
+  }
+#ifdef _WIN32
+  // The names are ASCII, so widening them byte by byte is exact.
+  const std::wstring wide_name(name.begin(), name.end());
+  if (create) {
+    const uint64_t size64 = size;
+    mapping_ = ::CreateFileMappingW(
+        INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64),
+        wide_name.c_str());
+    if (mapping_ != nullptr && ::GetLastError() == ERROR_ALREADY_EXISTS) {
+      ::CloseHandle(mapping_);
+      mapping_ = nullptr;
+    }
+  } else {
+    mapping_ = ::OpenFileMappingW(FILE_MAP_READ | FILE_MAP_WRITE, FALSE,
+                                  wide_name.c_str());
+  }
+  if (mapping_ == nullptr) {
+    return false;
+  }
+  // Fails if an opened mapping is smaller than |size|.
+  void* view =
+      ::MapViewOfFile(mapping_, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, size);
+  if (view == nullptr) {
+    return false;
+  }
+#else
+  const int fd =
+      create ? ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600)
+             : ::shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  bool sized = create ? ::ftruncate(fd, static_cast<off_t>(size)) == 0
+                      : ::fstat(fd, &info) == 0 &&
+                            static_cast<size_t>(info.st_size) >= size;
+  void* view = sized ? ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                              MAP_SHARED, fd, 0)
+                     : MAP_FAILED;
+  // The mapping keeps the object open.
+  ::close(fd);
+  if (view == MAP_FAILED) {
+    if (create) {
+      ::shm_unlink(name.c_str());
+    }
+    return false;
+  }
+  linked_ = create;
+#endif
+  view_ = static_cast<uint8_t*>(view);
+  size_ = size;
+  name_ = name;
+  return true;
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,57 @@
+#ifndef NATIVE_SHARED_MEMORY_H_
+#define NATIVE_SHARED_MEMORY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cloudtolocalllm {
+
+// A named block of memory mapped read-write into every process that opens
+// it: a POSIX shm object, or a pagefile-backed file mapping in the session's
+// Local\ namespace on Windows. Only the current user can open it.
+class SharedMemory {
+ public:
+  SharedMemory();
+  ~SharedMemory();
+
+  // Prevent copying.
+  SharedMemory(SharedMemory const&) = delete;
+  SharedMemory& operator=(SharedMemory const&) = delete;
+
+  // A name no other block has, for Create. |prefix| is made of characters
+  // valid in both namespaces.
+  static std::string UniqueName(const std::string& prefix);
+
+  // Creates and maps a zero-filled block of |size| bytes. Fails if |name|
+  // exists already.
+  bool Create(const std::string& name, size_t size);
+
+  // Maps the block another process created as |name|, which must be at
+  // least |size| bytes.
+  bool Open(const std::string& name, size_t size);
+
+  // Removes the name, so no one else can open the block; the mappings stay.
+  // On Windows the name goes with the last handle, so this does nothing.
+  void Unlink();
+
+  uint8_t* data() const { return view_; }
+  size_t size() const { return size_; }
+  const std::string& name() const { return name_; }
+
+ private:
+  bool Map(const std::string& name, size_t size, bool create);
+
+#ifdef _WIN32
+  // HANDLE, kept as void* so this header needs no <windows.h>.
+  void* mapping_;
+#endif
+  uint8_t* view_;
+  size_t size_;
+  std::string name_;
+  bool linked_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_SHARED_MEMORY_H_
@@ -0,0 +1,153 @@
+#include "native/shared_ring.h"
+
+#include <new>
+
+namespace cloudtolocalllm {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x524c5443;  // "CTLR"
+constexpr size_t kLengthSize = 4;
+constexpr size_t kHeadOffset = 64;
+constexpr size_t kTailOffset = 128;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "positions are shared between processes");
+
+size_t RecordSize(size_t payload_size) {
+  return (kLengthSize + payload_size + 7) & ~static_cast<size_t>(7);
+}
+
+void StoreU32(uint8_t* out, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+uint32_t LoadU32(const uint8_t* in) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; i++) {
+    value |= static_cast<uint32_t>(in[i]) << (8 * i);
+  }
+  return value;
+}
+
+}  // namespace
+
+size_t SharedRing::RoundCapacity(size_t capacity) {
+  size_t rounded = kMinCapacity;
+  while (rounded < capacity && rounded < kMaxCapacity) {
+    rounded <<= 1;
+  }
+  return rounded;
+}
+
+SharedRing SharedRing::Initialize(uint8_t* block, size_t capacity) {
+  StoreU32(block, kMagic);
+  StoreU32(block + 4, static_cast<uint32_t>(capacity));
+  new (block + kHeadOffset) std::atomic<uint64_t>(0);
+  new (block + kTailOffset) std::atomic<uint64_t>(0);
+  return SharedRing(block, capacity);
+}
+
+SharedRing SharedRing::Attach(uint8_t* block, size_t block_size) {
+  const size_t capacity =
+      block_size >= kHeaderSize ? LoadU32(block + 4) : 0;
+  SharedRing ring(block, capacity);
+  ring.corrupt_ = block_size < kHeaderSize || LoadU32(block) != kMagic ||
+                  RoundCapacity(capacity) != capacity ||
+                  BlockSize(capacity) > block_size;
+  if (!ring.corrupt_) {
+    ring.position_ = ring.tail_position()->load(std::memory_order_acquire);
+  }
+  return ring;
+}
+
+SharedRing::SharedRing(uint8_t* block, size_t capacity)
+    : block_(block),
+      data_(block + kHeaderSize),
+      capacity_(capacity),
+      corrupt_(false),
+      position_(0),
+      pending_(0) {}
+
+std::atomic<uint64_t>* SharedRing::head_position() const {
+  return reinterpret_cast<std::atomic<uint64_t>*>(block_ + kHeadOffset);
+}
+
+std::atomic<uint64_t>* SharedRing::tail_position() const {
+  return reinterpret_cast<std::atomic<uint64_t>*>(block_ + kTailOffset);
+}
+
+uint8_t* SharedRing::Reserve(size_t size) {
+  const size_t record = RecordSize(size);
+  if (corrupt_ || size >= kWrapMarker || record > capacity_) {
+    return nullptr;
+  }
+  const uint64_t tail = tail_position()->load(std::memory_order_acquire);
+  if (tail > position_ || position_ - tail > capacity_) {
+    corrupt_ = true;
+    return nullptr;
+  }
+
+  size_t index = static_cast<size_t>(position_) & (capacity_ - 1);
+  const size_t room_to_end = capacity_ - index;
+  const size_t needed = record + (room_to_end < record ? room_to_end : 0);
+  if (capacity_ - static_cast<size_t>(position_ - tail) < needed) {
+    return nullptr;
+  }
+  if (room_to_end < record) {
+    // Records are 8-byte aligned, so there is always room for the marker.
+    StoreU32(data_ + index, kWrapMarker);
+    position_ += room_to_end;
+    index = 0;
+  }
+  StoreU32(data_ + index, static_cast<uint32_t>(size));
+  pending_ = record;
+  return data_ + index + kLengthSize;
+}
+
+void SharedRing::Commit() {
+  position_ += pending_;
+  pending_ = 0;
+  head_position()->store(position_, std::memory_order_release);
+}
+
+bool SharedRing::Next(const uint8_t** data, size_t* size) {
+  if (corrupt_) {
+    return false;
+  }
+  const uint64_t head = head_position()->load(std::memory_order_acquire);
+  while (position_ != head) {
+    const uint64_t available = head - position_;
+    const size_t index = static_cast<size_t>(position_) & (capacity_ - 1);
+    const size_t room_to_end = capacity_ - index;
+    if (available > capacity_ || available < kLengthSize) {
+      break;
+    }
+    const uint32_t length = LoadU32(data_ + index);
+    if (length == kWrapMarker) {
+      if (room_to_end > available) {
+        break;
+      }
+      position_ += room_to_end;
+      continue;
+    }
+    const size_t record = RecordSize(length);
+    if (record > available || record > room_to_end) {
+      break;
+    }
+    *data = data_ + index + kLengthSize;
+    *size = length;
+    position_ += record;
+    return true;
+  }
+  corrupt_ = position_ != head;
+  return false;
+}
+
+void SharedRing::Release() {
+  tail_position()->store(position_, std::memory_order_release);
+}
+
+}  // namespace cloudtolocalllm
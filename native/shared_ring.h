@@ -0,0 +1,83 @@
+#ifndef NATIVE_SHARED_RING_H_
+#define NATIVE_SHARED_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace cloudtolocalllm {
+
+// Single-producer/single-consumer ring of variable-length records laid out
+// in a block that two processes map, with SpscRing's record layout: a u32
+// length and the bytes, padded to 8, with kWrapMarker where a record would
+// have straddled the end.
+//
+// The block starts with a header holding the capacity and the two
+// free-running positions, each on a cache line of its own; the records
+// follow. Neither side trusts the other's position: a producer that finds
+// the consumer's tail out of range, or a consumer that finds a record
+// running past the head, marks the ring corrupt and stops using it.
+//
+// There is no doorbell or spill here; the owner of the ring says over some
+// other channel how many records to read, and writes what does not fit
+// some other way.
+class SharedRing {
+ public:
+  static constexpr uint32_t kWrapMarker = 0xffffffff;
+  static constexpr size_t kMinCapacity = 4 * 1024;
+  static constexpr size_t kMaxCapacity = 64 * 1024 * 1024;
+  static constexpr size_t kHeaderSize = 192;
+
+  // Rounds |capacity| up to a power of two within the limits.
+  static size_t RoundCapacity(size_t capacity);
+
+  // Bytes of block a ring of |capacity| takes.
+  static size_t BlockSize(size_t capacity) { return kHeaderSize + capacity; }
+
+  // Lays out a new ring of |capacity|, already rounded, in |block|. The
+  // producer calls this on a zero-filled block.
+  static SharedRing Initialize(uint8_t* block, size_t capacity);
+
+  // Attaches to the ring in |block|, of |block_size| bytes; the ring is
+  // corrupt if the header does not match.
+  static SharedRing Attach(uint8_t* block, size_t block_size);
+
+  // Producer side.
+
+  // Space for a record of |size| bytes, written and then published with
+  // Commit, or null if it does not fit now.
+  uint8_t* Reserve(size_t size);
+  void Commit();
+
+  // Consumer side.
+
+  // Points |*data| at the next record. False if there is none, or if the
+  // ring is corrupt.
+  bool Next(const uint8_t** data, size_t* size);
+
+  // Hands back every record Next has returned.
+  void Release();
+
+  bool corrupt() const { return corrupt_; }
+  size_t capacity() const { return capacity_; }
+
+ private:
+  SharedRing(uint8_t* block, size_t capacity);
+
+  std::atomic<uint64_t>* head_position() const;
+  std::atomic<uint64_t>* tail_position() const;
+
+  uint8_t* block_;
+  uint8_t* data_;
+  size_t capacity_;
+  bool corrupt_;
+  // The side's own position, ahead of the shared one until Commit or
+  // Release.
+  uint64_t position_;
+  // Producer: the reserved record's size.
+  size_t pending_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_SHARED_RING_H_
@@ -0,0 +1,457 @@
+#include "native/socket.h"
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <mstcpip.h>
+#include <afunix.h>
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace cloudtolocalllm {
+
+namespace {
+
+#if defined(_WIN32)
+using NativeSocket = SOCKET;
+
+bool IsWouldBlock() {
+  int error = WSAGetLastError();
+  return error == WSAEWOULDBLOCK || error == WSAEINPROGRESS;
+}
+#else
+using NativeSocket = int;
+
+bool IsWouldBlock() {
+  return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS;
+}
+#endif
+
+NativeSocket ToNative(SocketHandle socket) {
+  return static_cast<NativeSocket>(socket);
+}
+
+bool SetNonBlocking(NativeSocket socket) {
+#if defined(_WIN32)
+  u_long enabled = 1;
+  return ioctlsocket(socket, FIONBIO, &enabled) == 0;
+#else
+  int flags = fcntl(socket, F_GETFL, 0);
+  return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+void SetNoDelay(NativeSocket socket) {
+  int enabled = 1;
+  setsockopt(socket, IPPROTO_TCP, TCP_NODELAY,
+             reinterpret_cast<const char*>(&enabled), sizeof(enabled));
+}
+
+// Fills |address| for |path|; false if the path does not fit.
+bool MakeLocalAddress(const std::string& path, sockaddr_un* address) {
+  std::memset(address, 0, sizeof(*address));
+  address->sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(address->sun_path)) {
+    return false;
+  }
+  std::memcpy(address->sun_path, path.data(), path.size());
+  return true;
+}
+
+}  // namespace
+
+bool InitializeSockets() {
+#if defined(_WIN32)
+  static std::once_flag once;
+  static bool initialized = false;
+  std::call_once(once, []() {
+    WSADATA data;
+    initialized = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+  });
+  return initialized;
+#else
+  return true;
+#endif
+}
+
+SocketHandle ConnectTcp(const std::string& host, uint16_t port,
+                        std::string* error) {
+  if (!InitializeSockets()) {
+    *error = "Socket initialization failed";
+    return kInvalidSocket;
+  }
+
+  addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_protocol = IPPROTO_TCP;
+  addrinfo* results = nullptr;
+  std::string service = std::to_string(port);
+  int status = getaddrinfo(host.c_str(), service.c_str(), &hints, &results);
+  if (status != 0 || results == nullptr) {
+    *error = "Could not resolve " + host;
+    return kInvalidSocket;
+  }
+
+  NativeSocket connected = ToNative(kInvalidSocket);
+  for (addrinfo* info = results; info != nullptr; info = info->ai_next) {
+    NativeSocket candidate =
+        socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+    if (candidate == ToNative(kInvalidSocket)) {
+      continue;
+    }
+    if (!SetNonBlocking(candidate)) {
+      CloseSocket(static_cast<SocketHandle>(candidate));
+      continue;
+    }
+    SetNoDelay(candidate);
+#if defined(__APPLE__)
+    int no_sigpipe = 1;
+    setsockopt(candidate, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe,
+               sizeof(no_sigpipe));
+#endif
+    int result = connect(candidate, info->ai_addr,
+                         static_cast<int>(info->ai_addrlen));
+    if (result == 0 || IsWouldBlock()) {
+      connected = candidate;
+      break;
+    }
+    CloseSocket(static_cast<SocketHandle>(candidate));
+  }
+  freeaddrinfo(results);
+
+  if (connected == ToNative(kInvalidSocket)) {
+    *error = "Could not connect to " + host + ":" + service + ": " +
+             LastSocketErrorString();
+    return kInvalidSocket;
+  }
+  return static_cast<SocketHandle>(connected);
+}
+
+SocketHandle ListenLoopback(uint16_t* port, std::string* error) {
+  if (!InitializeSockets()) {
+    *error = "Sockets are unavailable";
+    return kInvalidSocket;
+  }
+  NativeSocket listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (listener == ToNative(kInvalidSocket)) {
+    *error = "Could not create a socket: " + LastSocketErrorString();
+    return kInvalidSocket;
+  }
+  sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(*port);
+#if defined(_WIN32)
+  int length = sizeof(address);
+#else
+  socklen_t length = sizeof(address);
+#endif
+  if (bind(listener, reinterpret_cast<sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      listen(listener, SOMAXCONN) != 0 ||
+      getsockname(listener, reinterpret_cast<sockaddr*>(&address),
+                  &length) != 0 ||
+      !SetNonBlocking(listener)) {
+    *error = "Could not listen on 127.0.0.1: " + LastSocketErrorString();
+    CloseSocket(static_cast<SocketHandle>(listener));
+    return kInvalidSocket;
+  }
+  *port = ntohs(address.sin_port);
+  return static_cast<SocketHandle>(listener);
+}
+
+SocketHandle ListenLocal(const std::string& path, std::string* error) {
+  sockaddr_un address;
+  if (!InitializeSockets() || !MakeLocalAddress(path, &address)) {
+    *error = "Unusable socket path " + path;
+    return kInvalidSocket;
+  }
+
+  NativeSocket listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener == ToNative(kInvalidSocket)) {
+    *error = "Could not create a local socket: " + LastSocketErrorString();
+    return kInvalidSocket;
+  }
+  bool bound = bind(listener, reinterpret_cast<sockaddr*>(&address),
+                    sizeof(address)) == 0;
+  if (!bound) {
+    // Someone answering means the path is taken; otherwise the file is a
+    // leftover and can go.
+    SocketHandle probe = ConnectLocal(path, error);
+    if (probe != kInvalidSocket) {
+      CloseSocket(probe);
+      CloseSocket(static_cast<SocketHandle>(listener));
+      *error = path + " is already being served";
+      return kInvalidSocket;
+    }
+    std::remove(path.c_str());
+    bound = bind(listener, reinterpret_cast<sockaddr*>(&address),
+                 sizeof(address)) == 0;
+  }
+  if (!bound || listen(listener, SOMAXCONN) != 0 ||
+      !SetNonBlocking(listener)) {
+    *error = "Could not listen on " + path + ": " + LastSocketErrorString();
+    CloseSocket(static_cast<SocketHandle>(listener));
+    return kInvalidSocket;
+  }
+  return static_cast<SocketHandle>(listener);
+}
+
+SocketHandle ConnectLocal(const std::string& path, std::string* error) {
+  sockaddr_un address;
+  if (!InitializeSockets() || !MakeLocalAddress(path, &address)) {
+    *error = "Unusable socket path " + path;
+    return kInvalidSocket;
+  }
+  NativeSocket connected = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (connected == ToNative(kInvalidSocket)) {
+    *error = "Could not create a local socket: " + LastSocketErrorString();
+    return kInvalidSocket;
+  }
+  if (connect(connected, reinterpret_cast<sockaddr*>(&address),
+              sizeof(address)) != 0 ||
+      !SetNonBlocking(connected)) {
+    *error = "Could not connect to " + path + ": " + LastSocketErrorString();
+    CloseSocket(static_cast<SocketHandle>(connected));
+    return kInvalidSocket;
+  }
+  return static_cast<SocketHandle>(connected);
+}
+
+SocketHandle AcceptSocket(SocketHandle listener) {
+  NativeSocket accepted = accept(ToNative(listener), nullptr, nullptr);
+  if (accepted == ToNative(kInvalidSocket)) {
+    return kInvalidSocket;
+  }
+  if (!SetNonBlocking(accepted)) {
+    CloseSocket(static_cast<SocketHandle>(accepted));
+    return kInvalidSocket;
+  }
+  return static_cast<SocketHandle>(accepted);
+}
+
+#if defined(_WIN32)
+bool IsSameUserPeer(SocketHandle /*socket*/) {
+  return true;
+}
+#else
+bool IsSameUserPeer(SocketHandle socket) {
+#if defined(__linux__)
+  ucred credentials;
+  socklen_t length = sizeof(credentials);
+  return getsockopt(ToNative(socket), SOL_SOCKET, SO_PEERCRED, &credentials,
+                    &length) == 0 &&
+         credentials.uid == getuid();
+#else
+  uid_t uid;
+  gid_t gid;
+  return getpeereid(ToNative(socket), &uid, &gid) == 0 && uid == getuid();
+#endif
+}
+#endif
+
+int GetPendingSocketError(SocketHandle socket) {
+  int error = 0;
+#if defined(_WIN32)
+  int length = sizeof(error);
+#else
+  socklen_t length = sizeof(error);
+#endif
+  if (getsockopt(ToNative(socket), SOL_SOCKET, SO_ERROR,
+                 reinterpret_cast<char*>(&error), &length) != 0) {
+    return -1;
+  }
+  return error;
+}
+
+bool SetTcpKeepAlive(SocketHandle socket, int idle_seconds) {
+  NativeSocket handle = ToNative(socket);
+  int enabled = 1;
+  if (setsockopt(handle, SOL_SOCKET, SO_KEEPALIVE,
+                 reinterpret_cast<const char*>(&enabled),
+                 sizeof(enabled)) != 0) {
+    return false;
+  }
+#if defined(_WIN32)
+  tcp_keepalive settings;
+  settings.onoff = 1;
+  settings.keepalivetime = static_cast<ULONG>(idle_seconds) * 1000;
+  settings.keepaliveinterval = 1000;
+  DWORD returned = 0;
+  return WSAIoctl(handle, SIO_KEEPALIVE_VALS, &settings, sizeof(settings),
+                  nullptr, 0, &returned, nullptr, nullptr) == 0;
+#elif defined(__linux__)
+  int interval = 1;
+  int count = 5;
+  return setsockopt(handle, IPPROTO_TCP, TCP_KEEPIDLE, &idle_seconds,
+                    sizeof(idle_seconds)) == 0 &&
+         setsockopt(handle, IPPROTO_TCP, TCP_KEEPINTVL, &interval,
+                    sizeof(interval)) == 0 &&
+         setsockopt(handle, IPPROTO_TCP, TCP_KEEPCNT, &count,
+                    sizeof(count)) == 0;
+#else
+  return true;
+#endif
+}
+
+long SendSome(SocketHandle socket, const void* data, size_t size) {
+#if defined(_WIN32)
+  int sent = send(ToNative(socket), static_cast<const char*>(data),
+                  static_cast<int>(size), 0);
+#elif defined(__linux__)
+  ssize_t sent = send(ToNative(socket), data, size, MSG_NOSIGNAL);
+#else
+  ssize_t sent = send(ToNative(socket), data, size, 0);
+#endif
+  if (sent >= 0) {
+    return static_cast<long>(sent);
+  }
+  return IsWouldBlock() ? kSocketWouldBlock : kSocketError;
+}
+
+long RecvSome(SocketHandle socket, void* data, size_t size) {
+#if defined(_WIN32)
+  int received =
+      recv(ToNative(socket), static_cast<char*>(data), static_cast<int>(size), 0);
+#else
+  ssize_t received = recv(ToNative(socket), data, size, 0);
+#endif
+  if (received >= 0) {
+    return static_cast<long>(received);
+  }
+  return IsWouldBlock() ? kSocketWouldBlock : kSocketError;
+}
+
+void CloseSocket(SocketHandle socket) {
+  if (socket == kInvalidSocket) {
+    return;
+  }
+#if defined(_WIN32)
+  closesocket(ToNative(socket));
+#else
+  close(ToNative(socket));
+#endif
+}
+
+int PollSockets(PollEntry* entries, size_t count, int timeout_ms) {
+  // Each polling thread keeps its array between calls rather than
+  // allocating one per wakeup.
+#if defined(_WIN32)
+  thread_local std::vector<WSAPOLLFD> fds;
+#else
+  thread_local std::vector<pollfd> fds;
+#endif
+  fds.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    fds[i].fd = ToNative(entries[i].handle);
+    fds[i].events = 0;
+    if (entries[i].events & kPollIn) {
+      fds[i].events |= POLLIN;
+    }
+    if (entries[i].events & kPollOut) {
+      fds[i].events |= POLLOUT;
+    }
+    fds[i].revents = 0;
+  }
+#if defined(_WIN32)
+  int ready = WSAPoll(fds.data(), static_cast<ULONG>(count), timeout_ms);
+#else
+  int ready = poll(fds.data(), static_cast<nfds_t>(count), timeout_ms);
+  if (ready < 0 && errno == EINTR) {
+    ready = 0;
+  }
+#endif
+  for (size_t i = 0; i < count; i++) {
+    short revents = 0;
+    if (fds[i].revents & (POLLIN | POLLHUP)) {
+      revents |= kPollIn;
+    }
+    if (fds[i].revents & POLLOUT) {
+      revents |= kPollOut;
+    }
+    if (fds[i].revents & (POLLERR | POLLNVAL)) {
+      revents |= kPollError;
+    }
+    entries[i].revents = revents;
+  }
+  return ready;
+}
+
+bool CreateWakePair(SocketHandle* read_end, SocketHandle* write_end) {
+  if (!InitializeSockets()) {
+    return false;
+  }
+  NativeSocket listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (listener == ToNative(kInvalidSocket)) {
+    return false;
+  }
+  sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+#if defined(_WIN32)
+  int length = sizeof(address);
+#else
+  socklen_t length = sizeof(address);
+#endif
+  NativeSocket writer = ToNative(kInvalidSocket);
+  NativeSocket reader = ToNative(kInvalidSocket);
+  bool ok =
+      bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) ==
+          0 &&
+      listen(listener, 1) == 0 &&
+      getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) ==
+          0;
+  if (ok) {
+    writer = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ok = writer != ToNative(kInvalidSocket) &&
+         connect(writer, reinterpret_cast<sockaddr*>(&address),
+                 sizeof(address)) == 0;
+  }
+  if (ok) {
+    reader = accept(listener, nullptr, nullptr);
+    ok = reader != ToNative(kInvalidSocket);
+  }
+  CloseSocket(static_cast<SocketHandle>(listener));
+  if (ok) {
+    ok = SetNonBlocking(reader) && SetNonBlocking(writer);
+    SetNoDelay(writer);
+  }
+  if (!ok) {
+    CloseSocket(static_cast<SocketHandle>(reader));
+    CloseSocket(static_cast<SocketHandle>(writer));
+    return false;
+  }
+  *read_end = static_cast<SocketHandle>(reader);
+  *write_end = static_cast<SocketHandle>(writer);
+  return true;
+}
+
+std::string LastSocketErrorString() {
+#if defined(_WIN32)
+  return "WSA error " + std::to_string(WSAGetLastError());
+#else
+  return std::strerror(errno);
+#endif
+}
+
+}  // namespace cloudtolocalllm
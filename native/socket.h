@@ -0,0 +1,103 @@
+#ifndef NATIVE_SOCKET_H_
+#define NATIVE_SOCKET_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cloudtolocalllm {
+
+// Thin portability layer over BSD sockets and Winsock. Handles are kept as
+// plain integers so this header does not drag <winsock2.h> (which must be
+// included before <windows.h>) into every file that uses it.
+#if defined(_WIN32)
+using SocketHandle = uintptr_t;
+#else
+using SocketHandle = int;
+#endif
+
+constexpr SocketHandle kInvalidSocket = static_cast<SocketHandle>(-1);
+
+// Result codes for SendSome/RecvSome besides a byte count.
+constexpr long kSocketWouldBlock = -1;
+constexpr long kSocketError = -2;
+
+// Event bits for PollEntry.
+constexpr short kPollIn = 1 << 0;
+constexpr short kPollOut = 1 << 1;
+constexpr short kPollError = 1 << 2;
+
+struct PollEntry {
+  SocketHandle handle;
+  short events;
+  short revents;
+};
+
+// Performs process-wide socket initialization (WSAStartup on Windows).
+// Safe to call repeatedly; returns false if sockets are unusable.
+bool InitializeSockets();
+
+// Starts a non-blocking TCP connect to |host|:|port| with TCP_NODELAY set.
+// The returned socket becomes writable once the connection is established;
+// check GetPendingSocketError then. Returns kInvalidSocket and fills |error|
+// if resolution or socket creation fails.
+SocketHandle ConnectTcp(const std::string& host, uint16_t port,
+                        std::string* error);
+
+// Starts listening on a non-blocking TCP socket on 127.0.0.1, on an
+// ephemeral port when |*port| is 0; |*port| is set to the one bound. For
+// stand-ins of a local server, as in the benchmarks.
+SocketHandle ListenLoopback(uint16_t* port, std::string* error);
+
+// Starts listening on a non-blocking Unix domain socket at |path|, which
+// Windows 10 supports through AF_UNIX as well. A socket file left behind by
+// a process that is gone is replaced; one still being served fails with
+// |error| set. The caller removes the file once done with it.
+SocketHandle ListenLocal(const std::string& path, std::string* error);
+
+// Connects to the Unix domain socket at |path|. Local connects complete at
+// once, so this blocks; the returned socket is non-blocking.
+SocketHandle ConnectLocal(const std::string& path, std::string* error);
+
+// Accepts a pending connection on |listener| as a non-blocking socket, or
+// returns kInvalidSocket if none is waiting.
+SocketHandle AcceptSocket(SocketHandle listener);
+
+// Whether the process at the other end of the local socket |socket| runs
+// as the same user as this one. Always true on Windows, where the socket
+// file's ACL, inherited from the per-user directory it lives in, does the
+// same job.
+bool IsSameUserPeer(SocketHandle socket);
+
+// Returns the pending error for |socket| (0 if none), typically used after a
+// non-blocking connect reports writable.
+int GetPendingSocketError(SocketHandle socket);
+
+// Enables TCP keepalive probes after |idle_seconds| of silence.
+bool SetTcpKeepAlive(SocketHandle socket, int idle_seconds);
+
+// Sends as much of |data| as the socket accepts without blocking. Returns
+// the number of bytes sent, kSocketWouldBlock or kSocketError.
+long SendSome(SocketHandle socket, const void* data, size_t size);
+
+// Receives up to |size| bytes without blocking. Returns the number of bytes
+// read, 0 on orderly shutdown, kSocketWouldBlock or kSocketError.
+long RecvSome(SocketHandle socket, void* data, size_t size);
+
+void CloseSocket(SocketHandle socket);
+
+// Waits up to |timeout_ms| (-1 for forever) for any entry to become ready.
+// Returns the number of ready entries, 0 on timeout, or -1 on error.
+int PollSockets(PollEntry* entries, size_t count, int timeout_ms);
+
+// Creates a connected pair of loopback sockets used to wake a thread blocked
+// in PollSockets. Windows has no socketpair(), so both platforms use the
+// same listen/connect/accept dance on 127.0.0.1.
+bool CreateWakePair(SocketHandle* read_end, SocketHandle* write_end);
+
+// Returns a description of the last socket error on this thread.
+std::string LastSocketErrorString();
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_SOCKET_H_
@@ -0,0 +1,236 @@
+#include "native/spsc_ring.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace cloudtolocalllm {
+
+namespace {
+
+constexpr size_t kLengthSize = 4;
+
+size_t RecordSize(size_t payload_size) {
+  return (kLengthSize + payload_size + 7) & ~static_cast<size_t>(7);
+}
+
+size_t RoundCapacity(size_t capacity) {
+  size_t rounded = SpscRing::kMinCapacity;
+  while (rounded < capacity && rounded < SpscRing::kMaxCapacity) {
+    rounded <<= 1;
+  }
+  return rounded;
+}
+
+void StoreU32(uint8_t* out, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+void AppendRecord(std::vector<uint8_t>* out, const uint8_t* data,
+                  size_t size) {
+  const size_t offset = out->size();
+  out->resize(offset + RecordSize(size), 0);
+  StoreU32(out->data() + offset, static_cast<uint32_t>(size));
+  if (size > 0) {
+    std::memcpy(out->data() + offset + kLengthSize, data, size);
+  }
+}
+
+}  // namespace
+
+SpscRing::SpscRing(size_t capacity, Doorbell doorbell, int64_t tag)
+    : capacity_(RoundCapacity(capacity)),
+      mask_(capacity_ - 1),
+      buffer_(new uint8_t[capacity_]),
+      head_(0),
+      tail_(0),
+      // A fresh consumer is waiting for its first record.
+      armed_(true),
+      spilling_(false),
+      staged_offset_(0),
+      reading_staging_(false),
+      producer_(std::thread::id()),
+      doorbell_(doorbell),
+      tag_(tag),
+      records_(0),
+      spilled_(0),
+      doorbells_(0) {}
+
+SpscRing::~SpscRing() = default;
+
+void SpscRing::Write(const uint8_t* data, size_t size) {
+#ifndef NDEBUG
+  CheckProducer();
+#endif
+  records_.fetch_add(1, std::memory_order_relaxed);
+  // Once anything has spilled, later records follow it into the spill
+  // buffer until the consumer has taken it, which keeps them in order.
+  if (spilling_.load(std::memory_order_acquire) || !TryWrite(data, size)) {
+    std::lock_guard<std::mutex> lock(spill_mutex_);
+    AppendRecord(&spill_, data, size);
+    spilling_.store(true, std::memory_order_release);
+    spilled_.fetch_add(1, std::memory_order_relaxed);
+  }
+  RingDoorbell();
+}
+
+void SpscRing::HandOffProducer() {
+  producer_.store(std::thread::id(), std::memory_order_relaxed);
+}
+
+void SpscRing::CheckProducer() {
+  const std::thread::id self = std::this_thread::get_id();
+  std::thread::id producer;
+  if (producer_.compare_exchange_strong(producer, self,
+                                        std::memory_order_relaxed)) {
+    return;
+  }
+  // A second producer races on head_, the spill buffer and the doorbell.
+  assert(producer == self && "SpscRing::Write called from a second thread");
+  (void)producer;
+}
+
+bool SpscRing::TryWrite(const uint8_t* data, size_t size) {
+  const size_t record = RecordSize(size);
+  if (size >= kWrapMarker || record > capacity_) {
+    return false;
+  }
+
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  const uint64_t tail = tail_.load(std::memory_order_acquire);
+  size_t index = static_cast<size_t>(head) & mask_;
+  const size_t room_to_end = capacity_ - index;
+  const size_t needed = record + (room_to_end < record ? room_to_end : 0);
+  if (capacity_ - static_cast<size_t>(head - tail) < needed) {
+    return false;
+  }
+
+  if (room_to_end < record) {
+    // Records are 8-byte aligned, so there is always room for the marker.
+    StoreU32(buffer_.get() + index, kWrapMarker);
+    head += room_to_end;
+    index = 0;
+  }
+  StoreU32(buffer_.get() + index, static_cast<uint32_t>(size));
+  if (size > 0) {
+    std::memcpy(buffer_.get() + index + kLengthSize, data, size);
+  }
+  head_.store(head + record, std::memory_order_release);
+  return true;
+}
+
+void SpscRing::RingDoorbell() {
+  // Pairs with the fence in Arm(): either the consumer sees the record, or
+  // this sees the consumer armed.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!armed_.load(std::memory_order_relaxed) ||
+      !armed_.exchange(false, std::memory_order_acq_rel)) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(doorbell_mutex_);
+  if (doorbell_ != nullptr) {
+    doorbells_.fetch_add(1, std::memory_order_relaxed);
+    doorbell_(tag_);
+  }
+}
+
+void SpscRing::DetachDoorbell() {
+  std::lock_guard<std::mutex> lock(doorbell_mutex_);
+  doorbell_ = nullptr;
+}
+
+bool SpscRing::HasRecords() const {
+  return head_.load(std::memory_order_acquire) !=
+             tail_.load(std::memory_order_relaxed) ||
+         spilling_.load(std::memory_order_acquire);
+}
+
+size_t SpscRing::Read(const uint8_t** data) {
+  reading_staging_ = false;
+  read_span_ = ReadSpan();
+  *data = nullptr;
+
+  if (staged_offset_ < staging_.size()) {
+    reading_staging_ = true;
+    *data = staging_.data() + staged_offset_;
+    read_span_.data = *data;
+    read_span_.size = staging_.size() - staged_offset_;
+    return static_cast<size_t>(read_span_.size);
+  }
+
+  const uint64_t tail = tail_.load(std::memory_order_relaxed);
+  uint64_t head = head_.load(std::memory_order_acquire);
+  if (head == tail && spilling_.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(spill_mutex_);
+    // Everything written before the first spilled record is visible now.
+    head = head_.load(std::memory_order_acquire);
+    if (head == tail) {
+      staging_.clear();
+      staged_offset_ = 0;
+      staging_.swap(spill_);
+      spilling_.store(false, std::memory_order_release);
+      return Read(data);
+    }
+  }
+  if (head == tail) {
+    return 0;
+  }
+
+  const size_t index = static_cast<size_t>(tail) & mask_;
+  const size_t size =
+      std::min(static_cast<size_t>(head - tail), capacity_ - index);
+  *data = buffer_.get() + index;
+  read_span_.data = *data;
+  read_span_.size = size;
+  return size;
+}
+
+void SpscRing::Consume(size_t size) {
+  if (reading_staging_) {
+    staged_offset_ += size;
+    if (staged_offset_ >= staging_.size()) {
+      staging_.clear();
+      staged_offset_ = 0;
+    }
+    return;
+  }
+  tail_.store(tail_.load(std::memory_order_relaxed) + size,
+              std::memory_order_release);
+}
+
+bool SpscRing::Arm() {
+  armed_.store(true, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (staged_offset_ >= staging_.size() && !HasRecords()) {
+    return true;
+  }
+  // Something slipped in. If the producer already claimed the arm its
+  // doorbell is on the way and reading now just makes it a no-op.
+  armed_.store(false, std::memory_order_relaxed);
+  return false;
+}
+
+SpscRing::Stats SpscRing::stats() const {
+  Stats stats;
+  stats.records = records_.load(std::memory_order_relaxed);
+  stats.spilled = spilled_.load(std::memory_order_relaxed);
+  stats.doorbells = doorbells_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+size_t SpscRingRead(SpscRing* ring) {
+  const uint8_t* data = nullptr;
+  return ring->Read(&data);
+}
+
+void SpscRingConsume(SpscRing* ring, size_t size) {
+  ring->Consume(size);
+}
+
+uint8_t SpscRingArm(SpscRing* ring) {
+  return ring->Arm() ? 1 : 0;
+}
+
+}  // namespace cloudtolocalllm
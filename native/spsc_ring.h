@@ -0,0 +1,149 @@
+#ifndef NATIVE_SPSC_RING_H_
+#define NATIVE_SPSC_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cloudtolocalllm {
+
+// Lock-free single-producer/single-consumer ring of variable-length records
+// in one block of native memory, read directly by the Dart isolate over FFI
+// so bursts of events reach Dart without a platform-channel message each.
+//
+// Records are a u32 length followed by the bytes, padded to 8 bytes. A
+// record never straddles the end of the buffer: when it would not fit, the
+// producer writes kWrapMarker as the length and the record starts again at
+// offset 0. Head and tail are free-running byte counts, so the buffer is
+// empty when they are equal.
+//
+// The consumer drains until Read() returns 0 and then calls Arm(). The next
+// write after that rings the doorbell once, from the producer's thread, so
+// an idle consumer costs nothing and a busy one is never notified per
+// record. Writes that do not fit are appended to a spill buffer under a
+// mutex and handed to the consumer, in order, once the ring is drained;
+// nothing is ever dropped or reordered.
+//
+// All of that holds only while one thread at a time writes. Debug builds
+// assert it: Write fails if it is called from a thread other than the one
+// that wrote last, unless HandOffProducer was called in between.
+class SpscRing {
+ public:
+  // Called on the producer thread with |tag| when the consumer is armed.
+  // Must be safe to call from any thread; a Dart NativeCallable.listener
+  // qualifies.
+  using Doorbell = void (*)(int64_t tag);
+
+  static constexpr uint32_t kWrapMarker = 0xffffffff;
+  static constexpr size_t kMinCapacity = 4 * 1024;
+  static constexpr size_t kMaxCapacity = 16 * 1024 * 1024;
+
+  // The span handed out by the last Read(), for FFI callers that cannot
+  // pass out-parameters.
+  struct ReadSpan {
+    const uint8_t* data = nullptr;
+    uint64_t size = 0;
+  };
+
+  struct Stats {
+    uint64_t records = 0;
+    uint64_t spilled = 0;
+    uint64_t doorbells = 0;
+  };
+
+  // |capacity| is rounded up to a power of two within
+  // [kMinCapacity, kMaxCapacity].
+  SpscRing(size_t capacity, Doorbell doorbell, int64_t tag);
+  ~SpscRing();
+
+  // Prevent copying.
+  SpscRing(SpscRing const&) = delete;
+  SpscRing& operator=(SpscRing const&) = delete;
+
+  // Producer side.
+
+  // Appends one record, spilling if the ring is full, and rings the
+  // doorbell if the consumer is armed.
+  void Write(const uint8_t* data, size_t size);
+
+  // Lets the next Write come from another thread, once the current
+  // producer has stopped writing for good (its thread was joined, say).
+  void HandOffProducer();
+
+  // Stops further doorbell calls; returns once none is in progress, so the
+  // doorbell can be released afterwards.
+  void DetachDoorbell();
+
+  // Consumer side.
+
+  // Returns the size of the next contiguous run of whole records and points
+  // |*data| (and read_span()) at it, or 0 if there is nothing to read.
+  size_t Read(const uint8_t** data);
+
+  // Releases the first |size| bytes of the span returned by Read().
+  void Consume(size_t size);
+
+  // Asks for the doorbell on the next write. Returns false, without arming,
+  // if records arrived in the meantime and the consumer should keep
+  // reading.
+  bool Arm();
+
+  const ReadSpan* read_span() const { return &read_span_; }
+  size_t capacity() const { return capacity_; }
+  Stats stats() const;
+
+ private:
+  bool TryWrite(const uint8_t* data, size_t size);
+  void CheckProducer();
+  bool HasRecords() const;
+  void RingDoorbell();
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<uint8_t[]> buffer_;
+
+  // Written by the producer, read by the consumer, and vice versa; kept on
+  // separate cache lines so the two threads don't contend.
+  alignas(64) std::atomic<uint64_t> head_;
+  alignas(64) std::atomic<uint64_t> tail_;
+  alignas(64) std::atomic<bool> armed_;
+  std::atomic<bool> spilling_;
+
+  // Overflow, in the same record layout. The producer appends to spill_;
+  // the consumer swaps it into staging_ once the ring is empty.
+  std::mutex spill_mutex_;
+  std::vector<uint8_t> spill_;
+
+  // Consumer-only state.
+  std::vector<uint8_t> staging_;
+  size_t staged_offset_;
+  bool reading_staging_;
+  ReadSpan read_span_;
+
+  // The thread writing records, or none before the first Write and after
+  // HandOffProducer. Only checked in debug builds; kept in all of them so
+  // the layout does not depend on NDEBUG.
+  std::atomic<std::thread::id> producer_;
+
+  std::mutex doorbell_mutex_;
+  Doorbell doorbell_;
+  const int64_t tag_;
+
+  std::atomic<uint64_t> records_;
+  std::atomic<uint64_t> spilled_;
+  std::atomic<uint64_t> doorbells_;
+};
+
+// C-compatible entry points for the consumer, whose addresses are handed to
+// Dart and called through dart:ffi.
+size_t SpscRingRead(SpscRing* ring);
+void SpscRingConsume(SpscRing* ring, size_t size);
+uint8_t SpscRingArm(SpscRing* ring);
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_SPSC_RING_H_
@@ -0,0 +1,242 @@
+#include "native/startup_trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "native/utf_transcode.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+constexpr char kDefaultFileName[] = "cloudtolocalllm_startup_trace.json";
+
+std::string ReadEnvironment(const char* name) {
+#ifdef _WIN32
+  std::wstring wide_name(name, name + std::char_traits<char>::length(name));
+  wchar_t buffer[MAX_PATH];
+  const DWORD length =
+      ::GetEnvironmentVariableW(wide_name.c_str(), buffer, MAX_PATH);
+  if (length == 0 || length >= MAX_PATH) {
+    return std::string();
+  }
+  std::string value;
+  Utf16ToUtf8(buffer, length, &value);
+  return value;
+#else
+  const char* value = std::getenv(name);
+  return value != nullptr ? std::string(value) : std::string();
+#endif
+}
+
+// How long ago the OS created this process, or 0 if unknown.
+int64_t ProcessAgeMicroseconds() {
+#ifdef _WIN32
+  FILETIME creation, exit, kernel, user, now;
+  if (!::GetProcessTimes(::GetCurrentProcess(), &creation, &exit, &kernel,
+                         &user)) {
+    return 0;
+  }
+  ::GetSystemTimePreciseAsFileTime(&now);
+  auto ticks = [](const FILETIME& time) {
+    return (static_cast<int64_t>(time.dwHighDateTime) << 32) |
+           time.dwLowDateTime;
+  };
+  // FILETIME counts 100 ns intervals.
+  return std::max<int64_t>(0, (ticks(now) - ticks(creation)) / 10);
+#else
+  // Field 22 of /proc/self/stat is the start time in clock ticks since boot,
+  // so this is only accurate to a tick (usually 10 ms).
+  std::ifstream stat("/proc/self/stat");
+  std::string contents((std::istreambuf_iterator<char>(stat)),
+                       std::istreambuf_iterator<char>());
+  const size_t comm_end = contents.rfind(')');
+  if (comm_end == std::string::npos) {
+    return 0;
+  }
+  std::istringstream fields(contents.substr(comm_end + 1));
+  std::string field;
+  for (int i = 3; i <= 22 && (fields >> field); i++) {
+  }
+  const long ticks_per_second = ::sysconf(_SC_CLK_TCK);
+  struct timespec boot_time;
+  if (!fields || ticks_per_second <= 0 ||
+      ::clock_gettime(CLOCK_BOOTTIME, &boot_time) != 0) {
+    return 0;
+  }
+  const int64_t started_us =
+      std::strtoll(field.c_str(), nullptr, 10) * 1000000 / ticks_per_second;
+  const int64_t now_us = static_cast<int64_t>(boot_time.tv_sec) * 1000000 +
+                         boot_time.tv_nsec / 1000;
+  return std::max<int64_t>(0, now_us - started_us);
+#endif
+}
+
+uint32_t ProcessId() {
+#ifdef _WIN32
+  return static_cast<uint32_t>(::GetCurrentProcessId());
+#else
+  return static_cast<uint32_t>(::getpid());
+#endif
+}
+
+void AppendJsonString(const std::string& value, std::string* out) {
+  out->push_back('"');
+  for (char c : value) {
+    switch (c) {
+      case '"':
+        out->append("\\\"");
+        break;
+      case '\\':
+        out->append("\\\\");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          std::snprintf(escaped, sizeof(escaped), "\\u%04x",
+                        static_cast<unsigned char>(c));
+          out->append(escaped);
+        } else {
+          out->push_back(c);
+        }
+    }
+  }
+  out->push_back('"');
+}
+
+}  // namespace
+
+StartupTrace* StartupTrace::Get() {
+  static StartupTrace* trace = new StartupTrace();
+  return trace;
+}
+
+StartupTrace::StartupTrace()
+    : enabled_(false), origin_(std::chrono::steady_clock::now()) {}
+
+void StartupTrace::Configure(std::vector<std::string>* arguments) {
+  std::string path = ReadEnvironment(kEnvironmentVariable);
+  bool requested = !path.empty();
+
+  const std::string flag(kFlag);
+  auto it = std::find_if(
+      arguments->begin(), arguments->end(), [&flag](const std::string& arg) {
+        return arg == flag || arg.compare(0, flag.size() + 1, flag + "=") == 0;
+      });
+  if (it != arguments->end()) {
+    requested = true;
+    if (it->size() > flag.size()) {
+      path = it->substr(flag.size() + 1);
+    }
+    arguments->erase(it);
+  }
+  if (!requested || enabled()) {
+    return;
+  }
+
+  if (path.empty()) {
+    std::error_code error;
+    const std::filesystem::path temp =
+        std::filesystem::temp_directory_path(error);
+    path = (error ? std::filesystem::path(kDefaultFileName)
+                  : temp / kDefaultFileName)
+               .u8string();
+  }
+  path_ = path;
+  origin_ = std::chrono::steady_clock::now() -
+            std::chrono::microseconds(ProcessAgeMicroseconds());
+  enabled_.store(true, std::memory_order_relaxed);
+
+  // Stamped with the creation time rather than now.
+  std::lock_guard<std::mutex> lock(mutex_);
+  events_.push_back(
+      Event{"process start", 'i', 0, ThreadIndex(std::this_thread::get_id())});
+}
+
+void StartupTrace::Instant(const char* name) {
+  Record(name, 'i');
+}
+
+void StartupTrace::Begin(const char* name) {
+  Record(name, 'B');
+}
+
+void StartupTrace::End() {
+  Record("", 'E');
+}
+
+void StartupTrace::Record(const char* name, char phase) {
+  if (!enabled()) {
+    return;
+  }
+  const int64_t now = Now();
+  std::lock_guard<std::mutex> lock(mutex_);
+  events_.push_back(
+      Event{name, phase, now, ThreadIndex(std::this_thread::get_id())});
+}
+
+int64_t StartupTrace::Now() const {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - origin_)
+      .count();
+}
+
+uint32_t StartupTrace::ThreadIndex(std::thread::id id) {
+  auto it = std::find(threads_.begin(), threads_.end(), id);
+  if (it != threads_.end()) {
+    return static_cast<uint32_t>(it - threads_.begin());
+  }
+  threads_.push_back(id);
+  return static_cast<uint32_t>(threads_.size() - 1);
+}
+
+bool StartupTrace::Flush() {
+  if (!enabled_.exchange(false)) {
+    return false;
+  }
+
+  std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  const std::string pid = std::to_string(ProcessId());
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < events_.size(); i++) {
+    const Event& event = events_[i];
+    if (i > 0) {
+      json.push_back(',');
+    }
+    json.append("\n{\"name\":");
+    AppendJsonString(event.name, &json);
+    json.append(",\"cat\":\"startup\",\"ph\":\"");
+    json.push_back(event.phase);
+    json.append("\",\"ts\":");
+    json.append(std::to_string(event.timestamp_us));
+    json.append(",\"pid\":");
+    json.append(pid);
+    json.append(",\"tid\":");
+    json.append(std::to_string(event.thread));
+    if (event.phase == 'i') {
+      json.append(",\"s\":\"p\"");
+    }
+    json.push_back('}');
+  }
+  json.append("\n]}\n");
+  events_.clear();
+
+  std::ofstream out(std::filesystem::u8path(path_),
+                    std::ios::binary | std::ios::trunc);
+  out << json;
+  out.close();
+  return !out.fail();
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,94 @@
+#ifndef NATIVE_STARTUP_TRACE_H_
+#define NATIVE_STARTUP_TRACE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cloudtolocalllm {
+
+// Records the desktop runners' startup milestones and writes them as a
+// Chrome trace (open in chrome://tracing or ui.perfetto.dev), so cold start
+// can be measured from process creation to the first Flutter frame.
+//
+// Tracing is off unless the CLOUDTOLOCALLLM_TRACE_STARTUP environment
+// variable is set to an output path, or the runner is started with
+// --trace-startup[=path]. Without a path the trace goes to
+// cloudtolocalllm_startup_trace.json in the temp directory. When disabled
+// every call is a cheap no-op.
+//
+// Timestamps are microseconds since the process was created, as reported by
+// the OS, so the time spent loading the executable and its DLLs or shared
+// libraries before main() shows up as the gap before the first event.
+class StartupTrace {
+ public:
+  static constexpr char kEnvironmentVariable[] =
+      "CLOUDTOLOCALLLM_TRACE_STARTUP";
+  static constexpr char kFlag[] = "--trace-startup";
+
+  // The process-wide trace.
+  static StartupTrace* Get();
+
+  // Enables tracing from the environment or the command line, removing the
+  // flag from |arguments| so it is not passed on to Dart. Records the
+  // "process start" event when enabled.
+  void Configure(std::vector<std::string>* arguments);
+
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  // A point in time on the calling thread.
+  void Instant(const char* name);
+
+  // Brackets a span on the calling thread; spans on one thread must nest.
+  void Begin(const char* name);
+  void End();
+
+  // Writes the trace recorded so far and stops tracing. Returns false if
+  // tracing is off or the file could not be written.
+  bool Flush();
+
+ private:
+  struct Event {
+    std::string name;
+    char phase;
+    int64_t timestamp_us;
+    uint32_t thread;
+  };
+
+  StartupTrace();
+
+  void Record(const char* name, char phase);
+  int64_t Now() const;
+  uint32_t ThreadIndex(std::thread::id id);
+
+  std::atomic<bool> enabled_;
+  std::string path_;
+  // Steady-clock time of process creation; event timestamps are relative to
+  // it.
+  std::chrono::steady_clock::time_point origin_;
+
+  std::mutex mutex_;
+  std::vector<Event> events_;
+  std::vector<std::thread::id> threads_;
+};
+
+// Traces the enclosing scope as a span.
+class ScopedStartupTrace {
+ public:
+  explicit ScopedStartupTrace(const char* name) {
+    StartupTrace::Get()->Begin(name);
+  }
+  ~ScopedStartupTrace() { StartupTrace::Get()->End(); }
+
+  // Prevent copying.
+  ScopedStartupTrace(ScopedStartupTrace const&) = delete;
+  ScopedStartupTrace& operator=(ScopedStartupTrace const&) = delete;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_STARTUP_TRACE_H_
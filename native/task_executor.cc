@@ -0,0 +1,243 @@
+#include "native/task_executor.h"
+
+#include <utility>
+
+namespace cloudtolocalllm {
+
+namespace {
+
+// The executor and worker index of the calling thread, so a task's own
+// posts stay on its worker's deque.
+thread_local const TaskExecutor* current_executor = nullptr;
+thread_local size_t current_worker = 0;
+
+size_t LaneIndex(TaskExecutor::Lane lane) {
+  return static_cast<size_t>(lane);
+}
+
+size_t DefaultThreadCount() {
+  const unsigned cores = std::thread::hardware_concurrency();
+  return cores == 0 ? 1 : cores;
+}
+
+}  // namespace
+
+TaskExecutor::TaskExecutor() : TaskExecutor(Options()) {}
+
+TaskExecutor::TaskExecutor(const Options& options) : options_(options) {
+  const size_t threads =
+      options_.threads == 0 ? DefaultThreadCount() : options_.threads;
+  workers_.reserve(threads);
+  for (size_t i = 0; i < threads; i++) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+}
+
+TaskExecutor::~TaskExecutor() {
+  Stop();
+}
+
+void TaskExecutor::Start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (started_ || stopping_) {
+    return;
+  }
+  started_ = true;
+  for (size_t i = 0; i < workers_.size(); i++) {
+    workers_[i]->thread = std::thread([this, i]() { Run(i); });
+  }
+}
+
+void TaskExecutor::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto& worker : workers_) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+
+  // Dropped outside the locks, in case a task's destructor posts.
+  std::deque<Task> dropped;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    dropped.swap(interactive_);
+    for (auto& task : background_) {
+      dropped.push_back(std::move(task));
+    }
+    background_.clear();
+  }
+  for (auto& worker : workers_) {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    for (auto& task : worker->tasks) {
+      dropped.push_back(std::move(task));
+    }
+    worker->tasks.clear();
+  }
+  for (auto& queued : queued_) {
+    queued = 0;
+  }
+}
+
+void TaskExecutor::Post(Task task, Lane lane) {
+  if (stopping_) {
+    return;
+  }
+  if (lane == Lane::kNormal) {
+    const size_t index = current_executor == this
+                             ? current_worker
+                             : next_worker_++ % workers_.size();
+    Worker& worker = *workers_[index];
+    {
+      // Counted first so the count never drops below the tasks queued.
+      std::lock_guard<std::mutex> lock(worker.mutex);
+      queued_[LaneIndex(lane)]++;
+      worker.tasks.push_back(std::move(task));
+    }
+    WakeOne();
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (lane == Lane::kInteractive) {
+      interactive_.push_back(std::move(task));
+    } else {
+      background_.push_back(std::move(task));
+    }
+    queued_[LaneIndex(lane)]++;
+  }
+  wake_.notify_one();
+}
+
+void TaskExecutor::SetForeground(bool foreground) {
+  foreground_ = foreground;
+  if (!foreground) {
+    // Every idle worker may take background work now.
+    { std::lock_guard<std::mutex> lock(mutex_); }
+    wake_.notify_all();
+  }
+}
+
+bool TaskExecutor::ShouldYield() const {
+  return foreground_ || queued_[LaneIndex(Lane::kInteractive)] > 0 ||
+         queued_[LaneIndex(Lane::kNormal)] > 0;
+}
+
+TaskExecutor::Stats TaskExecutor::stats() const {
+  Stats stats;
+  for (size_t i = 0; i < kLaneCount; i++) {
+    stats.executed[i] = executed_[i];
+  }
+  stats.stolen = stolen_;
+  stats.background_yields = background_yields_;
+  return stats;
+}
+
+void TaskExecutor::Run(size_t index) {
+  current_executor = this;
+  current_worker = index;
+
+  Task task;
+  Lane lane = Lane::kNormal;
+  while (!stopping_) {
+    if (!Take(index, &task, &lane)) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      // Counted before the queues are checked, and posts count before they
+      // check this, so a post either sees a sleeper or is seen here.
+      sleeping_++;
+      wake_.wait(lock, [this]() { return stopping_ || HasWork(); });
+      sleeping_--;
+      continue;
+    }
+
+    task();
+    task = nullptr;
+    executed_[LaneIndex(lane)]++;
+    if (lane != Lane::kBackground) {
+      continue;
+    }
+    if (foreground_) {
+      // Still counted as running, so no other worker starts background work
+      // during the rest. Cut short by anything more urgent.
+      background_yields_++;
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait_for(lock, options_.foreground_yield, [this]() {
+        return stopping_ || !foreground_ ||
+               queued_[LaneIndex(Lane::kInteractive)] > 0 ||
+               queued_[LaneIndex(Lane::kNormal)] > 0;
+      });
+    }
+    background_running_--;
+  }
+}
+
+bool TaskExecutor::Take(size_t index, Task* task, Lane* lane) {
+  if (queued_[LaneIndex(Lane::kInteractive)] > 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!interactive_.empty()) {
+      *task = std::move(interactive_.front());
+      interactive_.pop_front();
+      queued_[LaneIndex(Lane::kInteractive)]--;
+      *lane = Lane::kInteractive;
+      return true;
+    }
+  }
+
+  if (queued_[LaneIndex(Lane::kNormal)] > 0) {
+    // Own deque newest first, then the others' oldest first.
+    for (size_t i = 0; i < workers_.size(); i++) {
+      Worker& worker = *workers_[(index + i) % workers_.size()];
+      std::lock_guard<std::mutex> lock(worker.mutex);
+      if (worker.tasks.empty()) {
+        continue;
+      }
+      if (i == 0) {
+        *task = std::move(worker.tasks.back());
+        worker.tasks.pop_back();
+      } else {
+        *task = std::move(worker.tasks.front());
+        worker.tasks.pop_front();
+        stolen_++;
+      }
+      queued_[LaneIndex(Lane::kNormal)]--;
+      *lane = Lane::kNormal;
+      return true;
+    }
+  }
+
+  if (queued_[LaneIndex(Lane::kBackground)] > 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!background_.empty() && BackgroundAllowed()) {
+      *task = std::move(background_.front());
+      background_.pop_front();
+      queued_[LaneIndex(Lane::kBackground)]--;
+      background_running_++;
+      *lane = Lane::kBackground;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TaskExecutor::HasWork() const {
+  return queued_[LaneIndex(Lane::kInteractive)] > 0 ||
+         queued_[LaneIndex(Lane::kNormal)] > 0 ||
+         (queued_[LaneIndex(Lane::kBackground)] > 0 && BackgroundAllowed());
+}
+
+bool TaskExecutor::BackgroundAllowed() const {
+  return !foreground_ || background_running_ == 0;
+}
+
+void TaskExecutor::WakeOne() {
+  if (sleeping_ > 0) {
+    { std::lock_guard<std::mutex> lock(mutex_); }
+    wake_.notify_one();
+  }
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,143 @@
+#ifndef NATIVE_TASK_EXECUTOR_H_
+#define NATIVE_TASK_EXECUTOR_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cloudtolocalllm {
+
+// One pool of worker threads, one per core, for the CPU work of the native
+// subsystems, so each does not start threads of its own. Created and
+// stopped by the runner; plugins are handed a pointer to it.
+//
+// Every worker has its own deque. A task posted from a worker goes on that
+// worker's deque, which it pops newest first while the data is still in
+// cache; a task posted from any other thread is dealt round-robin. An idle
+// worker steals the oldest task from the others' deques, so a burst posted
+// by one worker spreads over the pool.
+//
+// Two lanes sit beside the deques. Interactive tasks, the ones a user in
+// the chat is waiting on, go on a shared queue every worker drains before
+// its own deque. Background tasks run only when nothing else is queued, and
+// while the window is in the foreground by at most one worker at a time,
+// with a pause of Options::foreground_yield after each, so indexing and
+// batching never compete with the UI for more than a share of one core.
+// Long background tasks should poll ShouldYield() and post the rest of
+// their work again.
+//
+// Thread-safe. Tasks must not block on each other.
+class TaskExecutor {
+ public:
+  enum class Lane : uint8_t {
+    kInteractive = 0,
+    kNormal = 1,
+    kBackground = 2,
+  };
+  static constexpr size_t kLaneCount = 3;
+
+  using Task = std::function<void()>;
+
+  struct Options {
+    // Zero means one per core.
+    size_t threads = 0;
+    // How long the background worker rests after each background task while
+    // the window is in the foreground.
+    std::chrono::milliseconds foreground_yield{20};
+  };
+
+  struct Stats {
+    uint64_t executed[kLaneCount] = {};
+    // Normal tasks run by a worker other than the one they were queued on.
+    uint64_t stolen = 0;
+    // Rests taken by the background worker while in the foreground.
+    uint64_t background_yields = 0;
+  };
+
+  TaskExecutor();
+  explicit TaskExecutor(const Options& options);
+  // Stops the executor if it is still running.
+  ~TaskExecutor();
+
+  // Prevent copying.
+  TaskExecutor(TaskExecutor const&) = delete;
+  TaskExecutor& operator=(TaskExecutor const&) = delete;
+
+  // Starts the workers. Tasks posted before this are queued for them.
+  void Start();
+
+  // Lets running tasks finish, drops the queued ones and joins the workers.
+  // Later posts are dropped. Call it before destroying anything the tasks
+  // use.
+  void Stop();
+
+  void Post(Task task, Lane lane = Lane::kNormal);
+
+  // Whether the application's window is in the foreground; background work
+  // is throttled while it is. Starts out true.
+  void SetForeground(bool foreground);
+  bool foreground() const { return foreground_.load(); }
+
+  // For background tasks to poll: true while the window is in the
+  // foreground or other work is waiting.
+  bool ShouldYield() const;
+
+  size_t thread_count() const { return workers_.size(); }
+  Stats stats() const;
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+    std::thread thread;
+  };
+
+  void Run(size_t index);
+  // Takes the next task for worker |index|, if any, and says which lane it
+  // came from.
+  bool Take(size_t index, Task* task, Lane* lane);
+  // Whether an idle worker has anything it may take. Caller holds mutex_.
+  bool HasWork() const;
+  // Whether another worker may start a background task. Caller holds
+  // mutex_.
+  bool BackgroundAllowed() const;
+  // Wakes an idle worker, if there is one, after a task is queued.
+  void WakeOne();
+
+  const Options options_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  // Guards the shared lanes and the sleep of idle workers.
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<Task> interactive_;
+  std::deque<Task> background_;
+  bool started_ = false;
+  // Workers waiting on wake_. Posts to a worker deque only take mutex_ to
+  // notify when this is non-zero.
+  std::atomic<size_t> sleeping_{0};
+
+  std::atomic<bool> stopping_{false};
+  // Queued tasks by lane, readable without a lock.
+  std::atomic<size_t> queued_[kLaneCount] = {};
+  std::atomic<size_t> next_worker_{0};
+  std::atomic<bool> foreground_{true};
+  // Workers running a background task or resting after one.
+  std::atomic<int> background_running_{0};
+
+  std::atomic<uint64_t> executed_[kLaneCount] = {};
+  std::atomic<uint64_t> stolen_{0};
+  std::atomic<uint64_t> background_yields_{0};
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_TASK_EXECUTOR_H_
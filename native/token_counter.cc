@@ -0,0 +1,627 @@
+#include "native/token_counter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "native/mapped_file.h"
+#include "native/wire_format.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+constexpr uint32_t kGgufMagic = 0x46554747;  // "GGUF"
+constexpr uint32_t kUnknownToken = std::numeric_limits<uint32_t>::max();
+constexpr float kNoMerge = std::numeric_limits<float>::infinity();
+
+// GGUF metadata value types.
+enum GgufType : uint32_t {
+  kGgufU8 = 0,
+  kGgufI8 = 1,
+  kGgufU16 = 2,
+  kGgufI16 = 3,
+  kGgufU32 = 4,
+  kGgufI32 = 5,
+  kGgufF32 = 6,
+  kGgufBool = 7,
+  kGgufString = 8,
+  kGgufArray = 9,
+  kGgufU64 = 10,
+  kGgufI64 = 11,
+  kGgufF64 = 12,
+};
+
+// tokenizer.ggml.token_type value for ordinary vocabulary entries.
+constexpr int32_t kNormalToken = 1;
+
+// SentencePiece's stand-in for a space, U+2581.
+constexpr char kSentencePieceSpace[] = "\xE2\x96\x81";
+
+size_t GgufScalarSize(uint32_t type) {
+  switch (type) {
+    case kGgufU8:
+    case kGgufI8:
+    case kGgufBool:
+      return 1;
+    case kGgufU16:
+    case kGgufI16:
+      return 2;
+    case kGgufU32:
+    case kGgufI32:
+    case kGgufF32:
+      return 4;
+    case kGgufU64:
+    case kGgufI64:
+    case kGgufF64:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+bool ReadGgufString(WireReader* reader, std::string_view* value) {
+  uint64_t size;
+  const uint8_t* span;
+  if (!reader->ReadU64(&size) || size > reader->remaining() ||
+      !reader->ReadSpan(static_cast<size_t>(size), &span)) {
+    return false;
+  }
+  *value = std::string_view(reinterpret_cast<const char*>(span),
+                            static_cast<size_t>(size));
+  return true;
+}
+
+bool SkipGgufValue(WireReader* reader, uint32_t type) {
+  const uint8_t* span;
+  if (type == kGgufString) {
+    std::string_view value;
+    return ReadGgufString(reader, &value);
+  }
+  if (type == kGgufArray) {
+    uint32_t element_type;
+    uint64_t count;
+    if (!reader->ReadU32(&element_type) || !reader->ReadU64(&count)) {
+      return false;
+    }
+    const size_t element_size = GgufScalarSize(element_type);
+    if (element_size != 0) {
+      return count <= reader->remaining() / element_size &&
+             reader->ReadSpan(static_cast<size_t>(count) * element_size,
+                              &span);
+    }
+    for (uint64_t i = 0; i < count; i++) {
+      if (!SkipGgufValue(reader, element_type)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  const size_t size = GgufScalarSize(type);
+  return size != 0 && reader->ReadSpan(size, &span);
+}
+
+// Reads an integer of any width; false for other types.
+bool ReadGgufUnsigned(WireReader* reader, uint32_t type, uint64_t* value) {
+  uint8_t u8;
+  uint16_t u16;
+  uint32_t u32;
+  switch (type) {
+    case kGgufU8:
+    case kGgufI8:
+      *value = reader->ReadU8(&u8) ? u8 : 0;
+      return reader->ok();
+    case kGgufU16:
+    case kGgufI16:
+      *value = reader->ReadU16(&u16) ? u16 : 0;
+      return reader->ok();
+    case kGgufU32:
+    case kGgufI32:
+      *value = reader->ReadU32(&u32) ? u32 : 0;
+      return reader->ok();
+    case kGgufU64:
+    case kGgufI64:
+      return reader->ReadU64(value);
+    default:
+      return false;
+  }
+}
+
+// Starts an array of |expected| elements. Each takes at least
+// |element_size| bytes, which bounds |count| by what is left of the input so
+// a corrupt count cannot drive a huge reservation.
+bool ReadGgufArrayHeader(WireReader* reader, uint32_t type, uint32_t expected,
+                         size_t element_size, size_t* count) {
+  uint32_t element_type;
+  uint64_t value;
+  if (type != kGgufArray || !reader->ReadU32(&element_type) ||
+      element_type != expected || !reader->ReadU64(&value) ||
+      value > reader->remaining() / element_size) {
+    return false;
+  }
+  *count = static_cast<size_t>(value);
+  return true;
+}
+
+bool EndsWith(std::string_view value, std::string_view suffix) {
+  return value.size() >= suffix.size() &&
+         value.compare(value.size() - suffix.size(), suffix.size(), suffix) ==
+             0;
+}
+
+// Byte-level BPE spells each byte as a printable character: the printable
+// Latin-1 bytes as themselves and the rest as U+0100 on, in byte order.
+uint32_t ByteLevelCodepoint(uint8_t byte) {
+  const auto printable = [](unsigned value) {
+    return (value >= 33 && value <= 126) || (value >= 161 && value <= 172) ||
+           value >= 174;
+  };
+  if (printable(byte)) {
+    return byte;
+  }
+  uint32_t index = 0;
+  for (unsigned value = 0; value < byte; value++) {
+    if (!printable(value)) {
+      index++;
+    }
+  }
+  return 256 + index;
+}
+
+enum CharClass : uint8_t { kOther, kLetter, kDigit, kSpace, kNewline };
+
+CharClass Classify(uint8_t byte) {
+  if (byte >= 0x80 || (byte >= 'a' && byte <= 'z') ||
+      (byte >= 'A' && byte <= 'Z')) {
+    return kLetter;
+  }
+  if (byte >= '0' && byte <= '9') {
+    return kDigit;
+  }
+  if (byte == '\n' || byte == '\r') {
+    return kNewline;
+  }
+  if (byte == ' ' || byte == '\t' || byte == '\v' || byte == '\f') {
+    return kSpace;
+  }
+  return kOther;
+}
+
+struct CharClassTable {
+  CharClassTable() {
+    for (int i = 0; i < 256; i++) {
+      classes[i] = Classify(static_cast<uint8_t>(i));
+    }
+  }
+  CharClass classes[256];
+};
+
+const CharClassTable& Classes() {
+  static const CharClassTable table;
+  return table;
+}
+
+// Length of the piece at the start of |text|, following the Llama 3 /
+// GPT-4 pre-tokenizer:
+//
+//   '(s|t|re|ve|m|ll|d) | [^\r\n\p{L}\p{N}]?\p{L}+ | \p{N}{1,3}
+//   | ' '?[^\s\p{L}\p{N}]+[\r\n]* | \s*[\r\n]+ | \s+(?!\S) | \s+
+size_t NextByteLevelPiece(const uint8_t* text, size_t size) {
+  const CharClass* classes = Classes().classes;
+  const auto at = [&](size_t i) { return classes[text[i]]; };
+
+  if (text[0] == '\'' && size >= 2) {
+    const uint8_t first = text[1] | 0x20;
+    if (first == 's' || first == 't' || first == 'm' || first == 'd') {
+      return 2;
+    }
+    if (size >= 3) {
+      const uint8_t second = text[2] | 0x20;
+      if ((first == 'r' && second == 'e') || (first == 'v' && second == 'e') ||
+          (first == 'l' && second == 'l')) {
+        return 3;
+      }
+    }
+  }
+
+  size_t i = 0;
+  if (at(0) != kLetter && at(0) != kDigit && at(0) != kNewline && size > 1 &&
+      at(1) == kLetter) {
+    i = 1;
+  }
+  if (at(i) == kLetter) {
+    while (i < size && at(i) == kLetter) {
+      i++;
+    }
+    return i;
+  }
+
+  if (at(0) == kDigit) {
+    while (i < size && i < 3 && at(i) == kDigit) {
+      i++;
+    }
+    return i;
+  }
+
+  i = text[0] == ' ' && size > 1 && at(1) == kOther ? 1 : 0;
+  if (at(i) == kOther) {
+    while (i < size && at(i) == kOther) {
+      i++;
+    }
+    while (i < size && at(i) == kNewline) {
+      i++;
+    }
+    return i;
+  }
+
+  size_t end = 0;
+  size_t after_newline = 0;
+  while (end < size && (at(end) == kSpace || at(end) == kNewline)) {
+    end++;
+    if (at(end - 1) == kNewline) {
+      after_newline = end;
+    }
+  }
+  if (after_newline != 0) {
+    return after_newline;
+  }
+  // Leave the last space for the word after it.
+  return end < size && end > 1 ? end - 1 : end;
+}
+
+uint64_t HashPiece(const uint8_t* piece, size_t size, uint64_t seed) {
+  uint64_t hash = 0xcbf29ce484222325ull ^ seed;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ piece[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+size_t Utf8SequenceSize(uint8_t lead) {
+  if (lead < 0xC0) {
+    return 1;
+  }
+  if (lead < 0xE0) {
+    return 2;
+  }
+  return lead < 0xF0 ? 3 : 4;
+}
+
+}  // namespace
+
+TokenCounter::TokenCounter()
+    : kind_(Kind::kByteLevel),
+      context_length_(0),
+      byte_tokens_(),
+      space_token_(0) {}
+
+TokenCounter::~TokenCounter() = default;
+
+bool TokenCounter::Load(const std::filesystem::path& path) {
+  file_.reset();
+  tokens_.clear();
+  token_ids_.clear();
+  merges_.clear();
+  cache_.clear();
+  context_length_ = 0;
+
+  auto file = std::make_unique<MappedFile>();
+  if (!file->Open(path)) {
+    return false;
+  }
+  WireReader reader(file->data(), file->size());
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint64_t tensor_count = 0;
+  uint64_t kv_count = 0;
+  reader.ReadU32(&magic);
+  reader.ReadU32(&version);
+  reader.ReadU64(&tensor_count);
+  reader.ReadU64(&kv_count);
+  if (!reader.ok() || magic != kGgufMagic || version < 2 || version > 3) {
+    return false;
+  }
+
+  std::string_view model;
+  std::string_view architecture;
+  std::vector<std::string_view> tokens;
+  std::vector<std::string_view> merges;
+  std::vector<float> scores;
+  std::vector<int32_t> token_types;
+  std::vector<std::pair<std::string_view, uint64_t>> context_lengths;
+  for (uint64_t i = 0; i < kv_count; i++) {
+    std::string_view key;
+    uint32_t type;
+    if (!ReadGgufString(&reader, &key) || !reader.ReadU32(&type)) {
+      return false;
+    }
+    size_t count = 0;
+    bool read = true;
+    if (key == "tokenizer.ggml.model" && type == kGgufString) {
+      read = ReadGgufString(&reader, &model);
+    } else if (key == "general.architecture" && type == kGgufString) {
+      read = ReadGgufString(&reader, &architecture);
+    } else if (key == "tokenizer.ggml.tokens" ||
+               key == "tokenizer.ggml.merges") {
+      std::vector<std::string_view>* strings =
+          key == "tokenizer.ggml.tokens" ? &tokens : &merges;
+      read = ReadGgufArrayHeader(&reader, type, kGgufString, 8, &count);
+      strings->resize(count);
+      for (size_t j = 0; read && j < count; j++) {
+        read = ReadGgufString(&reader, &(*strings)[j]);
+      }
+    } else if (key == "tokenizer.ggml.scores") {
+      read = ReadGgufArrayHeader(&reader, type, kGgufF32, 4, &count);
+      scores.resize(count);
+      for (size_t j = 0; read && j < count; j++) {
+        uint32_t bits = 0;
+        read = reader.ReadU32(&bits);
+        std::memcpy(&scores[j], &bits, sizeof(bits));
+      }
+    } else if (key == "tokenizer.ggml.token_type") {
+      read = ReadGgufArrayHeader(&reader, type, kGgufI32, 4, &count);
+      token_types.resize(count);
+      for (size_t j = 0; read && j < count; j++) {
+        uint32_t bits = 0;
+        read = reader.ReadU32(&bits);
+        token_types[j] = static_cast<int32_t>(bits);
+      }
+    } else if (EndsWith(key, ".context_length") &&
+               GgufScalarSize(type) != 0 && type != kGgufF32 &&
+               type != kGgufF64 && type != kGgufBool) {
+      context_lengths.emplace_back(key, 0);
+      read = ReadGgufUnsigned(&reader, type, &context_lengths.back().second);
+    } else {
+      read = SkipGgufValue(&reader, type);
+    }
+    if (!read) {
+      return false;
+    }
+  }
+
+  if (tokens.empty()) {
+    return false;
+  }
+  tokens_ = std::move(tokens);
+  token_ids_.reserve(tokens_.size());
+  for (size_t i = 0; i < tokens_.size(); i++) {
+    token_ids_.emplace(tokens_[i], static_cast<uint32_t>(i));
+  }
+
+  bool built = false;
+  if (model == "gpt2") {
+    kind_ = Kind::kByteLevel;
+    built = BuildByteLevel(merges);
+  } else if (model == "llama" && scores.size() == tokens_.size()) {
+    kind_ = Kind::kSentencePiece;
+    if (token_types.size() != tokens_.size()) {
+      token_types.assign(tokens_.size(), kNormalToken);
+    }
+    // Only ordinary tokens can be reached by merging; BuildSentencePiece()
+    // skips the others.
+    for (size_t i = 0; i < tokens_.size(); i++) {
+      if (token_types[i] != kNormalToken) {
+        scores[i] = kNoMerge;
+      }
+    }
+    built = BuildSentencePiece(scores);
+  }
+  if (!built) {
+    tokens_.clear();
+    token_ids_.clear();
+    merges_.clear();
+    return false;
+  }
+
+  for (const auto& [key, value] : context_lengths) {
+    if (key.size() == architecture.size() + sizeof(".context_length") - 1 &&
+        key.compare(0, architecture.size(), architecture) == 0) {
+      context_length_ = value;
+    }
+  }
+  file_ = std::move(file);
+  return true;
+}
+
+bool TokenCounter::BuildByteLevel(const std::vector<std::string_view>& merges) {
+  for (int byte = 0; byte < 256; byte++) {
+    const uint32_t codepoint = ByteLevelCodepoint(static_cast<uint8_t>(byte));
+    char spelled[2];
+    size_t size = 1;
+    if (codepoint < 0x80) {
+      spelled[0] = static_cast<char>(codepoint);
+    } else {
+      spelled[0] = static_cast<char>(0xC0 | (codepoint >> 6));
+      spelled[1] = static_cast<char>(0x80 | (codepoint & 0x3F));
+      size = 2;
+    }
+    byte_tokens_[byte] = Lookup(std::string_view(spelled, size));
+  }
+
+  merges_.reserve(merges.size());
+  std::string joined;
+  for (size_t rank = 0; rank < merges.size(); rank++) {
+    const std::string_view merge = merges[rank];
+    const size_t space = merge.find(' ');
+    if (space == std::string_view::npos) {
+      continue;
+    }
+    const uint32_t left = Lookup(merge.substr(0, space));
+    const uint32_t right = Lookup(merge.substr(space + 1));
+    joined.assign(merge.substr(0, space));
+    joined.append(merge.substr(space + 1));
+    const uint32_t token = Lookup(joined);
+    if (left != kUnknownToken && right != kUnknownToken &&
+        token != kUnknownToken) {
+      merges_.emplace(PairKey(left, right),
+                      Merge{static_cast<float>(rank), token});
+    }
+  }
+  return !merges_.empty();
+}
+
+bool TokenCounter::BuildSentencePiece(const std::vector<float>& scores) {
+  static const char kHex[] = "0123456789ABCDEF";
+  space_token_ = Lookup(kSentencePieceSpace);
+  for (int byte = 0; byte < 256; byte++) {
+    const char spelled[] = {'<', '0', 'x', kHex[byte >> 4], kHex[byte & 0xF],
+                            '>'};
+    byte_tokens_[byte] = Lookup(std::string_view(spelled, sizeof(spelled)));
+  }
+
+  // SentencePiece has no merge list: the merge of two adjacent pieces is
+  // the token spelled by both, if there is one, and the highest-scoring
+  // such token merges first.
+  for (size_t token = 0; token < tokens_.size(); token++) {
+    const std::string_view spelled = tokens_[token];
+    if (scores[token] == kNoMerge || spelled.size() < 2) {
+      continue;
+    }
+    for (size_t split = 1; split < spelled.size(); split++) {
+      if ((static_cast<uint8_t>(spelled[split]) & 0xC0) == 0x80) {
+        continue;
+      }
+      const uint32_t left = Lookup(spelled.substr(0, split));
+      const uint32_t right = Lookup(spelled.substr(split));
+      if (left != kUnknownToken && right != kUnknownToken) {
+        merges_.emplace(PairKey(left, right),
+                        Merge{-scores[token], static_cast<uint32_t>(token)});
+      }
+    }
+  }
+  return !merges_.empty();
+}
+
+uint32_t TokenCounter::Lookup(std::string_view piece) const {
+  auto it = token_ids_.find(piece);
+  return it != token_ids_.end() ? it->second : kUnknownToken;
+}
+
+uint64_t TokenCounter::Count(const char* text, size_t size) {
+  if (tokens_.empty() || size == 0) {
+    return 0;
+  }
+  if (cache_.size() > kMaxCachedWords) {
+    cache_.clear();
+  }
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(text);
+  return kind_ == Kind::kByteLevel ? CountByteLevel(bytes, size)
+                                   : CountSentencePiece(bytes, size);
+}
+
+uint64_t TokenCounter::CountByteLevel(const uint8_t* text, size_t size) {
+  uint64_t count = 0;
+  size_t offset = 0;
+  while (offset < size) {
+    const size_t piece = NextByteLevelPiece(text + offset, size - offset);
+    count += CountPiece(text + offset, piece, false);
+    offset += piece;
+  }
+  return count;
+}
+
+uint64_t TokenCounter::CountSentencePiece(const uint8_t* text, size_t size) {
+  // SentencePiece prefixes the text with a space, so every word, the first
+  // included, starts with one.
+  uint64_t count = 0;
+  size_t offset = 0;
+  while (offset < size) {
+    size_t end = offset;
+    while (end < size && text[end] == ' ') {
+      end++;
+    }
+    while (end < size && text[end] != ' ') {
+      end++;
+    }
+    count += CountPiece(text + offset, end - offset,
+                        offset == 0 && text[0] != ' ');
+    offset = end;
+  }
+  return count;
+}
+
+uint32_t TokenCounter::CountPiece(const uint8_t* piece, size_t size,
+                                  bool space_prefix) {
+  if (size > kMaxPieceSize) {
+    size_t cut = kMaxPieceSize;
+    while (cut > 1 && (piece[cut] & 0xC0) == 0x80) {
+      cut--;
+    }
+    return CountPiece(piece, cut, space_prefix) +
+           CountPiece(piece + cut, size - cut, false);
+  }
+
+  const uint64_t hash = HashPiece(piece, size, space_prefix ? 1 : 0);
+  auto cached = cache_.find(hash);
+  if (cached != cache_.end()) {
+    return cached->second;
+  }
+
+  symbols_.clear();
+  if (kind_ == Kind::kByteLevel) {
+    for (size_t i = 0; i < size; i++) {
+      symbols_.push_back(byte_tokens_[piece[i]]);
+    }
+  } else {
+    if (space_prefix) {
+      symbols_.push_back(space_token_);
+    }
+    for (size_t i = 0; i < size;) {
+      const size_t length =
+          std::min(Utf8SequenceSize(piece[i]), size - i);
+      const uint32_t token =
+          piece[i] == ' '
+              ? space_token_
+              : Lookup(std::string_view(
+                    reinterpret_cast<const char*>(piece + i), length));
+      if (token != kUnknownToken) {
+        symbols_.push_back(token);
+      } else {
+        for (size_t j = 0; j < length; j++) {
+          symbols_.push_back(byte_tokens_[piece[i + j]]);
+        }
+      }
+      i += length;
+    }
+  }
+
+  const uint32_t count = MergeSymbols();
+  cache_.emplace(hash, count);
+  return count;
+}
+
+uint32_t TokenCounter::MergeSymbols() {
+  const auto priority = [this](size_t i) {
+    auto it = merges_.find(PairKey(symbols_[i], symbols_[i + 1]));
+    return it != merges_.end() ? it->second.priority : kNoMerge;
+  };
+  if (symbols_.size() < 2) {
+    return static_cast<uint32_t>(symbols_.size());
+  }
+  priorities_.resize(symbols_.size() - 1);
+  for (size_t i = 0; i + 1 < symbols_.size(); i++) {
+    priorities_[i] = priority(i);
+  }
+  while (!priorities_.empty()) {
+    const size_t best = static_cast<size_t>(
+        std::min_element(priorities_.begin(), priorities_.end()) -
+        priorities_.begin());
+    if (priorities_[best] == kNoMerge) {
+      break;
+    }
+    symbols_[best] =
+        merges_.find(PairKey(symbols_[best], symbols_[best + 1]))
+            ->second.token;
+    symbols_.erase(symbols_.begin() + static_cast<ptrdiff_t>(best) + 1);
+    priorities_.erase(priorities_.begin() + static_cast<ptrdiff_t>(best));
+    if (best > 0) {
+      priorities_[best - 1] = priority(best - 1);
+    }
+    if (best < priorities_.size()) {
+      priorities_[best] = priority(best);
+    }
+  }
+  return static_cast<uint32_t>(symbols_.size());
+}
+
+}  // namespace cloudtolocalllm
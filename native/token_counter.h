@@ -0,0 +1,108 @@
+#ifndef NATIVE_TOKEN_COUNTER_H_
+#define NATIVE_TOKEN_COUNTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace cloudtolocalllm {
+
+class MappedFile;
+
+// Counts the tokens a model's tokenizer would split text into, using the
+// vocabulary embedded in the model's GGUF file.
+//
+// The file is memory-mapped and only its metadata is read: the token
+// strings stay in the mapping and are indexed in place, so loading a
+// multi-gigabyte model touches a few megabytes. Two tokenizer families are
+// supported, which between them cover the models Ollama serves:
+//
+//   "gpt2"   byte-level BPE ranked by tokenizer.ggml.merges (Llama 3, Qwen,
+//            Phi-3.5, ...). Text is pre-split the way their regex does,
+//            approximated with ASCII character classes; every byte of a
+//            multi-byte UTF-8 sequence counts as a letter.
+//   "llama"  SentencePiece BPE ranked by tokenizer.ggml.scores (Llama 2,
+//            Mistral, Gemma, ...), split into words at spaces, with byte
+//            fallback for characters outside the vocabulary.
+//
+// Chat templates and special tokens are not counted. Words are counted once
+// and cached by hash, so text that repeats (as chat history does) costs a
+// scan and a table lookup per word.
+class TokenCounter {
+ public:
+  // Pieces longer than this are counted in chunks of this many bytes, which
+  // bounds the quadratic merge loop on runs without separators.
+  static constexpr size_t kMaxPieceSize = 128;
+  // The word cache is dropped when it grows past this many entries.
+  static constexpr size_t kMaxCachedWords = 1 << 18;
+
+  TokenCounter();
+  ~TokenCounter();
+
+  // Prevent copying.
+  TokenCounter(TokenCounter const&) = delete;
+  TokenCounter& operator=(TokenCounter const&) = delete;
+
+  // Maps the GGUF file at |path| and builds the merge table; false if it is
+  // not GGUF (version 2 or 3) or has neither supported tokenizer.
+  bool Load(const std::filesystem::path& path);
+
+  uint64_t Count(const char* text, size_t size);
+
+  // <architecture>.context_length from the metadata, or 0 if absent.
+  uint64_t context_length() const { return context_length_; }
+  size_t vocab_size() const { return tokens_.size(); }
+
+ private:
+  enum class Kind { kByteLevel, kSentencePiece };
+
+  struct Merge {
+    // Lower merges first: the merge's rank, or minus the merged token's
+    // score.
+    float priority;
+    uint32_t token;
+  };
+
+  static uint64_t PairKey(uint32_t left, uint32_t right) {
+    return (static_cast<uint64_t>(left) << 32) | right;
+  }
+
+  bool BuildByteLevel(const std::vector<std::string_view>& merges);
+  bool BuildSentencePiece(const std::vector<float>& scores);
+  uint32_t Lookup(std::string_view piece) const;
+
+  uint64_t CountByteLevel(const uint8_t* text, size_t size);
+  uint64_t CountSentencePiece(const uint8_t* text, size_t size);
+  // Tokens in one pre-split piece, through the cache. |space_prefix| counts
+  // it as if it started with a space (SentencePiece's leading one).
+  uint32_t CountPiece(const uint8_t* piece, size_t size, bool space_prefix);
+  // Runs the merges over |symbols_| and returns how many are left.
+  uint32_t MergeSymbols();
+
+  std::unique_ptr<MappedFile> file_;
+  Kind kind_;
+  uint64_t context_length_;
+  // Token strings, pointing into the mapping.
+  std::vector<std::string_view> tokens_;
+  std::unordered_map<std::string_view, uint32_t> token_ids_;
+  std::unordered_map<uint64_t, Merge> merges_;
+  // Initial symbol for each byte: its byte-level character, or for
+  // SentencePiece its <0xXX> fallback token.
+  uint32_t byte_tokens_[256];
+  // SentencePiece's space piece.
+  uint32_t space_token_;
+  // Word hash to token count.
+  std::unordered_map<uint64_t, uint32_t> cache_;
+  // Scratch for MergeSymbols().
+  std::vector<uint32_t> symbols_;
+  std::vector<float> priorities_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_TOKEN_COUNTER_H_
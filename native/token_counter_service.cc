@@ -0,0 +1,113 @@
+#include "native/token_counter_service.h"
+
+#include <algorithm>
+#include <filesystem>
+
+namespace cloudtolocalllm {
+
+TokenCounterService::TokenCounterService() : clock_(0) {}
+
+TokenCounterService::~TokenCounterService() = default;
+
+void TokenCounterService::HandleMessage(const uint8_t* message, size_t size,
+                                        std::vector<uint8_t>* reply) {
+  reply->clear();
+
+  WireReader reader(message, size);
+  uint8_t op;
+  if (!reader.ReadU8(&op)) {
+    return;
+  }
+  if (!Handle(op, &reader, reply)) {
+    reply->clear();
+  } else if (reply->empty()) {
+    reply->push_back(1);
+  }
+}
+
+bool TokenCounterService::Handle(uint8_t op, WireReader* reader,
+                                 std::vector<uint8_t>* reply) {
+  WireWriter writer(reply);
+  std::string name;
+  if (!reader->ReadString(&name)) {
+    return false;
+  }
+  switch (op) {
+    case kLoad: {
+      std::string path;
+      if (!reader->ReadString(&path)) {
+        return false;
+      }
+      Model* model = Find(name);
+      if (model == nullptr || model->path != path) {
+        auto loaded = std::make_unique<Model>();
+        if (!loaded->counter.Load(std::filesystem::u8path(path))) {
+          return false;
+        }
+        loaded->name = name;
+        loaded->path = path;
+        models_.erase(std::remove_if(models_.begin(), models_.end(),
+                                     [&name](const std::unique_ptr<Model>& m) {
+                                       return m->name == name;
+                                     }),
+                      models_.end());
+        if (models_.size() >= kMaxModels) {
+          models_.erase(std::min_element(
+              models_.begin(), models_.end(),
+              [](const std::unique_ptr<Model>& a,
+                 const std::unique_ptr<Model>& b) {
+                return a->last_used < b->last_used;
+              }));
+        }
+        models_.push_back(std::move(loaded));
+        model = models_.back().get();
+      }
+      model->last_used = ++clock_;
+      writer.WriteU64(model->counter.context_length());
+      return true;
+    }
+    case kCount: {
+      Model* model = Find(name);
+      uint32_t count;
+      if (model == nullptr || !reader->ReadU32(&count) ||
+          count > reader->remaining() / 4) {
+        return false;
+      }
+      model->last_used = ++clock_;
+      writer.WriteU32(count);
+      for (uint32_t i = 0; i < count; i++) {
+        uint32_t size;
+        const uint8_t* text;
+        if (!reader->ReadU32(&size) || !reader->ReadSpan(size, &text)) {
+          return false;
+        }
+        const uint64_t tokens = model->counter.Count(
+            reinterpret_cast<const char*>(text), size);
+        writer.WriteU32(static_cast<uint32_t>(
+            std::min<uint64_t>(tokens, UINT32_MAX)));
+      }
+      return true;
+    }
+    case kUnload:
+      models_.erase(std::remove_if(models_.begin(), models_.end(),
+                                   [&name](const std::unique_ptr<Model>& m) {
+                                     return m->name == name;
+                                   }),
+                    models_.end());
+      return true;
+    default:
+      return false;
+  }
+}
+
+TokenCounterService::Model* TokenCounterService::Find(
+    const std::string& name) {
+  for (const std::unique_ptr<Model>& model : models_) {
+    if (model->name == name) {
+      return model.get();
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,63 @@
+#ifndef NATIVE_TOKEN_COUNTER_SERVICE_H_
+#define NATIVE_TOKEN_COUNTER_SERVICE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "native/token_counter.h"
+#include "native/wire_format.h"
+
+namespace cloudtolocalllm {
+
+// Platform-neutral handler behind the "cloudtolocalllm/token_counter" binary
+// channel, which counts tokens with the vocabulary of a model's GGUF file
+// (see TokenCounter). Loaded counters are cached by model name.
+//
+// Requests are `u8 op` followed by an op-specific payload:
+//
+//   kLoad   (1)  string model, string GGUF path; replies with u64 context
+//                length (0 if the file does not say). Loading a model
+//                already loaded from the same path reuses it.
+//   kCount  (2)  string model, u32 count, then that many strings; replies
+//                with u32 count and the token count of each
+//   kUnload (3)  string model
+//
+// kUnload replies with one byte. Malformed requests, files that are not a
+// supported GGUF tokenizer and kCount for a model that is not loaded get an
+// empty reply, which the Dart side treats as "estimate instead".
+class TokenCounterService {
+ public:
+  static constexpr uint8_t kLoad = 1;
+  static constexpr uint8_t kCount = 2;
+  static constexpr uint8_t kUnload = 3;
+
+  // Loading one more model than this drops the least recently used.
+  static constexpr size_t kMaxModels = 4;
+
+  TokenCounterService();
+  ~TokenCounterService();
+
+  void HandleMessage(const uint8_t* message, size_t size,
+                     std::vector<uint8_t>* reply);
+
+ private:
+  struct Model {
+    std::string name;
+    std::string path;
+    TokenCounter counter;
+    uint64_t last_used = 0;
+  };
+
+  bool Handle(uint8_t op, WireReader* reader, std::vector<uint8_t>* reply);
+  Model* Find(const std::string& name);
+
+  std::vector<std::unique_ptr<Model>> models_;
+  uint64_t clock_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_TOKEN_COUNTER_SERVICE_H_
@@ -0,0 +1,120 @@
+#include "native/tunnel_codec_service.h"
+
+#include "native/latency_metrics.h"
+#include "native/wire_format.h"
+
+namespace cloudtolocalllm {
+
+TunnelCodecService::TunnelCodecService() = default;
+
+TunnelCodecService::~TunnelCodecService() = default;
+
+void TunnelCodecService::HandleMessage(const uint8_t* message, size_t size,
+                                       std::vector<uint8_t>* reply) {
+  reply->clear();
+
+  WireReader reader(message, size);
+  uint8_t op;
+  uint32_t handle;
+  if (!reader.ReadU8(&op) || !reader.ReadU32(&handle)) {
+    return;
+  }
+
+  switch (op) {
+    case kOpenSession: {
+      const uint8_t* key = nullptr;
+      uint8_t direction = 0;
+      std::string session_id;
+      reader.ReadSpan(ChaCha20Poly1305::kKeySize, &key);
+      reader.ReadU8(&direction);
+      uint8_t flags = 0;
+      reader.ReadString(&session_id);
+      if (reader.remaining() > 0) {
+        reader.ReadU8(&flags);
+      }
+      if (!reader.ok() ||
+          direction >= kTunnelDirectionCount) {
+        return;
+      }
+      auto session = std::make_unique<TunnelSession>(
+          key, std::move(session_id), static_cast<TunnelDirection>(direction));
+      session->set_compression((flags & kSessionFlagCompress) != 0);
+      sessions_[handle] = std::move(session);
+      reply->push_back(1);
+      return;
+    }
+    case kCloseSession:
+      sessions_.erase(handle);
+      reply->push_back(1);
+      return;
+    case kSeal: {
+      auto it = sessions_.find(handle);
+      uint8_t type;
+      if (it == sessions_.end() || !reader.ReadU8(&type)) {
+        return;
+      }
+      if (type == kTypePing) {
+        // The payload starts with the message id.
+        WireReader payload(reader.current(), reader.remaining());
+        std::string id;
+        if (payload.ReadString(&id)) {
+          if (pending_pings_.size() >= kMaxPendingPings) {
+            pending_pings_.pop_front();
+          }
+          pending_pings_.emplace_back(std::move(id),
+                                      std::chrono::steady_clock::now());
+        }
+      }
+      it->second->Seal(type, reader.current(), reader.remaining(), reply);
+      return;
+    }
+    case kOpen: {
+      auto it = sessions_.find(handle);
+      if (it == sessions_.end()) {
+        return;
+      }
+      frame_buffer_.assign(reader.current(),
+                           reader.current() + reader.remaining());
+      TunnelFrame frame;
+      TunnelFrameStatus status = it->second->Open(
+          frame_buffer_.data(), frame_buffer_.size(), &frame);
+      WireWriter writer(reply);
+      writer.WriteU8(static_cast<uint8_t>(status));
+      if (status == TunnelFrameStatus::kOk) {
+        if (frame.type == kTypePong) {
+          RecordPong(frame);
+        }
+        writer.WriteU8(frame.type);
+        writer.WriteU64(frame.timestamp_us);
+        writer.WriteBytes(frame.payload, frame.payload_size);
+      }
+      return;
+    }
+    default:
+      return;
+  }
+}
+
+void TunnelCodecService::RecordPong(const TunnelFrame& frame) {
+  // Message id, then the id of the ping answered.
+  WireReader payload(frame.payload, frame.payload_size);
+  std::string id;
+  std::string ping_id;
+  if (!payload.ReadString(&id) || !payload.ReadString(&ping_id)) {
+    return;
+  }
+  for (auto it = pending_pings_.begin(); it != pending_pings_.end(); ++it) {
+    if (it->first == ping_id) {
+      const auto elapsed = std::chrono::steady_clock::now() - it->second;
+      LatencyMetrics::Get()->Record(
+          LatencyPath::kTunnel, LatencyKind::kRoundTrip,
+          static_cast<uint64_t>(
+              std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+                  .count()));
+      pending_pings_.erase(it);
+      return;
+    }
+  }
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,79 @@
+#ifndef NATIVE_TUNNEL_CODEC_SERVICE_H_
+#define NATIVE_TUNNEL_CODEC_SERVICE_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "native/tunnel_frame.h"
+
+namespace cloudtolocalllm {
+
+// Platform-neutral handler behind the "cloudtolocalllm/tunnel_codec" binary
+// channel, which seals and opens encrypted tunnel frames (see
+// native/tunnel_frame.h) so message bodies never pass through base64 or JSON.
+//
+// Requests are `u8 op, u32 session_handle` followed by an op-specific
+// payload:
+//
+//   kOpenSession  (1)  32-byte key, u8 outgoing TunnelDirection,
+//                      string session id, and optionally u8 flags
+//                      (kSessionFlagCompress); replies with one byte
+//   kSeal         (2)  u8 message type, then the plaintext payload; replies
+//                      with the frame
+//   kOpen         (3)  a frame; replies with u8 TunnelFrameStatus and, when
+//                      it is kOk, u8 message type, u64 timestamp_us and the
+//                      plaintext payload
+//   kCloseSession (4)  no payload; replies with one byte
+//
+// Malformed requests and unknown sessions get an empty reply, which the Dart
+// side treats as "native codec unavailable".
+//
+// The time each ping is sealed is kept by message id, and opening the pong
+// that names it records the round trip as LatencyPath::kTunnel's
+// LatencyKind::kRoundTrip in LatencyMetrics.
+class TunnelCodecService {
+ public:
+  static constexpr uint8_t kOpenSession = 1;
+  static constexpr uint8_t kSeal = 2;
+  static constexpr uint8_t kOpen = 3;
+  static constexpr uint8_t kCloseSession = 4;
+
+  // Seal compresses payloads (the peer advertised "lz4-dict-v1").
+  static constexpr uint8_t kSessionFlagCompress = 1 << 0;
+
+  // Tunnel message types (TunnelMessageType index + 1).
+  static constexpr uint8_t kTypePing = 6;
+  static constexpr uint8_t kTypePong = 7;
+
+  // Pings awaiting a pong; older ones are forgotten.
+  static constexpr size_t kMaxPendingPings = 8;
+
+  TunnelCodecService();
+  ~TunnelCodecService();
+
+  void HandleMessage(const uint8_t* message, size_t size,
+                     std::vector<uint8_t>* reply);
+
+ private:
+  // Records the round trip of the ping |frame| answers, if it was ours.
+  void RecordPong(const TunnelFrame& frame);
+
+  std::unordered_map<uint32_t, std::unique_ptr<TunnelSession>> sessions_;
+  // Scratch copy of incoming frames, which are decrypted in place.
+  std::vector<uint8_t> frame_buffer_;
+  // Message ids of unanswered pings with the time they were sealed, oldest
+  // first.
+  std::deque<std::pair<std::string, std::chrono::steady_clock::time_point>>
+      pending_pings_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_TUNNEL_CODEC_SERVICE_H_
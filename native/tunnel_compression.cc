@@ -0,0 +1,237 @@
+#include "native/tunnel_compression.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace cloudtolocalllm {
+
+// Fragments of Ollama's requests and responses, the most frequent last so
+// they sit at the shortest distances. Changing a byte of this changes the
+// wire format; it would need a new capability name.
+const char kTunnelDictionary[] =
+    "{\"status\":\"pulling manifest\"}{\"status\":\"verifying sha256 digest\""
+    "}{\"status\":\"writing manifest\"}{\"status\":\"success\"}{\"status\":\""
+    "downloading\",\"digest\":\"sha256:\",\"total\":,\"completed\":}{\"versio"
+    "n\":\"0.5.7\"}{\"models\":[{\"name\":\"\",\"model\":\"\",\"expires_at\":"
+    "\"\",\"size_vram\":{\"embeddings\":[[0.0,-0.0,{\"model\":\"\",\"messages"
+    "\":[{\"role\":\"system\",\"content\":\"\"},{\"role\":\"user\",\"content"
+    "\":\"\"}],\"stream\":true,\"options\":{\"temperature\":,\"num_ctx\":}}{"
+    "\"models\":[{\"name\":\"\",\"model\":\"\",\"modified_at\":\"\",\"size\":"
+    ",\"digest\":\"sha256:\",\"details\":{\"parent_model\":\"\",\"format\":\""
+    "gguf\",\"family\":\"llama\",\"families\":[\"llama\"],\"parameter_size\":"
+    "\"8.0B\",\"quantization_level\":\"Q4_K_M\"}}]}\"response\":\"\",\"contex"
+    "t\":[\"done\":true,\"done_reason\":\"stop\",\"total_duration\":,\"load_d"
+    "uration\":,\"prompt_eval_count\":,\"prompt_eval_duration\":,\"eval_count"
+    "\":,\"eval_duration\":}content-type: application/json; charset=utf-8 app"
+    "lication/x-ndjson content-length: {\"model\":\"llama3.2:latest\",\"creat"
+    "ed_at\":\"2025-01-01T00:00:00.000000000Z\",\"message\":{\"role\":\"assis"
+    "tant\",\"content\":\"\"},\"done\":false}";
+const size_t kTunnelDictionarySize = sizeof(kTunnelDictionary) - 1;
+
+namespace {
+
+constexpr int kHashBits = 12;
+constexpr uint32_t kNoPosition = 0xffffffff;
+constexpr size_t kMinMatch = 4;
+constexpr size_t kMaxOffset = 65535;
+// LZ4 block rules: the last five bytes are always literals, and the last
+// match starts at least twelve bytes before the end.
+constexpr size_t kLastLiterals = 5;
+constexpr size_t kMatchStartMargin = 12;
+
+uint32_t Load32(const uint8_t* p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint32_t Hash(uint32_t value) {
+  return (value * 2654435761u) >> (32 - kHashBits);
+}
+
+void PutLength(size_t length, std::vector<uint8_t>* out) {
+  for (; length >= 255; length -= 255) {
+    out->push_back(255);
+  }
+  out->push_back(static_cast<uint8_t>(length));
+}
+
+bool GetLength(const uint8_t** in, const uint8_t* end, size_t* length) {
+  uint8_t byte = 0;
+  do {
+    if (*in == end) {
+      return false;
+    }
+    byte = *(*in)++;
+    *length += byte;
+  } while (byte == 255 && *length <= kTunnelMaxDecompressedSize);
+  return *length <= kTunnelMaxDecompressedSize;
+}
+
+// Appends one sequence: literals, then a match |offset| back. A
+// |match_length| of 0 writes the final, literals-only sequence.
+void PutSequence(const uint8_t* literals, size_t literal_count, size_t offset,
+                 size_t match_length, std::vector<uint8_t>* out) {
+  const size_t match_code = match_length == 0 ? 0 : match_length - kMinMatch;
+  out->push_back(
+      static_cast<uint8_t>(std::min<size_t>(literal_count, 15) << 4 |
+                           std::min<size_t>(match_code, 15)));
+  if (literal_count >= 15) {
+    PutLength(literal_count - 15, out);
+  }
+  out->insert(out->end(), literals, literals + literal_count);
+  if (match_length == 0) {
+    return;
+  }
+  out->push_back(static_cast<uint8_t>(offset));
+  out->push_back(static_cast<uint8_t>(offset >> 8));
+  if (match_code >= 15) {
+    PutLength(match_code - 15, out);
+  }
+}
+
+}  // namespace
+
+TunnelCompressor::TunnelCompressor() = default;
+
+TunnelCompressor::~TunnelCompressor() = default;
+
+bool TunnelCompressor::Compress(const uint8_t* data, size_t size,
+                                std::vector<uint8_t>* out) {
+  if (size < kTunnelCompressionMinSize || size > kTunnelMaxDecompressedSize) {
+    return false;
+  }
+  const size_t start = kTunnelDictionarySize;
+  const size_t end = start + size;
+  window_.resize(end);
+  std::memcpy(window_.data(), kTunnelDictionary, start);
+  std::memcpy(window_.data() + start, data, size);
+  const uint8_t* window = window_.data();
+
+  table_.assign(size_t{1} << kHashBits, kNoPosition);
+  for (size_t i = 0; i + kMinMatch <= start; i++) {
+    table_[Hash(Load32(window + i))] = static_cast<uint32_t>(i);
+  }
+
+  const size_t limit = size - size / 8;
+  out->clear();
+  out->reserve(limit + 16);
+  for (int i = 0; i < 4; i++) {
+    out->push_back(static_cast<uint8_t>(size >> (8 * i)));
+  }
+
+  const size_t match_start_limit = end - kMatchStartMargin;
+  const size_t match_end_limit = end - kLastLiterals;
+  size_t anchor = start;
+  size_t position = start;
+  while (position < match_start_limit) {
+    const uint32_t sequence = Load32(window + position);
+    uint32_t& slot = table_[Hash(sequence)];
+    size_t reference = slot;
+    slot = static_cast<uint32_t>(position);
+    if (reference == kNoPosition || position - reference > kMaxOffset ||
+        Load32(window + reference) != sequence) {
+      // Step faster through runs that find nothing, so incompressible
+      // payloads are given up on cheaply.
+      position += 1 + ((position - anchor) >> 6);
+      continue;
+    }
+
+    size_t length = kMinMatch;
+    while (position + length < match_end_limit &&
+           window[reference + length] == window[position + length]) {
+      length++;
+    }
+    while (position > anchor && reference > 0 &&
+           window[position - 1] == window[reference - 1]) {
+      position--;
+      reference--;
+      length++;
+    }
+    PutSequence(window + anchor, position - anchor, position - reference,
+                length, out);
+    if (out->size() > limit) {
+      return false;
+    }
+    position += length;
+    anchor = position;
+  }
+  PutSequence(window + anchor, end - anchor, 0, 0, out);
+  return out->size() <= limit;
+}
+
+bool TunnelCompressor::Decompress(const uint8_t* data, size_t size,
+                                  const uint8_t** out, size_t* out_size) {
+  if (size < 4) {
+    return false;
+  }
+  const size_t raw_size = static_cast<size_t>(data[0]) |
+                          static_cast<size_t>(data[1]) << 8 |
+                          static_cast<size_t>(data[2]) << 16 |
+                          static_cast<size_t>(data[3]) << 24;
+  if (raw_size > kTunnelMaxDecompressedSize) {
+    return false;
+  }
+  const size_t start = kTunnelDictionarySize;
+  const size_t end = start + raw_size;
+  window_.resize(end);
+  std::memcpy(window_.data(), kTunnelDictionary, start);
+  uint8_t* window = window_.data();
+
+  const uint8_t* in = data + 4;
+  const uint8_t* const in_end = data + size;
+  size_t position = start;
+  while (true) {
+    if (in == in_end) {
+      return false;
+    }
+    const uint8_t token = *in++;
+    size_t literal_count = token >> 4;
+    if (literal_count == 15 && !GetLength(&in, in_end, &literal_count)) {
+      return false;
+    }
+    if (literal_count > static_cast<size_t>(in_end - in) ||
+        literal_count > end - position) {
+      return false;
+    }
+    std::memcpy(window + position, in, literal_count);
+    in += literal_count;
+    position += literal_count;
+    if (in == in_end) {
+      break;
+    }
+
+    if (in_end - in < 2) {
+      return false;
+    }
+    const size_t offset = static_cast<size_t>(in[0]) |
+                          static_cast<size_t>(in[1]) << 8;
+    in += 2;
+    size_t length = token & 15;
+    if (length == 15 && !GetLength(&in, in_end, &length)) {
+      return false;
+    }
+    length += kMinMatch;
+    if (offset == 0 || offset > position || length > end - position) {
+      return false;
+    }
+    const uint8_t* from = window + position - offset;
+    if (offset >= length) {
+      std::memcpy(window + position, from, length);
+    } else {
+      // Overlapping copy: the match repeats the bytes it is producing.
+      for (size_t i = 0; i < length; i++) {
+        window[position + i] = from[i];
+      }
+    }
+    position += length;
+  }
+  if (position != end) {
+    return false;
+  }
+  *out = window + start;
+  *out_size = raw_size;
+  return true;
+}
+
+}  // namespace cloudtolocalllm
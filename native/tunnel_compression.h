@@ -0,0 +1,64 @@
+#ifndef NATIVE_TUNNEL_COMPRESSION_H_
+#define NATIVE_TUNNEL_COMPRESSION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cloudtolocalllm {
+
+// Payload compression for tunnel frames, negotiated as the "lz4-dict-v1"
+// capability in the key exchange.
+//
+// A compressed payload is a u32 (little-endian) uncompressed size followed
+// by one LZ4 block whose matches may reach back into kTunnelDictionary, as
+// if the dictionary immediately preceded the data. Every frame is compressed
+// on its own: frames of different streams are interleaved and reordered by
+// priority, so there is no history to share between them beyond the
+// dictionary, which seeds even a single short NDJSON chunk with the keys
+// Ollama repeats in every line.
+//
+// The dictionary is part of the wire format and is byte-identical in
+// lib/services/tunnel_frame_codec.dart and api-backend/tunnel-frame.js.
+extern const char kTunnelDictionary[];
+extern const size_t kTunnelDictionarySize;
+
+// Payloads below this are sent as they are; the header and the chance of a
+// saving are both too small.
+constexpr size_t kTunnelCompressionMinSize = 96;
+
+// Largest uncompressed size accepted from a peer.
+constexpr size_t kTunnelMaxDecompressedSize = 16 * 1024 * 1024;
+
+// Compresses and decompresses tunnel payloads, reusing its buffers across
+// calls. Not thread-safe; owned by one TunnelSession.
+class TunnelCompressor {
+ public:
+  TunnelCompressor();
+  ~TunnelCompressor();
+
+  // Prevent copying.
+  TunnelCompressor(TunnelCompressor const&) = delete;
+  TunnelCompressor& operator=(TunnelCompressor const&) = delete;
+
+  // Writes the compressed form of |size| bytes at |data| to |out|. Returns
+  // false, leaving |out| unspecified, if the payload is too small or does
+  // not shrink by at least an eighth, in which case it should be sent raw.
+  bool Compress(const uint8_t* data, size_t size, std::vector<uint8_t>* out);
+
+  // Decompresses a payload produced by Compress. On success |*out| points
+  // at |*out_size| bytes owned by the compressor, valid until its next
+  // call. Returns false if the payload is malformed or too large.
+  bool Decompress(const uint8_t* data, size_t size, const uint8_t** out,
+                  size_t* out_size);
+
+ private:
+  // The dictionary followed by the data being compressed or decompressed,
+  // so offsets into either are plain distances back from the cursor.
+  std::vector<uint8_t> window_;
+  std::vector<uint32_t> table_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_TUNNEL_COMPRESSION_H_
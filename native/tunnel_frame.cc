@@ -0,0 +1,174 @@
+#include "native/tunnel_frame.h"
+
+#include <chrono>
+#include <cstring>
+#include <utility>
+
+#include "native/wire_format.h"
+
+namespace cloudtolocalllm {
+
+namespace {
+
+constexpr size_t kNonceOffset = 16;
+
+void StoreLE(uint8_t* out, uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) {
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+bool FromDesktop(uint32_t direction) {
+  return direction != static_cast<uint32_t>(TunnelDirection::kCloudToDesktop);
+}
+
+uint64_t MonotonicMicros() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+}  // namespace
+
+TunnelSession::TunnelSession(const uint8_t key[ChaCha20Poly1305::kKeySize],
+                             std::string session_id, TunnelDirection outgoing)
+    : aead_(key),
+      session_id_(std::move(session_id)),
+      outgoing_(outgoing),
+      next_sequence_(0),
+      next_received_sequence_(),
+      compress_(false) {
+  if (session_id_.size() > kTunnelFrameMaxSessionIdSize) {
+    session_id_.resize(kTunnelFrameMaxSessionIdSize);
+  }
+}
+
+TunnelSession::~TunnelSession() = default;
+
+size_t TunnelSession::FrameSize(size_t payload_size) const {
+  return HeaderSize() + payload_size + ChaCha20Poly1305::kTagSize;
+}
+
+size_t TunnelSession::HeaderSize() const {
+  return kTunnelFrameFixedHeaderSize + session_id_.size();
+}
+
+void TunnelSession::Seal(uint8_t type, const uint8_t* payload, size_t size,
+                         std::vector<uint8_t>* frame) {
+  frame->reserve(frame->size() + FrameSize(size));
+  const size_t start = BeginFrame(frame);
+  frame->insert(frame->end(), payload, payload + size);
+  FinishFrame(type, start, frame);
+}
+
+size_t TunnelSession::BeginFrame(std::vector<uint8_t>* frame) const {
+  const size_t start = frame->size();
+  frame->resize(start + HeaderSize());
+  return start;
+}
+
+void TunnelSession::FinishFrame(uint8_t type, size_t start,
+                                std::vector<uint8_t>* frame) {
+  const size_t header_size = HeaderSize();
+  size_t size = frame->size() - start - header_size;
+  uint8_t flags = 0;
+  if (compress_ && size >= kTunnelCompressionMinSize) {
+    if (!compressor_) {
+      compressor_ = std::make_unique<TunnelCompressor>();
+    }
+    if (compressor_->Compress(frame->data() + start + header_size, size,
+                              &compressed_)) {
+      size = compressed_.size();
+      frame->resize(start + header_size + size);
+      std::memcpy(frame->data() + start + header_size, compressed_.data(),
+                  size);
+      flags |= kTunnelFrameFlagCompressed;
+    }
+  }
+  frame->resize(frame->size() + ChaCha20Poly1305::kTagSize);
+
+  uint8_t* base = frame->data() + start;
+  base[0] = kTunnelFrameVersion;
+  base[1] = type;
+  base[2] = flags;
+  base[3] = static_cast<uint8_t>(session_id_.size());
+  StoreLE(base + 4, size + ChaCha20Poly1305::kTagSize, 4);
+  StoreLE(base + 8, MonotonicMicros(), 8);
+  StoreLE(base + 16, static_cast<uint32_t>(outgoing_), 4);
+  StoreLE(base + 20, next_sequence_++, 8);
+  std::memcpy(base + kTunnelFrameFixedHeaderSize, session_id_.data(),
+              session_id_.size());
+
+  aead_.Seal(base + kNonceOffset, base, header_size, base + header_size, size,
+             base + header_size + size);
+}
+
+TunnelFrameStatus TunnelSession::Open(uint8_t* frame, size_t size,
+                                      TunnelFrame* out) {
+  WireReader reader(frame, size);
+  uint8_t version = 0;
+  uint8_t type = 0;
+  uint8_t flags = 0;
+  uint8_t session_id_size = 0;
+  uint32_t ciphertext_size = 0;
+  uint64_t timestamp = 0;
+  uint32_t direction = 0;
+  uint64_t sequence = 0;
+  const uint8_t* session_id = nullptr;
+  reader.ReadU8(&version);
+  reader.ReadU8(&type);
+  reader.ReadU8(&flags);
+  reader.ReadU8(&session_id_size);
+  reader.ReadU32(&ciphertext_size);
+  reader.ReadU64(&timestamp);
+  reader.ReadU32(&direction);
+  reader.ReadU64(&sequence);
+  reader.ReadSpan(session_id_size, &session_id);
+  if (!reader.ok() || version != kTunnelFrameVersion ||
+      (flags & ~kTunnelFrameFlagCompressed) != 0 ||
+      ciphertext_size < ChaCha20Poly1305::kTagSize ||
+      reader.remaining() != ciphertext_size) {
+    return TunnelFrameStatus::kMalformed;
+  }
+  if (direction >= kTunnelDirectionCount ||
+      FromDesktop(direction) == FromDesktop(static_cast<uint32_t>(outgoing_)) ||
+      session_id_size != session_id_.size() ||
+      std::memcmp(session_id, session_id_.data(), session_id_size) != 0) {
+    return TunnelFrameStatus::kWrongSession;
+  }
+  if (sequence < next_received_sequence_[direction]) {
+    return TunnelFrameStatus::kReplayed;
+  }
+
+  const size_t header_size = size - ciphertext_size;
+  size_t payload_size = ciphertext_size - ChaCha20Poly1305::kTagSize;
+  uint8_t* plaintext = frame + header_size;
+  if (!aead_.Open(frame + kNonceOffset, frame, header_size, plaintext,
+                  payload_size, plaintext + payload_size)) {
+    return TunnelFrameStatus::kAuthenticationFailed;
+  }
+  const uint8_t* payload = plaintext;
+  if (flags & kTunnelFrameFlagCompressed) {
+    if (!compressor_) {
+      compressor_ = std::make_unique<TunnelCompressor>();
+    }
+    // It authenticated, so its sequence number is spent even though the
+    // payload is unusable.
+    if (!compressor_->Decompress(payload, payload_size, &payload,
+                                 &payload_size)) {
+      next_received_sequence_[direction] = sequence + 1;
+      return TunnelFrameStatus::kMalformed;
+    }
+  }
+
+  next_received_sequence_[direction] = sequence + 1;
+  out->type = type;
+  out->timestamp_us = timestamp;
+  out->sequence = sequence;
+  out->payload = payload;
+  out->payload_size = payload_size;
+  return TunnelFrameStatus::kOk;
+}
+
+}  // namespace cloudtolocalllm
@@ -0,0 +1,127 @@
+#ifndef NATIVE_TUNNEL_FRAME_H_
+#define NATIVE_TUNNEL_FRAME_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "native/chacha20_poly1305.h"
+#include "native/tunnel_compression.h"
+
+namespace cloudtolocalllm {
+
+// Binary frame carried in one WebSocket binary message on the encrypted
+// tunnel. All integers are little-endian:
+//
+//   0   u8    version (kTunnelFrameVersion)
+//   1   u8    message type (TunnelMessageType index + 1 on the Dart side)
+//   2   u8    flags (kTunnelFrameFlag*), other bits 0
+//   3   u8    session id length n
+//   4   u32   ciphertext length, including the 16-byte tag
+//   8   u64   sender's monotonic clock in microseconds
+//   16  u32   direction (TunnelDirection)
+//   20  u64   per-direction sequence number
+//   28  n     session id
+//   28+n      ciphertext, tag
+//
+// Bytes 16..27 are the ChaCha20-Poly1305 nonce, and the whole header is the
+// AAD, so nothing in it can be altered in transit. The sequence number must
+// increase strictly in each direction, which also rejects replays.
+constexpr uint8_t kTunnelFrameVersion = 1;
+constexpr size_t kTunnelFrameFixedHeaderSize = 28;
+constexpr size_t kTunnelFrameMaxSessionIdSize = 255;
+
+// The plaintext is a compressed payload (see native/tunnel_compression.h).
+// Only set by a sender whose peer advertised the capability; a receiver
+// always accepts it.
+constexpr uint8_t kTunnelFrameFlagCompressed = 1 << 0;
+
+enum class TunnelDirection : uint32_t {
+  kDesktopToCloud = 0,
+  kCloudToDesktop = 1,
+  // Response bodies streamed from the HTTP worker thread (see
+  // HttpStreamService). A direction of their own gives them a separate nonce
+  // space and sequence, so they interleave freely with frames sealed on the
+  // platform thread.
+  kDesktopToCloudStream = 2,
+};
+constexpr uint32_t kTunnelDirectionCount = 3;
+
+enum class TunnelFrameStatus : uint8_t {
+  kOk = 0,
+  kMalformed = 1,
+  kWrongSession = 2,
+  kReplayed = 3,
+  kAuthenticationFailed = 4,
+};
+
+// A decrypted frame. |payload| points into the buffer passed to Open or,
+// if the frame was compressed, into the session until its next Open.
+struct TunnelFrame {
+  uint8_t type = 0;
+  uint64_t timestamp_us = 0;
+  uint64_t sequence = 0;
+  const uint8_t* payload = nullptr;
+  size_t payload_size = 0;
+};
+
+// Seals and opens frames for one established tunnel session. Not
+// thread-safe; each session is used from a single thread.
+class TunnelSession {
+ public:
+  TunnelSession(const uint8_t key[ChaCha20Poly1305::kKeySize],
+                std::string session_id, TunnelDirection outgoing);
+  ~TunnelSession();
+
+  // Prevent copying.
+  TunnelSession(TunnelSession const&) = delete;
+  TunnelSession& operator=(TunnelSession const&) = delete;
+
+  // Appends a complete frame for |type|/|payload| to |frame|. The payload is
+  // copied once into place and encrypted there.
+  void Seal(uint8_t type, const uint8_t* payload, size_t size,
+            std::vector<uint8_t>* frame);
+
+  // Two-step sealing for callers that build the payload directly in the
+  // output buffer. BeginFrame appends room for the header to |frame| and
+  // returns where the frame starts; the caller appends the payload, then
+  // FinishFrame fills in the header, encrypts the payload in place and
+  // appends the tag.
+  size_t BeginFrame(std::vector<uint8_t>* frame) const;
+  void FinishFrame(uint8_t type, size_t start, std::vector<uint8_t>* frame);
+
+  // Authenticates |frame|, decrypts it in place and decompresses it if it
+  // is flagged compressed.
+  TunnelFrameStatus Open(uint8_t* frame, size_t size, TunnelFrame* out);
+
+  // Whether FinishFrame compresses payloads that shrink enough. Off by
+  // default; turned on once the peer has shown it can open such frames.
+  void set_compression(bool enabled) { compress_ = enabled; }
+
+  // Size of a frame carrying |payload_size| bytes in this session, at most
+  // (compression only ever makes it smaller).
+  size_t FrameSize(size_t payload_size) const;
+
+  // Size of the header preceding the payload in this session's frames.
+  size_t HeaderSize() const;
+
+  const std::string& session_id() const { return session_id_; }
+
+ private:
+  ChaCha20Poly1305 aead_;
+  std::string session_id_;
+  TunnelDirection outgoing_;
+  uint64_t next_sequence_;
+  // Lowest sequence number still acceptable from each direction.
+  uint64_t next_received_sequence_[kTunnelDirectionCount];
+  bool compress_;
+  // Created the first time either direction needs it.
+  std::unique_ptr<TunnelCompressor> compressor_;
+  std::vector<uint8_t> compressed_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_TUNNEL_FRAME_H_
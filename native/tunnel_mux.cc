@@ -0,0 +1,288 @@
+#include "native/tunnel_mux.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "native/latency_metrics.h"
+
+namespace cloudtolocalllm {
+
+TunnelMux::TunnelMux(Sink sink, ResumeCallback resume)
+    : TunnelMux(std::move(sink), std::move(resume), Options()) {}
+
+TunnelMux::TunnelMux(Sink sink, ResumeCallback resume, const Options& options)
+    : sink_(std::move(sink)),
+      resume_(std::move(resume)),
+      options_(options),
+      running_(false),
+      connection_unacked_(0),
+      bulk_unacked_(0),
+      streams_opened_(0),
+      frames_sent_(0),
+      credit_stalls_(0) {}
+
+TunnelMux::~TunnelMux() {
+  Stop();
+}
+
+bool TunnelMux::Start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running_) {
+    return true;
+  }
+  running_ = true;
+  worker_ = std::thread(&TunnelMux::Run, this);
+  return true;
+}
+
+void TunnelMux::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+  }
+  wake_.notify_all();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  streams_.Clear();
+  for (auto& ready : ready_) {
+    ready.clear();
+  }
+  connection_unacked_ = 0;
+  bulk_unacked_ = 0;
+}
+
+void TunnelMux::OpenStream(uint64_t id, std::shared_ptr<TunnelSession> session,
+                           Priority priority, uint32_t window) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  RemoveStream(id);
+  bool allocated;
+  Stream& stream = streams_.Insert(id, &allocated);
+  if (allocated) {
+    LatencyMetrics::Get()->CountAllocations();
+  }
+  stream.session = std::move(session);
+  stream.priority =
+      static_cast<uint32_t>(priority) < kPriorityCount ? priority
+                                                       : Priority::kNormal;
+  stream.window = std::max<uint32_t>(window, 1);
+  streams_opened_++;
+}
+
+bool TunnelMux::Enqueue(uint64_t id, uint8_t type, size_t frame_start,
+                        std::vector<uint8_t> event, bool flow_controlled) {
+  bool room = true;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stream* found = streams_.Find(id);
+    // A cancelled stream's producer is being stopped anyway.
+    if (found == nullptr || found->finished) {
+      return true;
+    }
+    Stream& stream = *found;
+    Item item;
+    item.event = std::move(event);
+    item.frame_start = frame_start;
+    item.type = type;
+    item.flow_controlled = flow_controlled;
+    stream.queue.push_back(std::move(item));
+    if (stream.queued() == 1) {
+      MarkReady(id, &stream);
+    }
+    if (flow_controlled) {
+      stream.queued_chunks++;
+      room = stream.queued_chunks + stream.unacked < stream.window;
+      if (!room) {
+        stream.paused = true;
+      }
+    }
+  }
+  wake_.notify_one();
+  return room;
+}
+
+void TunnelMux::Finish(uint64_t id, std::vector<uint8_t> event) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stream* found = streams_.Find(id);
+    if (found == nullptr || found->finished) {
+      return;
+    }
+    Stream& stream = *found;
+    Item item;
+    item.event = std::move(event);
+    item.seal = false;
+    stream.queue.push_back(std::move(item));
+    stream.finished = true;
+    if (stream.queue.size() == 1) {
+      MarkReady(id, &stream);
+    }
+  }
+  wake_.notify_one();
+}
+
+void TunnelMux::GrantCredit(uint64_t id, uint32_t frames) {
+  bool resume = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stream* found = streams_.Find(id);
+    if (found == nullptr) {
+      return;
+    }
+    Stream& stream = *found;
+    const uint32_t acked = std::min(frames, stream.unacked);
+    stream.unacked -= acked;
+    connection_unacked_ -= acked;
+    if (stream.priority == Priority::kBulk) {
+      bulk_unacked_ -= acked;
+    }
+    resume = stream.paused &&
+             stream.queued_chunks + stream.unacked < stream.window;
+    if (resume) {
+      stream.paused = false;
+    }
+  }
+  // Credit for one stream can unblock others waiting on the connection.
+  wake_.notify_one();
+  if (resume) {
+    resume_(id);
+  }
+}
+
+void TunnelMux::CloseStream(uint64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  RemoveStream(id);
+}
+
+TunnelMux::Stats TunnelMux::stats() const {
+  Stats stats;
+  stats.streams_opened = streams_opened_;
+  stats.frames_sent = frames_sent_;
+  stats.credit_stalls = credit_stalls_;
+  return stats;
+}
+
+void TunnelMux::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    uint64_t id = 0;
+    Stream* stream = nullptr;
+    wake_.wait(lock, [&] {
+      return !running_ || (stream = NextReady(&id)) != nullptr;
+    });
+    if (!running_) {
+      return;
+    }
+
+    Item item = std::move(stream->queue[stream->head++]);
+    if (stream->empty()) {
+      stream->queue.clear();
+      stream->head = 0;
+    } else if (stream->head >= 64 && stream->head * 2 >= stream->queue.size()) {
+      // A queue that never drains, behind a slow reader, still stays small.
+      stream->queue.erase(stream->queue.begin(),
+                          stream->queue.begin() + stream->head);
+      stream->head = 0;
+    }
+    stream->stalled = false;
+    if (item.flow_controlled) {
+      stream->queued_chunks--;
+      stream->unacked++;
+      connection_unacked_++;
+      if (stream->priority == Priority::kBulk) {
+        bulk_unacked_++;
+      }
+    }
+    // This thread is the only one sealing, so a session reference is all
+    // that has to outlive the lock.
+    std::shared_ptr<TunnelSession> session = stream->session;
+    if (!item.seal) {
+      // The final event; its frames have all gone. Whatever the cloud side
+      // has yet to acknowledge is no longer held against the connection.
+      RemoveStream(id);
+    } else if (!stream->empty()) {
+      MarkReady(id, stream);
+    }
+
+    lock.unlock();
+    if (item.seal) {
+      session->FinishFrame(item.type, item.frame_start, &item.event);
+      frames_sent_++;
+    }
+    sink_(std::move(item.event));
+    lock.lock();
+  }
+}
+
+TunnelMux::Stream* TunnelMux::NextReady(uint64_t* id) {
+  for (auto& ready : ready_) {
+    for (auto it = ready.begin(); it != ready.end(); ++it) {
+      Stream& stream = *streams_.Find(*it);
+      if (!CanSend(stream)) {
+        if (!stream.stalled) {
+          stream.stalled = true;
+          credit_stalls_++;
+        }
+        continue;
+      }
+      // Served streams go to the back of their priority's line when they
+      // have more (see Run), which makes it round-robin.
+      *id = *it;
+      ready.erase(it);
+      return &stream;
+    }
+  }
+  return nullptr;
+}
+
+bool TunnelMux::CanSend(const Stream& stream) const {
+  const Item& next = stream.queue[stream.head];
+  if (!next.flow_controlled) {
+    return true;
+  }
+  if (stream.unacked >= stream.window ||
+      connection_unacked_ >= options_.connection_window) {
+    return false;
+  }
+  return stream.priority != Priority::kBulk ||
+         bulk_unacked_ < options_.bulk_window;
+}
+
+void TunnelMux::MarkReady(uint64_t id, Stream* stream) {
+  ready_[static_cast<uint32_t>(stream->priority)].push_back(id);
+}
+
+void TunnelMux::RemoveStream(uint64_t id) {
+  const Stream* found = streams_.Find(id);
+  if (found == nullptr) {
+    return;
+  }
+  const Stream& stream = *found;
+  connection_unacked_ -= stream.unacked;
+  if (stream.priority == Priority::kBulk) {
+    bulk_unacked_ -= stream.unacked;
+  }
+  auto& ready = ready_[static_cast<uint32_t>(stream.priority)];
+  ready.erase(std::remove(ready.begin(), ready.end(), id), ready.end());
+  streams_.Erase(id);
+}
+
+void TunnelMux::ResetStream::operator()(Stream* stream) const {
+  stream->session.reset();
+  stream->priority = Priority::kNormal;
+  stream->window = 0;
+  stream->unacked = 0;
+  stream->queued_chunks = 0;
+  stream->paused = false;
+  stream->stalled = false;
+  stream->finished = false;
+  stream->queue.clear();
+  stream->head = 0;
+}
+
+}  // namespace cloudtolocalllm
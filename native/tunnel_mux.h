@@ -0,0 +1,183 @@
+#ifndef NATIVE_TUNNEL_MUX_H_
+#define NATIVE_TUNNEL_MUX_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "native/recycling_map.h"
+#include "native/tunnel_frame.h"
+
+namespace cloudtolocalllm {
+
+// Interleaves the responses relayed over one encrypted tunnel so that many
+// can share it without stalling each other.
+//
+// Each response is a stream, identified by its request id, with a priority
+// and a window of chunk frames the cloud side may have unacknowledged.
+// Producers (the HTTP worker) queue frames with the header reserved but not
+// yet sealed; the multiplexer's own thread picks the next frame to send,
+// seals it and hands it to the sink. Sealing at send time is what allows
+// reordering across streams: sequence numbers are assigned in the order
+// frames actually leave, so the cloud side still sees them strictly
+// increasing, while each stream's frames keep their own order.
+//
+// The next frame comes from the highest-priority stream that has one ready,
+// round-robin among streams of equal priority, so a chat's tokens go out
+// ahead of a model pull's layers and two chats share the link evenly.
+// Besides its own window, every chunk frame counts against a window for the
+// whole connection, which bounds how much is in flight to the cloud side
+// and so how long a newly ready interactive frame waits behind bulk ones.
+// Bulk streams may only fill part of it, keeping room for the rest.
+//
+// Thread-safe. The sink runs on the multiplexer's thread, and the resume
+// callback on the thread calling GrantCredit; both must hand off rather
+// than block.
+class TunnelMux {
+ public:
+  enum class Priority : uint8_t {
+    // Chat and generate streams, and small metadata responses.
+    kInteractive = 0,
+    kNormal = 1,
+    // Model pulls, pushes and blob uploads.
+    kBulk = 2,
+  };
+  static constexpr uint32_t kPriorityCount = 3;
+
+  struct Options {
+    // Chunk frames that may be unacknowledged across all streams.
+    uint32_t connection_window = 32;
+    // How much of it bulk streams may hold.
+    uint32_t bulk_window = 16;
+  };
+
+  struct Stats {
+    uint64_t streams_opened = 0;
+    uint64_t frames_sent = 0;
+    // Times a stream had a chunk ready but no credit of its own or of the
+    // connection's.
+    uint64_t credit_stalls = 0;
+  };
+
+  // Receives each sealed frame (or final event, see Finish) in send order.
+  using Sink = std::function<void(std::vector<uint8_t> event)>;
+  // Told that stream |id| has room in its window again after Enqueue
+  // returned false.
+  using ResumeCallback = std::function<void(uint64_t id)>;
+
+  TunnelMux(Sink sink, ResumeCallback resume);
+  TunnelMux(Sink sink, ResumeCallback resume, const Options& options);
+  ~TunnelMux();
+
+  // Prevent copying.
+  TunnelMux(TunnelMux const&) = delete;
+  TunnelMux& operator=(TunnelMux const&) = delete;
+
+  // Starts the multiplexer's thread. Returns false if it could not be
+  // started.
+  bool Start();
+
+  // Stops the thread; queued frames are dropped. Called automatically on
+  // destruction.
+  void Stop();
+
+  // Registers stream |id|, whose frames are sealed in |session|. At most
+  // |window| of its chunk frames are sent ahead of the cloud side's
+  // acknowledgements.
+  void OpenStream(uint64_t id, std::shared_ptr<TunnelSession> session,
+                  Priority priority, uint32_t window);
+
+  // Queues |event|, which holds a frame begun with session->BeginFrame at
+  // |frame_start| and its payload, to be sealed as |type|. Chunk frames
+  // (|flow_controlled|) wait for credit; others only for their turn.
+  // Returns false once the stream has a window's worth of chunk frames
+  // queued or unacknowledged, after which the producer should pause until
+  // the resume callback.
+  bool Enqueue(uint64_t id, uint8_t type, size_t frame_start,
+               std::vector<uint8_t> event, bool flow_controlled);
+
+  // Queues |event| to be sent as is after the stream's other frames, and
+  // ends the stream once it is.
+  void Finish(uint64_t id, std::vector<uint8_t> event);
+
+  // The cloud side has consumed |frames| chunk frames of stream |id|.
+  void GrantCredit(uint64_t id, uint32_t frames);
+
+  // Drops stream |id| and whatever it has queued.
+  void CloseStream(uint64_t id);
+
+  Stats stats() const;
+
+ private:
+  struct Item {
+    std::vector<uint8_t> event;
+    size_t frame_start = 0;
+    uint8_t type = 0;
+    bool seal = true;
+    bool flow_controlled = false;
+  };
+
+  struct Stream {
+    std::shared_ptr<TunnelSession> session;
+    Priority priority = Priority::kNormal;
+    uint32_t window = 0;
+    // Chunk frames sent and not yet acknowledged, and queued.
+    uint32_t unacked = 0;
+    uint32_t queued_chunks = 0;
+    bool paused = false;
+    bool stalled = false;
+    // Set by Finish; nothing more is queued.
+    bool finished = false;
+    // Queued from |head| on. A vector rather than a deque so that a
+    // recycled stream keeps its storage as items come and go.
+    std::vector<Item> queue;
+    size_t head = 0;
+
+    bool empty() const { return head == queue.size(); }
+    size_t queued() const { return queue.size() - head; }
+  };
+
+  // Readies a closed stream's entry for the next one, keeping its queue's
+  // storage.
+  struct ResetStream {
+    void operator()(Stream* stream) const;
+  };
+
+  void Run();
+  // With |mutex_| held: the next stream to send from, or nullptr.
+  Stream* NextReady(uint64_t* id);
+  bool CanSend(const Stream& stream) const;
+  void MarkReady(uint64_t id, Stream* stream);
+  void RemoveStream(uint64_t id);
+
+  Sink sink_;
+  ResumeCallback resume_;
+  Options options_;
+
+  std::thread worker_;
+  bool running_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  RecyclingMap<uint64_t, Stream, ResetStream> streams_;
+  // Streams with something queued, per priority, in service order.
+  std::deque<uint64_t> ready_[kPriorityCount];
+  // Chunk frames unacknowledged across all streams, and by bulk ones.
+  uint32_t connection_unacked_;
+  uint32_t bulk_unacked_;
+
+  std::atomic<uint64_t> streams_opened_;
+  std::atomic<uint64_t> frames_sent_;
+  std::atomic<uint64_t> credit_stalls_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_TUNNEL_MUX_H_
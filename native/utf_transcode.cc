@@ -0,0 +1,231 @@
+#include "native/utf_transcode.h"
+
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CLOUDTOLOCALLLM_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define CLOUDTOLOCALLLM_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace cloudtolocalllm {
+
+namespace {
+
+// Copies the leading ASCII code units of |size| at |in| to |out| as bytes;
+// returns how many there were.
+size_t NarrowAscii(const char16_t* in, size_t size, uint8_t* out) {
+  size_t n = 0;
+#if defined(CLOUDTOLOCALLLM_SSE2)
+  // -128 is 0xff80, the bits only a non-ASCII unit has set.
+  const __m128i non_ascii = _mm_set1_epi16(-128);
+  const __m128i zero = _mm_setzero_si128();
+  for (; size - n >= 16; n += 16) {
+    __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + n));
+    __m128i high =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + n + 8));
+    __m128i bits = _mm_and_si128(_mm_or_si128(low, high), non_ascii);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(bits, zero)) != 0xffff) {
+      break;
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + n),
+                     _mm_packus_epi16(low, high));
+  }
+#elif defined(CLOUDTOLOCALLLM_NEON)
+  for (; size - n >= 16; n += 16) {
+    uint16x8_t low = vld1q_u16(reinterpret_cast<const uint16_t*>(in + n));
+    uint16x8_t high =
+        vld1q_u16(reinterpret_cast<const uint16_t*>(in + n + 8));
+    uint16x8_t both = vorrq_u16(low, high);
+    uint16x4_t folded = vorr_u16(vget_low_u16(both), vget_high_u16(both));
+    if ((vget_lane_u64(vreinterpret_u64_u16(folded), 0) &
+         0xff80ff80ff80ff80ull) != 0) {
+      break;
+    }
+    vst1q_u8(out + n, vcombine_u8(vmovn_u16(low), vmovn_u16(high)));
+  }
+#endif
+  for (; n < size && in[n] < 0x80; n++) {
+    out[n] = static_cast<uint8_t>(in[n]);
+  }
+  return n;
+}
+
+// Copies the leading ASCII bytes of |size| at |in| to |out| as code units;
+// returns how many there were.
+size_t WidenAscii(const uint8_t* in, size_t size, char16_t* out) {
+  size_t n = 0;
+#if defined(CLOUDTOLOCALLLM_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  for (; size - n >= 16; n += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + n));
+    if (_mm_movemask_epi8(chunk) != 0) {
+      break;
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + n),
+                     _mm_unpacklo_epi8(chunk, zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + n + 8),
+                     _mm_unpackhi_epi8(chunk, zero));
+  }
+#elif defined(CLOUDTOLOCALLLM_NEON)
+  for (; size - n >= 16; n += 16) {
+    uint8x16_t chunk = vld1q_u8(in + n);
+    uint8x8_t folded = vorr_u8(vget_low_u8(chunk), vget_high_u8(chunk));
+    if ((vget_lane_u64(vreinterpret_u64_u8(folded), 0) &
+         0x8080808080808080ull) != 0) {
+      break;
+    }
+    uint16_t* wide = reinterpret_cast<uint16_t*>(out + n);
+    vst1q_u16(wide, vmovl_u8(vget_low_u8(chunk)));
+    vst1q_u16(wide + 8, vmovl_u8(vget_high_u8(chunk)));
+  }
+#endif
+  for (; n < size && in[n] < 0x80; n++) {
+    out[n] = static_cast<char16_t>(in[n]);
+  }
+  return n;
+}
+
+bool IsContinuation(uint8_t byte) { return (byte & 0xc0) == 0x80; }
+
+template <typename Char>
+bool Utf16ToUtf8String(const Char* in, size_t size, std::string* out) {
+  const char16_t* units = reinterpret_cast<const char16_t*>(in);
+  // Exactly right for ASCII; grown once at the first other character.
+  out->resize(size);
+  const size_t ascii =
+      NarrowAscii(units, size, reinterpret_cast<uint8_t*>(&(*out)[0]));
+  if (ascii == size) {
+    return true;
+  }
+  out->resize(ascii + MaxUtf8Size(size - ascii));
+  const size_t written =
+      Utf16ToUtf8(units + ascii, size - ascii, &(*out)[ascii]);
+  if (written == kUtfInvalid) {
+    out->clear();
+    return false;
+  }
+  out->resize(ascii + written);
+  return true;
+}
+
+template <typename String>
+bool Utf8ToUtf16String(const char* in, size_t size, String* out) {
+  out->resize(MaxUtf16Size(size));
+  const size_t written =
+      Utf8ToUtf16(in, size, reinterpret_cast<char16_t*>(&(*out)[0]));
+  if (written == kUtfInvalid) {
+    out->clear();
+    return false;
+  }
+  out->resize(written);
+  return true;
+}
+
+}  // namespace
+
+size_t Utf16ToUtf8(const char16_t* in, size_t size, char* out) {
+  uint8_t* const begin = reinterpret_cast<uint8_t*>(out);
+  uint8_t* o = begin;
+  size_t i = 0;
+  while (i < size) {
+    const size_t ascii = NarrowAscii(in + i, size - i, o);
+    i += ascii;
+    o += ascii;
+    for (; i < size && in[i] >= 0x80; i++) {
+      uint32_t c = in[i];
+      if (c < 0x800) {
+        *o++ = static_cast<uint8_t>(0xc0 | (c >> 6));
+        *o++ = static_cast<uint8_t>(0x80 | (c & 0x3f));
+        continue;
+      }
+      if (c >= 0xd800 && c <= 0xdfff) {
+        // Only a high surrogate followed by a low one is a character.
+        if (c >= 0xdc00 || i + 1 == size || in[i + 1] < 0xdc00 ||
+            in[i + 1] > 0xdfff) {
+          return kUtfInvalid;
+        }
+        c = 0x10000 + ((c - 0xd800) << 10) + (in[++i] - 0xdc00);
+        *o++ = static_cast<uint8_t>(0xf0 | (c >> 18));
+        *o++ = static_cast<uint8_t>(0x80 | ((c >> 12) & 0x3f));
+      } else {
+        *o++ = static_cast<uint8_t>(0xe0 | (c >> 12));
+      }
+      *o++ = static_cast<uint8_t>(0x80 | ((c >> 6) & 0x3f));
+      *o++ = static_cast<uint8_t>(0x80 | (c & 0x3f));
+    }
+  }
+  return static_cast<size_t>(o - begin);
+}
+
+size_t Utf8ToUtf16(const char* in, size_t size, char16_t* out) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(in);
+  char16_t* o = out;
+  size_t i = 0;
+  while (i < size) {
+    const size_t ascii = WidenAscii(bytes + i, size - i, o);
+    i += ascii;
+    o += ascii;
+    while (i < size && bytes[i] >= 0x80) {
+      const uint8_t lead = bytes[i];
+      const size_t remaining = size - i;
+      uint32_t c = 0;
+      if (lead >= 0xc2 && lead < 0xe0 && remaining >= 2 &&
+          IsContinuation(bytes[i + 1])) {
+        c = ((lead & 0x1fu) << 6) | (bytes[i + 1] & 0x3fu);
+        i += 2;
+      } else if (lead >= 0xe0 && lead < 0xf0 && remaining >= 3 &&
+                 IsContinuation(bytes[i + 1]) &&
+                 IsContinuation(bytes[i + 2])) {
+        c = ((lead & 0x0fu) << 12) | ((bytes[i + 1] & 0x3fu) << 6) |
+            (bytes[i + 2] & 0x3fu);
+        if (c < 0x800 || (c >= 0xd800 && c <= 0xdfff)) {
+          return kUtfInvalid;
+        }
+        i += 3;
+      } else if (lead >= 0xf0 && lead < 0xf5 && remaining >= 4 &&
+                 IsContinuation(bytes[i + 1]) &&
+                 IsContinuation(bytes[i + 2]) &&
+                 IsContinuation(bytes[i + 3])) {
+        c = ((lead & 0x07u) << 18) | ((bytes[i + 1] & 0x3fu) << 12) |
+            ((bytes[i + 2] & 0x3fu) << 6) | (bytes[i + 3] & 0x3fu);
+        if (c < 0x10000 || c > 0x10ffff) {
+          return kUtfInvalid;
+        }
+        c -= 0x10000;
+        *o++ = static_cast<char16_t>(0xd800 + (c >> 10));
+        *o++ = static_cast<char16_t>(0xdc00 + (c & 0x3ff));
+        i += 4;
+        continue;
+      } else {
+        // A stray continuation byte, C0/C1/F5..FF, or a cut-off sequence.
+        return kUtfInvalid;
+      }
+      *o++ = static_cast<char16_t>(c);
+    }
+  }
+  return static_cast<size_t>(o - out);
+}
+
+bool Utf16ToUtf8(const char16_t* in, size_t size, std::string* out) {
+  return Utf16ToUtf8String(in, size, out);
+}
+
+bool Utf8ToUtf16(const char* in, size_t size, std::u16string* out) {
+  return Utf8ToUtf16String(in, size, out);
+}
+
+#ifdef _WIN32
+bool Utf16ToUtf8(const wchar_t* in, size_t size, std::string* out) {
+  return Utf16ToUtf8String(in, size, out);
+}
+
+bool Utf8ToUtf16(const char* in, size_t size, std::wstring* out) {
+  return Utf8ToUtf16String(in, size, out);
+}
+#endif
+
+}  // namespace cloudtolocalllm
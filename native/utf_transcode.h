@@ -0,0 +1,56 @@
+#ifndef NATIVE_UTF_TRANSCODE_H_
+#define NATIVE_UTF_TRANSCODE_H_
+
+#include <cstddef>
+#include <string>
+
+namespace cloudtolocalllm {
+
+// Conversion between UTF-16, the encoding of Win32's wide strings, and the
+// UTF-8 the engine and Dart exchange.
+//
+// Each conversion is a single pass over the input into an output buffer
+// sized from the input length alone, so there is no sizing pass and no
+// reallocation. Runs of ASCII, which make up nearly all arguments, paths
+// and prompts, are converted 16 code units per step with SSE2 or NEON;
+// other characters are converted one at a time.
+//
+// Invalid input is rejected rather than replaced, as WideCharToMultiByte
+// does with WC_ERR_INVALID_CHARS: an unpaired surrogate in UTF-16, and in
+// UTF-8 a truncated, overlong or out-of-range sequence or an encoded
+// surrogate.
+
+// Returned by the buffer conversions for invalid input.
+constexpr size_t kUtfInvalid = static_cast<size_t>(-1);
+
+// Most bytes of UTF-8 that |utf16_size| code units can produce.
+constexpr size_t MaxUtf8Size(size_t utf16_size) { return utf16_size * 3; }
+
+// Most code units of UTF-16 that |utf8_size| bytes can produce.
+constexpr size_t MaxUtf16Size(size_t utf8_size) { return utf8_size; }
+
+// Converts |size| code units at |in| into |out|, which must have room for
+// MaxUtf8Size(size) bytes. Returns the number of bytes written, or
+// kUtfInvalid.
+size_t Utf16ToUtf8(const char16_t* in, size_t size, char* out);
+
+// Converts |size| bytes at |in| into |out|, which must have room for
+// MaxUtf16Size(size) code units. Returns the number of code units written,
+// or kUtfInvalid.
+size_t Utf8ToUtf16(const char* in, size_t size, char16_t* out);
+
+// Replace the contents of |out|, reusing its capacity. An all-ASCII input
+// is written straight into a buffer of exactly the right size. Return
+// false, leaving |out| empty, for invalid input.
+bool Utf16ToUtf8(const char16_t* in, size_t size, std::string* out);
+bool Utf8ToUtf16(const char* in, size_t size, std::u16string* out);
+
+#ifdef _WIN32
+// wchar_t is a UTF-16 code unit on Windows.
+bool Utf16ToUtf8(const wchar_t* in, size_t size, std::string* out);
+bool Utf8ToUtf16(const char* in, size_t size, std::wstring* out);
+#endif
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_UTF_TRANSCODE_H_
@@ -0,0 +1,172 @@
+#ifndef NATIVE_WIRE_FORMAT_H_
+#define NATIVE_WIRE_FORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace cloudtolocalllm {
+
+// Appends little-endian fixed-width values to a byte buffer. All binary
+// channel payloads exchanged with Dart use this layout, which matches
+// ByteData's Endian.little accessors on the Dart side.
+class WireWriter {
+ public:
+  explicit WireWriter(std::vector<uint8_t>* out) : out_(out) {}
+
+  void WriteU8(uint8_t value) { out_->push_back(value); }
+
+  void WriteU16(uint16_t value) {
+    uint8_t bytes[2] = {static_cast<uint8_t>(value),
+                        static_cast<uint8_t>(value >> 8)};
+    WriteBytes(bytes, sizeof(bytes));
+  }
+
+  void WriteU32(uint32_t value) {
+    uint8_t bytes[4];
+    for (int i = 0; i < 4; i++) {
+      bytes[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+    WriteBytes(bytes, sizeof(bytes));
+  }
+
+  void WriteU64(uint64_t value) {
+    uint8_t bytes[8];
+    for (int i = 0; i < 8; i++) {
+      bytes[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+    WriteBytes(bytes, sizeof(bytes));
+  }
+
+  void WriteI64(int64_t value) { WriteU64(static_cast<uint64_t>(value)); }
+
+  void WriteBytes(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    out_->insert(out_->end(), bytes, bytes + size);
+  }
+
+  // Writes a u32 length followed by the bytes of |value|.
+  void WriteString(const std::string& value) {
+    WriteU32(static_cast<uint32_t>(value.size()));
+    WriteBytes(value.data(), value.size());
+  }
+
+  // Overwrites a u32 previously written at |offset|, for length fields that
+  // are only known once the body has been written.
+  void PatchU32(size_t offset, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+      (*out_)[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+  }
+
+  size_t size() const { return out_->size(); }
+
+ private:
+  std::vector<uint8_t>* out_;
+};
+
+// Bounds-checked reader for the layout produced by WireWriter. Every Read*
+// returns false once the input is exhausted; callers check ok() at the end
+// instead of after each field.
+class WireReader {
+ public:
+  WireReader(const uint8_t* data, size_t size)
+      : data_(data), size_(size), offset_(0), ok_(true) {}
+
+  bool ReadU8(uint8_t* value) {
+    if (!Require(1)) {
+      return false;
+    }
+    *value = data_[offset_++];
+    return true;
+  }
+
+  bool ReadU16(uint16_t* value) {
+    if (!Require(2)) {
+      return false;
+    }
+    *value = static_cast<uint16_t>(data_[offset_] |
+                                   (data_[offset_ + 1] << 8));
+    offset_ += 2;
+    return true;
+  }
+
+  bool ReadU32(uint32_t* value) {
+    if (!Require(4)) {
+      return false;
+    }
+    uint32_t result = 0;
+    for (int i = 0; i < 4; i++) {
+      result |= static_cast<uint32_t>(data_[offset_ + i]) << (8 * i);
+    }
+    offset_ += 4;
+    *value = result;
+    return true;
+  }
+
+  bool ReadU64(uint64_t* value) {
+    if (!Require(8)) {
+      return false;
+    }
+    uint64_t result = 0;
+    for (int i = 0; i < 8; i++) {
+      result |= static_cast<uint64_t>(data_[offset_ + i]) << (8 * i);
+    }
+    offset_ += 8;
+    *value = result;
+    return true;
+  }
+
+  bool ReadI64(int64_t* value) {
+    uint64_t bits;
+    if (!ReadU64(&bits)) {
+      return false;
+    }
+    *value = static_cast<int64_t>(bits);
+    return true;
+  }
+
+  // Returns a pointer to the next |size| bytes without copying them.
+  bool ReadSpan(size_t size, const uint8_t** span) {
+    if (!Require(size)) {
+      return false;
+    }
+    *span = data_ + offset_;
+    offset_ += size;
+    return true;
+  }
+
+  bool ReadString(std::string* value) {
+    uint32_t length;
+    const uint8_t* span;
+    if (!ReadU32(&length) || !ReadSpan(length, &span)) {
+      return false;
+    }
+    value->assign(reinterpret_cast<const char*>(span), length);
+    return true;
+  }
+
+  const uint8_t* current() const { return data_ + offset_; }
+  size_t remaining() const { return size_ - offset_; }
+  bool ok() const { return ok_; }
+
+ private:
+  bool Require(size_t size) {
+    if (!ok_ || size_ - offset_ < size) {
+      ok_ = false;
+      return false;
+    }
+    return true;
+  }
+
+  const uint8_t* data_;
+  size_t size_;
+  size_t offset_;
+  bool ok_;
+};
+
+}  // namespace cloudtolocalllm
+
+#endif  // NATIVE_WIRE_FORMAT_H_
@@ -36,6 +36,124 @@ const logger = winston.createLogger({
 const connections = new Map();
 let connectionCount = 0;
 
+// Log-linear latency histogram in microseconds with the bucket layout of
+// native/latency_histogram.h, so bucket counts reported by desktop clients
+// add straight in: values below 128 exact, each power of two above split in
+// 64 buckets, everything from 2^36 us in the last one.
+const SUB_BUCKETS = 64;
+const MAX_SHIFT = 29;
+const BUCKET_COUNT = SUB_BUCKETS * (MAX_SHIFT + 2);
+
+class LatencyHistogram {
+  constructor() {
+    this.counts = new Float64Array(BUCKET_COUNT);
+    this.total = 0;
+  }
+
+  static bucketIndex(micros) {
+    const value = Math.max(0, Math.floor(micros));
+    if (value < 2 * SUB_BUCKETS) {
+      return value;
+    }
+    const shift = Math.floor(Math.log2(value)) - 6;
+    if (shift > MAX_SHIFT) {
+      return BUCKET_COUNT - 1;
+    }
+    return SUB_BUCKETS * (shift + 1) + (Math.floor(value / 2 ** shift) - SUB_BUCKETS);
+  }
+
+  static bucketHighest(index) {
+    if (index < 2 * SUB_BUCKETS) {
+      return index;
+    }
+    const shift = Math.floor(index / SUB_BUCKETS) - 1;
+    const sub = (index % SUB_BUCKETS) + SUB_BUCKETS;
+    return (sub + 1) * 2 ** shift - 1;
+  }
+
+  record(micros) {
+    this.addBucket(LatencyHistogram.bucketIndex(micros), 1);
+  }
+
+  addBucket(index, count) {
+    if (!Number.isInteger(index) || index < 0 || index >= BUCKET_COUNT ||
+        !(count > 0)) {
+      return;
+    }
+    this.counts[index] += count;
+    this.total += count;
+  }
+
+  // Percentiles in milliseconds, bucket upper bounds as in HdrHistogram
+  summary() {
+    const quantiles = [0.5, 0.9, 0.99];
+    const values = [];
+    let seen = 0;
+    let max = 0;
+    for (let i = 0; i < BUCKET_COUNT; i++) {
+      if (this.counts[i] === 0) {
+        continue;
+      }
+      seen += this.counts[i];
+      max = LatencyHistogram.bucketHighest(i);
+      while (values.length < quantiles.length &&
+             seen >= quantiles[values.length] * this.total) {
+        values.push(max);
+      }
+    }
+    const ms = (micros) => Math.round(micros / 10) / 100;
+    return {
+      count: this.total,
+      p50Ms: ms(values[0] || 0),
+      p90Ms: ms(values[1] || 0),
+      p99Ms: ms(values[2] || 0),
+      maxMs: ms(max)
+    };
+  }
+}
+
+// Latency histograms by name: "proxy.rtt" measured here, and the desktop's
+// own ("local.ttft", "tunnel.rtt", "cloud.inter_token", ...) as reported in
+// its "latency" messages.
+const latencyHistograms = new Map();
+
+function latencyHistogram(name) {
+  let histogram = latencyHistograms.get(name);
+  if (!histogram) {
+    histogram = new LatencyHistogram();
+    latencyHistograms.set(name, histogram);
+  }
+  return histogram;
+}
+
+// Adds a client's bucket counts: { histograms: { name: [[index, count]] } }
+function mergeLatencyReport(message) {
+  const histograms = message.histograms;
+  if (!histograms || typeof histograms !== 'object') {
+    return;
+  }
+  for (const [name, buckets] of Object.entries(histograms)) {
+    if (!/^[a-z_]+\.[a-z_]+$/.test(name) || name.startsWith('proxy.') ||
+        !Array.isArray(buckets)) {
+      continue;
+    }
+    const histogram = latencyHistogram(name);
+    for (const bucket of buckets) {
+      if (Array.isArray(bucket)) {
+        histogram.addBucket(bucket[0], bucket[1]);
+      }
+    }
+  }
+}
+
+function latencySummaries() {
+  const summaries = {};
+  for (const [name, histogram] of latencyHistograms) {
+    summaries[name] = histogram.summary();
+  }
+  return summaries;
+}
+
 // HTTP server for health checks and basic endpoints
 const server = http.createServer((req, res) => {
   const url = new URL(req.url, `http://${req.headers.host}`);
@@ -59,7 +177,8 @@ const server = http.createServer((req, res) => {
       connections: connectionCount,
       activeStreams: connections.size,
       memoryUsage: process.memoryUsage(),
-      uptime: process.uptime()
+      uptime: process.uptime(),
+      latency: latencySummaries()
     }));
     break;
 
@@ -114,7 +233,18 @@ wss.on('connection', (ws, req) => {
     ws,
     connectedAt: new Date(),
     lastActivity: new Date(),
-    bytesTransferred: 0
+    bytesTransferred: 0,
+    pingSentAt: 0
+  });
+
+  // Round trip to the client, from WebSocket pings sent by the cleanup timer
+  ws.on('pong', () => {
+    const connection = connections.get(connectionId);
+    if (connection && connection.pingSentAt) {
+      const elapsed = process.hrtime.bigint() - connection.pingSentAt;
+      latencyHistogram('proxy.rtt').record(Number(elapsed / 1000n));
+      connection.pingSentAt = 0;
+    }
   });
 
   // Handle incoming messages (streaming data)
@@ -127,6 +257,17 @@ wss.on('connection', (ws, req) => {
       // Forward streaming data to other connections (if needed)
       // This is where streaming relay logic would be implemented
       logger.debug(`Received ${data.length} bytes from ${connectionId}`);
+
+      if (data[0] === 0x7b) { // '{'
+        try {
+          const message = JSON.parse(data.toString());
+          if (message.type === 'latency') {
+            mergeLatencyReport(message);
+          }
+        } catch (_error) {
+          // Not a control message
+        }
+      }
     }
   });
 
@@ -209,6 +350,9 @@ setInterval(() => {
       connection.ws.close(1001, 'Connection stale');
       connections.delete(connectionId);
       connectionCount--;
+    } else if (connection.ws.readyState === connection.ws.OPEN) {
+      connection.pingSentAt = process.hrtime.bigint();
+      connection.ws.ping();
     }
   });
 }, 60000); // Check every minute
@@ -0,0 +1,88 @@
+import 'dart:async';
+import 'dart:typed_data';
+import 'dart:ui' as ui;
+
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:cloudtolocalllm/services/deferred_plugins.dart';
+
+/// Stands in for the engine: 'plugin' only answers once [registered] is set,
+/// and the scheduler channel answers when [finishRegistration] is called.
+class _FakeRunnerMessenger extends BinaryMessenger {
+  final bool hasScheduler;
+  bool registered = false;
+  final List<String> sent = [];
+  final Completer<void> _schedulerReply = Completer<void>();
+
+  _FakeRunnerMessenger({this.hasScheduler = true});
+
+  void finishRegistration() {
+    registered = true;
+    _schedulerReply.complete();
+  }
+
+  @override
+  Future<ByteData?>? send(String channel, ByteData? message) async {
+    sent.add(channel);
+    if (channel == DeferredPlugins.channelName) {
+      if (!hasScheduler) return null;
+      await _schedulerReply.future;
+      return ByteData(1)..setUint8(0, 1);
+    }
+    return registered ? ByteData(1) : null;
+  }
+
+  @override
+  void setMessageHandler(String channel, MessageHandler? handler) {}
+
+  @override
+  Future<void> handlePlatformMessage(
+    String channel,
+    ByteData? data,
+    ui.PlatformMessageResponseCallback? callback,
+  ) async {}
+}
+
+void main() {
+  setUp(DeferredPlugins.reset);
+
+  group('DeferredPluginMessenger', () {
+    test('retries an unhandled call once the deferred plugins are in', () async {
+      final runner = _FakeRunnerMessenger();
+      final messenger = DeferredPluginMessenger(runner);
+
+      var replied = false;
+      final reply = messenger.send('plugin', ByteData(0))!.then((data) {
+        replied = true;
+        return data;
+      });
+      await pumpEventQueue();
+      expect(replied, isFalse);
+
+      runner.finishRegistration();
+      expect(await reply, isNotNull);
+      expect(runner.sent, [
+        'plugin',
+        DeferredPlugins.channelName,
+        'plugin',
+      ]);
+    });
+
+    test('passes unhandled calls through once ready', () async {
+      final runner = _FakeRunnerMessenger()..finishRegistration();
+      final messenger = DeferredPluginMessenger(runner);
+      await DeferredPlugins.ready(runner);
+
+      runner.registered = false;
+      expect(await messenger.send('plugin', ByteData(0)), isNull);
+      expect(runner.sent.where((c) => c == 'plugin'), hasLength(1));
+    });
+
+    test('is ready at once when the runner has no scheduler', () async {
+      final runner = _FakeRunnerMessenger(hasScheduler: false);
+      await DeferredPlugins.ready(runner);
+      expect(DeferredPlugins.isReady, isTrue);
+    });
+  });
+}
@@ -0,0 +1,83 @@
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:cloudtolocalllm/models/markdown_block.dart';
+import 'package:cloudtolocalllm/services/markdown_block_lexer.dart';
+
+const _reply =
+    '# Plan\n'
+    '\n'
+    'First a paragraph\n'
+    'over two lines.\n'
+    '```python\n'
+    'print("hi")\n'
+    '\n'
+    'x = 2\n'
+    '```\n'
+    '## Then 😀\n'
+    '~~~\n'
+    'unterminated';
+
+/// The reply's blocks after feeding it [size] code units at a time, as
+/// rebuilt from the updates alone.
+List<MarkdownBlock> _streamed(String text, int size) {
+  final lexer = MarkdownBlockLexer();
+  final blocks = <MarkdownBlock>[];
+  for (var i = 0; i < text.length; i += size) {
+    final end = i + size < text.length ? i + size : text.length;
+    lexer.append(text.substring(i, end)).applyTo(blocks);
+  }
+  expect(blocks, lexer.blocks);
+  return blocks;
+}
+
+void main() {
+  group('MarkdownBlockLexer', () {
+    test('splits headings, paragraphs and fenced code', () {
+      final blocks = _streamed(_reply, _reply.length);
+
+      expect(blocks.map((b) => b.kind), [
+        MarkdownBlockKind.heading,
+        MarkdownBlockKind.paragraph,
+        MarkdownBlockKind.code,
+        MarkdownBlockKind.heading,
+        MarkdownBlockKind.code,
+      ]);
+      expect(blocks[0].body(_reply), 'Plan');
+      expect(blocks[1].body(_reply), 'First a paragraph\nover two lines.');
+      expect(blocks[2].language(_reply), 'python');
+      expect(blocks[2].body(_reply), 'print("hi")\n\nx = 2');
+      expect(blocks[3].headingLevel(_reply), 2);
+      expect(blocks[3].body(_reply), 'Then 😀');
+      expect(blocks.take(4).every((b) => b.closed), isTrue);
+      expect(blocks[4].closed, isFalse);
+      expect(blocks[4].body(_reply), 'unterminated');
+    });
+
+    test('gives the same blocks however the reply is split', () {
+      final whole = _streamed(_reply, _reply.length);
+      for (final size in [1, 2, 3, 7]) {
+        expect(_streamed(_reply, size), whole, reason: 'size $size');
+      }
+    });
+
+    test('reclassifies the unfinished line as it grows', () {
+      final lexer = MarkdownBlockLexer();
+      final blocks = <MarkdownBlock>[];
+
+      lexer.append('Intro\n``').applyTo(blocks);
+      expect(blocks.single.body('Intro\n``'), 'Intro\n``');
+
+      final update = lexer.append('`sh\n');
+      update.applyTo(blocks);
+      expect(update.first, 0);
+      expect(blocks.map((b) => b.kind), [
+        MarkdownBlockKind.paragraph,
+        MarkdownBlockKind.code,
+      ]);
+      expect(blocks.first.closed, isTrue);
+
+      // Only the open code block changes from here on.
+      expect(lexer.append('ls -la').first, 1);
+    });
+  });
+}
@@ -0,0 +1,182 @@
+import 'dart:convert';
+import 'dart:typed_data';
+import 'dart:ui' as ui;
+
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:cloudtolocalllm/models/conversation.dart';
+import 'package:cloudtolocalllm/models/message.dart';
+import 'package:cloudtolocalllm/services/native_conversation_store.dart';
+
+/// Stands in for the runner: keeps the last conversation and message put
+/// and echoes them back in the reply layouts, so requests and replies have
+/// to agree.
+class _EchoStoreMessenger extends BinaryMessenger {
+  final bool available;
+  Uint8List? lastRequest;
+  Uint8List? conversation;
+  Uint8List? message;
+
+  _EchoStoreMessenger({this.available = true});
+
+  @override
+  Future<ByteData?>? send(String channel, ByteData? data) async {
+    final request = Uint8List.sublistView(data!);
+    lastRequest = request;
+    if (!available) return ByteData(0);
+    final payload = Uint8List.sublistView(request, 1);
+    final reply = BytesBuilder();
+    switch (request[0]) {
+      case 2: // list
+        reply.add(_u32(1));
+        reply.add(conversation!);
+        reply.add(_u32(3));
+        reply.addByte(message != null ? 1 : 0);
+        if (message != null) reply.add(message!);
+      case 3: // load messages
+        reply.add(_u32(1));
+        reply.add(message!);
+      case 4: // put conversation
+        conversation = payload;
+        reply.addByte(1);
+      case 6: // put message: skip the conversation id
+        final idLength = ByteData.sublistView(payload).getUint32(
+          0,
+          Endian.little,
+        );
+        message = Uint8List.sublistView(payload, 4 + idLength);
+        reply.addByte(1);
+      case 12: // search: one hit with the query as the message id
+        final queryLength = ByteData.sublistView(payload).getUint32(
+          0,
+          Endian.little,
+        );
+        reply.add(_u32(1));
+        reply.add(_u32(6));
+        reply.add(utf8.encode('conv_1'));
+        reply.add(Uint8List.sublistView(payload, 0, 4 + queryLength));
+        reply.add(
+          (ByteData(8)..setFloat64(0, 1.5, Endian.little)).buffer.asUint8List(),
+        );
+      default:
+        reply.addByte(1);
+    }
+    return ByteData.sublistView(reply.toBytes());
+  }
+
+  @override
+  void setMessageHandler(String channel, MessageHandler? handler) {}
+
+  @override
+  Future<void> handlePlatformMessage(
+    String channel,
+    ByteData? data,
+    ui.PlatformMessageResponseCallback? callback,
+  ) async {}
+}
+
+Uint8List _u32(int value) =>
+    (ByteData(4)..setUint32(0, value, Endian.little)).buffer.asUint8List();
+
+void main() {
+  final created = DateTime.fromMillisecondsSinceEpoch(1700000000000);
+  final conversation = Conversation(
+    id: 'conv_1',
+    title: 'Grüße',
+    model: 'llama3',
+    messages: const [],
+    createdAt: created,
+    updatedAt: created.add(const Duration(minutes: 5)),
+  );
+  final message = Message(
+    id: 'msg_1',
+    content: 'Hello 👋',
+    role: MessageRole.assistant,
+    timestamp: created,
+    model: 'llama3',
+    status: MessageStatus.error,
+    error: 'cut off',
+  );
+
+  group('NativeConversationStore', () {
+    test('lists what was put, with only the last message', () async {
+      final messenger = _EchoStoreMessenger();
+      final store = await NativeConversationStore.open(
+        '/tmp/store',
+        messenger: messenger,
+      );
+      await store!.putConversation(conversation);
+      await store.putMessage(conversation.id, message);
+
+      final summaries = await store.list();
+      expect(summaries, hasLength(1));
+      final listed = summaries.single.conversation;
+      expect(summaries.single.messageCount, 3);
+      expect(listed.id, conversation.id);
+      expect(listed.title, conversation.title);
+      expect(listed.model, conversation.model);
+      expect(listed.createdAt, conversation.createdAt);
+      expect(listed.updatedAt, conversation.updatedAt);
+      expect(listed.messages.single.content, message.content);
+    });
+
+    test('loads messages field for field', () async {
+      final messenger = _EchoStoreMessenger();
+      final store = await NativeConversationStore.open(
+        '/tmp/store',
+        messenger: messenger,
+      );
+      await store!.putMessage(conversation.id, message);
+
+      final loaded = (await store.loadMessages(conversation.id)).single;
+      expect(loaded.id, message.id);
+      expect(loaded.content, message.content);
+      expect(loaded.role, message.role);
+      expect(loaded.status, message.status);
+      expect(loaded.model, message.model);
+      expect(loaded.error, message.error);
+      expect(loaded.timestamp, message.timestamp);
+    });
+
+    test('sends appended text as raw UTF-8 after the ids', () async {
+      final messenger = _EchoStoreMessenger();
+      final store = await NativeConversationStore.open(
+        '/tmp/store',
+        messenger: messenger,
+      );
+      await store!.appendToMessage('c', 'm', 'é');
+      expect(messenger.lastRequest, [
+        7,
+        ..._u32(1),
+        ...utf8.encode('c'),
+        ..._u32(1),
+        ...utf8.encode('m'),
+        ...utf8.encode('é'),
+      ]);
+    });
+
+    test('reads search hits with their scores', () async {
+      final messenger = _EchoStoreMessenger();
+      final store = await NativeConversationStore.open(
+        '/tmp/store',
+        messenger: messenger,
+      );
+      final hits = await store!.search('"brown fox"', limit: 7);
+      expect(hits, hasLength(1));
+      expect(hits.single.conversationId, 'conv_1');
+      expect(hits.single.messageId, '"brown fox"');
+      expect(hits.single.score, 1.5);
+      final request = messenger.lastRequest!;
+      expect(request.sublist(request.length - 4), _u32(7));
+    });
+
+    test('is unavailable when the runner rejects open', () async {
+      final store = await NativeConversationStore.open(
+        '/tmp/store',
+        messenger: _EchoStoreMessenger(available: false),
+      );
+      expect(store, isNull);
+    });
+  });
+}
@@ -0,0 +1,325 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:cloudtolocalllm/models/markdown_block.dart';
+import 'package:cloudtolocalllm/services/native_http_client.dart';
+
+/// Binary messenger with no handlers registered, as on web and mobile.
+class _UnregisteredMessenger implements BinaryMessenger {
+  @override
+  Future<ByteData?> send(String channel, ByteData? message) async => null;
+
+  @override
+  void setMessageHandler(String channel, MessageHandler? handler) {}
+
+  @override
+  dynamic noSuchMethod(Invocation invocation) => super.noSuchMethod(invocation);
+}
+
+/// Stands in for the runner: acknowledges every request and answers a start,
+/// an embedding job or a pull with a canned sequence of events.
+class _FakeRunnerMessenger implements BinaryMessenger {
+  final List<Uint8List> Function(int id) eventsFor;
+  final List<Uint8List> sent = [];
+  MessageHandler? _eventHandler;
+
+  _FakeRunnerMessenger(this.eventsFor);
+
+  @override
+  Future<ByteData?> send(String channel, ByteData? message) async {
+    final op = message!.getUint8(0);
+    final id = message.getUint64(1, Endian.little);
+    sent.add(
+      Uint8List.fromList(
+        message.buffer.asUint8List(
+          message.offsetInBytes,
+          message.lengthInBytes,
+        ),
+      ),
+    );
+    if (op == 1 || op == 7 || op == 8) {
+      Future(() async {
+        for (final event in eventsFor(id)) {
+          await _eventHandler!(ByteData.view(event.buffer));
+        }
+      });
+    }
+    return ByteData(1);
+  }
+
+  @override
+  void setMessageHandler(String channel, MessageHandler? handler) {
+    _eventHandler = handler;
+  }
+
+  @override
+  dynamic noSuchMethod(Invocation invocation) => super.noSuchMethod(invocation);
+}
+
+Uint8List _event(int type, int id, [List<int> payload = const []]) {
+  final builder = BytesBuilder()
+    ..addByte(type)
+    ..add(Uint8List(8)..buffer.asByteData().setUint64(0, id, Endian.little))
+    ..add(payload);
+  return builder.toBytes();
+}
+
+List<int> _u16(int value) =>
+    Uint8List(2)..buffer.asByteData().setUint16(0, value, Endian.little);
+
+List<int> _string(String value) {
+  final bytes = utf8.encode(value);
+  return [
+    ...Uint8List(4)
+      ..buffer.asByteData().setUint32(0, bytes.length, Endian.little),
+    ...bytes,
+  ];
+}
+
+void main() {
+  test('reports unavailable when the channel is missing', () async {
+    final client = NativeHttpClient.withMessenger(_UnregisteredMessenger());
+
+    expect(await client.isAvailable, isFalse);
+    expect(
+      () => client.send(method: 'GET', url: Uri.parse('http://localhost/')),
+      throwsA(isA<NativeHttpException>()),
+    );
+  });
+
+  test('delivers headers, token batches and completion', () async {
+    final client = NativeHttpClient.withMessenger(
+      _FakeRunnerMessenger(
+        (id) => [
+          _event(1, id, [
+            ..._u16(200),
+            ..._u16(1),
+            ..._string('content-type'),
+            ..._string('application/x-ndjson'),
+          ]),
+          _event(3, id, [1, ..._u32(2), ..._string('Hello')]),
+          _event(4, id),
+        ],
+      ),
+    );
+
+    final response = await client.send(
+      method: 'POST',
+      url: Uri.parse('http://localhost:11434/api/chat'),
+      parseNdjson: true,
+    );
+    final batches = await response.tokens.toList();
+
+    expect(response.statusCode, 200);
+    expect(response.headers['content-type'], 'application/x-ndjson');
+    expect(batches.single.text, 'Hello');
+    expect(batches.single.tokenCount, 2);
+    expect(batches.single.done, isTrue);
+    expect(await response.body.isEmpty, isTrue);
+  });
+
+  test('attaches native markdown blocks to the batch after them', () async {
+    const text = '```js\nx = 1;';
+    final client = NativeHttpClient.withMessenger(
+      _FakeRunnerMessenger(
+        (id) => [
+          _event(1, id, [..._u16(200), ..._u16(0)]),
+          _event(10, id, [
+            ..._u32(0),
+            ..._u32(1),
+            2,
+            0,
+            ..._u32(0),
+            ..._u32(12),
+            ..._u32(3),
+            ..._u32(5),
+            ..._u32(6),
+            ..._u32(12),
+          ]),
+          _event(3, id, [0, ..._u32(4), ..._string(text)]),
+          _event(3, id, [1, ..._u32(0), ..._string('')]),
+          _event(4, id),
+        ],
+      ),
+    );
+
+    final response = await client.send(
+      method: 'POST',
+      url: Uri.parse('http://localhost:11434/api/chat'),
+      parseNdjson: true,
+      lexMarkdown: true,
+    );
+    final batches = await response.tokens.toList();
+
+    final update = batches.first.blocks!;
+    expect(update.first, 0);
+    expect(update.blocks.single.kind, MarkdownBlockKind.code);
+    expect(update.blocks.single.closed, isFalse);
+    expect(update.blocks.single.language(text), 'js');
+    expect(update.blocks.single.body(text), 'x = 1;');
+    expect(batches.last.blocks, isNull);
+  });
+
+  test('relays a binary request body byte for byte', () async {
+    final messenger = _FakeRunnerMessenger((id) => const []);
+    final client = NativeHttpClient.withMessenger(messenger);
+    final body = [0x89, 0x50, 0x4e, 0x47, 0x00, 0xff, 0xfe, 0x80];
+
+    await client.relayToTunnel(
+      tunnelStream: 1,
+      correlationId: 'req-1',
+      method: 'POST',
+      url: Uri.parse('http://localhost:11434/api/blobs/sha256:abcd'),
+      headers: {'content-type': 'application/octet-stream'},
+      body: body,
+    );
+
+    final start = ByteData.sublistView(
+      messenger.sent.singleWhere((message) => message[0] == 1),
+    );
+    var offset = 9;
+    int u32() {
+      final value = start.getUint32(offset, Endian.little);
+      offset += 4;
+      return value;
+    }
+
+    void skipString() => offset += u32();
+    skipString(); // method
+    skipString(); // host
+    offset += 2; // port
+    skipString(); // path
+    final headerCount = start.getUint16(offset, Endian.little);
+    offset += 2;
+    for (var i = 0; i < headerCount * 2; i++) {
+      skipString();
+    }
+    offset += 1; // flags
+    final length = u32();
+    expect(
+      start.buffer.asUint8List(start.offsetInBytes + offset, length),
+      body,
+    );
+  });
+
+  test('surfaces native errors before the response starts', () async {
+    final client = NativeHttpClient.withMessenger(
+      _FakeRunnerMessenger((id) => [_event(5, id, _string('refused'))]),
+    );
+
+    expect(
+      client.send(method: 'GET', url: Uri.parse('http://localhost:1/')),
+      throwsA(
+        isA<NativeHttpException>().having(
+          (e) => e.message,
+          'message',
+          'refused',
+        ),
+      ),
+    );
+  });
+
+  test('views batched embeddings in place', () async {
+    final vectors = Float32List.fromList([1, 2, 3, 4, 5, 6]);
+    final client = NativeHttpClient.withMessenger(
+      _FakeRunnerMessenger(
+        (id) => [
+          _event(7, id, [..._u32(2), ..._u32(3)]),
+          _event(8, id, [
+            ..._u32(3),
+            ..._u32(2),
+            0,
+            0,
+            0,
+            ...vectors.buffer.asUint8List(),
+            ..._u32(0),
+            ..._u64(0),
+            ..._u32(100),
+            ..._u32(1),
+            ..._u64(80),
+            ..._u32(40),
+          ]),
+          _event(4, id),
+        ],
+      ),
+    );
+
+    final job = await client.embedFiles(
+      model: 'nomic-embed-text',
+      paths: ['a.md', 'b.md'],
+    );
+    final progress = job.progress.toList();
+    final embeddings = await job.result;
+
+    expect(embeddings.dimensions, 3);
+    expect(embeddings.vectorAt(1), [4, 5, 6]);
+    expect(embeddings.chunks.last.file, 1);
+    expect(embeddings.chunks.last.offset, 80);
+    expect(embeddings.chunks.last.length, 40);
+    expect((await progress).single.chunked, 3);
+  });
+
+  test('reports natively coalesced pull progress', () async {
+    final client = NativeHttpClient.withMessenger(
+      _FakeRunnerMessenger(
+        (id) => [
+          _event(9, id, [
+            ..._u64(400),
+            ..._u64(1600),
+            ..._u64(2048),
+            ..._string('pulling 6a0746a1ec1a'),
+          ]),
+          _event(9, id, [
+            ..._u64(1600),
+            ..._u64(1600),
+            ..._u64(0),
+            ..._string('success'),
+          ]),
+          _event(4, id),
+        ],
+      ),
+    );
+
+    final job = await client.pullModel('llama3.2');
+    final progress = job.progress.toList();
+    await job.done;
+    final reports = await progress;
+
+    expect(reports.first.fraction, 0.25);
+    expect(reports.first.bytesPerSecond, 2048);
+    expect(reports.first.status, 'pulling 6a0746a1ec1a');
+    expect(reports.last.status, 'success');
+  });
+
+  test('schedules chats ahead of model transfers', () {
+    expect(
+      TunnelStreamPriority.forPath('/api/chat'),
+      TunnelStreamPriority.interactive,
+    );
+    expect(
+      TunnelStreamPriority.forPath('/api/tags?verbose=1'),
+      TunnelStreamPriority.interactive,
+    );
+    expect(
+      TunnelStreamPriority.forPath('/api/embed'),
+      TunnelStreamPriority.normal,
+    );
+    expect(
+      TunnelStreamPriority.forPath('/api/pull'),
+      TunnelStreamPriority.bulk,
+    );
+    expect(
+      TunnelStreamPriority.forPath('/api/blobs/sha256:abcd'),
+      TunnelStreamPriority.bulk,
+    );
+  });
+}
+
+List<int> _u32(int value) =>
+    Uint8List(4)..buffer.asByteData().setUint32(0, value, Endian.little);
+
+List<int> _u64(int value) =>
+    Uint8List(8)..buffer.asByteData().setUint64(0, value, Endian.little);
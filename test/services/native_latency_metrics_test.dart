@@ -0,0 +1,114 @@
+import 'dart:typed_data';
+
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:cloudtolocalllm/services/native_latency_metrics.dart';
+
+/// Stands in for the runner: one local time-to-first-token histogram whose
+/// bucket 300 grows by however many values were recorded natively.
+class _MetricsMessenger implements BinaryMessenger {
+  final List<List<int>> recorded = [];
+  int bucketCount = 5;
+
+  @override
+  Future<ByteData?> send(String channel, ByteData? message) async {
+    final op = message!.getUint8(0);
+    switch (op) {
+      case 1:
+        return ByteData(43)
+          ..setUint8(0, 1)
+          ..setUint8(1, 0)
+          ..setUint8(2, 0)
+          ..setUint64(3, 12, Endian.little)
+          ..setUint64(11, 180000, Endian.little)
+          ..setUint64(19, 300000, Endian.little)
+          ..setUint64(27, 420000, Endian.little)
+          ..setUint64(35, 500000, Endian.little);
+      case 2:
+        return ByteData(15)
+          ..setUint8(0, 1)
+          ..setUint8(1, 0)
+          ..setUint8(2, 0)
+          ..setUint16(3, 1, Endian.little)
+          ..setUint16(5, 300, Endian.little)
+          ..setUint64(7, bucketCount, Endian.little);
+      case 4:
+        return ByteData(16)
+          ..setUint64(0, 200, Endian.little)
+          ..setUint64(8, 30, Endian.little);
+      default:
+        final count = message.getUint32(3, Endian.little);
+        recorded.add([
+          message.getUint8(1),
+          message.getUint8(2),
+          for (var i = 0; i < count; i++)
+            message.getUint32(7 + 4 * i, Endian.little),
+        ]);
+        return ByteData(1)..setUint8(0, 1);
+    }
+  }
+
+  @override
+  dynamic noSuchMethod(Invocation invocation) => super.noSuchMethod(invocation);
+}
+
+void main() {
+  group('NativeLatencyMetrics', () {
+    test('decodes histogram summaries', () async {
+      final metrics = NativeLatencyMetrics(messenger: _MetricsMessenger());
+
+      final summaries = await metrics.summaries();
+      expect(summaries, hasLength(1));
+      expect(summaries[0].name, 'local.ttft');
+      expect(summaries[0].count, 12);
+      expect(summaries[0].p50, const Duration(milliseconds: 180));
+      expect(summaries[0].p99, const Duration(milliseconds: 420));
+    });
+
+    test('reports only bucket counts added since the last report', () async {
+      final messenger = _MetricsMessenger();
+      final metrics = NativeLatencyMetrics(messenger: messenger);
+
+      expect(await metrics.bucketDeltas(), {
+        'local.ttft': [
+          [300, 5],
+        ],
+      });
+      expect(await metrics.bucketDeltas(), isEmpty);
+      messenger.bucketCount = 7;
+      expect(await metrics.bucketDeltas(), {
+        'local.ttft': [
+          [300, 2],
+        ],
+      });
+    });
+
+    test('decodes request allocation counts', () async {
+      final metrics = NativeLatencyMetrics(messenger: _MetricsMessenger());
+
+      final allocations = await metrics.allocations();
+      expect(allocations!.requests, 200);
+      expect(allocations.allocations, 30);
+      expect(allocations.perRequest, closeTo(0.15, 1e-9));
+    });
+
+    test('records a timed stream when it finishes', () async {
+      final messenger = _MetricsMessenger();
+      final metrics = NativeLatencyMetrics(messenger: messenger);
+
+      final timer = metrics.startStream(LatencyPath.cloud);
+      timer
+        ..token()
+        ..token()
+        ..token();
+      await timer.finish();
+
+      expect(messenger.recorded, hasLength(2));
+      expect(messenger.recorded[0].sublist(0, 2), [2, 0]);
+      expect(messenger.recorded[0], hasLength(3));
+      expect(messenger.recorded[1].sublist(0, 2), [2, 1]);
+      expect(messenger.recorded[1], hasLength(4));
+    });
+  });
+}
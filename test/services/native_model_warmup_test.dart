@@ -0,0 +1,115 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:cloudtolocalllm/services/native_model_warmup.dart';
+
+/// Stands in for the runner: remembers the model it was given, starts the
+/// first warm-up and turns the rest away as in flight.
+class _WarmupMessenger implements BinaryMessenger {
+  String? host;
+  int? port;
+  String? model;
+  int? sizeBytes;
+  final List<int> triggers = [];
+
+  @override
+  Future<ByteData?> send(String channel, ByteData? message) async {
+    final request = ByteData.sublistView(message!);
+    var offset = 1;
+    String string() {
+      final length = request.getUint32(offset, Endian.little);
+      final value = utf8.decode(
+        Uint8List.sublistView(request, offset + 4, offset + 4 + length),
+      );
+      offset += 4 + length;
+      return value;
+    }
+
+    switch (request.getUint8(0)) {
+      case 1:
+        host = string();
+        port = request.getUint16(offset, Endian.little);
+        offset += 2;
+        model = string();
+        sizeBytes = request.getUint64(offset, Endian.little);
+        return ByteData(1)..setUint8(0, 1);
+      case 2:
+        triggers.add(request.getUint8(1));
+        if (model == null) return ByteData(1)..setUint8(0, 1);
+        return ByteData(1)..setUint8(0, triggers.length == 1 ? 0 : 2);
+      case 3:
+        final reply = ByteData(48);
+        for (var i = 0; i < 6; i++) {
+          reply.setUint64(i * 8, i + 1, Endian.little);
+        }
+        reply.setUint64(40, 2500000, Endian.little);
+        return reply;
+    }
+    return ByteData(0);
+  }
+
+  @override
+  dynamic noSuchMethod(Invocation invocation) => super.noSuchMethod(invocation);
+}
+
+void main() {
+  group('NativeModelWarmup', () {
+    test('names the model and its size to the runner', () async {
+      final messenger = _WarmupMessenger();
+      final warmup = NativeModelWarmup(messenger: messenger);
+
+      expect(await warmup.setModel('llama3.2:1b', sizeBytes: 1 << 30), isTrue);
+      expect(messenger.host, 'localhost');
+      expect(messenger.port, 11434);
+      expect(messenger.model, 'llama3.2:1b');
+      expect(messenger.sizeBytes, 1 << 30);
+
+      await warmup.setModel('qwen', host: '10.0.0.2', port: 8080);
+      expect(messenger.host, '10.0.0.2');
+      expect(messenger.port, 8080);
+      expect(messenger.sizeBytes, 0);
+    });
+
+    test('decodes warm-up results', () async {
+      final messenger = _WarmupMessenger();
+      final warmup = NativeModelWarmup(messenger: messenger);
+
+      expect(await warmup.warm(WarmupTrigger.launch), WarmupResult.noModel);
+      await warmup.setModel('llama3.2:1b');
+      messenger.triggers.clear();
+      expect(await warmup.warm(WarmupTrigger.select), WarmupResult.started);
+      expect(await warmup.warm(WarmupTrigger.tray), WarmupResult.inFlight);
+      expect(messenger.triggers, [3, 2]);
+    });
+
+    test('decodes the counters', () async {
+      final warmup = NativeModelWarmup(messenger: _WarmupMessenger());
+
+      final stats = (await warmup.stats())!;
+      expect(stats.started, 1);
+      expect(stats.completed, 2);
+      expect(stats.failed, 3);
+      expect(stats.skippedNoRoom, 4);
+      expect(stats.skippedCoolingDown, 5);
+      expect(stats.saved, const Duration(milliseconds: 2500));
+    });
+
+    test('does nothing without a runner', () async {
+      final warmup = NativeModelWarmup(messenger: _NoRunnerMessenger());
+
+      expect(await warmup.warm(WarmupTrigger.focus), isNull);
+      expect(await warmup.stats(), isNull);
+    });
+  });
+}
+
+class _NoRunnerMessenger implements BinaryMessenger {
+  @override
+  Future<ByteData?> send(String channel, ByteData? message) async => null;
+
+  @override
+  dynamic noSuchMethod(Invocation invocation) => super.noSuchMethod(invocation);
+}
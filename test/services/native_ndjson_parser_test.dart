@@ -0,0 +1,96 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:cloudtolocalllm/models/ollama_token_batch.dart';
+import 'package:cloudtolocalllm/services/native_ndjson_parser.dart';
+
+/// Binary messenger with no handlers registered, as on web and mobile.
+class _UnregisteredMessenger implements BinaryMessenger {
+  @override
+  Future<ByteData?> send(String channel, ByteData? message) async => null;
+
+  @override
+  dynamic noSuchMethod(Invocation invocation) => super.noSuchMethod(invocation);
+}
+
+Stream<List<int>> _chunked(String body, int size) async* {
+  final bytes = utf8.encode(body);
+  for (var i = 0; i < bytes.length; i += size) {
+    yield bytes.sublist(i, i + size > bytes.length ? bytes.length : i + size);
+  }
+}
+
+void main() {
+  group('OllamaTokenBatch.decode', () {
+    test('decodes text, counters and done flag', () {
+      final text = utf8.encode('Hello é');
+      final builder = BytesBuilder()
+        ..addByte(1 | 4) // done | hasStats
+        ..add(_u32(2))
+        ..add(_u32(text.length))
+        ..add(text);
+      for (final value in [2000000, 0, 12, 1000000, 40, 1000000000]) {
+        builder.add(_i64(value));
+      }
+
+      final batch = OllamaTokenBatch.decode(
+        ByteData.view(builder.toBytes().buffer),
+      );
+
+      expect(batch.text, 'Hello é');
+      expect(batch.tokenCount, 2);
+      expect(batch.done, isTrue);
+      expect(batch.error, isNull);
+      expect(batch.stats!.promptEvalCount, 12);
+      expect(batch.stats!.evalCount, 40);
+      expect(batch.stats!.tokensPerSecond, closeTo(40, 0.001));
+    });
+
+    test('decodes error message', () {
+      final error = utf8.encode('model not found');
+      final builder = BytesBuilder()
+        ..addByte(2)
+        ..add(_u32(0))
+        ..add(_u32(0))
+        ..add(_u32(error.length))
+        ..add(error);
+
+      final batch = OllamaTokenBatch.decode(
+        ByteData.view(builder.toBytes().buffer),
+      );
+
+      expect(batch.error, 'model not found');
+      expect(batch.isEmpty, isFalse);
+    });
+  });
+
+  group('NativeNdjsonParser', () {
+    const stream =
+        '{"message":{"role":"assistant","content":"Hel"},"done":false}\n'
+        '\n'
+        '{"message":{"role":"assistant","content":"lo"},"done":false}\n'
+        'not json\n'
+        '{"done":true,"eval_count":2,"eval_duration":1000000}\n'
+        '{"message":{"content":"ignored after done"}}\n';
+
+    test('falls back to Dart parsing when the channel is missing', () async {
+      final parser = NativeNdjsonParser(messenger: _UnregisteredMessenger());
+
+      final batches = await parser.parse(_chunked(stream, 7)).toList();
+
+      expect(parser.isNativeAvailable, isFalse);
+      expect(batches.map((b) => b.text).join(), 'Hello');
+      expect(batches.last.done, isTrue);
+      expect(batches.last.stats!.evalCount, 2);
+    });
+  });
+}
+
+Uint8List _u32(int value) =>
+    Uint8List(4)..buffer.asByteData().setUint32(0, value, Endian.little);
+
+Uint8List _i64(int value) =>
+    Uint8List(8)..buffer.asByteData().setInt64(0, value, Endian.little);
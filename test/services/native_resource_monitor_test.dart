@@ -0,0 +1,86 @@
+import 'dart:typed_data';
+
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:cloudtolocalllm/services/native_resource_monitor.dart';
+
+/// Stands in for the runner: each kLatest reply is a new sample with the
+/// given CPU load and an NVML GPU that is half full.
+class _SamplerMessenger implements BinaryMessenger {
+  double cpuLoad = 0.1;
+  int timestamp = 1000;
+
+  ByteData sample() {
+    final data = ByteData(ResourceSnapshot.encodedSize)
+      ..setInt64(0, timestamp++, Endian.little)
+      ..setUint16(8, (cpuLoad * 10000).round(), Endian.little)
+      ..setUint16(10, 0xFFFF, Endian.little)
+      ..setUint64(12, 300 << 20, Endian.little)
+      ..setUint64(20, 16 << 30, Endian.little)
+      ..setUint64(28, 8 << 30, Endian.little)
+      ..setUint64(36, 8 << 30, Endian.little)
+      ..setUint64(44, 4 << 30, Endian.little)
+      ..setUint8(52, 1);
+    return data;
+  }
+
+  @override
+  Future<ByteData?> send(String channel, ByteData? message) async {
+    final op = message!.getUint8(0);
+    if (op == 1) return sample();
+    if (op == 2) {
+      final reply = ByteData(4 + 2 * ResourceSnapshot.encodedSize)
+        ..setUint32(0, 2, Endian.little);
+      for (var i = 0; i < 2; i++) {
+        final bytes = sample().buffer.asUint8List();
+        reply.buffer.asUint8List().setAll(
+          4 + i * ResourceSnapshot.encodedSize,
+          bytes,
+        );
+      }
+      return reply;
+    }
+    return ByteData(1)..setUint8(0, 1);
+  }
+
+  @override
+  dynamic noSuchMethod(Invocation invocation) => super.noSuchMethod(invocation);
+}
+
+void main() {
+  group('NativeResourceMonitor', () {
+    test('decodes samples from the runner', () async {
+      final monitor = NativeResourceMonitor(messenger: _SamplerMessenger());
+
+      final snapshot = (await monitor.refresh())!;
+      expect(snapshot.cpuLoad, closeTo(0.1, 1e-4));
+      expect(snapshot.gpuLoad, isNull);
+      expect(snapshot.processRss, 300 << 20);
+      expect(snapshot.memoryAvailable, 8 << 30);
+      expect(snapshot.gpuSource, GpuSource.nvml);
+      expect(snapshot.gpuMemoryFree, 4 << 30);
+      expect(snapshot.saturated, isFalse);
+
+      final history = await monitor.history(10);
+      expect(history, hasLength(2));
+      expect(history[0].timestamp.isBefore(history[1].timestamp), isTrue);
+    });
+
+    test('reports a constrained host only after sustained load', () async {
+      final messenger = _SamplerMessenger();
+      final monitor = NativeResourceMonitor(messenger: messenger);
+
+      messenger.cpuLoad = 0.97;
+      await monitor.refresh();
+      await monitor.refresh();
+      expect(monitor.hostConstrained, isFalse);
+      await monitor.refresh();
+      expect(monitor.hostConstrained, isTrue);
+
+      messenger.cpuLoad = 0.2;
+      await monitor.refresh();
+      expect(monitor.hostConstrained, isFalse);
+    });
+  });
+}
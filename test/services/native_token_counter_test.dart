@@ -0,0 +1,149 @@
+import 'dart:convert';
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:cloudtolocalllm/services/native_token_counter.dart';
+
+/// Stands in for the runner: loads anything with the given context length
+/// and counts one token per word.
+class _WordCountMessenger implements BinaryMessenger {
+  final int contextLength;
+  final List<int> ops = [];
+
+  _WordCountMessenger(this.contextLength);
+
+  @override
+  Future<ByteData?> send(String channel, ByteData? message) async {
+    final request = ByteData.sublistView(message!);
+    final op = request.getUint8(0);
+    ops.add(op);
+    var offset = 1;
+    String string() {
+      final length = request.getUint32(offset, Endian.little);
+      final value = utf8.decode(
+        Uint8List.sublistView(request, offset + 4, offset + 4 + length),
+      );
+      offset += 4 + length;
+      return value;
+    }
+
+    string(); // model
+    if (op == 1) {
+      return ByteData(8)..setUint64(0, contextLength, Endian.little);
+    }
+    final count = request.getUint32(offset, Endian.little);
+    offset += 4;
+    final reply = ByteData(4 + 4 * count)
+      ..setUint32(0, count, Endian.little);
+    for (var i = 0; i < count; i++) {
+      final words = string().split(' ').where((w) => w.isNotEmpty).length;
+      reply.setUint32(4 + 4 * i, words, Endian.little);
+    }
+    return reply;
+  }
+
+  @override
+  dynamic noSuchMethod(Invocation invocation) => super.noSuchMethod(invocation);
+}
+
+void main() {
+  late Directory models;
+
+  setUp(() async {
+    models = await Directory.systemTemp.createTemp('ollama_models');
+    final manifest = File(
+      '${models.path}/manifests/registry.ollama.ai/library/llama3/8b',
+    );
+    await manifest.create(recursive: true);
+    await manifest.writeAsString(
+      json.encode({
+        'layers': [
+          {
+            'mediaType': 'application/vnd.ollama.image.template',
+            'digest': 'sha256:0001',
+          },
+          {
+            'mediaType': 'application/vnd.ollama.image.model',
+            'digest': 'sha256:abcd',
+          },
+        ],
+      }),
+    );
+  });
+
+  tearDown(() => models.delete(recursive: true));
+
+  group('NativeTokenCounter', () {
+    test('finds the model layer from the manifest', () async {
+      expect(
+        await NativeTokenCounter.findModelFile('llama3:8b', [models.path]),
+        '${models.path}/blobs/sha256-abcd',
+      );
+      expect(
+        await NativeTokenCounter.findModelFile('llama3', [models.path]),
+        isNull,
+      );
+    });
+
+    test('keeps the newest messages that fit', () async {
+      final messenger = _WordCountMessenger(64);
+      final counter = NativeTokenCounter(
+        messenger: messenger,
+        modelsDirectory: models.path,
+      );
+      final history = [
+        for (var i = 0; i < 6; i++)
+          {'role': 'user', 'content': List.filled(10, 'word$i').join(' ')},
+      ];
+
+      // 64 - 16 for the reply - (2 + 4) for the prompt leaves room for three
+      // messages of 10 + 4.
+      final fitted = await counter.fitHistory(
+        model: 'llama3:8b',
+        history: history,
+        prompt: 'two words',
+        responseTokens: 16,
+      );
+      expect(fitted, history.sublist(3));
+      expect(messenger.ops, [1, 2]);
+    });
+
+    test('keeps the start stable across turns of a conversation', () async {
+      final counter = NativeTokenCounter(
+        messenger: _WordCountMessenger(64),
+        modelsDirectory: models.path,
+      );
+      final history = [
+        for (var i = 0; i < 8; i++)
+          {'role': 'user', 'content': List.filled(10, 'word$i').join(' ')},
+      ];
+      Future<List<Map<String, String>>> fit(int length) => counter.fitHistory(
+        model: 'llama3:8b',
+        history: history.sublist(0, length),
+        prompt: 'two words',
+        conversationId: 'c',
+        responseTokens: 16,
+      );
+
+      // Over the room of three messages, only half of it is filled...
+      expect(await fit(4), history.sublist(3, 4));
+      // ...so the next two turns append to the same start.
+      expect(await fit(5), history.sublist(3, 5));
+      expect(await fit(6), history.sublist(3, 6));
+      expect(await fit(7), history.sublist(6, 7));
+    });
+
+    test('estimates when the model has no local file', () async {
+      final messenger = _WordCountMessenger(64);
+      final counter = NativeTokenCounter(
+        messenger: messenger,
+        modelsDirectory: models.path,
+      );
+      expect(await counter.count('mistral', ['12345678', '']), [2, 0]);
+      expect(messenger.ops, isEmpty);
+    });
+  });
+}
@@ -0,0 +1,79 @@
+import 'dart:convert';
+
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:cloudtolocalllm/models/ollama_token_batch.dart';
+import 'package:cloudtolocalllm/services/ollama_chat_session.dart';
+
+void main() {
+  group('OllamaChatSessions', () {
+    test('extends the previous turn and pins the model', () {
+      final sessions = OllamaChatSessions(
+        keepAlive: const Duration(minutes: 10),
+      );
+      final first = sessions.buildRequest(
+        conversationId: 'c',
+        model: 'llama3',
+        history: [
+          {'role': 'user', 'content': 'hi'},
+        ],
+        prompt: 'hi',
+      );
+      sessions.recordReply(
+        'c',
+        'hello',
+        doneStats: const OllamaDoneStats(promptEvalCount: 12),
+      );
+      final second = sessions.buildRequest(
+        conversationId: 'c',
+        model: 'llama3',
+        history: [
+          {'role': 'user', 'content': 'hi'},
+          {'role': 'assistant', 'content': 'hello'},
+          {'role': 'user', 'content': 'more'},
+        ],
+        prompt: 'more',
+      );
+
+      final firstMessages = (json.decode(first) as Map)['messages'] as List;
+      final body = json.decode(second) as Map<String, dynamic>;
+      expect(firstMessages, hasLength(1));
+      expect(body['keep_alive'], '600s');
+      expect(body['messages'], hasLength(3));
+      expect(body.containsKey('options'), isFalse);
+      // Everything before the messages is the same on every turn.
+      expect(
+        second.substring(0, second.indexOf('"messages"')),
+        first.substring(0, first.indexOf('"messages"')),
+      );
+
+      final stats = sessions.statsFor('c')!;
+      expect(stats.turns, 2);
+      expect(stats.prefixHits, 1);
+      expect(stats.promptEvalTokens, 12);
+      expect(stats.reuseRatio, greaterThan(0));
+    });
+
+    test('expects a miss after another conversation used the model', () {
+      final sessions = OllamaChatSessions();
+      void turn(String conversationId, List<Map<String, String>> history) {
+        sessions.buildRequest(
+          conversationId: conversationId,
+          model: 'llama3',
+          history: history,
+          prompt: 'q',
+        );
+        sessions.recordReply(conversationId, 'a');
+      }
+
+      turn('a', const []);
+      turn('b', const []);
+      turn('a', const [
+        {'role': 'user', 'content': 'q'},
+        {'role': 'assistant', 'content': 'a'},
+      ]);
+      expect(sessions.statsFor('a')!.prefixHits, 0);
+      expect(sessions.stats.turns, 3);
+    });
+  });
+}
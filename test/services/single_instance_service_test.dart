@@ -0,0 +1,49 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:cloudtolocalllm/services/single_instance_service.dart';
+
+ByteData _encode(String workingDirectory, List<String> arguments) {
+  final builder = BytesBuilder();
+  void u32(int value) =>
+      builder.add((ByteData(4)..setUint32(0, value, Endian.little))
+          .buffer
+          .asUint8List());
+  void string(String value) {
+    final bytes = utf8.encode(value);
+    u32(bytes.length);
+    builder.add(bytes);
+  }
+
+  string(workingDirectory);
+  u32(arguments.length);
+  arguments.forEach(string);
+  return ByteData.sublistView(builder.toBytes());
+}
+
+void main() {
+  group('ForwardedLaunch', () {
+    test('decodes the runner encoding', () {
+      final launch = ForwardedLaunch.decode(
+        _encode('/home/user', ['--minimized', 'é b', '']),
+      );
+
+      expect(launch, isNotNull);
+      expect(launch!.workingDirectory, '/home/user');
+      expect(launch.arguments, ['--minimized', 'é b', '']);
+    });
+
+    test('rejects truncated messages', () {
+      final full = Uint8List.sublistView(_encode('/tmp', ['--a']));
+      for (var length = 0; length < full.length; length++) {
+        expect(
+          ForwardedLaunch.decode(ByteData.sublistView(full, 0, length)),
+          isNull,
+          reason: 'length $length',
+        );
+      }
+    });
+  });
+}
@@ -0,0 +1,224 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:cloudtolocalllm/services/encrypted_tunnel_protocol.dart';
+import 'package:cloudtolocalllm/services/tunnel_frame_codec.dart';
+
+Uint8List _key() => Uint8List.fromList(List.generate(32, (i) => i));
+
+Uint8List _hex(String hex) => Uint8List.fromList([
+  for (var i = 0; i < hex.length; i += 2)
+    int.parse(hex.substring(i, i + 2), radix: 16),
+]);
+
+// httpRequest sealed by api-backend/tunnel-frame.js with key 00..1f,
+// session id 'session-1', cloud-to-desktop, sequence 0.
+const String _cloudFrame =
+    '0101000971000000c8abae3c0000000001000000000000000000000073657373696f6e2d'
+    '31913f7beeb686ed07465fd3f36d6f920875b1f0d82dd6b84dfc6f943176d517cd61ae3f'
+    '4932f54e183a1389d202b64d7f2e6b18f5853f345417995a536234b62a39378ade7c7c3e'
+    '23a848ff0222e6188b7fc5dc2d72259cbc6c89102850d1b0b23beb78dc8bb6ceb9b0886f'
+    '9e48363bcc26';
+
+// As above, but compressed ('lz4-dict-v1', flags 1): req-2, corr-2, with a
+// chat request body.
+const String _compressedCloudFrame =
+    '010101096f000000b63dde0e0100000001000000000000000000000073657373696f6e2d'
+    '31303f7bee35ff992a775ba1961c12ef5f21b8f08862aa8d349540f77676d178e202c63d'
+    '5246876329587cf7a02f842f104c137d9ab912412e66b45a536234325a49bae3a21cd957'
+    '45c5c495717b8a1c555da5ac4a3e01d7a74db5083b48d5fed8c822aefc9ee887c31aa88e'
+    '054dca2d';
+
+void main() {
+  group('TunnelPayloadCodec', () {
+    test('round-trips an HTTP response with a raw body', () {
+      final body = Uint8List.fromList([0, 1, 2, 255, ...utf8.encode('é')]);
+      final encoded = TunnelPayloadCodec.encode(
+        HttpResponseMessage(
+          id: 'res-1',
+          statusCode: 200,
+          headers: {'content-type': 'application/x-ndjson'},
+          bodyBytes: body,
+          correlationId: 'corr-1',
+        ),
+      );
+
+      final decoded =
+          TunnelPayloadCodec.decode(TunnelMessageType.httpResponse, encoded)
+              as HttpResponseMessage;
+
+      expect(decoded.id, 'res-1');
+      expect(decoded.statusCode, 200);
+      expect(decoded.headers, {'content-type': 'application/x-ndjson'});
+      expect(decoded.bodyBytes, body);
+      expect(decoded.correlationId, 'corr-1');
+    });
+
+    test('distinguishes a missing body from an empty one', () {
+      HttpRequestMessage roundTrip(String? body) =>
+          TunnelPayloadCodec.decode(
+                TunnelMessageType.httpRequest,
+                TunnelPayloadCodec.encode(
+                  HttpRequestMessage(
+                    id: 'req',
+                    method: 'GET',
+                    path: '/api/tags',
+                    headers: const {},
+                    body: body,
+                  ),
+                ),
+              )
+              as HttpRequestMessage;
+
+      expect(roundTrip(null).body, isNull);
+      expect(roundTrip('').body, '');
+      expect(roundTrip(null).correlationId, isNull);
+    });
+
+    test('round-trips a streamed response', () {
+      T roundTrip<T extends TunnelMessage>(T message) =>
+          TunnelPayloadCodec.decode(
+                message.type,
+                TunnelPayloadCodec.encode(message),
+              )
+              as T;
+
+      final start = roundTrip(
+        HttpResponseStartMessage(
+          id: 's',
+          statusCode: 200,
+          headers: const {'content-type': 'application/x-ndjson'},
+          correlationId: 'corr-1',
+        ),
+      );
+      expect(start.statusCode, 200);
+      expect(start.headers, {'content-type': 'application/x-ndjson'});
+      expect(start.correlationId, 'corr-1');
+
+      final body = Uint8List.fromList(List.generate(300, (i) => i & 0xff));
+      final chunk = roundTrip(
+        HttpResponseChunkMessage(id: 'c', correlationId: 'corr-1', body: body),
+      );
+      expect(chunk.body, body);
+
+      final end = roundTrip(
+        HttpResponseEndMessage(id: 'e', correlationId: 'corr-1'),
+      );
+      expect(end.error, isNull);
+      final failed = roundTrip(
+        HttpResponseEndMessage(id: 'e', correlationId: 'corr-1', error: 'x'),
+      );
+      expect(failed.error, 'x');
+
+      final ack = roundTrip(
+        HttpResponseAckMessage(id: 'a', correlationId: 'corr-1', frames: 5),
+      );
+      expect(ack.frames, 5);
+      expect(ack.correlationId, 'corr-1');
+    });
+
+    test('refuses to frame key exchange messages', () {
+      expect(
+        () => TunnelPayloadCodec.encode(
+          KeyExchangeMessage(id: 'k', publicKey: 'p', userId: 'u'),
+        ),
+        throwsArgumentError,
+      );
+    });
+  });
+
+  group('TunnelFrameCodec (Dart fallback)', () {
+    test('opens frames sealed by the cloud side', () async {
+      final codec = await TunnelFrameCodec.open(
+        key: _key(),
+        sessionId: 'session-1',
+        forceDart: true,
+      );
+
+      final message =
+          await codec.open(_hex(_cloudFrame)) as HttpRequestMessage;
+
+      expect(message.id, 'req-1');
+      expect(message.method, 'POST');
+      expect(message.path, '/api/chat');
+      expect(message.correlationId, 'corr-1');
+      expect(message.headers, {'content-type': 'application/json'});
+      expect(message.body, '{"model":"llama3"}');
+    });
+
+    test('opens compressed frames sealed by the cloud side', () async {
+      final codec = await TunnelFrameCodec.open(
+        key: _key(),
+        sessionId: 'session-1',
+        forceDart: true,
+      );
+
+      final message =
+          await codec.open(_hex(_compressedCloudFrame)) as HttpRequestMessage;
+
+      expect(message.id, 'req-2');
+      expect(message.correlationId, 'corr-2');
+      expect(message.headers, {'content-type': 'application/json'});
+      expect(
+        message.body,
+        '{"model":"llama3.2:latest","messages":'
+        '[{"role":"user","content":"Hi"}],"stream":true}',
+      );
+    });
+
+    test('rejects replayed, tampered and reflected frames', () async {
+      final codec = await TunnelFrameCodec.open(
+        key: _key(),
+        sessionId: 'session-1',
+        forceDart: true,
+      );
+      final frame = _hex(_cloudFrame);
+      await codec.open(Uint8List.fromList(frame));
+
+      Future<TunnelFrameStatus> statusOf(Uint8List frame) async {
+        try {
+          await codec.open(frame);
+          return TunnelFrameStatus.ok;
+        } on TunnelFrameException catch (e) {
+          return e.status;
+        }
+      }
+
+      expect(await statusOf(frame), TunnelFrameStatus.replayed);
+
+      final tampered = Uint8List.fromList(frame)..[20] = 1;
+      tampered[frame.length - 1] ^= 1;
+      expect(await statusOf(tampered), TunnelFrameStatus.authenticationFailed);
+
+      final own = await codec.seal(PingMessage(id: 'ping'));
+      expect(await statusOf(own), TunnelFrameStatus.wrongSession);
+    });
+
+    test('seals frames the peer can open', () async {
+      final desktop = await TunnelFrameCodec.open(
+        key: _key(),
+        sessionId: 'abc',
+        forceDart: true,
+      );
+      final cloud = await TunnelFrameCodec.open(
+        key: _key(),
+        sessionId: 'abc',
+        outgoing: TunnelDirection.cloudToDesktop,
+        forceDart: true,
+      );
+
+      for (var i = 0; i < 3; i++) {
+        final frame = await desktop.seal(
+          PongMessage(id: 'pong-$i', pingId: 'ping-$i'),
+        );
+        expect(frame[0], TunnelFrameCodec.frameVersion);
+        expect(frame[1], TunnelPayloadCodec.typeCode(TunnelMessageType.pong));
+
+        final message = await cloud.open(frame) as PongMessage;
+        expect(message.pingId, 'ping-$i');
+      }
+    });
+  });
+}
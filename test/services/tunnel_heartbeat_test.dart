@@ -0,0 +1,64 @@
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:cloudtolocalllm/services/tunnel_heartbeat.dart';
+
+void main() {
+  const minInterval = Duration(milliseconds: 40);
+
+  group('AdaptiveHeartbeat', () {
+    test('sends no pings while the peer is heard from', () async {
+      var pings = 0;
+      final heartbeat = AdaptiveHeartbeat(
+        minInterval: minInterval,
+        maxInterval: minInterval * 8,
+        timeout: minInterval,
+        ping: () => pings++,
+        onDead: () => fail('peer is alive'),
+      )..start();
+
+      for (var i = 0; i < 10; i++) {
+        await Future<void>.delayed(const Duration(milliseconds: 10));
+        heartbeat
+          ..sent()
+          ..received();
+      }
+      heartbeat.stop();
+
+      expect(pings, 0);
+      expect(heartbeat.pingsSkipped, greaterThan(0));
+    });
+
+    test('backs off while idle and the peer answers', () async {
+      late AdaptiveHeartbeat heartbeat;
+      heartbeat = AdaptiveHeartbeat(
+        minInterval: minInterval,
+        maxInterval: minInterval * 4,
+        timeout: minInterval,
+        ping: () => heartbeat.received(),
+        onDead: () => fail('peer answered'),
+      )..start();
+
+      await Future<void>.delayed(minInterval * 10);
+      heartbeat.stop();
+
+      // 40 + 80 + 160 + 160 ms: four pings in 400 ms rather than ten.
+      expect(heartbeat.pingsSent, inInclusiveRange(2, 5));
+      expect(heartbeat.interval, minInterval * 4);
+    });
+
+    test('reports a peer that stops answering', () async {
+      var dead = 0;
+      final heartbeat = AdaptiveHeartbeat(
+        minInterval: minInterval,
+        timeout: minInterval,
+        ping: () {},
+        onDead: () => dead++,
+      )..start();
+
+      await Future<void>.delayed(minInterval * 4);
+
+      expect(dead, 1);
+      expect(heartbeat.isRunning, isFalse);
+    });
+  });
+}
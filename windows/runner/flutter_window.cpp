@@ -1,15 +1,40 @@
 #include "flutter_window.h"
 
+#include <cstring>
 #include <optional>
+#include <vector>
 
-#include "flutter/generated_plugin_registrant.h"
+#include "native/wire_format.h"
 
-FlutterWindow::FlutterWindow(const flutter::DartProject& project)
-    : project_(project) {}
+#include "native/startup_trace.h"
+
+using cloudtolocalllm::ScopedStartupTrace;
+using cloudtolocalllm::StartupTrace;
+
+namespace {
+
+// Receives the launches of later instances; see single_instance.h.
+constexpr char kSingleInstanceChannel[] = "cloudtolocalllm/single_instance";
+
+// Tells Dart the window was hidden (1) or shown again (0); see
+// lib/services/background_mode_service.dart.
+constexpr char kBackgroundModeChannel[] = "cloudtolocalllm/background_mode";
+
+// Replies to any message with the message loop's Stats as `u64 wakeups,
+// f64 wakeups_per_second, u8 efficiency_mode`.
+constexpr char kMessageLoopChannel[] = "cloudtolocalllm/message_loop";
+
+}  // namespace
+
+FlutterWindow::FlutterWindow(const flutter::DartProject& project,
+                             MessageLoop* message_loop,
+                             cloudtolocalllm::TaskExecutor* executor)
+    : project_(project), message_loop_(message_loop), executor_(executor) {}
 
 FlutterWindow::~FlutterWindow() {}
 
 bool FlutterWindow::OnCreate() {
+  ScopedStartupTrace trace("FlutterWindow::OnCreate");
   if (!Win32Window::OnCreate()) {
     return false;
   }
@@ -18,18 +43,48 @@ bool FlutterWindow::OnCreate() {
 
   // The size here must match the window dimensions to avoid unnecessary surface
   // creation / destruction in the startup path.
+  StartupTrace::Get()->Begin("FlutterViewController");
   flutter_controller_ = std::make_unique<flutter::FlutterViewController>(
       frame.right - frame.left, frame.bottom - frame.top, project_);
+  StartupTrace::Get()->End();
   // Ensure that basic setup of the controller was successful.
   if (!flutter_controller_->engine() || !flutter_controller_->view()) {
     return false;
   }
-  RegisterPlugins(flutter_controller_->engine());
+  {
+    ScopedStartupTrace plugins_trace("PluginScheduler");
+    plugin_scheduler_ =
+        std::make_unique<PluginScheduler>(flutter_controller_->engine());
+  }
+  {
+    ScopedStartupTrace plugins_trace("NativePlugins");
+    native_plugins_ = std::make_unique<NativePlugins>(
+        flutter_controller_->engine(), executor_);
+  }
+  flutter_controller_->engine()->messenger()->SetMessageHandler(
+      kMessageLoopChannel,
+      [this](const uint8_t* /*message*/, size_t /*message_size*/,
+             flutter::BinaryReply reply) {
+        const MessageLoop::Stats stats = message_loop_->stats();
+        std::vector<uint8_t> out;
+        cloudtolocalllm::WireWriter writer(&out);
+        writer.WriteU64(stats.wakeups);
+        uint64_t rate_bits;
+        static_assert(sizeof(rate_bits) == sizeof(stats.wakeups_per_second));
+        std::memcpy(&rate_bits, &stats.wakeups_per_second, sizeof(rate_bits));
+        writer.WriteU64(rate_bits);
+        writer.WriteU8(stats.efficiency_mode ? 1 : 0);
+        reply(out.data(), out.size());
+      });
   SetChildContent(flutter_controller_->view()->GetNativeWindow());
 
   flutter_controller_->engine()->SetNextFrameCallback([&]() {
+    StartupTrace::Get()->Instant("first frame");
     this->Show();
+    // The trace is written once the deferred plugins are registered.
+    plugin_scheduler_->OnFirstFrame();
   });
+  StartupTrace::Get()->Instant("SetNextFrameCallback");
 
   // Flutter can complete the first frame before the "show window" callback is
   // registered. The following call ensures a frame is pending to ensure the
@@ -39,7 +94,71 @@ bool FlutterWindow::OnCreate() {
   return true;
 }
 
+void FlutterWindow::OnForwardedLaunch(const std::vector<uint8_t>& launch) {
+  if (!flutter_controller_) {
+    return;
+  }
+  flutter_controller_->engine()->messenger()->Send(
+      kSingleInstanceChannel, launch.data(), launch.size());
+
+  // Brings the window back even if it was hidden to the tray.
+  HWND window = GetHandle();
+  ShowWindow(window, IsIconic(window) ? SW_RESTORE : SW_SHOW);
+  SetForegroundWindow(window);
+}
+
+void FlutterWindow::EnterBackground() {
+  if (in_background_ || !flutter_controller_) {
+    return;
+  }
+  in_background_ = true;
+
+  // The engine sizes its swap chain to the view, so a 1x1 view gives back
+  // the full-size surface; the redraw makes it reallocate now rather than on
+  // the next frame, which a hidden window may never get.
+  MoveWindow(flutter_controller_->view()->GetNativeWindow(), 0, 0, 1, 1,
+             FALSE);
+  flutter_controller_->ForceRedraw();
+  message_loop_->SetEfficiencyMode(true);
+
+  // Once Dart has dropped its image and GPU resource caches, hand the pages
+  // they used back to the OS; they fault back in if the window is shown.
+  const uint8_t entered = 1;
+  flutter_controller_->engine()->messenger()->Send(
+      kBackgroundModeChannel, &entered, sizeof(entered),
+      [](const uint8_t* /*reply*/, size_t /*reply_size*/) {
+        SetProcessWorkingSetSizeEx(GetCurrentProcess(),
+                                   static_cast<SIZE_T>(-1),
+                                   static_cast<SIZE_T>(-1), 0);
+      });
+}
+
+void FlutterWindow::LeaveBackground() {
+  if (!in_background_ || !flutter_controller_) {
+    return;
+  }
+  in_background_ = false;
+  message_loop_->SetEfficiencyMode(false);
+
+  RECT frame = GetClientArea();
+  MoveWindow(flutter_controller_->view()->GetNativeWindow(), frame.left,
+             frame.top, frame.right - frame.left, frame.bottom - frame.top,
+             TRUE);
+  const uint8_t left = 0;
+  flutter_controller_->engine()->messenger()->Send(
+      kBackgroundModeChannel, &left, sizeof(left));
+  flutter_controller_->ForceRedraw();
+}
+
 void FlutterWindow::OnDestroy() {
+  if (flutter_controller_) {
+    flutter_controller_->engine()->messenger()->SetMessageHandler(
+        kMessageLoopChannel, nullptr);
+  }
+  // Joins the workers while the plugins their tasks use are still alive.
+  executor_->Stop();
+  native_plugins_ = nullptr;
+  plugin_scheduler_ = nullptr;
   if (flutter_controller_) {
     flutter_controller_ = nullptr;
   }
@@ -65,6 +184,31 @@ FlutterWindow::MessageHandler(HWND hwnd, UINT const message,
     case WM_FONTCHANGE:
       flutter_controller_->engine()->ReloadSystemFonts();
       break;
+    case WM_ACTIVATE:
+      // Background work is throttled while the user is in the window, and
+      // the model is loaded for the chat they may be about to start.
+      executor_->SetForeground(LOWORD(wparam) != WA_INACTIVE);
+      if (LOWORD(wparam) != WA_INACTIVE && native_plugins_) {
+        native_plugins_->OnWindowActivated();
+      }
+      break;
+    case WM_SHOWWINDOW:
+      // Only ShowWindow() calls, such as window_manager hiding the window to
+      // the tray, not an owner being minimized.
+      if (lparam == 0) {
+        if (wparam) {
+          LeaveBackground();
+        } else {
+          EnterBackground();
+        }
+      }
+      break;
+    case WM_SIZE:
+      // Keep the view at 1x1 while hidden; LeaveBackground() resizes it.
+      if (in_background_) {
+        return 0;
+      }
+      break;
   }
 
   return Win32Window::MessageHandler(hwnd, message, wparam, lparam);
@@ -4,17 +4,32 @@
 #include <flutter/dart_project.h>
 #include <flutter/flutter_view_controller.h>
 
+#include <cstdint>
 #include <memory>
+#include <vector>
 
+#include "message_loop.h"
+#include "native/task_executor.h"
+#include "native_plugins.h"
+#include "plugin_scheduler.h"
 #include "win32_window.h"
 
 // A window that does nothing but host a Flutter view.
 class FlutterWindow : public Win32Window {
  public:
   // Creates a new FlutterWindow hosting a Flutter view running |project|.
-  explicit FlutterWindow(const flutter::DartProject& project);
+  // |message_loop| runs this window's messages and must outlive it.
+  // |executor| runs the native plugins' work; the window stops it when it
+  // is destroyed.
+  FlutterWindow(const flutter::DartProject& project,
+                MessageLoop* message_loop,
+                cloudtolocalllm::TaskExecutor* executor);
   virtual ~FlutterWindow();
 
+  // Brings the window to the front and hands |launch|, a later instance's
+  // command line encoded as in native/forwarded_launch.h, to Dart.
+  void OnForwardedLaunch(const std::vector<uint8_t>& launch);
+
  protected:
   // Win32Window:
   bool OnCreate() override;
@@ -23,11 +38,30 @@ class FlutterWindow : public Win32Window {
                          LPARAM const lparam) noexcept override;
 
  private:
+  // While the window is hidden (e.g. to the tray) the view is shrunk to 1x1
+  // so the engine releases its full-size GPU surface, and Dart is asked to
+  // drop its caches; the engine and the Dart services keep running.
+  void EnterBackground();
+  // Restores the view before the window is shown again.
+  void LeaveBackground();
+
   // The project to run.
   flutter::DartProject project_;
 
+  MessageLoop* message_loop_;
+
+  cloudtolocalllm::TaskExecutor* executor_;
+
   // The Flutter instance hosted by this window.
   std::unique_ptr<flutter::FlutterViewController> flutter_controller_;
+
+  // Registers the pub plugins; torn down before the controller.
+  std::unique_ptr<PluginScheduler> plugin_scheduler_;
+
+  // The runner's own native plugins; torn down before the controller.
+  std::unique_ptr<NativePlugins> native_plugins_;
+
+  bool in_background_ = false;
 };
 
 #endif  // RUNNER_FLUTTER_WINDOW_H_
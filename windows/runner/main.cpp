@@ -3,10 +3,34 @@
 #include <windows.h>
 
 #include "flutter_window.h"
+#include "message_loop.h"
+#include "native/startup_trace.h"
+#include "native/task_executor.h"
+#include "single_instance.h"
 #include "utils.h"
 
+using cloudtolocalllm::ScopedStartupTrace;
+using cloudtolocalllm::StartupTrace;
+using cloudtolocalllm::TaskExecutor;
+
 int APIENTRY wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev,
                       _In_ wchar_t *command_line, _In_ int show_command) {
+  // Enabled by CLOUDTOLOCALLLM_TRACE_STARTUP or --trace-startup; the flag is
+  // not passed on to Dart.
+  std::vector<std::string> command_line_arguments =
+      GetCommandLineArguments();
+  StartupTrace::Get()->Configure(&command_line_arguments);
+  StartupTrace::Get()->Instant("wWinMain");
+
+  // A later launch hands its arguments to the running instance and exits.
+  SingleInstance single_instance;
+  {
+    ScopedStartupTrace trace("SingleInstance");
+    if (!single_instance.AcquireOrForward(command_line_arguments)) {
+      return EXIT_SUCCESS;
+    }
+  }
+
   // Attach to console when present (e.g., 'flutter run') or create a
   // new console when running with a debugger.
   if (!::AttachConsole(ATTACH_PARENT_PROCESS) && ::IsDebuggerPresent()) {
@@ -15,28 +39,34 @@ int APIENTRY wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev,
 
   // Initialize COM, so that it is available for use in the library and/or
   // plugins.
-  ::CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+  {
+    ScopedStartupTrace trace("CoInitializeEx");
+    ::CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+  }
 
   flutter::DartProject project(L"data");
 
-  std::vector<std::string> command_line_arguments =
-      GetCommandLineArguments();
-
   project.set_dart_entrypoint_arguments(std::move(command_line_arguments));
 
-  FlutterWindow window(project);
+  // One pool of workers for every native plugin; the window stops it before
+  // it tears the plugins down.
+  TaskExecutor executor;
+  executor.Start();
+
+  MessageLoop message_loop;
+  FlutterWindow window(project, &message_loop, &executor);
   Win32Window::Point origin(10, 10);
   Win32Window::Size size(1280, 720);
   if (!window.Create(L"cloudtolocalllm", origin, size)) {
     return EXIT_FAILURE;
   }
   window.SetQuitOnClose(true);
+  single_instance.SetLaunchHandler(
+      [&window](const std::vector<uint8_t>& launch) {
+        window.OnForwardedLaunch(launch);
+      });
 
-  ::MSG msg;
-  while (::GetMessage(&msg, nullptr, 0, 0)) {
-    ::TranslateMessage(&msg);
-    ::DispatchMessage(&msg);
-  }
+  message_loop.Run();
 
   ::CoUninitialize();
   return EXIT_SUCCESS;
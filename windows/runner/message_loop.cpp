@@ -0,0 +1,85 @@
+#include "message_loop.h"
+
+#include <cstdlib>
+
+namespace {
+
+constexpr uint64_t kRateWindowMs = 1000;
+
+}  // namespace
+
+MessageLoop::MessageLoop() : window_start_ms_(GetTickCount64()) {}
+
+MessageLoop::~MessageLoop() {
+  SetEfficiencyMode(false);
+}
+
+int MessageLoop::Run() {
+  for (;;) {
+    // MWMO_INPUTAVAILABLE also returns for input that an earlier peek saw
+    // but left queued, so nothing sits unprocessed until the next wakeup.
+    const DWORD result = MsgWaitForMultipleObjectsEx(
+        0, nullptr, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+    if (result == WAIT_FAILED) {
+      return EXIT_FAILURE;
+    }
+    CountWakeup();
+
+    MSG msg;
+    while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
+      if (msg.message == WM_QUIT) {
+        return static_cast<int>(msg.wParam);
+      }
+      TranslateMessage(&msg);
+      DispatchMessage(&msg);
+    }
+  }
+}
+
+void MessageLoop::SetEfficiencyMode(bool enabled) {
+  if (enabled == efficiency_mode_) {
+    return;
+  }
+  efficiency_mode_ = enabled;
+
+  PROCESS_POWER_THROTTLING_STATE state{};
+  state.Version = PROCESS_POWER_THROTTLING_CURRENT_VERSION;
+  state.ControlMask = PROCESS_POWER_THROTTLING_EXECUTION_SPEED;
+#ifdef PROCESS_POWER_THROTTLING_IGNORE_TIMER_RESOLUTION
+  // Windows 11 and later; older versions reject the whole call with it set.
+  OSVERSIONINFOEXW version{sizeof(version)};
+  version.dwBuildNumber = 22000;
+  DWORDLONG condition = 0;
+  VER_SET_CONDITION(condition, VER_BUILDNUMBER, VER_GREATER_EQUAL);
+  if (VerifyVersionInfoW(&version, VER_BUILDNUMBER, condition)) {
+    state.ControlMask |= PROCESS_POWER_THROTTLING_IGNORE_TIMER_RESOLUTION;
+  }
+#endif
+  state.StateMask = enabled ? state.ControlMask : 0;
+  SetProcessInformation(GetCurrentProcess(), ProcessPowerThrottling, &state,
+                        sizeof(state));
+}
+
+MessageLoop::Stats MessageLoop::stats() const {
+  Stats stats;
+  stats.wakeups = wakeups_;
+  const uint64_t elapsed = GetTickCount64() - window_start_ms_;
+  stats.wakeups_per_second =
+      elapsed >= kRateWindowMs
+          ? static_cast<double>(window_wakeups_) * 1000 / elapsed
+          : last_rate_;
+  stats.efficiency_mode = efficiency_mode_;
+  return stats;
+}
+
+void MessageLoop::CountWakeup() {
+  wakeups_++;
+  const uint64_t now = GetTickCount64();
+  const uint64_t elapsed = now - window_start_ms_;
+  if (elapsed >= kRateWindowMs) {
+    last_rate_ = static_cast<double>(window_wakeups_) * 1000 / elapsed;
+    window_start_ms_ = now;
+    window_wakeups_ = 0;
+  }
+  window_wakeups_++;
+}
@@ -0,0 +1,54 @@
+#ifndef RUNNER_MESSAGE_LOOP_H_
+#define RUNNER_MESSAGE_LOOP_H_
+
+#include <windows.h>
+
+#include <cstdint>
+
+// The runner's main message loop. It blocks in MsgWaitForMultipleObjectsEx
+// and drains every queued message per wakeup, counting the wakeups so the
+// idle cost can be measured: each one is a return from the wait, whether
+// for input, an engine or plugin post, or a timer.
+//
+// While the window is hidden to the tray it also marks the process for
+// EcoQoS and tells Windows to ignore its timer resolution requests, so the
+// engine's and plugins' timers are coalesced with the rest of the system's
+// rather than waking the CPU on their own schedule.
+class MessageLoop {
+ public:
+  struct Stats {
+    uint64_t wakeups;
+    // Averaged over the last full second, or since the last wakeup when the
+    // loop has been idle for longer.
+    double wakeups_per_second;
+    bool efficiency_mode;
+  };
+
+  MessageLoop();
+  ~MessageLoop();
+
+  // Prevent copying.
+  MessageLoop(MessageLoop const&) = delete;
+  MessageLoop& operator=(MessageLoop const&) = delete;
+
+  // Runs until WM_QUIT and returns its exit code.
+  int Run();
+
+  // Applies or lifts the power throttling hints; called when the window is
+  // hidden to or restored from the tray.
+  void SetEfficiencyMode(bool enabled);
+
+  Stats stats() const;
+
+ private:
+  void CountWakeup();
+
+  uint64_t wakeups_ = 0;
+  // Wakeups in the second starting at window_start_ms_.
+  uint64_t window_start_ms_ = 0;
+  uint64_t window_wakeups_ = 0;
+  double last_rate_ = 0;
+  bool efficiency_mode_ = false;
+};
+
+#endif  // RUNNER_MESSAGE_LOOP_H_
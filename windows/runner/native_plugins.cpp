@@ -0,0 +1,57 @@
+#include "native_plugins.h"
+
+#include "native/startup_trace.h"
+
+using cloudtolocalllm::ScopedStartupTrace;
+
+NativePlugins::NativePlugins(flutter::FlutterEngine* engine,
+                             cloudtolocalllm::TaskExecutor* executor)
+    : task_runner_(std::make_unique<PlatformTaskRunner>()),
+      resource_monitor_sampler_(
+          std::make_shared<cloudtolocalllm::ResourceMonitor>()) {
+  // Each plugin is traced like the pub ones in PluginScheduler.
+  {
+    ScopedStartupTrace trace("ConversationStorePlugin");
+    conversation_store_ =
+        std::make_unique<ConversationStorePlugin>(engine->messenger());
+  }
+  {
+    ScopedStartupTrace trace("LatencyMetricsPlugin");
+    latency_metrics_ =
+        std::make_unique<LatencyMetricsPlugin>(engine->messenger());
+  }
+  {
+    ScopedStartupTrace trace("ModelWarmupPlugin");
+    model_warmup_ = std::make_unique<ModelWarmupPlugin>(
+        engine->messenger(), resource_monitor_sampler_);
+  }
+  {
+    ScopedStartupTrace trace("NdjsonParserPlugin");
+    ndjson_parser_ = std::make_unique<NdjsonParserPlugin>(engine->messenger());
+  }
+  {
+    ScopedStartupTrace trace("OllamaHttpPlugin");
+    ollama_http_ = std::make_unique<OllamaHttpPlugin>(engine->messenger(),
+                                                      task_runner_.get());
+  }
+  {
+    ScopedStartupTrace trace("ResourceMonitorPlugin");
+    resource_monitor_ = std::make_unique<ResourceMonitorPlugin>(
+        engine->messenger(), resource_monitor_sampler_);
+  }
+  {
+    ScopedStartupTrace trace("TokenCounterPlugin");
+    token_counter_ = std::make_unique<TokenCounterPlugin>(
+        engine->messenger(), task_runner_.get(), executor);
+  }
+  {
+    ScopedStartupTrace trace("TunnelCodecPlugin");
+    tunnel_codec_ = std::make_unique<TunnelCodecPlugin>(engine->messenger());
+  }
+}
+
+NativePlugins::~NativePlugins() {}
+
+void NativePlugins::OnWindowActivated() {
+  model_warmup_->OnWindowActivated();
+}
@@ -0,0 +1,53 @@
+#ifndef RUNNER_NATIVE_PLUGINS_H_
+#define RUNNER_NATIVE_PLUGINS_H_
+
+#include <flutter/flutter_engine.h>
+
+#include <memory>
+
+#include "native/resource_monitor.h"
+#include "native/task_executor.h"
+#include "platform_task_runner.h"
+#include "plugins/conversation_store_plugin.h"
+#include "plugins/latency_metrics_plugin.h"
+#include "plugins/model_warmup_plugin.h"
+#include "plugins/ndjson_parser_plugin.h"
+#include "plugins/ollama_http_plugin.h"
+#include "plugins/resource_monitor_plugin.h"
+#include "plugins/token_counter_plugin.h"
+#include "plugins/tunnel_codec_plugin.h"
+
+// Owns the runner's own native plugins, the ones implemented under
+// runner/plugins on top of the shared native/ library rather than pulled in
+// from pub packages. Create it right after the PluginScheduler, which
+// registers the pub plugins, and destroy it before the engine. |executor|
+// runs the plugins' work; stop it before destroying this object.
+class NativePlugins {
+ public:
+  NativePlugins(flutter::FlutterEngine* engine,
+                cloudtolocalllm::TaskExecutor* executor);
+  ~NativePlugins();
+
+  // Prevent copying.
+  NativePlugins(NativePlugins const&) = delete;
+  NativePlugins& operator=(NativePlugins const&) = delete;
+
+  // Called as the window becomes the active one.
+  void OnWindowActivated();
+
+ private:
+  // Declared first so it outlives the plugins that post to it.
+  std::unique_ptr<PlatformTaskRunner> task_runner_;
+  // Sampled for the resource monitor channel and read by the warm-up.
+  std::shared_ptr<cloudtolocalllm::ResourceMonitor> resource_monitor_sampler_;
+  std::unique_ptr<ConversationStorePlugin> conversation_store_;
+  std::unique_ptr<LatencyMetricsPlugin> latency_metrics_;
+  std::unique_ptr<ModelWarmupPlugin> model_warmup_;
+  std::unique_ptr<NdjsonParserPlugin> ndjson_parser_;
+  std::unique_ptr<OllamaHttpPlugin> ollama_http_;
+  std::unique_ptr<ResourceMonitorPlugin> resource_monitor_;
+  std::unique_ptr<TokenCounterPlugin> token_counter_;
+  std::unique_ptr<TunnelCodecPlugin> tunnel_codec_;
+};
+
+#endif  // RUNNER_NATIVE_PLUGINS_H_
@@ -0,0 +1,110 @@
+#include "platform_task_runner.h"
+
+namespace {
+
+constexpr const wchar_t kWindowClassName[] = L"CLOUDTOLOCALLLM_TASK_RUNNER";
+
+constexpr UINT kRunTasksMessage = WM_APP + 1;
+
+constexpr UINT_PTR kIdleTimerId = 1;
+
+}  // namespace
+
+PlatformTaskRunner::PlatformTaskRunner() {
+  static bool class_registered = false;
+  if (!class_registered) {
+    WNDCLASS window_class{};
+    window_class.lpszClassName = kWindowClassName;
+    window_class.hInstance = GetModuleHandle(nullptr);
+    window_class.lpfnWndProc = PlatformTaskRunner::WndProc;
+    class_registered = RegisterClass(&window_class) != 0;
+  }
+  window_ = CreateWindowEx(0, kWindowClassName, L"", 0, 0, 0, 0, 0,
+                           HWND_MESSAGE, nullptr, GetModuleHandle(nullptr),
+                           nullptr);
+  if (window_ != nullptr) {
+    SetWindowLongPtr(window_, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+  }
+}
+
+PlatformTaskRunner::~PlatformTaskRunner() {
+  if (window_ != nullptr) {
+    SetWindowLongPtr(window_, GWLP_USERDATA, 0);
+    DestroyWindow(window_);
+    window_ = nullptr;
+  }
+}
+
+void PlatformTaskRunner::PostTask(std::function<void()> task) {
+  bool post = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+    if (!wakeup_posted_) {
+      wakeup_posted_ = true;
+      post = true;
+    }
+  }
+  if (post && window_ != nullptr) {
+    PostMessage(window_, kRunTasksMessage, 0, 0);
+  }
+}
+
+void PlatformTaskRunner::PostIdleTask(std::function<void()> task) {
+  idle_tasks_.push_back(std::move(task));
+  if (idle_tasks_.size() == 1 && window_ != nullptr) {
+    SetCoalescableTimer(window_, kIdleTimerId, USER_TIMER_MINIMUM, nullptr,
+                        TIMERV_DEFAULT_COALESCING);
+  }
+}
+
+// static
+LRESULT CALLBACK PlatformTaskRunner::WndProc(HWND const window,
+                                             UINT const message,
+                                             WPARAM const wparam,
+                                             LPARAM const lparam) noexcept {
+  if (message == kRunTasksMessage) {
+    auto* runner = reinterpret_cast<PlatformTaskRunner*>(
+        GetWindowLongPtr(window, GWLP_USERDATA));
+    if (runner != nullptr) {
+      runner->RunPendingTasks();
+    }
+    return 0;
+  }
+  if (message == WM_TIMER && wparam == kIdleTimerId) {
+    auto* runner = reinterpret_cast<PlatformTaskRunner*>(
+        GetWindowLongPtr(window, GWLP_USERDATA));
+    if (runner != nullptr) {
+      runner->RunIdleTask();
+    }
+    return 0;
+  }
+  return DefWindowProc(window, message, wparam, lparam);
+}
+
+void PlatformTaskRunner::RunPendingTasks() {
+  std::deque<std::function<void()>> tasks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks.swap(tasks_);
+    wakeup_posted_ = false;
+  }
+  for (auto& task : tasks) {
+    task();
+  }
+}
+
+void PlatformTaskRunner::RunIdleTask() {
+  KillTimer(window_, kIdleTimerId);
+  if (idle_tasks_.empty()) {
+    return;
+  }
+  std::function<void()> task = std::move(idle_tasks_.front());
+  idle_tasks_.pop_front();
+  // Re-armed first, so a task posting another idle task doesn't set it twice.
+  if (!idle_tasks_.empty()) {
+    SetCoalescableTimer(window_, kIdleTimerId, USER_TIMER_MINIMUM, nullptr,
+                        TIMERV_DEFAULT_COALESCING);
+  }
+  task();
+}
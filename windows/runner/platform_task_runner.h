@@ -0,0 +1,55 @@
+#ifndef RUNNER_PLATFORM_TASK_RUNNER_H_
+#define RUNNER_PLATFORM_TASK_RUNNER_H_
+
+#include <windows.h>
+
+#include <deque>
+#include <functional>
+#include <mutex>
+
+// Runs closures on the platform (main) thread. Flutter's BinaryMessenger may
+// only be used from that thread, so native workers post their results here.
+//
+// Backed by a message-only window: PostTask queues the closure and posts a
+// single wakeup message, and the window procedure drains the queue. Must be
+// created and destroyed on the platform thread.
+class PlatformTaskRunner {
+ public:
+  PlatformTaskRunner();
+  ~PlatformTaskRunner();
+
+  // Prevent copying.
+  PlatformTaskRunner(PlatformTaskRunner const&) = delete;
+  PlatformTaskRunner& operator=(PlatformTaskRunner const&) = delete;
+
+  // Queues |task| to run on the platform thread. May be called from any
+  // thread. Tasks still queued when the runner is destroyed are dropped.
+  void PostTask(std::function<void()> task);
+
+  // Queues |task| to run on the platform thread once it has no other
+  // messages to handle, input and painting included. Idle tasks run one per
+  // WM_TIMER, which Windows only delivers to an otherwise empty queue. Must
+  // be called on the platform thread.
+  void PostIdleTask(std::function<void()> task);
+
+ private:
+  static LRESULT CALLBACK WndProc(HWND const window, UINT const message,
+                                  WPARAM const wparam,
+                                  LPARAM const lparam) noexcept;
+
+  void RunPendingTasks();
+  void RunIdleTask();
+
+  HWND window_ = nullptr;
+
+  std::mutex mutex_;
+  std::deque<std::function<void()>> tasks_;
+  // Whether a wakeup message is already in flight, so a burst of posts costs
+  // one message rather than one per task.
+  bool wakeup_posted_ = false;
+
+  // Platform thread only.
+  std::deque<std::function<void()>> idle_tasks_;
+};
+
+#endif  // RUNNER_PLATFORM_TASK_RUNNER_H_
@@ -0,0 +1,113 @@
+#include "plugin_scheduler.h"
+
+#include <connectivity_plus/connectivity_plus_windows_plugin.h>
+#include <flutter_secure_storage_x_windows/flutter_secure_storage_windows_plugin.h>
+#include <screen_retriever_windows/screen_retriever_windows_plugin_c_api.h>
+#include <tray_manager/tray_manager_plugin.h>
+#include <url_launcher_windows/url_launcher_windows.h>
+#include <window_manager/window_manager_plugin.h>
+
+#include <iterator>
+
+#include "native/startup_trace.h"
+
+using cloudtolocalllm::ScopedStartupTrace;
+using cloudtolocalllm::StartupTrace;
+
+namespace {
+
+constexpr char kChannelName[] = "cloudtolocalllm/plugin_scheduler";
+constexpr uint8_t kAwaitDeferred = 1;
+
+struct ScheduledPlugin {
+  const char* name;
+  void (*register_with_registrar)(FlutterDesktopPluginRegistrarRef registrar);
+  bool deferred;
+};
+
+// Every plugin in flutter/generated_plugins.cmake, critical ones first and
+// the rest in the order the app first needs them. The build fails if the
+// generated list changes without this table; see ../CMakeLists.txt.
+const ScheduledPlugin kPlugins[] = {
+    {"WindowManagerPlugin", WindowManagerPluginRegisterWithRegistrar, false},
+    {"FlutterSecureStorageWindowsPlugin",
+     FlutterSecureStorageWindowsPluginRegisterWithRegistrar, true},
+    {"TrayManagerPlugin", TrayManagerPluginRegisterWithRegistrar, true},
+    {"ConnectivityPlusWindowsPlugin",
+     ConnectivityPlusWindowsPluginRegisterWithRegistrar, true},
+    {"ScreenRetrieverWindowsPluginCApi",
+     ScreenRetrieverWindowsPluginCApiRegisterWithRegistrar, true},
+    {"UrlLauncherWindows", UrlLauncherWindowsRegisterWithRegistrar, true},
+};
+
+void RegisterPlugin(flutter::PluginRegistry* registry,
+                    const ScheduledPlugin& plugin) {
+  ScopedStartupTrace trace(plugin.name);
+  plugin.register_with_registrar(registry->GetRegistrarForPlugin(plugin.name));
+}
+
+void RespondDone(const flutter::BinaryReply& reply) {
+  static const uint8_t kDone = 1;
+  reply(&kDone, sizeof(kDone));
+}
+
+}  // namespace
+
+PluginScheduler::PluginScheduler(flutter::FlutterEngine* engine)
+    : engine_(engine), task_runner_(std::make_unique<PlatformTaskRunner>()) {
+  for (const ScheduledPlugin& plugin : kPlugins) {
+    if (!plugin.deferred) {
+      RegisterPlugin(engine_, plugin);
+    }
+  }
+  engine_->messenger()->SetMessageHandler(
+      kChannelName, [this](const uint8_t* message, size_t message_size,
+                           flutter::BinaryReply reply) {
+        HandleMessage(message, message_size, reply);
+      });
+}
+
+PluginScheduler::~PluginScheduler() {
+  engine_->messenger()->SetMessageHandler(kChannelName, nullptr);
+}
+
+void PluginScheduler::OnFirstFrame() {
+  if (started_) {
+    return;
+  }
+  started_ = true;
+  task_runner_->PostIdleTask([this]() { RegisterNextDeferred(); });
+}
+
+void PluginScheduler::RegisterNextDeferred() {
+  while (next_ < std::size(kPlugins) && !kPlugins[next_].deferred) {
+    next_++;
+  }
+  if (next_ < std::size(kPlugins)) {
+    RegisterPlugin(engine_, kPlugins[next_++]);
+    task_runner_->PostIdleTask([this]() { RegisterNextDeferred(); });
+    return;
+  }
+
+  done_ = true;
+  StartupTrace::Get()->Instant("deferred plugins registered");
+  StartupTrace::Get()->Flush();
+  for (const flutter::BinaryReply& reply : waiting_) {
+    RespondDone(reply);
+  }
+  waiting_.clear();
+}
+
+void PluginScheduler::HandleMessage(const uint8_t* message,
+                                    size_t message_size,
+                                    const flutter::BinaryReply& reply) {
+  if (message_size < 1 || message[0] != kAwaitDeferred) {
+    reply(nullptr, 0);
+    return;
+  }
+  if (done_) {
+    RespondDone(reply);
+    return;
+  }
+  waiting_.push_back(reply);
+}
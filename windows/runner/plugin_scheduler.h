@@ -0,0 +1,52 @@
+#ifndef RUNNER_PLUGIN_SCHEDULER_H_
+#define RUNNER_PLUGIN_SCHEDULER_H_
+
+#include <flutter/binary_messenger.h>
+#include <flutter/flutter_engine.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "platform_task_runner.h"
+
+// Registers the pub plugins in place of RegisterPlugins(), which is
+// regenerated by the Flutter tool and registers everything before the first
+// frame. Only window_manager, which has to see the window's messages from the
+// start, is registered by the constructor; the rest are registered one idle
+// task at a time after OnFirstFrame(), so input and frames get a turn in
+// between.
+//
+// Also handles the "cloudtolocalllm/plugin_scheduler" binary channel: a
+// message with op 1 is answered with one byte once the deferred plugins are
+// registered, which is what DeferredPlugins.ready waits for on the Dart side.
+class PluginScheduler {
+ public:
+  // |engine| must outlive this object.
+  explicit PluginScheduler(flutter::FlutterEngine* engine);
+  ~PluginScheduler();
+
+  // Prevent copying.
+  PluginScheduler(PluginScheduler const&) = delete;
+  PluginScheduler& operator=(PluginScheduler const&) = delete;
+
+  // Starts registering the deferred plugins. Called when the first frame
+  // has been drawn; later calls do nothing.
+  void OnFirstFrame();
+
+ private:
+  void RegisterNextDeferred();
+  void HandleMessage(const uint8_t* message, size_t message_size,
+                     const flutter::BinaryReply& reply);
+
+  flutter::FlutterEngine* engine_;
+  // Queued registrations are dropped with it, so they never outlive this.
+  std::unique_ptr<PlatformTaskRunner> task_runner_;
+  size_t next_ = 0;
+  bool started_ = false;
+  bool done_ = false;
+  // Requests from Dart waiting for the deferred plugins.
+  std::vector<flutter::BinaryReply> waiting_;
+};
+
+#endif  // RUNNER_PLUGIN_SCHEDULER_H_
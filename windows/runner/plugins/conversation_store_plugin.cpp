@@ -0,0 +1,29 @@
+#include "plugins/conversation_store_plugin.h"
+
+namespace {
+
+constexpr char kChannelName[] = "cloudtolocalllm/conversation_store";
+
+}  // namespace
+
+ConversationStorePlugin::ConversationStorePlugin(
+    flutter::BinaryMessenger* messenger)
+    : messenger_(messenger) {
+  messenger_->SetMessageHandler(
+      kChannelName, [this](const uint8_t* message, size_t message_size,
+                           flutter::BinaryReply reply) {
+        HandleMessage(message, message_size, reply);
+      });
+}
+
+ConversationStorePlugin::~ConversationStorePlugin() {
+  messenger_->SetMessageHandler(kChannelName, nullptr);
+}
+
+void ConversationStorePlugin::HandleMessage(
+    const uint8_t* message,
+    size_t message_size,
+    const flutter::BinaryReply& reply) {
+  service_.HandleMessage(message, message_size, &reply_buffer_);
+  reply(reply_buffer_.data(), reply_buffer_.size());
+}
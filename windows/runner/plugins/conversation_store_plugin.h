@@ -0,0 +1,34 @@
+#ifndef RUNNER_PLUGINS_CONVERSATION_STORE_PLUGIN_H_
+#define RUNNER_PLUGINS_CONVERSATION_STORE_PLUGIN_H_
+
+#include <flutter/binary_messenger.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "native/conversation_store_service.h"
+
+// Handles the "cloudtolocalllm/conversation_store" binary channel, which
+// keeps chat history in a memory-mapped append-only log. See
+// native/conversation_store_service.h for the message layout.
+class ConversationStorePlugin {
+ public:
+  // Installs the channel handler on |messenger|, which must outlive this
+  // object.
+  explicit ConversationStorePlugin(flutter::BinaryMessenger* messenger);
+  ~ConversationStorePlugin();
+
+  // Prevent copying.
+  ConversationStorePlugin(ConversationStorePlugin const&) = delete;
+  ConversationStorePlugin& operator=(ConversationStorePlugin const&) = delete;
+
+ private:
+  void HandleMessage(const uint8_t* message, size_t message_size,
+                     const flutter::BinaryReply& reply);
+
+  flutter::BinaryMessenger* messenger_;
+  cloudtolocalllm::ConversationStoreService service_;
+  std::vector<uint8_t> reply_buffer_;
+};
+
+#endif  // RUNNER_PLUGINS_CONVERSATION_STORE_PLUGIN_H_
@@ -0,0 +1,29 @@
+#include "plugins/latency_metrics_plugin.h"
+
+namespace {
+
+constexpr char kChannelName[] = "cloudtolocalllm/latency_metrics";
+
+}  // namespace
+
+LatencyMetricsPlugin::LatencyMetricsPlugin(
+    flutter::BinaryMessenger* messenger)
+    : messenger_(messenger) {
+  messenger_->SetMessageHandler(
+      kChannelName, [this](const uint8_t* message, size_t message_size,
+                           flutter::BinaryReply reply) {
+        HandleMessage(message, message_size, reply);
+      });
+}
+
+LatencyMetricsPlugin::~LatencyMetricsPlugin() {
+  messenger_->SetMessageHandler(kChannelName, nullptr);
+}
+
+void LatencyMetricsPlugin::HandleMessage(
+    const uint8_t* message,
+    size_t message_size,
+    const flutter::BinaryReply& reply) {
+  service_.HandleMessage(message, message_size, &reply_buffer_);
+  reply(reply_buffer_.data(), reply_buffer_.size());
+}
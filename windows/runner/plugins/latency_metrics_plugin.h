@@ -0,0 +1,34 @@
+#ifndef RUNNER_PLUGINS_LATENCY_METRICS_PLUGIN_H_
+#define RUNNER_PLUGINS_LATENCY_METRICS_PLUGIN_H_
+
+#include <flutter/binary_messenger.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "native/latency_metrics_service.h"
+
+// Handles the "cloudtolocalllm/latency_metrics" binary channel, which reports
+// time-to-first-token, inter-token and tunnel round-trip percentiles. See
+// native/latency_metrics_service.h for the message layout.
+class LatencyMetricsPlugin {
+ public:
+  // Installs the channel handler on |messenger|, which must outlive this
+  // object.
+  explicit LatencyMetricsPlugin(flutter::BinaryMessenger* messenger);
+  ~LatencyMetricsPlugin();
+
+  // Prevent copying.
+  LatencyMetricsPlugin(LatencyMetricsPlugin const&) = delete;
+  LatencyMetricsPlugin& operator=(LatencyMetricsPlugin const&) = delete;
+
+ private:
+  void HandleMessage(const uint8_t* message, size_t message_size,
+                     const flutter::BinaryReply& reply);
+
+  flutter::BinaryMessenger* messenger_;
+  cloudtolocalllm::LatencyMetricsService service_;
+  std::vector<uint8_t> reply_buffer_;
+};
+
+#endif  // RUNNER_PLUGINS_LATENCY_METRICS_PLUGIN_H_
@@ -0,0 +1,36 @@
+#include "plugins/model_warmup_plugin.h"
+
+#include <utility>
+
+namespace {
+
+constexpr char kChannelName[] = "cloudtolocalllm/model_warmup";
+
+}  // namespace
+
+ModelWarmupPlugin::ModelWarmupPlugin(
+    flutter::BinaryMessenger* messenger,
+    std::shared_ptr<const cloudtolocalllm::ResourceMonitor> monitor)
+    : messenger_(messenger), service_(std::move(monitor)) {
+  messenger_->SetMessageHandler(
+      kChannelName, [this](const uint8_t* message, size_t message_size,
+                           flutter::BinaryReply reply) {
+        HandleMessage(message, message_size, reply);
+      });
+}
+
+ModelWarmupPlugin::~ModelWarmupPlugin() {
+  messenger_->SetMessageHandler(kChannelName, nullptr);
+}
+
+void ModelWarmupPlugin::OnWindowActivated() {
+  service_.warmup()->Warm(cloudtolocalllm::WarmupTrigger::kFocus);
+}
+
+void ModelWarmupPlugin::HandleMessage(
+    const uint8_t* message,
+    size_t message_size,
+    const flutter::BinaryReply& reply) {
+  service_.HandleMessage(message, message_size, &reply_buffer_);
+  reply(reply_buffer_.data(), reply_buffer_.size());
+}
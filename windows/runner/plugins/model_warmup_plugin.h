@@ -0,0 +1,41 @@
+#ifndef RUNNER_PLUGINS_MODEL_WARMUP_PLUGIN_H_
+#define RUNNER_PLUGINS_MODEL_WARMUP_PLUGIN_H_
+
+#include <flutter/binary_messenger.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "native/model_warmup_service.h"
+#include "native/resource_monitor.h"
+
+// Handles the "cloudtolocalllm/model_warmup" binary channel, which keeps
+// the last-used Ollama model loaded ahead of the first chat. See
+// native/model_warmup_service.h for the message layout.
+class ModelWarmupPlugin {
+ public:
+  // Installs the channel handler on |messenger|, which must outlive this
+  // object. |monitor| is checked for room before each warm-up.
+  ModelWarmupPlugin(
+      flutter::BinaryMessenger* messenger,
+      std::shared_ptr<const cloudtolocalllm::ResourceMonitor> monitor);
+  ~ModelWarmupPlugin();
+
+  // Prevent copying.
+  ModelWarmupPlugin(ModelWarmupPlugin const&) = delete;
+  ModelWarmupPlugin& operator=(ModelWarmupPlugin const&) = delete;
+
+  // Warms the model, cooldown permitting, as the window is activated.
+  void OnWindowActivated();
+
+ private:
+  void HandleMessage(const uint8_t* message, size_t message_size,
+                     const flutter::BinaryReply& reply);
+
+  flutter::BinaryMessenger* messenger_;
+  cloudtolocalllm::ModelWarmupService service_;
+  std::vector<uint8_t> reply_buffer_;
+};
+
+#endif  // RUNNER_PLUGINS_MODEL_WARMUP_PLUGIN_H_
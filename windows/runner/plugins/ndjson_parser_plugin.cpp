@@ -0,0 +1,27 @@
+#include "plugins/ndjson_parser_plugin.h"
+
+namespace {
+
+constexpr char kChannelName[] = "cloudtolocalllm/ndjson_parser";
+
+}  // namespace
+
+NdjsonParserPlugin::NdjsonParserPlugin(flutter::BinaryMessenger* messenger)
+    : messenger_(messenger) {
+  messenger_->SetMessageHandler(
+      kChannelName, [this](const uint8_t* message, size_t message_size,
+                           flutter::BinaryReply reply) {
+        HandleMessage(message, message_size, reply);
+      });
+}
+
+NdjsonParserPlugin::~NdjsonParserPlugin() {
+  messenger_->SetMessageHandler(kChannelName, nullptr);
+}
+
+void NdjsonParserPlugin::HandleMessage(const uint8_t* message,
+                                       size_t message_size,
+                                       const flutter::BinaryReply& reply) {
+  service_.HandleMessage(message, message_size, &reply_buffer_);
+  reply(reply_buffer_.data(), reply_buffer_.size());
+}
@@ -0,0 +1,34 @@
+#ifndef RUNNER_PLUGINS_NDJSON_PARSER_PLUGIN_H_
+#define RUNNER_PLUGINS_NDJSON_PARSER_PLUGIN_H_
+
+#include <flutter/binary_messenger.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "native/ndjson_parser_service.h"
+
+// Handles the "cloudtolocalllm/ndjson_parser" binary channel, which turns raw
+// Ollama /api/chat response bytes into batched token deltas. See
+// native/ndjson_parser_service.h for the message layout.
+class NdjsonParserPlugin {
+ public:
+  // Installs the channel handler on |messenger|, which must outlive this
+  // object.
+  explicit NdjsonParserPlugin(flutter::BinaryMessenger* messenger);
+  ~NdjsonParserPlugin();
+
+  // Prevent copying.
+  NdjsonParserPlugin(NdjsonParserPlugin const&) = delete;
+  NdjsonParserPlugin& operator=(NdjsonParserPlugin const&) = delete;
+
+ private:
+  void HandleMessage(const uint8_t* message, size_t message_size,
+                     const flutter::BinaryReply& reply);
+
+  flutter::BinaryMessenger* messenger_;
+  cloudtolocalllm::NdjsonParserService service_;
+  std::vector<uint8_t> reply_buffer_;
+};
+
+#endif  // RUNNER_PLUGINS_NDJSON_PARSER_PLUGIN_H_
@@ -0,0 +1,82 @@
+#include "plugins/ollama_http_plugin.h"
+
+#include <string>
+#include <utility>
+
+namespace {
+
+constexpr char kChannelName[] = "cloudtolocalllm/ollama_http";
+constexpr char kEventChannelName[] = "cloudtolocalllm/ollama_http/events";
+
+}  // namespace
+
+OllamaHttpPlugin::OllamaHttpPlugin(flutter::BinaryMessenger* messenger,
+                                   PlatformTaskRunner* task_runner)
+    : messenger_(messenger),
+      task_runner_(task_runner),
+      alive_(std::make_shared<bool>(true)) {
+  flutter::BinaryMessenger* events_messenger = messenger_;
+  std::shared_ptr<bool> alive = alive_;
+  PlatformTaskRunner* runner = task_runner_;
+  broker_ = std::make_unique<cloudtolocalllm::LocalBroker>(
+      [this, alive, runner](uint64_t id, std::vector<uint8_t> message) {
+        auto shared_message =
+            std::make_shared<std::vector<uint8_t>>(std::move(message));
+        runner->PostTask([this, alive, id, shared_message]() {
+          if (!*alive) {
+            return;
+          }
+          service_->HandleMessage(shared_message->data(),
+                                  shared_message->size(), &upstream_reply_);
+          if (upstream_reply_.empty() && !shared_message->empty() &&
+              (*shared_message)[0] ==
+                  cloudtolocalllm::HttpStreamService::kStart) {
+            broker_->OnRejected(id);
+          }
+        });
+      });
+  service_ = std::make_unique<cloudtolocalllm::HttpStreamService>(
+      [this, events_messenger, alive, runner](std::vector<uint8_t> event) {
+        if (broker_->HandleEvent(event.data(), event.size())) {
+          service_->RecycleEvent(std::move(event));
+          return;
+        }
+        auto shared_event =
+            std::make_shared<std::vector<uint8_t>>(std::move(event));
+        // Send copies the bytes, so the buffer can be reused right after.
+        std::shared_ptr<cloudtolocalllm::FrameBufferPool> pool =
+            service_->buffer_pool();
+        runner->PostTask([events_messenger, alive, shared_event, pool]() {
+          if (*alive) {
+            events_messenger->Send(kEventChannelName, shared_event->data(),
+                                   shared_event->size());
+          }
+          pool->Release(std::move(*shared_event));
+        });
+      });
+  messenger_->SetMessageHandler(
+      kChannelName, [this](const uint8_t* message, size_t message_size,
+                           flutter::BinaryReply reply) {
+        HandleMessage(message, message_size, reply);
+      });
+  // Without it only the app reaches Ollama through the service, as before;
+  // it fails when another instance already serves the socket.
+  std::string error;
+  broker_->Start(&error);
+}
+
+OllamaHttpPlugin::~OllamaHttpPlugin() {
+  messenger_->SetMessageHandler(kChannelName, nullptr);
+  // Joins the broker's thread, so no more requests reach the service.
+  broker_->Stop();
+  // Joins the worker thread, so nothing is posted after this.
+  service_->Shutdown();
+  *alive_ = false;
+}
+
+void OllamaHttpPlugin::HandleMessage(const uint8_t* message,
+                                     size_t message_size,
+                                     const flutter::BinaryReply& reply) {
+  service_->HandleMessage(message, message_size, &reply_buffer_);
+  reply(reply_buffer_.data(), reply_buffer_.size());
+}
@@ -0,0 +1,48 @@
+#ifndef RUNNER_PLUGINS_OLLAMA_HTTP_PLUGIN_H_
+#define RUNNER_PLUGINS_OLLAMA_HTTP_PLUGIN_H_
+
+#include <flutter/binary_messenger.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "native/http_stream_service.h"
+#include "native/local_broker.h"
+#include "platform_task_runner.h"
+
+// Handles the "cloudtolocalllm/ollama_http" binary channel, which streams
+// HTTP requests to the local Ollama server from a native worker thread and
+// reports progress on "cloudtolocalllm/ollama_http/events". See
+// native/http_stream_service.h for the message layout.
+//
+// The same service also answers other local processes through a
+// LocalBroker; see native/local_broker.h.
+class OllamaHttpPlugin {
+ public:
+  // Installs the channel handler on |messenger|. Both |messenger| and
+  // |task_runner| must outlive this object.
+  OllamaHttpPlugin(flutter::BinaryMessenger* messenger,
+                   PlatformTaskRunner* task_runner);
+  ~OllamaHttpPlugin();
+
+  // Prevent copying.
+  OllamaHttpPlugin(OllamaHttpPlugin const&) = delete;
+  OllamaHttpPlugin& operator=(OllamaHttpPlugin const&) = delete;
+
+ private:
+  void HandleMessage(const uint8_t* message, size_t message_size,
+                     const flutter::BinaryReply& reply);
+
+  flutter::BinaryMessenger* messenger_;
+  PlatformTaskRunner* task_runner_;
+  // Cleared on destruction so events posted by the worker before it stopped
+  // are dropped instead of reaching a dead messenger.
+  std::shared_ptr<bool> alive_;
+  std::unique_ptr<cloudtolocalllm::LocalBroker> broker_;
+  std::unique_ptr<cloudtolocalllm::HttpStreamService> service_;
+  std::vector<uint8_t> reply_buffer_;
+  std::vector<uint8_t> upstream_reply_;
+};
+
+#endif  // RUNNER_PLUGINS_OLLAMA_HTTP_PLUGIN_H_
@@ -0,0 +1,32 @@
+#include "plugins/resource_monitor_plugin.h"
+
+#include <utility>
+
+namespace {
+
+constexpr char kChannelName[] = "cloudtolocalllm/resource_monitor";
+
+}  // namespace
+
+ResourceMonitorPlugin::ResourceMonitorPlugin(
+    flutter::BinaryMessenger* messenger,
+    std::shared_ptr<cloudtolocalllm::ResourceMonitor> monitor)
+    : messenger_(messenger), service_(std::move(monitor)) {
+  messenger_->SetMessageHandler(
+      kChannelName, [this](const uint8_t* message, size_t message_size,
+                           flutter::BinaryReply reply) {
+        HandleMessage(message, message_size, reply);
+      });
+}
+
+ResourceMonitorPlugin::~ResourceMonitorPlugin() {
+  messenger_->SetMessageHandler(kChannelName, nullptr);
+}
+
+void ResourceMonitorPlugin::HandleMessage(
+    const uint8_t* message,
+    size_t message_size,
+    const flutter::BinaryReply& reply) {
+  service_.HandleMessage(message, message_size, &reply_buffer_);
+  reply(reply_buffer_.data(), reply_buffer_.size());
+}
@@ -0,0 +1,37 @@
+#ifndef RUNNER_PLUGINS_RESOURCE_MONITOR_PLUGIN_H_
+#define RUNNER_PLUGINS_RESOURCE_MONITOR_PLUGIN_H_
+
+#include <flutter/binary_messenger.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "native/resource_monitor_service.h"
+
+// Handles the "cloudtolocalllm/resource_monitor" binary channel, which reports
+// the host's CPU, memory and GPU headroom. See
+// native/resource_monitor_service.h for the message layout.
+class ResourceMonitorPlugin {
+ public:
+  // Installs the channel handler on |messenger|, which must outlive this
+  // object, reporting the samples of |monitor|.
+  ResourceMonitorPlugin(
+      flutter::BinaryMessenger* messenger,
+      std::shared_ptr<cloudtolocalllm::ResourceMonitor> monitor);
+  ~ResourceMonitorPlugin();
+
+  // Prevent copying.
+  ResourceMonitorPlugin(ResourceMonitorPlugin const&) = delete;
+  ResourceMonitorPlugin& operator=(ResourceMonitorPlugin const&) = delete;
+
+ private:
+  void HandleMessage(const uint8_t* message, size_t message_size,
+                     const flutter::BinaryReply& reply);
+
+  flutter::BinaryMessenger* messenger_;
+  cloudtolocalllm::ResourceMonitorService service_;
+  std::vector<uint8_t> reply_buffer_;
+};
+
+#endif  // RUNNER_PLUGINS_RESOURCE_MONITOR_PLUGIN_H_
@@ -0,0 +1,44 @@
+#include "plugins/token_counter_plugin.h"
+
+#include <utility>
+
+namespace {
+
+constexpr char kChannelName[] = "cloudtolocalllm/token_counter";
+
+}  // namespace
+
+TokenCounterPlugin::TokenCounterPlugin(
+    flutter::BinaryMessenger* messenger,
+    PlatformTaskRunner* task_runner,
+    cloudtolocalllm::TaskExecutor* executor)
+    : messenger_(messenger), task_runner_(task_runner), executor_(executor) {
+  messenger_->SetMessageHandler(
+      kChannelName, [this](const uint8_t* message, size_t message_size,
+                           flutter::BinaryReply reply) {
+        HandleMessage(message, message_size, reply);
+      });
+}
+
+TokenCounterPlugin::~TokenCounterPlugin() {
+  messenger_->SetMessageHandler(kChannelName, nullptr);
+}
+
+void TokenCounterPlugin::HandleMessage(
+    const uint8_t* message,
+    size_t message_size,
+    const flutter::BinaryReply& reply) {
+  std::vector<uint8_t> request(message, message + message_size);
+  executor_->Post(
+      [this, request = std::move(request), reply]() {
+        std::vector<uint8_t> out;
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          service_.HandleMessage(request.data(), request.size(), &out);
+        }
+        task_runner_->PostTask([reply, out = std::move(out)]() {
+          reply(out.data(), out.size());
+        });
+      },
+      cloudtolocalllm::TaskExecutor::Lane::kInteractive);
+}
@@ -0,0 +1,48 @@
+#ifndef RUNNER_PLUGINS_TOKEN_COUNTER_PLUGIN_H_
+#define RUNNER_PLUGINS_TOKEN_COUNTER_PLUGIN_H_
+
+#include <flutter/binary_messenger.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "native/task_executor.h"
+#include "native/token_counter_service.h"
+#include "platform_task_runner.h"
+
+// Handles the "cloudtolocalllm/token_counter" binary channel, which counts
+// prompt tokens with the vocabulary of a model's GGUF file. See
+// native/token_counter_service.h for the message layout.
+//
+// Loading a vocabulary and counting a long prompt take milliseconds, so
+// requests run on |executor|'s interactive lane and the replies are posted
+// back through |task_runner|.
+class TokenCounterPlugin {
+ public:
+  // Installs the channel handler on |messenger|. |messenger|, |task_runner|
+  // and |executor| must outlive this object, and |executor| must be stopped
+  // before it is destroyed.
+  TokenCounterPlugin(flutter::BinaryMessenger* messenger,
+                     PlatformTaskRunner* task_runner,
+                     cloudtolocalllm::TaskExecutor* executor);
+  ~TokenCounterPlugin();
+
+  // Prevent copying.
+  TokenCounterPlugin(TokenCounterPlugin const&) = delete;
+  TokenCounterPlugin& operator=(TokenCounterPlugin const&) = delete;
+
+ private:
+  void HandleMessage(const uint8_t* message, size_t message_size,
+                     const flutter::BinaryReply& reply);
+
+  flutter::BinaryMessenger* messenger_;
+  PlatformTaskRunner* task_runner_;
+  cloudtolocalllm::TaskExecutor* executor_;
+
+  // Requests may run on several workers at once.
+  std::mutex mutex_;
+  cloudtolocalllm::TokenCounterService service_;
+};
+
+#endif  // RUNNER_PLUGINS_TOKEN_COUNTER_PLUGIN_H_
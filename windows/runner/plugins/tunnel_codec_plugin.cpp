@@ -0,0 +1,27 @@
+#include "plugins/tunnel_codec_plugin.h"
+
+namespace {
+
+constexpr char kChannelName[] = "cloudtolocalllm/tunnel_codec";
+
+}  // namespace
+
+TunnelCodecPlugin::TunnelCodecPlugin(flutter::BinaryMessenger* messenger)
+    : messenger_(messenger) {
+  messenger_->SetMessageHandler(
+      kChannelName, [this](const uint8_t* message, size_t message_size,
+                           flutter::BinaryReply reply) {
+        HandleMessage(message, message_size, reply);
+      });
+}
+
+TunnelCodecPlugin::~TunnelCodecPlugin() {
+  messenger_->SetMessageHandler(kChannelName, nullptr);
+}
+
+void TunnelCodecPlugin::HandleMessage(const uint8_t* message,
+                                       size_t message_size,
+                                       const flutter::BinaryReply& reply) {
+  service_.HandleMessage(message, message_size, &reply_buffer_);
+  reply(reply_buffer_.data(), reply_buffer_.size());
+}
@@ -0,0 +1,34 @@
+#ifndef RUNNER_PLUGINS_TUNNEL_CODEC_PLUGIN_H_
+#define RUNNER_PLUGINS_TUNNEL_CODEC_PLUGIN_H_
+
+#include <flutter/binary_messenger.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "native/tunnel_codec_service.h"
+
+// Handles the "cloudtolocalllm/tunnel_codec" binary channel, which seals and
+// opens encrypted tunnel frames with ChaCha20-Poly1305. See
+// native/tunnel_codec_service.h for the message layout.
+class TunnelCodecPlugin {
+ public:
+  // Installs the channel handler on |messenger|, which must outlive this
+  // object.
+  explicit TunnelCodecPlugin(flutter::BinaryMessenger* messenger);
+  ~TunnelCodecPlugin();
+
+  // Prevent copying.
+  TunnelCodecPlugin(TunnelCodecPlugin const&) = delete;
+  TunnelCodecPlugin& operator=(TunnelCodecPlugin const&) = delete;
+
+ private:
+  void HandleMessage(const uint8_t* message, size_t message_size,
+                     const flutter::BinaryReply& reply);
+
+  flutter::BinaryMessenger* messenger_;
+  cloudtolocalllm::TunnelCodecService service_;
+  std::vector<uint8_t> reply_buffer_;
+};
+
+#endif  // RUNNER_PLUGINS_TUNNEL_CODEC_PLUGIN_H_
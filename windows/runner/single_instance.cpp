@@ -0,0 +1,140 @@
+#include "single_instance.h"
+
+#include "native/forwarded_launch.h"
+#include "native/utf_transcode.h"
+#include "utils.h"
+
+namespace {
+
+constexpr const wchar_t kMutexName[] = L"Local\\CloudToLocalLLM.SingleInstance";
+constexpr const wchar_t kWindowClassName[] = L"CLOUDTOLOCALLLM_SINGLE_INSTANCE";
+
+// COPYDATASTRUCT::dwData tag for a forwarded launch ("CTLL").
+constexpr ULONG_PTR kCopyDataLaunch = 0x4C4C5443;
+
+// The primary creates its window right after the mutex, but a launch can
+// land in between; this bounds how long a later instance waits for it.
+constexpr int kFindWindowAttempts = 20;
+constexpr DWORD kFindWindowIntervalMs = 100;
+constexpr UINT kSendTimeoutMs = 5000;
+
+}  // namespace
+
+SingleInstance::SingleInstance() {}
+
+SingleInstance::~SingleInstance() {
+  if (window_ != nullptr) {
+    SetWindowLongPtr(window_, GWLP_USERDATA, 0);
+    DestroyWindow(window_);
+    window_ = nullptr;
+  }
+  if (mutex_ != nullptr) {
+    CloseHandle(mutex_);
+    mutex_ = nullptr;
+  }
+}
+
+bool SingleInstance::AcquireOrForward(
+    const std::vector<std::string>& arguments) {
+  mutex_ = CreateMutexW(nullptr, FALSE, kMutexName);
+  if (mutex_ == nullptr) {
+    // No way to tell; behave as before rather than refusing to start.
+    return true;
+  }
+  if (GetLastError() != ERROR_ALREADY_EXISTS) {
+    WNDCLASS window_class{};
+    window_class.lpszClassName = kWindowClassName;
+    window_class.hInstance = GetModuleHandle(nullptr);
+    window_class.lpfnWndProc = SingleInstance::WndProc;
+    RegisterClass(&window_class);
+    window_ = CreateWindowEx(0, kWindowClassName, L"", 0, 0, 0, 0, 0,
+                             HWND_MESSAGE, nullptr, GetModuleHandle(nullptr),
+                             nullptr);
+    if (window_ != nullptr) {
+      SetWindowLongPtr(window_, GWLP_USERDATA,
+                       reinterpret_cast<LONG_PTR>(this));
+    }
+    return true;
+  }
+  CloseHandle(mutex_);
+  mutex_ = nullptr;
+
+  HWND primary = nullptr;
+  for (int attempt = 0; attempt < kFindWindowAttempts && primary == nullptr;
+       attempt++) {
+    primary = FindWindowEx(HWND_MESSAGE, nullptr, kWindowClassName, nullptr);
+    if (primary == nullptr) {
+      Sleep(kFindWindowIntervalMs);
+    }
+  }
+  if (primary == nullptr) {
+    return false;
+  }
+
+  cloudtolocalllm::ForwardedLaunch launch;
+  wchar_t working_directory[MAX_PATH];
+  const DWORD length = GetCurrentDirectoryW(MAX_PATH, working_directory);
+  if (length > 0 && length < MAX_PATH) {
+    cloudtolocalllm::Utf16ToUtf8(working_directory, length,
+                                 &launch.working_directory);
+  }
+  launch.arguments = arguments;
+  const std::vector<uint8_t> encoded =
+      cloudtolocalllm::EncodeForwardedLaunch(launch);
+
+  // Windows only lets the foreground process hand the foreground on.
+  DWORD primary_process = 0;
+  GetWindowThreadProcessId(primary, &primary_process);
+  AllowSetForegroundWindow(primary_process);
+
+  COPYDATASTRUCT copy_data{};
+  copy_data.dwData = kCopyDataLaunch;
+  copy_data.cbData = static_cast<DWORD>(encoded.size());
+  copy_data.lpData = const_cast<uint8_t*>(encoded.data());
+  DWORD_PTR result = 0;
+  SendMessageTimeout(primary, WM_COPYDATA, 0,
+                     reinterpret_cast<LPARAM>(&copy_data), SMTO_ABORTIFHUNG,
+                     kSendTimeoutMs, &result);
+  return false;
+}
+
+void SingleInstance::SetLaunchHandler(LaunchHandler handler) {
+  handler_ = std::move(handler);
+  std::vector<std::vector<uint8_t>> pending;
+  pending.swap(pending_launches_);
+  for (auto& launch : pending) {
+    OnLaunch(std::move(launch));
+  }
+}
+
+// static
+LRESULT CALLBACK SingleInstance::WndProc(HWND const window, UINT const message,
+                                         WPARAM const wparam,
+                                         LPARAM const lparam) noexcept {
+  if (message == WM_COPYDATA) {
+    auto* instance = reinterpret_cast<SingleInstance*>(
+        GetWindowLongPtr(window, GWLP_USERDATA));
+    const auto* copy_data = reinterpret_cast<const COPYDATASTRUCT*>(lparam);
+    if (instance == nullptr || copy_data->dwData != kCopyDataLaunch) {
+      return FALSE;
+    }
+    const auto* data = static_cast<const uint8_t*>(copy_data->lpData);
+    cloudtolocalllm::ForwardedLaunch launch;
+    // Validated here, since it comes from another process.
+    if (!cloudtolocalllm::DecodeForwardedLaunch(data, copy_data->cbData,
+                                                &launch)) {
+      return FALSE;
+    }
+    instance->OnLaunch(std::vector<uint8_t>(data, data + copy_data->cbData));
+    return TRUE;
+  }
+  return DefWindowProc(window, message, wparam, lparam);
+}
+
+void SingleInstance::OnLaunch(std::vector<uint8_t> launch) {
+  if (!handler_) {
+    pending_launches_.push_back(std::move(launch));
+    return;
+  }
+  handler_(launch);
+}
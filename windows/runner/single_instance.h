@@ -0,0 +1,53 @@
+#ifndef RUNNER_SINGLE_INSTANCE_H_
+#define RUNNER_SINGLE_INSTANCE_H_
+
+#include <windows.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Keeps the app to one instance per user session. The first process owns a
+// named mutex and a message-only window; later ones send that window their
+// command line with WM_COPYDATA and exit, so launching the app again from
+// the Start menu or a shortcut does not start a second Flutter engine and
+// tunnel session.
+//
+// Must be created and destroyed on the platform thread.
+class SingleInstance {
+ public:
+  // Receives each later launch, encoded as in native/forwarded_launch.h.
+  using LaunchHandler = std::function<void(const std::vector<uint8_t>&)>;
+
+  SingleInstance();
+  ~SingleInstance();
+
+  // Prevent copying.
+  SingleInstance(SingleInstance const&) = delete;
+  SingleInstance& operator=(SingleInstance const&) = delete;
+
+  // Returns true if this process is the primary instance. Otherwise
+  // |arguments| (without the executable name) have been handed to the
+  // primary, which is allowed to take the foreground, and this process
+  // should exit.
+  bool AcquireOrForward(const std::vector<std::string>& arguments);
+
+  // Sets the handler for later launches; any that arrived before it was set
+  // are delivered straight away.
+  void SetLaunchHandler(LaunchHandler handler);
+
+ private:
+  static LRESULT CALLBACK WndProc(HWND const window, UINT const message,
+                                  WPARAM const wparam,
+                                  LPARAM const lparam) noexcept;
+
+  void OnLaunch(std::vector<uint8_t> launch);
+
+  HANDLE mutex_ = nullptr;
+  HWND window_ = nullptr;
+  LaunchHandler handler_;
+  std::vector<std::vector<uint8_t>> pending_launches_;
+};
+
+#endif  // RUNNER_SINGLE_INSTANCE_H_
@@ -7,6 +7,8 @@
 
 #include <iostream>
 
+#include "native/utf_transcode.h"
+
 void CreateAndAttachConsole() {
   if (::AllocConsole()) {
     FILE *unused;
@@ -29,11 +31,12 @@ std::vector<std::string> GetCommandLineArguments() {
     return std::vector<std::string>();
   }
 
-  std::vector<std::string> command_line_arguments;
-
-  // Skip the first argument as it's the binary name.
+  // Skip the first argument as it's the binary name. Each argument is
+  // converted straight into its own string, sized from its length.
+  std::vector<std::string> command_line_arguments(argc > 1 ? argc - 1 : 0);
   for (int i = 1; i < argc; i++) {
-    command_line_arguments.push_back(Utf8FromUtf16(argv[i]));
+    cloudtolocalllm::Utf16ToUtf8(argv[i], wcslen(argv[i]),
+                                 &command_line_arguments[i - 1]);
   }
 
   ::LocalFree(argv);
@@ -42,24 +45,10 @@ std::vector<std::string> GetCommandLineArguments() {
 }
 
 std::string Utf8FromUtf16(const wchar_t* utf16_string) {
-  if (utf16_string == nullptr) {
-    return std::string();
-  }
-  unsigned int target_length = ::WideCharToMultiByte(
-      CP_UTF8, WC_ERR_INVALID_CHARS, utf16_string,
-      -1, nullptr, 0, nullptr, nullptr)
-    -1; // remove the trailing null character
-  int input_length = (int)wcslen(utf16_string);
   std::string utf8_string;
-  if (target_length == 0 || target_length > utf8_string.max_size()) {
-    return utf8_string;
-  }
-  utf8_string.resize(target_length);
-  int converted_length = ::WideCharToMultiByte(
-      CP_UTF8, WC_ERR_INVALID_CHARS, utf16_string,
-      input_length, utf8_string.data(), target_length, nullptr, nullptr);
-  if (converted_length == 0) {
-    return std::string();
+  if (utf16_string != nullptr) {
+    cloudtolocalllm::Utf16ToUtf8(utf16_string, wcslen(utf16_string),
+                                 &utf8_string);
   }
   return utf8_string;
 }
@@ -3,6 +3,7 @@
 #include <dwmapi.h>
 #include <flutter_windows.h>
 
+#include "native/startup_trace.h"
 #include "resource.h"
 
 namespace {
@@ -123,6 +124,7 @@ Win32Window::~Win32Window() {
 bool Win32Window::Create(const std::wstring& title,
                          const Point& origin,
                          const Size& size) {
+  cloudtolocalllm::ScopedStartupTrace trace("Win32Window::Create");
   Destroy();
 
   const wchar_t* window_class =
@@ -134,11 +136,13 @@ bool Win32Window::Create(const std::wstring& title,
   UINT dpi = FlutterDesktopGetDpiForMonitor(monitor);
   double scale_factor = dpi / 96.0;
 
+  cloudtolocalllm::StartupTrace::Get()->Begin("CreateWindow");
   HWND window = CreateWindow(
       window_class, title.c_str(), WS_OVERLAPPEDWINDOW,
       Scale(origin.x, scale_factor), Scale(origin.y, scale_factor),
       Scale(size.width, scale_factor), Scale(size.height, scale_factor),
       nullptr, nullptr, GetModuleHandle(nullptr), this);
+  cloudtolocalllm::StartupTrace::Get()->End();
 
   if (!window) {
     return false;